@@ -0,0 +1,83 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+#ifndef __ND_BENCHMARK_UTILS_H__
+#define __ND_BENCHMARK_UTILS_H__
+
+#include <cstdio>
+#include <cstdlib>
+#include "ndNewton.h"
+
+// add a large static floor to the world.
+inline ndBodyKinematic* ndBenchmarkAddFloor(ndWorld& world, const ndVector& origin)
+{
+	ndShapeInstance box(new ndShapeBox(ndFloat32(1000.0f), ndFloat32(1.0f), ndFloat32(1000.0f)));
+	ndMatrix matrix(ndGetIdentityMatrix());
+	matrix.m_posit = origin;
+	matrix.m_posit.m_y -= ndFloat32(0.5f);
+	matrix.m_posit.m_w = ndFloat32(1.0f);
+
+	ndBodyKinematic* const body = new ndBodyKinematic();
+	body->SetCollisionShape(box);
+	body->SetMatrix(matrix);
+	ndSharedPtr<ndBody> bodyPtr(body);
+	world.AddBody(bodyPtr);
+	return body;
+}
+
+// add a grid of dynamic bodies, count x count bodies per layer. 
+inline void ndBenchmarkAddPile(ndWorld& world, const ndShapeInstance& shape, const ndVector& origin, ndInt32 count, ndInt32 layers, ndFloat32 spacing, bool autoSleep = true)
+{
+	const ndVector gravity(ndFloat32(0.0f), ndFloat32(-10.0f), ndFloat32(0.0f), ndFloat32(0.0f));
+	const ndFloat32 offset = ndFloat32(count - 1) * spacing * ndFloat32(0.5f);
+	for (ndInt32 y = 0; y < layers; ++y)
+	{
+		for (ndInt32 z = 0; z < count; ++z)
+		{
+			for (ndInt32 x = 0; x < count; ++x)
+			{
+				ndMatrix matrix(ndGetIdentityMatrix());
+				matrix.m_posit = origin + ndVector(ndFloat32(x) * spacing - offset, ndFloat32(y) * spacing + spacing * ndFloat32(0.5f), ndFloat32(z) * spacing - offset, ndFloat32(0.0f));
+				matrix.m_posit.m_w = ndFloat32(1.0f);
+
+				ndBodyDynamic* const body = new ndBodyDynamic();
+				body->SetNotifyCallback(new ndBodyNotify(gravity));
+				body->SetCollisionShape(shape);
+				body->SetMatrix(matrix);
+				body->SetMassMatrix(ndFloat32(1.0f), shape);
+				body->SetAutoSleep(autoSleep);
+				ndSharedPtr<ndBody> bodyPtr(body);
+				world.AddBody(bodyPtr);
+			}
+		}
+	}
+}
+
+// run the world for some frames and return the average frame time in micro seconds.
+inline ndFloat64 ndBenchmarkRun(ndWorld& world, ndInt32 frames, ndFloat32 timestep = ndFloat32(1.0f / 60.0f))
+{
+	ndUnsigned64 time = 0;
+	for (ndInt32 i = 0; i < frames; ++i)
+	{
+		const ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+		world.Update(timestep);
+		world.Sync();
+		time += ndGetTimeInMicroseconds() - time0;
+	}
+	return ndFloat64(time) / ndFloat64(ndMax(frames, 1));
+}
+
+inline ndInt32 ndBenchmarkGetArg(int argc, char** argv, ndInt32 index, ndInt32 defaultValue)
+{
+	return (index < argc) ? ndInt32(atoi(argv[index])) : defaultValue;
+}
+
+#endif
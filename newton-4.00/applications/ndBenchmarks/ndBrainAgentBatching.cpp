@@ -0,0 +1,110 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// compare the policy latency of many inference agents sharing one brain, 
+// stepping each agent by itself against one ndBrainAgentBatch step.
+// usage: ndBrainAgentBatching [maxAgents] [steps] [threads]
+
+#include "ndBenchmarkUtils.h"
+#include "ndBrainInc.h"
+
+#define D_BENCHMARK_OBSERVATIONS	32
+#define D_BENCHMARK_ACTIONS			8
+
+class ndBenchmarkAgent: public ndBrainAgentContinuePolicyGradient<D_BENCHMARK_OBSERVATIONS, D_BENCHMARK_ACTIONS>
+{
+	public:
+	ndBenchmarkAgent(const ndSharedPtr<ndBrain>& actor)
+		:ndBrainAgentContinuePolicyGradient<D_BENCHMARK_OBSERVATIONS, D_BENCHMARK_ACTIONS>(actor)
+	{
+		for (ndInt32 i = 0; i < D_BENCHMARK_OBSERVATIONS; ++i)
+		{
+			m_observation[i] = ndBrainFloat(ndRand() * 2.0f - 1.0f);
+		}
+	}
+
+	void GetObservation(ndBrainFloat* const observation)
+	{
+		for (ndInt32 i = 0; i < D_BENCHMARK_OBSERVATIONS; ++i)
+		{
+			observation[i] = m_observation[i];
+		}
+	}
+
+	void ApplyActions(ndBrainFloat* const actions)
+	{
+		for (ndInt32 i = 0; i < D_BENCHMARK_ACTIONS; ++i)
+		{
+			m_actions[i] = actions[i];
+		}
+	}
+
+	ndBrainFloat m_observation[D_BENCHMARK_OBSERVATIONS];
+	ndBrainFloat m_actions[D_BENCHMARK_ACTIONS];
+};
+
+int main(int argc, char** argv)
+{
+	const ndInt32 maxAgents = ndBenchmarkGetArg(argc, argv, 1, 1024);
+	const ndInt32 steps = ndBenchmarkGetArg(argc, argv, 2, 100);
+	const ndInt32 threads = ndBenchmarkGetArg(argc, argv, 3, ndBrainThreadPool::GetMaxThreads());
+
+	// the default policy shape of the continue policy gradient agents
+	const ndInt32 neurons = 64;
+	ndSharedPtr<ndBrain> brain(new ndBrain());
+	brain->AddLayer(new ndBrainLayerLinear(D_BENCHMARK_OBSERVATIONS, neurons));
+	brain->AddLayer(new ndBrainLayerTanhActivation(neurons));
+	brain->AddLayer(new ndBrainLayerLinear(neurons, neurons));
+	brain->AddLayer(new ndBrainLayerTanhActivation(neurons));
+	brain->AddLayer(new ndBrainLayerLinear(neurons, neurons));
+	brain->AddLayer(new ndBrainLayerTanhActivation(neurons));
+	brain->AddLayer(new ndBrainLayerLinear(neurons, D_BENCHMARK_ACTIONS));
+	brain->AddLayer(new ndBrainLayerTanhActivation(D_BENCHMARK_ACTIONS));
+	brain->InitWeightsXavierMethod();
+
+	ndBrainAgentBatch batch(brain, threads);
+
+	printf("threads: %d\n", batch.GetThreadCount());
+	printf("agents, agent step(us/step), batch step(us/step), speedup\n");
+	ndArray<ndBenchmarkAgent*> agents;
+	for (ndInt32 count = 1; count <= maxAgents; count *= 2)
+	{
+		while (agents.GetCount() < count)
+		{
+			agents.PushBack(new ndBenchmarkAgent(brain));
+			batch.AddAgent(agents[agents.GetCount() - 1]);
+		}
+
+		ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+		for (ndInt32 i = 0; i < steps; ++i)
+		{
+			for (ndInt32 j = 0; j < agents.GetCount(); ++j)
+			{
+				agents[j]->Step();
+			}
+		}
+		const ndFloat64 agentTime = ndFloat64(ndGetTimeInMicroseconds() - time0) / ndFloat64(steps);
+
+		time0 = ndGetTimeInMicroseconds();
+		for (ndInt32 i = 0; i < steps; ++i)
+		{
+			batch.Step();
+		}
+		const ndFloat64 batchTime = ndFloat64(ndGetTimeInMicroseconds() - time0) / ndFloat64(steps);
+		printf("%d, %.1f, %.1f, %.2f\n", count, agentTime, batchTime, agentTime / ndMax(batchTime, 1.0e-3));
+	}
+
+	for (ndInt32 i = 0; i < agents.GetCount(); ++i)
+	{
+		delete agents[i];
+	}
+	return 0;
+}
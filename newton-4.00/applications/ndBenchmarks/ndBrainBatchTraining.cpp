@@ -0,0 +1,173 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// train the networks of the tutorials with batch sizes from 1 to 512, 
+// comparing one trainer per sample, as the tutorials do, against a single 
+// trainer that back propagates the whole batch through the matrix kernels.
+// the data is random, only the shapes of the networks matter.
+// usage: ndBrainBatchTraining [samples] [maxBatch]
+
+#include "ndBenchmarkUtils.h"
+#include "ndBrainInc.h"
+
+static void BuildMnistNetwork(ndBrain& brain)
+{
+	// same as the linear network of the hand written digits tutorial
+	const ndInt32 neurons = 64;
+	brain.AddLayer(new ndBrainLayerLinear(28 * 28, neurons));
+	brain.AddLayer(new ndBrainLayerReluActivation(neurons));
+	brain.AddLayer(new ndBrainLayerLinear(neurons, neurons));
+	brain.AddLayer(new ndBrainLayerReluActivation(neurons));
+	brain.AddLayer(new ndBrainLayerLinear(neurons, neurons));
+	brain.AddLayer(new ndBrainLayerReluActivation(neurons));
+	brain.AddLayer(new ndBrainLayerLinear(neurons, 10));
+	brain.AddLayer(new ndBrainLayerCategoricalSoftmaxActivation(10));
+	brain.InitWeightsXavierMethod();
+}
+
+static void BuildPolicyNetwork(ndBrain& brain)
+{
+	// same shape as the default policy of the reinforcement learning agents
+	const ndInt32 neurons = 64;
+	brain.AddLayer(new ndBrainLayerLinear(32, neurons));
+	brain.AddLayer(new ndBrainLayerTanhActivation(neurons));
+	brain.AddLayer(new ndBrainLayerLinear(neurons, neurons));
+	brain.AddLayer(new ndBrainLayerTanhActivation(neurons));
+	brain.AddLayer(new ndBrainLayerLinear(neurons, neurons));
+	brain.AddLayer(new ndBrainLayerTanhActivation(neurons));
+	brain.AddLayer(new ndBrainLayerLinear(neurons, 8));
+	brain.AddLayer(new ndBrainLayerTanhActivation(8));
+	brain.InitWeightsXavierMethod();
+}
+
+static void MakeData(ndBrainMatrix& input, ndBrainMatrix& truth, bool categorical)
+{
+	for (ndInt32 i = 0; i < input.GetRows(); ++i)
+	{
+		for (ndInt32 j = 0; j < input.GetColumns(); ++j)
+		{
+			input[i][j] = ndBrainFloat(ndRand());
+		}
+		truth[i].Set(ndBrainFloat(0.0f));
+		if (categorical)
+		{
+			truth[i][ndInt32(ndRandInt() % ndUnsigned32(truth.GetColumns()))] = ndBrainFloat(1.0f);
+		}
+		else
+		{
+			for (ndInt32 j = 0; j < truth.GetColumns(); ++j)
+			{
+				truth[i][j] = ndBrainFloat(ndRand() * 2.0f - 1.0f);
+			}
+		}
+	}
+}
+
+// one trainer per sample of the batch and an optimizer step per batch, in micro seconds per sample.
+static ndFloat64 TrainSingleSample(ndBrain& brain, ndBrainLoss& loss, const ndBrainMatrix& input, const ndBrainMatrix& truth, ndInt32 batchSize)
+{
+	ndArray<ndBrainTrainer*> trainers;
+	for (ndInt32 i = 0; i < batchSize; ++i)
+	{
+		trainers.PushBack(new ndBrainTrainer(&brain));
+	}
+	ndBrainOptimizerAdam optimizer;
+
+	const ndInt32 batches = input.GetRows() / batchSize;
+	const ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+	for (ndInt32 i = 0; i < batches; ++i)
+	{
+		for (ndInt32 j = 0; j < batchSize; ++j)
+		{
+			const ndInt32 index = i * batchSize + j;
+			loss.SetTruth(truth[index]);
+			trainers[j]->BackPropagate(input[index], loss);
+		}
+		optimizer.Update(nullptr, trainers, ndBrainFloat(1.0e-4f));
+	}
+	const ndUnsigned64 time = ndGetTimeInMicroseconds() - time0;
+
+	for (ndInt32 i = 0; i < trainers.GetCount(); ++i)
+	{
+		delete trainers[i];
+	}
+	return ndFloat64(time) / ndFloat64(ndMax(batches * batchSize, 1));
+}
+
+// one trainer for the whole batch and an optimizer step per batch, in micro seconds per sample.
+static ndFloat64 TrainBatch(ndBrain& brain, ndBrainLoss& loss, const ndBrainMatrix& input, const ndBrainMatrix& truth, ndInt32 batchSize)
+{
+	ndArray<ndBrainTrainer*> trainers;
+	trainers.PushBack(new ndBrainTrainer(&brain));
+	ndBrainOptimizerAdam optimizer;
+
+	ndBrainMatrix batchInput(batchSize, input.GetColumns());
+	ndBrainMatrix batchTruth(batchSize, truth.GetColumns());
+
+	const ndInt32 batches = input.GetRows() / batchSize;
+	const ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+	for (ndInt32 i = 0; i < batches; ++i)
+	{
+		for (ndInt32 j = 0; j < batchSize; ++j)
+		{
+			batchInput[j].Set(input[i * batchSize + j]);
+			batchTruth[j].Set(truth[i * batchSize + j]);
+		}
+		trainers[0]->BackPropagate(batchInput, batchTruth, loss);
+		optimizer.Update(nullptr, trainers, ndBrainFloat(1.0e-4f));
+	}
+	const ndUnsigned64 time = ndGetTimeInMicroseconds() - time0;
+
+	delete trainers[0];
+	return ndFloat64(time) / ndFloat64(ndMax(batches * batchSize, 1));
+}
+
+static void RunNetwork(const char* const name, void (*BuildNetwork)(ndBrain&), ndInt32 samples, ndInt32 maxBatch)
+{
+	ndBrain brain;
+	BuildNetwork(brain);
+	const bool categorical = !strcmp(brain[brain.GetCount() - 1]->GetLabelId(), "ndBrainLayerCategoricalSoftmaxActivation");
+
+	ndBrainMatrix input(samples, brain.GetInputSize());
+	ndBrainMatrix truth(samples, brain.GetOutputSize());
+	MakeData(input, truth, categorical);
+
+	ndBrainLossLeastSquaredError leastSquared(brain.GetOutputSize());
+	ndBrainLossCategoricalCrossEntropy crossEntropy(brain.GetOutputSize());
+	ndBrainLoss& loss = categorical ? (ndBrainLoss&)crossEntropy : (ndBrainLoss&)leastSquared;
+
+	printf("%s, parameters: %d\n", name, brain.GetNumberOfParameters());
+	printf("batch, single sample(us/sample), batched(us/sample), speedup\n");
+	for (ndInt32 batchSize = 1; batchSize <= ndMin(maxBatch, samples); batchSize *= 2)
+	{
+		ndBrain singleBrain(brain);
+		ndBrain batchBrain(brain);
+		const ndFloat64 singleTime = TrainSingleSample(singleBrain, loss, input, truth, batchSize);
+		const ndFloat64 batchTime = TrainBatch(batchBrain, loss, input, truth, batchSize);
+		printf("%d, %.2f, %.2f, %.2f\n", batchSize, singleTime, batchTime, singleTime / ndMax(batchTime, 1.0e-3));
+	}
+	printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+	const ndInt32 samples = ndBenchmarkGetArg(argc, argv, 1, 4096);
+	const ndInt32 maxBatch = ndBenchmarkGetArg(argc, argv, 2, 512);
+
+#ifdef D_NEWTON_USE_AVX2_OPTION
+	printf("matrix kernels: avx2\n\n");
+#else
+	printf("matrix kernels: generic\n\n");
+#endif
+	RunNetwork("mnist", BuildMnistNetwork, samples, maxBatch);
+	RunNetwork("policy", BuildPolicyNetwork, samples, maxBatch);
+	return 0;
+}
@@ -0,0 +1,165 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// time the 2d convolution layers of the convolutional network of the 
+// hand written digits tutorial, each layer by itself and the whole network,
+// for prediction and for one training step per sample.
+// the data is random, only the shapes of the layers matter.
+// usage: ndBrainConvolution [iterations]
+
+#include "ndBenchmarkUtils.h"
+#include "ndBrainInc.h"
+
+#define D_BENCHMARK_FEATURE_MAPS	32
+
+template <class ndConvolution>
+static void BuildDigitsNetwork(ndBrain& brain)
+{
+	// same as the convolutional network of the hand written digits tutorial
+	const ndConvolution* conv;
+	const ndBrainLayerImagePolling_2x2* pooling;
+
+	brain.AddLayer(new ndConvolution(28, 28, 1, 3, D_BENCHMARK_FEATURE_MAPS));
+	conv = (ndConvolution*)brain[brain.GetCount() - 1];
+	brain.AddLayer(new ndBrainLayerReluActivation(conv->GetOutputSize()));
+	brain.AddLayer(new ndBrainLayerImagePolling_2x2(conv->GetOutputWidth(), conv->GetOutputHeight(), conv->GetOutputChannels()));
+	pooling = (ndBrainLayerImagePolling_2x2*)brain[brain.GetCount() - 1];
+
+	for (ndInt32 i = 0; i < 2; ++i)
+	{
+		brain.AddLayer(new ndConvolution(pooling->GetOutputWidth(), pooling->GetOutputHeight(), pooling->GetOutputChannels(), 3, D_BENCHMARK_FEATURE_MAPS));
+		conv = (ndConvolution*)brain[brain.GetCount() - 1];
+		brain.AddLayer(new ndBrainLayerReluActivation(conv->GetOutputSize()));
+		brain.AddLayer(new ndBrainLayerImagePolling_2x2(conv->GetOutputWidth(), conv->GetOutputHeight(), conv->GetOutputChannels()));
+		pooling = (ndBrainLayerImagePolling_2x2*)brain[brain.GetCount() - 1];
+	}
+
+	brain.AddLayer(new ndBrainLayerLinear(pooling->GetOutputSize(), 64));
+	brain.AddLayer(new ndBrainLayerReluActivation(64));
+	brain.AddLayer(new ndBrainLayerLinear(64, 64));
+	brain.AddLayer(new ndBrainLayerReluActivation(64));
+	brain.AddLayer(new ndBrainLayerLinear(64, 10));
+	brain.AddLayer(new ndBrainLayerCategoricalSoftmaxActivation(10));
+	brain.InitWeightsXavierMethod();
+}
+
+static void FillRandom(ndBrainVector& vector)
+{
+	for (ndInt32 i = 0; i < vector.GetCount(); ++i)
+	{
+		vector[i] = ndBrainFloat(ndRand() * 2.0f - 1.0f);
+	}
+}
+
+template <class ndConvolution>
+static void TimeLayers(const ndBrain& brain, ndInt32 iterations)
+{
+	const ndConvolution prototype(4, 4, 1, 3, 1);
+	for (ndInt32 i = 0; i < brain.GetCount(); ++i)
+	{
+		const ndConvolution* const layer = (ndConvolution*)brain[i];
+		if (strcmp(layer->GetLabelId(), prototype.GetLabelId()))
+		{
+			continue;
+		}
+
+		ndBrainVector input;
+		ndBrainVector output;
+		ndBrainVector outputDerivative;
+		ndBrainVector inputGradient;
+		input.SetCount(layer->GetInputSize());
+		output.SetCount(layer->GetOutputBufferSize());
+		outputDerivative.SetCount(layer->GetOutputSize());
+		inputGradient.SetCount(layer->GetInputSize());
+		FillRandom(input);
+		FillRandom(outputDerivative);
+		ndSharedPtr<ndBrainLayer> gradients(layer->Clone());
+
+		ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+		for (ndInt32 j = 0; j < iterations; ++j)
+		{
+			ndBrainMemVector out(&output[0], layer->GetOutputSize());
+			layer->MakePrediction(input, out);
+		}
+		const ndFloat64 predictionTime = ndFloat64(ndGetTimeInMicroseconds() - time0) / ndFloat64(iterations);
+
+		time0 = ndGetTimeInMicroseconds();
+		for (ndInt32 j = 0; j < iterations; ++j)
+		{
+			layer->CalculateParamGradients(input, output, outputDerivative, inputGradient, *gradients);
+		}
+		const ndFloat64 gradientTime = ndFloat64(ndGetTimeInMicroseconds() - time0) / ndFloat64(iterations);
+
+		// one multiply add per weight and output pixel, twice as many for the gradients.
+		const ndFloat64 weights = ndFloat64(layer->GetNumberOfParameters() - layer->GetOutputChannels());
+		const ndFloat64 flops = 2.0 * weights * ndFloat64(layer->GetOutputWidth() * layer->GetOutputHeight());
+		printf("%s %d, %d, %.1f, %.1f, %.2f, %.2f\n", layer->GetLabelId(), i, layer->GetInputSize(), predictionTime, gradientTime, 
+			flops * 1.0e-3 / ndMax(predictionTime, 1.0e-3), 2.0 * flops * 1.0e-3 / ndMax(gradientTime, 1.0e-3));
+	}
+}
+
+static void TimeNetwork(ndBrain& brain, ndInt32 iterations)
+{
+	ndBrainVector input;
+	ndBrainVector output;
+	ndBrainVector truth;
+	ndBrainVector workingBuffer;
+	input.SetCount(brain.GetInputSize());
+	output.SetCount(brain.GetOutputSize());
+	truth.SetCount(brain.GetOutputSize());
+	FillRandom(input);
+	truth.Set(ndBrainFloat(0.0f));
+	truth[3] = ndBrainFloat(1.0f);
+
+	ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+	for (ndInt32 i = 0; i < iterations; ++i)
+	{
+		brain.MakePrediction(input, output, workingBuffer);
+	}
+	const ndFloat64 predictionTime = ndFloat64(ndGetTimeInMicroseconds() - time0) / ndFloat64(iterations);
+
+	ndBrainTrainer trainer(&brain);
+	ndBrainLossCategoricalCrossEntropy loss(brain.GetOutputSize());
+	loss.SetTruth(truth);
+	time0 = ndGetTimeInMicroseconds();
+	for (ndInt32 i = 0; i < iterations; ++i)
+	{
+		trainer.BackPropagate(input, loss);
+	}
+	const ndFloat64 trainingTime = ndFloat64(ndGetTimeInMicroseconds() - time0) / ndFloat64(iterations);
+	printf("network prediction(us/sample), %.1f\n", predictionTime);
+	printf("network training step(us/sample), %.1f\n", trainingTime);
+}
+
+int main(int argc, char** argv)
+{
+	const ndInt32 iterations = ndBenchmarkGetArg(argc, argv, 1, 200);
+
+	for (ndInt32 n = 0; n < 2; ++n)
+	{
+		ndBrain brain;
+		if (n == 0)
+		{
+			BuildDigitsNetwork<ndBrainLayerConvolutional_2d>(brain);
+			printf("layer, index, inputs, prediction(us), gradients(us), prediction(gflops), gradients(gflops)\n");
+			TimeLayers<ndBrainLayerConvolutional_2d>(brain, iterations);
+		}
+		else
+		{
+			BuildDigitsNetwork<ndBrainLayerCrossCorrelation_2d>(brain);
+			printf("layer, index, inputs, prediction(us), gradients(us), prediction(gflops), gradients(gflops)\n");
+			TimeLayers<ndBrainLayerCrossCorrelation_2d>(brain, iterations);
+		}
+		TimeNetwork(brain, iterations);
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,106 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// compare the latency of one prediction of small policy networks, 
+// layer by layer against the fused steps of ndBrainInference.
+// usage: ndBrainFusedInference [predictions]
+
+#include "ndBenchmarkUtils.h"
+#include "ndBrainInc.h"
+
+static ndBrain* ndCreatePolicy(ndInt32 inputs, ndInt32 neurons, ndInt32 hiddenLayers, ndInt32 outputs, bool softmax)
+{
+	ndBrain* const brain = new ndBrain();
+	brain->AddLayer(new ndBrainLayerLinear(inputs, neurons));
+	brain->AddLayer(new ndBrainLayerReluActivation(neurons));
+	for (ndInt32 i = 1; i < hiddenLayers; ++i)
+	{
+		brain->AddLayer(new ndBrainLayerLinear(neurons, neurons));
+		brain->AddLayer(new ndBrainLayerTanhActivation(neurons));
+	}
+	brain->AddLayer(new ndBrainLayerLinear(neurons, outputs));
+	if (softmax)
+	{
+		brain->AddLayer(new ndBrainLayerSoftmaxActivation(outputs));
+	}
+	else
+	{
+		brain->AddLayer(new ndBrainLayerTanhActivation(outputs));
+	}
+	brain->InitWeightsXavierMethod();
+	return brain;
+}
+
+int main(int argc, char** argv)
+{
+	const ndInt32 predictions = ndBenchmarkGetArg(argc, argv, 1, 20000);
+
+	class ndShape
+	{
+		public:
+		ndInt32 m_inputs;
+		ndInt32 m_neurons;
+		ndInt32 m_hiddenLayers;
+		ndInt32 m_outputs;
+		bool m_softmax;
+	};
+	const ndShape shapes[] = 
+	{
+		{ 8, 16, 2, 2, false },
+		{ 32, 32, 2, 8, false },
+		{ 32, 64, 3, 8, false },
+		{ 64, 64, 3, 16, true },
+		{ 64, 128, 3, 16, true },
+		{ 128, 256, 3, 32, false },
+	};
+
+	printf("inputs, neurons, hidden layers, outputs, layers(us), fused(us), speedup, max difference\n");
+	for (ndInt32 n = 0; n < ndInt32(sizeof(shapes) / sizeof(shapes[0])); ++n)
+	{
+		const ndShape& shape = shapes[n];
+		ndSharedPtr<ndBrain> brain(ndCreatePolicy(shape.m_inputs, shape.m_neurons, shape.m_hiddenLayers, shape.m_outputs, shape.m_softmax));
+		ndBrainInference inference(brain);
+
+		ndBrainVector input;
+		ndBrainVector output;
+		ndBrainVector fusedOutput;
+		ndBrainVector workingBuffer;
+		input.SetCount(shape.m_inputs);
+		output.SetCount(shape.m_outputs);
+		fusedOutput.SetCount(shape.m_outputs);
+		for (ndInt32 i = 0; i < input.GetCount(); ++i)
+		{
+			input[i] = ndBrainFloat(ndRand() * 2.0f - 1.0f);
+		}
+
+		ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+		for (ndInt32 i = 0; i < predictions; ++i)
+		{
+			brain->MakePrediction(input, output, workingBuffer);
+		}
+		const ndFloat64 layerTime = ndFloat64(ndGetTimeInMicroseconds() - time0) / ndFloat64(predictions);
+
+		time0 = ndGetTimeInMicroseconds();
+		for (ndInt32 i = 0; i < predictions; ++i)
+		{
+			inference.MakePrediction(input, fusedOutput);
+		}
+		const ndFloat64 fusedTime = ndFloat64(ndGetTimeInMicroseconds() - time0) / ndFloat64(predictions);
+
+		ndBrainFloat maxDifference = ndBrainFloat(0.0f);
+		for (ndInt32 i = 0; i < output.GetCount(); ++i)
+		{
+			maxDifference = ndMax(maxDifference, ndBrainFloat(ndAbs(output[i] - fusedOutput[i])));
+		}
+		printf("%d, %d, %d, %d, %.3f, %.3f, %.2f, %g\n", shape.m_inputs, shape.m_neurons, shape.m_hiddenLayers, shape.m_outputs, layerTime, fusedTime, layerTime / ndMax(fusedTime, 1.0e-6), maxDifference);
+	}
+	return 0;
+}
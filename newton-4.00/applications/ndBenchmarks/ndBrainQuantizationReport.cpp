@@ -0,0 +1,204 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// accuracy against speed of the quantized linear layers, the float brain
+// and its int8 and bfloat16 copies predict the same recorded inputs.
+// usage: ndBrainQuantizationReport [brain.dnn] [inputs.txt]
+// the inputs file has one input vector per line, without arguments 
+// a random policy network predicts random inputs.
+
+#include "ndBenchmarkUtils.h"
+#include "ndBrainInc.h"
+
+#define D_REPORT_BATCH_SIZE		64
+#define D_REPORT_PASSES			10
+#define D_REPORT_RANDOM_INPUTS	1024
+
+static ndBrain* ndCreateDefaultBrain()
+{
+	const ndInt32 inputs = 64;
+	const ndInt32 neurons = 256;
+	const ndInt32 outputs = 16;
+	ndBrain* const brain = new ndBrain();
+	brain->AddLayer(new ndBrainLayerLinear(inputs, neurons));
+	brain->AddLayer(new ndBrainLayerTanhActivation(neurons));
+	brain->AddLayer(new ndBrainLayerLinear(neurons, neurons));
+	brain->AddLayer(new ndBrainLayerTanhActivation(neurons));
+	brain->AddLayer(new ndBrainLayerLinear(neurons, outputs));
+	brain->InitWeightsXavierMethod();
+	return brain;
+}
+
+static bool ndLoadInputs(const char* const pathName, ndInt32 inputSize, ndArray<ndBrainFloat>& inputs)
+{
+	FILE* const file = fopen(pathName, "rb");
+	if (!file)
+	{
+		return false;
+	}
+	ndReal value;
+	while (fscanf(file, "%f", &value) == 1)
+	{
+		inputs.PushBack(ndBrainFloat(value));
+	}
+	fclose(file);
+
+	// drop a partial vector at the end of the file
+	inputs.SetCount(inputs.GetCount() - inputs.GetCount() % inputSize);
+	return inputs.GetCount() > 0;
+}
+
+static void ndBatchPrediction(const ndBrain& brain, ndArray<ndBrainMatrix*>& buffers)
+{
+	for (ndInt32 i = 0; i < brain.GetCount(); ++i)
+	{
+		brain[i]->MakeBatchPrediction(*buffers[i], *buffers[i + 1]);
+	}
+}
+
+static void ndReport(const char* const name, ndBrain& brain, const ndBrainMatrix& inputs, const ndBrainMatrix* const reference, ndBrainMatrix& outputs)
+{
+	const ndInt32 samples = inputs.GetRows();
+	ndBrainVector workingBuffer;
+
+	ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+	for (ndInt32 pass = 0; pass < D_REPORT_PASSES; ++pass)
+	{
+		for (ndInt32 i = 0; i < samples; ++i)
+		{
+			brain.MakePrediction(inputs[i], outputs[i], workingBuffer);
+		}
+	}
+	const ndFloat64 singleTime = ndFloat64(ndGetTimeInMicroseconds() - time0) / ndFloat64(D_REPORT_PASSES * samples);
+
+	ndArray<ndBrainMatrix*> buffers;
+	buffers.PushBack(new ndBrainMatrix(D_REPORT_BATCH_SIZE, brain.GetInputSize()));
+	for (ndInt32 i = 0; i < brain.GetCount(); ++i)
+	{
+		buffers.PushBack(new ndBrainMatrix(D_REPORT_BATCH_SIZE, brain[i]->GetOutputSize()));
+	}
+
+	ndInt32 batchCount = 0;
+	time0 = ndGetTimeInMicroseconds();
+	for (ndInt32 pass = 0; pass < D_REPORT_PASSES; ++pass)
+	{
+		for (ndInt32 base = 0; base + D_REPORT_BATCH_SIZE <= samples; base += D_REPORT_BATCH_SIZE)
+		{
+			for (ndInt32 i = 0; i < D_REPORT_BATCH_SIZE; ++i)
+			{
+				(*buffers[0])[i].Set(inputs[base + i]);
+			}
+			ndBatchPrediction(brain, buffers);
+			batchCount++;
+		}
+	}
+	const ndFloat64 batchTime = batchCount ? ndFloat64(ndGetTimeInMicroseconds() - time0) / ndFloat64(batchCount * D_REPORT_BATCH_SIZE) : 0.0;
+	for (ndInt32 i = 0; i < buffers.GetCount(); ++i)
+	{
+		delete buffers[i];
+	}
+
+	ndFloat64 maxError = 0.0;
+	ndFloat64 sumError = 0.0;
+	ndFloat64 errorNorm2 = 0.0;
+	ndFloat64 referenceNorm2 = 0.0;
+	ndInt32 argMaxMatches = 0;
+	if (reference)
+	{
+		for (ndInt32 i = 0; i < samples; ++i)
+		{
+			const ndBrainVector& out = outputs[i];
+			const ndBrainVector& ref = (*reference)[i];
+			for (ndInt32 j = 0; j < out.GetCount(); ++j)
+			{
+				const ndFloat64 error = ndAbs(ndFloat64(out[j]) - ndFloat64(ref[j]));
+				maxError = ndMax(maxError, error);
+				sumError += error;
+				errorNorm2 += error * error;
+				referenceNorm2 += ndFloat64(ref[j]) * ndFloat64(ref[j]);
+			}
+			argMaxMatches += (out.ArgMax() == ref.ArgMax()) ? 1 : 0;
+		}
+	}
+	else
+	{
+		argMaxMatches = samples;
+	}
+
+	const ndFloat64 meanError = sumError / ndFloat64(samples * outputs.GetColumns());
+	const ndFloat64 relativeError = ndSqrt(errorNorm2 / ndMax(referenceNorm2, 1.0e-30));
+	const ndFloat64 agreement = 100.0 * ndFloat64(argMaxMatches) / ndFloat64(samples);
+	printf("%s, %.2f, %.2f, %.2f, %g, %g, %g, %.2f\n", name, singleTime, batchTime, singleTime / ndMax(batchTime, 1.0e-3), maxError, meanError, relativeError, agreement);
+}
+
+int main(int argc, char** argv)
+{
+	ndSharedPtr<ndBrain> brain(nullptr);
+	if (argc > 1)
+	{
+		FILE* const file = fopen(argv[1], "rb");
+		if (!file)
+		{
+			printf("can't open %s\n", argv[1]);
+			return 1;
+		}
+		fclose(file);
+		brain = ndSharedPtr<ndBrain>(ndBrainLoad::Load(argv[1]));
+	}
+	else
+	{
+		brain = ndSharedPtr<ndBrain>(ndCreateDefaultBrain());
+	}
+
+	const ndInt32 inputSize = brain->GetInputSize();
+	ndArray<ndBrainFloat> recorded;
+	if (argc > 2)
+	{
+		if (!ndLoadInputs(argv[2], inputSize, recorded))
+		{
+			printf("can't read inputs of size %d from %s\n", inputSize, argv[2]);
+			return 1;
+		}
+	}
+	else
+	{
+		recorded.SetCount(D_REPORT_RANDOM_INPUTS * inputSize);
+		for (ndInt32 i = 0; i < recorded.GetCount(); ++i)
+		{
+			recorded[i] = ndBrainFloat(ndRand() * 2.0f - 1.0f);
+		}
+	}
+
+	const ndInt32 samples = recorded.GetCount() / inputSize;
+	ndBrainMatrix inputs(samples, inputSize);
+	for (ndInt32 i = 0; i < samples; ++i)
+	{
+		for (ndInt32 j = 0; j < inputSize; ++j)
+		{
+			inputs[i][j] = recorded[i * inputSize + j];
+		}
+	}
+
+	ndBrain int8Brain(**brain);
+	ndBrain bfloat16Brain(**brain);
+	ndBrainLayerLinearQuantized::Quantize(int8Brain, ndBrainLayerLinearQuantized::m_int8);
+	ndBrainLayerLinearQuantized::Quantize(bfloat16Brain, ndBrainLayerLinearQuantized::m_bfloat16);
+
+	ndBrainMatrix reference(samples, brain->GetOutputSize());
+	ndBrainMatrix outputs(samples, brain->GetOutputSize());
+
+	printf("samples: %d, inputs: %d, outputs: %d, batch: %d\n", samples, inputSize, brain->GetOutputSize(), D_REPORT_BATCH_SIZE);
+	printf("type, single(us/sample), batch(us/sample), batch speedup, max error, mean error, relative error, argmax agreement(%%)\n");
+	ndReport("float", **brain, inputs, nullptr, reference);
+	ndReport("bfloat16", bfloat16Brain, inputs, &reference, outputs);
+	ndReport("int8", int8Brain, inputs, &reference, outputs);
+	return 0;
+}
@@ -0,0 +1,45 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// compare the frame time of the bvh and the sweep and prune broad phases 
+// on a wide layer of boxes dropped on a floor, the case where all bodies 
+// have a similar size and are spread over a plane.
+// usage: ndBroadPhase [bodiesPerSide] [layers] [frames]
+
+#include "ndBenchmarkUtils.h"
+
+static ndFloat64 RunScene(ndScene::ndBroadPhaseType type, ndInt32 count, ndInt32 layers, ndInt32 frames)
+{
+	ndWorld world;
+	world.SetBroadPhaseType(type);
+
+	const ndVector origin(ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(1.0f));
+	ndShapeInstance shape(new ndShapeBox(ndFloat32(1.0f), ndFloat32(1.0f), ndFloat32(1.0f)));
+	ndBenchmarkAddFloor(world, origin);
+	ndBenchmarkAddPile(world, shape, origin, count, layers, ndFloat32(1.5f), false);
+
+	const ndFloat64 frameTime = ndBenchmarkRun(world, frames);
+	world.CleanUp();
+	return frameTime;
+}
+
+int main(int argc, char** argv)
+{
+	const ndInt32 count = ndBenchmarkGetArg(argc, argv, 1, 64);
+	const ndInt32 layers = ndBenchmarkGetArg(argc, argv, 2, 2);
+	const ndInt32 frames = ndBenchmarkGetArg(argc, argv, 3, 120);
+
+	printf("bodies: %d, frames: %d\n", count * count * layers, frames);
+	printf("broadphase, frame(us)\n");
+	printf("bvh, %.1f\n", RunScene(ndScene::ndBvhBroadPhase, count, layers, frames));
+	printf("sweep and prune, %.1f\n", RunScene(ndScene::ndSweepAndPruneBroadPhase, count, layers, frames));
+	return 0;
+}
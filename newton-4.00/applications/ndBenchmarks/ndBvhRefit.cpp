@@ -0,0 +1,47 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// compare the periodic bvh rebuild with the refit update, first on a pile 
+// of boxes that falls and settles, then on the same pile at rest.
+// usage: ndBvhRefit [bodiesPerSide] [layers] [frames]
+
+#include "ndBenchmarkUtils.h"
+
+static void RunScene(ndScene::ndBvhUpdateType type, const char* const name, ndInt32 count, ndInt32 layers, ndInt32 frames)
+{
+	ndWorld world;
+	world.GetScene()->SetBvhUpdateType(type);
+
+	const ndVector origin(ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(1.0f));
+	ndShapeInstance shape(new ndShapeBox(ndFloat32(1.0f), ndFloat32(1.0f), ndFloat32(1.0f)));
+	ndBenchmarkAddFloor(world, origin);
+	ndBenchmarkAddPile(world, shape, origin, count, layers, ndFloat32(1.2f), true);
+
+	const ndFloat64 fallTime = ndBenchmarkRun(world, frames);
+	const ndUnsigned32 fallRebuilds = world.GetScene()->GetBvhRebuildCount();
+	const ndFloat64 restTime = ndBenchmarkRun(world, frames);
+	const ndUnsigned32 restRebuilds = world.GetScene()->GetBvhRebuildCount() - fallRebuilds;
+	printf("%s, %.1f, %d, %.1f, %d, %.2f\n", name, fallTime, fallRebuilds, restTime, restRebuilds, world.GetScene()->GetBvhQuality());
+	world.CleanUp();
+}
+
+int main(int argc, char** argv)
+{
+	const ndInt32 count = ndBenchmarkGetArg(argc, argv, 1, 48);
+	const ndInt32 layers = ndBenchmarkGetArg(argc, argv, 2, 4);
+	const ndInt32 frames = ndBenchmarkGetArg(argc, argv, 3, 240);
+
+	printf("bodies: %d, frames: %d\n", count * count * layers, frames);
+	printf("update, falling frame(us), rebuilds, resting frame(us), rebuilds, quality\n");
+	RunScene(ndScene::ndBvhPeriodicRebuild, "periodic rebuild", count, layers, frames);
+	RunScene(ndScene::ndBvhRefit, "refit", count, layers, frames);
+	return 0;
+}
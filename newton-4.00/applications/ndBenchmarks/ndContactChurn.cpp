@@ -0,0 +1,126 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// measure the cost of creating and destroying contacts with the default and 
+// the thread local allocators.
+// rows of spheres slide through each other in opposite directions, the contact 
+// notify rejects all the contacts, so every frame pairs start and stop overlapping 
+// and the scene churns contacts through CreateNewContacts and DeleteDeadContacts.
+// usage: ndContactChurn [spheresPerRow] [rows] [frames]
+
+#include "ndBenchmarkUtils.h"
+
+class ndChurnContactNotify: public ndContactNotify
+{
+	public:
+	ndChurnContactNotify()
+		:ndContactNotify(nullptr)
+	{
+	}
+
+	virtual bool OnAabbOverlap(const ndContact* const, ndFloat32) const
+	{
+		return false;
+	}
+};
+
+class ndChurnBodyNotify: public ndBodyNotify
+{
+	public:
+	ndChurnBodyNotify(ndFloat32 origin, ndFloat32 range)
+		:ndBodyNotify(ndVector::m_zero)
+		,m_origin(origin)
+		,m_range(range)
+	{
+	}
+
+	// move back and forth along the row.
+	virtual void OnApplyExternalForce(ndInt32, ndFloat32)
+	{
+		ndBodyKinematic* const body = GetBody()->GetAsBodyKinematic();
+		const ndVector veloc(body->GetVelocity());
+		const ndFloat32 x = body->GetMatrix().m_posit.m_x - m_origin;
+		if (((x > m_range) && (veloc.m_x > ndFloat32(0.0f))) || ((x < -m_range) && (veloc.m_x < ndFloat32(0.0f))))
+		{
+			body->SetVelocity(ndVector(-veloc.m_x, ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(0.0f)));
+		}
+		body->SetForce(ndVector::m_zero);
+		body->SetTorque(ndVector::m_zero);
+	}
+
+	ndFloat32 m_origin;
+	ndFloat32 m_range;
+};
+
+static ndFloat64 RunChurn(ndInt32 count, ndInt32 rows, ndInt32 frames, ndInt32& contacts)
+{
+	ndWorld world;
+	world.SetThreadCount(ndThreadPool::GetMaxThreads());
+	world.SetContactNotify(new ndChurnContactNotify());
+
+	const ndFloat32 spacing = ndFloat32(2.0f);
+	const ndFloat32 rowSpacing = ndFloat32(0.9f);
+	const ndFloat32 speed = ndFloat32(10.0f);
+	ndShapeInstance shape(new ndShapeSphere(ndFloat32(0.5f)));
+	for (ndInt32 z = 0; z < rows; ++z)
+	{
+		for (ndInt32 y = 0; y < rows; ++y)
+		{
+			const ndFloat32 direction = ((y + z) & 1) ? speed : -speed;
+			for (ndInt32 x = 0; x < count; ++x)
+			{
+				ndMatrix matrix(ndGetIdentityMatrix());
+				matrix.m_posit = ndVector(ndFloat32(x) * spacing, ndFloat32(y) * rowSpacing, ndFloat32(z) * rowSpacing, ndFloat32(1.0f));
+
+				ndBodyDynamic* const body = new ndBodyDynamic();
+				body->SetNotifyCallback(new ndChurnBodyNotify(matrix.m_posit.m_x, spacing * ndFloat32(2.0f)));
+				body->SetCollisionShape(shape);
+				body->SetMatrix(matrix);
+				body->SetMassMatrix(ndFloat32(1.0f), shape);
+				body->SetVelocity(ndVector(direction, ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(0.0f)));
+				body->SetAutoSleep(false);
+				ndSharedPtr<ndBody> bodyPtr(body);
+				world.AddBody(bodyPtr);
+			}
+		}
+	}
+
+	ndBenchmarkRun(world, 10);
+	const ndFloat64 frameTime = ndBenchmarkRun(world, frames);
+	contacts = world.GetContactList().GetCount();
+	world.CleanUp();
+	return frameTime;
+}
+
+int main(int argc, char** argv)
+{
+	const ndInt32 count = ndBenchmarkGetArg(argc, argv, 1, 64);
+	const ndInt32 rows = ndBenchmarkGetArg(argc, argv, 2, 8);
+	const ndInt32 frames = ndBenchmarkGetArg(argc, argv, 3, 120);
+
+	printf("bodies: %d, threads: %d\n", count * rows * rows, ndThreadPool::GetMaxThreads());
+	printf("allocator, frame(us), live contacts\n");
+
+	ndMemAllocCallback alloc;
+	ndMemFreeCallback free;
+	ndMemory::GetMemoryAllocators(alloc, free);
+
+	ndInt32 contacts = 0;
+	ndFloat64 frameTime = RunChurn(count, rows, frames, contacts);
+	printf("default, %.1f, %d\n", frameTime, contacts);
+
+	ndMemory::SetMemoryAllocators(ndSlabAllocator::Malloc, ndSlabAllocator::Free);
+	frameTime = RunChurn(count, rows, frames, contacts);
+	printf("thread local, %.1f, %d\n", frameTime, contacts);
+
+	ndMemory::SetMemoryAllocators(alloc, free);
+	return 0;
+}
@@ -0,0 +1,115 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// compare the per body contact lookup of the open addressing ndContactMap with 
+// the red black tree it replaced, using the contacts of a settled pile of boxes.
+// every pair is looked up from the body with fewer contacts, as ndScene::AddPair does, 
+// and the same number of lookups are made for pairs of bodies that are not touching.
+// usage: ndContactLookup [bodiesPerSide] [layers] [repetitions]
+
+#include "ndBenchmarkUtils.h"
+
+typedef ndTree<ndContact*, ndUnsigned64, ndContainersFreeListAlloc<ndContact*>> ndContactTree;
+
+static ndUnsigned64 MakeKey(const ndBody* const body0, const ndBody* const body1)
+{
+	const ndUnsigned64 id0 = body0->GetId();
+	const ndUnsigned64 id1 = body1->GetId();
+	return (id0 < id1) ? (id0 | (id1 << 32)) : (id1 | (id0 << 32));
+}
+
+int main(int argc, char** argv)
+{
+	const ndInt32 count = ndBenchmarkGetArg(argc, argv, 1, 16);
+	const ndInt32 layers = ndBenchmarkGetArg(argc, argv, 2, 8);
+	const ndInt32 repetitions = ndBenchmarkGetArg(argc, argv, 3, 100);
+
+	ndWorld world;
+	const ndVector origin(ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(1.0f));
+	ndShapeInstance shape(new ndShapeBox(ndFloat32(1.0f), ndFloat32(1.0f), ndFloat32(1.0f)));
+	ndBenchmarkAddFloor(world, origin);
+	ndBenchmarkAddPile(world, shape, origin, count, layers, ndFloat32(1.01f), false);
+	ndBenchmarkRun(world, 60);
+
+	// build the reference trees with the same contacts.
+	const ndArray<ndBodyKinematic*>& bodyArray = world.GetScene()->GetActiveBodyArray();
+	ndArray<ndContactTree*> trees;
+	for (ndInt32 i = 0; i < bodyArray.GetCount(); ++i)
+	{
+		ndBodyKinematic* const body = bodyArray[i];
+		ndContactTree* const tree = new ndContactTree();
+		ndBodyKinematic::ndContactMap::Iterator it(body->GetContactMap());
+		for (it.Begin(); it; it++)
+		{
+			ndContact* const contact = *it;
+			tree->Insert(contact, MakeKey(contact->GetBody0(), contact->GetBody1()));
+		}
+		trees.PushBack(tree);
+	}
+
+	// half the queries hit an existing contact, half miss.
+	ndArray<ndBodyKinematic*> queries;
+	const ndContactArray& contactArray = world.GetContactList();
+	for (ndInt32 i = 0; i < contactArray.GetCount(); ++i)
+	{
+		const ndContact* const contact = contactArray[i];
+		queries.PushBack(contact->GetBody0());
+		queries.PushBack(contact->GetBody1());
+		ndBodyKinematic* const other = bodyArray[(contact->GetBody0()->GetIndex() + bodyArray.GetCount() / 2) % bodyArray.GetCount()];
+		queries.PushBack(contact->GetBody0());
+		queries.PushBack(other);
+	}
+	const ndInt32 lookups = repetitions * queries.GetCount() / 2;
+
+	ndInt32 treeHits = 0;
+	ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+	for (ndInt32 n = 0; n < repetitions; ++n)
+	{
+		for (ndInt32 i = 0; i < queries.GetCount(); i += 2)
+		{
+			ndBodyKinematic* const body0 = queries[i];
+			ndBodyKinematic* const body1 = queries[i + 1];
+			ndContactTree* const tree0 = trees[ndInt32(body0->GetIndex())];
+			ndContactTree* const tree1 = trees[ndInt32(body1->GetIndex())];
+			ndContactTree* const tree = (tree0->GetCount() <= tree1->GetCount()) ? tree0 : tree1;
+			treeHits += tree->Find(MakeKey(body0, body1)) ? 1 : 0;
+		}
+	}
+	const ndUnsigned64 treeTime = ndGetTimeInMicroseconds() - time0;
+
+	ndInt32 hashHits = 0;
+	time0 = ndGetTimeInMicroseconds();
+	for (ndInt32 n = 0; n < repetitions; ++n)
+	{
+		for (ndInt32 i = 0; i < queries.GetCount(); i += 2)
+		{
+			ndBodyKinematic* const body0 = queries[i];
+			ndBodyKinematic* const body1 = queries[i + 1];
+			const ndBodyKinematic::ndContactMap& map0 = body0->GetContactMap();
+			const ndBodyKinematic::ndContactMap& map1 = body1->GetContactMap();
+			hashHits += ((map0.GetCount() <= map1.GetCount()) ? map0.FindContact(body0, body1) : map1.FindContact(body1, body0)) ? 1 : 0;
+		}
+	}
+	const ndUnsigned64 hashTime = ndGetTimeInMicroseconds() - time0;
+
+	printf("bodies: %d, contacts: %d, lookups: %d\n", bodyArray.GetCount(), contactArray.GetCount(), lookups);
+	printf("container, lookup(ns), hits\n");
+	printf("tree, %.2f, %d\n", ndFloat64(treeTime) * 1000.0 / ndFloat64(lookups), treeHits);
+	printf("hash, %.2f, %d\n", ndFloat64(hashTime) * 1000.0 / ndFloat64(lookups), hashHits);
+	printf("frame(us): %.1f\n", ndBenchmarkRun(world, 60));
+
+	for (ndInt32 i = 0; i < trees.GetCount(); ++i)
+	{
+		delete trees[i];
+	}
+	world.CleanUp();
+	return 0;
+}
@@ -0,0 +1,147 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// compare the generic narrow phase with the batched primitive kernels.
+// first the cost per pair of each path on random overlapping pairs of each type,
+// then the frame time of piles of spheres, capsules and boxes resting on a floor.
+// usage: ndNarrowPhase [pairs] [bodiesPerSide] [layers] [frames] [threads]
+
+#include "ndBenchmarkUtils.h"
+
+static ndMatrix RandomMatrix(const ndVector& posit)
+{
+	ndMatrix matrix(ndPitchMatrix(ndRand() * ndFloat32(2.0f) * ndPi) * ndYawMatrix(ndRand() * ndFloat32(2.0f) * ndPi) * ndRollMatrix(ndRand() * ndFloat32(2.0f) * ndPi));
+	matrix.m_posit = posit;
+	matrix.m_posit.m_w = ndFloat32(1.0f);
+	return matrix;
+}
+
+static void RunPairs(const char* const name, const ndShapeInstance& shape0, const ndShapeInstance& shape1, ndFloat32 distance, ndInt32 pairCount)
+{
+	ndArray<ndShapeInstance*> instances;
+	for (ndInt32 i = 0; i < pairCount; ++i)
+	{
+		const ndVector dir(ndVector(ndRand() - ndFloat32(0.5f), ndRand() - ndFloat32(0.5f), ndRand() - ndFloat32(0.5f), ndFloat32(0.0f)).Normalize());
+		ndShapeInstance* const instance0 = new ndShapeInstance(shape0);
+		ndShapeInstance* const instance1 = new ndShapeInstance(shape1);
+		instance0->SetGlobalMatrix(RandomMatrix(ndVector::m_wOne));
+		instance1->SetGlobalMatrix(RandomMatrix(dir.Scale(distance * (ndFloat32(0.8f) + ndFloat32(0.2f) * ndRand()))));
+		instances.PushBack(instance0);
+		instances.PushBack(instance1);
+	}
+
+	ndInt32 genericCount = 0;
+	const ndUnsigned64 genericTime0 = ndGetTimeInMicroseconds();
+	for (ndInt32 i = 0; i < pairCount; ++i)
+	{
+		ndContactSolver solver;
+		ndFixSizeArray<ndContactPoint, 16> contacts;
+		const ndShapeInstance* const instance0 = instances[i * 2];
+		const ndShapeInstance* const instance1 = instances[i * 2 + 1];
+		solver.CalculateContacts(instance0, instance0->GetGlobalMatrix(), ndVector::m_zero, instance1, instance1->GetGlobalMatrix(), ndVector::m_zero, contacts, nullptr);
+		genericCount += contacts.GetCount() ? 1 : 0;
+	}
+	const ndUnsigned64 genericTime = ndGetTimeInMicroseconds() - genericTime0;
+
+	ndInt32 batchCount = 0;
+	const ndContactBatch::ndPairType type = ndContactBatch::GetPairType(shape0, shape1);
+	const ndUnsigned64 batchTime0 = ndGetTimeInMicroseconds();
+	for (ndInt32 i = 0; i < pairCount; i += D_CONTACT_BATCH_WIDTH)
+	{
+		ndContactBatch::ndPair pairs[D_CONTACT_BATCH_WIDTH];
+		ndContactPoint contacts[D_CONTACT_BATCH_WIDTH * D_CONTACT_BATCH_MAX_POINTS];
+		const ndInt32 count = ndMin(pairCount - i, D_CONTACT_BATCH_WIDTH);
+		for (ndInt32 j = 0; j < count; ++j)
+		{
+			pairs[j].m_instance0 = instances[(i + j) * 2];
+			pairs[j].m_instance1 = instances[(i + j) * 2 + 1];
+			pairs[j].m_contacts = &contacts[j * D_CONTACT_BATCH_MAX_POINTS];
+		}
+		ndContactBatch::CalculateContacts(type, pairs, count);
+		for (ndInt32 j = 0; j < count; ++j)
+		{
+			batchCount += pairs[j].m_count ? 1 : 0;
+		}
+	}
+	const ndUnsigned64 batchTime = ndGetTimeInMicroseconds() - batchTime0;
+
+	const ndFloat64 genericPairTime = ndFloat64(genericTime) * ndFloat64(1000.0f) / ndFloat64(pairCount);
+	const ndFloat64 batchPairTime = ndFloat64(batchTime) * ndFloat64(1000.0f) / ndFloat64(pairCount);
+	printf("%s, %.1f, %.1f, %.2f, %d, %d\n", name, genericPairTime, batchPairTime, genericPairTime / ndMax(batchPairTime, ndFloat64(1.0e-3f)), genericCount, batchCount);
+
+	for (ndInt32 i = 0; i < instances.GetCount(); ++i)
+	{
+		delete instances[i];
+	}
+}
+
+static void RunScene(const char* const name, const ndShapeInstance& shape, bool batching, ndInt32 count, ndInt32 layers, ndInt32 frames, ndInt32 threads)
+{
+	ndWorld world;
+	world.SetThreadCount(threads);
+	world.GetScene()->SetContactBatching(batching);
+
+	const ndVector origin(ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(1.0f));
+	ndBenchmarkAddFloor(world, origin);
+	ndBenchmarkAddPile(world, shape, origin, count, layers, ndFloat32(1.01f), false);
+
+	// let the piles settle before measuring
+	ndBenchmarkRun(world, 60);
+	const ndFloat64 frameTime = ndBenchmarkRun(world, frames);
+
+	ndInt32 bodyCount = 0;
+	ndFloat64 veloc2 = ndFloat64(0.0f);
+	const ndBodyListView& bodyList = world.GetBodyList();
+	for (ndBodyListView::ndNode* node = bodyList.GetFirst(); node; node = node->GetNext())
+	{
+		ndBodyKinematic* const body = node->GetInfo()->GetAsBodyKinematic();
+		if (body->GetInvMass() > ndFloat32(0.0f))
+		{
+			const ndVector veloc(body->GetVelocity());
+			veloc2 += ndFloat64(veloc.DotProduct(veloc).GetScalar());
+			bodyCount++;
+		}
+	}
+	const ndFloat64 rmsVeloc = ndSqrt(veloc2 / ndFloat64(ndMax(bodyCount, 1)));
+	printf("%s, %s, %.1f, %d, %.4f\n", name, batching ? "batched" : "generic", frameTime, world.GetScene()->GetActiveContactArray().GetCount(), rmsVeloc);
+	world.CleanUp();
+}
+
+int main(int argc, char** argv)
+{
+	const ndInt32 pairs = ndBenchmarkGetArg(argc, argv, 1, 100000);
+	const ndInt32 count = ndBenchmarkGetArg(argc, argv, 2, 16);
+	const ndInt32 layers = ndBenchmarkGetArg(argc, argv, 3, 4);
+	const ndInt32 frames = ndBenchmarkGetArg(argc, argv, 4, 240);
+	const ndInt32 threads = ndBenchmarkGetArg(argc, argv, 5, 1);
+
+	ndShapeInstance sphere(new ndShapeSphere(ndFloat32(0.5f)));
+	ndShapeInstance capsule(new ndShapeCapsule(ndFloat32(0.25f), ndFloat32(0.25f), ndFloat32(0.5f)));
+	ndShapeInstance box(new ndShapeBox(ndFloat32(1.0f), ndFloat32(1.0f), ndFloat32(1.0f)));
+
+	printf("pairs: %d\n", pairs);
+	printf("pair, generic(ns), batched(ns), speedup, generic hits, batched hits\n");
+	RunPairs("sphere sphere", sphere, sphere, ndFloat32(1.0f), pairs);
+	RunPairs("sphere capsule", sphere, capsule, ndFloat32(0.75f), pairs);
+	RunPairs("capsule capsule", capsule, capsule, ndFloat32(0.5f), pairs);
+	RunPairs("sphere box", sphere, box, ndFloat32(1.0f), pairs);
+	RunPairs("box box", box, box, ndFloat32(1.0f), pairs);
+
+	printf("\nbodies: %d, frames: %d, threads: %d\n", count * count * layers, frames, threads);
+	printf("shape, narrow phase, frame(us), contacts, rms veloc\n");
+	RunScene("sphere", sphere, false, count, layers, frames, threads);
+	RunScene("sphere", sphere, true, count, layers, frames, threads);
+	RunScene("capsule", capsule, false, count, layers, frames, threads);
+	RunScene("capsule", capsule, true, count, layers, frames, threads);
+	RunScene("box", box, false, count, layers, frames, threads);
+	RunScene("box", box, true, count, layers, frames, threads);
+	return 0;
+}
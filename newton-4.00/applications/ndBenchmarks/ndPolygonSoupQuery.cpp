@@ -0,0 +1,238 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// building a large static bvh terrain, serial, on the thread pool and with
+// the faces welded in the builder, saving it and mapping it back from the 
+// file, followed by ray casts and oriented box queries against it. Two triangles per cell, about a million triangles with
+// the default size.
+// usage: ndPolygonSoupQuery [cellsPerSide] [rays] [boxes] [threads]
+
+#include "ndBenchmarkUtils.h"
+
+class ndBenchmarkSoup : public ndShapeStatic_bvh
+{
+	public:
+	class ndClosestHit
+	{
+		public:
+		ndClosestHit(const ndVector& p0, const ndVector& p1)
+			:m_ray(p0, p1)
+			,m_t(ndFloat32(1.2f))
+		{
+		}
+
+		ndFastRay m_ray;
+		ndFloat32 m_t;
+	};
+
+	ndBenchmarkSoup(const ndPolygonSoupBuilder& builder)
+		:ndShapeStatic_bvh(builder)
+	{
+	}
+
+	ndBenchmarkSoup(const ndPolygonSoupBuilder& builder, ndThreadPool& threadPool)
+		:ndShapeStatic_bvh(builder, threadPool)
+	{
+	}
+
+	ndBenchmarkSoup(const char* const path)
+		:ndShapeStatic_bvh(path)
+	{
+	}
+
+	ndFloat32 RayHit(const ndVector& p0, const ndVector& p1) const
+	{
+		ndClosestHit hit(p0, p1);
+		ForAllSectorsRayHit(hit.m_ray, ndFloat32(1.0f), ClosestHit, &hit);
+		return hit.m_t;
+	}
+
+	ndInt32 BoxQuery(const ndFastAabb& box) const
+	{
+		ndInt32 count = 0;
+		ForAllSectors(box, ndVector::m_zero, ndFloat32(1.0f), CountFace, &count);
+		return count;
+	}
+
+	static ndFloat32 ClosestHit(void* const context, const ndFloat32* const polygon, ndInt32 strideInBytes, const ndInt32* const indexArray, ndInt32 indexCount)
+	{
+		ndClosestHit& hit = *((ndClosestHit*)context);
+		const ndVector normal(ndVector(&polygon[indexArray[indexCount + 1] * (strideInBytes / ndInt32(sizeof(ndFloat32)))]) & ndVector::m_triplexMask);
+		const ndFloat32 t = hit.m_ray.PolygonIntersect(normal, hit.m_t, polygon, strideInBytes, indexArray, indexCount);
+		hit.m_t = ndMin(hit.m_t, t);
+		return t;
+	}
+
+	static ndIntersectStatus CountFace(void* const context, const ndFloat32* const, ndInt32, const ndInt32* const, ndInt32, ndFloat32)
+	{
+		(*(ndInt32*)context)++;
+		return m_continueSearh;
+	}
+};
+
+static ndFloat32 TerrainHeight(ndInt32 i, ndInt32 j)
+{
+	const ndFloat32 x = ndFloat32(i);
+	const ndFloat32 z = ndFloat32(j);
+	return ndFloat32(4.0f) * ndSin(x * ndFloat32(0.021f)) * ndCos(z * ndFloat32(0.017f)) + ndFloat32(0.3f) * ndSin(x * ndFloat32(0.37f) + z * ndFloat32(0.23f));
+}
+
+static void AddTerrainFaces(ndPolygonSoupBuilder& meshBuilder, ndInt32 cells, ndFloat32 cellSize)
+{
+	for (ndInt32 i = 0; i < cells; ++i)
+	{
+		for (ndInt32 j = 0; j < cells; ++j)
+		{
+			const ndVector p00(ndFloat32(i) * cellSize, TerrainHeight(i, j), ndFloat32(j) * cellSize, ndFloat32(0.0f));
+			const ndVector p01(ndFloat32(i) * cellSize, TerrainHeight(i, j + 1), ndFloat32(j + 1) * cellSize, ndFloat32(0.0f));
+			const ndVector p10(ndFloat32(i + 1) * cellSize, TerrainHeight(i + 1, j), ndFloat32(j) * cellSize, ndFloat32(0.0f));
+			const ndVector p11(ndFloat32(i + 1) * cellSize, TerrainHeight(i + 1, j + 1), ndFloat32(j + 1) * cellSize, ndFloat32(0.0f));
+			const ndVector face0[3] = { p00, p01, p11 };
+			const ndVector face1[3] = { p00, p11, p10 };
+			meshBuilder.AddFace(&face0[0].m_x, sizeof(ndVector), 3, 0);
+			meshBuilder.AddFace(&face1[0].m_x, sizeof(ndVector), 3, 0);
+		}
+	}
+}
+
+// build the terrain with one of the three methods, returns the time of each stage in milliseconds
+static ndBenchmarkSoup* BuildTerrain(ndInt32 cells, ndFloat32 cellSize, ndThreadPool* const threadPool, bool welded, ndFloat64* const times)
+{
+	ndPolygonSoupBuilder meshBuilder;
+	const ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+	if (welded)
+	{
+		meshBuilder.BeginWelded();
+	}
+	else
+	{
+		meshBuilder.Begin();
+	}
+	AddTerrainFaces(meshBuilder, cells, cellSize);
+
+	const ndUnsigned64 time1 = ndGetTimeInMicroseconds();
+	if (threadPool)
+	{
+		meshBuilder.End(false, *threadPool);
+	}
+	else
+	{
+		meshBuilder.End(false);
+	}
+
+	const ndUnsigned64 time2 = ndGetTimeInMicroseconds();
+	ndBenchmarkSoup* const soup = threadPool ? new ndBenchmarkSoup(meshBuilder, *threadPool) : new ndBenchmarkSoup(meshBuilder);
+	const ndUnsigned64 time3 = ndGetTimeInMicroseconds();
+
+	times[0] = ndFloat64(time1 - time0) * ndFloat64(1.0e-3f);
+	times[1] = ndFloat64(time2 - time1) * ndFloat64(1.0e-3f);
+	times[2] = ndFloat64(time3 - time2) * ndFloat64(1.0e-3f);
+	return soup;
+}
+
+int main(int argc, char** argv)
+{
+	const ndInt32 cells = ndBenchmarkGetArg(argc, argv, 1, 708);
+	const ndInt32 rayCount = ndBenchmarkGetArg(argc, argv, 2, 200000);
+	const ndInt32 boxCount = ndBenchmarkGetArg(argc, argv, 3, 200000);
+	const ndInt32 threads = ndBenchmarkGetArg(argc, argv, 4, 4);
+
+	const ndFloat32 cellSize = ndFloat32(0.5f);
+	const ndFloat32 size = ndFloat32(cells) * cellSize;
+
+	// the world owns the thread pool used by the threaded builds
+	ndWorld world;
+	world.SetThreadCount(threads);
+	ndThreadPool* const threadPool = world.GetScene();
+
+	ndFloat64 serialTimes[3];
+	ndFloat64 threadedTimes[3];
+	ndFloat64 weldedTimes[3];
+	{
+		// the welded and threaded meshes are only timed, the queries run on the serial one
+		ndShapeInstance weldedMesh(BuildTerrain(cells, cellSize, threadPool, true, weldedTimes));
+		ndShapeInstance threaded(BuildTerrain(cells, cellSize, threadPool, false, threadedTimes));
+	}
+	ndShapeInstance builtInstance(BuildTerrain(cells, cellSize, nullptr, false, serialTimes));
+
+	// the queries run on the mesh mapped from the file
+	const char* const path = "ndPolygonSoupQuery.bin";
+	const ndUnsigned64 saveTime0 = ndGetTimeInMicroseconds();
+	((ndBenchmarkSoup*)builtInstance.GetShape()->GetAsShapeStaticBVH())->Serialize(path);
+	const ndUnsigned64 saveTime = ndGetTimeInMicroseconds() - saveTime0;
+
+	const ndUnsigned64 loadTime0 = ndGetTimeInMicroseconds();
+	ndShapeInstance instance(new ndBenchmarkSoup(path));
+	const ndUnsigned64 loadTime = ndGetTimeInMicroseconds() - loadTime0;
+	const ndBenchmarkSoup* const soup = (ndBenchmarkSoup*)instance.GetShape()->GetAsShapeStaticBVH();
+
+	// vertical probes, and long segments crossing the terrain at a shallow angle
+	ndArray<ndVector> probes;
+	ndArray<ndVector> segments;
+	for (ndInt32 i = 0; i < rayCount; ++i)
+	{
+		const ndVector p0(ndRand() * size, ndFloat32(8.0f), ndRand() * size, ndFloat32(0.0f));
+		probes.PushBack(p0);
+		probes.PushBack(ndVector(p0.m_x, ndFloat32(-8.0f), p0.m_z, ndFloat32(0.0f)));
+		segments.PushBack(p0);
+		segments.PushBack(ndVector(ndRand() * size, ndFloat32(-8.0f), ndRand() * size, ndFloat32(0.0f)));
+	}
+
+	ndInt32 probeHits = 0;
+	const ndUnsigned64 probeTime0 = ndGetTimeInMicroseconds();
+	for (ndInt32 i = 0; i < rayCount; ++i)
+	{
+		probeHits += (soup->RayHit(probes[i * 2], probes[i * 2 + 1]) < ndFloat32(1.0f)) ? 1 : 0;
+	}
+	const ndUnsigned64 probeTime = ndGetTimeInMicroseconds() - probeTime0;
+
+	ndInt32 segmentHits = 0;
+	const ndUnsigned64 segmentTime0 = ndGetTimeInMicroseconds();
+	for (ndInt32 i = 0; i < rayCount; ++i)
+	{
+		segmentHits += (soup->RayHit(segments[i * 2], segments[i * 2 + 1]) < ndFloat32(1.0f)) ? 1 : 0;
+	}
+	const ndUnsigned64 segmentTime = ndGetTimeInMicroseconds() - segmentTime0;
+
+	// boxes the size of a vehicle or a character, touching the terrain surface.
+	ndArray<ndFastAabb> boxes;
+	for (ndInt32 i = 0; i < boxCount; ++i)
+	{
+		ndMatrix matrix(ndPitchMatrix(ndRand() * ndPi) * ndYawMatrix(ndRand() * ndPi) * ndRollMatrix(ndRand() * ndPi));
+		const ndFloat32 x = ndRand() * size;
+		const ndFloat32 z = ndRand() * size;
+		matrix.m_posit = ndVector(x, TerrainHeight(ndInt32(x / cellSize), ndInt32(z / cellSize)), z, ndFloat32(1.0f));
+		const ndVector halfSize(ndFloat32(0.25f) + ndRand(), ndFloat32(0.25f) + ndRand(), ndFloat32(0.25f) + ndRand(), ndFloat32(0.0f));
+		boxes.PushBack(ndFastAabb(matrix, halfSize));
+	}
+
+	ndInt32 boxFaces = 0;
+	const ndUnsigned64 boxTime0 = ndGetTimeInMicroseconds();
+	for (ndInt32 i = 0; i < boxCount; ++i)
+	{
+		boxFaces += soup->BoxQuery(boxes[i]);
+	}
+	const ndUnsigned64 boxTime = ndGetTimeInMicroseconds() - boxTime0;
+
+	printf("triangles: %d, threads: %d\n", cells * cells * 2, threads);
+	printf("build, add faces(ms), end(ms), create(ms), total(ms)\n");
+	printf("serial, %.1f, %.1f, %.1f, %.1f\n", serialTimes[0], serialTimes[1], serialTimes[2], serialTimes[0] + serialTimes[1] + serialTimes[2]);
+	printf("threaded, %.1f, %.1f, %.1f, %.1f\n", threadedTimes[0], threadedTimes[1], threadedTimes[2], threadedTimes[0] + threadedTimes[1] + threadedTimes[2]);
+	printf("welded, %.1f, %.1f, %.1f, %.1f\n", weldedTimes[0], weldedTimes[1], weldedTimes[2], weldedTimes[0] + weldedTimes[1] + weldedTimes[2]);
+	printf("save(ms): %.1f, load(ms): %.2f\n", ndFloat64(saveTime) * ndFloat64(1.0e-3f), ndFloat64(loadTime) * ndFloat64(1.0e-3f));
+	printf("\n");
+	printf("query, count, time(ns), result\n");
+	printf("vertical ray, %d, %.1f, %d hits\n", rayCount, ndFloat64(probeTime) * ndFloat64(1000.0f) / ndFloat64(rayCount), probeHits);
+	printf("shallow ray, %d, %.1f, %d hits\n", rayCount, ndFloat64(segmentTime) * ndFloat64(1000.0f) / ndFloat64(rayCount), segmentHits);
+	printf("box, %d, %.1f, %.2f faces\n", boxCount, ndFloat64(boxTime) * ndFloat64(1000.0f) / ndFloat64(boxCount), ndFloat64(boxFaces) / ndFloat64(boxCount));
+	remove(path);
+	return 0;
+}
@@ -0,0 +1,76 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// compare casting a large set of short random rays over a resting pile one 
+// at the time through ndWorld::RayCast against a single ndWorld::RayCastBatch.
+// usage: ndRayCastBatch [bodiesPerSide] [rays] [repeats] [threads]
+
+#include "ndBenchmarkUtils.h"
+
+int main(int argc, char** argv)
+{
+	const ndInt32 count = ndBenchmarkGetArg(argc, argv, 1, 32);
+	const ndInt32 rayCount = ndBenchmarkGetArg(argc, argv, 2, 10000);
+	const ndInt32 repeats = ndBenchmarkGetArg(argc, argv, 3, 10);
+	const ndInt32 threads = ndBenchmarkGetArg(argc, argv, 4, 1);
+
+	ndWorld world;
+	world.SetThreadCount(threads);
+	const ndVector origin(ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(1.0f));
+	ndShapeInstance shape(new ndShapeBox(ndFloat32(1.0f), ndFloat32(1.0f), ndFloat32(1.0f)));
+	ndBenchmarkAddFloor(world, origin);
+	ndBenchmarkAddPile(world, shape, origin, count, 2, ndFloat32(1.5f));
+	ndBenchmarkRun(world, 60);
+
+	// sensor like rays, short segments between random points over the pile.
+	ndArray<ndRayCastBatchQuery> queries;
+	const ndFloat32 size = ndFloat32(count) * ndFloat32(1.5f) * ndFloat32(0.5f);
+	for (ndInt32 i = 0; i < rayCount; ++i)
+	{
+		ndRayCastBatchQuery query;
+		query.m_origin = ndVector(ndRand() * ndFloat32(2.0f) * size - size, ndFloat32(6.0f), ndRand() * ndFloat32(2.0f) * size - size, ndFloat32(0.0f));
+		query.m_dest = query.m_origin + ndVector(ndRand() * ndFloat32(8.0f) - ndFloat32(4.0f), ndFloat32(-8.0f), ndRand() * ndFloat32(8.0f) - ndFloat32(4.0f), ndFloat32(0.0f));
+		queries.PushBack(query);
+	}
+
+	ndInt32 singleHits = 0;
+	ndUnsigned64 time0 = ndGetTimeInMicroseconds();
+	for (ndInt32 j = 0; j < repeats; ++j)
+	{
+		singleHits = 0;
+		for (ndInt32 i = 0; i < rayCount; ++i)
+		{
+			ndRayCastClosestHitCallback callback;
+			singleHits += world.RayCast(callback, queries[i].m_origin, queries[i].m_dest) ? 1 : 0;
+		}
+	}
+	const ndUnsigned64 singleTime = ndGetTimeInMicroseconds() - time0;
+
+	ndInt32 batchHits = 0;
+	ndArray<ndCastBatchHit> hits;
+	time0 = ndGetTimeInMicroseconds();
+	for (ndInt32 j = 0; j < repeats; ++j)
+	{
+		world.RayCastBatch(queries, hits);
+	}
+	const ndUnsigned64 batchTime = ndGetTimeInMicroseconds() - time0;
+	for (ndInt32 i = 0; i < hits.GetCount(); ++i)
+	{
+		batchHits += hits[i].m_body ? 1 : 0;
+	}
+
+	printf("bodies: %d, rays: %d, threads: %d\n", count * count * 2 + 1, rayCount, world.GetThreadCount());
+	printf("query, hits, time per ray(ns)\n");
+	printf("single, %d, %.1f\n", singleHits, ndFloat64(singleTime) * 1000.0 / ndFloat64(rayCount * repeats));
+	printf("batch, %d, %.1f\n", batchHits, ndFloat64(batchTime) * 1000.0 / ndFloat64(rayCount * repeats));
+	world.CleanUp();
+	return 0;
+}
@@ -0,0 +1,152 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// convergence versus cost of the default jacobi solver and the graph colored
+// gauss seidel solver, on box columns and pyramids like the basic stacks demo.
+// for each solver and iteration count it prints the frame time, the average
+// sink of the top box of each stack and the rms velocity of the bodies at rest.
+// usage: ndSolverConvergence [columns] [columnHigh] [pyramidBase] [frames] [threads]
+
+#include "ndBenchmarkUtils.h"
+
+static ndBodyDynamic* AddBox(ndWorld& world, const ndShapeInstance& shape, const ndMatrix& matrix)
+{
+	ndBodyDynamic* const body = new ndBodyDynamic();
+	body->SetNotifyCallback(new ndBodyNotify(ndVector(ndFloat32(0.0f), ndFloat32(-10.0f), ndFloat32(0.0f), ndFloat32(0.0f))));
+	body->SetCollisionShape(shape);
+	body->SetMatrix(matrix);
+	body->SetMassMatrix(ndFloat32(1.0f), shape);
+	body->SetAutoSleep(false);
+	ndSharedPtr<ndBody> bodyPtr(body);
+	world.AddBody(bodyPtr);
+	return body;
+}
+
+class ndStackTop
+{
+	public:
+	ndBodyDynamic* m_body;
+	ndFloat32 m_height;
+};
+
+// a column of unit boxes, each one rotated 20 degrees from the one below
+static void AddColumn(ndWorld& world, const ndVector& origin, ndInt32 high, ndArray<ndStackTop>& tops)
+{
+	const ndFloat32 gap = ndFloat32(0.01f);
+	ndShapeInstance shape(new ndShapeBox(ndFloat32(1.0f), ndFloat32(1.0f), ndFloat32(1.0f)));
+	ndBodyDynamic* top = nullptr;
+	for (ndInt32 i = 0; i < high; ++i)
+	{
+		ndMatrix matrix(ndYawMatrix(ndFloat32(i) * ndFloat32(20.0f) * ndDegreeToRad));
+		matrix.m_posit = origin + ndVector(ndFloat32(0.0f), ndFloat32(0.5f) + ndFloat32(i) * (ndFloat32(1.0f) + gap), ndFloat32(0.0f), ndFloat32(0.0f));
+		matrix.m_posit.m_w = ndFloat32(1.0f);
+		top = AddBox(world, shape, matrix);
+	}
+	ndStackTop entry;
+	entry.m_body = top;
+	entry.m_height = origin.m_y + ndFloat32(high) - ndFloat32(0.5f);
+	tops.PushBack(entry);
+}
+
+// a two dimensional pyramid of flat boxes
+static void AddPyramid(ndWorld& world, const ndVector& origin, ndInt32 base, ndArray<ndStackTop>& tops)
+{
+	const ndFloat32 gap = ndFloat32(0.01f);
+	const ndVector size(ndFloat32(0.5f), ndFloat32(0.25f), ndFloat32(0.8f), ndFloat32(0.0f));
+	ndShapeInstance shape(new ndShapeBox(size.m_x, size.m_y, size.m_z));
+
+	ndBodyDynamic* top = nullptr;
+	const ndFloat32 stepX = size.m_x + gap;
+	for (ndInt32 i = 0; i < base; ++i)
+	{
+		const ndInt32 rowCount = base - i;
+		const ndFloat32 x0 = -ndFloat32(rowCount - 1) * stepX * ndFloat32(0.5f);
+		for (ndInt32 j = 0; j < rowCount; ++j)
+		{
+			ndMatrix matrix(ndGetIdentityMatrix());
+			matrix.m_posit = origin + ndVector(x0 + ndFloat32(j) * stepX, size.m_y * ndFloat32(0.5f) + ndFloat32(i) * (size.m_y + gap), ndFloat32(0.0f), ndFloat32(0.0f));
+			matrix.m_posit.m_w = ndFloat32(1.0f);
+			top = AddBox(world, shape, matrix);
+		}
+	}
+	ndStackTop entry;
+	entry.m_body = top;
+	entry.m_height = origin.m_y + ndFloat32(base) * size.m_y - size.m_y * ndFloat32(0.5f);
+	tops.PushBack(entry);
+}
+
+static void RunScene(ndWorld::ndSolverModes solver, ndInt32 iterations, ndInt32 columns, ndInt32 columnHigh, ndInt32 pyramidBase, ndInt32 frames, ndInt32 threads)
+{
+	ndWorld world;
+	world.SetThreadCount(threads);
+	world.SelectSolver(solver);
+	world.SetSolverIterations(iterations);
+
+	ndArray<ndStackTop> tops;
+	const ndVector origin(ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(1.0f));
+	ndBenchmarkAddFloor(world, origin);
+	for (ndInt32 i = 0; i < columns; ++i)
+	{
+		for (ndInt32 j = 0; j < columns; ++j)
+		{
+			AddColumn(world, origin + ndVector(ndFloat32(i) * ndFloat32(4.0f), ndFloat32(0.0f), ndFloat32(j) * ndFloat32(4.0f), ndFloat32(0.0f)), columnHigh, tops);
+		}
+		AddPyramid(world, origin + ndVector(ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(-4.0f) - ndFloat32(i) * ndFloat32(3.0f), ndFloat32(0.0f)), pyramidBase, tops);
+	}
+
+	// let the stacks settle before measuring
+	ndBenchmarkRun(world, 60);
+	const ndFloat64 frameTime = ndBenchmarkRun(world, frames);
+
+	ndFloat64 sink = ndFloat64(0.0f);
+	for (ndInt32 i = 0; i < tops.GetCount(); ++i)
+	{
+		sink += ndFloat64(tops[i].m_height - tops[i].m_body->GetMatrix().m_posit.m_y);
+	}
+	sink /= ndFloat64(tops.GetCount());
+
+	ndInt32 bodyCount = 0;
+	ndFloat64 veloc2 = ndFloat64(0.0f);
+	const ndBodyListView& bodyList = world.GetBodyList();
+	for (ndBodyListView::ndNode* node = bodyList.GetFirst(); node; node = node->GetNext())
+	{
+		ndBodyKinematic* const body = node->GetInfo()->GetAsBodyKinematic();
+		if (body->GetInvMass() > ndFloat32(0.0f))
+		{
+			const ndVector veloc(body->GetVelocity());
+			veloc2 += ndFloat64(veloc.DotProduct(veloc).GetScalar());
+			bodyCount++;
+		}
+	}
+	const ndFloat64 rmsVeloc = ndSqrt(veloc2 / ndFloat64(ndMax(bodyCount, 1)));
+
+	printf("%s, %d, %.1f, %.4f, %.4f\n", world.GetSolverString(), iterations, frameTime, sink, rmsVeloc);
+	world.CleanUp();
+}
+
+int main(int argc, char** argv)
+{
+	const ndInt32 columns = ndBenchmarkGetArg(argc, argv, 1, 4);
+	const ndInt32 columnHigh = ndBenchmarkGetArg(argc, argv, 2, 20);
+	const ndInt32 pyramidBase = ndBenchmarkGetArg(argc, argv, 3, 20);
+	const ndInt32 frames = ndBenchmarkGetArg(argc, argv, 4, 240);
+	const ndInt32 threads = ndBenchmarkGetArg(argc, argv, 5, 1);
+
+	printf("columns: %d of %d boxes, pyramids: %d of %d base boxes, frames: %d, threads: %d\n", columns * columns, columnHigh, columns, pyramidBase, frames, threads);
+	printf("solver, iterations, frame(us), top sink, rms veloc\n");
+	const ndInt32 iterations[] = { 4, 8, 16 };
+	for (ndInt32 i = 0; i < ndInt32(sizeof(iterations) / sizeof(iterations[0])); ++i)
+	{
+		RunScene(ndWorld::ndStandardSolver, iterations[i], columns, columnHigh, pyramidBase, frames, threads);
+		RunScene(ndWorld::ndGaussSeidelSolver, iterations[i], columns, columnHigh, pyramidBase, frames, threads);
+	}
+	return 0;
+}
@@ -0,0 +1,51 @@
+/* Copyright (c) <2003-2022> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+// report the sub step time of a large scene for 1 to N threads.
+// usage: ndThreadScaling [bodiesPerSide] [layers] [frames] [subSteps]
+// the veryLargeScene_test scene only has two bodies, not enough work to distribute
+// across threads, so it is extended with a pile of boxes resting on a floor.
+
+#include "ndBenchmarkUtils.h"
+
+int main(int argc, char** argv)
+{
+	const ndInt32 count = ndBenchmarkGetArg(argc, argv, 1, 32);
+	const ndInt32 layers = ndBenchmarkGetArg(argc, argv, 2, 4);
+	const ndInt32 frames = ndBenchmarkGetArg(argc, argv, 3, 120);
+	const ndInt32 subSteps = ndBenchmarkGetArg(argc, argv, 4, 2);
+	const ndInt32 maxThreads = ndThreadPool::GetMaxThreads();
+
+	const ndVector origin(ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(1.0f));
+	ndShapeInstance shape(new ndShapeBox(ndFloat32(1.0f), ndFloat32(1.0f), ndFloat32(1.0f)));
+
+	printf("bodies: %d, sub steps: %d, max threads: %d\n", count * count * layers, subSteps, maxThreads);
+	printf("threads, substep(us), speedup\n");
+
+	ndFloat64 baseTime = ndFloat64(0.0f);
+	for (ndInt32 threads = 1; threads <= maxThreads; ++threads)
+	{
+		ndWorld world;
+		world.SetSubSteps(subSteps);
+		world.SetThreadCount(threads);
+
+		ndBenchmarkAddFloor(world, origin);
+		ndBenchmarkAddPile(world, shape, origin, count, layers, ndFloat32(1.01f), false);
+
+		// let the pile settle before measuring.
+		ndBenchmarkRun(world, 30);
+		const ndFloat64 subStepTime = ndBenchmarkRun(world, frames) / ndFloat64(subSteps);
+		baseTime = (threads == 1) ? subStepTime : baseTime;
+		printf("%d, %.1f, %.2f\n", world.GetThreadCount(), subStepTime, baseTime / subStepTime);
+		world.CleanUp();
+	}
+	return 0;
+}
@@ -1010,6 +1010,7 @@ void ndDemoEntityManager::ShowMainMenuBar()
 			ImGui::RadioButton("sse", &solverMode, ndWorld::ndSimdSoaSolver);
 			ImGui::RadioButton("avx2", &solverMode, ndWorld::ndSimdAvx2Solver);
 			ImGui::RadioButton("cuda", &solverMode, ndWorld::ndCudaSolver);
+			ImGui::RadioButton("gauss seidel", &solverMode, ndWorld::ndGaussSeidelSolver);
 
 			m_solverMode = ndWorld::ndSolverModes(solverMode);
 			ImGui::Separator();
@@ -251,12 +251,12 @@ static void Cifar10TrainingSet()
 		void Optimize(ndBrainMatrix* const trainingLabels, const ndBrainMatrix* const sourceTrainingImages,
 					  ndBrainMatrix* const testLabels, ndBrainMatrix* const testImages)
 		{
-			ndUnsigned32 failCount[D_MAX_THREADS_COUNT];
+			ndUnsigned32* const failCount = ndAlloca(ndUnsigned32, GetThreadCount());
 			ndUnsigned32 miniBashArray[BATCH_BUFFER_SIZE];
 
 			ndAtomic<ndInt32> iterator(0);
 			const ndBrainMatrix& trainingImages = *sourceTrainingImages;
-			auto BackPropagateBash = ndMakeObject::ndFunction([this, &iterator, &trainingImages, trainingLabels, &miniBashArray, &failCount](ndInt32 threadIndex, ndInt32)
+			auto BackPropagateBash = ndMakeObject::ndFunction([this, &iterator, &trainingImages, trainingLabels, &miniBashArray, failCount](ndInt32 threadIndex, ndInt32)
 			{
 				class CategoricalLoss : public ndBrainLossCategoricalCrossEntropy
 				{
@@ -329,7 +329,7 @@ static void Cifar10TrainingSet()
 			for (ndInt32 epoch = 0; epoch < 500; ++epoch)
 			{
 				ndInt32 start = 0;
-				ndMemSet(failCount, ndUnsigned32(0), D_MAX_THREADS_COUNT);
+				ndMemSet(failCount, ndUnsigned32(0), GetThreadCount());
 
 				m_brain.EnableDropOut();
 				m_brain.UpdateDropOut();
@@ -355,7 +355,7 @@ static void Cifar10TrainingSet()
 				//bool test = (trainFail < minTrainingFail) || ((trainFail == minTrainingFail) && (testFail < minTestFail));
 				if (test)
 				{
-					auto CrossValidateTest = ndMakeObject::ndFunction([this, &iterator, testLabels, testImages, &failCount](ndInt32 threadIndex, ndInt32)
+					auto CrossValidateTest = ndMakeObject::ndFunction([this, &iterator, testLabels, testImages, failCount](ndInt32 threadIndex, ndInt32)
 					{
 						ndBrainFloat outputBuffer[32];
 						ndBrainMemVector output(outputBuffer, m_brain.GetOutputSize());
@@ -277,7 +277,7 @@ static void MnistTrainingSet()
 			if (test)
 			{
 				ndAtomic<ndInt32> iterator(0);
-				auto CrossValidateTest = ndMakeObject::ndFunction([this, &iterator, testDigits, testLabels, &failCount](ndInt32 threadIndex, ndInt32)
+				auto CrossValidateTest = ndMakeObject::ndFunction([this, &iterator, testDigits, testLabels, failCount](ndInt32 threadIndex, ndInt32)
 				{
 					ndBrainFloat outputBuffer[32];
 					ndBrainMemVector output(outputBuffer, m_brain.GetOutputSize());
@@ -337,7 +337,7 @@ static void MnistTrainingSet()
 			if (score > MIN_TRAIN_SCORE)
 			{
 				ndAtomic<ndInt32> iterator(0);
-				auto CrossValidateTest = ndMakeObject::ndFunction([this, &iterator, testDigits, testLabels, &failCount](ndInt32 threadIndex, ndInt32)
+				auto CrossValidateTest = ndMakeObject::ndFunction([this, &iterator, testDigits, testLabels, failCount](ndInt32 threadIndex, ndInt32)
 				{
 					ndBrainFloat outputBuffer[32];
 					ndBrainMemVector output(outputBuffer, m_brain.GetOutputSize());
@@ -391,11 +391,11 @@ static void MnistTrainingSet()
 		void Optimize(ndBrainMatrix* const trainingLabels, ndBrainMatrix* const trainingDigits,
 					  ndBrainMatrix* const testLabels, ndBrainMatrix* const testDigits)
 		{
-			ndUnsigned32 failCount[D_MAX_THREADS_COUNT];
+			ndUnsigned32* const failCount = ndAlloca(ndUnsigned32, GetThreadCount());
 			ndUnsigned32 miniBashArray[BATCH_BUFFER_SIZE];
 
 			ndAtomic<ndInt32> iterator(0);
-			auto BackPropagateBash = ndMakeObject::ndFunction([this, &iterator, trainingDigits, trainingLabels, &miniBashArray, &failCount](ndInt32 threadIndex, ndInt32)
+			auto BackPropagateBash = ndMakeObject::ndFunction([this, &iterator, trainingDigits, trainingLabels, &miniBashArray, failCount](ndInt32 threadIndex, ndInt32)
 			{
 				class CategoricalLoss : public ndBrainLossCategoricalCrossEntropy
 				{
@@ -475,7 +475,7 @@ static void MnistTrainingSet()
 			for (ndInt32 epoch = 0; epoch < 100; ++epoch)
 			{
 				ndInt32 start = 0;
-				ndMemSet(failCount, ndUnsigned32(0), D_MAX_THREADS_COUNT);
+				ndMemSet(failCount, ndUnsigned32(0), GetThreadCount());
 
 				m_brain.EnableDropOut();
 				m_brain.UpdateDropOut();
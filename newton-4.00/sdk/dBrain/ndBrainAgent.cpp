@@ -22,6 +22,7 @@
 #include "ndBrainStdafx.h"
 #include "ndBrain.h"
 #include "ndBrainAgent.h"
+#include "ndBrainVector.h"
 #include "ndBrainSaveLoad.h"
 
 ndBrainAgent::ndBrainAgent()
@@ -34,6 +35,11 @@ ndBrainAgent::~ndBrainAgent()
 {
 }
 
+void ndBrainAgent::ApplyPrediction(ndBrainVector& prediction)
+{
+	ApplyActions(&prediction[0]);
+}
+
 void ndBrainAgent::SaveToFile(const char* const)
 {
 	ndAssert(0);
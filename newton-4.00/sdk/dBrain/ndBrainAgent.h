@@ -24,6 +24,7 @@
 
 
 class ndBrainSave;
+class ndBrainVector;
 
 
 class ndBrainAgent: public ndClassAlloc
@@ -50,9 +51,18 @@ class ndBrainAgent: public ndClassAlloc
 	virtual ndInt32 GetEpisodeFrames() const = 0;
 	virtual void Save(ndBrainSave* const loadSave) = 0;
 	virtual void ApplyActions(ndBrainFloat* const actions)= 0;
+
+	// an agent in an ndBrainAgentBatch gets this call, and the call to ApplyPrediction,
+	// from a thread of the batch, concurrently with the other agents of the batch.
+	// so they must only read and write the state of this agent.
 	virtual void GetObservation(ndBrainFloat* const observation) = 0;
 
+	// turns the output of the policy into actions, the default applies the output as is.
+	virtual void ApplyPrediction(ndBrainVector& prediction);
+
 	ndString m_name;
+
+	friend class ndBrainAgentBatch;
 };
 
 inline const ndString& ndBrainAgent::GetName() const
@@ -0,0 +1,164 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndBrainStdafx.h"
+#include "ndBrain.h"
+#include "ndBrainAgent.h"
+#include "ndBrainLayer.h"
+#include "ndBrainMatrix.h"
+#include "ndBrainAgentBatch.h"
+
+// waking up the workers costs more than predicting a few agents.
+#define D_BRAIN_AGENT_BATCH_MIN_BLOCK	16
+
+// the input of the network followed by the output of each layer for the block of agents of one thread.
+class ndBrainAgentBatch::ndThreadBuffers: public ndClassAlloc
+{
+	public:
+	ndThreadBuffers(const ndBrain& brain)
+		:ndClassAlloc()
+		,m_layers()
+	{
+		for (ndInt32 i = 0; i <= brain.GetCount(); ++i)
+		{
+			m_layers.PushBack(new ndBrainMatrix());
+		}
+	}
+
+	~ndThreadBuffers()
+	{
+		for (ndInt32 i = 0; i < m_layers.GetCount(); ++i)
+		{
+			delete m_layers[i];
+		}
+	}
+
+	void Init(const ndBrain& brain, ndInt32 rows)
+	{
+		if (m_layers[0]->GetRows() != rows)
+		{
+			m_layers[0]->Init(rows, brain.GetInputSize());
+			for (ndInt32 i = 0; i < brain.GetCount(); ++i)
+			{
+				m_layers[i + 1]->Init(rows, brain[i]->GetOutputSize());
+			}
+		}
+	}
+
+	ndArray<ndBrainMatrix*> m_layers;
+};
+
+ndBrainAgentBatch::ndBrainAgentBatch(const ndSharedPtr<ndBrain>& brain, ndInt32 threadCount)
+	:ndBrainThreadPool()
+	,m_brain(brain)
+	,m_agents()
+	,m_buffers()
+{
+	SetThreadCount(threadCount);
+}
+
+ndBrainAgentBatch::~ndBrainAgentBatch()
+{
+	for (ndInt32 i = 0; i < m_buffers.GetCount(); ++i)
+	{
+		delete m_buffers[i];
+	}
+}
+
+void ndBrainAgentBatch::AddAgent(ndBrainAgent* const agent)
+{
+	ndAssert(!agent->IsTrainer());
+#ifdef _DEBUG
+	for (ndInt32 i = 0; i < m_agents.GetCount(); ++i)
+	{
+		ndAssert(m_agents[i] != agent);
+	}
+#endif
+	m_agents.PushBack(agent);
+}
+
+void ndBrainAgentBatch::RemoveAgent(ndBrainAgent* const agent)
+{
+	for (ndInt32 i = 0; i < m_agents.GetCount(); ++i)
+	{
+		if (m_agents[i] == agent)
+		{
+			m_agents[i] = m_agents[m_agents.GetCount() - 1];
+			m_agents.SetCount(m_agents.GetCount() - 1);
+			break;
+		}
+	}
+}
+
+void ndBrainAgentBatch::Step()
+{
+	const ndInt32 threadCount = GetThreadCount();
+	for (ndInt32 i = m_buffers.GetCount(); i < threadCount; ++i)
+	{
+		m_buffers.PushBack(new ndThreadBuffers(**m_brain));
+	}
+
+	// each thread gathers, predicts and scatters its own block of agents,
+	// so there is no synchronization between the three phases.
+	const ndInt32 blocks = ndMin(threadCount, (m_agents.GetCount() + D_BRAIN_AGENT_BATCH_MIN_BLOCK - 1) / D_BRAIN_AGENT_BATCH_MIN_BLOCK);
+	auto PredictBlock = ndMakeObject::ndFunction([this, blocks](ndInt32 threadIndex, ndInt32)
+	{
+		if (threadIndex >= blocks)
+		{
+			return;
+		}
+		const ndStartEnd startEnd(m_agents.GetCount(), threadIndex, blocks);
+		const ndInt32 rows = startEnd.m_end - startEnd.m_start;
+		if (!rows)
+		{
+			return;
+		}
+
+		const ndBrain& brain = **m_brain;
+		ndThreadBuffers& buffers = *m_buffers[threadIndex];
+		buffers.Init(brain, rows);
+
+		ndBrainMatrix& observations = *buffers.m_layers[0];
+		for (ndInt32 i = 0; i < rows; ++i)
+		{
+			m_agents[startEnd.m_start + i]->GetObservation(&observations[i][0]);
+		}
+
+		for (ndInt32 i = 0; i < brain.GetCount(); ++i)
+		{
+			brain[i]->MakeBatchPrediction(*buffers.m_layers[i], *buffers.m_layers[i + 1]);
+		}
+
+		ndBrainMatrix& actions = *buffers.m_layers[brain.GetCount()];
+		for (ndInt32 i = 0; i < rows; ++i)
+		{
+			m_agents[startEnd.m_start + i]->ApplyPrediction(actions[i]);
+		}
+	});
+	if (blocks > 1)
+	{
+		ParallelExecute(PredictBlock);
+	}
+	else
+	{
+		PredictBlock(0, 1);
+	}
+}
@@ -0,0 +1,76 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef _ND_BRAIN_AGENT_BATCH_H__
+#define _ND_BRAIN_AGENT_BATCH_H__
+
+#include "ndBrainStdafx.h"
+#include "ndBrainThreadPool.h"
+
+class ndBrain;
+class ndBrainAgent;
+class ndBrainMatrix;
+
+// runs the policy of many inference agents that share one brain as a batched 
+// forward pass. each step gathers the observations of all the agents, runs the 
+// network over the thread pool, one block of agents per thread, and applies the
+// predicted actions back. call Step once per substep instead of the agents Step, 
+// for example from ndWorld::OnSubStepPreUpdate.
+// GetObservation and ApplyPrediction of the agents run on the threads of the batch,
+// several agents at once, so they must not touch state shared between agents.
+// the batch has its own thread pool of threadCount threads. when Step is called
+// from a world callback the world workers are busy in that same substep, so a
+// second full size pool oversubscribes the cores, use one thread there unless
+// the cores outnumber the world threads.
+class ndBrainAgentBatch: public ndBrainThreadPool
+{
+	public: 
+	ndBrainAgentBatch(const ndSharedPtr<ndBrain>& brain, ndInt32 threadCount);
+	~ndBrainAgentBatch();
+
+	ndBrain* GetBrain() const;
+	ndInt32 GetAgentCount() const;
+
+	// the agent must use the brain of the batch, and must not be a trainer.
+	void AddAgent(ndBrainAgent* const agent);
+	void RemoveAgent(ndBrainAgent* const agent);
+
+	void Step();
+
+	private:
+	class ndThreadBuffers;
+
+	ndSharedPtr<ndBrain> m_brain;
+	ndArray<ndBrainAgent*> m_agents;
+	ndArray<ndThreadBuffers*> m_buffers;
+};
+
+inline ndBrain* ndBrainAgentBatch::GetBrain() const
+{
+	return (ndBrain*)*m_brain;
+}
+
+inline ndInt32 ndBrainAgentBatch::GetAgentCount() const
+{
+	return m_agents.GetCount();
+}
+
+#endif 
@@ -132,7 +132,7 @@ void ndBrainAgentContinuePolicyGradient<statesDim, actionDim>::Step()
 	
 	GetObservation(&observations[0]);
 	m_actor->MakePrediction(observations, actions, workingBuffer);
-	ApplyActions(&actions[0]);
+	ApplyPrediction(actions);
 }
 
 #endif 
@@ -96,6 +96,12 @@ ndBrainLayer* ndBrainLastActivationLayer::Clone() const
 	return new ndBrainLastActivationLayer(*this);
 }
 
+ndBrainLayer::ndFusableActivation ndBrainLastActivationLayer::GetFusableActivation() const
+{
+	// the second half of the outputs are sigmas, not a plain tanh
+	return m_noActivation;
+}
+
 void ndBrainLastActivationLayer::Save(const ndBrainSave* const loadSave) const
 {
 	char buffer[1024];
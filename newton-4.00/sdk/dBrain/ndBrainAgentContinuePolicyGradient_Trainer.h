@@ -53,6 +53,7 @@ class ndBrainLastActivationLayer : public ndBrainLayerTanhActivation
 
 	ndBrainLayer* Clone() const;
 	virtual void Save(const ndBrainSave* const loadSave) const;
+	ndFusableActivation GetFusableActivation() const;
 
 	void MakePrediction(const ndBrainVector& input, ndBrainVector& output) const;
 	void InputDerivative(const ndBrainVector& output, const ndBrainVector& outputDerivative, ndBrainVector& inputDerivative) const;
@@ -633,7 +634,7 @@ void ndBrainAgentContinuePolicyGradient_TrainerMaster<statesDim, actionDim>::Opt
 	m_averageScore.Update(averageSum / ndBrainFloat(m_trajectoryAccumulator.GetCount()));
 	m_averageFramesPerEpisodes.Update(ndBrainFloat(m_trajectoryAccumulator.GetCount()) / ndBrainFloat(m_bashTrajectoryIndex));
 
-	ndBrainFixSizeVector<D_MAX_THREADS_COUNT> rewardVariance;
+	ndBrainMemVector rewardVariance(ndAlloca(ndBrainFloat, GetThreadCount()), GetThreadCount());
 
 	rewardVariance.Set(ndBrainFloat(0.0f));
 	m_workingBuffer.SetCount(m_baseValueWorkingBufferSize * GetThreadCount());
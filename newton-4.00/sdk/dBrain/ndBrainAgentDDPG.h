@@ -121,7 +121,7 @@ void ndBrainAgentDDPG<statesDim, actionDim>::Step()
 
 	GetObservation(&observations[0]);
 	m_actor->MakePrediction(observations, actions);
-	ApplyActions(&actions[0]);
+	ApplyPrediction(actions);
 }
 
 #endif 
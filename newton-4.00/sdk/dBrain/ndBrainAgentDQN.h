@@ -43,6 +43,7 @@ class ndBrainAgentDQN: public ndBrainAgent
 	bool IsTerminal() const;
 	ndBrainFloat CalculateReward();
 	ndInt32 GetEpisodeFrames() const;
+	void ApplyPrediction(ndBrainVector& prediction);
 	
 	void Save(ndBrainSave* const loadSave);
 
@@ -124,8 +125,13 @@ void ndBrainAgentDQN<statesDim, actionDim>::Step()
 
 	GetObservation(&observations[0]);
 	m_actor->MakePrediction(observations, actions);
+	ApplyPrediction(actions);
+}
 
-	ndBrainFloat bestAction = ndBrainFloat(actions.ArgMax());
+template<ndInt32 statesDim, ndInt32 actionDim>
+void ndBrainAgentDQN<statesDim, actionDim>::ApplyPrediction(ndBrainVector& prediction)
+{
+	ndBrainFloat bestAction = ndBrainFloat(prediction.ArgMax());
 	ApplyActions(&bestAction);
 }
 
@@ -45,6 +45,7 @@ class ndBrainAgentDiscretePolicyGradient: public ndBrainAgent
 	bool IsTerminal() const;
 	ndBrainFloat CalculateReward();
 	ndInt32 GetEpisodeFrames() const;
+	void ApplyPrediction(ndBrainVector& prediction);
 
 	void Save(ndBrainSave* const loadSave);
 
@@ -134,8 +135,13 @@ void ndBrainAgentDiscretePolicyGradient<statesDim, actionDim>::Step()
 	ndBrainMemVector workingBuffer(bufferMem, bufferSize);
 	GetObservation(&observations[0]);
 	m_actor->MakePrediction(observations, actions, workingBuffer);
-	
-	ndBrainFloat bestAction = ndBrainFloat(actions.ArgMax());
+	ApplyPrediction(actions);
+}
+
+template<ndInt32 statesDim, ndInt32 actionDim>
+void ndBrainAgentDiscretePolicyGradient<statesDim, actionDim>::ApplyPrediction(ndBrainVector& prediction)
+{
+	ndBrainFloat bestAction = ndBrainFloat(prediction.ArgMax());
 	ApplyActions(&bestAction);
 }
 
@@ -573,7 +573,7 @@ void ndBrainAgentDiscretePolicyGradient_TrainerMaster<statesDim, actionDim>::Opt
 	m_averageScore.Update(averageSum / ndBrainFloat(m_trajectoryAccumulator.GetCount()));
 	m_averageFramesPerEpisodes.Update(ndBrainFloat(m_trajectoryAccumulator.GetCount()) / ndBrainFloat(m_bashTrajectoryIndex));
 
-	ndBrainFixSizeVector<D_MAX_THREADS_COUNT> rewardVariance;
+	ndBrainMemVector rewardVariance(ndAlloca(ndBrainFloat, GetThreadCount()), GetThreadCount());
 
 	rewardVariance.Set(ndBrainFloat(0.0f));
 	m_workingBuffer.SetCount(m_baseValueWorkingBufferSize * GetThreadCount());
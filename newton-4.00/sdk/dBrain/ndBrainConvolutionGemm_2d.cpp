@@ -0,0 +1,210 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndBrainStdafx.h"
+#include "ndBrainMatrix.h"
+#include "ndBrainConvolutionGemm_2d.h"
+
+// the matrices of the products point to a buffer of each thread, 
+// so the layers can run on many threads without allocating per sample.
+class ndBrainConvolutionScratch
+{
+	public:
+	ndBrainConvolutionScratch()
+		:m_buffer()
+		,m_weights()
+		,m_columns()
+		,m_result()
+		,m_derivatives()
+	{
+	}
+
+	// rows of a ndBrainMatrix start at 16 byte boundaries
+	static ndInt32 GetAlignedStride(ndInt32 columns)
+	{
+		return (columns + 3) & -4;
+	}
+
+	ndBrainFloat* GetBuffer(ndInt32 size)
+	{
+		m_buffer.SetCount(size);
+		return &m_buffer[0];
+	}
+
+	// the row headers are allocated only when a matrix needs more rows, 
+	// the one column they are initialized with is never used.
+	static void SetRows(ndBrainMatrix& matrix, const ndBrainFloat* const memory, ndInt32 rows, ndInt32 columns, ndInt32 stride)
+	{
+		if (rows >= matrix.GetCapacity())
+		{
+			matrix.Init(rows, 1);
+		}
+		matrix.SetCount(rows);
+		for (ndInt32 i = 0; i < rows; ++i)
+		{
+			ndBrainMemVector& row = matrix[i];
+			row.SetPointer((ndBrainFloat*)&memory[i * stride]);
+			row.SetSize(columns);
+		}
+	}
+
+	ndBrainVector m_buffer;
+	ndBrainMatrix m_weights;
+	ndBrainMatrix m_columns;
+	ndBrainMatrix m_result;
+	ndBrainMatrix m_derivatives;
+};
+
+static thread_local ndBrainConvolutionScratch m_convolutionScratch;
+
+ndBrainConvolutionGemm_2d::ndBrainConvolutionGemm_2d(ndInt32 inputWidth, ndInt32 inputHeight, ndInt32 inputLayers, ndInt32 kernelSize, ndInt32 outputLayers, bool flipKernels)
+	:m_kernelSize(kernelSize)
+	,m_inputWidth(inputWidth)
+	,m_inputHeight(inputHeight)
+	,m_inputLayers(inputLayers)
+	,m_outputWidth(inputWidth - kernelSize + 1)
+	,m_outputHeight(inputHeight - kernelSize + 1)
+	,m_outputLayers(outputLayers)
+	,m_flipKernels(flipKernels)
+{
+}
+
+ndInt32 ndBrainConvolutionGemm_2d::GetColumnRow(ndInt32 channel, ndInt32 kernelIndex) const
+{
+	const ndInt32 kernelSize = m_kernelSize * m_kernelSize;
+	return channel * kernelSize + (m_flipKernels ? kernelSize - 1 - kernelIndex : kernelIndex);
+}
+
+void ndBrainConvolutionGemm_2d::ImageToColumns(const ndBrainVector& input, ndBrainMatrix& columns) const
+{
+	// row (channel, ky, kx) has the input pixel under that kernel 
+	// element for each output pixel, copied one output row at a time.
+	const ndInt32 inputSize = m_inputWidth * m_inputHeight;
+	for (ndInt32 channel = 0; channel < m_inputLayers; ++channel)
+	{
+		for (ndInt32 ky = 0; ky < m_kernelSize; ++ky)
+		{
+			for (ndInt32 kx = 0; kx < m_kernelSize; ++kx)
+			{
+				ndBrainVector& row = columns[GetColumnRow(channel, ky * m_kernelSize + kx)];
+				const ndBrainFloat* src = &input[channel * inputSize + ky * m_inputWidth + kx];
+				for (ndInt32 y = 0; y < m_outputHeight; ++y)
+				{
+					ndMemCpy(&row[y * m_outputWidth], src, m_outputWidth);
+					src += m_inputWidth;
+				}
+			}
+		}
+	}
+}
+
+void ndBrainConvolutionGemm_2d::ColumnsToImage(const ndBrainMatrix& columns, ndBrainVector& input) const
+{
+	const ndInt32 inputSize = m_inputWidth * m_inputHeight;
+	input.Set(ndBrainFloat(0.0f));
+	for (ndInt32 channel = 0; channel < m_inputLayers; ++channel)
+	{
+		for (ndInt32 ky = 0; ky < m_kernelSize; ++ky)
+		{
+			for (ndInt32 kx = 0; kx < m_kernelSize; ++kx)
+			{
+				const ndBrainVector& row = columns[GetColumnRow(channel, ky * m_kernelSize + kx)];
+				ndBrainFloat* dst = &input[channel * inputSize + ky * m_inputWidth + kx];
+				for (ndInt32 y = 0; y < m_outputHeight; ++y)
+				{
+					const ndBrainFloat* const src = &row[y * m_outputWidth];
+					for (ndInt32 x = 0; x < m_outputWidth; ++x)
+					{
+						dst[x] += src[x];
+					}
+					dst += m_inputWidth;
+				}
+			}
+		}
+	}
+}
+
+void ndBrainConvolutionGemm_2d::MakePrediction(const ndBrainVector& kernels, const ndBrainVector& bias, const ndBrainVector& input, ndBrainVector& output) const
+{
+	const ndInt32 outputSize = m_outputWidth * m_outputHeight;
+	const ndInt32 patchSize = m_inputLayers * m_kernelSize * m_kernelSize;
+	const ndBrainFloat biasScale = ndBrainFloat(1.0f) / ndBrainFloat(m_inputLayers * outputSize);
+
+	ndBrainConvolutionScratch& scratch = m_convolutionScratch;
+	const ndInt32 stride = ndBrainConvolutionScratch::GetAlignedStride(outputSize);
+	ndBrainFloat* const buffer = scratch.GetBuffer((patchSize + m_outputLayers) * stride);
+	ndBrainConvolutionScratch::SetRows(scratch.m_weights, &kernels[0], m_outputLayers, patchSize, patchSize);
+	ndBrainConvolutionScratch::SetRows(scratch.m_columns, buffer, patchSize, outputSize, stride);
+	ndBrainConvolutionScratch::SetRows(scratch.m_result, &buffer[patchSize * stride], m_outputLayers, outputSize, stride);
+
+	ImageToColumns(input, scratch.m_columns);
+	scratch.m_result.MatrixMul(scratch.m_weights, scratch.m_columns);
+
+	for (ndInt32 i = 0; i < m_outputLayers; ++i)
+	{
+		ndBrainMemVector out(&output[i * outputSize], outputSize);
+		out.Set(bias[i] * biasScale);
+		out.Add(scratch.m_result[i]);
+	}
+}
+
+void ndBrainConvolutionGemm_2d::CalculateParamGradients(
+	const ndBrainVector& kernels, const ndBrainVector& input, const ndBrainVector& outputDerivative,
+	ndBrainVector& inputGradient, ndBrainVector& kernelGradients, ndBrainVector& biasGradients) const
+{
+	const ndInt32 outputSize = m_outputWidth * m_outputHeight;
+	const ndInt32 patchSize = m_inputLayers * m_kernelSize * m_kernelSize;
+	const ndBrainFloat biasScale = ndBrainFloat(1.0f) / ndBrainFloat(m_inputLayers * outputSize);
+
+	ndBrainConvolutionScratch& scratch = m_convolutionScratch;
+	const ndInt32 columnStride = ndBrainConvolutionScratch::GetAlignedStride(outputSize);
+	const ndInt32 resultStride = ndBrainConvolutionScratch::GetAlignedStride(patchSize);
+	ndBrainFloat* const buffer = scratch.GetBuffer(patchSize * columnStride + m_outputLayers * resultStride);
+	ndBrainConvolutionScratch::SetRows(scratch.m_weights, &kernels[0], m_outputLayers, patchSize, patchSize);
+	ndBrainConvolutionScratch::SetRows(scratch.m_derivatives, &outputDerivative[0], m_outputLayers, outputSize, outputSize);
+	ndBrainConvolutionScratch::SetRows(scratch.m_columns, buffer, patchSize, outputSize, columnStride);
+	ndBrainConvolutionScratch::SetRows(scratch.m_result, &buffer[patchSize * columnStride], m_outputLayers, patchSize, resultStride);
+
+	const ndBrainMatrix& derivatives = scratch.m_derivatives;
+	for (ndInt32 i = 0; i < m_outputLayers; ++i)
+	{
+		const ndBrainVector& src = derivatives[i];
+		ndBrainFloat value = ndBrainFloat(0.0f);
+		for (ndInt32 j = 0; j < outputSize; ++j)
+		{
+			value += src[j];
+		}
+		biasGradients[i] = value * biasScale;
+	}
+
+	// the filter gradients are the output derivatives times the input patches
+	ImageToColumns(input, scratch.m_columns);
+	scratch.m_result.MatrixMulTranspose(derivatives, scratch.m_columns);
+	for (ndInt32 i = 0; i < m_outputLayers; ++i)
+	{
+		ndMemCpy(&kernelGradients[i * patchSize], &scratch.m_result[i][0], patchSize);
+	}
+
+	// the patch gradients are the filters transposed times the output 
+	// derivatives, scattered back to the pixels they were copied from.
+	scratch.m_columns.TransposeMatrixMul(scratch.m_weights, derivatives);
+	ColumnsToImage(scratch.m_columns, inputGradient);
+}
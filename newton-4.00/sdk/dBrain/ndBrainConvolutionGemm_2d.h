@@ -0,0 +1,63 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef _ND_BRAIN_CONVOLUTION_GEMM_2D_H__
+#define _ND_BRAIN_CONVOLUTION_GEMM_2D_H__
+
+#include "ndBrainStdafx.h"
+#include "ndBrainVector.h"
+
+class ndBrainMatrix;
+
+// the 2d convolution layers lowered to the blocked matrix products, 
+// the input patches are copied to the columns of a matrix (im2col) 
+// so that all filters of a layer run as a single product.
+// a convolution copies the kernel rows of the patches in reverse order, 
+// so in both cases the kernels of the layer are used as the weight matrix.
+// the other matrices live in a scratch buffer of each thread that only 
+// grows, so after the first sample a layer does not allocate.
+class ndBrainConvolutionGemm_2d
+{
+	public: 
+	ndBrainConvolutionGemm_2d(ndInt32 inputWidth, ndInt32 inputHeight, ndInt32 inputLayers, ndInt32 kernelSize, ndInt32 outputLayers, bool flipKernels);
+
+	void MakePrediction(const ndBrainVector& kernels, const ndBrainVector& bias, const ndBrainVector& input, ndBrainVector& output) const;
+	void CalculateParamGradients(
+		const ndBrainVector& kernels, const ndBrainVector& input, const ndBrainVector& outputDerivative, 
+		ndBrainVector& inputGradient, ndBrainVector& kernelGradients, ndBrainVector& biasGradients) const;
+
+	private:
+	ndInt32 GetColumnRow(ndInt32 channel, ndInt32 kernelIndex) const;
+	void ImageToColumns(const ndBrainVector& input, ndBrainMatrix& columns) const;
+	void ColumnsToImage(const ndBrainMatrix& columns, ndBrainVector& input) const;
+
+	ndInt32 m_kernelSize;
+	ndInt32 m_inputWidth;
+	ndInt32 m_inputHeight;
+	ndInt32 m_inputLayers;
+	ndInt32 m_outputWidth;
+	ndInt32 m_outputHeight;
+	ndInt32 m_outputLayers;
+	bool m_flipKernels;
+};
+
+#endif 
+
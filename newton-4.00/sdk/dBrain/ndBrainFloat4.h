@@ -47,6 +47,9 @@ class ndBrainFloat4
 	ndBrainFloat4 MulAdd(const ndBrainFloat4& A, const ndBrainFloat4& B) const;
 	ndBrainFloat4 MulSub(const ndBrainFloat4& A, const ndBrainFloat4& B) const;
 
+	// unaligned store
+	void Store(ndBrainFloat* const ptr) const;
+
 	// logical operations;
 	ndBrainFloat4 operator& (const ndBrainFloat4& data) const;
 	ndBrainFloat4 operator| (const ndBrainFloat4& data) const;
@@ -174,6 +177,11 @@ inline ndBrainFloat4 ndBrainFloat4::operator< (const ndBrainFloat4& data) const
 	return _mm_cmplt_ps(m_type, data.m_type);
 }
 
+inline void ndBrainFloat4::Store(ndBrainFloat* const ptr) const
+{
+	_mm_storeu_ps(ptr, m_type);
+}
+
 #else
 
 inline ndBrainFloat4::ndBrainFloat4()
@@ -264,6 +272,14 @@ inline ndBrainFloat4 ndBrainFloat4::operator< (const ndBrainFloat4& data) const
 	return ndBrainFloat4((m_x >= data.m_x) - 1, (m_y >= data.m_y) - 1, (m_z >= data.m_z) - 1, (m_w >= data.m_w) - 1);
 }
 
+inline void ndBrainFloat4::Store(ndBrainFloat* const ptr) const
+{
+	ptr[0] = m_x;
+	ptr[1] = m_y;
+	ptr[2] = m_z;
+	ptr[3] = m_w;
+}
+
 #endif
 
 
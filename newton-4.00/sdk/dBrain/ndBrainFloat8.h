@@ -0,0 +1,216 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef _ND_BRAIN_FLOAT8_H__
+#define _ND_BRAIN_FLOAT8_H__
+
+#include "ndBrainStdafx.h"
+
+// eight wide register for the matrix kernels, 
+// loads and stores are always unaligned.
+class ndBrainFloat8
+{
+	public: 
+	ndBrainFloat8();
+#ifdef D_NEWTON_USE_AVX2_OPTION
+	ndBrainFloat8(const __m256 type);
+#endif
+	ndBrainFloat8(const ndBrainFloat a);
+	ndBrainFloat8(const ndBrainFloat8& src);
+	ndBrainFloat8(const ndBrainFloat* const ptr);
+	~ndBrainFloat8();
+
+	ndBrainFloat8& operator= (const ndBrainFloat8& A);
+
+	ndBrainFloat8 operator+ (const ndBrainFloat8& A) const;
+	ndBrainFloat8 operator* (const ndBrainFloat8& A) const;
+
+	// this + A * B
+	ndBrainFloat8 MulAdd(const ndBrainFloat8& A, const ndBrainFloat8& B) const;
+
+	ndBrainFloat AddHorizontal() const;
+	void Store(ndBrainFloat* const ptr) const;
+
+	union
+	{
+		ndBrainFloat m_f[8];
+		#ifdef D_NEWTON_USE_AVX2_OPTION
+		__m256 m_type;
+		#endif
+	};
+};
+
+#ifdef D_NEWTON_USE_AVX2_OPTION
+inline ndBrainFloat8::ndBrainFloat8()
+{
+}
+
+inline ndBrainFloat8::ndBrainFloat8(const ndBrainFloat8& src)
+	:m_type(src.m_type)
+{
+}
+
+inline ndBrainFloat8::ndBrainFloat8(const __m256 type)
+	:m_type(type)
+{
+}
+
+inline ndBrainFloat8::ndBrainFloat8(const ndBrainFloat a)
+	:m_type(_mm256_set1_ps(a))
+{
+}
+
+inline ndBrainFloat8::ndBrainFloat8(const ndBrainFloat* const ptr)
+	:m_type(_mm256_loadu_ps(ptr))
+{
+}
+
+inline ndBrainFloat8::~ndBrainFloat8()
+{
+}
+
+inline ndBrainFloat8& ndBrainFloat8::operator= (const ndBrainFloat8& A)
+{
+	m_type = A.m_type;
+	return *this;
+}
+
+inline ndBrainFloat8 ndBrainFloat8::operator+ (const ndBrainFloat8& A) const
+{
+	return _mm256_add_ps(m_type, A.m_type);
+}
+
+inline ndBrainFloat8 ndBrainFloat8::operator* (const ndBrainFloat8& A) const
+{
+	return _mm256_mul_ps(m_type, A.m_type);
+}
+
+inline ndBrainFloat8 ndBrainFloat8::MulAdd(const ndBrainFloat8& A, const ndBrainFloat8& B) const
+{
+	return _mm256_fmadd_ps(A.m_type, B.m_type, m_type);
+}
+
+inline ndBrainFloat ndBrainFloat8::AddHorizontal() const
+{
+	const __m128 sum4(_mm_add_ps(_mm256_castps256_ps128(m_type), _mm256_extractf128_ps(m_type, 1)));
+	const __m128 sum2(_mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4)));
+	const __m128 sum1(_mm_add_ss(sum2, _mm_shuffle_ps(sum2, sum2, 0x55)));
+	return _mm_cvtss_f32(sum1);
+}
+
+inline void ndBrainFloat8::Store(ndBrainFloat* const ptr) const
+{
+	_mm256_storeu_ps(ptr, m_type);
+}
+
+#else
+
+inline ndBrainFloat8::ndBrainFloat8()
+{
+}
+
+inline ndBrainFloat8::ndBrainFloat8(const ndBrainFloat8& src)
+{
+	for (ndInt32 i = 0; i < 8; ++i)
+	{
+		m_f[i] = src.m_f[i];
+	}
+}
+
+inline ndBrainFloat8::ndBrainFloat8(const ndBrainFloat a)
+{
+	for (ndInt32 i = 0; i < 8; ++i)
+	{
+		m_f[i] = a;
+	}
+}
+
+inline ndBrainFloat8::ndBrainFloat8(const ndBrainFloat* const ptr)
+{
+	for (ndInt32 i = 0; i < 8; ++i)
+	{
+		m_f[i] = ptr[i];
+	}
+}
+
+inline ndBrainFloat8::~ndBrainFloat8()
+{
+}
+
+inline ndBrainFloat8& ndBrainFloat8::operator= (const ndBrainFloat8& A)
+{
+	for (ndInt32 i = 0; i < 8; ++i)
+	{
+		m_f[i] = A.m_f[i];
+	}
+	return *this;
+}
+
+inline ndBrainFloat8 ndBrainFloat8::operator+ (const ndBrainFloat8& A) const
+{
+	ndBrainFloat8 tmp;
+	for (ndInt32 i = 0; i < 8; ++i)
+	{
+		tmp.m_f[i] = m_f[i] + A.m_f[i];
+	}
+	return tmp;
+}
+
+inline ndBrainFloat8 ndBrainFloat8::operator* (const ndBrainFloat8& A) const
+{
+	ndBrainFloat8 tmp;
+	for (ndInt32 i = 0; i < 8; ++i)
+	{
+		tmp.m_f[i] = m_f[i] * A.m_f[i];
+	}
+	return tmp;
+}
+
+inline ndBrainFloat8 ndBrainFloat8::MulAdd(const ndBrainFloat8& A, const ndBrainFloat8& B) const
+{
+	ndBrainFloat8 tmp;
+	for (ndInt32 i = 0; i < 8; ++i)
+	{
+		tmp.m_f[i] = m_f[i] + A.m_f[i] * B.m_f[i];
+	}
+	return tmp;
+}
+
+inline ndBrainFloat ndBrainFloat8::AddHorizontal() const
+{
+	ndBrainFloat sum = ndBrainFloat(0.0f);
+	for (ndInt32 i = 0; i < 8; ++i)
+	{
+		sum += m_f[i];
+	}
+	return sum;
+}
+
+inline void ndBrainFloat8::Store(ndBrainFloat* const ptr) const
+{
+	for (ndInt32 i = 0; i < 8; ++i)
+	{
+		ptr[i] = m_f[i];
+	}
+}
+
+#endif
+#endif 
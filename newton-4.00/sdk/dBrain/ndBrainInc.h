@@ -29,12 +29,15 @@
 #include <ndBrainAgent.h>
 #include <ndBrainLayer.h>
 #include <ndBrainFloat4.h>
+#include <ndBrainFloat8.h>
 #include <ndBrainVector.h>
 #include <ndBrainMatrix.h>
 #include <ndBrainTrainer.h>
+#include <ndBrainInference.h>
 #include <ndBrainSaveLoad.h>
 #include <ndBrainAgentDQN.h>
 #include <ndBrainAgentDDPG.h>
+#include <ndBrainAgentBatch.h>
 #include <ndBrainOptimizer.h>
 #include <ndBrainGpuBuffer.h>
 #include <ndBrainThreadPool.h>
@@ -53,6 +56,7 @@
 #include <ndBrainLayerTanhActivation.h>
 #include <ndBrainLayerImagePolling_2x2.h>
 #include <ndBrainLayerConvolutional_2d.h>
+#include <ndBrainLayerLinearQuantized.h>
 #include <ndBrainLossLeastSquaredError.h>
 #include <ndBrainLayerLinearWithDropOut.h>
 #include <ndBrainLayerSigmoidActivation.h>
@@ -0,0 +1,282 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndBrainStdafx.h"
+#include "ndBrain.h"
+#include "ndBrainFloat8.h"
+#include "ndBrainMatrix.h"
+#include "ndBrainInference.h"
+#include "ndBrainLayerLinear.h"
+
+#define D_INFERENCE_ROW_BLOCK	4
+
+ndBrainInference::ndBrainInference(const ndSharedPtr<ndBrain>& brain)
+	:ndClassAlloc()
+	,m_brain(brain)
+	,m_steps()
+	,m_scratchBuffer()
+	,m_scratchBufferSize(0)
+{
+	Compile();
+	m_scratchBuffer.SetCount(m_scratchBufferSize);
+	m_scratchBuffer.Set(ndBrainFloat(0.0f));
+}
+
+ndBrainInference::~ndBrainInference()
+{
+}
+
+const ndSharedPtr<ndBrain>& ndBrainInference::GetBrain() const
+{
+	return m_brain;
+}
+
+ndInt32 ndBrainInference::GetInputSize() const
+{
+	return m_brain->GetInputSize();
+}
+
+ndInt32 ndBrainInference::GetOutputSize() const
+{
+	return m_brain->GetOutputSize();
+}
+
+ndInt32 ndBrainInference::GetStepCount() const
+{
+	return m_steps.GetCount();
+}
+
+ndInt32 ndBrainInference::GetScratchBufferSize() const
+{
+	return m_scratchBufferSize;
+}
+
+void ndBrainInference::Compile()
+{
+	const ndBrain& brain = **m_brain;
+	ndAssert(brain.GetCount());
+	ndInt32 maxSize = brain[0]->GetInputSize();
+	for (ndInt32 i = 0; i < brain.GetCount(); ++i)
+	{
+		maxSize = ndMax(maxSize, brain[i]->GetOutputBufferSize());
+	}
+	maxSize = (maxSize + 7) & -8;
+
+	// the steps alternate between the two halves of the scratch buffer, 
+	// the first step reads the input and the last writes the output.
+	ndInt32 half = 0;
+	ndInt32 inputOffset = -1;
+	for (ndInt32 i = 0; i < brain.GetCount(); ++i)
+	{
+		ndBrainLayer* const layer = brain[i];
+
+		ndStep step;
+		step.m_layer = layer;
+		step.m_activationLayer = nullptr;
+		step.m_weights = nullptr;
+		step.m_bias = nullptr;
+		step.m_activation = ndBrainLayer::m_noActivation;
+		step.m_inputSize = layer->GetInputSize();
+		step.m_outputSize = layer->GetOutputSize();
+
+		// linear layers with drop out are not fused, 
+		// the drop out can still be enabled.
+		if (!strcmp(layer->GetLabelId(), "ndBrainLayerLinear"))
+		{
+			ndBrainLayerLinear* const linear = (ndBrainLayerLinear*)layer;
+			step.m_weights = linear->GetWeights();
+			step.m_bias = linear->GetBias();
+
+			if ((i + 1) < brain.GetCount())
+			{
+				// the layer reports its own activation, so a derived layer 
+				// that keeps the label of its base is not fused by mistake. 
+				// layers that can not be fused run as a step of their own.
+				const ndBrainLayer* const next = brain[i + 1];
+				step.m_activation = next->GetFusableActivation();
+				if (step.m_activation != ndBrainLayer::m_noActivation)
+				{
+					step.m_activationLayer = next;
+					ndAssert(next->GetInputSize() == step.m_outputSize);
+					i++;
+				}
+			}
+		}
+
+		const bool isLast = (i == (brain.GetCount() - 1));
+		const bool writesOutput = step.m_weights || (layer->GetOutputBufferSize() == step.m_outputSize);
+		step.m_inputOffset = inputOffset;
+		step.m_outputOffset = (isLast && writesOutput) ? -1 : half * maxSize;
+		inputOffset = step.m_outputOffset;
+		half = 1 - half;
+		m_steps.PushBack(step);
+	}
+	m_scratchBufferSize = maxSize * 2;
+}
+
+void ndBrainInference::LinearStep(const ndStep& step, const ndBrainFloat* const input, ndBrainFloat* const output) const
+{
+	const ndBrainMatrix& weights = *step.m_weights;
+	const ndBrainVector& bias = *step.m_bias;
+	const ndInt32 rows = step.m_outputSize;
+	const ndInt32 columns = step.m_inputSize;
+
+#ifdef D_NEWTON_USE_AVX2_OPTION
+	const ndInt32 columns8 = columns & -8;
+
+	ndInt32 i = 0;
+	for (; (i + D_INFERENCE_ROW_BLOCK) <= rows; i += D_INFERENCE_ROW_BLOCK)
+	{
+		const ndBrainFloat* const w0 = &weights[i + 0][0];
+		const ndBrainFloat* const w1 = &weights[i + 1][0];
+		const ndBrainFloat* const w2 = &weights[i + 2][0];
+		const ndBrainFloat* const w3 = &weights[i + 3][0];
+
+		ndBrainFloat8 acc0(ndBrainFloat(0.0f));
+		ndBrainFloat8 acc1(ndBrainFloat(0.0f));
+		ndBrainFloat8 acc2(ndBrainFloat(0.0f));
+		ndBrainFloat8 acc3(ndBrainFloat(0.0f));
+		for (ndInt32 k = 0; k < columns8; k += 8)
+		{
+			const ndBrainFloat8 x(&input[k]);
+			acc0 = acc0.MulAdd(ndBrainFloat8(&w0[k]), x);
+			acc1 = acc1.MulAdd(ndBrainFloat8(&w1[k]), x);
+			acc2 = acc2.MulAdd(ndBrainFloat8(&w2[k]), x);
+			acc3 = acc3.MulAdd(ndBrainFloat8(&w3[k]), x);
+		}
+
+		ndBrainFloat dot0 = acc0.AddHorizontal() + bias[i + 0];
+		ndBrainFloat dot1 = acc1.AddHorizontal() + bias[i + 1];
+		ndBrainFloat dot2 = acc2.AddHorizontal() + bias[i + 2];
+		ndBrainFloat dot3 = acc3.AddHorizontal() + bias[i + 3];
+		for (ndInt32 k = columns8; k < columns; ++k)
+		{
+			const ndBrainFloat x = input[k];
+			dot0 += w0[k] * x;
+			dot1 += w1[k] * x;
+			dot2 += w2[k] * x;
+			dot3 += w3[k] * x;
+		}
+
+		output[i + 0] = dot0;
+		output[i + 1] = dot1;
+		output[i + 2] = dot2;
+		output[i + 3] = dot3;
+	}
+
+	for (; i < rows; ++i)
+	{
+		const ndBrainFloat* const w = &weights[i][0];
+		ndBrainFloat8 acc(ndBrainFloat(0.0f));
+		for (ndInt32 k = 0; k < columns8; k += 8)
+		{
+			acc = acc.MulAdd(ndBrainFloat8(&w[k]), ndBrainFloat8(&input[k]));
+		}
+		ndBrainFloat dot = acc.AddHorizontal() + bias[i];
+		for (ndInt32 k = columns8; k < columns; ++k)
+		{
+			dot += w[k] * input[k];
+		}
+		output[i] = dot;
+	}
+
+#else
+	// without wide registers the four row blocks are slower than plain dot products
+	for (ndInt32 i = 0; i < rows; ++i)
+	{
+		output[i] = ndDotProduct(columns, &weights[i][0], input) + bias[i];
+	}
+#endif
+
+	// the activation runs over the output while it is still in cache, 
+	// in a loop of its own so that the compiler can vectorize it.
+	ndBrainMemVector out(output, rows);
+	switch (step.m_activation)
+	{
+		case ndBrainLayer::m_reluActivation:
+		{
+			for (ndInt32 j = 0; j < rows; ++j)
+			{
+				output[j] = (output[j] > ndBrainFloat(0.0f)) ? output[j] : ndBrainFloat(0.0f);
+			}
+			break;
+		}
+
+		case ndBrainLayer::m_tanhActivation:
+		{
+			for (ndInt32 j = 0; j < rows; ++j)
+			{
+				output[j] = ndBrainFloat(ndTanh(output[j]));
+			}
+			out.FlushToZero();
+			break;
+		}
+
+		case ndBrainLayer::m_sigmoidActivation:
+		case ndBrainLayer::m_softmaxActivation:
+		{
+			step.m_activationLayer->MakePrediction(out, out);
+			break;
+		}
+
+		default:;
+	}
+}
+
+void ndBrainInference::MakePrediction(const ndBrainVector& input, ndBrainVector& output)
+{
+	MakePrediction(input, output, m_scratchBuffer);
+}
+
+void ndBrainInference::MakePrediction(const ndBrainVector& input, ndBrainVector& output, ndBrainVector& scratchBuffer) const
+{
+	ndAssert(input.GetCount() == GetInputSize());
+	ndAssert(output.GetCount() == GetOutputSize());
+	if (scratchBuffer.GetCount() < m_scratchBufferSize)
+	{
+		scratchBuffer.SetCount(m_scratchBufferSize);
+	}
+
+	ndBrainFloat* const scratch = &scratchBuffer[0];
+	for (ndInt32 i = 0; i < m_steps.GetCount(); ++i)
+	{
+		const ndStep& step = m_steps[i];
+		const ndBrainFloat* const in = (step.m_inputOffset < 0) ? &input[0] : &scratch[step.m_inputOffset];
+		ndBrainFloat* const out = (step.m_outputOffset < 0) ? &output[0] : &scratch[step.m_outputOffset];
+		if (step.m_weights)
+		{
+			LinearStep(step, in, out);
+		}
+		else
+		{
+			const ndBrainMemVector inVector(in, step.m_inputSize);
+			ndBrainMemVector outVector(out, step.m_outputSize);
+			step.m_layer->MakePrediction(inVector, outVector);
+		}
+	}
+
+	const ndStep& lastStep = m_steps[m_steps.GetCount() - 1];
+	if (lastStep.m_outputOffset >= 0)
+	{
+		const ndBrainMemVector result(&scratch[lastStep.m_outputOffset], lastStep.m_outputSize);
+		output.Set(result);
+	}
+}
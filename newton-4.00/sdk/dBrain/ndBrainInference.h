@@ -0,0 +1,81 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef _ND_BRAIN_INFERENCE_H__
+#define _ND_BRAIN_INFERENCE_H__
+
+#include "ndBrainStdafx.h"
+#include "ndBrainLayer.h"
+#include "ndBrainVector.h"
+
+class ndBrain;
+class ndBrainMatrix;
+
+// cpu inference of a brain compiled once into a list of fused steps.
+// a linear layer and the activation after it run as a single kernel, 
+// and all the intermediate vectors live at fixed offsets of one scratch 
+// buffer, so a prediction does not allocate or walk the layers again.
+// the steps read the weights of the brain, so the weights can be 
+// updated, but adding or removing layers requires a new inference.
+class ndBrainInference : public ndClassAlloc
+{
+	public:
+	ndBrainInference(const ndSharedPtr<ndBrain>& brain);
+	~ndBrainInference();
+
+	ndInt32 GetInputSize() const;
+	ndInt32 GetOutputSize() const;
+	ndInt32 GetStepCount() const;
+	ndInt32 GetScratchBufferSize() const;
+	const ndSharedPtr<ndBrain>& GetBrain() const;
+
+	// uses the scratch buffer of the inference
+	void MakePrediction(const ndBrainVector& input, ndBrainVector& output);
+
+	// many threads can share one inference, each with its own scratch buffer
+	void MakePrediction(const ndBrainVector& input, ndBrainVector& output, ndBrainVector& scratchBuffer) const;
+
+	private:
+	class ndStep
+	{
+		public:
+		const ndBrainLayer* m_layer;
+		const ndBrainLayer* m_activationLayer;
+		const ndBrainMatrix* m_weights;
+		const ndBrainVector* m_bias;
+		ndBrainLayer::ndFusableActivation m_activation;
+		ndInt32 m_inputSize;
+		ndInt32 m_outputSize;
+		ndInt32 m_inputOffset;
+		ndInt32 m_outputOffset;
+	};
+
+	void Compile();
+	void LinearStep(const ndStep& step, const ndBrainFloat* const input, ndBrainFloat* const output) const;
+
+	ndSharedPtr<ndBrain> m_brain;
+	ndArray<ndStep> m_steps;
+	ndBrainVector m_scratchBuffer;
+	ndInt32 m_scratchBufferSize;
+};
+
+#endif 
+
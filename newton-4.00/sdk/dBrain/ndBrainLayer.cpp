@@ -22,6 +22,8 @@
 
 #include "ndBrainStdafx.h"
 #include "ndBrainLayer.h"
+#include "ndBrainVector.h"
+#include "ndBrainMatrix.h"
 
 class ndBrainGpuContext;
 
@@ -61,6 +63,11 @@ const char* ndBrainLayer::GetLabelId() const
 	return "ndBrainLayer";
 }
 
+ndBrainLayer::ndFusableActivation ndBrainLayer::GetFusableActivation() const
+{
+	return m_noActivation;
+}
+
 ndInt32 ndBrainLayer::GetInputSize() const
 {
 	ndAssert(0);
@@ -167,6 +174,69 @@ void ndBrainLayer::CalculateParamGradients(const ndBrainVector&, const ndBrainVe
 	ndAssert(0);
 }
 
+void ndBrainLayer::MakeBatchPrediction(const ndBrainMatrix& input, ndBrainMatrix& output) const
+{
+	ndAssert(input.GetRows() == output.GetRows());
+	ndAssert(input.GetColumns() == GetInputSize());
+	ndAssert(output.GetColumns() == GetOutputSize());
+
+	if (GetOutputBufferSize() == GetOutputSize())
+	{
+		for (ndInt32 i = 0; i < input.GetRows(); ++i)
+		{
+			MakePrediction(input[i], output[i]);
+		}
+		return;
+	}
+
+	// some layers use the output as scratch memory past its size
+	ndBrainVector buffer;
+	buffer.SetCount(GetOutputBufferSize() + 32);
+	ndBrainMemVector out(&buffer[0], GetOutputSize());
+	for (ndInt32 i = 0; i < input.GetRows(); ++i)
+	{
+		MakePrediction(input[i], out);
+		output[i].Set(out);
+	}
+}
+
+void ndBrainLayer::CalculateBatchParamGradients(
+	const ndBrainMatrix& input, const ndBrainMatrix& output,
+	const ndBrainMatrix& outputDerivative, ndBrainMatrix& inputGradient, ndBrainLayer* const gradientOut) const
+{
+	ndAssert(input.GetRows() == output.GetRows());
+	ndAssert(input.GetRows() == inputGradient.GetRows());
+	ndAssert(input.GetRows() == outputDerivative.GetRows());
+
+	ndBrainLayer* rowGradient = nullptr;
+	if (gradientOut)
+	{
+		gradientOut->Clear();
+		rowGradient = gradientOut->Clone();
+	}
+
+	ndBrainVector buffer;
+	const ndInt32 bufferSize = ndMax(GetInputSize(), GetOutputBufferSize()) + 32;
+	buffer.SetCount(bufferSize * 2);
+	ndBrainMemVector out(&buffer[0], GetOutputSize());
+	ndBrainMemVector inGradient(&buffer[bufferSize], GetInputSize());
+	for (ndInt32 i = 0; i < input.GetRows(); ++i)
+	{
+		out.Set(output[i]);
+		CalculateParamGradients(input[i], out, outputDerivative[i], inGradient, rowGradient);
+		inputGradient[i].Set(inGradient);
+		if (rowGradient)
+		{
+			gradientOut->Add(*rowGradient);
+		}
+	}
+
+	if (rowGradient)
+	{
+		delete rowGradient;
+	}
+}
+
 ndBrainGpuCommand* ndBrainLayer::AssemblyGPUCommand(ndBrainGpuContext* const, ndInt32, ndInt32, ndBufferOffsetPair**)
 {
 	ndAssert(0);
@@ -45,6 +45,16 @@ class ndBrainLayer : public ndClassAlloc
 		ndArray<ndInt32> m_offsets;
 	};
 
+	// element wise activations that an inference can fuse with the linear layer before them
+	enum ndFusableActivation
+	{
+		m_noActivation,
+		m_reluActivation,
+		m_tanhActivation,
+		m_sigmoidActivation,
+		m_softmaxActivation,
+	};
+
 	ndBrainLayer();
 	ndBrainLayer(const ndBrainLayer& src);
 
@@ -53,6 +63,7 @@ class ndBrainLayer : public ndClassAlloc
 
 	virtual bool HasParameters() const;
 	virtual const char* GetLabelId() const;
+	virtual ndFusableActivation GetFusableActivation() const;
 	virtual ndInt32 GetNumberOfParameters() const;
 
 	virtual ndInt32 GetInputSize() const;
@@ -80,6 +91,14 @@ class ndBrainLayer : public ndClassAlloc
 		const ndBrainVector& input, const ndBrainVector& output, 
 		const ndBrainVector& outputDerivative, ndBrainVector& inputGradient, ndBrainLayer* const gradientOut) const;
 
+	// batched versions, each row of the matrices is one sample.
+	// gradientOut gets the sum of the gradients of all the rows.
+	// the defaults call the single sample functions row by row.
+	virtual void MakeBatchPrediction(const ndBrainMatrix& input, ndBrainMatrix& output) const;
+	virtual void CalculateBatchParamGradients(
+		const ndBrainMatrix& input, const ndBrainMatrix& output,
+		const ndBrainMatrix& outputDerivative, ndBrainMatrix& inputGradient, ndBrainLayer* const gradientOut) const;
+
 	virtual void Save(const ndBrainSave* const loadSave) const;
 	virtual void AdamUpdate(const ndBrainLayer& u, const ndBrainLayer& v, ndBrainFloat epsilon);
 	virtual void GetNumberOfParameters(ndBrainVector& parameters, ndArray<ndInt32>& offsets) const;
@@ -21,8 +21,11 @@
 
 #include "ndBrainStdafx.h"
 #include "ndBrainSaveLoad.h"
+#include "ndBrainConvolutionGemm_2d.h"
 #include "ndBrainLayerCrossCorrelation_2d.h"
 
+//#define ND_CROSS_CORRELATION_USE_SCALAR
+
 ndBrainLayerCrossCorrelation_2d::ndBrainLayerCrossCorrelation_2d(ndInt32 inputWidth, ndInt32 inputHeight, ndInt32 inputDepth, ndInt32 kernelSize, ndInt32 numberOfKernels)
 	:ndBrainLayer()
 	,m_bias()
@@ -333,6 +336,7 @@ ndBrainLayer* ndBrainLayerCrossCorrelation_2d::Load(const ndBrainLoad* const loa
 	return layer;
 }
 
+#ifdef ND_CROSS_CORRELATION_USE_SCALAR
 void ndBrainLayerCrossCorrelation_2d::MakePrediction(const ndBrainVector& input, ndBrainVector& output) const
 {
 	ndAssert(input.GetCount() == GetInputSize());
@@ -546,3 +550,30 @@ void ndBrainLayerCrossCorrelation_2d::CalculateParamGradients(
 	}
 }
 
+#else
+
+void ndBrainLayerCrossCorrelation_2d::MakePrediction(const ndBrainVector& input, ndBrainVector& output) const
+{
+	ndAssert(input.GetCount() == GetInputSize());
+	const ndBrainConvolutionGemm_2d gemm(m_inputWidth, m_inputHeight, m_inputLayers, m_kernelSize, m_outputLayers, false);
+	gemm.MakePrediction(m_kernels, m_bias, input, output);
+}
+
+void ndBrainLayerCrossCorrelation_2d::InputDerivative(const ndBrainVector&, const ndBrainVector&, ndBrainVector&) const
+{
+	ndAssert(0);
+}
+
+void ndBrainLayerCrossCorrelation_2d::CalculateParamGradients(
+	const ndBrainVector& input, const ndBrainVector&,
+	const ndBrainVector& outputDerivative, ndBrainVector& inputGradient, ndBrainLayer* const gradientOut) const
+{
+	ndAssert(!strcmp(GetLabelId(), gradientOut->GetLabelId()));
+	ndBrainLayerCrossCorrelation_2d* const gradients = (ndBrainLayerCrossCorrelation_2d*)gradientOut;
+	ndAssert(gradients->m_bias.GetCount() == m_outputLayers);
+
+	const ndBrainConvolutionGemm_2d gemm(m_inputWidth, m_inputHeight, m_inputLayers, m_kernelSize, m_outputLayers, false);
+	gemm.CalculateParamGradients(m_kernels, input, outputDerivative, inputGradient, gradients->m_kernels, gradients->m_bias);
+}
+
+#endif
@@ -319,6 +319,37 @@ void ndBrainLayerLinear::CalculateParamGradients(
 	m_weights.TransposeMul(outputDerivative, inputGradient);
 }
 
+void ndBrainLayerLinear::MakeBatchPrediction(const ndBrainMatrix& input, ndBrainMatrix& output) const
+{
+	ndAssert(input.GetRows() == output.GetRows());
+	ndAssert(input.GetColumns() == GetInputSize());
+	ndAssert(output.GetColumns() == GetOutputSize());
+
+	output.MatrixMulTranspose(input, m_weights);
+	for (ndInt32 i = output.GetRows() - 1; i >= 0; --i)
+	{
+		output[i].Add(m_bias);
+	}
+}
+
+void ndBrainLayerLinear::CalculateBatchParamGradients(
+	const ndBrainMatrix& input, const ndBrainMatrix&,
+	const ndBrainMatrix& outputDerivative, ndBrainMatrix& inputGradient, ndBrainLayer* const gradientOut) const
+{
+	ndAssert(!strcmp(GetLabelId(), gradientOut->GetLabelId()));
+	ndBrainLayerLinear* const gradients = (ndBrainLayerLinear*)gradientOut;
+	ndAssert(input.GetRows() == outputDerivative.GetRows());
+	ndAssert(gradients->m_bias.GetCount() == outputDerivative.GetColumns());
+
+	gradients->m_bias.Set(ndBrainFloat(0.0f));
+	for (ndInt32 i = outputDerivative.GetRows() - 1; i >= 0; --i)
+	{
+		gradients->m_bias.Add(outputDerivative[i]);
+	}
+	gradients->m_weights.TransposeMatrixMul(outputDerivative, input);
+	inputGradient.MatrixMul(outputDerivative, m_weights);
+}
+
 ndBrainGpuCommand* ndBrainLayerLinear::AssemblyGPUCommand(ndBrainGpuContext* const context, ndInt32 layerIndex, ndInt32 paramsCount, ndBufferOffsetPair** params)
 {
 	//ndAssert(0);
@@ -0,0 +1,526 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndBrainStdafx.h"
+#include "ndBrain.h"
+#include "ndBrainFloat8.h"
+#include "ndBrainMatrix.h"
+#include "ndBrainSaveLoad.h"
+#include "ndBrainLayerLinear.h"
+#include "ndBrainLayerLinearQuantized.h"
+
+// rows are padded with zeros to the width of the kernels, 
+// and the kernels produce four outputs at a time.
+#define D_QUANTIZED_INT8_ALIGNMENT		32
+#define D_QUANTIZED_BFLOAT16_ALIGNMENT	8
+#define D_QUANTIZED_ROW_BLOCK			4
+#define D_QUANTIZED_INT8_RANGE			127
+
+static ndUnsigned16 ndFloatToBfloat16(ndBrainFloat value)
+{
+	// round to nearest even
+	ndUnsigned32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bits += 0x7fff + ((bits >> 16) & 1);
+	return ndUnsigned16(bits >> 16);
+}
+
+static ndBrainFloat ndBfloat16ToFloat(ndUnsigned16 value)
+{
+	ndBrainFloat x;
+	const ndUnsigned32 bits = ndUnsigned32(value) << 16;
+	memcpy(&x, &bits, sizeof(x));
+	return x;
+}
+
+// symmetric quantization of one input vector, returns the scale.
+static ndBrainFloat ndQuantizeInput(const ndBrainFloat* const input, ndInt32 count, ndInt32 stride, ndInt8* const out)
+{
+	ndBrainFloat maxValue = ndBrainFloat(0.0f);
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		maxValue = ndMax(maxValue, ndAbs(input[i]));
+	}
+	const ndBrainFloat scale = (maxValue > ndBrainFloat(0.0f)) ? maxValue / ndBrainFloat(D_QUANTIZED_INT8_RANGE) : ndBrainFloat(1.0f);
+	const ndBrainFloat invScale = ndBrainFloat(1.0f) / scale;
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		const ndInt32 value = ndInt32(ndFloor(input[i] * invScale + ndBrainFloat(0.5f)));
+		out[i] = ndInt8(ndClamp(value, -D_QUANTIZED_INT8_RANGE, D_QUANTIZED_INT8_RANGE));
+	}
+	for (ndInt32 i = count; i < stride; ++i)
+	{
+		out[i] = 0;
+	}
+	return scale;
+}
+
+#ifdef D_NEWTON_USE_AVX2_OPTION
+static inline __m256i ndDotInt8(__m256i acc, const __m256i unsignedInput, const __m256i signedWeights)
+{
+	#if defined(__AVXVNNI__)
+		return _mm256_dpbusd_avx_epi32(acc, unsignedInput, signedWeights);
+	#elif defined(__AVX512VNNI__) && defined(__AVX512VL__)
+		return _mm256_dpbusd_epi32(acc, unsignedInput, signedWeights);
+	#else
+		// the products of pairs can not saturate since both values are in [-127, 127]
+		const __m256i pairs(_mm256_maddubs_epi16(unsignedInput, signedWeights));
+		return _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, _mm256_set1_epi16(1)));
+	#endif
+}
+
+static inline ndInt32 ndAddHorizontal(const __m256i acc)
+{
+	const __m128i sum4(_mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+	const __m128i sum2(_mm_add_epi32(sum4, _mm_unpackhi_epi64(sum4, sum4)));
+	const __m128i sum1(_mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, 0x55)));
+	return _mm_cvtsi128_si32(sum1);
+}
+#endif
+
+static void ndDotInt8Rows(const ndInt8* const weights, ndInt32 stride, const ndInt8* const input, ndInt32* const dot)
+{
+#ifdef D_NEWTON_USE_AVX2_OPTION
+	// the unsigned times signed instructions get the sign of 
+	// the products by moving the sign of the input to the weights.
+	__m256i acc[D_QUANTIZED_ROW_BLOCK];
+	for (ndInt32 j = 0; j < D_QUANTIZED_ROW_BLOCK; ++j)
+	{
+		acc[j] = _mm256_setzero_si256();
+	}
+	for (ndInt32 i = 0; i < stride; i += D_QUANTIZED_INT8_ALIGNMENT)
+	{
+		const __m256i x(_mm256_loadu_si256((__m256i*)&input[i]));
+		const __m256i absX(_mm256_abs_epi8(x));
+		for (ndInt32 j = 0; j < D_QUANTIZED_ROW_BLOCK; ++j)
+		{
+			const __m256i w(_mm256_loadu_si256((__m256i*)&weights[j * stride + i]));
+			acc[j] = ndDotInt8(acc[j], absX, _mm256_sign_epi8(w, x));
+		}
+	}
+	for (ndInt32 j = 0; j < D_QUANTIZED_ROW_BLOCK; ++j)
+	{
+		dot[j] = ndAddHorizontal(acc[j]);
+	}
+#else
+	for (ndInt32 j = 0; j < D_QUANTIZED_ROW_BLOCK; ++j)
+	{
+		ndInt32 acc = 0;
+		const ndInt8* const row = &weights[j * stride];
+		for (ndInt32 i = 0; i < stride; ++i)
+		{
+			acc += ndInt32(row[i]) * ndInt32(input[i]);
+		}
+		dot[j] = acc;
+	}
+#endif
+}
+
+static void ndDotBfloat16Rows(const ndUnsigned16* const weights, ndInt32 stride, const ndBrainFloat* const input, ndBrainFloat* const dot)
+{
+#ifdef D_NEWTON_USE_AVX2_OPTION
+	ndBrainFloat8 acc[D_QUANTIZED_ROW_BLOCK];
+	for (ndInt32 j = 0; j < D_QUANTIZED_ROW_BLOCK; ++j)
+	{
+		acc[j] = ndBrainFloat8(ndBrainFloat(0.0f));
+	}
+	for (ndInt32 i = 0; i < stride; i += D_QUANTIZED_BFLOAT16_ALIGNMENT)
+	{
+		const ndBrainFloat8 x(&input[i]);
+		for (ndInt32 j = 0; j < D_QUANTIZED_ROW_BLOCK; ++j)
+		{
+			// a bfloat16 is the upper half of a float
+			const __m256i w(_mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i*)&weights[j * stride + i])));
+			acc[j] = acc[j].MulAdd(ndBrainFloat8(_mm256_castsi256_ps(_mm256_slli_epi32(w, 16))), x);
+		}
+	}
+	for (ndInt32 j = 0; j < D_QUANTIZED_ROW_BLOCK; ++j)
+	{
+		dot[j] = acc[j].AddHorizontal();
+	}
+#else
+	for (ndInt32 j = 0; j < D_QUANTIZED_ROW_BLOCK; ++j)
+	{
+		ndBrainFloat acc = ndBrainFloat(0.0f);
+		const ndUnsigned16* const row = &weights[j * stride];
+		for (ndInt32 i = 0; i < stride; ++i)
+		{
+			acc += ndBfloat16ToFloat(row[i]) * input[i];
+		}
+		dot[j] = acc;
+	}
+#endif
+}
+
+ndBrainLayerLinearQuantized::ndBrainLayerLinearQuantized(ndInt32 inputs, ndInt32 outputs, ndType type)
+	:ndBrainLayer()
+	,m_bias()
+	,m_scale()
+	,m_int8Weights()
+	,m_bfloat16Weights()
+	,m_inputs(inputs)
+	,m_outputs(outputs)
+	,m_stride(0)
+	,m_type(type)
+{
+	const ndInt32 rows = (outputs + D_QUANTIZED_ROW_BLOCK - 1) & -D_QUANTIZED_ROW_BLOCK;
+	m_bias.SetCount(outputs);
+	m_scale.SetCount(outputs);
+	m_bias.Set(ndBrainFloat(0.0f));
+	m_scale.Set(ndBrainFloat(1.0f));
+	if (m_type == m_int8)
+	{
+		m_stride = (inputs + D_QUANTIZED_INT8_ALIGNMENT - 1) & -D_QUANTIZED_INT8_ALIGNMENT;
+		m_int8Weights.SetCount(rows * m_stride);
+		for (ndInt32 i = 0; i < m_int8Weights.GetCount(); ++i)
+		{
+			m_int8Weights[i] = 0;
+		}
+	}
+	else
+	{
+		m_stride = (inputs + D_QUANTIZED_BFLOAT16_ALIGNMENT - 1) & -D_QUANTIZED_BFLOAT16_ALIGNMENT;
+		m_bfloat16Weights.SetCount(rows * m_stride);
+		for (ndInt32 i = 0; i < m_bfloat16Weights.GetCount(); ++i)
+		{
+			m_bfloat16Weights[i] = 0;
+		}
+	}
+}
+
+ndBrainLayerLinearQuantized::ndBrainLayerLinearQuantized(const ndBrainLayerLinear& src, ndType type)
+	:ndBrainLayerLinearQuantized(src.GetInputSize(), src.GetOutputSize(), type)
+{
+	SetWeights(src);
+}
+
+ndBrainLayerLinearQuantized::ndBrainLayerLinearQuantized(const ndBrainLayerLinearQuantized& src)
+	:ndBrainLayer(src)
+	,m_bias(src.m_bias)
+	,m_scale(src.m_scale)
+	,m_int8Weights(src.m_int8Weights)
+	,m_bfloat16Weights(src.m_bfloat16Weights)
+	,m_inputs(src.m_inputs)
+	,m_outputs(src.m_outputs)
+	,m_stride(src.m_stride)
+	,m_type(src.m_type)
+{
+}
+
+ndBrainLayerLinearQuantized::~ndBrainLayerLinearQuantized()
+{
+}
+
+const char* ndBrainLayerLinearQuantized::GetLabelId() const
+{
+	return "ndBrainLayerLinearQuantized";
+}
+
+ndBrainLayer* ndBrainLayerLinearQuantized::Clone() const
+{
+	return new ndBrainLayerLinearQuantized(*this);
+}
+
+bool ndBrainLayerLinearQuantized::HasParameters() const
+{
+	return false;
+}
+
+ndInt32 ndBrainLayerLinearQuantized::GetOutputSize() const
+{
+	return m_outputs;
+}
+
+ndInt32 ndBrainLayerLinearQuantized::GetInputSize() const
+{
+	return m_inputs;
+}
+
+ndInt32 ndBrainLayerLinearQuantized::GetNumberOfParameters() const
+{
+	return m_outputs + m_inputs * m_outputs;
+}
+
+void ndBrainLayerLinearQuantized::SetWeights(const ndBrainLayerLinear& src)
+{
+	ndBrainLayerLinear& linear = (ndBrainLayerLinear&)src;
+	const ndBrainMatrix& weights = *linear.GetWeights();
+	m_bias.Set(*linear.GetBias());
+
+	for (ndInt32 i = 0; i < m_outputs; ++i)
+	{
+		const ndBrainVector& row = weights[i];
+		if (m_type == m_int8)
+		{
+			ndBrainFloat maxValue = ndBrainFloat(0.0f);
+			for (ndInt32 j = 0; j < m_inputs; ++j)
+			{
+				maxValue = ndMax(maxValue, ndAbs(row[j]));
+			}
+			const ndBrainFloat scale = (maxValue > ndBrainFloat(0.0f)) ? maxValue / ndBrainFloat(D_QUANTIZED_INT8_RANGE) : ndBrainFloat(1.0f);
+			const ndBrainFloat invScale = ndBrainFloat(1.0f) / scale;
+
+			m_scale[i] = scale;
+			ndInt8* const dst = &m_int8Weights[i * m_stride];
+			for (ndInt32 j = 0; j < m_inputs; ++j)
+			{
+				const ndInt32 value = ndInt32(ndFloor(row[j] * invScale + ndBrainFloat(0.5f)));
+				dst[j] = ndInt8(ndClamp(value, -D_QUANTIZED_INT8_RANGE, D_QUANTIZED_INT8_RANGE));
+			}
+		}
+		else
+		{
+			ndUnsigned16* const dst = &m_bfloat16Weights[i * m_stride];
+			for (ndInt32 j = 0; j < m_inputs; ++j)
+			{
+				dst[j] = ndFloatToBfloat16(row[j]);
+			}
+		}
+	}
+}
+
+void ndBrainLayerLinearQuantized::Quantize(ndBrain& brain, ndType type)
+{
+	// drop out is an identity at inference time
+	for (ndInt32 i = 0; i < brain.GetCount(); ++i)
+	{
+		ndBrainLayer* const layer = brain[i];
+		const char* const label = layer->GetLabelId();
+		if (!strcmp(label, "ndBrainLayerLinear") || !strcmp(label, "ndBrainLayerLinearWithDropOut"))
+		{
+			brain[i] = new ndBrainLayerLinearQuantized(*((ndBrainLayerLinear*)layer), type);
+			delete layer;
+		}
+	}
+}
+
+void ndBrainLayerLinearQuantized::PredictionInt8(const ndBrainFloat* const input, ndInt8* const quantizedInput, ndBrainFloat* const output) const
+{
+	const ndBrainFloat inputScale = ndQuantizeInput(input, m_inputs, m_stride, quantizedInput);
+	for (ndInt32 i = 0; i < m_outputs; i += D_QUANTIZED_ROW_BLOCK)
+	{
+		ndInt32 dot[D_QUANTIZED_ROW_BLOCK];
+		ndDotInt8Rows(&m_int8Weights[i * m_stride], m_stride, quantizedInput, dot);
+		const ndInt32 count = ndMin(D_QUANTIZED_ROW_BLOCK, m_outputs - i);
+		for (ndInt32 j = 0; j < count; ++j)
+		{
+			output[i + j] = ndBrainFloat(dot[j]) * m_scale[i + j] * inputScale + m_bias[i + j];
+		}
+	}
+}
+
+void ndBrainLayerLinearQuantized::PredictionBfloat16(const ndBrainFloat* const input, ndBrainFloat* const paddedInput, ndBrainFloat* const output) const
+{
+	for (ndInt32 i = 0; i < m_inputs; ++i)
+	{
+		paddedInput[i] = input[i];
+	}
+	for (ndInt32 i = m_inputs; i < m_stride; ++i)
+	{
+		paddedInput[i] = ndBrainFloat(0.0f);
+	}
+	for (ndInt32 i = 0; i < m_outputs; i += D_QUANTIZED_ROW_BLOCK)
+	{
+		ndBrainFloat dot[D_QUANTIZED_ROW_BLOCK];
+		ndDotBfloat16Rows(&m_bfloat16Weights[i * m_stride], m_stride, paddedInput, dot);
+		const ndInt32 count = ndMin(D_QUANTIZED_ROW_BLOCK, m_outputs - i);
+		for (ndInt32 j = 0; j < count; ++j)
+		{
+			output[i + j] = dot[j] + m_bias[i + j];
+		}
+	}
+}
+
+void ndBrainLayerLinearQuantized::MakePrediction(const ndBrainVector& input, ndBrainVector& output) const
+{
+	ndAssert(input.GetCount() == m_inputs);
+	ndAssert(output.GetCount() == m_outputs);
+	if (m_type == m_int8)
+	{
+		ndInt8* const quantizedInput = ndAlloca(ndInt8, m_stride);
+		PredictionInt8(&input[0], quantizedInput, &output[0]);
+	}
+	else
+	{
+		ndBrainFloat* const paddedInput = ndAlloca(ndBrainFloat, m_stride);
+		PredictionBfloat16(&input[0], paddedInput, &output[0]);
+	}
+}
+
+void ndBrainLayerLinearQuantized::MakeBatchPrediction(const ndBrainMatrix& input, ndBrainMatrix& output) const
+{
+	ndAssert(input.GetRows() == output.GetRows());
+	ndAssert(input.GetColumns() == m_inputs);
+	ndAssert(output.GetColumns() == m_outputs);
+
+	// the inputs are converted once, and each block of 
+	// weight rows is used for the whole batch before the next.
+	const ndInt32 batchSize = input.GetRows();
+	if (m_type == m_int8)
+	{
+		ndBrainVector inputScale;
+		ndArray<ndInt8> quantizedInput;
+		inputScale.SetCount(batchSize);
+		quantizedInput.SetCount(batchSize * m_stride);
+		for (ndInt32 k = 0; k < batchSize; ++k)
+		{
+			inputScale[k] = ndQuantizeInput(&input[k][0], m_inputs, m_stride, &quantizedInput[k * m_stride]);
+		}
+
+		for (ndInt32 i = 0; i < m_outputs; i += D_QUANTIZED_ROW_BLOCK)
+		{
+			const ndInt8* const weights = &m_int8Weights[i * m_stride];
+			const ndInt32 count = ndMin(D_QUANTIZED_ROW_BLOCK, m_outputs - i);
+			for (ndInt32 k = 0; k < batchSize; ++k)
+			{
+				ndInt32 dot[D_QUANTIZED_ROW_BLOCK];
+				ndDotInt8Rows(weights, m_stride, &quantizedInput[k * m_stride], dot);
+				ndBrainVector& out = output[k];
+				for (ndInt32 j = 0; j < count; ++j)
+				{
+					out[i + j] = ndBrainFloat(dot[j]) * m_scale[i + j] * inputScale[k] + m_bias[i + j];
+				}
+			}
+		}
+	}
+	else
+	{
+		ndBrainVector paddedInput;
+		paddedInput.SetCount(batchSize * m_stride);
+		paddedInput.Set(ndBrainFloat(0.0f));
+		for (ndInt32 k = 0; k < batchSize; ++k)
+		{
+			const ndBrainVector& src = input[k];
+			for (ndInt32 j = 0; j < m_inputs; ++j)
+			{
+				paddedInput[k * m_stride + j] = src[j];
+			}
+		}
+
+		for (ndInt32 i = 0; i < m_outputs; i += D_QUANTIZED_ROW_BLOCK)
+		{
+			const ndUnsigned16* const weights = &m_bfloat16Weights[i * m_stride];
+			const ndInt32 count = ndMin(D_QUANTIZED_ROW_BLOCK, m_outputs - i);
+			for (ndInt32 k = 0; k < batchSize; ++k)
+			{
+				ndBrainFloat dot[D_QUANTIZED_ROW_BLOCK];
+				ndDotBfloat16Rows(weights, m_stride, &paddedInput[k * m_stride], dot);
+				ndBrainVector& out = output[k];
+				for (ndInt32 j = 0; j < count; ++j)
+				{
+					out[i + j] = dot[j] + m_bias[i + j];
+				}
+			}
+		}
+	}
+}
+
+void ndBrainLayerLinearQuantized::Save(const ndBrainSave* const loadSave) const
+{
+	char buffer[1024];
+	auto Save = [this, &buffer, &loadSave](const char* const fmt, ...)
+	{
+		va_list v_args;
+		buffer[0] = 0;
+		va_start(v_args, fmt);
+		vsnprintf(buffer, sizeof(buffer), fmt, v_args);
+		va_end(v_args);
+		loadSave->WriteData(buffer);
+	};
+
+	Save("\tinputs %d\n", m_inputs);
+	Save("\toutputs %d\n", m_outputs);
+	Save("\ttype %d\n", ndInt32(m_type));
+
+	Save("\tbias ");
+	for (ndInt32 i = 0; i < m_outputs; ++i)
+	{
+		Save("%g ", m_bias[i]);
+	}
+	Save("\n");
+
+	Save("\tscale ");
+	for (ndInt32 i = 0; i < m_outputs; ++i)
+	{
+		Save("%g ", m_scale[i]);
+	}
+	Save("\n");
+
+	// the quantized values are saved as integers
+	Save("\tweights\n");
+	for (ndInt32 i = 0; i < m_outputs; ++i)
+	{
+		Save("\t\trow_%d ", i);
+		for (ndInt32 j = 0; j < m_inputs; ++j)
+		{
+			const ndInt32 value = (m_type == m_int8) ? ndInt32(m_int8Weights[i * m_stride + j]) : ndInt32(m_bfloat16Weights[i * m_stride + j]);
+			Save("%d ", value);
+		}
+		Save("\n");
+	}
+}
+
+ndBrainLayer* ndBrainLayerLinearQuantized::Load(const ndBrainLoad* const loadSave)
+{
+	char buffer[1024];
+	loadSave->ReadString(buffer);
+
+	loadSave->ReadString(buffer);
+	ndInt32 inputs = loadSave->ReadInt();
+	loadSave->ReadString(buffer);
+	ndInt32 outputs = loadSave->ReadInt();
+	loadSave->ReadString(buffer);
+	ndType type = ndType(loadSave->ReadInt());
+	ndBrainLayerLinearQuantized* const layer = new ndBrainLayerLinearQuantized(inputs, outputs, type);
+
+	loadSave->ReadString(buffer);
+	for (ndInt32 i = 0; i < outputs; ++i)
+	{
+		layer->m_bias[i] = ndBrainFloat(loadSave->ReadFloat());
+	}
+
+	loadSave->ReadString(buffer);
+	for (ndInt32 i = 0; i < outputs; ++i)
+	{
+		layer->m_scale[i] = ndBrainFloat(loadSave->ReadFloat());
+	}
+
+	loadSave->ReadString(buffer);
+	for (ndInt32 i = 0; i < outputs; ++i)
+	{
+		loadSave->ReadString(buffer);
+		for (ndInt32 j = 0; j < inputs; ++j)
+		{
+			const ndInt32 value = loadSave->ReadInt();
+			if (type == m_int8)
+			{
+				layer->m_int8Weights[i * layer->m_stride + j] = ndInt8(value);
+			}
+			else
+			{
+				layer->m_bfloat16Weights[i * layer->m_stride + j] = ndUnsigned16(value);
+			}
+		}
+	}
+
+	loadSave->ReadString(buffer);
+	return layer;
+}
@@ -0,0 +1,90 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef _ND_BRAIN_LAYER_LINEAR_QUANTIZED_H__
+#define _ND_BRAIN_LAYER_LINEAR_QUANTIZED_H__
+
+#include "ndBrainStdafx.h"
+#include "ndBrainLayer.h"
+#include "ndBrainVector.h"
+
+class ndBrain;
+class ndBrainLayerLinear;
+
+// inference only copy of a trained linear layer with low precision weights.
+// int8 weights have one scale per row and the input is quantized on the fly,
+// bfloat16 weights are the upper half of the float weights.
+class ndBrainLayerLinearQuantized : public ndBrainLayer
+{
+	public: 
+	enum ndType
+	{
+		m_int8,
+		m_bfloat16,
+	};
+
+	ndBrainLayerLinearQuantized(const ndBrainLayerLinear& src, ndType type);
+	ndBrainLayerLinearQuantized(const ndBrainLayerLinearQuantized& src);
+	virtual ~ndBrainLayerLinearQuantized();
+	virtual ndBrainLayer* Clone() const;
+
+	virtual bool HasParameters() const;
+	virtual ndInt32 GetOutputSize() const;
+	virtual ndInt32 GetInputSize() const;
+	virtual const char* GetLabelId() const;
+	virtual ndInt32 GetNumberOfParameters() const;
+
+	virtual void MakePrediction(const ndBrainVector& input, ndBrainVector& output) const;
+	virtual void MakeBatchPrediction(const ndBrainMatrix& input, ndBrainMatrix& output) const;
+
+	virtual void Save(const ndBrainSave* const loadSave) const;
+	static ndBrainLayer* Load(const ndBrainLoad* const loadSave);
+
+	ndType GetType() const;
+
+	// replaces the linear layers of a trained brain, 
+	// the brain can not be trained after this.
+	static void Quantize(ndBrain& brain, ndType type);
+
+	private:
+	ndBrainLayerLinearQuantized(ndInt32 inputs, ndInt32 outputs, ndType type);
+	void SetWeights(const ndBrainLayerLinear& src);
+
+	void PredictionInt8(const ndBrainFloat* const input, ndInt8* const quantizedInput, ndBrainFloat* const output) const;
+	void PredictionBfloat16(const ndBrainFloat* const input, ndBrainFloat* const paddedInput, ndBrainFloat* const output) const;
+
+	ndBrainVector m_bias;
+	ndBrainVector m_scale;
+	ndArray<ndInt8> m_int8Weights;
+	ndArray<ndUnsigned16> m_bfloat16Weights;
+	ndInt32 m_inputs;
+	ndInt32 m_outputs;
+	ndInt32 m_stride;
+	ndType m_type;
+};
+
+inline ndBrainLayerLinearQuantized::ndType ndBrainLayerLinearQuantized::GetType() const
+{
+	return m_type;
+}
+
+#endif 
+
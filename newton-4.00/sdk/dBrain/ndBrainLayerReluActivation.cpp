@@ -43,6 +43,11 @@ const char* ndBrainLayerReluActivation::GetLabelId() const
 	return "ndBrainLayerReluActivation";
 }
 
+ndBrainLayer::ndFusableActivation ndBrainLayerReluActivation::GetFusableActivation() const
+{
+	return m_reluActivation;
+}
+
 ndBrainLayer* ndBrainLayerReluActivation::Load(const ndBrainLoad* const loadSave)
 {
 	char buffer[1024];
@@ -42,6 +42,11 @@ const char* ndBrainLayerSigmoidActivation::GetLabelId() const
 	return "ndBrainLayerSigmoidActivation";
 }
 
+ndBrainLayer::ndFusableActivation ndBrainLayerSigmoidActivation::GetFusableActivation() const
+{
+	return m_sigmoidActivation;
+}
+
 ndBrainLayer* ndBrainLayerSigmoidActivation::Load(const ndBrainLoad* const loadSave)
 {
 	char buffer[1024];
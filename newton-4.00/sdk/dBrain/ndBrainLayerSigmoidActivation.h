@@ -35,6 +35,7 @@ class ndBrainLayerSigmoidActivation : public ndBrainLayerActivation
 	static ndBrainLayer* Load(const ndBrainLoad* const loadSave);
 
 	const char* GetLabelId() const;
+	ndFusableActivation GetFusableActivation() const;
 	void MakePrediction(const ndBrainVector& input, ndBrainVector& output) const;
 	void InputDerivative(const ndBrainVector& output, const ndBrainVector& outputDerivative, ndBrainVector& inputDerivative) const;
 };
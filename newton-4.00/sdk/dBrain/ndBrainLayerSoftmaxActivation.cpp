@@ -43,6 +43,11 @@ const char* ndBrainLayerSoftmaxActivation::GetLabelId() const
 	return "ndBrainLayerSoftmaxActivation";
 }
 
+ndBrainLayer::ndFusableActivation ndBrainLayerSoftmaxActivation::GetFusableActivation() const
+{
+	return m_softmaxActivation;
+}
+
 ndBrainLayer* ndBrainLayerSoftmaxActivation::Load(const ndBrainLoad* const loadSave)
 {
 	char buffer[1024];
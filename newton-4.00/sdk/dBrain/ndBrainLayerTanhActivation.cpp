@@ -49,6 +49,11 @@ const char* ndBrainLayerTanhActivation::GetLabelId() const
 	return "ndBrainLayerTanhActivation";
 }
 
+ndBrainLayer::ndFusableActivation ndBrainLayerTanhActivation::GetFusableActivation() const
+{
+	return m_tanhActivation;
+}
+
 ndBrainLayer* ndBrainLayerTanhActivation::Load(const ndBrainLoad* const loadSave)
 {
 	char buffer[1024];
@@ -114,6 +119,11 @@ const char* ndBrainLayerApproximateTanhActivation::GetLabelId() const
 	return "ndBrainLayerApproximateTanhActivation";
 }
 
+ndBrainLayer::ndFusableActivation ndBrainLayerApproximateTanhActivation::GetFusableActivation() const
+{
+	return m_noActivation;
+}
+
 void ndBrainLayerApproximateTanhActivation::MakePrediction(const ndBrainVector& input, ndBrainVector& output) const
 {
 	// rational approximation of tanh, approximation 4 time faster that standard tanh.
@@ -36,6 +36,7 @@ class ndBrainLayerTanhActivation : public ndBrainLayerActivation
 	static ndBrainLayer* Load(const ndBrainLoad* const loadSave);
 
 	const char* GetLabelId() const;
+	ndFusableActivation GetFusableActivation() const;
 	void MakePrediction(const ndBrainVector& input, ndBrainVector& output) const;
 	void InputDerivative(const ndBrainVector& output, const ndBrainVector& outputDerivative, ndBrainVector& inputDerivative) const;
 };
@@ -49,6 +50,7 @@ class ndBrainLayerApproximateTanhActivation : public ndBrainLayerTanhActivation
 	static ndBrainLayer* Load(const ndBrainLoad* const loadSave);
 
 	const char* GetLabelId() const;
+	ndFusableActivation GetFusableActivation() const;
 	void MakePrediction(const ndBrainVector& input, ndBrainVector& output) const;
 
 	static ndBrainVector4 m_c1;
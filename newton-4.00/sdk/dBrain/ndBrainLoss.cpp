@@ -30,3 +30,8 @@ ndBrainLoss::ndBrainLoss()
 ndBrainLoss::~ndBrainLoss() 
 {
 }
+
+void ndBrainLoss::SetTruth(const ndBrainVector&)
+{
+	ndAssert(0);
+}
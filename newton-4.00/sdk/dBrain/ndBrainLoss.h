@@ -33,6 +33,10 @@ class ndBrainLoss : public ndClassAlloc
 	virtual ~ndBrainLoss();
 	virtual void GetLoss(const ndBrainVector& output, ndBrainVector& loss) = 0;
 
+	// only needed by losses used for batch training, 
+	// the trainer sets the truth of each row before calling GetLoss.
+	virtual void SetTruth(const ndBrainVector& truth);
+
 	virtual bool IsCategorical() const;
 };
 
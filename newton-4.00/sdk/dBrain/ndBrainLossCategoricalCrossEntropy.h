@@ -37,7 +37,7 @@ class ndBrainLossCategoricalCrossEntropy: public ndBrainLoss
 {
 	public:
 	ndBrainLossCategoricalCrossEntropy(ndInt32 size);
-	void SetTruth(const ndBrainVector& truth);
+	virtual void SetTruth(const ndBrainVector& truth);
 	virtual void GetLoss(const ndBrainVector& output, ndBrainVector& loss);
 
 	virtual bool IsCategorical() const;
@@ -30,7 +30,7 @@ class ndBrainLossLeastSquaredError: public ndBrainLoss
 {
 	public:
 	ndBrainLossLeastSquaredError(ndInt32 size);
-	void SetTruth(const ndBrainVector& truth);
+	virtual void SetTruth(const ndBrainVector& truth);
 	virtual void GetLoss(const ndBrainVector& output, ndBrainVector& loss);
 
 	ndBrainVector m_truth;
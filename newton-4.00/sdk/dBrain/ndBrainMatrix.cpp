@@ -20,9 +20,17 @@
 */
 
 #include "ndBrainStdafx.h"
+#include "ndBrainFloat8.h"
 #include "ndBrainMatrix.h"
 
-#define D_BRAIN_MATRIX_ALIGNMENT 16
+#define D_BRAIN_MATRIX_ALIGNMENT	16
+
+// cache blocking of the matrix products, a panel of D_BRAIN_GEMM_BLOCK_K rows 
+// by D_BRAIN_GEMM_BLOCK_N columns of the right matrix stays in the L2 cache
+// while all the rows of the left matrix are accumulated against it.
+#define D_BRAIN_GEMM_BLOCK_K	128
+#define D_BRAIN_GEMM_BLOCK_N	256
+#define D_BRAIN_GEMM_BLOCK_DOT	32
 
 ndBrainMatrix::ndBrainMatrix()
 	:ndArray<ndBrainMemVector>()
@@ -62,6 +70,18 @@ ndBrainMatrix::~ndBrainMatrix()
 
 void ndBrainMatrix::Init(ndInt32 rows, ndInt32 columns)
 {
+	if (m_memory)
+	{
+		ndBrainMatrix& me = *this;
+		for (ndInt32 i = GetCount() - 1; i >= 0; --i)
+		{
+			ndBrainMemVector& row = me[i];
+			row.~ndBrainMemVector();
+		}
+		ndMemory::Free(m_memory);
+		m_memory = nullptr;
+	}
+
 	m_size = rows;
 	m_capacity = rows + 1;
 
@@ -211,4 +231,299 @@ void ndBrainMatrix::TransposeMul(const ndBrainVector& input, ndBrainVector& outp
 		const ndBrainVector& row = me[j];
 		output.ScaleAdd(row, scale);
 	}
-}
\ No newline at end of file
+}
+
+ndInt32 ndBrainMatrix::GetRowStride() const
+{
+	// measured from the rows, a matrix can have rows pointing to memory it does not own
+	const ndBrainMatrix& me = *this;
+	if ((GetCount() > 1) && me[0].GetCount())
+	{
+		return ndInt32(&me[1][0] - &me[0][0]);
+	}
+	return ((ndInt32(GetColumns() * sizeof(ndBrainFloat)) + D_BRAIN_MATRIX_ALIGNMENT - 1) & -D_BRAIN_MATRIX_ALIGNMENT) / ndInt32(sizeof(ndBrainFloat));
+}
+
+// c = sum(p) a(i, p) * b[p], for the columns [j0, j1) of the rows [i0, i0 + 4) of c, and the rows [p0, p1) of b.
+// a(i, p) = a[i * aRowStride + p * aColStride], so that the same kernel does a * b and transpose(a) * b.
+static void ndGemmKernel_4xN(ndBrainMatrix& c, const ndBrainFloat* const a, ndInt32 aRowStride, ndInt32 aColStride, const ndBrainMatrix& b, ndInt32 i0, ndInt32 p0, ndInt32 p1, ndInt32 j0, ndInt32 j1)
+{
+	ndBrainFloat* const c0 = &c[i0 + 0][0];
+	ndBrainFloat* const c1 = &c[i0 + 1][0];
+	ndBrainFloat* const c2 = &c[i0 + 2][0];
+	ndBrainFloat* const c3 = &c[i0 + 3][0];
+	const ndBrainFloat* const a0 = &a[(i0 + 0) * aRowStride];
+	const ndBrainFloat* const a1 = &a[(i0 + 1) * aRowStride];
+	const ndBrainFloat* const a2 = &a[(i0 + 2) * aRowStride];
+	const ndBrainFloat* const a3 = &a[(i0 + 3) * aRowStride];
+
+	ndInt32 j = j0;
+	for (; (j + 16) <= j1; j += 16)
+	{
+		ndBrainFloat8 acc00(&c0[j]);
+		ndBrainFloat8 acc01(&c0[j + 8]);
+		ndBrainFloat8 acc10(&c1[j]);
+		ndBrainFloat8 acc11(&c1[j + 8]);
+		ndBrainFloat8 acc20(&c2[j]);
+		ndBrainFloat8 acc21(&c2[j + 8]);
+		ndBrainFloat8 acc30(&c3[j]);
+		ndBrainFloat8 acc31(&c3[j + 8]);
+		for (ndInt32 p = p0; p < p1; ++p)
+		{
+			const ndBrainFloat* const row = &b[p][j];
+			const ndBrainFloat8 b0(row);
+			const ndBrainFloat8 b1(&row[8]);
+			const ndInt32 index = p * aColStride;
+			const ndBrainFloat8 s0(a0[index]);
+			const ndBrainFloat8 s1(a1[index]);
+			const ndBrainFloat8 s2(a2[index]);
+			const ndBrainFloat8 s3(a3[index]);
+			acc00 = acc00.MulAdd(s0, b0);
+			acc01 = acc01.MulAdd(s0, b1);
+			acc10 = acc10.MulAdd(s1, b0);
+			acc11 = acc11.MulAdd(s1, b1);
+			acc20 = acc20.MulAdd(s2, b0);
+			acc21 = acc21.MulAdd(s2, b1);
+			acc30 = acc30.MulAdd(s3, b0);
+			acc31 = acc31.MulAdd(s3, b1);
+		}
+		acc00.Store(&c0[j]);
+		acc01.Store(&c0[j + 8]);
+		acc10.Store(&c1[j]);
+		acc11.Store(&c1[j + 8]);
+		acc20.Store(&c2[j]);
+		acc21.Store(&c2[j + 8]);
+		acc30.Store(&c3[j]);
+		acc31.Store(&c3[j + 8]);
+	}
+
+	for (; (j + 8) <= j1; j += 8)
+	{
+		ndBrainFloat8 acc0(&c0[j]);
+		ndBrainFloat8 acc1(&c1[j]);
+		ndBrainFloat8 acc2(&c2[j]);
+		ndBrainFloat8 acc3(&c3[j]);
+		for (ndInt32 p = p0; p < p1; ++p)
+		{
+			const ndBrainFloat8 b0(&b[p][j]);
+			const ndInt32 index = p * aColStride;
+			acc0 = acc0.MulAdd(ndBrainFloat8(a0[index]), b0);
+			acc1 = acc1.MulAdd(ndBrainFloat8(a1[index]), b0);
+			acc2 = acc2.MulAdd(ndBrainFloat8(a2[index]), b0);
+			acc3 = acc3.MulAdd(ndBrainFloat8(a3[index]), b0);
+		}
+		acc0.Store(&c0[j]);
+		acc1.Store(&c1[j]);
+		acc2.Store(&c2[j]);
+		acc3.Store(&c3[j]);
+	}
+
+	// the rows are only padded to four floats, the tail can not be read eight wide
+	for (; j < j1; ++j)
+	{
+		ndBrainFloat acc0 = c0[j];
+		ndBrainFloat acc1 = c1[j];
+		ndBrainFloat acc2 = c2[j];
+		ndBrainFloat acc3 = c3[j];
+		for (ndInt32 p = p0; p < p1; ++p)
+		{
+			const ndBrainFloat b0 = b[p][j];
+			const ndInt32 index = p * aColStride;
+			acc0 += a0[index] * b0;
+			acc1 += a1[index] * b0;
+			acc2 += a2[index] * b0;
+			acc3 += a3[index] * b0;
+		}
+		c0[j] = acc0;
+		c1[j] = acc1;
+		c2[j] = acc2;
+		c3[j] = acc3;
+	}
+}
+
+static void ndGemmKernel_1xN(ndBrainMatrix& c, const ndBrainFloat* const a, ndInt32 aRowStride, ndInt32 aColStride, const ndBrainMatrix& b, ndInt32 i0, ndInt32 p0, ndInt32 p1, ndInt32 j0, ndInt32 j1)
+{
+	ndBrainFloat* const c0 = &c[i0][0];
+	const ndBrainFloat* const a0 = &a[i0 * aRowStride];
+
+	ndInt32 j = j0;
+	for (; (j + 8) <= j1; j += 8)
+	{
+		ndBrainFloat8 acc0(&c0[j]);
+		for (ndInt32 p = p0; p < p1; ++p)
+		{
+			acc0 = acc0.MulAdd(ndBrainFloat8(a0[p * aColStride]), ndBrainFloat8(&b[p][j]));
+		}
+		acc0.Store(&c0[j]);
+	}
+	for (; j < j1; ++j)
+	{
+		ndBrainFloat acc0 = c0[j];
+		for (ndInt32 p = p0; p < p1; ++p)
+		{
+			acc0 += a0[p * aColStride] * b[p][j];
+		}
+		c0[j] = acc0;
+	}
+}
+
+static void ndGemm(ndBrainMatrix& c, const ndBrainFloat* const a, ndInt32 aRowStride, ndInt32 aColStride, const ndBrainMatrix& b)
+{
+	const ndInt32 rows = c.GetRows();
+	const ndInt32 columns = c.GetColumns();
+	const ndInt32 depth = b.GetRows();
+	for (ndInt32 p0 = 0; p0 < depth; p0 += D_BRAIN_GEMM_BLOCK_K)
+	{
+		const ndInt32 p1 = ndMin(p0 + D_BRAIN_GEMM_BLOCK_K, depth);
+		for (ndInt32 j0 = 0; j0 < columns; j0 += D_BRAIN_GEMM_BLOCK_N)
+		{
+			const ndInt32 j1 = ndMin(j0 + D_BRAIN_GEMM_BLOCK_N, columns);
+			ndInt32 i = 0;
+			for (; (i + 4) <= rows; i += 4)
+			{
+				ndGemmKernel_4xN(c, a, aRowStride, aColStride, b, i, p0, p1, j0, j1);
+			}
+			for (; i < rows; ++i)
+			{
+				ndGemmKernel_1xN(c, a, aRowStride, aColStride, b, i, p0, p1, j0, j1);
+			}
+		}
+	}
+}
+
+void ndBrainMatrix::MatrixMul(const ndBrainMatrix& a, const ndBrainMatrix& b)
+{
+	ndAssert(a.GetColumns() == b.GetRows());
+	ndAssert(a.GetRows() == GetRows());
+	ndAssert(b.GetColumns() == GetColumns());
+	if (!GetRows() || !GetColumns())
+	{
+		return;
+	}
+	Set(ndBrainFloat(0.0f));
+	if (b.GetRows())
+	{
+		ndGemm(*this, &a[0][0], a.GetRowStride(), 1, b);
+	}
+}
+
+void ndBrainMatrix::TransposeMatrixMul(const ndBrainMatrix& a, const ndBrainMatrix& b)
+{
+	ndAssert(a.GetRows() == b.GetRows());
+	ndAssert(a.GetColumns() == GetRows());
+	ndAssert(b.GetColumns() == GetColumns());
+	if (!GetRows() || !GetColumns())
+	{
+		return;
+	}
+	Set(ndBrainFloat(0.0f));
+	if (b.GetRows())
+	{
+		ndGemm(*this, &a[0][0], 1, a.GetRowStride(), b);
+	}
+}
+
+void ndBrainMatrix::MatrixMulTranspose(const ndBrainMatrix& a, const ndBrainMatrix& b)
+{
+	ndAssert(a.GetColumns() == b.GetColumns());
+	ndAssert(a.GetRows() == GetRows());
+	ndAssert(b.GetRows() == GetColumns());
+	if (!GetRows() || !GetColumns())
+	{
+		return;
+	}
+
+	// each entry is the dot product of a row of a and a row of b, the rows of b 
+	// are visited in blocks so that they stay in cache for all the rows of a.
+	ndBrainMatrix& c = *this;
+	const ndInt32 rows = GetRows();
+	const ndInt32 columns = GetColumns();
+	const ndInt32 depth = a.GetColumns();
+	const ndInt32 depth8 = depth & -8;
+	for (ndInt32 j0 = 0; j0 < columns; j0 += D_BRAIN_GEMM_BLOCK_DOT)
+	{
+		const ndInt32 j1 = ndMin(j0 + D_BRAIN_GEMM_BLOCK_DOT, columns);
+		ndInt32 i = 0;
+		for (; (i + 2) <= rows; i += 2)
+		{
+			const ndBrainFloat* const a0 = &a[i + 0][0];
+			const ndBrainFloat* const a1 = &a[i + 1][0];
+			ndInt32 j = j0;
+			for (; (j + 2) <= j1; j += 2)
+			{
+				const ndBrainFloat* const b0 = &b[j + 0][0];
+				const ndBrainFloat* const b1 = &b[j + 1][0];
+				ndBrainFloat8 acc00(ndBrainFloat(0.0f));
+				ndBrainFloat8 acc01(ndBrainFloat(0.0f));
+				ndBrainFloat8 acc10(ndBrainFloat(0.0f));
+				ndBrainFloat8 acc11(ndBrainFloat(0.0f));
+				for (ndInt32 p = 0; p < depth8; p += 8)
+				{
+					const ndBrainFloat8 x0(&a0[p]);
+					const ndBrainFloat8 x1(&a1[p]);
+					const ndBrainFloat8 y0(&b0[p]);
+					const ndBrainFloat8 y1(&b1[p]);
+					acc00 = acc00.MulAdd(x0, y0);
+					acc01 = acc01.MulAdd(x0, y1);
+					acc10 = acc10.MulAdd(x1, y0);
+					acc11 = acc11.MulAdd(x1, y1);
+				}
+				ndBrainFloat sum00 = acc00.AddHorizontal();
+				ndBrainFloat sum01 = acc01.AddHorizontal();
+				ndBrainFloat sum10 = acc10.AddHorizontal();
+				ndBrainFloat sum11 = acc11.AddHorizontal();
+				for (ndInt32 p = depth8; p < depth; ++p)
+				{
+					sum00 += a0[p] * b0[p];
+					sum01 += a0[p] * b1[p];
+					sum10 += a1[p] * b0[p];
+					sum11 += a1[p] * b1[p];
+				}
+				c[i + 0][j + 0] = sum00;
+				c[i + 0][j + 1] = sum01;
+				c[i + 1][j + 0] = sum10;
+				c[i + 1][j + 1] = sum11;
+			}
+			for (; j < j1; ++j)
+			{
+				const ndBrainFloat* const b0 = &b[j][0];
+				ndBrainFloat8 acc00(ndBrainFloat(0.0f));
+				ndBrainFloat8 acc10(ndBrainFloat(0.0f));
+				for (ndInt32 p = 0; p < depth8; p += 8)
+				{
+					const ndBrainFloat8 y0(&b0[p]);
+					acc00 = acc00.MulAdd(ndBrainFloat8(&a0[p]), y0);
+					acc10 = acc10.MulAdd(ndBrainFloat8(&a1[p]), y0);
+				}
+				ndBrainFloat sum00 = acc00.AddHorizontal();
+				ndBrainFloat sum10 = acc10.AddHorizontal();
+				for (ndInt32 p = depth8; p < depth; ++p)
+				{
+					sum00 += a0[p] * b0[p];
+					sum10 += a1[p] * b0[p];
+				}
+				c[i + 0][j] = sum00;
+				c[i + 1][j] = sum10;
+			}
+		}
+		for (; i < rows; ++i)
+		{
+			const ndBrainFloat* const a0 = &a[i][0];
+			for (ndInt32 j = j0; j < j1; ++j)
+			{
+				const ndBrainFloat* const b0 = &b[j][0];
+				ndBrainFloat8 acc(ndBrainFloat(0.0f));
+				for (ndInt32 p = 0; p < depth8; p += 8)
+				{
+					acc = acc.MulAdd(ndBrainFloat8(&a0[p]), ndBrainFloat8(&b0[p]));
+				}
+				ndBrainFloat sum = acc.AddHorizontal();
+				for (ndInt32 p = depth8; p < depth; ++p)
+				{
+					sum += a0[p] * b0[p];
+				}
+				c[i][j] = sum;
+			}
+		}
+	}
+}
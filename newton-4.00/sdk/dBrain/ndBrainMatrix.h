@@ -49,6 +49,17 @@ class ndBrainMatrix: public ndArray<ndBrainMemVector>
 	void Mul(const ndBrainVector& input, ndBrainVector& output) const;
 	void TransposeMul(const ndBrainVector& input, ndBrainVector& output) const;
 
+	// cache blocked matrix products, this is the result:
+	// this = a * b
+	void MatrixMul(const ndBrainMatrix& a, const ndBrainMatrix& b);
+	// this = a * transpose(b)
+	void MatrixMulTranspose(const ndBrainMatrix& a, const ndBrainMatrix& b);
+	// this = transpose(a) * b
+	void TransposeMatrixMul(const ndBrainMatrix& a, const ndBrainMatrix& b);
+
+	// distance in floats between the start of two consecutive rows
+	ndInt32 GetRowStride() const;
+
 	protected:
 	void* m_memory;
 };
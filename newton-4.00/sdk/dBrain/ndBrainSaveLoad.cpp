@@ -26,6 +26,7 @@
 #include "ndBrainLayerReluActivation.h"
 #include "ndBrainLayerTanhActivation.h"
 #include "ndBrainLayerImagePolling_2x2.h"
+#include "ndBrainLayerLinearQuantized.h"
 #include "ndBrainLayerConvolutional_2d.h"
 #include "ndBrainLayerSoftmaxActivation.h"
 #include "ndBrainLayerSigmoidActivation.h"
@@ -105,6 +106,10 @@ ndBrain* ndBrainLoad::Load() const
 		{
 			layer = ndBrainLayerLinear::Load(this);
 		}
+		else if (!strcmp(layerType, "ndBrainLayerLinearQuantized"))
+		{
+			layer = ndBrainLayerLinearQuantized::Load(this);
+		}
 		else if (!strcmp(layerType, "ndBrainLayerReluActivation"))
 		{
 			layer = ndBrainLayerReluActivation::Load(this);
@@ -66,12 +66,6 @@ ndBrainThreadPool::ndBrainThreadPool()
 	,ndSyncMutex()
 	,m_workers()
 {
-	for (ndInt32 i = 0; i < D_MAX_THREADS_COUNT; ++i)
-	{
-		m_workers.PushBack(nullptr);
-	}
-
-	m_workers.SetCount(0);
 	SetThreadCount(1);
 }
 
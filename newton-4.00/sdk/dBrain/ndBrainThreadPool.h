@@ -43,7 +43,7 @@ class ndBrainThreadPool: public ndClassAlloc, public ndSyncMutex
 
 	private:
 	void SubmmitTask(ndTask* const task, ndInt32 index);
-	ndFixSizeArray<ndWorker*, D_MAX_THREADS_COUNT> m_workers;
+	ndArray<ndWorker*> m_workers;
 };
 
 template <typename Function>
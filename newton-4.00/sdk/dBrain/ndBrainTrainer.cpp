@@ -81,6 +81,8 @@ class ndBrainTrainer::ndLayerData : public ndClassAlloc
 ndBrainTrainer::ndBrainTrainer(ndBrain* const brain)
 	:ndClassAlloc()
 	,m_data()
+	,m_batchOutputs()
+	,m_batchGradients()
 	,m_workingBuffer()
 	,m_prefixScan()
 	,m_brain(brain)
@@ -112,6 +114,8 @@ ndBrainTrainer::ndBrainTrainer(ndBrain* const brain)
 ndBrainTrainer::ndBrainTrainer(const ndBrainTrainer& src)
 	:ndClassAlloc()
 	,m_data()
+	,m_batchOutputs()
+	,m_batchGradients()
 	,m_workingBuffer()
 	,m_prefixScan(src.m_prefixScan)
 	,m_brain(src.m_brain)
@@ -131,6 +135,14 @@ ndBrainTrainer::~ndBrainTrainer()
 	{
 		delete (m_data[i]);
 	}
+	for (ndInt32 i = 0; i < m_batchOutputs.GetCount(); ++i)
+	{
+		delete (m_batchOutputs[i]);
+	}
+	for (ndInt32 i = 0; i < m_batchGradients.GetCount(); ++i)
+	{
+		delete (m_batchGradients[i]);
+	}
 }
 
 ndBrain* ndBrainTrainer::GetBrain() const
@@ -222,4 +234,69 @@ void ndBrainTrainer::BackPropagate(const ndBrainVector& input, ndBrainLoss& loss
 	}
 }
 
+void ndBrainTrainer::InitBatchBuffers(ndInt32 batchSize)
+{
+	const ndInt32 layersCount = m_brain->GetCount();
+	const ndArray<ndBrainLayer*>& layers = *m_brain;
+	if (!m_batchOutputs.GetCount())
+	{
+		for (ndInt32 i = 0; i < layersCount; ++i)
+		{
+			m_batchOutputs.PushBack(new ndBrainMatrix());
+			m_batchGradients.PushBack(new ndBrainMatrix());
+		}
+		m_batchGradients.PushBack(new ndBrainMatrix());
+	}
+
+	if (m_batchOutputs[0]->GetRows() != batchSize)
+	{
+		// the output of layer i, the derivative of the loss with respect 
+		// to the input of layer i, and last the one of the output of the brain.
+		for (ndInt32 i = 0; i < layersCount; ++i)
+		{
+			m_batchOutputs[i]->Init(batchSize, layers[i]->GetOutputSize());
+			m_batchGradients[i]->Init(batchSize, layers[i]->GetInputSize());
+		}
+		m_batchGradients[layersCount]->Init(batchSize, m_brain->GetOutputSize());
+	}
+}
+
+void ndBrainTrainer::BackPropagate(const ndBrainMatrix& input, const ndBrainMatrix& truth, ndBrainLoss& loss)
+{
+	const ndInt32 layersCount = m_brain->GetCount();
+	const ndArray<ndBrainLayer*>& layers = *m_brain;
+	ndAssert(!(loss.IsCategorical() ^ (!strcmp(layers[layersCount - 1]->GetLabelId(), "ndBrainLayerCategoricalSoftmaxActivation"))));
+	ndAssert(input.GetRows() == truth.GetRows());
+	ndAssert(input.GetColumns() == m_brain->GetInputSize());
+	ndAssert(truth.GetColumns() == m_brain->GetOutputSize());
+
+	const ndInt32 batchSize = input.GetRows();
+	if (!batchSize)
+	{
+		ClearGradients();
+		return;
+	}
+	InitBatchBuffers(batchSize);
+
+	for (ndInt32 i = 0; i < layersCount; ++i)
+	{
+		const ndBrainMatrix& in = i ? *m_batchOutputs[i - 1] : input;
+		layers[i]->MakeBatchPrediction(in, *m_batchOutputs[i]);
+	}
+
+	const ndBrainMatrix& output = *m_batchOutputs[layersCount - 1];
+	ndBrainMatrix& lossGradient = *m_batchGradients[layersCount];
+	for (ndInt32 i = 0; i < batchSize; ++i)
+	{
+		loss.SetTruth(truth[i]);
+		loss.GetLoss(output[i], lossGradient[i]);
+	}
 
+	for (ndInt32 i = layersCount - 1; i >= 0; --i)
+	{
+		const ndBrainMatrix& in = i ? *m_batchOutputs[i - 1] : input;
+		layers[i]->CalculateBatchParamGradients(in, *m_batchOutputs[i], *m_batchGradients[i + 1], *m_batchGradients[i], m_data[i]->m_gradient);
+	}
+
+	ScaleWeights(ndBrainFloat(1.0f) / ndBrainFloat(batchSize));
+}
@@ -26,6 +26,7 @@
 #include "ndBrainVector.h"
 class ndBrain;
 class ndBrainLoss;
+class ndBrainMatrix;
 
 class ndBrainTrainer: public ndClassAlloc
 {
@@ -38,6 +39,11 @@ class ndBrainTrainer: public ndClassAlloc
 
 	ndBrain* GetBrain() const;
 	void BackPropagate(const ndBrainVector& input, ndBrainLoss& loss);
+
+	// each row of input is one sample and the same row of truth is its expected output.
+	// the gradients are the average of the gradients of the rows, so that one batch 
+	// trainer gives the same update as one single sample trainer per row.
+	void BackPropagate(const ndBrainMatrix& input, const ndBrainMatrix& truth, ndBrainLoss& loss);
 	void AcculumateGradients(const ndBrainTrainer& src, ndInt32 index);
 
 	ndBrainLayer* GetWeightsLayer(ndInt32 index) const;
@@ -50,7 +56,11 @@ class ndBrainTrainer: public ndClassAlloc
 	ndBrainVector& GetWorkingBuffer();
 
 	private:
+	void InitBatchBuffers(ndInt32 batchSize);
+
 	ndArray<ndLayerData*> m_data;
+	ndArray<ndBrainMatrix*> m_batchOutputs;
+	ndArray<ndBrainMatrix*> m_batchGradients;
 	ndBrainVector m_workingBuffer;
 	ndFixSizeArray<ndInt32, 256> m_prefixScan;
 	ndBrain* m_brain;
@@ -150,14 +150,16 @@ void ndBrainVector::FlushToZero()
 
 	const ndBrainFloat4 max(ndBrainFloat(1.0e-16f));
 	const ndBrainFloat4 min(ndBrainFloat(-1.0e-16f));
-	ndBrainFloat4* const ptrSimd =(ndBrainFloat4*) &(*this)[0];
+	ndBrainFloat* const ptr = &(*this)[0];
 
+	// the vectors are not always aligned, so load and store unaligned
 	const ndInt32 roundCount = (GetCount() & -4) / 4;
 	for (ndInt32 i = 0; i < roundCount; ++i)
 	{
 		//(*this)[i] = ndFlushToZero((*this)[i]);
-		const ndBrainFloat4 mask((ptrSimd[i] < min) | (ptrSimd[i] > max));
-		ptrSimd[i] = ptrSimd[i] & mask;
+		const ndBrainFloat4 value(&ptr[i * 4]);
+		const ndBrainFloat4 mask((value < min) | (value > max));
+		(value & mask).Store(&ptr[i * 4]);
 	}
 	for (ndInt32 i = roundCount * 4; i < GetCount(); ++i)
 	{
@@ -50,6 +50,7 @@ ndBody::ndBody()
 	,m_isConstrained(0)
 	,m_sceneForceUpdate(1)
 	,m_sceneEquilibrium(0)
+	,m_islandSleep(0)
 {
 	m_uniqueIdCount++;
 	m_transformIsDirty = 1;
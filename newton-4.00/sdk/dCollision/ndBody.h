@@ -115,6 +115,7 @@ class ndBody : public ndContainersFreeListAlloc<ndBody>
 			ndUnsigned32 m_contactTestOnly : 1;
 			ndUnsigned32 m_transformIsDirty : 1;
 			ndUnsigned32 m_equilibriumOverride : 1;
+			ndUnsigned32 m_speculativeContacts : 1;
 		};
 	};
 
@@ -127,6 +128,7 @@ class ndBody : public ndContainersFreeListAlloc<ndBody>
 	ndUnsigned8 m_isConstrained;
 	ndUnsigned8 m_sceneForceUpdate;
 	ndUnsigned8 m_sceneEquilibrium;
+	ndUnsigned8 m_islandSleep;
 	
 	D_COLLISION_API static ndUnsigned32 m_uniqueIdCount;
 
@@ -57,19 +57,96 @@ bool ndBodyKinematic::ndContactkey::operator> (const ndContactkey& key) const
 }
 
 ndBodyKinematic::ndContactMap::ndContactMap()
-	:ndTree<ndContact*, ndContactkey, ndContainersFreeListAlloc<ndContact*>>()
+	:m_slots(m_inlineSlots)
+	,m_count(0)
+	,m_mask(D_CONTACT_MAP_INLINE_SLOTS - 1)
 {
+	memset(m_inlineSlots, 0, sizeof(m_inlineSlots));
 }
 
 ndBodyKinematic::ndContactMap::~ndContactMap()
 {
+	if (m_slots != m_inlineSlots)
+	{
+		ndMemory::Free(m_slots);
+	}
+}
+
+ndInt32 ndBodyKinematic::ndContactMap::FindSlot(ndUnsigned64 key) const
+{
+	ndInt32 slot = GetHomeSlot(key);
+	for (ndInt32 distance = 0; m_slots[slot].m_contact; ++distance)
+	{
+		const ndNode& node = m_slots[slot];
+		if (node.m_key == key)
+		{
+			return slot;
+		}
+
+		// entries are sorted by home slot and key, so the key can not be further down.
+		const ndInt32 nodeDistance = GetProbeDistance(node.m_key, slot);
+		if ((nodeDistance < distance) || ((nodeDistance == distance) && (node.m_key > key)))
+		{
+			break;
+		}
+		slot = (slot + 1) & m_mask;
+	}
+	return -1;
+}
+
+void ndBodyKinematic::ndContactMap::Insert(ndUnsigned64 key, ndContact* const contact)
+{
+	ndNode entry;
+	entry.m_key = key;
+	entry.m_contact = contact;
+
+	ndInt32 distance = 0;
+	ndInt32 slot = GetHomeSlot(key);
+	while (m_slots[slot].m_contact)
+	{
+		ndNode& node = m_slots[slot];
+		const ndInt32 nodeDistance = GetProbeDistance(node.m_key, slot);
+		if ((nodeDistance < distance) || ((nodeDistance == distance) && (node.m_key > entry.m_key)))
+		{
+			ndSwap(node, entry);
+			distance = nodeDistance;
+		}
+		slot = (slot + 1) & m_mask;
+		distance++;
+	}
+	m_slots[slot] = entry;
+	m_count++;
+}
+
+void ndBodyKinematic::ndContactMap::Resize(ndInt32 capacity)
+{
+	ndAssert(!(capacity & (capacity - 1)));
+	ndNode* const oldSlots = m_slots;
+	const ndInt32 oldCapacity = m_mask + 1;
+
+	m_slots = (ndNode*)ndMemory::Malloc(size_t(capacity) * sizeof(ndNode));
+	memset(m_slots, 0, size_t(capacity) * sizeof(ndNode));
+	m_mask = capacity - 1;
+	m_count = 0;
+	for (ndInt32 i = 0; i < oldCapacity; ++i)
+	{
+		if (oldSlots[i].m_contact)
+		{
+			Insert(oldSlots[i].m_key, oldSlots[i].m_contact);
+		}
+	}
+
+	if (oldSlots != m_inlineSlots)
+	{
+		ndMemory::Free(oldSlots);
+	}
 }
 
 ndContact* ndBodyKinematic::ndContactMap::FindContact(const ndBody* const body0, const ndBody* const body1) const
 {
 	ndContactkey key(body0->GetId(), body1->GetId());
-	ndNode* const node = Find(key);
-	return node ? node->GetInfo() : nullptr;
+	const ndInt32 slot = FindSlot(key.GetTag());
+	return (slot >= 0) ? m_slots[slot].m_contact : nullptr;
 }
 
 void ndBodyKinematic::ndContactMap::AttachContact(ndContact* const contact)
@@ -77,8 +154,14 @@ void ndBodyKinematic::ndContactMap::AttachContact(ndContact* const contact)
 	ndBody* const body0 = contact->GetBody0();
 	ndBody* const body1 = contact->GetBody1();
 	ndContactkey key(body0->GetId(), body1->GetId());
-	ndAssert(!Find(key));
-	Insert(contact, key);
+	ndAssert(FindSlot(key.GetTag()) < 0);
+
+	// keep the load factor under 3/4
+	if ((m_count + 1) * 4 > (m_mask + 1) * 3)
+	{
+		Resize((m_mask + 1) * 2);
+	}
+	Insert(key.GetTag(), contact);
 }
 
 void ndBodyKinematic::ndContactMap::DetachContact(ndContact* const contact)
@@ -86,8 +169,36 @@ void ndBodyKinematic::ndContactMap::DetachContact(ndContact* const contact)
 	ndBody* const body0 = contact->GetBody0();
 	ndBody* const body1 = contact->GetBody1();
 	ndContactkey key(body0->GetId(), body1->GetId());
-	ndAssert(Find(key));
-	Remove(key);
+	ndInt32 slot = FindSlot(key.GetTag());
+	ndAssert(slot >= 0);
+
+	// shift back the entries that follow, so that no tomb stones are needed.
+	ndInt32 next = (slot + 1) & m_mask;
+	while (m_slots[next].m_contact && GetProbeDistance(m_slots[next].m_key, next))
+	{
+		m_slots[slot] = m_slots[next];
+		slot = next;
+		next = (next + 1) & m_mask;
+	}
+	m_slots[slot].m_contact = nullptr;
+	m_count--;
+}
+
+bool ndBodyKinematic::ndContactMap::SanityCheck() const
+{
+	ndInt32 count = 0;
+	for (ndInt32 i = 0; i <= m_mask; ++i)
+	{
+		if (m_slots[i].m_contact)
+		{
+			count++;
+			if (FindSlot(m_slots[i].m_key) != i)
+			{
+				return false;
+			}
+		}
+	}
+	return count == m_count;
 }
 
 ndBodyKinematic::ndBodyKinematic()
@@ -159,6 +270,19 @@ void ndBodyKinematic::SetCollisionShape(const ndShapeInstance& shapeInstance)
 	}
 }
 
+void ndBodyKinematic::CollisionShapeChanged()
+{
+	m_sceneForceUpdate = 1;
+	ndContactMap::Iterator it(m_contactList);
+	for (it.Begin(); it; it++)
+	{
+		// resting bodies keep their contacts until they move, so wake them up
+		ndContact* const contact = *it;
+		ndBodyKinematic* const body = (contact->GetBody0() == this) ? contact->GetBody1() : contact->GetBody0();
+		body->SetSleepState(false);
+	}
+}
+
 ndContact* ndBodyKinematic::FindContact(const ndBody* const otherBody) const
 {
 	ndScopeSpinLock lock(m_lock);
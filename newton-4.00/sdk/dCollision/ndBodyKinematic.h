@@ -33,6 +33,7 @@ class ndSkeletonContainer;
 class ndJointBilateralConstraint;
 
 #define D_USE_FULL_INERTIA
+#define D_CONTACT_MAP_INLINE_SLOTS	16
 #define	D_FREEZZING_VELOCITY_DRAG	ndFloat32 (0.9f)
 #define	D_SOLVER_MAX_ACCEL_ERROR	(D_FREEZE_MAG * ndFloat32 (0.5f))
 
@@ -47,6 +48,7 @@ class ndBodyKinematic : public ndBody
 		bool operator> (const ndContactkey& key) const;
 		bool operator< (const ndContactkey& key) const;
 		bool operator== (const ndContactkey& key) const;
+		ndUnsigned64 GetTag() const;
 		private:
 		union
 		{
@@ -70,16 +72,66 @@ class ndBodyKinematic : public ndBody
 		}
 	};
 
-	class ndContactMap: public ndTree<ndContact*, ndContactkey, ndContainersFreeListAlloc<ndContact*>>
+	// open addressing hash table of the contacts of a body, using robin hood 
+	// linear probing, with ties broken by key. The layout only depends on the 
+	// set of contacts and not on the order they were attached, so iteration 
+	// order is the same regardless of how many threads created the contacts.
+	// small tables live inside the body and do not allocate memory.
+	class ndContactMap
 	{
 		public:
+		class ndNode
+		{
+			public:
+			ndContact* GetInfo() const;
+
+			private:
+			ndUnsigned64 m_key;
+			ndContact* m_contact;
+			friend class ndContactMap;
+		};
+
+		class Iterator
+		{
+			public:
+			Iterator(const ndContactMap& map);
+
+			void Begin();
+			operator ndInt32() const;
+			void operator++ ();
+			void operator++ (ndInt32);
+			ndContact* operator*() const;
+			ndNode* GetNode() const;
+
+			private:
+			void Next(ndInt32 slot);
+
+			const ndContactMap* m_map;
+			ndInt32 m_slot;
+		};
+
+		ndInt32 GetCount() const;
+		D_COLLISION_API bool SanityCheck() const;
 		D_COLLISION_API ndContact* FindContact(const ndBody* const body0, const ndBody* const body1) const;
 
 		private:
 		ndContactMap();
 		~ndContactMap();
+		ndContactMap(const ndContactMap&);
+		ndContactMap& operator=(const ndContactMap&);
+
 		void AttachContact(ndContact* const contact);
 		void DetachContact(ndContact* const contact);
+		void Insert(ndUnsigned64 key, ndContact* const contact);
+		void Resize(ndInt32 capacity);
+		ndInt32 FindSlot(ndUnsigned64 key) const;
+		ndInt32 GetHomeSlot(ndUnsigned64 key) const;
+		ndInt32 GetProbeDistance(ndUnsigned64 key, ndInt32 slot) const;
+
+		ndNode* m_slots;
+		ndInt32 m_count;
+		ndInt32 m_mask;
+		ndNode m_inlineSlots[D_CONTACT_MAP_INLINE_SLOTS];
 		friend class ndBodyKinematic;
 	};
 
@@ -104,6 +156,8 @@ class ndBodyKinematic : public ndBody
 
 	bool GetAutoSleep() const;
 	void SetAutoSleep(bool state);
+	bool GetSpeculativeContacts() const;
+	void SetSpeculativeContacts(bool state);
 	ndFloat32 GetMaxLinearStep() const;
 	ndFloat32 GetMaxAngularStep() const;
 	void SetDebugMaxLinearAndAngularIntegrationStep(ndFloat32 angleInRadian, ndFloat32 stepInUnitPerSeconds);
@@ -118,6 +172,12 @@ class ndBodyKinematic : public ndBody
 	D_COLLISION_API ndShapeInstance& GetCollisionShape();
 	D_COLLISION_API const ndShapeInstance& GetCollisionShape() const;
 	D_COLLISION_API virtual void SetCollisionShape(const ndShapeInstance& shapeInstance);
+
+	/// call after editing the shape of the body in place, like loading or unloading the
+	/// tiles of a heightfield. the scene updates the bounds of the body in the next update,
+	/// and the bodies touching it wake up to collide with the new surface.
+	/// only legal outside of an update, or after Sync.
+	D_COLLISION_API void CollisionShapeChanged();
 	D_COLLISION_API virtual bool RayCast(ndRayCastNotify& callback, const ndFastRay& ray, const ndFloat32 maxT) const;
 
 	D_COLLISION_API ndVector CalculateLinearMomentum() const;
@@ -238,6 +298,7 @@ class ndBodyKinematic : public ndBody
 	friend class ndSkeletonContainer;
 	friend class ndModelArticulation;
 	friend class ndDynamicsUpdateSoa;
+	friend class ndDynamicsUpdateGaussSeidel;
 	friend class ndDynamicsUpdateAvx2;
 	friend class ndDynamicsUpdateSycl;
 	friend class ndDynamicsUpdateCuda;
@@ -394,6 +455,75 @@ inline void ndBodyKinematic::PrepareStep(ndInt32 index)
 	m_equilibrium0 = m_equilibrium;
 }
 
+inline ndUnsigned64 ndBodyKinematic::ndContactkey::GetTag() const
+{
+	return m_tag;
+}
+
+inline ndContact* ndBodyKinematic::ndContactMap::ndNode::GetInfo() const
+{
+	return m_contact;
+}
+
+inline ndInt32 ndBodyKinematic::ndContactMap::GetCount() const
+{
+	return m_count;
+}
+
+inline ndInt32 ndBodyKinematic::ndContactMap::GetHomeSlot(ndUnsigned64 key) const
+{
+	// fibonacci hashing, the high bits of the product are the best mixed.
+	return ndInt32((key * ndUnsigned64(0x9E3779B97F4A7C15)) >> 32) & m_mask;
+}
+
+inline ndInt32 ndBodyKinematic::ndContactMap::GetProbeDistance(ndUnsigned64 key, ndInt32 slot) const
+{
+	return (slot - GetHomeSlot(key)) & m_mask;
+}
+
+inline ndBodyKinematic::ndContactMap::Iterator::Iterator(const ndContactMap& map)
+	:m_map(&map)
+	,m_slot(map.m_mask + 1)
+{
+}
+
+inline void ndBodyKinematic::ndContactMap::Iterator::Next(ndInt32 slot)
+{
+	const ndInt32 capacity = m_map->m_mask + 1;
+	for (; (slot < capacity) && !m_map->m_slots[slot].m_contact; ++slot);
+	m_slot = slot;
+}
+
+inline void ndBodyKinematic::ndContactMap::Iterator::Begin()
+{
+	Next(0);
+}
+
+inline ndBodyKinematic::ndContactMap::Iterator::operator ndInt32() const
+{
+	return m_slot <= m_map->m_mask;
+}
+
+inline void ndBodyKinematic::ndContactMap::Iterator::operator++ ()
+{
+	Next(m_slot + 1);
+}
+
+inline void ndBodyKinematic::ndContactMap::Iterator::operator++ (ndInt32)
+{
+	Next(m_slot + 1);
+}
+
+inline ndContact* ndBodyKinematic::ndContactMap::Iterator::operator*() const
+{
+	return m_map->m_slots[m_slot].m_contact;
+}
+
+inline ndBodyKinematic::ndContactMap::ndNode* ndBodyKinematic::ndContactMap::Iterator::GetNode() const
+{
+	return &m_map->m_slots[m_slot];
+}
+
 inline ndBodyKinematic::ndContactMap& ndBodyKinematic::GetContactMap()
 {
 	return m_contactList;
@@ -440,6 +570,20 @@ inline void ndBodyKinematic::SetAutoSleep(bool state)
 	SetSleepState(false);
 }
 
+inline bool ndBodyKinematic::GetSpeculativeContacts() const
+{
+	return m_speculativeContacts ? true : false;
+}
+
+// a body with speculative contacts gets contacts with the shapes it can reach
+// in the next step, and the solver only lets it close the gap to them. 
+// this prevents fast bodies from tunneling, without continuous collision 
+// or extra sub steps. does not apply to static meshes and heightfields.
+inline void ndBodyKinematic::SetSpeculativeContacts(bool state)
+{
+	m_speculativeContacts = ndUnsigned32(state ? 1 : 0);
+}
+
 inline ndSkeletonContainer* ndBodyKinematic::GetSkeleton() const
 { 
 	return m_skeletonContainer;
@@ -170,10 +170,6 @@ class ndBodySphFluid::ndWorkingBuffers
 		,m_hashGridSize(ndFloat32(0.0f))
 		,m_hashInvGridSize(ndFloat32(0.0f))
 	{
-		for (ndInt32 i = 0; i < D_MAX_THREADS_COUNT; ++i)
-		{
-			m_partialsGridScans[i].Resize(D_SPH_BUFFER_GRANULARITY);
-		}
 	}
 
 	~ndWorkingBuffers()
@@ -214,7 +210,7 @@ class ndBodySphFluid::ndWorkingBuffers
 	ndArray<ndGridHash> m_hashGridMap;
 	ndArray<ndGridHash> m_hashGridMapScratchBuffer;
 	ndArray<ndParticleKernelDistance> m_kernelDistance;
-	ndArray<ndInt32> m_partialsGridScans[D_MAX_THREADS_COUNT];
+	ndPerThreadArray<ndArray<ndInt32>> m_partialsGridScans;
 	ndFloat32 m_worlToGridOrigin;
 	ndFloat32 m_worlToGridScale;
 	ndFloat32 m_hashGridSize;
@@ -446,8 +442,8 @@ void ndBodySphFluid::CalculateScans(ndThreadPool* const threadPool)
 {
 	D_TRACKTIME();
 	ndWorkingBuffers& data = *m_workingBuffers;
-	ndInt32 sums[D_MAX_THREADS_COUNT + 1];
-	ndInt32 scans[D_MAX_THREADS_COUNT + 1];
+	ndInt32* const sums = ndAlloca(ndInt32, threadPool->GetThreadCount() + 1);
+	ndInt32* const scans = ndAlloca(ndInt32, threadPool->GetThreadCount() + 1);
 
 	auto CountGridScans = ndMakeObject::ndFunction([&data, &scans](ndInt32 threadIndex, ndInt32)
 	{
@@ -491,6 +487,7 @@ void ndBodySphFluid::CalculateScans(ndThreadPool* const threadPool)
 
 	memset(scans, 0, sizeof(scans));
 	const ndInt32 threadCount = threadPool->GetThreadCount();
+	data.m_partialsGridScans.SetCount(threadCount);
 	
 	ndInt32 particleCount = data.m_hashGridMap.GetCount();
 
@@ -929,7 +926,7 @@ void ndBodySphFluid::CaculateAabb(ndThreadPool* const threadPool)
 		ndVector m_max;
 	};
 
-	ndBox boxes[D_MAX_THREADS_COUNT];
+	ndBox* const boxes = ndAlloca(ndBox, threadPool->GetThreadCount());
 	auto CalculateAabb = ndMakeObject::ndFunction([this, &boxes](ndInt32 threadIndex, ndInt32 threadCount)
 	{
 		D_TRACKTIME_NAMED(CalculateAabb);
@@ -1335,10 +1332,6 @@ class ndBodySphFluid::ndWorkingBuffers
 		, m_hashInvGridSize(ndFloat32(0.0f))
 		, m_particleDiameter(ndFloat32(0.0f))
 	{
-		for (ndInt32 i = 0; i < D_MAX_THREADS_COUNT; ++i)
-		{
-			m_partialsGridScans[i].Resize(D_SPH_BUFFER_GRANULARITY);
-		}
 	}
 
 	~ndWorkingBuffers()
@@ -1379,7 +1372,7 @@ class ndBodySphFluid::ndWorkingBuffers
 	ndArray<ndGridHash> m_hashGridMap;
 	ndArray<ndGridHash> m_hashGridMapScratchBuffer;
 	ndArray<ndParticleKernelDistance> m_kernelDistance;
-	ndArray<ndInt32> m_partialsGridScans[D_MAX_THREADS_COUNT];
+	ndPerThreadArray<ndArray<ndInt32>> m_partialsGridScans;
 	ndFloat32 m_worlToGridOrigin;
 	ndFloat32 m_worlToGridScale;
 	ndFloat32 m_hashGridSize;
@@ -1611,8 +1604,8 @@ void ndBodySphFluid::CalculateScans(ndThreadPool* const threadPool)
 {
 	D_TRACKTIME();
 	ndWorkingBuffers& data = *m_workingBuffers;
-	ndInt32 sums[D_MAX_THREADS_COUNT + 1];
-	ndInt32 scans[D_MAX_THREADS_COUNT + 1];
+	ndInt32* const sums = ndAlloca(ndInt32, threadPool->GetThreadCount() + 1);
+	ndInt32* const scans = ndAlloca(ndInt32, threadPool->GetThreadCount() + 1);
 
 	auto CountGridScans = ndMakeObject::ndFunction([&data, &scans](ndInt32 threadIndex, ndInt32)
 	{
@@ -1656,6 +1649,7 @@ void ndBodySphFluid::CalculateScans(ndThreadPool* const threadPool)
 
 	memset(scans, 0, sizeof(scans));
 	const ndInt32 threadCount = threadPool->GetThreadCount();
+	data.m_partialsGridScans.SetCount(threadCount);
 
 	ndInt32 particleCount = data.m_hashGridMap.GetCount();
 
@@ -2105,7 +2099,7 @@ void ndBodySphFluid::CaculateAabb(ndThreadPool* const threadPool)
 		ndVector m_max;
 	};
 
-	ndBox boxes[D_MAX_THREADS_COUNT];
+	ndBox* const boxes = ndAlloca(ndBox, threadPool->GetThreadCount());
 	auto CalculateAabb = ndMakeObject::ndFunction([this, &boxes](ndInt32 threadIndex, ndInt32 threadCount)
 	{
 		D_TRACKTIME_NAMED(CalculateAabb);
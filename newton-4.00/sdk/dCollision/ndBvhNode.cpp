@@ -27,6 +27,11 @@
 #define D_AABB_QUANTIZATION		ndFloat32 (4.0f)
 #define D_AABB_INV_QUANTIZATION	(ndFloat32 (1.0f) / D_AABB_QUANTIZATION)
 
+#define D_BVH_SAH_BINS				16
+#define D_BVH_SAH_MAX_DEPTH			64
+#define D_BVH_SAH_PARALLEL_COUNT	4096
+#define D_BVH_SAH_REBUILD_FACTOR	ndFloat32 (1.25f)
+
 ndVector ndBvhNode::m_aabbQuantization(D_AABB_QUANTIZATION, D_AABB_QUANTIZATION, D_AABB_QUANTIZATION, ndFloat32 (0.0f));
 ndVector ndBvhNode::m_aabbInvQuantization(D_AABB_INV_QUANTIZATION, D_AABB_INV_QUANTIZATION, D_AABB_INV_QUANTIZATION, ndFloat32(0.0f));
 
@@ -185,12 +190,16 @@ void ndBvhNodeArray::Swap(ndBvhNodeArray& src)
 ndBvhSceneManager::ndBvhSceneManager()
 	:m_workingArray()
 	,m_bvhBuildState()
+	,m_internalArea(ndFloat64(0.0f))
+	,m_buildQuality(ndFloat32(0.0f))
 {
 }
 
 ndBvhSceneManager::ndBvhSceneManager(const ndBvhSceneManager& src)
 	:m_workingArray(src.m_workingArray)
 	,m_bvhBuildState(src.m_bvhBuildState)
+	,m_internalArea(src.m_internalArea)
+	,m_buildQuality(src.m_buildQuality)
 {
 }
 
@@ -396,6 +405,8 @@ ndBuildBvhTreeBuildState::ndBuildBvhTreeBuildState()
 	,m_cellCounts0(1024)
 	,m_cellCounts1(1024)
 	,m_tempNodeBuffer(1024)
+	,m_sahBins()
+	,m_sahRanges()
 	,m_root(nullptr)
 	,m_srcArray(nullptr)
 	,m_tmpArray(nullptr)
@@ -425,9 +436,11 @@ void ndBvhSceneManager::UpdateScene(ndThreadPool& threadPool)
 	ndInt32 start = 0;
 	ndInt32 count = 0;
 	ndAtomic<ndInt32> iterator(0);
-	auto UpdateSceneBvh = ndMakeObject::ndFunction([this, &iterator, &start, &count](ndInt32, ndInt32)
+	ndFloat64* const areaDelta = ndAlloca(ndFloat64, threadPool.GetThreadCount());
+	auto UpdateSceneBvh = ndMakeObject::ndFunction([this, &iterator, &start, &count, &areaDelta](ndInt32 threadIndex, ndInt32)
 	{
 		D_TRACKTIME_NAMED(UpdateSceneBvh);
+		ndFloat64 delta = ndFloat64(0.0f);
 		ndBvhInternalNode** const nodes = (ndBvhInternalNode**)&m_workingArray[start];
 		const ndInt32 itemsCount = count;
 		for (ndInt32 i = iterator.fetch_add(D_WORKER_BATCH_SIZE); i < itemsCount; i = iterator.fetch_add(D_WORKER_BATCH_SIZE))
@@ -442,13 +455,21 @@ void ndBvhSceneManager::UpdateScene(ndThreadPool& threadPool)
 				const ndVector maxBox(node->m_left->m_maxBox.GetMax(node->m_right->m_maxBox));
 				if (!ndBoxInclusionTest(minBox, maxBox, node->m_minBox, node->m_maxBox))
 				{
+					delta += ndBvhNode::CalculateSurfaceArea(minBox, maxBox) - ndBvhNode::CalculateSurfaceArea(node->m_minBox, node->m_maxBox);
 					node->m_minBox = minBox;
 					node->m_maxBox = maxBox;
 				}
 			}
 		}
+		areaDelta[threadIndex] += delta;
 	});
 
+	const ndInt32 threadCount = threadPool.GetThreadCount();
+	for (ndInt32 i = 0; i < threadCount; ++i)
+	{
+		areaDelta[i] = ndFloat64(0.0f);
+	}
+
 	const ndBvhNodeArray& array = m_workingArray;
 	for (ndInt32 i = 0; i < ndInt32(array.m_scansCount); ++i)
 	{
@@ -456,6 +477,11 @@ void ndBvhSceneManager::UpdateScene(ndThreadPool& threadPool)
 		count = ndInt32(array.m_scans[i + 1] - start);
 		threadPool.ParallelExecute(UpdateSceneBvh);
 	}
+
+	for (ndInt32 i = 0; i < threadCount; ++i)
+	{
+		m_internalArea += areaDelta[i];
+	}
 }
 
 bool ndBvhSceneManager::BuildBvhTreeInitNodes(ndThreadPool& threadPool)
@@ -533,8 +559,8 @@ bool ndBvhSceneManager::BuildBvhTreeInitNodes(ndThreadPool& threadPool)
 void ndBvhSceneManager::BuildBvhTreeCalculateLeafBoxes(ndThreadPool& threadPool)
 {
 	D_TRACKTIME();
-	ndVector boxes[D_MAX_THREADS_COUNT][2];
-	ndFloat32 boxSizes[D_MAX_THREADS_COUNT];
+	ndVector (*const boxes)[2] = (ndVector (*)[2])ndAlloca(ndVector, 2 * threadPool.GetThreadCount());
+	ndFloat32* const boxSizes = ndAlloca(ndFloat32, threadPool.GetThreadCount());
 
 	ndAtomic<ndInt32> iterator(0);
 	auto CalculateBoxSize = ndMakeObject::ndFunction([this, &iterator, &boxSizes, &boxes](ndInt32 threadIndex, ndInt32)
@@ -584,7 +610,7 @@ void ndBvhSceneManager::BuildBvhTreeCalculateLeafBoxes(ndThreadPool& threadPool)
 
 ndInt32 ndBvhSceneManager::BuildSmallBvhTree(ndThreadPool& threadPool, ndBvhNode** const parentsArray, ndInt32 bashCount)
 {
-	ndInt32 depthLevel[D_MAX_THREADS_COUNT];
+	ndInt32* const depthLevel = ndAlloca(ndInt32, threadPool.GetThreadCount());
 	ndAtomic<ndInt32> iterator(0);
 	auto SmallBhvNodes = ndMakeObject::ndFunction([this, &iterator, parentsArray, bashCount, &depthLevel](ndInt32 threadIndex, ndInt32)
 	{
@@ -1141,7 +1167,7 @@ void ndBvhSceneManager::BuildBvhGenerateLayerGrids(ndThreadPool& threadPool)
 	};
 
 	ndUnsigned32 prefixScan[8];
-	ndInt32 maxGrids[D_MAX_THREADS_COUNT][3];
+	ndInt32 (*const maxGrids)[3] = (ndInt32 (*)[3])ndAlloca(ndInt32, 3 * threadPool.GetThreadCount());
 
 	ndCountingSortInPlace<ndBvhNode*, ndGridClassifier, 2>(threadPool, m_bvhBuildState.m_srcArray, m_bvhBuildState.m_tmpArray, m_bvhBuildState.m_leafNodesCount, prefixScan, &m_bvhBuildState);
 	ndInt32 insideCellsCount = ndInt32(prefixScan[m_insideCell + 1] - prefixScan[m_insideCell]);
@@ -1426,6 +1452,425 @@ ndBvhNode* ndBvhSceneManager::BuildBvhTree(ndThreadPool& threadPool)
 
 	BuildBvhTreeSetNodesDepth(threadPool);
 	ndAssert(m_bvhBuildState.m_root->SanityCheck(0));
+
+	ndFloat64 area = ndFloat64(0.0f);
+	const ndInt32 sceneNodeCount = m_workingArray.GetCount() / 2 - 1;
+	for (ndInt32 i = 0; i < sceneNodeCount; ++i)
+	{
+		const ndBvhNode* const node = m_workingArray[i];
+		area += ndBvhNode::CalculateSurfaceArea(node->m_minBox, node->m_maxBox);
+	}
+	m_internalArea = area;
+	m_buildQuality = GetTreeQuality(m_bvhBuildState.m_root);
 	
 	return m_bvhBuildState.m_root;
 }
+
+ndInt32 ndBvhSceneManager::SplitSahRange(ndThreadPool& threadPool, ndInt32 start, ndInt32 count, ndInt32 depth, bool parallel)
+{
+	ndBvhNode** const leaves = &m_bvhBuildState.m_srcArray[start];
+	const ndInt32 threadCount = parallel ? threadPool.GetThreadCount() : 1;
+
+	// the centroids are not divided by two, the scale does not matter for the split.
+	// the leaf with the largest area is also found, since a large body like a floor 
+	// is better split off on its own than binned with the rest.
+	ndVector (*const centroidBox)[2] = (ndVector (*)[2])ndAlloca(ndVector, 2 * threadCount);
+	ndFloat32* const largestArea = ndAlloca(ndFloat32, threadCount);
+	ndInt32* const largestLeaf = ndAlloca(ndInt32, threadCount);
+	auto CalculateCentroidBox = ndMakeObject::ndFunction([leaves, count, &centroidBox, &largestArea, &largestLeaf](ndInt32 threadIndex, ndInt32 threadCount)
+	{
+		D_TRACKTIME_NAMED(CalculateCentroidBox);
+		ndVector minP(ndFloat32(1.0e15f));
+		ndVector maxP(ndFloat32(-1.0e15f));
+		ndFloat32 maxArea = ndFloat32(-1.0f);
+		ndInt32 maxAreaLeaf = 0;
+		const ndStartEnd startEnd(count, threadIndex, threadCount);
+		for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
+		{
+			const ndBvhNode* const node = leaves[i];
+			const ndVector centroid(node->m_minBox + node->m_maxBox);
+			minP = minP.GetMin(centroid);
+			maxP = maxP.GetMax(centroid);
+			const ndFloat32 area = ndBvhNode::CalculateSurfaceArea(node->m_minBox, node->m_maxBox);
+			if (area > maxArea)
+			{
+				maxArea = area;
+				maxAreaLeaf = i;
+			}
+		}
+		centroidBox[threadIndex][0] = minP;
+		centroidBox[threadIndex][1] = maxP;
+		largestArea[threadIndex] = maxArea;
+		largestLeaf[threadIndex] = maxAreaLeaf;
+	});
+
+	if (parallel)
+	{
+		threadPool.ParallelExecute(CalculateCentroidBox);
+	}
+	else
+	{
+		CalculateCentroidBox(0, 1);
+	}
+
+	ndVector minP(centroidBox[0][0]);
+	ndVector maxP(centroidBox[0][1]);
+	ndInt32 bigLeaf = largestLeaf[0];
+	ndFloat32 bigLeafArea = largestArea[0];
+	for (ndInt32 i = 1; i < threadCount; ++i)
+	{
+		minP = minP.GetMin(centroidBox[i][0]);
+		maxP = maxP.GetMax(centroidBox[i][1]);
+		if (largestArea[i] > bigLeafArea)
+		{
+			bigLeaf = largestLeaf[i];
+			bigLeafArea = largestArea[i];
+		}
+	}
+
+	const ndVector size(maxP - minP);
+	ndInt32 axis = (size.m_x >= size.m_y) ? 0 : 1;
+	axis = (size[axis] >= size.m_z) ? axis : 2;
+	const ndFloat32 extent = size[axis];
+
+	if (extent <= ndFloat32(1.0e-5f))
+	{
+		// all centroids are in the same place, any split is as good as any other.
+		return count / 2;
+	}
+
+	if (depth >= D_BVH_SAH_MAX_DEPTH)
+	{
+		// a very unbalanced distribution, use median splits from here on 
+		// so that the depth of the tree stays bounded.
+		class ndCompareKey
+		{
+			public:
+			ndCompareKey(const void* const context)
+				:m_axis(*((ndInt32*)context))
+			{
+			}
+
+			ndInt32 Compare(const ndBvhNode* const nodeA, const ndBvhNode* const nodeB) const
+			{
+				const ndFloat32 keyA = nodeA->m_minBox[m_axis] + nodeA->m_maxBox[m_axis];
+				const ndFloat32 keyB = nodeB->m_minBox[m_axis] + nodeB->m_maxBox[m_axis];
+				if (keyA < keyB)
+				{
+					return -1;
+				}
+				else if (keyA > keyB)
+				{
+					return 1;
+				}
+				return 0;
+			}
+
+			ndInt32 m_axis;
+		};
+		ndSort<ndBvhNode*, ndCompareKey>(leaves, count, &axis);
+		return count / 2;
+	}
+
+	// serial splits run concurrently from the sub tree jobs, so they bin on the stack.
+	ndBvhSahBin localBins[D_BVH_SAH_BINS];
+	if (parallel)
+	{
+		m_bvhBuildState.m_sahBins.SetCount(threadCount * D_BVH_SAH_BINS);
+	}
+	ndBvhSahBin* const threadBins = parallel ? &m_bvhBuildState.m_sahBins[0] : localBins;
+	const ndFloat32 origin = minP[axis];
+	const ndFloat32 scale = ndFloat32(D_BVH_SAH_BINS) * ndFloat32(0.999f) / extent;
+	auto BinLeaves = ndMakeObject::ndFunction([leaves, count, axis, origin, scale, threadBins, bigLeaf](ndInt32 threadIndex, ndInt32 threadCount)
+	{
+		D_TRACKTIME_NAMED(BinLeaves);
+		ndBvhSahBin* const bins = &threadBins[threadIndex * D_BVH_SAH_BINS];
+		for (ndInt32 i = 0; i < D_BVH_SAH_BINS; ++i)
+		{
+			bins[i].m_minBox = ndVector(ndFloat32(1.0e15f));
+			bins[i].m_maxBox = ndVector(ndFloat32(-1.0e15f));
+			bins[i].m_count = 0;
+		}
+
+		const ndStartEnd startEnd(count, threadIndex, threadCount);
+		for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
+		{
+			if (i == bigLeaf)
+			{
+				continue;
+			}
+			const ndBvhNode* const node = leaves[i];
+			const ndFloat32 centroid = node->m_minBox[axis] + node->m_maxBox[axis];
+			const ndInt32 index = ndClamp(ndInt32((centroid - origin) * scale), 0, D_BVH_SAH_BINS - 1);
+			ndBvhSahBin& bin = bins[index];
+			bin.m_minBox = bin.m_minBox.GetMin(node->m_minBox);
+			bin.m_maxBox = bin.m_maxBox.GetMax(node->m_maxBox);
+			bin.m_count++;
+		}
+	});
+
+	if (parallel)
+	{
+		threadPool.ParallelExecute(BinLeaves);
+	}
+	else
+	{
+		BinLeaves(0, 1);
+	}
+
+	ndBvhSahBin* const bins = threadBins;
+	for (ndInt32 i = 1; i < threadCount; ++i)
+	{
+		const ndBvhSahBin* const srcBins = &threadBins[i * D_BVH_SAH_BINS];
+		for (ndInt32 j = 0; j < D_BVH_SAH_BINS; ++j)
+		{
+			bins[j].m_minBox = bins[j].m_minBox.GetMin(srcBins[j].m_minBox);
+			bins[j].m_maxBox = bins[j].m_maxBox.GetMax(srcBins[j].m_maxBox);
+			bins[j].m_count += srcBins[j].m_count;
+		}
+	}
+
+	// cost of splitting off the largest leaf, then put it back in its bin.
+	ndVector minBox(ndFloat32(1.0e15f));
+	ndVector maxBox(ndFloat32(-1.0e15f));
+	for (ndInt32 i = 0; i < D_BVH_SAH_BINS; ++i)
+	{
+		minBox = minBox.GetMin(bins[i].m_minBox);
+		maxBox = maxBox.GetMax(bins[i].m_maxBox);
+	}
+	const ndFloat32 bigLeafCost = bigLeafArea + ndFloat32(count - 1) * ndBvhNode::CalculateSurfaceArea(minBox, maxBox);
+
+	const ndBvhNode* const bigNode = leaves[bigLeaf];
+	const ndFloat32 bigCentroid = bigNode->m_minBox[axis] + bigNode->m_maxBox[axis];
+	ndBvhSahBin& bigBin = bins[ndClamp(ndInt32((bigCentroid - origin) * scale), 0, D_BVH_SAH_BINS - 1)];
+	bigBin.m_minBox = bigBin.m_minBox.GetMin(bigNode->m_minBox);
+	bigBin.m_maxBox = bigBin.m_maxBox.GetMax(bigNode->m_maxBox);
+	bigBin.m_count++;
+
+	// sweep from the right to get the cost of the right side of each split plane, 
+	// then from the left to find the plane with the lowest cost.
+	ndFloat32 rightCost[D_BVH_SAH_BINS];
+	minBox = ndVector(ndFloat32(1.0e15f));
+	maxBox = ndVector(ndFloat32(-1.0e15f));
+	ndInt32 rightCount = 0;
+	for (ndInt32 i = D_BVH_SAH_BINS - 1; i > 0; --i)
+	{
+		minBox = minBox.GetMin(bins[i].m_minBox);
+		maxBox = maxBox.GetMax(bins[i].m_maxBox);
+		rightCount += bins[i].m_count;
+		rightCost[i] = rightCount ? ndFloat32(rightCount) * ndBvhNode::CalculateSurfaceArea(minBox, maxBox) : ndFloat32(1.0e30f);
+	}
+
+	ndInt32 split = 0;
+	ndInt32 leftCount = 0;
+	ndFloat32 bestCost = ndFloat32(1.0e30f);
+	minBox = ndVector(ndFloat32(1.0e15f));
+	maxBox = ndVector(ndFloat32(-1.0e15f));
+	for (ndInt32 i = 0; i < D_BVH_SAH_BINS - 1; ++i)
+	{
+		minBox = minBox.GetMin(bins[i].m_minBox);
+		maxBox = maxBox.GetMax(bins[i].m_maxBox);
+		leftCount += bins[i].m_count;
+		if (leftCount)
+		{
+			const ndFloat32 cost = ndFloat32(leftCount) * ndBvhNode::CalculateSurfaceArea(minBox, maxBox) + rightCost[i + 1];
+			if (cost < bestCost)
+			{
+				split = i;
+				bestCost = cost;
+			}
+		}
+	}
+
+	if (bigLeafCost < bestCost)
+	{
+		ndSwap(leaves[0], leaves[bigLeaf]);
+		return 1;
+	}
+
+	// the extreme centroids land in the first and last bins, so both sides are never empty.
+	ndInt32 i0 = 0;
+	ndInt32 i1 = count - 1;
+	while (i0 <= i1)
+	{
+		const ndBvhNode* const node = leaves[i0];
+		const ndFloat32 centroid = node->m_minBox[axis] + node->m_maxBox[axis];
+		const ndInt32 index = ndClamp(ndInt32((centroid - origin) * scale), 0, D_BVH_SAH_BINS - 1);
+		if (index <= split)
+		{
+			i0++;
+		}
+		else
+		{
+			ndSwap(leaves[i0], leaves[i1]);
+			i1--;
+		}
+	}
+	ndAssert(i0 > 0);
+	ndAssert(i0 < count);
+	return i0;
+}
+
+ndBvhNode* ndBvhSceneManager::BuildSahSubTree(ndThreadPool& threadPool, ndInt32 start, ndInt32 count, ndInt32 depth, ndFloat64& area)
+{
+	if (count == 1)
+	{
+		return m_bvhBuildState.m_srcArray[start];
+	}
+
+	// a range of n leaves owns the internal nodes [start, start + n - 1), the split node 
+	// takes the one slot the left range does not use.
+	const ndInt32 leftCount = SplitSahRange(threadPool, start, count, depth, false);
+	ndBvhInternalNode* const node = (ndBvhInternalNode*)m_bvhBuildState.m_parentsArray[start + leftCount - 1];
+	ndAssert(node->GetAsSceneTreeNode());
+
+	ndBvhNode* const left = BuildSahSubTree(threadPool, start, leftCount, depth + 1, area);
+	ndBvhNode* const right = BuildSahSubTree(threadPool, start + leftCount, count - leftCount, depth + 1, area);
+
+	node->m_left = left;
+	node->m_right = right;
+	left->m_parent = node;
+	right->m_parent = node;
+	node->m_minBox = left->m_minBox.GetMin(right->m_minBox);
+	node->m_maxBox = left->m_maxBox.GetMax(right->m_maxBox);
+	node->m_depthLevel = ndMax(left->m_depthLevel, right->m_depthLevel) + 1;
+	area += ndBvhNode::CalculateSurfaceArea(node->m_minBox, node->m_maxBox);
+	return node;
+}
+
+ndBvhNode* ndBvhSceneManager::BuildSahBvhTree(ndThreadPool& threadPool)
+{
+	D_TRACKTIME();
+	if (!BuildBvhTreeInitNodes(threadPool))
+	{
+		return nullptr;
+	}
+
+	const ndInt32 leafCount = m_bvhBuildState.m_leafNodesCount;
+	const ndInt32 threadCount = threadPool.GetThreadCount();
+	const ndInt32 jobSize = ndMax(leafCount / (threadCount * 8), 256);
+
+	// split the top of the tree until there are enough sub trees to 
+	// distribute across threads, large ranges are binned in parallel.
+	ndArray<ndBvhSahRange>& ranges = m_bvhBuildState.m_sahRanges;
+	ranges.SetCount(0);
+
+	ndBvhSahRange rootRange;
+	rootRange.m_root = nullptr;
+	rootRange.m_parent = nullptr;
+	rootRange.m_start = 0;
+	rootRange.m_count = leafCount;
+	rootRange.m_depth = 0;
+	rootRange.m_isLeft = 0;
+	ranges.PushBack(rootRange);
+
+	for (ndInt32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		const ndBvhSahRange range(ranges[i]);
+		if (range.m_count > jobSize)
+		{
+			const ndInt32 leftCount = SplitSahRange(threadPool, range.m_start, range.m_count, range.m_depth, range.m_count >= D_BVH_SAH_PARALLEL_COUNT);
+			ndBvhInternalNode* const node = (ndBvhInternalNode*)m_bvhBuildState.m_parentsArray[range.m_start + leftCount - 1];
+			ranges[i].m_root = node;
+
+			ndBvhSahRange child;
+			child.m_root = nullptr;
+			child.m_parent = node;
+			child.m_depth = range.m_depth + 1;
+
+			child.m_start = range.m_start;
+			child.m_count = leftCount;
+			child.m_isLeft = 1;
+			ranges.PushBack(child);
+
+			child.m_start = range.m_start + leftCount;
+			child.m_count = range.m_count - leftCount;
+			child.m_isLeft = 0;
+			ranges.PushBack(child);
+		}
+	}
+
+	// the ranges that were not split are built in parallel.
+	ndFloat64* const threadArea = ndAlloca(ndFloat64, threadCount);
+	for (ndInt32 i = 0; i < threadCount; ++i)
+	{
+		threadArea[i] = ndFloat64(0.0f);
+	}
+
+	ndAtomic<ndInt32> iterator(0);
+	auto BuildSubTrees = ndMakeObject::ndFunction([this, &iterator, &threadPool, &ranges, &threadArea, jobSize](ndInt32 threadIndex, ndInt32)
+	{
+		D_TRACKTIME_NAMED(BuildSubTrees);
+		ndFloat64 area = ndFloat64(0.0f);
+		const ndInt32 count = ranges.GetCount();
+		for (ndInt32 i = iterator++; i < count; i = iterator++)
+		{
+			ndBvhSahRange& range = ranges[i];
+			if (range.m_count <= jobSize)
+			{
+				range.m_root = BuildSahSubTree(threadPool, range.m_start, range.m_count, range.m_depth, area);
+			}
+		}
+		threadArea[threadIndex] += area;
+	});
+	threadPool.ParallelExecute(BuildSubTrees);
+
+	ndFloat64 area = ndFloat64(0.0f);
+	for (ndInt32 i = 0; i < threadCount; ++i)
+	{
+		area += threadArea[i];
+	}
+
+	// children ranges are always after their parent, so going backward 
+	// completes the top of the tree bottom up.
+	for (ndInt32 i = ranges.GetCount() - 1; i >= 0; --i)
+	{
+		const ndBvhSahRange& range = ranges[i];
+		ndBvhNode* const root = range.m_root;
+		if (range.m_count > jobSize)
+		{
+			ndBvhInternalNode* const node = root->GetAsSceneTreeNode();
+			node->m_minBox = node->m_left->m_minBox.GetMin(node->m_right->m_minBox);
+			node->m_maxBox = node->m_left->m_maxBox.GetMax(node->m_right->m_maxBox);
+			node->m_depthLevel = ndMax(node->m_left->m_depthLevel, node->m_right->m_depthLevel) + 1;
+			area += ndBvhNode::CalculateSurfaceArea(node->m_minBox, node->m_maxBox);
+		}
+
+		root->m_parent = range.m_parent;
+		if (range.m_parent)
+		{
+			if (range.m_isLeft)
+			{
+				range.m_parent->m_left = root;
+			}
+			else
+			{
+				range.m_parent->m_right = root;
+			}
+		}
+	}
+
+	ndBvhNode* const root = ranges[0].m_root;
+	ndAssert(!root->m_parent);
+	m_bvhBuildState.m_root = root;
+	BuildBvhTreeSetNodesDepth(threadPool);
+	ndAssert(root->SanityCheck(0));
+
+	const ndFloat32 rootArea = ndBvhNode::CalculateSurfaceArea(root->m_minBox, root->m_maxBox);
+	m_internalArea = area;
+	m_buildQuality = (rootArea > ndFloat32(0.0f)) ? ndFloat32(area / rootArea) : ndFloat32(0.0f);
+	return root;
+}
+
+ndFloat32 ndBvhSceneManager::GetTreeQuality(const ndBvhNode* const root) const
+{
+	// sum of the internal node areas relative to the root, the expected 
+	// number of nodes visited by a random query, lower is better.
+	const ndFloat32 rootArea = root ? ndBvhNode::CalculateSurfaceArea(root->m_minBox, root->m_maxBox) : ndFloat32(0.0f);
+	return (rootArea > ndFloat32(0.0f)) ? ndFloat32(m_internalArea / rootArea) : ndFloat32(0.0f);
+}
+
+bool ndBvhSceneManager::IsTreeDegraded(const ndBvhNode* const root) const
+{
+	return GetTreeQuality(root) > (m_buildQuality * D_BVH_SAH_REBUILD_FACTOR);
+}
@@ -40,6 +40,7 @@ class ndBvhNode : public ndContainersFreeListAlloc<ndBvhNode>
 	void Kill();
 	void GetAabb(ndVector& minBox, ndVector& maxBox) const;
 	void SetAabb(const ndVector& minBox, const ndVector& maxBox);
+	static ndFloat32 CalculateSurfaceArea(const ndVector& minBox, const ndVector& maxBox);
 
 	virtual ndBvhNode* GetAsSceneNode() const;
 	virtual ndBvhLeafNode* GetAsSceneBodyNode() const;
@@ -114,6 +115,25 @@ class ndCellScanPrefix
 	ndUnsigned32 m_cellTest : 1;
 };
 
+class ndBvhSahBin
+{
+	public:
+	ndVector m_minBox;
+	ndVector m_maxBox;
+	ndInt32 m_count;
+};
+
+class ndBvhSahRange
+{
+	public:
+	ndBvhNode* m_root;
+	ndBvhInternalNode* m_parent;
+	ndInt32 m_start;
+	ndInt32 m_count;
+	ndInt32 m_depth;
+	ndInt32 m_isLeft;
+};
+
 class ndBuildBvhTreeBuildState
 {
 	public:
@@ -137,6 +157,8 @@ class ndBuildBvhTreeBuildState
 	ndArray<ndCellScanPrefix> m_cellCounts0;
 	ndArray<ndCellScanPrefix> m_cellCounts1;
 	ndArray<ndBvhNode*> m_tempNodeBuffer;
+	ndArray<ndBvhSahBin> m_sahBins;
+	ndArray<ndBvhSahRange> m_sahRanges;
 
 	ndBvhNode* m_root;
 	ndBvhNode** m_srcArray;
@@ -176,6 +198,11 @@ class ndBvhSceneManager
 
 	void UpdateScene(ndThreadPool& threadPool);
 	ndBvhNode* BuildBvhTree(ndThreadPool& threadPool);
+	ndBvhNode* BuildSahBvhTree(ndThreadPool& threadPool);
+
+	void AddSurfaceAreaDelta(ndFloat64 delta);
+	ndFloat32 GetTreeQuality(const ndBvhNode* const root) const;
+	bool IsTreeDegraded(const ndBvhNode* const root) const;
 
 	ndBvhNodeArray& GetNodeArray();
 	ndBvhLeafNode* GetLeafNode(ndBodyKinematic* const body) const;
@@ -190,8 +217,13 @@ class ndBvhSceneManager
 	ndBvhNode* BuildIncrementalBvhTree(ndThreadPool& threadPool);
 	ndInt32 BuildSmallBvhTree(ndThreadPool& threadPool, ndBvhNode** const parentsArray, ndInt32 bashCount);
 
+	ndInt32 SplitSahRange(ndThreadPool& threadPool, ndInt32 start, ndInt32 count, ndInt32 depth, bool parallel);
+	ndBvhNode* BuildSahSubTree(ndThreadPool& threadPool, ndInt32 start, ndInt32 count, ndInt32 depth, ndFloat64& area);
+
 	ndBvhNodeArray m_workingArray;
 	ndBuildBvhTreeBuildState m_bvhBuildState;
+	ndFloat64 m_internalArea;
+	ndFloat32 m_buildQuality;
 };
 
 
@@ -234,6 +266,12 @@ inline ndBvhNode::~ndBvhNode()
 {
 }
 
+inline ndFloat32 ndBvhNode::CalculateSurfaceArea(const ndVector& minBox, const ndVector& maxBox)
+{
+	const ndVector side(ndVector::m_half * (maxBox - minBox));
+	return side.DotProduct(side.ShiftTripleRight()).GetScalar();
+}
+
 inline ndBvhNode* ndBvhNode::GetAsSceneNode() const
 { 
 	return (ndBvhNode*)this;
@@ -327,4 +365,9 @@ inline ndBvhNodeArray& ndBvhSceneManager::GetNodeArray()
 	return m_workingArray;
 }
 
+inline void ndBvhSceneManager::AddSurfaceAreaDelta(ndFloat64 delta)
+{
+	m_internalArea += delta;
+}
+
 #endif
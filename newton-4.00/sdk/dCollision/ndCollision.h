@@ -46,6 +46,7 @@
 #include <ndShapeConvex.h>
 #include <ndBodyListView.h>
 #include <ndContactArray.h>
+#include <ndContactBatch.h>
 #include <ndBodySphFluid.h>
 #include "ndBodySphFluid_New.h"
 #include <ndShapeCapsule.h>
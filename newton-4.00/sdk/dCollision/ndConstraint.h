@@ -121,6 +121,7 @@ class ndForceImpactPair
 	void Clear();
 	void Push(ndFloat32 val);
 	ndFloat32 GetInitialGuess() const;
+	ndFloat32 GetWarmStart() const;
 
 	ndFloat32 m_force;
 	ndFloat32 m_impact;
@@ -252,6 +253,7 @@ class ndConstraint: public ndContainersFreeListAlloc<ndConstraint>
 	friend class ndDynamicsUpdate;
 	friend class ndSkeletonContainer;
 	friend class ndDynamicsUpdateSoa;
+	friend class ndDynamicsUpdateGaussSeidel;
 	friend class ndDynamicsUpdateAvx2;
 } D_GCC_NEWTON_ALIGN_32 ;
 
@@ -25,6 +25,7 @@
 #include "ndContact.h"
 #include "ndBodyKinematic.h"
 #include "ndContactOptions.h"
+#include "ndPolygonMeshDesc.h"
 
 ndVector ndContact::m_initialSeparatingVector(ndFloat32(0.0f), ndFloat32(1.0f), ndFloat32(0.0f), ndFloat32(0.0f));
 
@@ -40,6 +41,7 @@ ndContact::ndContact()
 	,m_separatingVector(m_initialSeparatingVector)
 	,m_contacPointsList()
 	,m_material(nullptr)
+	,m_meshFaceCache(nullptr)
 	,m_timeOfImpact(ndFloat32(1.0e10f))
 	,m_separationDistance(ndFloat32(0.0f))
 	,m_sceneLru(0)
@@ -49,12 +51,17 @@ ndContact::ndContact()
 	,m_isIntersetionTestOnly(0)
 	//,m_skeletonIntraCollision(1)
 	,m_skeletonSelftCollision(1)
+	,m_islandSleep(0)
 {
 	m_active = 0;
 }
 
 ndContact::~ndContact()
 {
+	if (m_meshFaceCache)
+	{
+		delete m_meshFaceCache;
+	}
 }
 
 void ndContact::SetBodies(ndBodyKinematic* const body0, ndBodyKinematic* const body1)
@@ -168,12 +175,24 @@ void ndContact::JacobianContactDerivative(ndConstraintDescritor& desc, const ndC
 	desc.m_forceBounds[normalIndex].m_normalIndex = D_INDEPENDENT_ROW;
 	desc.m_forceBounds[normalIndex].m_jointForce = (ndForceImpactPair*)&contact.m_normal_Force;
 
-	const ndFloat32 restitutionVelocity = (relSpeed > D_REST_RELATIVE_VELOCITY) ? relSpeed * restitutionCoefficient : ndFloat32(0.0f);
-	const ndFloat32 penetrationStiffness = D_MAX_PENETRATION_STIFFNESS * contact.m_material.m_softness;
-	const ndFloat32 penetrationVeloc = penetration * penetrationStiffness;
-	ndAssert(ndAbs(penetrationVeloc - D_MAX_PENETRATION_STIFFNESS * contact.m_material.m_softness * penetration) < ndFloat32(1.0e-6f));
-	desc.m_penetrationStiffness[normalIndex] = penetrationStiffness;
-	relSpeed += ndMax(restitutionVelocity, penetrationVeloc);
+	if (contact.m_penetration < -D_PENETRATION_TOL)
+	{
+		// speculative contact, the shapes are still apart. a negative penetration 
+		// tells JointAccelerations to only remove the approach speed that would 
+		// close the gap in this step, so the row does nothing until the impact.
+		desc.m_penetration[normalIndex] = contact.m_penetration;
+		desc.m_penetrationStiffness[normalIndex] = desc.m_invTimestep;
+		relSpeed += contact.m_penetration * desc.m_invTimestep;
+	}
+	else
+	{
+		const ndFloat32 restitutionVelocity = (relSpeed > D_REST_RELATIVE_VELOCITY) ? relSpeed * restitutionCoefficient : ndFloat32(0.0f);
+		const ndFloat32 penetrationStiffness = D_MAX_PENETRATION_STIFFNESS * contact.m_material.m_softness;
+		const ndFloat32 penetrationVeloc = penetration * penetrationStiffness;
+		ndAssert(ndAbs(penetrationVeloc - D_MAX_PENETRATION_STIFFNESS * contact.m_material.m_softness * penetration) < ndFloat32(1.0e-6f));
+		desc.m_penetrationStiffness[normalIndex] = penetrationStiffness;
+		relSpeed += ndMax(restitutionVelocity, penetrationVeloc);
+	}
 
 	const bool isHardContact = !(contact.m_material.m_flags & m_isSoftContact);
 	desc.m_diagonalRegularizer[normalIndex] = isHardContact ? D_DIAGONAL_REGULARIZER : ndMax(D_DIAGONAL_REGULARIZER, contact.m_material.m_skinMargin);
@@ -319,7 +338,13 @@ void ndContact::JointAccelerations(ndJointAccelerationDecriptor* const desc)
 		
 				ndFloat32 penetrationVeloc = ndFloat32(0.0f);
 				ndFloat32 restitution = (vRel <= ndFloat32(0.0f)) ? (ndFloat32(1.0f) + rhs->m_restitution) : ndFloat32(1.0f);
-				if (rhs->m_penetration > D_RESTING_CONTACT_PENETRATION * ndFloat32(0.125f)) 
+				if (rhs->m_penetration < ndFloat32(0.0f))
+				{
+					// speculative contact, the bodies can approach by the gap in this step.
+					restitution = ndFloat32(1.0f);
+					penetrationVeloc = -(rhs->m_penetration * rhs->m_penetrationStiffness);
+				}
+				else if (rhs->m_penetration > D_RESTING_CONTACT_PENETRATION * ndFloat32(0.125f)) 
 				{
 					if (vRel > ndFloat32(0.0f)) 
 					{
@@ -29,6 +29,7 @@
 
 class ndBodyKinematic;
 class ndShapeInstance;
+class ndStaticMeshFaceCache;
 
 #define D_MAX_CONTATCS					128
 #define D_CONSTRAINT_MAX_ROWS			(3 * 16)
@@ -46,6 +47,7 @@ class ndContactPoint
 	const ndShapeInstance* m_shapeInstance1;
 	ndInt64 m_shapeId0;
 	ndInt64 m_shapeId1;
+	ndUnsigned64 m_featureId;
 	ndFloat32 m_penetration;
 } D_GCC_NEWTON_ALIGN_32;
 
@@ -58,6 +60,7 @@ class ndContactMaterial: public ndContactPoint
 		,m_dir1(ndVector::m_zero)
 		,m_material()
 	{
+		m_featureId = 0;
 		m_dir0_Force.Clear();
 		m_dir1_Force.Clear();
 		m_normal_Force.Clear();
@@ -75,6 +78,26 @@ class ndContactMaterial: public ndContactPoint
 		m_material.m_flags = m_material.m_flags | m_override1Accel;
 	}
 
+	// rotate the cached friction forces from the old to the current friction directions
+	void WarmStartFriction(const ndVector& oldDir0, const ndVector& oldDir1)
+	{
+		const ndFloat32 dot00 = oldDir0.DotProduct(m_dir0).GetScalar();
+		const ndFloat32 dot01 = oldDir0.DotProduct(m_dir1).GetScalar();
+		const ndFloat32 dot10 = oldDir1.DotProduct(m_dir0).GetScalar();
+		const ndFloat32 dot11 = oldDir1.DotProduct(m_dir1).GetScalar();
+		for (ndInt32 i = 0; i < ndInt32(sizeof(m_dir0_Force.m_initialGuess) / sizeof(m_dir0_Force.m_initialGuess[0])); ++i)
+		{
+			const ndFloat32 f0 = m_dir0_Force.m_initialGuess[i];
+			const ndFloat32 f1 = m_dir1_Force.m_initialGuess[i];
+			m_dir0_Force.m_initialGuess[i] = f0 * dot00 + f1 * dot10;
+			m_dir1_Force.m_initialGuess[i] = f0 * dot01 + f1 * dot11;
+		}
+		const ndFloat32 f0 = m_dir0_Force.m_force;
+		const ndFloat32 f1 = m_dir1_Force.m_force;
+		m_dir0_Force.m_force = f0 * dot00 + f1 * dot10;
+		m_dir1_Force.m_force = f0 * dot01 + f1 * dot11;
+	}
+
 	ndVector m_dir0;
 	ndVector m_dir1;
 	ndForceImpactPair m_normal_Force;
@@ -127,6 +150,7 @@ class ndContact: public ndConstraint
 	ndVector m_separatingVector;
 	ndContactPointList m_contacPointsList;
 	ndMaterial* m_material;
+	ndStaticMeshFaceCache* m_meshFaceCache;
 	ndFloat32 m_timeOfImpact;
 	ndFloat32 m_separationDistance;
 	//ndUnsigned32 m_maxDOF;
@@ -136,6 +160,7 @@ class ndContact: public ndConstraint
 	ndUnsigned32 m_isAttached : 1;
 	ndUnsigned32 m_isIntersetionTestOnly : 1;
 	ndUnsigned32 m_skeletonSelftCollision : 1;
+	ndUnsigned32 m_islandSleep : 1;
 	static ndVector m_initialSeparatingVector;
 
 	friend class ndScene;
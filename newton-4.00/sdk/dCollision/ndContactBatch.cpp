@@ -0,0 +1,842 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+*
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndCoreStdafx.h"
+#include "ndCollisionStdafx.h"
+#include "ndShapeBox.h"
+#include "ndShapeSphere.h"
+#include "ndShapeCapsule.h"
+#include "ndContactBatch.h"
+#include "ndShapeInstance.h"
+#include "ndContactSolver.h"
+
+// segments closer to parallel than this generate two contacts
+#define D_CONTACT_BATCH_PARALLEL_SIN2	ndFloat32 (1.0e-3f)
+
+// a box box axis must beat the best face of body0 by this much to be selected,
+// this keeps the reference face from flipping between frames on resting boxes.
+#define D_CONTACT_BATCH_RELATIVE_TOL	ndFloat32 (0.95f)
+#define D_CONTACT_BATCH_ABSOLUTE_TOL	ndFloat32 (1.0e-3f)
+
+// one 3d vector per lane
+class ndSoaVector3
+{
+	public:
+	ndSoaVector3()
+	{
+	}
+
+	ndSoaVector3(const ndVector& x, const ndVector& y, const ndVector& z)
+		:m_x(x)
+		,m_y(y)
+		,m_z(z)
+	{
+	}
+
+	ndSoaVector3(const ndVector& v0, const ndVector& v1, const ndVector& v2, const ndVector& v3)
+	{
+		ndVector w;
+		ndVector::Transpose4x4(m_x, m_y, m_z, w, v0, v1, v2, v3);
+	}
+
+	ndSoaVector3 operator+ (const ndSoaVector3& src) const
+	{
+		return ndSoaVector3(m_x + src.m_x, m_y + src.m_y, m_z + src.m_z);
+	}
+
+	ndSoaVector3 operator- (const ndSoaVector3& src) const
+	{
+		return ndSoaVector3(m_x - src.m_x, m_y - src.m_y, m_z - src.m_z);
+	}
+
+	ndSoaVector3 Scale(const ndVector& scale) const
+	{
+		return ndSoaVector3(m_x * scale, m_y * scale, m_z * scale);
+	}
+
+	ndVector DotProduct(const ndSoaVector3& src) const
+	{
+		return m_x * src.m_x + m_y * src.m_y + m_z * src.m_z;
+	}
+
+	ndVector GetVector(ndInt32 lane) const
+	{
+		return ndVector(m_x[lane], m_y[lane], m_z[lane], ndFloat32(0.0f));
+	}
+
+	ndVector GetPoint(ndInt32 lane) const
+	{
+		return ndVector(m_x[lane], m_y[lane], m_z[lane], ndFloat32(1.0f));
+	}
+
+	ndVector m_x;
+	ndVector m_y;
+	ndVector m_z;
+};
+
+static void AddContact(ndContactBatch::ndPair& pair, const ndVector& point, const ndVector& normal, ndFloat32 penetration)
+{
+	ndAssert(pair.m_count < D_CONTACT_BATCH_MAX_POINTS);
+	ndContactPoint& contact = pair.m_contacts[pair.m_count];
+	contact.m_point = point;
+	contact.m_normal = normal;
+	contact.m_body0 = nullptr;
+	contact.m_body1 = nullptr;
+	contact.m_shapeInstance0 = pair.m_instance0;
+	contact.m_shapeInstance1 = pair.m_instance1;
+	contact.m_shapeId0 = 0;
+	contact.m_shapeId1 = 0;
+	contact.m_featureId = 0;
+	contact.m_penetration = penetration;
+	pair.m_count++;
+}
+
+// contacts between the closest points of two round shapes, pointA and pointB
+// are the closest points of the inner segments, lanes with the swap mask set
+// have shape A in body1.
+static void RoundContacts(ndContactBatch::ndPair* const pairs, ndInt32 count,
+	const ndSoaVector3& pointA, const ndSoaVector3& pointB,
+	const ndVector& radiusA, const ndVector& radiusB, const ndVector& swapMask)
+{
+	const ndSoaVector3 dist(pointB - pointA);
+	const ndVector dist2(dist.DotProduct(dist));
+	const ndVector valid(dist2 > ndVector(ndFloat32(1.0e-12f)));
+	const ndVector mag(dist2.Sqrt());
+	const ndVector invMag(ndVector::m_one.Divide(ndVector::m_one.Select(mag, valid)));
+	const ndSoaVector3 dir(dist.Scale(invMag));
+
+	const ndVector penetration(radiusA + radiusB - mag - ndVector(D_PENETRATION_TOL));
+	const ndSoaVector3 point((pointA + dir.Scale(radiusA) + pointB - dir.Scale(radiusB)).Scale(ndVector::m_half));
+	const ndSoaVector3 separatingVector(dir.Scale(ndVector::m_one.Select(ndVector::m_negOne, swapMask)));
+
+	const ndInt32 validMask = valid.GetSignMask();
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndContactBatch::ndPair& pair = pairs[i];
+		pair.m_count = 0;
+		pair.m_separatingVector = separatingVector.GetVector(i);
+		pair.m_separationDistance = -penetration[i];
+		if (!((validMask >> i) & 1))
+		{
+			// the inner points touch, concentric shapes or crossing segments
+			// have no direction, the pair goes to the generic solver.
+			pair.m_degenerate = 1;
+		}
+		else if (penetration[i] >= ndFloat32(0.0f))
+		{
+			AddContact(pair, point.GetPoint(i), pair.m_separatingVector * ndVector::m_negOne, penetration[i]);
+		}
+	}
+}
+
+// segments are parameterized from their center.
+static ndFloat32 ClampSegmentParam(ndFloat32 param, ndFloat32 halfLength)
+{
+	return ndClamp(param, -halfLength, halfLength);
+}
+
+// keep the part of the polygon on the negative side of the plane dir * p = dist
+static ndInt32 ClipPolygon(const ndVector* const polygon, ndInt32 count, ndVector* const output, const ndVector& dir, ndFloat32 dist)
+{
+	ndInt32 outCount = 0;
+	if (count)
+	{
+		ndVector p0(polygon[count - 1]);
+		ndFloat32 side0 = dir.DotProduct(p0).GetScalar() - dist;
+		for (ndInt32 i = 0; i < count; ++i)
+		{
+			const ndVector p1(polygon[i]);
+			const ndFloat32 side1 = dir.DotProduct(p1).GetScalar() - dist;
+			if ((side0 > ndFloat32(0.0f)) != (side1 > ndFloat32(0.0f)))
+			{
+				const ndFloat32 t = side0 / (side0 - side1);
+				output[outCount++] = p0 + (p1 - p0).Scale(t);
+			}
+			if (side1 <= ndFloat32(0.0f))
+			{
+				output[outCount++] = p1;
+			}
+			p0 = p1;
+			side0 = side1;
+		}
+	}
+	return outCount;
+}
+
+// reference face of one box against the most anti parallel face of the other,
+// the points of the clipped incident face below the reference face are the contacts.
+static void BoxBoxFaceContacts(ndContactBatch::ndPair& pair,
+	const ndMatrix& refMatrix, const ndVector& refSize, ndInt32 refAxis, const ndVector& refNormal,
+	const ndMatrix& incMatrix, const ndVector& incSize, const ndVector& normal)
+{
+	const ndVector faceCenter(refMatrix.m_posit + refNormal.Scale(refSize[refAxis]));
+	const ndInt32 u = (refAxis + 1) % 3;
+	const ndInt32 v = (refAxis + 2) % 3;
+
+	ndInt32 incAxis = 0;
+	ndFloat32 maxProject = ndFloat32(-1.0f);
+	for (ndInt32 i = 0; i < 3; ++i)
+	{
+		const ndFloat32 project = ndAbs(refNormal.DotProduct(incMatrix[i]).GetScalar());
+		if (project > maxProject)
+		{
+			incAxis = i;
+			maxProject = project;
+		}
+	}
+	const ndFloat32 incSign = (refNormal.DotProduct(incMatrix[incAxis]).GetScalar() > ndFloat32(0.0f)) ? ndFloat32(-1.0f) : ndFloat32(1.0f);
+	const ndVector incCenter(incMatrix.m_posit + incMatrix[incAxis].Scale(incSign * incSize[incAxis]));
+	const ndVector edge0(incMatrix[(incAxis + 1) % 3].Scale(incSize[(incAxis + 1) % 3]));
+	const ndVector edge1(incMatrix[(incAxis + 2) % 3].Scale(incSize[(incAxis + 2) % 3]));
+
+	ndVector buffer0[8];
+	ndVector buffer1[8];
+	buffer0[0] = incCenter + edge0 + edge1;
+	buffer0[1] = incCenter - edge0 + edge1;
+	buffer0[2] = incCenter - edge0 - edge1;
+	buffer0[3] = incCenter + edge0 - edge1;
+
+	const ndVector& dirU = refMatrix[u];
+	const ndVector& dirV = refMatrix[v];
+	const ndFloat32 centerU = dirU.DotProduct(faceCenter).GetScalar();
+	const ndFloat32 centerV = dirV.DotProduct(faceCenter).GetScalar();
+	ndInt32 count = ClipPolygon(buffer0, 4, buffer1, dirU, centerU + refSize[u]);
+	count = ClipPolygon(buffer1, count, buffer0, dirU * ndVector::m_negOne, refSize[u] - centerU);
+	count = ClipPolygon(buffer0, count, buffer1, dirV, centerV + refSize[v]);
+	count = ClipPolygon(buffer1, count, buffer0, dirV * ndVector::m_negOne, refSize[v] - centerV);
+
+	ndInt32 pointCount = 0;
+	ndVector points[8];
+	ndFloat32 penetration[8];
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		const ndFloat32 separation = refNormal.DotProduct(buffer0[i] - faceCenter).GetScalar();
+		if (separation <= D_PENETRATION_TOL)
+		{
+			points[pointCount] = buffer0[i] - refNormal.Scale(separation * ndFloat32(0.5f));
+			penetration[pointCount] = D_PENETRATION_TOL - separation;
+			pointCount++;
+		}
+	}
+
+	if (pointCount > D_CONTACT_BATCH_MAX_POINTS)
+	{
+		// keep the deepest point, the farthest from it, and the two points
+		// that make the largest triangles at each side of that diagonal.
+		ndInt32 index[4];
+		index[0] = 0;
+		for (ndInt32 i = 1; i < pointCount; ++i)
+		{
+			if (penetration[i] > penetration[index[0]])
+			{
+				index[0] = i;
+			}
+		}
+
+		index[1] = index[0];
+		ndFloat32 maxDist2 = ndFloat32(-1.0f);
+		for (ndInt32 i = 0; i < pointCount; ++i)
+		{
+			const ndVector dist(points[i] - points[index[0]]);
+			const ndFloat32 dist2 = dist.DotProduct(dist).GetScalar();
+			if (dist2 > maxDist2)
+			{
+				index[1] = i;
+				maxDist2 = dist2;
+			}
+		}
+
+		index[2] = index[0];
+		index[3] = index[1];
+		ndFloat32 maxArea = ndFloat32(0.0f);
+		ndFloat32 minArea = ndFloat32(0.0f);
+		const ndVector diagonal(points[index[1]] - points[index[0]]);
+		for (ndInt32 i = 0; i < pointCount; ++i)
+		{
+			const ndFloat32 area = refNormal.DotProduct(diagonal.CrossProduct(points[i] - points[index[0]])).GetScalar();
+			if (area > maxArea)
+			{
+				index[2] = i;
+				maxArea = area;
+			}
+			else if (area < minArea)
+			{
+				index[3] = i;
+				minArea = area;
+			}
+		}
+
+		ndInt32 reducedCount = 0;
+		ndVector reducedPoints[4];
+		ndFloat32 reducedPenetration[4];
+		for (ndInt32 i = 0; i < 4; ++i)
+		{
+			bool duplicate = false;
+			for (ndInt32 j = 0; j < i; ++j)
+			{
+				duplicate = duplicate || (index[j] == index[i]);
+			}
+			if (!duplicate)
+			{
+				reducedPoints[reducedCount] = points[index[i]];
+				reducedPenetration[reducedCount] = penetration[index[i]];
+				reducedCount++;
+			}
+		}
+		for (ndInt32 i = 0; i < reducedCount; ++i)
+		{
+			points[i] = reducedPoints[i];
+			penetration[i] = reducedPenetration[i];
+		}
+		pointCount = reducedCount;
+	}
+
+	for (ndInt32 i = 0; i < pointCount; ++i)
+	{
+		AddContact(pair, points[i] | ndVector::m_wOne, normal, penetration[i]);
+	}
+}
+
+// closest points of the two supporting edges along the separating axis.
+static void BoxBoxEdgeContacts(ndContactBatch::ndPair& pair,
+	const ndMatrix& matrix0, const ndVector& size0, ndInt32 axis0,
+	const ndMatrix& matrix1, const ndVector& size1, ndInt32 axis1, const ndVector& separatingVector)
+{
+	ndVector center0(matrix0.m_posit & ndVector::m_triplexMask);
+	ndVector center1(matrix1.m_posit & ndVector::m_triplexMask);
+	for (ndInt32 i = 0; i < 3; ++i)
+	{
+		if (i != axis0)
+		{
+			const ndFloat32 sign = (matrix0[i].DotProduct(separatingVector).GetScalar() > ndFloat32(0.0f)) ? ndFloat32(1.0f) : ndFloat32(-1.0f);
+			center0 += matrix0[i].Scale(sign * size0[i]);
+		}
+		if (i != axis1)
+		{
+			const ndFloat32 sign = (matrix1[i].DotProduct(separatingVector).GetScalar() > ndFloat32(0.0f)) ? ndFloat32(-1.0f) : ndFloat32(1.0f);
+			center1 += matrix1[i].Scale(sign * size1[i]);
+		}
+	}
+
+	const ndVector& dir0 = matrix0[axis0];
+	const ndVector& dir1 = matrix1[axis1];
+	const ndVector dist(center0 - center1);
+	const ndFloat32 dir01 = dir0.DotProduct(dir1).GetScalar();
+	const ndFloat32 proj0 = dir0.DotProduct(dist).GetScalar();
+	const ndFloat32 proj1 = dir1.DotProduct(dist).GetScalar();
+	const ndFloat32 den = ndMax(ndFloat32(1.0f) - dir01 * dir01, ndFloat32(1.0e-6f));
+	ndFloat32 param0 = ClampSegmentParam((dir01 * proj1 - proj0) / den, size0[axis0]);
+	const ndFloat32 param1 = ClampSegmentParam(proj1 + dir01 * param0, size1[axis1]);
+	param0 = ClampSegmentParam(dir01 * param1 - proj0, size0[axis0]);
+
+	const ndVector point0(center0 + dir0.Scale(param0));
+	const ndVector point1(center1 + dir1.Scale(param1));
+	const ndFloat32 penetration = D_PENETRATION_TOL - separatingVector.DotProduct(point1 - point0).GetScalar();
+	if (penetration >= ndFloat32(0.0f))
+	{
+		AddContact(pair, (point0 + point1).Scale(ndFloat32(0.5f)) | ndVector::m_wOne, separatingVector * ndVector::m_negOne, penetration);
+	}
+}
+
+ndInt32 ndContactBatch::GetShapeClass(const ndShapeInstance& instance)
+{
+	// 0: generic, 1: sphere, 2: capsule, 3: box
+	if ((instance.GetScaleType() > ndShapeInstance::m_uniform) || (instance.m_skinMargin != ndFloat32(0.0f)))
+	{
+		return 0;
+	}
+	ndShape* const shape = (ndShape*)instance.GetShape();
+	if (shape->GetAsShapeSphere())
+	{
+		return 1;
+	}
+	const ndShapeCapsule* const capsule = shape->GetAsShapeCapsule();
+	if (capsule)
+	{
+		return (capsule->m_radius0 == capsule->m_radius1) ? 2 : 0;
+	}
+	if (shape->GetAsShapeBox())
+	{
+		return 3;
+	}
+	return 0;
+}
+
+ndContactBatch::ndPairType ndContactBatch::GetPairType(const ndShapeInstance& instance0, const ndShapeInstance& instance1)
+{
+	static const ndPairType pairTypes[4][4] =
+	{
+		{ m_generic, m_generic, m_generic, m_generic },
+		{ m_generic, m_sphereSphere, m_sphereCapsule, m_sphereBox },
+		{ m_generic, m_sphereCapsule, m_capsuleCapsule, m_generic },
+		{ m_generic, m_sphereBox, m_generic, m_boxBox },
+	};
+	return pairTypes[GetShapeClass(instance0)][GetShapeClass(instance1)];
+}
+
+void ndContactBatch::GetSegment(const ndShapeInstance& instance, ndVector& p0, ndVector& p1, ndFloat32& radius)
+{
+	const ndMatrix& matrix = instance.m_globalMatrix;
+	const ndFloat32 scale = instance.GetScale().m_x;
+	ndShape* const shape = (ndShape*)instance.GetShape();
+	const ndShapeCapsule* const capsule = shape->GetAsShapeCapsule();
+	if (capsule)
+	{
+		const ndVector step(matrix.m_front.Scale(capsule->m_height * scale));
+		p0 = matrix.m_posit - step;
+		p1 = matrix.m_posit + step;
+		radius = capsule->m_radius0 * scale;
+	}
+	else
+	{
+		const ndShapeSphere* const sphere = shape->GetAsShapeSphere();
+		ndAssert(sphere);
+		p0 = matrix.m_posit;
+		p1 = matrix.m_posit;
+		radius = sphere->m_radius * scale;
+	}
+}
+
+ndVector ndContactBatch::GetBoxSize(const ndShapeInstance& instance)
+{
+	const ndShapeBox* const box = ((ndShape*)instance.GetShape())->GetAsShapeBox();
+	ndAssert(box);
+	return box->m_size[0].Scale(instance.GetScale().m_x);
+}
+
+void ndContactBatch::SphereSphereContacts(ndPair* const pairs, ndInt32 count)
+{
+	ndVector center0[D_CONTACT_BATCH_WIDTH];
+	ndVector center1[D_CONTACT_BATCH_WIDTH];
+	ndFloat32 radius0[D_CONTACT_BATCH_WIDTH];
+	ndFloat32 radius1[D_CONTACT_BATCH_WIDTH];
+	for (ndInt32 i = 0; i < D_CONTACT_BATCH_WIDTH; ++i)
+	{
+		const ndPair& pair = pairs[ndMin(i, count - 1)];
+		GetSegment(*pair.m_instance0, center0[i], center0[i], radius0[i]);
+		GetSegment(*pair.m_instance1, center1[i], center1[i], radius1[i]);
+	}
+
+	const ndSoaVector3 pointA(center0[0], center0[1], center0[2], center0[3]);
+	const ndSoaVector3 pointB(center1[0], center1[1], center1[2], center1[3]);
+	RoundContacts(pairs, count, pointA, pointB, ndVector(&radius0[0]), ndVector(&radius1[0]), ndVector::m_zero);
+}
+
+void ndContactBatch::SphereCapsuleContacts(ndPair* const pairs, ndInt32 count)
+{
+	ndVector center[D_CONTACT_BATCH_WIDTH];
+	ndVector segment0[D_CONTACT_BATCH_WIDTH];
+	ndVector segment1[D_CONTACT_BATCH_WIDTH];
+	ndFloat32 radiusA[D_CONTACT_BATCH_WIDTH];
+	ndFloat32 radiusB[D_CONTACT_BATCH_WIDTH];
+	ndInt32 swap[D_CONTACT_BATCH_WIDTH];
+	for (ndInt32 i = 0; i < D_CONTACT_BATCH_WIDTH; ++i)
+	{
+		const ndPair& pair = pairs[ndMin(i, count - 1)];
+		const bool swapped = ((ndShape*)pair.m_instance0->GetShape())->GetAsShapeCapsule() ? true : false;
+		const ndShapeInstance& sphere = swapped ? *pair.m_instance1 : *pair.m_instance0;
+		const ndShapeInstance& capsule = swapped ? *pair.m_instance0 : *pair.m_instance1;
+		GetSegment(sphere, center[i], center[i], radiusA[i]);
+		GetSegment(capsule, segment0[i], segment1[i], radiusB[i]);
+		swap[i] = swapped ? -1 : 0;
+	}
+
+	const ndSoaVector3 pointA(center[0], center[1], center[2], center[3]);
+	const ndSoaVector3 p0(segment0[0], segment0[1], segment0[2], segment0[3]);
+	const ndSoaVector3 p1(segment1[0], segment1[1], segment1[2], segment1[3]);
+	const ndSoaVector3 dir(p1 - p0);
+	const ndVector param((dir.DotProduct(pointA - p0).Divide(dir.DotProduct(dir))).GetMax(ndVector::m_zero).GetMin(ndVector::m_one));
+	const ndSoaVector3 pointB(p0 + dir.Scale(param));
+
+	const ndVector swapMask(swap[0], swap[1], swap[2], swap[3]);
+	RoundContacts(pairs, count, pointA, pointB, ndVector(&radiusA[0]), ndVector(&radiusB[0]), swapMask);
+}
+
+void ndContactBatch::CapsuleCapsuleContacts(ndPair* const pairs, ndInt32 count)
+{
+	ndVector segmentA0[D_CONTACT_BATCH_WIDTH];
+	ndVector segmentA1[D_CONTACT_BATCH_WIDTH];
+	ndVector segmentB0[D_CONTACT_BATCH_WIDTH];
+	ndVector segmentB1[D_CONTACT_BATCH_WIDTH];
+	ndFloat32 radiusA[D_CONTACT_BATCH_WIDTH];
+	ndFloat32 radiusB[D_CONTACT_BATCH_WIDTH];
+	for (ndInt32 i = 0; i < D_CONTACT_BATCH_WIDTH; ++i)
+	{
+		const ndPair& pair = pairs[ndMin(i, count - 1)];
+		GetSegment(*pair.m_instance0, segmentA0[i], segmentA1[i], radiusA[i]);
+		GetSegment(*pair.m_instance1, segmentB0[i], segmentB1[i], radiusB[i]);
+	}
+
+	// closest points of two segments, the degenerate parallel case clamps the
+	// param of segment A to zero. the nearly parallel lanes still solve the
+	// closest points, and get the two contacts added after.
+	const ndSoaVector3 a0(segmentA0[0], segmentA0[1], segmentA0[2], segmentA0[3]);
+	const ndSoaVector3 a1(segmentA1[0], segmentA1[1], segmentA1[2], segmentA1[3]);
+	const ndSoaVector3 b0(segmentB0[0], segmentB0[1], segmentB0[2], segmentB0[3]);
+	const ndSoaVector3 b1(segmentB1[0], segmentB1[1], segmentB1[2], segmentB1[3]);
+	const ndSoaVector3 dirA(a1 - a0);
+	const ndSoaVector3 dirB(b1 - b0);
+	const ndSoaVector3 dist(a0 - b0);
+
+	const ndVector aa(dirA.DotProduct(dirA));
+	const ndVector bb(dirB.DotProduct(dirB));
+	const ndVector ab(dirA.DotProduct(dirB));
+	const ndVector ad(dirA.DotProduct(dist));
+	const ndVector bd(dirB.DotProduct(dist));
+	const ndVector den(aa * bb - ab * ab);
+	const ndVector parallel(den <= ndVector(D_CONTACT_BATCH_PARALLEL_SIN2) * aa * bb);
+
+	const ndVector notDegenerate(den > ndVector(ndFloat32(1.0e-12f)) * aa * bb);
+	ndVector paramA(ndVector::m_zero.Select((ab * bd - ad * bb).Divide(ndVector::m_one.Select(den, notDegenerate)), notDegenerate));
+	paramA = paramA.GetMax(ndVector::m_zero).GetMin(ndVector::m_one);
+	ndVector paramB((ab * paramA + bd).Divide(bb));
+	const ndVector paramAOfB0((ndVector::m_zero - ad).Divide(aa).GetMax(ndVector::m_zero).GetMin(ndVector::m_one));
+	const ndVector paramAOfB1((ab - ad).Divide(aa).GetMax(ndVector::m_zero).GetMin(ndVector::m_one));
+	paramA = paramA.Select(paramAOfB0, paramB < ndVector::m_zero);
+	paramA = paramA.Select(paramAOfB1, paramB > ndVector::m_one);
+	paramB = paramB.GetMax(ndVector::m_zero).GetMin(ndVector::m_one);
+
+	const ndSoaVector3 pointA(a0 + dirA.Scale(paramA));
+	const ndSoaVector3 pointB(b0 + dirB.Scale(paramB));
+	RoundContacts(pairs, count, pointA, pointB, ndVector(&radiusA[0]), ndVector(&radiusB[0]), ndVector::m_zero);
+
+	const ndInt32 parallelMask = parallel.GetSignMask();
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndPair& pair = pairs[i];
+		if (((parallelMask >> i) & 1) && pair.m_count)
+		{
+			// two contacts at the ends of the overlap of the two segments.
+			const ndVector sepDir(pair.m_separatingVector);
+			const ndVector segA(segmentA1[i] - segmentA0[i]);
+			const ndVector segB(segmentB1[i] - segmentB0[i]);
+			const ndFloat32 invLenA2 = ndFloat32(1.0f) / segA.DotProduct(segA).GetScalar();
+			const ndFloat32 invLenB2 = ndFloat32(1.0f) / segB.DotProduct(segB).GetScalar();
+			const ndFloat32 t0 = segA.DotProduct(segmentB0[i] - segmentA0[i]).GetScalar() * invLenA2;
+			const ndFloat32 t1 = segA.DotProduct(segmentB1[i] - segmentA0[i]).GetScalar() * invLenA2;
+			const ndFloat32 tMin = ndMax(ndMin(t0, t1), ndFloat32(0.0f));
+			const ndFloat32 tMax = ndMin(ndMax(t0, t1), ndFloat32(1.0f));
+			if ((tMax - tMin) * ndSqrt(segA.DotProduct(segA).GetScalar()) > ndFloat32(1.0e-3f))
+			{
+				const ndVector normal(pair.m_contacts[0].m_normal);
+				pair.m_count = 0;
+				const ndFloat32 params[] = { tMin, tMax };
+				for (ndInt32 j = 0; j < 2; ++j)
+				{
+					const ndVector pA(segmentA0[i] + segA.Scale(params[j]));
+					const ndFloat32 tB = ndClamp(segB.DotProduct(pA - segmentB0[i]).GetScalar() * invLenB2, ndFloat32(0.0f), ndFloat32(1.0f));
+					const ndVector pB(segmentB0[i] + segB.Scale(tB));
+					const ndFloat32 penetration = radiusA[i] + radiusB[i] - sepDir.DotProduct(pB - pA).GetScalar() - D_PENETRATION_TOL;
+					if (penetration >= ndFloat32(0.0f))
+					{
+						const ndVector point((pA + sepDir.Scale(radiusA[i]) + pB - sepDir.Scale(radiusB[i])).Scale(ndFloat32(0.5f)));
+						AddContact(pair, (point & ndVector::m_triplexMask) | ndVector::m_wOne, normal, penetration);
+					}
+				}
+			}
+		}
+	}
+}
+
+void ndContactBatch::SphereBoxContacts(ndPair* const pairs, ndInt32 count)
+{
+	ndMatrix matrix[D_CONTACT_BATCH_WIDTH];
+	ndVector size[D_CONTACT_BATCH_WIDTH];
+	ndVector center[D_CONTACT_BATCH_WIDTH];
+	ndFloat32 radius[D_CONTACT_BATCH_WIDTH];
+	ndInt32 swap[D_CONTACT_BATCH_WIDTH];
+	for (ndInt32 i = 0; i < D_CONTACT_BATCH_WIDTH; ++i)
+	{
+		const ndPair& pair = pairs[ndMin(i, count - 1)];
+		const bool swapped = ((ndShape*)pair.m_instance0->GetShape())->GetAsShapeBox() ? true : false;
+		const ndShapeInstance& sphere = swapped ? *pair.m_instance1 : *pair.m_instance0;
+		const ndShapeInstance& box = swapped ? *pair.m_instance0 : *pair.m_instance1;
+		GetSegment(sphere, center[i], center[i], radius[i]);
+		matrix[i] = box.m_globalMatrix;
+		size[i] = GetBoxSize(box);
+		swap[i] = swapped ? -1 : 0;
+	}
+
+	const ndSoaVector3 front(matrix[0].m_front, matrix[1].m_front, matrix[2].m_front, matrix[3].m_front);
+	const ndSoaVector3 up(matrix[0].m_up, matrix[1].m_up, matrix[2].m_up, matrix[3].m_up);
+	const ndSoaVector3 right(matrix[0].m_right, matrix[1].m_right, matrix[2].m_right, matrix[3].m_right);
+	const ndSoaVector3 origin(matrix[0].m_posit, matrix[1].m_posit, matrix[2].m_posit, matrix[3].m_posit);
+	const ndSoaVector3 extent(size[0], size[1], size[2], size[3]);
+	const ndSoaVector3 sphereCenter(center[0], center[1], center[2], center[3]);
+	const ndVector sphereRadius(&radius[0]);
+
+	// sphere center in the box space, and its closest point in the box
+	const ndSoaVector3 dist(sphereCenter - origin);
+	const ndSoaVector3 local(front.DotProduct(dist), up.DotProduct(dist), right.DotProduct(dist));
+	const ndSoaVector3 clamped(
+		local.m_x.GetMax(ndVector::m_zero - extent.m_x).GetMin(extent.m_x),
+		local.m_y.GetMax(ndVector::m_zero - extent.m_y).GetMin(extent.m_y),
+		local.m_z.GetMax(ndVector::m_zero - extent.m_z).GetMin(extent.m_z));
+	const ndSoaVector3 outsideDist(local - clamped);
+	const ndVector outsideDist2(outsideDist.DotProduct(outsideDist));
+	const ndVector outside(outsideDist2 > ndVector(ndFloat32(1.0e-12f)));
+	const ndVector outsideMag(outsideDist2.Sqrt());
+	const ndVector invOutsideMag(ndVector::m_one.Divide(ndVector::m_one.Select(outsideMag, outside)));
+
+	// a center inside the box is pushed out through the closest face
+	const ndVector faceDistX(extent.m_x - local.m_x.Abs());
+	const ndVector faceDistY(extent.m_y - local.m_y.Abs());
+	const ndVector faceDistZ(extent.m_z - local.m_z.Abs());
+	const ndVector faceX((faceDistX <= faceDistY) & (faceDistX <= faceDistZ));
+	const ndVector faceY(ndVector::m_xyzwMask.AndNot(faceX) & (faceDistY <= faceDistZ));
+	const ndVector faceZ(ndVector::m_xyzwMask.AndNot(faceX | faceY));
+	const ndVector faceDist(faceDistX.GetMin(faceDistY).GetMin(faceDistZ));
+	const ndSoaVector3 sign(
+		ndVector::m_one.Select(ndVector::m_negOne, local.m_x < ndVector::m_zero),
+		ndVector::m_one.Select(ndVector::m_negOne, local.m_y < ndVector::m_zero),
+		ndVector::m_one.Select(ndVector::m_negOne, local.m_z < ndVector::m_zero));
+	const ndSoaVector3 insideNormal(sign.m_x & faceX, sign.m_y & faceY, sign.m_z & faceZ);
+	const ndSoaVector3 insideSurface(
+		local.m_x.Select(sign.m_x * extent.m_x, faceX),
+		local.m_y.Select(sign.m_y * extent.m_y, faceY),
+		local.m_z.Select(sign.m_z * extent.m_z, faceZ));
+
+	const ndSoaVector3 localNormal(
+		insideNormal.m_x.Select(outsideDist.m_x * invOutsideMag, outside),
+		insideNormal.m_y.Select(outsideDist.m_y * invOutsideMag, outside),
+		insideNormal.m_z.Select(outsideDist.m_z * invOutsideMag, outside));
+	const ndSoaVector3 localSurface(
+		insideSurface.m_x.Select(clamped.m_x, outside),
+		insideSurface.m_y.Select(clamped.m_y, outside),
+		insideSurface.m_z.Select(clamped.m_z, outside));
+	const ndVector penetration(sphereRadius + (faceDist.Select(ndVector::m_zero - outsideMag, outside)));
+
+	// back to global space, the normal goes from the box to the sphere
+	const ndSoaVector3 boxNormal(front.Scale(localNormal.m_x) + up.Scale(localNormal.m_y) + right.Scale(localNormal.m_z));
+	const ndSoaVector3 boxSurface(origin + front.Scale(localSurface.m_x) + up.Scale(localSurface.m_y) + right.Scale(localSurface.m_z));
+	const ndSoaVector3 point((boxSurface + sphereCenter - boxNormal.Scale(sphereRadius)).Scale(ndVector::m_half));
+	const ndVector swapMask(swap[0], swap[1], swap[2], swap[3]);
+	const ndSoaVector3 separatingVector(boxNormal.Scale(ndVector::m_negOne.Select(ndVector::m_one, swapMask)));
+
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndPair& pair = pairs[i];
+		pair.m_count = 0;
+		pair.m_separatingVector = separatingVector.GetVector(i);
+		pair.m_separationDistance = -penetration[i];
+		if (penetration[i] >= ndFloat32(0.0f))
+		{
+			AddContact(pair, point.GetPoint(i), pair.m_separatingVector * ndVector::m_negOne, penetration[i]);
+		}
+	}
+}
+
+void ndContactBatch::BoxBoxContacts(ndPair* const pairs, ndInt32 count)
+{
+	ndMatrix matrix0[D_CONTACT_BATCH_WIDTH];
+	ndMatrix matrix1[D_CONTACT_BATCH_WIDTH];
+	ndVector size0[D_CONTACT_BATCH_WIDTH];
+	ndVector size1[D_CONTACT_BATCH_WIDTH];
+	for (ndInt32 i = 0; i < D_CONTACT_BATCH_WIDTH; ++i)
+	{
+		const ndPair& pair = pairs[ndMin(i, count - 1)];
+		matrix0[i] = pair.m_instance0->m_globalMatrix;
+		matrix1[i] = pair.m_instance1->m_globalMatrix;
+		size0[i] = GetBoxSize(*pair.m_instance0);
+		size1[i] = GetBoxSize(*pair.m_instance1);
+	}
+
+	ndSoaVector3 axis0[3];
+	ndSoaVector3 axis1[3];
+	for (ndInt32 i = 0; i < 3; ++i)
+	{
+		axis0[i] = ndSoaVector3(matrix0[0][i], matrix0[1][i], matrix0[2][i], matrix0[3][i]);
+		axis1[i] = ndSoaVector3(matrix1[0][i], matrix1[1][i], matrix1[2][i], matrix1[3][i]);
+	}
+	const ndSoaVector3 origin0(matrix0[0].m_posit, matrix0[1].m_posit, matrix0[2].m_posit, matrix0[3].m_posit);
+	const ndSoaVector3 origin1(matrix1[0].m_posit, matrix1[1].m_posit, matrix1[2].m_posit, matrix1[3].m_posit);
+	const ndSoaVector3 soaSize0(size0[0], size0[1], size0[2], size0[3]);
+	const ndSoaVector3 soaSize1(size1[0], size1[1], size1[2], size1[3]);
+	const ndVector extent0[] = { soaSize0.m_x, soaSize0.m_y, soaSize0.m_z };
+	const ndVector extent1[] = { soaSize1.m_x, soaSize1.m_y, soaSize1.m_z };
+	const ndSoaVector3 dist(origin1 - origin0);
+
+	ndVector rot[3][3];
+	ndVector absRot[3][3];
+	ndVector dist0[3];
+	ndVector dist1[3];
+	const ndVector parallelTol(ndFloat32(1.0e-6f));
+	for (ndInt32 i = 0; i < 3; ++i)
+	{
+		dist0[i] = axis0[i].DotProduct(dist);
+		dist1[i] = axis1[i].DotProduct(dist);
+		for (ndInt32 j = 0; j < 3; ++j)
+		{
+			rot[i][j] = axis0[i].DotProduct(axis1[j]);
+			absRot[i][j] = rot[i][j].Abs() + parallelTol;
+		}
+	}
+
+	// separating axis test of the 15 axes of each pair, one pair per lane.
+	// axis 0 to 2 are the faces of box0, 3 to 5 the faces of box1,
+	// and 6 to 14 the cross products of the edges.
+	ndVector bestAxis(ndVector::m_zero);
+	ndVector bestSeparation(ndFloat32(-1.0e10f));
+	for (ndInt32 i = 0; i < 3; ++i)
+	{
+		const ndVector radius(extent0[i] + extent1[0] * absRot[i][0] + extent1[1] * absRot[i][1] + extent1[2] * absRot[i][2]);
+		const ndVector separation(dist0[i].Abs() - radius);
+		const ndVector test(separation > bestSeparation);
+		bestSeparation = bestSeparation.Select(separation, test);
+		bestAxis = bestAxis.Select(ndVector(ndFloat32(i)), test);
+	}
+
+	const ndVector relTol(D_CONTACT_BATCH_RELATIVE_TOL);
+	const ndVector absTol(D_CONTACT_BATCH_ABSOLUTE_TOL);
+	const ndVector faceSeparation0(bestSeparation * relTol + absTol);
+	for (ndInt32 j = 0; j < 3; ++j)
+	{
+		const ndVector radius(extent1[j] + extent0[0] * absRot[0][j] + extent0[1] * absRot[1][j] + extent0[2] * absRot[2][j]);
+		const ndVector separation(dist1[j].Abs() - radius);
+		const ndVector test((separation > faceSeparation0) & (separation > bestSeparation));
+		bestSeparation = bestSeparation.Select(separation, test);
+		bestAxis = bestAxis.Select(ndVector(ndFloat32(3 + j)), test);
+	}
+
+	const ndVector faceSeparation(bestSeparation * relTol + absTol);
+	for (ndInt32 i = 0; i < 3; ++i)
+	{
+		const ndInt32 i1 = (i + 1) % 3;
+		const ndInt32 i2 = (i + 2) % 3;
+		for (ndInt32 j = 0; j < 3; ++j)
+		{
+			const ndInt32 j1 = (j + 1) % 3;
+			const ndInt32 j2 = (j + 2) % 3;
+			const ndVector project(dist0[i2] * rot[i1][j] - dist0[i1] * rot[i2][j]);
+			const ndVector radius0(extent0[i1] * absRot[i2][j] + extent0[i2] * absRot[i1][j]);
+			const ndVector radius1(extent1[j1] * absRot[i][j2] + extent1[j2] * absRot[i][j1]);
+			const ndVector mag2((ndVector::m_one - rot[i][j] * rot[i][j]).GetMax(ndVector::m_zero));
+			const ndVector valid(mag2 > ndVector(ndFloat32(1.0e-6f)));
+			const ndVector separation((project.Abs() - radius0 - radius1).Divide(mag2.GetMax(ndVector(ndFloat32(1.0e-6f))).Sqrt()));
+			const ndVector test(valid & (separation > faceSeparation) & (separation > bestSeparation));
+			bestSeparation = bestSeparation.Select(separation, test);
+			bestAxis = bestAxis.Select(ndVector(ndFloat32(6 + i * 3 + j)), test);
+		}
+	}
+
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndPair& pair = pairs[i];
+		const ndMatrix& m0 = matrix0[i];
+		const ndMatrix& m1 = matrix1[i];
+		const ndVector distance(dist.GetVector(i));
+		const ndInt32 axis = ndInt32(bestAxis[i]);
+
+		ndVector separatingVector;
+		if (axis < 3)
+		{
+			separatingVector = m0[axis].Scale((dist0[axis][i] >= ndFloat32(0.0f)) ? ndFloat32(1.0f) : ndFloat32(-1.0f));
+		}
+		else if (axis < 6)
+		{
+			separatingVector = m1[axis - 3].Scale((dist1[axis - 3][i] >= ndFloat32(0.0f)) ? ndFloat32(1.0f) : ndFloat32(-1.0f));
+		}
+		else
+		{
+			const ndVector cross(m0[(axis - 6) / 3].CrossProduct(m1[(axis - 6) % 3]));
+			separatingVector = cross.Normalize();
+			if (separatingVector.DotProduct(distance).GetScalar() < ndFloat32(0.0f))
+			{
+				separatingVector = separatingVector * ndVector::m_negOne;
+			}
+		}
+		separatingVector = separatingVector & ndVector::m_triplexMask;
+
+		pair.m_count = 0;
+		pair.m_separatingVector = separatingVector;
+		pair.m_separationDistance = bestSeparation[i] - D_PENETRATION_TOL;
+		if (bestSeparation[i] <= D_PENETRATION_TOL)
+		{
+			const ndVector normal(separatingVector * ndVector::m_negOne);
+			if (axis < 3)
+			{
+				BoxBoxFaceContacts(pair, m0, size0[i], axis, separatingVector, m1, size1[i], normal);
+			}
+			else if (axis < 6)
+			{
+				BoxBoxFaceContacts(pair, m1, size1[i], axis - 3, normal, m0, size0[i], normal);
+			}
+			else
+			{
+				BoxBoxEdgeContacts(pair, m0, size0[i], (axis - 6) / 3, m1, size1[i], (axis - 6) % 3, separatingVector);
+			}
+		}
+	}
+}
+
+void ndContactBatch::CalculateFeatureIds(ndPair* const pairs, ndInt32 count)
+{
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndPair& pair = pairs[i];
+		for (ndInt32 j = 0; j < pair.m_count; ++j)
+		{
+			ndContactPoint& contact = pair.m_contacts[j];
+			contact.m_featureId = ndContactSolver::CalculateFeatureId(*pair.m_instance0, *pair.m_instance1, contact);
+		}
+	}
+}
+
+void ndContactBatch::CalculateContacts(ndPairType type, ndPair* const pairs, ndInt32 count)
+{
+	ndAssert(count > 0);
+	ndAssert(count <= D_CONTACT_BATCH_WIDTH);
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		pairs[i].m_degenerate = 0;
+	}
+
+	switch (type)
+	{
+		case m_sphereSphere:
+			SphereSphereContacts(pairs, count);
+			break;
+
+		case m_sphereCapsule:
+			SphereCapsuleContacts(pairs, count);
+			break;
+
+		case m_capsuleCapsule:
+			CapsuleCapsuleContacts(pairs, count);
+			break;
+
+		case m_sphereBox:
+			SphereBoxContacts(pairs, count);
+			break;
+
+		case m_boxBox:
+			BoxBoxContacts(pairs, count);
+			break;
+
+		default:
+			ndAssert(0);
+			for (ndInt32 i = 0; i < count; ++i)
+			{
+				pairs[i].m_count = 0;
+			}
+	}
+	CalculateFeatureIds(pairs, count);
+}
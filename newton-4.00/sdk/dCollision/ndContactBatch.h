@@ -0,0 +1,96 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+*
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __ND_CONTACT_BATCH_H__
+#define __ND_CONTACT_BATCH_H__
+
+#include "ndCollisionStdafx.h"
+#include "ndContact.h"
+
+class ndShapeInstance;
+
+// pairs per packet, one pair per ndVector lane
+#define D_CONTACT_BATCH_WIDTH			4
+
+// max contacts per pair, a box box clipped polygon is reduced to four points
+#define D_CONTACT_BATCH_MAX_POINTS		4
+
+// Closed form narrow phase for the primitive pairs that dominate most scenes.
+// The scene sorts the contacts that need a narrow phase update by pair type
+// and calls the kernel with packets of up to D_CONTACT_BATCH_WIDTH pairs of the
+// same type. Sphere and capsule pairs are solved one pair per lane, box box
+// pairs run the separating axis test one pair per lane, followed by clipping
+// the incident face against the reference face of each pair.
+// The results follow the conventions of ndContactSolver, so that a pair can
+// move between this path and the generic one without a jump in the contacts:
+// normals point from body1 to body0, points are on the midplane between
+// the two surfaces, and the penetration has D_PENETRATION_TOL added per
+// polyhedral shape and subtracted per round shape in the pair.
+class ndContactBatch
+{
+	public:
+	enum ndPairType
+	{
+		m_generic,
+		m_sphereSphere,
+		m_sphereCapsule,
+		m_capsuleCapsule,
+		m_sphereBox,
+		m_boxBox,
+		m_pairTypeCount,
+	};
+
+	class ndPair
+	{
+		public:
+		// input, both instances must have the global matrix set.
+		const ndShapeInstance* m_instance0;
+		const ndShapeInstance* m_instance1;
+		ndContactPoint* m_contacts;
+
+		// output, same meaning as the ndContact members with the same name.
+		ndVector m_separatingVector;
+		ndFloat32 m_separationDistance;
+		ndInt32 m_count;
+
+		// set when the pair has no closed form direction, the caller
+		// must solve it with the generic contact solver.
+		ndInt32 m_degenerate;
+	};
+
+	D_COLLISION_API static ndPairType GetPairType(const ndShapeInstance& instance0, const ndShapeInstance& instance1);
+	D_COLLISION_API static void CalculateContacts(ndPairType type, ndPair* const pairs, ndInt32 count);
+
+	private:
+	static ndInt32 GetShapeClass(const ndShapeInstance& instance);
+	static ndVector GetBoxSize(const ndShapeInstance& instance);
+	static void GetSegment(const ndShapeInstance& instance, ndVector& p0, ndVector& p1, ndFloat32& radius);
+
+	static void SphereSphereContacts(ndPair* const pairs, ndInt32 count);
+	static void SphereCapsuleContacts(ndPair* const pairs, ndInt32 count);
+	static void CapsuleCapsuleContacts(ndPair* const pairs, ndInt32 count);
+	static void SphereBoxContacts(ndPair* const pairs, ndInt32 count);
+	static void BoxBoxContacts(ndPair* const pairs, ndInt32 count);
+	static void CalculateFeatureIds(ndPair* const pairs, ndInt32 count);
+};
+
+#endif
+
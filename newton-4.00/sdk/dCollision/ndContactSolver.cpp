@@ -341,6 +341,7 @@ ndContactSolver::ndContactSolver()
 	,m_freeFace(nullptr)
 	,m_notification(nullptr)
 	,m_contactBuffer(nullptr)
+	,m_frameAllocator(nullptr)
 	,m_timestep(ndFloat32 (0.0f))
 	,m_skinMargin(ndFloat32(0.0f))
 	,m_separationDistance(ndFloat32(0.0f))
@@ -362,6 +363,7 @@ ndContactSolver::ndContactSolver(ndShapeInstance* const instance, ndContactNotif
 	,m_freeFace(nullptr)
 	,m_notification(notification)
 	,m_contactBuffer(nullptr)
+	,m_frameAllocator(nullptr)
 	,m_timestep(timestep)
 	,m_skinMargin(ndFloat32(0.0f))
 	,m_separationDistance(ndFloat32(0.0f))
@@ -385,6 +387,7 @@ ndContactSolver::ndContactSolver(ndContact* const contact, ndContactNotify* cons
 	,m_freeFace(nullptr)
 	,m_notification(notification)
 	,m_contactBuffer(nullptr)
+	,m_frameAllocator(nullptr)
 	,m_timestep(timestep)
 	,m_skinMargin(ndFloat32(0.0f))
 	,m_separationDistance(ndFloat32(0.0f))
@@ -408,6 +411,7 @@ ndContactSolver::ndContactSolver(const ndContactSolver& src, const ndShapeInstan
 	,m_freeFace(nullptr)
 	,m_notification(src.m_notification)
 	,m_contactBuffer(src.m_contactBuffer)
+	,m_frameAllocator(src.m_frameAllocator)
 	,m_timestep(src.m_timestep)
 	,m_skinMargin(src.m_skinMargin)
 	,m_separationDistance(src.m_separationDistance)
@@ -2429,6 +2433,43 @@ bool ndContactSolver::CalculateClosestPoints()
 //*************************************************************
 // calculate proper separation distance for discrete collision.
 //*************************************************************
+ndUnsigned64 ndContactSolver::CalculateFeatureId(const ndShapeInstance& instance0, const ndShapeInstance& instance1, const ndContactPoint& contact)
+{
+	// the support vertex of a convex shape in the direction of a contact point
+	// is an exact shape vertex, so it is bitwise identical from frame to frame 
+	// for as long as the point is generated by the same features.
+	// non convex shapes contribute the face or child id of the point.
+	const ndShapeInstance* const instance[] = { &instance0, &instance1 };
+	ndVector features[2];
+	for (ndInt32 j = 0; j < 2; ++j)
+	{
+		features[j] = ndVector::m_zero;
+		if (((ndShape*)instance[j]->GetShape())->GetAsShapeConvex())
+		{
+			const ndMatrix& matrix = instance[j]->m_globalMatrix;
+			const ndVector dir(matrix.UnrotateVector(contact.m_point - matrix.m_posit) & ndVector::m_triplexMask);
+			const ndFloat32 mag2 = dir.DotProduct(dir).GetScalar();
+			if (mag2 > ndFloat32(1.0e-12f))
+			{
+				features[j] = instance[j]->SupportVertex(dir.Scale(ndRsqrt(mag2))) & ndVector::m_triplexMask;
+			}
+		}
+	}
+	ndUnsigned64 featureId = ndCRC64(features, ndInt32(sizeof(features)), ndUnsigned64(0));
+	featureId = ndCRC64(&contact.m_shapeId0, ndInt32(sizeof(contact.m_shapeId0)), featureId);
+	featureId = ndCRC64(&contact.m_shapeId1, ndInt32(sizeof(contact.m_shapeId1)), featureId);
+	return featureId;
+}
+
+void ndContactSolver::CalculateFeatureIds(ndInt32 count)
+{
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndContactPoint& contact = m_contactBuffer[i];
+		contact.m_featureId = CalculateFeatureId(m_instance0, m_instance1, contact);
+	}
+}
+
 ndInt32 ndContactSolver::CalculateContactsDiscrete()
 {
 	ndInt32 count = 0;
@@ -2446,6 +2487,11 @@ ndInt32 ndContactSolver::CalculateContactsDiscrete()
 		ndAssert(0);
 	}
 
+	if (!m_intersectionTestOnly)
+	{
+		CalculateFeatureIds(count);
+	}
+
 	m_contact->m_timeOfImpact = m_timestep;
 	m_contact->m_separatingVector = m_separatingVector;
 	ndAssert(!count || (m_separationDistance < ndFloat32(100.0f)));
@@ -2555,9 +2601,28 @@ ndInt32 ndContactSolver::ConvexToConvexContactsDiscrete()
 		{
 			if (ndInt8 (m_instance0.GetCollisionMode()) & ndInt8(m_instance1.GetCollisionMode()))
 			{
-				count = CalculateContacts(m_closestPoint0, m_closestPoint1, m_separatingVector * ndVector::m_negOne);
 				// skip convex shape polygon because they could have a skirt
 				ndShapeConvexPolygon* const convexPolygon = m_instance1.GetShape()->GetAsShapeAsConvexPolygon();
+				const ndFloat32 gap = penetration + m_skinMargin;
+				if ((m_skinMargin > ndFloat32(0.0f)) && (gap > ndFloat32(0.0f)) && !convexPolygon)
+				{
+					// speculative contacts, slide shape1 until it touches shape0, 
+					// and move the contacts back to the middle of the gap.
+					const ndVector step(m_separatingVector.Scale(gap));
+					m_instance1.m_globalMatrix.m_posit -= step;
+					count = CalculateContacts(m_closestPoint0, m_closestPoint1 - step, m_separatingVector * ndVector::m_negOne);
+					m_instance1.m_globalMatrix.m_posit += step;
+
+					const ndVector halfStep(step * ndVector::m_half);
+					for (ndInt32 i = count - 1; i >= 0; --i)
+					{
+						m_buffer[i] += halfStep;
+					}
+				}
+				else
+				{
+					count = CalculateContacts(m_closestPoint0, m_closestPoint1, m_separatingVector * ndVector::m_negOne);
+				}
 				if (!(count || convexPolygon))
 				{
 					// poly line failed probably because of rounding error
@@ -2612,7 +2677,9 @@ ndInt32 ndContactSolver::ConvexToConvexContactsDiscrete()
 			contactOut[i].m_body1 = body1;
 			contactOut[i].m_shapeInstance0 = instance0;
 			contactOut[i].m_shapeInstance1 = instance1;
-			contactOut[i].m_penetration = -penetration;
+			contactOut[i].m_shapeId0 = 0;
+			contactOut[i].m_shapeId1 = 0;
+			contactOut[i].m_penetration = -(penetration + m_skinMargin);
 		}
 	}
 
@@ -2932,7 +2999,8 @@ ndInt32 ndContactSolver::CompoundToCompoundContactsDiscrete()
 
 	ndInt32 stack = 1;
 	ndInt32 contactCount = 0;
-	ndStackEntry stackPool[2 * D_COMPOUND_STACK_DEPTH];
+	ndFrameAllocator::ndScope frameScope(m_frameAllocator, m_threadId);
+	ndStackEntry* const stackPool = m_frameAllocator ? m_frameAllocator->Alloc<ndStackEntry>(m_threadId, 2 * D_COMPOUND_STACK_DEPTH) : ndAlloca(ndStackEntry, 2 * D_COMPOUND_STACK_DEPTH);
 
 	stackPool[0].m_node0 = compoundShape0->m_root;
 	stackPool[0].m_node1 = compoundShape1->m_root;
@@ -3091,7 +3159,8 @@ ndInt32 ndContactSolver::CompoundToShapeStaticBvhContactsDiscrete()
 
 	ndInt32 stack = 1;
 	ndInt32 contactCount = 0;
-	ndStackBvhStackEntry stackPool[2 * D_COMPOUND_STACK_DEPTH];
+	ndFrameAllocator::ndScope frameScope(m_frameAllocator, m_threadId);
+	ndStackBvhStackEntry* const stackPool = m_frameAllocator ? m_frameAllocator->Alloc<ndStackBvhStackEntry>(m_threadId, 2 * D_COMPOUND_STACK_DEPTH) : ndAlloca(ndStackBvhStackEntry, 2 * D_COMPOUND_STACK_DEPTH);
 
 	stackPool[0].m_treeNodeIsLeaf = 0;
 	stackPool[0].m_compoundNode = compoundShape->m_root;
@@ -3512,6 +3581,11 @@ ndInt32 ndContactSolver::CalculateContactsContinue()
 		ndAssert(0);
 	}
 
+	if (!m_intersectionTestOnly)
+	{
+		CalculateFeatureIds(count);
+	}
+
 	m_contact->m_timeOfImpact = m_timestep;
 	m_contact->m_separatingVector = m_separatingVector;
 	m_contact->m_separationDistance = m_separationDistance;
@@ -4123,7 +4197,7 @@ void ndContactSolver::CalculateContacts(
 	}
 }
 
-ndInt32 ndContactSolver::CalculatePolySoupToHullContactsDescrete(ndPolygonMeshDesc& data)
+ndInt32 ndContactSolver::CalculatePolySoupToHullContactsDescrete(ndPolygonMeshDesc& data, ndStaticMeshFaceCache* const faceCache)
 {
 	ndShapeConvexPolygon polygon;
 	ndShapeInstance polySoupInstance(m_instance1);
@@ -4191,6 +4265,12 @@ ndInt32 ndContactSolver::CalculatePolySoupToHullContactsDescrete(ndPolygonMeshDe
 
 		ndInt32 count1 = polygon.CalculateContactToConvexHullDescrete(&polySoupInstance, *this);
 		closestDist = ndMin(closestDist, m_separationDistance);
+		if (faceCache)
+		{
+			// the separation is only known when the face was rejected on a plane.
+			const ndInt32 face = faceCache->FindFace(address);
+			faceCache->m_faceSeparation[face] = (count1 > 0) ? ndFloat32(-1.0f) : polygon.m_separation - faceCache->m_motion;
+		}
 
 		if (count1 > 0)
 		{
@@ -4237,17 +4317,33 @@ ndInt32 ndContactSolver::ConvexToStaticMeshContactsDiscrete()
 	ndPolygonMeshDesc data(*this, false);
 	ndShapeStaticMesh* const polysoup = m_instance1.GetShape()->GetAsShapeStaticMesh();
 	ndAssert(polysoup);
-	polysoup->GetCollidingFaces(&data);
-	if (data.m_staticMeshQuery->m_faceIndexCount.GetCount())
-	{
-		count = CalculatePolySoupToHullContactsDescrete(data);
-	}
 
 	ndBodyKinematic* const body0 = m_contact->GetBody0();
 	ndBodyKinematic* const body1 = m_contact->GetBody1();
 	ndShapeInstance* const instance0 = &body0->GetCollisionShape();
 	ndShapeInstance* const instance1 = &body1->GetCollisionShape();
 
+	// the faces of a bvh mesh are persistent, so they can be cached in the contact, 
+	// but not for the sub shapes of a compound, since they all share the same contact.
+	ndStaticMeshFaceCache* faceCache = nullptr;
+	if (polysoup->GetAsShapeStaticBVH() && (instance0->GetShape() == m_instance0.GetShape()))
+	{
+		faceCache = GetCachedStaticMeshFaces(data);
+	}
+	else
+	{
+		polysoup->GetCollidingFaces(&data);
+	}
+
+	if (data.m_staticMeshQuery->m_faceIndexCount.GetCount())
+	{
+		count = CalculatePolySoupToHullContactsDescrete(data, faceCache);
+		if ((count > D_MESH_MANIFOLD_MAX_POINTS) && m_pruneContacts && !m_intersectionTestOnly)
+		{
+			count = ReduceMeshContacts(count);
+		}
+	}
+
 	if (!m_intersectionTestOnly)
 	{
 		ndContactPoint* const contactOut = m_contactBuffer;
@@ -4264,6 +4360,190 @@ ndInt32 ndContactSolver::ConvexToStaticMeshContactsDiscrete()
 	return count;
 }
 
+ndStaticMeshFaceCache* ndContactSolver::GetCachedStaticMeshFaces(ndPolygonMeshDesc& data)
+{
+	D_TRACKTIME();
+	ndShapeStatic_bvh* const polysoup = m_instance1.GetShape()->GetAsShapeStaticBVH();
+	ndAssert(polysoup);
+	ndAssert(m_notification->m_scene);
+
+	ndScene::ndThreadScratch& scratch = m_notification->m_scene->m_threadScratch[m_threadId];
+	ndPolygonMeshDesc::ndStaticMeshFaceQuery& query = *data.m_staticMeshQuery;
+
+	if (!m_contact->m_meshFaceCache)
+	{
+		m_contact->m_meshFaceCache = new ndStaticMeshFaceCache;
+	}
+	ndStaticMeshFaceCache& cache = *m_contact->m_meshFaceCache;
+
+	scratch.m_meshFaceCacheLookups++;
+	if (cache.IsValid(polysoup, data.GetOrigin(), data.GetTarget()))
+	{
+		scratch.m_meshFaceCacheHits++;
+	}
+	else
+	{
+		// collect the faces overlapping the padded box of the shape
+		ndFastAabb& box = data;
+		const ndFastAabb convexBox(box);
+		const ndVector padding(ndVector(D_MESH_FACE_CACHE_PADDING) & ndVector::m_triplexMask);
+		cache.m_shape = polysoup;
+		cache.m_reference = convexBox;
+		cache.m_minBox = convexBox.GetOrigin() - padding;
+		cache.m_maxBox = convexBox.GetTarget() + padding;
+
+		box = ndFastAabb(cache.m_minBox, cache.m_maxBox);
+		polysoup->GetCollidingFaces(&data);
+		box = convexBox;
+
+		const ndInt32 faceCount = query.m_faceIndexCount.GetCount();
+		const ndInt32 indexCount = query.m_faceVertexIndex.GetCount();
+		cache.m_faceIndexCount.SetCount(faceCount);
+		cache.m_faceIndexStart.SetCount(faceCount);
+		cache.m_faceVertexIndex.SetCount(indexCount);
+		cache.m_faceSeparation.SetCount(faceCount);
+		if (faceCount)
+		{
+			ndMemCpy(&cache.m_faceIndexCount[0], &query.m_faceIndexCount[0], faceCount);
+			ndMemCpy(&cache.m_faceIndexStart[0], &query.m_faceIndexStart[0], faceCount);
+			ndMemCpy(&cache.m_faceVertexIndex[0], &query.m_faceVertexIndex[0], indexCount);
+			for (ndInt32 i = 0; i < faceCount; ++i)
+			{
+				cache.m_faceSeparation[i] = ndFloat32(-1.0f);
+			}
+		}
+		query.Reset();
+	}
+
+	// the separations are measured in global space, which is
+	// only the same distance in mesh space for unit scale meshes.
+	const bool useSeparation = (m_instance1.GetScaleType() == ndShapeInstance::m_unit);
+	// the motion is measured around the posit of the mesh description, the
+	// center of the shape box in shape space, which is not the center of the
+	// global box for off center shapes. so the radius is the distance from
+	// that posit to the farthest corner of the global box.
+	const ndVector posit(data.m_posit & ndVector::m_triplexMask);
+	const ndVector corner((data.GetOrigin() - posit).Abs().GetMax((data.GetTarget() - posit).Abs()) & ndVector::m_triplexMask);
+	cache.m_motion = cache.CalculateMotion(data, ndSqrt(corner.DotProduct(corner).GetScalar()));
+
+	// keep the cached faces that overlap the box of the shape, 
+	// this is the same test the bvh applies to the leaf faces.
+	// the faces share the index array of the cache, so that
+	// the polygon test can find the face to save its separation.
+	data.m_vertex = polysoup->GetLocalVertexPool();
+	data.m_vertexStrideInBytes = polysoup->GetStrideInBytes();
+	const ndFloat32* const vertex = data.m_vertex;
+	const ndInt32 stride = ndInt32(data.m_vertexStrideInBytes / sizeof(ndFloat32));
+	query.m_faceVertexIndex.SetCount(cache.m_faceVertexIndex.GetCount());
+	if (cache.m_faceVertexIndex.GetCount())
+	{
+		ndMemCpy(&query.m_faceVertexIndex[0], &cache.m_faceVertexIndex[0], cache.m_faceVertexIndex.GetCount());
+	}
+	for (ndInt32 i = 0; i < cache.m_faceIndexCount.GetCount(); ++i)
+	{
+		if (useSeparation && (cache.m_faceSeparation[i] > cache.m_motion))
+		{
+			scratch.m_meshFaceCacheSkips++;
+			continue;
+		}
+		const ndInt32 faceIndexCount = cache.m_faceIndexCount[i];
+		const ndInt32* const indices = &cache.m_faceVertexIndex[cache.m_faceIndexStart[i]];
+		const ndVector faceNormal(ndVector(&vertex[indices[faceIndexCount + 1] * stride]) & ndVector::m_triplexMask);
+		const ndFloat32 dist = data.PolygonBoxDistance(faceNormal, faceIndexCount, indices, stride, vertex);
+		if (dist > ndFloat32(0.0f))
+		{
+			query.m_hitDistance.PushBack(dist);
+			query.m_faceIndexCount.PushBack(faceIndexCount);
+			query.m_faceIndexStart.PushBack(cache.m_faceIndexStart[i]);
+		}
+	}
+	return useSeparation ? &cache : nullptr;
+}
+
+ndInt32 ndContactSolver::ReduceMeshContacts(ndInt32 count) const
+{
+	// the contacts of a shape resting on many faces are reduced to the deepest point 
+	// and the three points that span the largest area around it, so that the manifold
+	// does not change from frame to frame as the shape moves over the faces.
+	ndAssert(count > D_MESH_MANIFOLD_MAX_POINTS);
+	ndContactPoint* const contactArray = m_contactBuffer;
+
+	ndInt32 index = 0;
+	for (ndInt32 i = 1; i < count; ++i)
+	{
+		if (contactArray[i].m_penetration > contactArray[index].m_penetration)
+		{
+			index = i;
+		}
+	}
+	ndSwap(contactArray[0], contactArray[index]);
+	const ndVector p0(contactArray[0].m_point & ndVector::m_triplexMask);
+
+	index = 1;
+	ndFloat32 maxDist2 = ndFloat32(-1.0f);
+	for (ndInt32 i = 1; i < count; ++i)
+	{
+		const ndVector dist((contactArray[i].m_point & ndVector::m_triplexMask) - p0);
+		const ndFloat32 dist2 = dist.DotProduct(dist).GetScalar();
+		if (dist2 > maxDist2)
+		{
+			index = i;
+			maxDist2 = dist2;
+		}
+	}
+	if (maxDist2 < D_MINK_VERTEX_ERR2)
+	{
+		return 1;
+	}
+	ndSwap(contactArray[1], contactArray[index]);
+	const ndVector edge((contactArray[1].m_point & ndVector::m_triplexMask) - p0);
+
+	index = 2;
+	ndFloat32 maxArea2 = ndFloat32(-1.0f);
+	for (ndInt32 i = 2; i < count; ++i)
+	{
+		const ndVector normal(edge.CrossProduct((contactArray[i].m_point & ndVector::m_triplexMask) - p0));
+		const ndFloat32 area2 = normal.DotProduct(normal).GetScalar();
+		if (area2 > maxArea2)
+		{
+			index = i;
+			maxArea2 = area2;
+		}
+	}
+	if (maxArea2 < (D_MINK_VERTEX_ERR2 * maxDist2))
+	{
+		return 2;
+	}
+	ndSwap(contactArray[2], contactArray[index]);
+	const ndVector p1(contactArray[1].m_point & ndVector::m_triplexMask);
+	const ndVector p2(contactArray[2].m_point & ndVector::m_triplexMask);
+	const ndVector normal(edge.CrossProduct(p2 - p0));
+
+	// the last point is the one farthest outside of the triangle edges
+	index = 3;
+	ndFloat32 maxOutside = ndFloat32(0.0f);
+	for (ndInt32 i = 3; i < count; ++i)
+	{
+		const ndVector p(contactArray[i].m_point & ndVector::m_triplexMask);
+		const ndFloat32 area0 = normal.DotProduct((p1 - p0).CrossProduct(p - p0)).GetScalar();
+		const ndFloat32 area1 = normal.DotProduct((p2 - p1).CrossProduct(p - p1)).GetScalar();
+		const ndFloat32 area2 = normal.DotProduct((p0 - p2).CrossProduct(p - p2)).GetScalar();
+		const ndFloat32 outside = -ndMin(area0, ndMin(area1, area2));
+		if (outside > maxOutside)
+		{
+			index = i;
+			maxOutside = outside;
+		}
+	}
+	// the ratio of the area added by the last point to the area of the triangle
+	if (maxOutside < (ndFloat32(1.0e-3f) * maxArea2))
+	{
+		return 3;
+	}
+	ndSwap(contactArray[3], contactArray[index]);
+	return D_MESH_MANIFOLD_MAX_POINTS;
+}
+
 ndInt32 ndContactSolver::ConvexToSaticStaticBvhContactsNodeDescrete(const ndAabbPolygonSoup::ndNode* const node)
 {
 	ndVector origin0(m_instance0.m_globalMatrix.m_posit);
@@ -4283,7 +4563,7 @@ ndInt32 ndContactSolver::ConvexToSaticStaticBvhContactsNodeDescrete(const ndAabb
 	ndInt32 count = 0;
 	if (data.m_staticMeshQuery->m_faceIndexCount.GetCount())
 	{
-		count = CalculatePolySoupToHullContactsDescrete(data);
+		count = CalculatePolySoupToHullContactsDescrete(data, nullptr);
 	}
 
 	ndBodyKinematic* const body0 = m_contact->GetBody0();
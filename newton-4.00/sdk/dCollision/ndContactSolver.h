@@ -30,6 +30,7 @@ class ndPlane;
 class ndBodyKinematic;
 class ndContactNotify;
 class ndPolygonMeshDesc;
+class ndStaticMeshFaceCache;
 
 D_MSV_NEWTON_ALIGN_32
 class ndMinkFace
@@ -51,6 +52,7 @@ class ndMinkFace
 #define D_PENETRATION_TOL				ndFloat32 (1.0f / 1024.0f)
 #define D_MINK_VERTEX_ERR				ndFloat32 (1.0e-3f)
 #define D_MINK_VERTEX_ERR2				(D_MINK_VERTEX_ERR * D_MINK_VERTEX_ERR)
+#define D_MESH_MANIFOLD_MAX_POINTS		4
 
 class ndContact;
 class dCollisionParamProxy;
@@ -88,8 +90,10 @@ class ndContactSolver: public ndDownHeap<ndMinkFace *, ndFloat32>
 	ndInt32 ConvexToStaticMeshContactsDiscrete(); // done
 	ndInt32 CompoundToShapeStaticBvhContactsDiscrete(); // done
 	ndInt32 CompoundToStaticHeightfieldContactsDiscrete(); // done
-	ndInt32 CalculatePolySoupToHullContactsDescrete(ndPolygonMeshDesc& data); // done
+	ndInt32 CalculatePolySoupToHullContactsDescrete(ndPolygonMeshDesc& data, ndStaticMeshFaceCache* const faceCache); // done
 	ndInt32 ConvexToSaticStaticBvhContactsNodeDescrete(const ndAabbPolygonSoup::ndNode* const node); // done
+	ndStaticMeshFaceCache* GetCachedStaticMeshFaces(ndPolygonMeshDesc& data);
+	ndInt32 ReduceMeshContacts(ndInt32 count) const;
 
 	ndInt32 ConvexContactsContinue(); // done
 	ndInt32 CompoundContactsContinue(); // done
@@ -135,6 +139,8 @@ class ndContactSolver: public ndDownHeap<ndMinkFace *, ndFloat32>
 	void SupportVertex(const ndVector& dir, ndInt32 vertexIndex);
 
 	void TranslateSimplex(const ndVector& step);
+	void CalculateFeatureIds(ndInt32 count);
+	static ndUnsigned64 CalculateFeatureId(const ndShapeInstance& instance0, const ndShapeInstance& instance1, const ndContactPoint& contact);
 	void CalculateContactFromFeacture(ndInt32 featureType);
 
 	ndShapeInstance m_instance0;
@@ -156,6 +162,7 @@ class ndContactSolver: public ndDownHeap<ndMinkFace *, ndFloat32>
 	dgFaceFreeList* m_freeFace;
 	ndContactNotify* m_notification;
 	ndContactPoint* m_contactBuffer;
+	ndFrameAllocator* m_frameAllocator;
 	ndFloat32 m_timestep;
 	ndFloat32 m_skinMargin;
 	ndFloat32 m_separationDistance;
@@ -181,6 +188,7 @@ class ndContactSolver: public ndDownHeap<ndMinkFace *, ndFloat32>
 
 	friend class ndScene;
 	friend class ndShapeConvex;
+	friend class ndContactBatch;
 	friend class ndShapeInstance;
 	friend class ndPolygonMeshDesc;
 	friend class ndConvexCastNotify;
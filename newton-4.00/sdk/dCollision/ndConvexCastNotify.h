@@ -84,4 +84,13 @@ class ndConvexCastNotify : public ndClassAlloc
 	ndScene* m_cachedScene;
 } D_GCC_NEWTON_ALIGN_32;
 
+// one sweep of a batched convex cast, see ndScene::ConvexCastBatch
+D_MSV_NEWTON_ALIGN_32
+class ndConvexCastBatchQuery
+{
+	public:
+	ndMatrix m_origin;
+	ndVector m_dest;
+} D_GCC_NEWTON_ALIGN_32;
+
 #endif
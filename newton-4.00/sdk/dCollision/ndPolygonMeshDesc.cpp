@@ -68,8 +68,8 @@ ndPolygonMeshDesc::ndPolygonMeshDesc(ndContactSolver& proxy, bool ccdMode)
 	//}
 
 	ndScene* const scene = proxy.m_notification->m_scene;
-	m_staticMeshQuery = &scene->m_staticMeshQuery[proxy.m_threadId];
-	m_proceduralStaticMeshFaceQuery = &scene->m_proceduralStaticMeshQuery[proxy.m_threadId];
+	m_staticMeshQuery = &scene->m_threadScratch[proxy.m_threadId].m_staticMeshQuery;
+	m_proceduralStaticMeshFaceQuery = &scene->m_threadScratch[proxy.m_threadId].m_proceduralStaticMeshQuery;
 	Init();
 }
 
@@ -30,6 +30,87 @@ class ndShapeInstance;
 class ndContactSolver;
 class ndShapeStaticMesh;
 
+// padding of the box used to collect the faces saved in a contact face cache,
+// the cached faces are reused until the convex shape moves out of the padded box.
+#define D_MESH_FACE_CACHE_PADDING	ndFloat32 (0.125f)
+
+// faces of a static bvh mesh collected by the last mesh query of a contact.
+// the faces overlapping the padded box of the convex shape are a superset of
+// the faces overlapping the convex shape at any position inside that box, so
+// the contact can skip the bvh traversal while the shape stays in the box.
+// each face also keeps the separation found by its last polygon test, so
+// the test is skipped while the shape moves less than that distance.
+D_MSV_NEWTON_ALIGN_32
+class ndStaticMeshFaceCache : public ndClassAlloc
+{
+	public:
+	ndStaticMeshFaceCache()
+		:ndClassAlloc()
+		,m_reference(ndGetIdentityMatrix())
+		,m_minBox(ndVector::m_zero)
+		,m_maxBox(ndVector::m_zero)
+		,m_shape(nullptr)
+		,m_motion(ndFloat32(0.0f))
+		,m_faceIndexCount()
+		,m_faceIndexStart()
+		,m_faceVertexIndex()
+		,m_faceSeparation()
+	{
+	}
+
+	bool IsValid(const ndShape* const shape, const ndVector& p0, const ndVector& p1) const
+	{
+		const ndVector test((p0 >= m_minBox) & (p1 <= m_maxBox));
+		return (shape == m_shape) && ((test.GetSignMask() & 0x07) == 0x07);
+	}
+
+	// upper bound of the distance any point of a shape of the given radius, 
+	// around the posit of matrix, has moved from the reference pose.
+	ndFloat32 CalculateMotion(const ndMatrix& matrix, ndFloat32 radius) const
+	{
+		const ndVector front(matrix.m_front - m_reference.m_front);
+		const ndVector up(matrix.m_up - m_reference.m_up);
+		const ndVector right(matrix.m_right - m_reference.m_right);
+		const ndVector posit((matrix.m_posit - m_reference.m_posit) & ndVector::m_triplexMask);
+		const ndVector rotation(front.DotProduct(front) + up.DotProduct(up) + right.DotProduct(right));
+		return ndSqrt(posit.DotProduct(posit).GetScalar()) + radius * ndSqrt(rotation.GetScalar());
+	}
+
+	ndInt32 FindFace(ndInt32 faceIndexStart) const
+	{
+		ndInt32 i0 = 0;
+		ndInt32 i1 = m_faceIndexStart.GetCount() - 1;
+		while (i0 < i1)
+		{
+			const ndInt32 mid = (i0 + i1 + 1) >> 1;
+			if (m_faceIndexStart[mid] <= faceIndexStart)
+			{
+				i0 = mid;
+			}
+			else
+			{
+				i1 = mid - 1;
+			}
+		}
+		ndAssert(m_faceIndexStart[i0] == faceIndexStart);
+		return i0;
+	}
+
+	// the pose of the shape box in mesh space when the faces were collected
+	ndMatrix m_reference;
+	ndVector m_minBox;
+	ndVector m_maxBox;
+	const ndShape* m_shape;
+	// motion bound of the shape from the reference pose, for the current query
+	ndFloat32 m_motion;
+	ndArray<ndInt32> m_faceIndexCount;
+	ndArray<ndInt32> m_faceIndexStart;
+	ndArray<ndInt32> m_faceVertexIndex;
+	// the separation of each face minus the motion bound at the time it was 
+	// measured, the face can be skipped while the motion bound stays below it.
+	ndArray<ndFloat32> m_faceSeparation;
+} D_GCC_NEWTON_ALIGN_32;
+
 D_MSV_NEWTON_ALIGN_32 
 class ndPolygonMeshDesc: public ndFastAabb
 {
@@ -79,5 +79,25 @@ class ndRayCastClosestHitCallback: public ndRayCastNotify
 	}
 } D_GCC_NEWTON_ALIGN_32 ;
 
+// one segment of a batched ray cast, see ndScene::RayCastBatch
+D_MSV_NEWTON_ALIGN_32
+class ndRayCastBatchQuery
+{
+	public:
+	ndVector m_origin;
+	ndVector m_dest;
+} D_GCC_NEWTON_ALIGN_32;
+
+// closest hit of a batched ray or convex cast. 
+// m_body is nullptr and m_param is larger than one when the query did not hit anything.
+D_MSV_NEWTON_ALIGN_32
+class ndCastBatchHit
+{
+	public:
+	ndVector m_point;
+	ndVector m_normal;
+	const ndBodyKinematic* m_body;
+	ndFloat32 m_param;
+} D_GCC_NEWTON_ALIGN_32;
 
 #endif
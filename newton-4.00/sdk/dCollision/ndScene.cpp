@@ -26,6 +26,7 @@
 #include "ndBodyNotify.h"
 #include "ndShapeCompound.h"
 #include "ndBodyKinematic.h"
+#include "ndContactBatch.h"
 #include "ndContactNotify.h"
 #include "ndContactSolver.h"
 #include "ndRayCastNotify.h"
@@ -37,6 +38,8 @@
 #include "ndShapeStaticProceduralMesh.h"
 
 #define D_CONTACT_DELAY_FRAMES		4
+#define D_CONTACT_MATCH_DIST2		ndFloat32 (0.05f * 0.05f)
+#define D_CONTACT_FEATURE_DIST2		ndFloat32 (0.5f * 0.5f)
 #define D_NARROW_PHASE_DIST			ndFloat32 (0.2f)
 #define D_CONTACT_TRANSLATION_ERROR	ndFloat32 (1.0e-3f)
 #define D_CONTACT_ANGULAR_ERROR		(ndFloat32 (0.25f * ndDegreeToRad))
@@ -57,7 +60,17 @@ ndScene::ndScene()
 	,m_specialUpdateList()
 	,m_backgroundThread()
 	,m_newPairs(1024)
+	,m_threadScratch()
+	,m_frameAllocator()
+	,m_sweepAndPruneArray()
+	,m_sweepAndPruneBands()
+	,m_sweepAndPruneBandStart()
+	,m_sleepingContactArray()
+	,m_contactBatchQueue()
+	,m_contactBatchSorted()
+	,m_contactBatchPackets()
 	,m_lock()
+	,m_bvhLock()
 	,m_rootNode(nullptr)
 	,m_sentinelBody(nullptr)
 	,m_contactNotifyCallback(new ndContactNotify(nullptr))
@@ -66,14 +79,26 @@ ndScene::ndScene()
 	,m_frameNumber(0)
 	,m_subStepNumber(0)
 	,m_forceBalanceSceneCounter(0)
+	,m_bvhRebuildCount(0)
+	,m_broadPhaseType(ndBvhBroadPhase)
+	,m_bvhUpdateType(ndBvhPeriodicRebuild)
+	,m_sweepAndPruneAxis(0)
+	,m_sweepAndPruneBandAxis(0)
+	,m_sweepAndPruneBandCount(0)
+	,m_sweepAndPruneBandOrigin(ndFloat32(0.0f))
+	,m_sweepAndPruneBandInvSize(ndFloat32(0.0f))
+	,m_sleepingActiveCount(0)
+	,m_wakeSleepingIslands(0)
+	,m_contactBatchCount(0)
+	,m_bvhOutOfDate(0)
+	,m_sweepAndPruneDirty(true)
+	,m_islandSleep(false)
+	,m_contactBatching(true)
 {
 	m_sentinelBody = new ndBodySentinel;
 	m_contactNotifyCallback->m_scene = this;
-
-	for (ndInt32 i = 0; i < D_MAX_THREADS_COUNT; ++i)
-	{
-		m_partialNewPairs[i].Resize(256);
-	}
+	m_threadScratch.SetCount(GetThreadCount());
+	m_frameAllocator.SetThreadCount(GetThreadCount());
 }
 
 ndScene::ndScene(const ndScene& src)
@@ -88,7 +113,17 @@ ndScene::ndScene(const ndScene& src)
 	,m_specialUpdateList()
 	,m_backgroundThread()
 	,m_newPairs(1024)
+	,m_threadScratch()
+	,m_frameAllocator()
+	,m_sweepAndPruneArray()
+	,m_sweepAndPruneBands()
+	,m_sweepAndPruneBandStart()
+	,m_sleepingContactArray()
+	,m_contactBatchQueue()
+	,m_contactBatchSorted()
+	,m_contactBatchPackets()
 	,m_lock()
+	,m_bvhLock()
 	,m_rootNode(nullptr)
 	,m_sentinelBody(nullptr)
 	,m_contactNotifyCallback(nullptr)
@@ -97,15 +132,33 @@ ndScene::ndScene(const ndScene& src)
 	,m_frameNumber(src.m_frameNumber)
 	,m_subStepNumber(src.m_subStepNumber)
 	,m_forceBalanceSceneCounter(0)
+	,m_bvhRebuildCount(src.m_bvhRebuildCount)
+	,m_broadPhaseType(src.m_broadPhaseType)
+	,m_bvhUpdateType(src.m_bvhUpdateType)
+	,m_sweepAndPruneAxis(0)
+	,m_sweepAndPruneBandAxis(0)
+	,m_sweepAndPruneBandCount(0)
+	,m_sweepAndPruneBandOrigin(ndFloat32(0.0f))
+	,m_sweepAndPruneBandInvSize(ndFloat32(0.0f))
+	,m_sleepingActiveCount(src.m_sleepingActiveCount)
+	,m_wakeSleepingIslands(0)
+	,m_contactBatchCount(0)
+	,m_bvhOutOfDate(src.m_bvhOutOfDate.load())
+	,m_sweepAndPruneDirty(true)
+	,m_islandSleep(src.m_islandSleep)
+	,m_contactBatching(src.m_contactBatching)
 {
 	ndScene* const stealData = (ndScene*)&src;
 
 	SetThreadCount(src.GetThreadCount());
+	SetThreadAffinity(src.GetThreadAffinity());
 	m_backgroundThread.SetThreadCount(m_backgroundThread.GetThreadCount());
 
 	m_scratchBuffer.Swap(stealData->m_scratchBuffer);
 	m_sceneBodyArray.Swap(stealData->m_sceneBodyArray);
 	m_activeConstraintArray.Swap(stealData->m_activeConstraintArray);
+	m_sleepingContactArray.Swap(stealData->m_sleepingContactArray);
+	stealData->m_sleepingActiveCount = 0;
 
 	ndSwap(m_rootNode, stealData->m_rootNode);
 	ndSwap(m_sentinelBody, stealData->m_sentinelBody);
@@ -140,11 +193,6 @@ ndScene::ndScene(const ndScene& src)
 		}
 		ndAssert (body->GetContactMap().SanityCheck());
 	}
-
-	for (ndInt32 i = 0; i < D_MAX_THREADS_COUNT; ++i)
-	{
-		m_partialNewPairs[i].Resize(256);
-	}
 }
 
 ndScene::~ndScene()
@@ -158,6 +206,26 @@ ndScene::~ndScene()
 	ndFreeListAlloc::Flush();
 }
 
+void ndScene::SetThreadCount(ndInt32 count)
+{
+	ndThreadPool::SetThreadCount(count);
+	if (m_threadScratch.GetCount() != GetThreadCount())
+	{
+		if (m_threadScratch.IsFirstTouch())
+		{
+			// keep the scratch entries in the memory node of the threads that use them.
+			ndThreadPool::Begin();
+			m_threadScratch.SetCount(GetThreadCount(), *this);
+			ndThreadPool::End();
+		}
+		else
+		{
+			m_threadScratch.SetCount(GetThreadCount());
+		}
+	}
+	m_frameAllocator.SetThreadCount(GetThreadCount());
+}
+
 void ndScene::Sync()
 {
 	ndThreadPool::Sync();
@@ -166,6 +234,11 @@ void ndScene::Sync()
 void ndScene::Begin()
 {
 	ndThreadPool::Begin();
+	if ((ndMemory::GetAllocationMode() == ndMemory::m_firstTouchAllocation) && !m_threadScratch.IsFirstTouch())
+	{
+		m_threadScratch.SetCount(GetThreadCount(), *this);
+	}
+	m_frameAllocator.Reset();
 }
 
 void ndScene::End()
@@ -244,6 +317,7 @@ bool ndScene::AddBody(const ndSharedPtr<ndBody>& body)
 			}
 
 			m_forceBalanceSceneCounter = 0;
+			m_sweepAndPruneDirty = true;
 
 			return true;
 		}
@@ -275,12 +349,20 @@ bool ndScene::RemoveBody(const ndSharedPtr<ndBody>& body)
 	if (kinematicBody)
 	{
 		m_forceBalanceSceneCounter = 0;
+		m_sweepAndPruneDirty = true;
 		m_bvhSceneManager.RemoveBody(kinematicBody);
 
 		ndBodyKinematic::ndContactMap& contactMap = kinematicBody->GetContactMap();
-		while (contactMap.GetRoot())
+		while (contactMap.GetCount())
 		{
-			ndContact* const contact = contactMap.GetRoot()->GetInfo();
+			ndBodyKinematic::ndContactMap::Iterator it(contactMap);
+			it.Begin();
+			ndContact* const contact = *it;
+			if (contact->m_islandSleep)
+			{
+				// parked contacts are about to die, let the next update collect them 
+				m_wakeSleepingIslands.store(1);
+			}
 			m_contactArray.DetachContact(contact);
 		}
 
@@ -314,12 +396,38 @@ void ndScene::BalanceScene()
 	UpdateBodyList();
 	if (m_bvhSceneManager.GetNodeArray().GetCount() > 2)
 	{
-		if (!m_forceBalanceSceneCounter)
+		if (m_broadPhaseType == ndSweepAndPruneBroadPhase)
+		{
+			// sweep and prune does not use the tree to find pairs, it is only 
+			// rebuilt to take in the added and removed bodies.
+			if (!m_forceBalanceSceneCounter)
+			{
+				m_rootNode = m_bvhSceneManager.BuildBvhTree(*this);
+				m_forceBalanceSceneCounter = 1;
+				m_bvhRebuildCount++;
+			}
+		}
+		else if (m_bvhUpdateType == ndBvhRefit)
 		{
-			m_rootNode = m_bvhSceneManager.BuildBvhTree(*this);
+			// the tree is only refitted, it is rebuilt when bodies are added or 
+			// removed, or when the refits degraded it past some threshold.
+			if (!m_forceBalanceSceneCounter || m_bvhSceneManager.IsTreeDegraded(m_rootNode))
+			{
+				m_rootNode = m_bvhSceneManager.BuildSahBvhTree(*this);
+				m_forceBalanceSceneCounter = 1;
+				m_bvhRebuildCount++;
+			}
+		}
+		else
+		{
+			if (!m_forceBalanceSceneCounter)
+			{
+				m_rootNode = m_bvhSceneManager.BuildBvhTree(*this);
+				m_bvhRebuildCount++;
+			}
+			const ndInt32 sceneUpdatePeriod = 64;
+			m_forceBalanceSceneCounter = (m_forceBalanceSceneCounter < sceneUpdatePeriod) ? m_forceBalanceSceneCounter + 1 : 0;
 		}
-		const ndInt32 sceneUpdatePeriod = 64;
-		m_forceBalanceSceneCounter = (m_forceBalanceSceneCounter < sceneUpdatePeriod) ? m_forceBalanceSceneCounter + 1 : 0;
 		ndAssert(!m_rootNode || !m_rootNode->m_parent);
 	}
 
@@ -392,11 +500,24 @@ void ndScene::CalculateJointContacts(ndInt32 threadIndex, ndContact* const conta
 		ndAssert(!body0->GetCollisionShape().GetShape()->GetAsShapeNull());
 		ndAssert(!body1->GetCollisionShape().GetShape()->GetAsShapeNull());
 
-		ndContactPoint contactBuffer[D_MAX_CONTATCS];
+		ndFrameAllocator::ndScope frameScope(&m_frameAllocator, threadIndex);
+		ndContactPoint* const contactBuffer = m_frameAllocator.Alloc<ndContactPoint>(threadIndex, D_MAX_CONTATCS);
 		ndContactSolver contactSolver(contact, m_contactNotifyCallback, m_timestep, threadIndex);
 		contactSolver.m_separatingVector = contact->m_separatingVector;
 		contactSolver.m_contactBuffer = contactBuffer;
+		contactSolver.m_frameAllocator = &m_frameAllocator;
 		contactSolver.m_intersectionTestOnly = body0->m_contactTestOnly | body1->m_contactTestOnly;
+		if ((body0->m_speculativeContacts | body1->m_speculativeContacts) && !contactSolver.m_intersectionTestOnly)
+		{
+			// speculative contacts, report the features the two shapes can 
+			// reach in this step. static meshes use the regular contacts.
+			ndShape* const shape0 = body0->GetCollisionShape().GetShape();
+			ndShape* const shape1 = body1->GetCollisionShape().GetShape();
+			if (!(shape0->GetAsShapeStaticMesh() || shape1->GetAsShapeStaticMesh()))
+			{
+				contactSolver.m_skinMargin = CalculateContactSpeed(contact) * m_timestep;
+			}
+		}
 
 		ndInt32 count = contactSolver.CalculateContactsDiscrete ();
 		if (count)
@@ -422,7 +543,7 @@ void ndScene::CalculateJointContacts(ndInt32 threadIndex, ndContact* const conta
 			else
 			{
 				ndAssert(count <= (D_CONSTRAINT_MAX_ROWS / 3));
-				ProcessContacts(threadIndex, count, &contactSolver);
+				ProcessContacts(threadIndex, count, contact, contactBuffer);
 				ndAssert(contact->m_maxDof);
 				contact->m_isIntersetionTestOnly = 0;
 			}
@@ -452,9 +573,8 @@ void ndScene::CalculateJointContacts(ndInt32 threadIndex, ndContact* const conta
 	}
 }
 
-void ndScene::ProcessContacts(ndInt32, ndInt32 contactCount, ndContactSolver* const contactSolver)
+void ndScene::ProcessContacts(ndInt32, ndInt32 contactCount, ndContact* const contact, const ndContactPoint* const contactArray)
 {
-	ndContact* const contact = contactSolver->m_contact;
 	contact->m_positAcc = ndVector::m_zero;
 	contact->m_rotationAcc = ndQuaternion();
 
@@ -465,7 +585,6 @@ void ndScene::ProcessContacts(ndInt32, ndInt32 contactCount, ndContactSolver* co
 	ndAssert(body0 != body1);
 
 	contact->m_material = m_contactNotifyCallback->GetMaterial(contact, body0->GetCollisionShape(), body1->GetCollisionShape());
-	const ndContactPoint* const contactArray = contactSolver->m_contactBuffer;
 	
 	ndInt32 count = 0;
 	ndVector cachePosition[D_MAX_CONTATCS];
@@ -517,31 +636,60 @@ void ndScene::ProcessContacts(ndInt32, ndInt32 contactCount, ndContactSolver* co
 		ndAssert(ndAbs(controlNormal.DotProduct(controlDir0.CrossProduct(controlDir1)).GetScalar() - ndFloat32(1.0f)) < ndFloat32(1.0e-3f));
 	}
 	
-	ndFloat32 maxImpulse = ndFloat32(-1.0f);
-	for (ndInt32 i = 0; i < contactCount; ++i) 
+	// match the new points to the cached points, first by feature id, then by
+	// proximity. The points left over inherit the forces of the closest cached 
+	// point that was not claimed, so that the total contact force carries over.
+	ndContactPointList::ndNode* matches[D_MAX_CONTATCS];
+	for (ndInt32 i = 0; i < contactCount; ++i)
+	{
+		matches[i] = nullptr;
+	}
+	for (ndInt32 pass = 0; (pass < 3) && count; ++pass)
 	{
-		ndInt32 index = -1;
-		ndFloat32 min = ndFloat32(1.0e20f);
-		ndContactPointList::ndNode* contactNode = nullptr;
-		for (ndInt32 j = 0; j < count; ++j) 
+		const ndFloat32 maxDist2 = (pass == 0) ? D_CONTACT_FEATURE_DIST2 : (pass == 1) ? D_CONTACT_MATCH_DIST2 : ndFloat32(1.0e20f);
+		for (ndInt32 i = 0; (i < contactCount) && count; ++i)
 		{
-			ndVector v(ndVector::m_triplexMask & (cachePosition[j] - contactArray[i].m_point));
-			ndAssert(v.m_w == ndFloat32(0.0f));
-			diff = v.DotProduct(v).GetScalar();
-			if (diff < min) 
+			if (!matches[i])
 			{
-				index = j;
-				min = diff;
-				contactNode = nodes[j];
+				ndInt32 index = -1;
+				ndFloat32 min = maxDist2;
+				for (ndInt32 j = 0; j < count; ++j)
+				{
+					if ((pass == 0) && (nodes[j]->GetInfo().m_featureId != contactArray[i].m_featureId))
+					{
+						continue;
+					}
+					ndVector v(ndVector::m_triplexMask & (cachePosition[j] - contactArray[i].m_point));
+					ndAssert(v.m_w == ndFloat32(0.0f));
+					diff = v.DotProduct(v).GetScalar();
+					if (diff < min)
+					{
+						index = j;
+						min = diff;
+					}
+				}
+
+				if (index >= 0)
+				{
+					matches[i] = nodes[index];
+					count--;
+					nodes[index] = nodes[count];
+					cachePosition[index] = cachePosition[count];
+				}
 			}
 		}
-	
+	}
+
+	ndFloat32 maxImpulse = ndFloat32(-1.0f);
+	for (ndInt32 i = 0; i < contactCount; ++i) 
+	{
+		ndContactPointList::ndNode* contactNode = matches[i];
+		ndVector cachedDir0(ndVector::m_zero);
+		ndVector cachedDir1(ndVector::m_zero);
 		if (contactNode) 
 		{
-			count--;
-			ndAssert(index != -1);
-			nodes[index] = nodes[count];
-			cachePosition[index] = cachePosition[count];
+			cachedDir0 = contactNode->GetInfo().m_dir0;
+			cachedDir1 = contactNode->GetInfo().m_dir1;
 		}
 		else 
 		{
@@ -568,6 +716,7 @@ void ndScene::ProcessContacts(ndInt32, ndInt32 contactCount, ndContactSolver* co
 		contactPoint->m_shapeInstance1 = contactArray[i].m_shapeInstance1;
 		contactPoint->m_shapeId0 = contactArray[i].m_shapeId0;
 		contactPoint->m_shapeId1 = contactArray[i].m_shapeId1;
+		contactPoint->m_featureId = contactArray[i].m_featureId;
 		contactPoint->m_material = *contact->m_material;
 	
 		if (staticMotion) 
@@ -637,6 +786,13 @@ void ndScene::ProcessContacts(ndInt32, ndInt32 contactCount, ndContactSolver* co
 		ndAssert(contactPoint->m_dir0.m_w == ndFloat32(0.0f));
 		ndAssert(contactPoint->m_dir0.m_w == ndFloat32(0.0f));
 		ndAssert(contactPoint->m_normal.m_w == ndFloat32(0.0f));
+
+		if (matches[i])
+		{
+			// the friction directions change from frame to frame, 
+			// project the cached friction forces onto the new directions.
+			contactPoint->WarmStartFriction(cachedDir0, cachedDir1);
+		}
 	}
 	
 	for (ndInt32 i = 0; i < count; ++i) 
@@ -786,6 +942,384 @@ void ndScene::FindCollidingPairsBackward(ndBodyKinematic* const body, ndInt32 th
 	}
 }
 
+void ndScene::SweepAndPruneSort()
+{
+	D_TRACKTIME();
+	class ndCompareKey
+	{
+		public:
+		ndCompareKey(const void* const context)
+			:m_axis(*((ndInt32*)context))
+		{
+		}
+
+		ndInt32 Compare(const ndSweepAndPruneEntry& entryA, const ndSweepAndPruneEntry& entryB) const
+		{
+			const ndFloat32 keyA = entryA.m_minBox[m_axis];
+			const ndFloat32 keyB = entryB.m_minBox[m_axis];
+			if (keyA < keyB)
+			{
+				return -1;
+			}
+			else if (keyA > keyB)
+			{
+				return 1;
+			}
+			return 0;
+		}
+
+		ndInt32 m_axis;
+	};
+
+	bool fullSort = m_sweepAndPruneDirty;
+	if (m_sweepAndPruneDirty)
+	{
+		const ndArray<ndBodyKinematic*>& view = GetActiveBodyArray();
+		const ndInt32 bodyCount = view.GetCount() - 1;
+		m_sweepAndPruneArray.SetCount(bodyCount);
+		for (ndInt32 i = 0; i < bodyCount; ++i)
+		{
+			m_sweepAndPruneArray[i].m_body = view[i];
+		}
+		m_sweepAndPruneDirty = false;
+	}
+	ndAssert(m_sweepAndPruneArray.GetCount() == (GetActiveBodyArray().GetCount() - 1));
+
+	ndAtomic<ndInt32> iterator(0);
+	auto UpdateBoxes = ndMakeObject::ndFunction([this, &iterator](ndInt32, ndInt32)
+	{
+		D_TRACKTIME_NAMED(UpdateBoxes);
+		ndBvhNodeArray& nodeArray = m_bvhSceneManager.GetNodeArray();
+		ndArray<ndSweepAndPruneEntry>& entryArray = m_sweepAndPruneArray;
+
+		const ndInt32 count = entryArray.GetCount();
+		for (ndInt32 i = iterator.fetch_add(D_WORKER_BATCH_SIZE); i < count; i = iterator.fetch_add(D_WORKER_BATCH_SIZE))
+		{
+			const ndInt32 maxSpan = ((count - i) >= D_WORKER_BATCH_SIZE) ? D_WORKER_BATCH_SIZE : count - i;
+			for (ndInt32 j = 0; j < maxSpan; ++j)
+			{
+				ndSweepAndPruneEntry& entry = entryArray[i + j];
+				const ndBvhNode* const bodyNode = nodeArray[entry.m_body->m_bodyNodeIndex];
+				ndAssert(bodyNode->GetAsSceneBodyNode());
+				ndAssert(bodyNode->GetBody() == entry.m_body);
+				entry.m_minBox = bodyNode->m_minBox;
+				entry.m_maxBox = bodyNode->m_maxBox;
+			}
+		}
+	});
+	ParallelExecute(UpdateBoxes);
+
+	// sweep along the axis with the largest spread of box centers, 
+	// a different axis has to be better by some margin before switching 
+	// so that scenes with similar spread in two directions do not flip every frame.
+	const ndInt32 count = m_sweepAndPruneArray.GetCount();
+	ndVector sum(ndVector::m_zero);
+	ndVector sum2(ndVector::m_zero);
+	ndVector sizeSum(ndVector::m_zero);
+	ndVector minBox(ndFloat32(1.0e15f));
+	ndVector maxBox(ndFloat32(-1.0e15f));
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		const ndSweepAndPruneEntry& entry = m_sweepAndPruneArray[i];
+		const ndVector center(entry.m_minBox + entry.m_maxBox);
+		sum += center;
+		sum2 += center * center;
+		sizeSum += entry.m_maxBox - entry.m_minBox;
+		minBox = minBox.GetMin(entry.m_minBox);
+		maxBox = maxBox.GetMax(entry.m_maxBox);
+	}
+	const ndVector den(ndFloat32(1.0f) / ndFloat32(ndMax(count, 1)));
+	const ndVector mean(sum * den);
+	const ndVector variance(sum2 * den - mean * mean);
+
+	ndInt32 axis = m_sweepAndPruneAxis;
+	for (ndInt32 i = 0; i < 3; ++i)
+	{
+		if (variance[i] > ndFloat32(1.5f) * variance[axis])
+		{
+			axis = i;
+		}
+	}
+	if (axis != m_sweepAndPruneAxis)
+	{
+		fullSort = true;
+		m_sweepAndPruneAxis = axis;
+	}
+
+	if (fullSort)
+	{
+		if (count > 1)
+		{
+			ndSort<ndSweepAndPruneEntry, ndCompareKey>(&m_sweepAndPruneArray[0], count, &axis);
+		}
+	}
+	else
+	{
+		// boxes move little from one step to the next, so an insertion sort 
+		// of the previous order is close to linear.
+		ndArray<ndSweepAndPruneEntry>& entryArray = m_sweepAndPruneArray;
+		for (ndInt32 i = 1; i < count; ++i)
+		{
+			const ndSweepAndPruneEntry entry(entryArray[i]);
+			const ndFloat32 key = entry.m_minBox[axis];
+			ndInt32 j = i - 1;
+			for (; (j >= 0) && (entryArray[j].m_minBox[axis] > key); --j)
+			{
+				entryArray[j + 1] = entryArray[j];
+			}
+			entryArray[j + 1] = entry;
+		}
+	}
+
+	SweepAndPruneBuildBands(minBox, maxBox, sizeSum * den);
+}
+
+ndInt32 ndScene::SweepAndPruneBand(ndFloat32 value) const
+{
+	const ndInt32 band = ndInt32(ndFloor((value - m_sweepAndPruneBandOrigin) * m_sweepAndPruneBandInvSize));
+	return ndClamp(band, 0, m_sweepAndPruneBandCount - 1);
+}
+
+void ndScene::SweepAndPruneBuildBands(const ndVector& minBox, const ndVector& maxBox, const ndVector& averageSize)
+{
+	D_TRACKTIME();
+	// a single sorted axis finds all the bodies in a slice across the scene, 
+	// which for bodies spread on a plane is a large fraction of the scene. 
+	// so the second axis is cut in bands a few bodies wide and each band 
+	// is swept on its own. a body is in all the bands its box touches.
+	const ndInt32 count = m_sweepAndPruneArray.GetCount();
+	const ndInt32 axis = m_sweepAndPruneAxis;
+	const ndInt32 bandAxis = (axis + 1) % 3;
+	const ndInt32 otherAxis = (axis + 2) % 3;
+	const ndVector extent(maxBox - minBox);
+	m_sweepAndPruneBandAxis = (extent[otherAxis] > extent[bandAxis]) ? otherAxis : bandAxis;
+
+	const ndFloat32 bandSize = ndMax(ndFloat32(4.0f) * averageSize[m_sweepAndPruneBandAxis], ndFloat32(1.0e-3f));
+	const ndInt32 maxBands = ndInt32(ndSqrt(ndFloat32(count))) + 1;
+	m_sweepAndPruneBandCount = ndClamp(ndInt32(extent[m_sweepAndPruneBandAxis] / bandSize), 1, maxBands);
+	m_sweepAndPruneBandOrigin = minBox[m_sweepAndPruneBandAxis];
+	m_sweepAndPruneBandInvSize = ndFloat32(m_sweepAndPruneBandCount) / ndMax(extent[m_sweepAndPruneBandAxis], ndFloat32(1.0e-3f));
+
+	ndArray<ndInt32>& bandStart = m_sweepAndPruneBandStart;
+	bandStart.SetCount(m_sweepAndPruneBandCount + 1);
+	for (ndInt32 i = 0; i <= m_sweepAndPruneBandCount; ++i)
+	{
+		bandStart[i] = 0;
+	}
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		const ndSweepAndPruneEntry& entry = m_sweepAndPruneArray[i];
+		const ndInt32 band0 = SweepAndPruneBand(entry.m_minBox[m_sweepAndPruneBandAxis]);
+		const ndInt32 band1 = SweepAndPruneBand(entry.m_maxBox[m_sweepAndPruneBandAxis]);
+		for (ndInt32 j = band0; j <= band1; ++j)
+		{
+			bandStart[j + 1]++;
+		}
+	}
+	for (ndInt32 i = 0; i < m_sweepAndPruneBandCount; ++i)
+	{
+		bandStart[i + 1] += bandStart[i];
+	}
+
+	// the entries are visited in sweep order, so each band is sorted too.
+	m_sweepAndPruneBands.SetCount(bandStart[m_sweepAndPruneBandCount]);
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		const ndSweepAndPruneEntry& entry = m_sweepAndPruneArray[i];
+		const ndInt32 band0 = SweepAndPruneBand(entry.m_minBox[m_sweepAndPruneBandAxis]);
+		const ndInt32 band1 = SweepAndPruneBand(entry.m_maxBox[m_sweepAndPruneBandAxis]);
+		for (ndInt32 j = band0; j <= band1; ++j)
+		{
+			ndSweepAndPruneBandEntry& bandEntry = m_sweepAndPruneBands[bandStart[j]];
+			bandEntry.m_entry = i;
+			bandEntry.m_band = j;
+			bandStart[j]++;
+		}
+	}
+	for (ndInt32 i = m_sweepAndPruneBandCount; i > 0; --i)
+	{
+		bandStart[i] = bandStart[i - 1];
+	}
+	bandStart[0] = 0;
+}
+
+void ndScene::SweepAndPruneSubmitPairs(ndInt32 index, ndInt32 threadId)
+{
+	const ndInt32 axis = m_sweepAndPruneAxis;
+	const ndInt32 bandAxis = m_sweepAndPruneBandAxis;
+	const ndArray<ndSweepAndPruneEntry>& entryArray = m_sweepAndPruneArray;
+	const ndArray<ndSweepAndPruneBandEntry>& bandArray = m_sweepAndPruneBands;
+
+	const ndSweepAndPruneBandEntry& bandEntry = bandArray[index];
+	const ndSweepAndPruneEntry& entry0 = entryArray[bandEntry.m_entry];
+	ndBodyKinematic* const body0 = entry0.m_body;
+	const ndFloat32 maxValue = entry0.m_maxBox[axis];
+
+	const ndInt32 band = bandEntry.m_band;
+	const ndInt32 bandEnd = m_sweepAndPruneBandStart[band + 1];
+	for (ndInt32 i = index + 1; (i < bandEnd) && (entryArray[bandArray[i].m_entry].m_minBox[axis] <= maxValue); ++i)
+	{
+		const ndSweepAndPruneEntry& entry1 = entryArray[bandArray[i].m_entry];
+		ndBodyKinematic* const body1 = entry1.m_body;
+
+		// same filter as the tree traversal, at least one of the two bodies 
+		// changed its scene box and at least one is not at rest.
+		const bool test = !(body0->m_sceneEquilibrium & body1->m_sceneEquilibrium) && !(body0->m_equilibrium & body1->m_equilibrium);
+		if (test && ndOverlapTest(entry0.m_minBox, entry0.m_maxBox, entry1.m_minBox, entry1.m_maxBox))
+		{
+			// a pair that shares more than one band is only reported 
+			// by the band where the overlap of the two boxes starts.
+			const ndFloat32 overlapStart = ndMax(entry0.m_minBox[bandAxis], entry1.m_minBox[bandAxis]);
+			if (SweepAndPruneBand(overlapStart) == band)
+			{
+				ndBodyKinematic* const owner = body0->m_sceneEquilibrium ? body1 : body0;
+				ndBodyKinematic* const other = body0->m_sceneEquilibrium ? body0 : body1;
+				ndBodyNotify* const notify = owner->GetNotifyCallback();
+				if (!notify || notify->OnSceneAabbOverlap(other))
+				{
+					AddPair(owner, other, threadId);
+				}
+			}
+		}
+	}
+}
+
+void ndScene::SweepAndPruneFindPairs()
+{
+	D_TRACKTIME();
+	if (!m_sceneBodyArray.GetCount())
+	{
+		return;
+	}
+
+	SweepAndPruneSort();
+
+	ndAtomic<ndInt32> iterator(0);
+	auto FindPairs = ndMakeObject::ndFunction([this, &iterator](ndInt32 threadIndex, ndInt32)
+	{
+		D_TRACKTIME_NAMED(SweepAndPrunePairs);
+		const ndInt32 count = m_sweepAndPruneBands.GetCount();
+		for (ndInt32 i = iterator.fetch_add(D_WORKER_BATCH_SIZE); i < count; i = iterator.fetch_add(D_WORKER_BATCH_SIZE))
+		{
+			const ndInt32 maxSpan = ((count - i) >= D_WORKER_BATCH_SIZE) ? D_WORKER_BATCH_SIZE : count - i;
+			for (ndInt32 j = 0; j < maxSpan; ++j)
+			{
+				SweepAndPruneSubmitPairs(i + j, threadIndex);
+			}
+		}
+	});
+	ParallelExecute(FindPairs);
+}
+
+void ndScene::SetBvhUpdateType(ndBvhUpdateType type)
+{
+	if (type != m_bvhUpdateType)
+	{
+		m_bvhUpdateType = type;
+		m_forceBalanceSceneCounter = 0;
+	}
+}
+
+ndFloat32 ndScene::GetBvhQuality() const
+{
+	return m_bvhSceneManager.GetTreeQuality(m_rootNode);
+}
+
+void ndScene::SetBroadPhaseType(ndBroadPhaseType type)
+{
+	if (type != m_broadPhaseType)
+	{
+		m_broadPhaseType = type;
+		m_sweepAndPruneArray.SetCount(0);
+		m_sweepAndPruneBands.SetCount(0);
+		m_sweepAndPruneDirty = true;
+		// the tree was not maintained in sweep and prune mode. 
+		m_forceBalanceSceneCounter = 0;
+	}
+}
+
+void ndScene::RefitOutOfDateBvh() const
+{
+	if (!m_bvhOutOfDate.load())
+	{
+		return;
+	}
+
+	ndScopeSpinLock lock(m_bvhLock);
+	if (m_bvhOutOfDate.load())
+	{
+		// same refit as the bvh broad phase, boxes only grow until the next rebuild.
+		const ndArray<ndBodyKinematic*>& view = GetActiveBodyArray();
+		for (ndInt32 i = view.GetCount() - 2; i >= 0; --i)
+		{
+			const ndBvhNode* const bodyNode = m_bvhSceneManager.GetLeafNode(view[i]);
+			for (ndBvhInternalNode* parent = (ndBvhInternalNode*)bodyNode->m_parent; parent; parent = (ndBvhInternalNode*)parent->m_parent)
+			{
+				ndAssert(parent->GetAsSceneTreeNode());
+				const ndVector minBox(parent->m_left->m_minBox.GetMin(parent->m_right->m_minBox));
+				const ndVector maxBox(parent->m_left->m_maxBox.GetMax(parent->m_right->m_maxBox));
+				if (ndBoxInclusionTest(minBox, maxBox, parent->m_minBox, parent->m_maxBox))
+				{
+					break;
+				}
+				parent->m_minBox = minBox;
+				parent->m_maxBox = maxBox;
+			}
+		}
+		m_bvhOutOfDate.store(0);
+	}
+}
+
+void ndScene::SetIslandSleep(bool state)
+{
+	if (state != m_islandSleep)
+	{
+		m_islandSleep = state;
+		if (!state)
+		{
+			for (ndInt32 i = 0; i < m_sleepingContactArray.GetCount(); ++i)
+			{
+				ndContact* const contact = m_sleepingContactArray[i];
+				contact->m_islandSleep = 0;
+				contact->m_sceneLru = m_lru;
+				m_contactArray.PushBack(contact);
+			}
+			m_sleepingContactArray.SetCount(0);
+			m_sleepingActiveCount = 0;
+		}
+	}
+}
+
+ndInt32 ndScene::GetMeshFaceCacheHits() const
+{
+	ndInt32 hits = 0;
+	for (ndInt32 i = 0; i < m_threadScratch.GetCount(); ++i)
+	{
+		hits += m_threadScratch[i].m_meshFaceCacheHits;
+	}
+	return hits;
+}
+
+ndInt32 ndScene::GetMeshFaceCacheLookups() const
+{
+	ndInt32 lookups = 0;
+	for (ndInt32 i = 0; i < m_threadScratch.GetCount(); ++i)
+	{
+		lookups += m_threadScratch[i].m_meshFaceCacheLookups;
+	}
+	return lookups;
+}
+
+ndInt32 ndScene::GetMeshFaceCacheSkips() const
+{
+	ndInt32 skips = 0;
+	for (ndInt32 i = 0; i < m_threadScratch.GetCount(); ++i)
+	{
+		skips += m_threadScratch[i].m_meshFaceCacheSkips;
+	}
+	return skips;
+}
+
 void ndScene::UpdateTransform()
 {
 	D_TRACKTIME();
@@ -820,6 +1354,44 @@ void ndScene::UpdateTransform()
 	ParallelExecute(TransformUpdate);
 }
 
+ndFloat32 ndScene::CalculateContactSpeed(const ndContact* const contact) const
+{
+	// upper bound of the speed at which the two shapes can approach each other
+	const ndBodyKinematic* const body0 = contact->GetBody0();
+	const ndBodyKinematic* const body1 = contact->GetBody1();
+	const ndVector veloc0(body0->GetVelocity());
+	const ndVector veloc1(body1->GetVelocity());
+
+	const ndVector veloc(veloc1 - veloc0);
+	const ndVector omega0(body0->GetOmega());
+	const ndVector omega1(body1->GetOmega());
+	const ndShapeInstance* const collision0 = &body0->GetCollisionShape();
+	const ndShapeInstance* const collision1 = &body1->GetCollisionShape();
+	const ndVector scale(ndFloat32(1.0f), ndFloat32(3.5f) * collision0->GetBoxMaxRadius(), ndFloat32(3.5f) * collision1->GetBoxMaxRadius(), ndFloat32(0.0f));
+	const ndVector velocMag2(veloc.DotProduct(veloc).GetScalar(), omega0.DotProduct(omega0).GetScalar(), omega1.DotProduct(omega1).GetScalar(), ndFloat32(0.0f));
+	const ndVector velocMag(velocMag2.GetMax(ndVector::m_epsilon).InvSqrt() * velocMag2 * scale);
+	return velocMag.AddHorizontal().GetScalar() + ndFloat32(0.5f);
+}
+
+void ndScene::UpdateContactActiveState(ndContact* const contact, bool wasActive)
+{
+	if (wasActive ^ contact->IsActive())
+	{
+		ndBodyKinematic* const body0 = contact->GetBody0();
+		ndBodyKinematic* const body1 = contact->GetBody1();
+		ndAssert(body0->GetInvMass() > ndFloat32(0.0f));
+		body0->m_equilibrium = 0;
+		if (body1->GetInvMass() > ndFloat32(0.0f))
+		{
+			body1->m_equilibrium = 0;
+		}
+		if (body0->m_islandSleep | body1->m_islandSleep)
+		{
+			m_wakeSleepingIslands.store(1);
+		}
+	}
+}
+
 void ndScene::CalculateContacts(ndInt32 threadIndex, ndContact* const contact)
 {
 	const ndUnsigned32 lru = m_lru - D_CONTACT_DELAY_FRAMES;
@@ -846,24 +1418,26 @@ void ndScene::CalculateContacts(ndInt32 threadIndex, ndContact* const contact)
 			ndFloat32 distance = contact->m_separationDistance;
 			if (distance >= D_NARROW_PHASE_DIST)
 			{
-				const ndVector veloc0(body0->GetVelocity());
-				const ndVector veloc1(body1->GetVelocity());
-				
-				const ndVector veloc(veloc1 - veloc0);
-				const ndVector omega0(body0->GetOmega());
-				const ndVector omega1(body1->GetOmega());
-				const ndShapeInstance* const collision0 = &body0->GetCollisionShape();
-				const ndShapeInstance* const collision1 = &body1->GetCollisionShape();
-				const ndVector scale(ndFloat32(1.0f), ndFloat32(3.5f) * collision0->GetBoxMaxRadius(), ndFloat32(3.5f) * collision1->GetBoxMaxRadius(), ndFloat32(0.0f));
-				const ndVector velocMag2(veloc.DotProduct(veloc).GetScalar(), omega0.DotProduct(omega0).GetScalar(), omega1.DotProduct(omega1).GetScalar(), ndFloat32(0.0f));
-				const ndVector velocMag(velocMag2.GetMax(ndVector::m_epsilon).InvSqrt() * velocMag2 * scale);
-				const ndFloat32 speed = velocMag.AddHorizontal().GetScalar() + ndFloat32(0.5f);
-				
-				distance -= speed * m_timestep;
+				distance -= CalculateContactSpeed(contact) * m_timestep;
 				contact->m_separationDistance = distance;
 			}
 			if (distance < D_NARROW_PHASE_DIST)
 			{
+				if (m_contactBatching && !(body0->m_contactTestOnly | body1->m_contactTestOnly | body0->m_speculativeContacts | body1->m_speculativeContacts))
+				{
+					const ndContactBatch::ndPairType pairType = ndContactBatch::GetPairType(body0->GetCollisionShape(), body1->GetCollisionShape());
+					if (pairType != ndContactBatch::m_generic)
+					{
+						// primitive pairs are solved in packets of the same 
+						// type, after all the contacts are visited.
+						ndContactBatchEntry& entry = m_contactBatchQueue[m_contactBatchCount.fetch_add(1)];
+						entry.m_contact = contact;
+						entry.m_pairType = pairType;
+						entry.m_wasActive = active ? 1 : 0;
+						return;
+					}
+				}
+
 				CalculateJointContacts(threadIndex, contact);
 				if (contact->m_maxDof || contact->m_isIntersetionTestOnly)
 				{
@@ -889,15 +1463,7 @@ void ndScene::CalculateContacts(ndInt32 threadIndex, ndContact* const contact)
 			}
 		}
 
-		if (active ^ contact->IsActive())
-		{
-			ndAssert(body0->GetInvMass() > ndFloat32(0.0f));
-			body0->m_equilibrium = 0;
-			if (body1->GetInvMass() > ndFloat32(0.0f))
-			{
-				body1->m_equilibrium = 0;
-			}
-		}
+		UpdateContactActiveState(contact, active);
 	}
 	else
 	{
@@ -988,6 +1554,7 @@ bool ndScene::ConvexCast(ndConvexCastNotify& callback, const ndBvhNode** stackPo
 							callback.m_closestPoint0 = savedNotification.m_closestPoint0;
 							callback.m_closestPoint1 = savedNotification.m_closestPoint1;
 							callback.m_param = savedNotification.m_param;
+							callback.m_contacts.SetCount(savedNotification.m_contacts.GetCount());
 							for (ndInt32 i = 0; i < savedNotification.m_contacts.GetCount(); ++i)
 							{
 								callback.m_contacts[i] = savedNotification.m_contacts[i];
@@ -1003,6 +1570,7 @@ bool ndScene::ConvexCast(ndConvexCastNotify& callback, const ndBvhNode** stackPo
 						callback.m_closestPoint0 = savedNotification.m_closestPoint0;
 						callback.m_closestPoint1 = savedNotification.m_closestPoint1;
 						callback.m_param = savedNotification.m_param;
+						callback.m_contacts.SetCount(savedNotification.m_contacts.GetCount());
 						for (ndInt32 i = 0; i < savedNotification.m_contacts.GetCount(); ++i)
 						{
 							callback.m_contacts[i] = savedNotification.m_contacts[i];
@@ -1140,6 +1708,7 @@ bool ndScene::RayCast(ndRayCastNotify& callback, const ndBvhNode** stackPool, nd
 void ndScene::BodiesInAabb(ndBodiesInAabbNotify& callback, const ndVector& minBox, const ndVector& maxBox) const
 {
 	callback.Reset();
+	RefitOutOfDateBvh();
 	if (m_rootNode)
 	{
 		const ndBvhNode* stackPool[D_SCENE_MAX_STACK_DEPTH];
@@ -1198,6 +1767,12 @@ void ndScene::Cleanup()
 	}
 
 	m_bvhSceneManager.CleanUp();
+	for (ndInt32 i = m_sleepingContactArray.GetCount() - 1; i >= 0; --i)
+	{
+		m_contactArray.PushBack(m_sleepingContactArray[i]);
+	}
+	m_sleepingContactArray.SetCount(0);
+	m_sleepingActiveCount = 0;
 	m_contactArray.DeleteAllContacts();
 
 	ndFreeListAlloc::Flush();
@@ -1210,6 +1785,8 @@ void ndScene::Cleanup()
 	m_scratchBuffer.SetCount(0);
 	m_sceneBodyArray.SetCount(0);
 	m_activeConstraintArray.SetCount(0);
+	m_sweepAndPruneArray.SetCount(0);
+	m_sweepAndPruneDirty = true;
 }
 
 bool ndScene::RayCast(ndRayCastNotify& callback, const ndVector& globalOrigin, const ndVector& globalDest) const
@@ -1219,6 +1796,7 @@ bool ndScene::RayCast(ndRayCastNotify& callback, const ndVector& globalOrigin, c
 
 	bool state = false;
 	callback.m_param = ndFloat32(1.2f);
+	RefitOutOfDateBvh();
 	if (m_rootNode)
 	{
 		const ndVector segment(p1 - p0);
@@ -1242,6 +1820,7 @@ bool ndScene::ConvexCast(ndConvexCastNotify& callback, const ndShapeInstance& co
 {
 	bool state = false;
 	callback.m_param = ndFloat32(1.2f);
+	RefitOutOfDateBvh();
 	if (m_rootNode)
 	{
 		ndVector boxP0;
@@ -1265,15 +1844,314 @@ bool ndScene::ConvexCast(ndConvexCastNotify& callback, const ndShapeInstance& co
 	return state;
 }
 
-void ndScene::SendBackgroundTask(ndBackgroundTask* const job)
-{
-	m_backgroundThread.SendTask(job);
-}
-
-void ndScene::AddPair(ndBodyKinematic* const body0, ndBodyKinematic* const body1, ndInt32 threadId)
+void ndScene::RayCastPacket(const ndRayCastBatchQuery* const queries, const ndInt32* const queryIndex, ndInt32 count, ndCastBatchHit* const hits) const
 {
-	const ndBodyKinematic::ndContactMap& contactMap0 = body0->GetContactMap();
-	const ndBodyKinematic::ndContactMap& contactMap1 = body1->GetContactMap();
+	class ndBatchClosestHit : public ndRayCastNotify
+	{
+		public:
+		ndFloat32 OnRayCastAction(const ndContactPoint& contact, ndFloat32 intersetParam)
+		{
+			if (intersetParam < m_param)
+			{
+				m_contact = contact;
+				m_param = intersetParam;
+			}
+			return intersetParam;
+		}
+	};
+
+	ndAssert(count <= D_SCENE_RAY_PACKET_SIZE);
+	ndBatchClosestHit notify[D_SCENE_RAY_PACKET_SIZE];
+	ndFastRay* const rays = ndAlloca(ndFastRay, D_SCENE_RAY_PACKET_SIZE);
+
+	// transpose the packet so that each box test checks all rays at once, 
+	// a degenerated or missing ray gets a negative param, so it never hits.
+	ndFloat32 param[D_SCENE_RAY_PACKET_SIZE];
+	ndFloat32 origin[3][D_SCENE_RAY_PACKET_SIZE];
+	ndFloat32 invDir[3][D_SCENE_RAY_PACKET_SIZE];
+	const ndVector step(ndFloat32(1.0f), ndFloat32(0.0f), ndFloat32(0.0f), ndFloat32(0.0f));
+	for (ndInt32 i = 0; i < D_SCENE_RAY_PACKET_SIZE; ++i)
+	{
+		const ndRayCastBatchQuery& query = queries[queryIndex[ndMin(i, count - 1)]];
+		const ndVector p0(query.m_origin & ndVector::m_triplexMask);
+		const ndVector p1(query.m_dest & ndVector::m_triplexMask);
+		const ndVector segment(p1 - p0);
+		const bool valid = (i < count) && (segment.DotProduct(segment).GetScalar() > ndFloat32(1.0e-8f));
+
+		::new (&rays[i]) ndFastRay(p0, valid ? p1 : p0 + step);
+		param[i] = valid ? ndFloat32(1.0f) : ndFloat32(-1.0f);
+		for (ndInt32 j = 0; j < 3; ++j)
+		{
+			origin[j][i] = valid ? rays[i].m_p0[j] : ndFloat32(0.0f);
+			invDir[j][i] = valid ? rays[i].m_dpInv[j] : ndFloat32(0.0f);
+		}
+	}
+
+	const ndVector originX(&origin[0][0]);
+	const ndVector originY(&origin[1][0]);
+	const ndVector originZ(&origin[2][0]);
+	const ndVector invDirX(&invDir[0][0]);
+	const ndVector invDirY(&invDir[1][0]);
+	const ndVector invDirZ(&invDir[2][0]);
+	ndVector maxParam(&param[0]);
+
+	auto PacketBoxTest = [&originX, &originY, &originZ, &invDirX, &invDirY, &invDirZ, &maxParam](const ndBvhNode* const node, ndFloat32& distance)
+	{
+		const ndVector tx0((ndVector(node->m_minBox.m_x) - originX) * invDirX);
+		const ndVector tx1((ndVector(node->m_maxBox.m_x) - originX) * invDirX);
+		const ndVector ty0((ndVector(node->m_minBox.m_y) - originY) * invDirY);
+		const ndVector ty1((ndVector(node->m_maxBox.m_y) - originY) * invDirY);
+		const ndVector tz0((ndVector(node->m_minBox.m_z) - originZ) * invDirZ);
+		const ndVector tz1((ndVector(node->m_maxBox.m_z) - originZ) * invDirZ);
+		const ndVector tmin(tx0.GetMin(tx1).GetMax(ty0.GetMin(ty1)).GetMax(tz0.GetMin(tz1)).GetMax(ndVector::m_zero));
+		const ndVector tmax(tx0.GetMax(tx1).GetMin(ty0.GetMax(ty1)).GetMin(tz0.GetMax(tz1)).GetMin(maxParam));
+		const ndVector hit(tmin <= tmax);
+		const ndVector entry(ndVector(ndFloat32(1.0e10f)).Select(tmin, hit));
+		distance = ndMin(ndMin(entry.m_x, entry.m_y), ndMin(entry.m_z, entry.m_w));
+		return hit.GetSignMask();
+	};
+
+	// each stack entry remembers which rays of the packet entered its box
+	ndInt32 stackMask[D_SCENE_MAX_STACK_DEPTH];
+	ndFloat32 stackDistance[D_SCENE_MAX_STACK_DEPTH];
+	const ndBvhNode* stackPool[D_SCENE_MAX_STACK_DEPTH];
+
+	ndInt32 stack = 0;
+	stackMask[0] = PacketBoxTest(m_rootNode, stackDistance[0]);
+	if (stackMask[0])
+	{
+		stackPool[0] = m_rootNode;
+		stack = 1;
+	}
+
+	while (stack && (stack < (D_SCENE_MAX_STACK_DEPTH - 4)))
+	{
+		stack--;
+		if (stackDistance[stack] > maxParam.GetMax().GetScalar())
+		{
+			continue;
+		}
+
+		const ndBvhNode* const node = stackPool[stack];
+		ndBodyKinematic* const body = node->GetBody();
+		if (body)
+		{
+			bool newHit = false;
+			for (ndInt32 i = 0, mask = stackMask[stack]; mask; ++i, mask >>= 1)
+			{
+				if (mask & 1)
+				{
+					if (body->RayCast(notify[i], rays[i], notify[i].m_param))
+					{
+						param[i] = ndMin(param[i], notify[i].m_param);
+						newHit = true;
+					}
+				}
+			}
+			if (newHit)
+			{
+				maxParam = ndVector(&param[0]);
+			}
+		}
+		else
+		{
+			ndFloat32 leftDistance;
+			ndFloat32 rightDistance;
+			const ndBvhNode* const left = node->GetLeft();
+			const ndBvhNode* const right = node->GetRight();
+			const ndInt32 leftMask = PacketBoxTest(left, leftDistance);
+			const ndInt32 rightMask = PacketBoxTest(right, rightDistance);
+
+			// push the far child first so that the near one is visited first
+			const bool leftFirst = leftDistance < rightDistance;
+			const ndInt32 nearMask = leftFirst ? leftMask : rightMask;
+			const ndInt32 farMask = leftFirst ? rightMask : leftMask;
+			if (farMask)
+			{
+				stackPool[stack] = leftFirst ? right : left;
+				stackDistance[stack] = leftFirst ? rightDistance : leftDistance;
+				stackMask[stack] = farMask;
+				stack++;
+			}
+			if (nearMask)
+			{
+				stackPool[stack] = leftFirst ? left : right;
+				stackDistance[stack] = leftFirst ? leftDistance : rightDistance;
+				stackMask[stack] = nearMask;
+				stack++;
+			}
+			ndAssert(stack < D_SCENE_MAX_STACK_DEPTH);
+		}
+	}
+
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		const ndInt32 index = queryIndex[i];
+		ndCastBatchHit& hit = hits[index];
+		if (notify[i].m_param < ndFloat32(1.0f))
+		{
+			hit.m_point = notify[i].m_contact.m_point;
+			hit.m_normal = notify[i].m_contact.m_normal;
+			hit.m_body = notify[i].m_contact.m_body0;
+			hit.m_param = notify[i].m_param;
+		}
+		else
+		{
+			hit.m_point = queries[index].m_dest & ndVector::m_triplexMask;
+			hit.m_normal = ndVector::m_zero;
+			hit.m_body = nullptr;
+			hit.m_param = ndFloat32(1.2f);
+		}
+	}
+}
+
+void ndScene::RayCastBatch(const ndArray<ndRayCastBatchQuery>& queries, ndArray<ndCastBatchHit>& hits)
+{
+	D_TRACKTIME();
+	class ndRayKey
+	{
+		public:
+		ndRayKey(void* const)
+		{
+		}
+
+		ndInt32 Compare(const ndUnsigned64 key0, const ndUnsigned64 key1) const
+		{
+			return (key0 < key1) ? -1 : (key0 > key1) ? 1 : 0;
+		}
+	};
+
+	const ndInt32 count = queries.GetCount();
+	hits.SetCount(count);
+	RefitOutOfDateBvh();
+	if (!count || !m_rootNode)
+	{
+		for (ndInt32 i = 0; i < count; ++i)
+		{
+			hits[i].m_point = queries[i].m_dest & ndVector::m_triplexMask;
+			hits[i].m_normal = ndVector::m_zero;
+			hits[i].m_body = nullptr;
+			hits[i].m_param = ndFloat32(1.2f);
+		}
+		return;
+	}
+
+	// packets only pay off when their rays are close to each other, 
+	// so group the queries by the morton code of their segment center.
+	ndVector minBox(ndFloat32(1.0e15f));
+	ndVector maxBox(ndFloat32(-1.0e15f));
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		const ndVector center(ndVector::m_half * (queries[i].m_origin + queries[i].m_dest));
+		minBox = minBox.GetMin(center);
+		maxBox = maxBox.GetMax(center);
+	}
+	const ndVector size((maxBox - minBox).GetMax(ndVector(ndFloat32(1.0e-3f))));
+	const ndVector scale(ndVector(ndFloat32(1023.0f)) * size.Reciproc());
+
+	m_scratchBuffer.SetCount(ndInt32(count * sizeof(ndUnsigned64)));
+	ndUnsigned64* const keys = (ndUnsigned64*)&m_scratchBuffer[0];
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		const ndVector center(ndVector::m_half * (queries[i].m_origin + queries[i].m_dest));
+		const ndVector cell(((center - minBox) * scale).GetInt());
+		ndUnsigned64 code = 0;
+		for (ndInt32 bit = 9; bit >= 0; --bit)
+		{
+			code = (code << 3) | ndUnsigned64(((cell.m_iz >> bit) & 1) << 2) | ndUnsigned64(((cell.m_iy >> bit) & 1) << 1) | ndUnsigned64((cell.m_ix >> bit) & 1);
+		}
+		keys[i] = (code << 32) | ndUnsigned64(i);
+	}
+	ndSort<ndUnsigned64, ndRayKey>(keys, count, nullptr);
+
+	ndInt32* const queryIndex = (ndInt32*)keys;
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		queryIndex[i] = ndInt32(keys[i] & 0xffffffff);
+	}
+
+	ndAtomic<ndInt32> iterator(0);
+	auto RayCastPackets = ndMakeObject::ndFunction([this, &iterator, &queries, &hits, queryIndex](ndInt32, ndInt32)
+	{
+		D_TRACKTIME_NAMED(RayCastPackets);
+		const ndInt32 queryCount = queries.GetCount();
+		const ndInt32 packetCount = (queryCount + D_SCENE_RAY_PACKET_SIZE - 1) / D_SCENE_RAY_PACKET_SIZE;
+		for (ndInt32 i = iterator.fetch_add(D_WORKER_BATCH_SIZE); i < packetCount; i = iterator.fetch_add(D_WORKER_BATCH_SIZE))
+		{
+			const ndInt32 maxSpan = ((packetCount - i) >= D_WORKER_BATCH_SIZE) ? D_WORKER_BATCH_SIZE : packetCount - i;
+			for (ndInt32 j = 0; j < maxSpan; ++j)
+			{
+				const ndInt32 start = (i + j) * D_SCENE_RAY_PACKET_SIZE;
+				const ndInt32 packetSize = ndMin(D_SCENE_RAY_PACKET_SIZE, queryCount - start);
+				RayCastPacket(&queries[0], &queryIndex[start], packetSize, &hits[0]);
+			}
+		}
+	});
+
+	ndThreadPool::Begin();
+	ParallelExecute(RayCastPackets);
+	ndThreadPool::End();
+}
+
+void ndScene::ConvexCastBatch(const ndShapeInstance& convexShape, const ndArray<ndConvexCastBatchQuery>& queries, ndArray<ndCastBatchHit>& hits)
+{
+	class ndBatchConvexCast : public ndConvexCastNotify
+	{
+		public:
+		ndUnsigned32 OnRayPrecastAction(const ndBody* const, const ndShapeInstance* const)
+		{
+			return 1;
+		}
+	};
+
+	D_TRACKTIME();
+	hits.SetCount(queries.GetCount());
+	RefitOutOfDateBvh();
+	ndAtomic<ndInt32> iterator(0);
+	auto ConvexCastQueries = ndMakeObject::ndFunction([this, &iterator, &convexShape, &queries, &hits](ndInt32, ndInt32)
+	{
+		D_TRACKTIME_NAMED(ConvexCastQueries);
+		const ndInt32 count = queries.GetCount();
+		for (ndInt32 i = iterator.fetch_add(D_WORKER_BATCH_SIZE); i < count; i = iterator.fetch_add(D_WORKER_BATCH_SIZE))
+		{
+			const ndInt32 maxSpan = ((count - i) >= D_WORKER_BATCH_SIZE) ? D_WORKER_BATCH_SIZE : count - i;
+			for (ndInt32 j = 0; j < maxSpan; ++j)
+			{
+				ndBatchConvexCast notify;
+				const ndConvexCastBatchQuery& query = queries[i + j];
+				ndCastBatchHit& hit = hits[i + j];
+				if (ConvexCast(notify, convexShape, query.m_origin, query.m_dest) && notify.m_contacts.GetCount())
+				{
+					hit.m_point = notify.m_contacts[0].m_point;
+					hit.m_normal = notify.m_normal;
+					hit.m_body = notify.m_contacts[0].m_body1;
+					hit.m_param = notify.m_param;
+				}
+				else
+				{
+					hit.m_point = query.m_dest & ndVector::m_triplexMask;
+					hit.m_normal = ndVector::m_zero;
+					hit.m_body = nullptr;
+					hit.m_param = ndFloat32(1.2f);
+				}
+			}
+		}
+	});
+
+	ndThreadPool::Begin();
+	ParallelExecute(ConvexCastQueries);
+	ndThreadPool::End();
+}
+
+void ndScene::SendBackgroundTask(ndBackgroundTask* const job)
+{
+	m_backgroundThread.SendTask(job);
+}
+
+void ndScene::AddPair(ndBodyKinematic* const body0, ndBodyKinematic* const body1, ndInt32 threadId)
+{
+	const ndBodyKinematic::ndContactMap& contactMap0 = body0->GetContactMap();
+	const ndBodyKinematic::ndContactMap& contactMap1 = body1->GetContactMap();
 
 	ndContact* const contact = (contactMap0.GetCount() <= contactMap1.GetCount()) ? contactMap0.FindContact(body0, body1) : contactMap1.FindContact(body1, body0);
 	if (!contact)
@@ -1282,14 +2160,14 @@ void ndScene::AddPair(ndBodyKinematic* const body0, ndBodyKinematic* const body1
 		const bool isCollidable = bilateral ? bilateral->IsCollidable() : true;
 		if (isCollidable)
 		{
-			ndArray<ndContactPairs>& particalPairs = m_partialNewPairs[threadId];
+			ndArray<ndContactPairs>& particalPairs = m_threadScratch[threadId].m_partialNewPairs;
 			ndContactPairs pair(ndUnsigned32(body0->m_index), ndUnsigned32(body1->m_index));
 			particalPairs.PushBack(pair);
 		}
 	}
 }
 
-void ndScene::FindCollidingPairs()
+void ndScene::BvhFindPairs()
 {
 	D_TRACKTIME();
 	ndAtomic<ndInt32> iterator0(0);
@@ -1328,27 +2206,40 @@ void ndScene::FindCollidingPairs()
 		}
 	});
 
+	ParallelExecute(FindPairsForward);
+	ParallelExecute(FindPairsBackward);
+}
+
+void ndScene::FindCollidingPairs()
+{
+	D_TRACKTIME();
 	for (ndInt32 i = GetThreadCount() - 1; i >= 0; --i)
 	{
-		m_partialNewPairs[i].SetCount(0);
+		m_threadScratch[i].m_partialNewPairs.SetCount(0);
 	}
 
 	const ndInt32 threadCount = GetThreadCount();
 
-	ParallelExecute(FindPairsForward);
-	ParallelExecute(FindPairsBackward);
+	if (m_broadPhaseType == ndSweepAndPruneBroadPhase)
+	{
+		SweepAndPruneFindPairs();
+	}
+	else
+	{
+		BvhFindPairs();
+	}
 
 	ndInt32 sum = 0;
 	for (ndInt32 i = 0; i < threadCount; ++i)
 	{
-		sum += m_partialNewPairs[i].GetCount();
+		sum += m_threadScratch[i].m_partialNewPairs.GetCount();
 	}
 	m_newPairs.SetCount(sum);
 
 	sum = 0;
 	for (ndInt32 i = 0; i < threadCount; ++i)
 	{
-		const ndArray<ndContactPairs>& newPairs = m_partialNewPairs[i];
+		const ndArray<ndContactPairs>& newPairs = m_threadScratch[i].m_partialNewPairs;
 		const ndInt32 count = newPairs.GetCount();
 		if (count)
 		{
@@ -1375,6 +2266,17 @@ void ndScene::UpdateBodyList()
 	}
 }
 
+void ndScene::ApplyExtForce(ndInt32 threadIndex, ndInt32 start, ndInt32 count)
+{
+	const ndArray<ndBodyKinematic*>& view = GetActiveBodyArray();
+	const ndFloat32 timestep = m_timestep;
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndBodyKinematic* const body = view[start + i];
+		body->ApplyExternalForces(threadIndex, timestep);
+	}
+}
+
 void ndScene::ApplyExtForce()
 {
 	D_TRACKTIME();
@@ -1382,24 +2284,61 @@ void ndScene::ApplyExtForce()
 	auto ApplyForce = ndMakeObject::ndFunction([this, &iterator](ndInt32 threadIndex, ndInt32)
 	{
 		D_TRACKTIME_NAMED(ApplyForce);
-		const ndArray<ndBodyKinematic*>& view = GetActiveBodyArray();
-
-		const ndFloat32 timestep = m_timestep;
-
-		const ndInt32 count = view.GetCount() - 1;
+		const ndInt32 count = GetActiveBodyArray().GetCount() - 1;
 		for (ndInt32 i = iterator.fetch_add(D_WORKER_BATCH_SIZE); i < count; i = iterator.fetch_add(D_WORKER_BATCH_SIZE))
 		{
 			const ndInt32 maxSpan = ((count - i) >= D_WORKER_BATCH_SIZE) ? D_WORKER_BATCH_SIZE : count - i;
-			for (ndInt32 j = 0; j < maxSpan; ++j)
-			{
-				ndBodyKinematic* const body = view[i + j];
-				body->ApplyExternalForces(threadIndex, timestep);
-			}
+			ApplyExtForce(threadIndex, i, maxSpan);
 		}
 	});
 	ParallelExecute(ApplyForce);
 }
 
+void ndScene::InitBodyArray(ndInt32 start, ndInt32 count)
+{
+	const ndArray<ndBodyKinematic*>& view = GetActiveBodyArray();
+	ndBvhNodeArray& array = m_bvhSceneManager.GetNodeArray();
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndBodyKinematic* const body = view[start + i];
+		body->PrepareStep(start + i);
+		ndUnsigned8 sceneEquilibrium = 1;
+		ndUnsigned8 sceneForceUpdate = body->m_sceneForceUpdate;
+		ndUnsigned8 moving = ndUnsigned8(!body->m_equilibrium);
+		if (moving & body->m_islandSleep)
+		{
+			body->m_islandSleep = 0;
+			m_wakeSleepingIslands.store(1);
+		}
+		if (moving | sceneForceUpdate)
+		{
+			ndBvhLeafNode* const bodyNode = (ndBvhLeafNode*)array[body->m_bodyNodeIndex];
+			ndAssert(bodyNode->GetAsSceneBodyNode());
+			ndAssert(bodyNode->m_body == body);
+			ndAssert(!bodyNode->GetLeft());
+			ndAssert(!bodyNode->GetRight());
+
+			body->UpdateCollisionMatrix();
+			if (body->m_speculativeContacts)
+			{
+				// the box of a speculative body covers the path of the body in 
+				// this step, so that the broad phase finds what it can hit.
+				const ndVector step((body->m_veloc & ndVector::m_triplexMask).Scale(m_timestep));
+				body->m_minAabb += step.GetMin(ndVector::m_zero);
+				body->m_maxAabb += step.GetMax(ndVector::m_zero);
+			}
+			const ndInt32 test = ndBoxInclusionTest(body->m_minAabb, body->m_maxAabb, bodyNode->m_minBox, bodyNode->m_maxBox);
+			if (!test)
+			{
+				bodyNode->SetAabb(body->m_minAabb, body->m_maxAabb);
+			}
+			sceneEquilibrium = ndUnsigned8(!sceneForceUpdate & (test != 0));
+		}
+		body->m_sceneForceUpdate = 0;
+		body->m_sceneEquilibrium = sceneEquilibrium;
+	}
+}
+
 void ndScene::InitBodyArray()
 {
 	D_TRACKTIME();
@@ -1407,44 +2346,20 @@ void ndScene::InitBodyArray()
 	auto BuildBodyArray = ndMakeObject::ndFunction([this, &iterator](ndInt32, ndInt32)
 	{
 		D_TRACKTIME_NAMED(BuildBodyArray);
-		const ndArray<ndBodyKinematic*>& view = GetActiveBodyArray();
-
-		ndBvhNodeArray& array = m_bvhSceneManager.GetNodeArray();
-		const ndInt32 count = view.GetCount() - 1;
+		const ndInt32 count = GetActiveBodyArray().GetCount() - 1;
 		for (ndInt32 i = iterator.fetch_add(D_WORKER_BATCH_SIZE); i < count; i = iterator.fetch_add(D_WORKER_BATCH_SIZE))
 		{
 			const ndInt32 maxSpan = ((count - i) >= D_WORKER_BATCH_SIZE) ? D_WORKER_BATCH_SIZE : count - i;
-			for (ndInt32 j = 0; j < maxSpan; ++j)
-			{
-				ndBodyKinematic* const body = view[i + j];
-				body->PrepareStep(i + j);
-				ndUnsigned8 sceneEquilibrium = 1;
-				ndUnsigned8 sceneForceUpdate = body->m_sceneForceUpdate;
-				ndUnsigned8 moving = ndUnsigned8(!body->m_equilibrium);
-				if (moving | sceneForceUpdate)
-				{
-					ndBvhLeafNode* const bodyNode = (ndBvhLeafNode*)array[body->m_bodyNodeIndex];
-					ndAssert(bodyNode->GetAsSceneBodyNode());
-					ndAssert(bodyNode->m_body == body);
-					ndAssert(!bodyNode->GetLeft());
-					ndAssert(!bodyNode->GetRight());
-
-					body->UpdateCollisionMatrix();
-					const ndInt32 test = ndBoxInclusionTest(body->m_minAabb, body->m_maxAabb, bodyNode->m_minBox, bodyNode->m_maxBox);
-					if (!test)
-					{
-						bodyNode->SetAabb(body->m_minAabb, body->m_maxAabb);
-					}
-					sceneEquilibrium = ndUnsigned8(!sceneForceUpdate & (test != 0));
-				}
-				body->m_sceneForceUpdate = 0;
-				body->m_sceneEquilibrium = sceneEquilibrium;
-			}
+			InitBodyArray(i, maxSpan);
 		}
 	});
-
 	ParallelExecute(BuildBodyArray);
+	FinishBodyArray();
+}
 
+void ndScene::FinishBodyArray()
+{
+	D_TRACKTIME();
 	ndUnsigned32 scans[4];
 	class ndSortCompactKey
 	{
@@ -1470,16 +2385,23 @@ void ndScene::InitBodyArray()
 		m_sceneBodyArray.SetCount(movingBodyCount);
 	}
 
-	if (m_rootNode && m_rootNode->GetAsSceneTreeNode())
+	if (m_broadPhaseType == ndSweepAndPruneBroadPhase)
+	{
+		// the leaf boxes are up to date, the first query refits the rest of the tree.
+		m_bvhOutOfDate.store(1);
+	}
+	else if (m_rootNode && m_rootNode->GetAsSceneTreeNode())
 	{
 		const ndInt32 bodyCount = m_bodyList.GetCount();
 		const ndInt32 cutoffCount = (ndExp2(bodyCount) + 1) * movingBodyCount;
 		if (cutoffCount < bodyCount)
 		{
 			ndAtomic<ndInt32> iterator1(0);
-			auto UpdateSceneBvh = ndMakeObject::ndFunction([this, &iterator1](ndInt32, ndInt32)
+			ndFloat64* const areaDelta = ndAlloca(ndFloat64, GetThreadCount());
+			auto UpdateSceneBvh = ndMakeObject::ndFunction([this, &iterator1, &areaDelta](ndInt32 threadIndex, ndInt32)
 			{
 				D_TRACKTIME_NAMED(UpdateSceneBvh);
+				ndFloat64 delta = ndFloat64(0.0f);
 				const ndArray<ndBodyKinematic*>& view = m_sceneBodyArray;
 				ndBvhNodeArray& array = m_bvhSceneManager.GetNodeArray();
 
@@ -1506,15 +2428,21 @@ void ndScene::InitBodyArray()
 							{
 								break;
 							}
+							delta += ndBvhNode::CalculateSurfaceArea(minBox, maxBox) - ndBvhNode::CalculateSurfaceArea(parent->m_minBox, parent->m_maxBox);
 							parent->m_minBox = minBox;
 							parent->m_maxBox = maxBox;
 						}
 					}
 				}
+				areaDelta[threadIndex] = delta;
 			});
 	
 			D_TRACKTIME_NAMED(UpdateSceneBvhLight);
 			ParallelExecute(UpdateSceneBvh);
+			for (ndInt32 i = GetThreadCount() - 1; i >= 0; --i)
+			{
+				m_bvhSceneManager.AddSurfaceAreaDelta(areaDelta[i]);
+			}
 		}
 		else
 		{
@@ -1539,6 +2467,10 @@ void ndScene::InitBodyArray()
 void ndScene::CreateNewContacts()
 {
 	D_TRACKTIME();
+	if (m_wakeSleepingIslands.load())
+	{
+		WakeSleepingContacts();
+	}
 	const ndInt32 contactCount = m_contactArray.GetCount();
 	m_scratchBuffer.SetCount(ndInt32((contactCount + m_newPairs.GetCount() + 16) * sizeof(ndContact*)));
 
@@ -1592,6 +2524,12 @@ void ndScene::CalculateContacts()
 {
 	D_TRACKTIME();
 	m_activeConstraintArray.SetCount(0);
+	for (ndInt32 i = 0; i < m_threadScratch.GetCount(); ++i)
+	{
+		m_threadScratch[i].m_meshFaceCacheHits = 0;
+		m_threadScratch[i].m_meshFaceCacheLookups = 0;
+		m_threadScratch[i].m_meshFaceCacheSkips = 0;
+	}
 	const ndInt32 contactCount = m_contactArray.GetCount() + m_newPairs.GetCount();
 	m_contactArray.SetCount(contactCount);
 	if (contactCount)
@@ -1618,7 +2556,139 @@ void ndScene::CalculateContacts()
 				}
 			}
 		});
+		m_contactBatchCount.store(0);
+		if (m_contactBatching)
+		{
+			m_contactBatchQueue.SetCount(contactCount);
+		}
 		ParallelExecute(CalculateContactPoints);
+
+		if (m_contactBatchCount.load())
+		{
+			CalculateBatchContacts();
+		}
+	}
+}
+
+void ndScene::CalculateBatchContacts()
+{
+	D_TRACKTIME();
+	// bucket the queued pairs by type, and split each bucket in packets
+	ndInt32 typeStart[ndContactBatch::m_pairTypeCount + 1];
+	for (ndInt32 i = 0; i <= ndContactBatch::m_pairTypeCount; ++i)
+	{
+		typeStart[i] = 0;
+	}
+
+	const ndInt32 count = m_contactBatchCount.load();
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		typeStart[m_contactBatchQueue[i].m_pairType + 1]++;
+	}
+	for (ndInt32 i = 1; i <= ndContactBatch::m_pairTypeCount; ++i)
+	{
+		typeStart[i] += typeStart[i - 1];
+	}
+
+	m_contactBatchPackets.SetCount(0);
+	for (ndInt32 i = 0; i < ndContactBatch::m_pairTypeCount; ++i)
+	{
+		for (ndInt32 j = typeStart[i]; j < typeStart[i + 1]; j += D_CONTACT_BATCH_WIDTH)
+		{
+			m_contactBatchPackets.PushBack(j);
+		}
+	}
+	m_contactBatchPackets.PushBack(count);
+
+	m_contactBatchSorted.SetCount(count);
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		const ndContactBatchEntry& entry = m_contactBatchQueue[i];
+		m_contactBatchSorted[typeStart[entry.m_pairType]++] = entry;
+	}
+
+	ndAtomic<ndInt32> iterator(0);
+	auto CalculateContactPackets = ndMakeObject::ndFunction([this, &iterator](ndInt32 threadIndex, ndInt32)
+	{
+		D_TRACKTIME_NAMED(CalculateContactPackets);
+		const ndInt32 packetCount = m_contactBatchPackets.GetCount() - 1;
+		for (ndInt32 i = iterator.fetch_add(1); i < packetCount; i = iterator.fetch_add(1))
+		{
+			const ndInt32 start = m_contactBatchPackets[i];
+			CalculateBatchContacts(threadIndex, &m_contactBatchSorted[start], m_contactBatchPackets[i + 1] - start);
+		}
+	});
+	ParallelExecute(CalculateContactPackets);
+}
+
+void ndScene::CalculateBatchContacts(ndInt32 threadIndex, const ndContactBatchEntry* const entries, ndInt32 count)
+{
+	ndAssert(count <= D_CONTACT_BATCH_WIDTH);
+	ndContact* contacts[D_CONTACT_BATCH_WIDTH];
+	ndContactBatch::ndPair pairs[D_CONTACT_BATCH_WIDTH];
+	ndContactPoint contactBuffer[D_CONTACT_BATCH_WIDTH * D_CONTACT_BATCH_MAX_POINTS];
+
+	ndInt32 pairCount = 0;
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndContact* const contact = entries[i].m_contact;
+		ndAssert(entries[i].m_pairType == entries[0].m_pairType);
+		if (m_contactNotifyCallback->OnAabbOverlap(contact, m_timestep))
+		{
+			ndContactBatch::ndPair& pair = pairs[pairCount];
+			pair.m_instance0 = &contact->GetBody0()->GetCollisionShape();
+			pair.m_instance1 = &contact->GetBody1()->GetCollisionShape();
+			pair.m_contacts = &contactBuffer[pairCount * D_CONTACT_BATCH_MAX_POINTS];
+			contacts[pairCount] = contact;
+			pairCount++;
+		}
+	}
+
+	if (pairCount)
+	{
+		ndContactBatch::CalculateContacts(ndContactBatch::ndPairType(entries[0].m_pairType), pairs, pairCount);
+	}
+
+	for (ndInt32 i = 0; i < pairCount; ++i)
+	{
+		ndContact* const contact = contacts[i];
+		const ndContactBatch::ndPair& pair = pairs[i];
+		if (pair.m_degenerate)
+		{
+			CalculateJointContacts(threadIndex, contact);
+			continue;
+		}
+		contact->m_timeOfImpact = m_timestep;
+		contact->m_separatingVector = pair.m_separatingVector;
+		contact->m_separationDistance = pair.m_separationDistance;
+		if (pair.m_count)
+		{
+			for (ndInt32 j = 0; j < pair.m_count; ++j)
+			{
+				pair.m_contacts[j].m_body0 = contact->GetBody0();
+				pair.m_contacts[j].m_body1 = contact->GetBody1();
+			}
+			contact->SetActive(true);
+			ProcessContacts(threadIndex, pair.m_count, contact, pair.m_contacts);
+			ndAssert(contact->m_maxDof);
+			contact->m_isIntersetionTestOnly = 0;
+		}
+		else
+		{
+			contact->m_maxDof = 0;
+		}
+	}
+
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndContact* const contact = entries[i].m_contact;
+		if (contact->m_maxDof || contact->m_isIntersetionTestOnly)
+		{
+			contact->SetActive(true);
+			contact->m_timeOfImpact = ndFloat32(1.0e10f);
+		}
+		contact->m_sceneLru = m_lru;
+		UpdateContactActiveState(contact, entries[i].m_wasActive ? true : false);
 	}
 }
 
@@ -1653,6 +2723,24 @@ void ndScene::DeleteDeadContacts()
 	};
 	ndUnsigned32 prefixScan[5];
 
+	if (m_wakeSleepingIslands.load())
+	{
+		// at this point the live contacts are in the scratch buffer, append the woken ones there.
+		const ndInt32 start = m_contactArray.GetCount();
+		WakeSleepingContacts();
+		const ndInt32 count = m_contactArray.GetCount();
+		const ndInt32 scratchSize = ndInt32((count + 16) * sizeof(ndContact*));
+		if (m_scratchBuffer.GetCount() < scratchSize)
+		{
+			m_scratchBuffer.SetCount(scratchSize);
+		}
+		ndContact** const tmpJointsArray = (ndContact**)&m_scratchBuffer[0];
+		for (ndInt32 i = start; i < count; ++i)
+		{
+			tmpJointsArray[i] = m_contactArray[i];
+		}
+	}
+
 	if (m_contactArray.GetCount())
 	{
 		D_TRACKTIME();
@@ -1688,13 +2776,114 @@ void ndScene::DeleteDeadContacts()
 			m_contactArray.SetCount(ndInt32(prefixScan[m_inactive + 1]));
 		}
 
-		m_activeConstraintArray.SetCount(ndInt32(prefixScan[m_active + 1]));
+		ndInt32 activeCount = ndInt32(prefixScan[m_active + 1]);
+		if (m_islandSleep)
+		{
+			activeCount = ParkSleepingContacts(activeCount);
+		}
+
+		m_activeConstraintArray.SetCount(activeCount);
 		if (m_activeConstraintArray.GetCount())
 		{
 			ndConstraint** constraintArray = (ndConstraint**)& m_contactArray[0];
 			ndMemCpy(&m_activeConstraintArray[0], constraintArray, m_activeConstraintArray.GetCount());
 		}
 	}
+
+	if (m_sleepingActiveCount)
+	{
+		// the solver still owns the sleeping islands, it will skip them as resting 
+		// but it needs their joints to decide when they wake up. 
+		const ndInt32 activeCount = m_activeConstraintArray.GetCount();
+		m_activeConstraintArray.SetCount(activeCount + m_sleepingActiveCount);
+		ndConstraint** constraintArray = (ndConstraint**)&m_sleepingContactArray[0];
+		ndMemCpy(&m_activeConstraintArray[activeCount], constraintArray, m_sleepingActiveCount);
+	}
+}
+
+ndInt32 ndScene::ParkSleepingContacts(ndInt32 activeCount)
+{
+	D_TRACKTIME();
+	// contacts are sorted active first, the sleeping array keeps the same partition, 
+	// so that its active contacts can still be handed to the solver with one copy.
+	ndInt32 awakeCount = 0;
+	ndInt32 awakeActiveCount = 0;
+	ndContact** const contactArray = &m_contactArray[0];
+	const ndInt32 contactCount = m_contactArray.GetCount();
+	for (ndInt32 i = 0; i < contactCount; ++i)
+	{
+		ndContact* const contact = contactArray[i];
+		ndBodyKinematic* const body0 = contact->GetBody0();
+		ndBodyKinematic* const body1 = contact->GetBody1();
+		if (body0->m_equilibrium & body1->m_equilibrium)
+		{
+			ndAssert(!contact->m_isDead);
+			// only dynamic bodies are flagged, a static body is shared by many 
+			// islands and its flag would never be cleared, so each contact that 
+			// changes state on it would scan the sleeping array. 
+			contact->m_islandSleep = 1;
+			body0->m_islandSleep = ndUnsigned8(body0->m_islandSleep | (body0->GetInvMass() > ndFloat32(0.0f)));
+			body1->m_islandSleep = ndUnsigned8(body1->m_islandSleep | (body1->GetInvMass() > ndFloat32(0.0f)));
+			m_sleepingContactArray.PushBack(contact);
+			if (i < activeCount)
+			{
+				const ndInt32 last = m_sleepingContactArray.GetCount() - 1;
+				ndSwap(m_sleepingContactArray[m_sleepingActiveCount], m_sleepingContactArray[last]);
+				m_sleepingActiveCount++;
+			}
+		}
+		else
+		{
+			awakeActiveCount += (i < activeCount) ? 1 : 0;
+			contactArray[awakeCount] = contact;
+			awakeCount++;
+		}
+	}
+	m_contactArray.SetCount(awakeCount);
+	return awakeActiveCount;
+}
+
+void ndScene::WakeSleepingContacts()
+{
+	D_TRACKTIME();
+	// a body in a sleeping island moved, or was removed, 
+	// return all parked contacts that touch an awake body to the scene.
+	ndInt32 sleepingCount = 0;
+	ndInt32 sleepingActiveCount = 0;
+	const ndInt32 count = m_sleepingContactArray.GetCount();
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		ndContact* const contact = m_sleepingContactArray[i];
+		ndAssert(contact->m_islandSleep);
+		bool wakeUp = contact->m_isDead ? true : false;
+		if (!wakeUp)
+		{
+			ndBodyKinematic* const body0 = contact->GetBody0();
+			ndBodyKinematic* const body1 = contact->GetBody1();
+			wakeUp = !(body0->m_equilibrium & body1->m_equilibrium);
+			if (wakeUp)
+			{
+				body0->m_islandSleep = ndUnsigned8(body0->m_islandSleep & body0->m_equilibrium);
+				body1->m_islandSleep = ndUnsigned8(body1->m_islandSleep & body1->m_equilibrium);
+			}
+		}
+
+		if (wakeUp)
+		{
+			contact->m_islandSleep = 0;
+			contact->m_sceneLru = m_lru;
+			m_contactArray.PushBack(contact);
+		}
+		else
+		{
+			sleepingActiveCount += (i < m_sleepingActiveCount) ? 1 : 0;
+			m_sleepingContactArray[sleepingCount] = contact;
+			sleepingCount++;
+		}
+	}
+	m_sleepingContactArray.SetCount(sleepingCount);
+	m_sleepingActiveCount = sleepingActiveCount;
+	m_wakeSleepingIslands.store(0);
 }
 
 void ndScene::ParticleUpdate(ndFloat32 timestep)
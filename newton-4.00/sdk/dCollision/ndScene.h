@@ -29,13 +29,17 @@
 #include "ndPolygonMeshDesc.h"
 
 #define D_SCENE_MAX_STACK_DEPTH		256
+#define D_SCENE_RAY_PACKET_SIZE		4
 
 class ndWorld;
 class ndScene;
 class ndContact;
 class ndRayCastNotify;
+class ndCastBatchHit;
 class ndContactNotify;
 class ndConvexCastNotify;
+class ndRayCastBatchQuery;
+class ndConvexCastBatchQuery;
 class ndBodiesInAabbNotify;
 class ndJointBilateralConstraint;
 
@@ -57,6 +61,19 @@ class ndSceneTreeNotiFy : public ndClassAlloc
 D_MSV_NEWTON_ALIGN_32
 class ndScene : public ndThreadPool
 {
+	public:
+	enum ndBroadPhaseType
+	{
+		ndBvhBroadPhase,
+		ndSweepAndPruneBroadPhase,
+	};
+
+	enum ndBvhUpdateType
+	{
+		ndBvhPeriodicRebuild,
+		ndBvhRefit,
+	};
+
 	protected:
 	class ndContactPairs
 	{
@@ -71,6 +88,50 @@ class ndScene : public ndThreadPool
 		ndUnsigned32 m_body1;
 	};
 
+	class ndThreadScratch
+	{
+		public:
+		ndThreadScratch()
+			:m_partialNewPairs(256)
+			,m_staticMeshQuery()
+			,m_proceduralStaticMeshQuery()
+			,m_meshFaceCacheHits(0)
+			,m_meshFaceCacheLookups(0)
+			,m_meshFaceCacheSkips(0)
+		{
+		}
+
+		ndArray<ndContactPairs> m_partialNewPairs;
+		ndPolygonMeshDesc::ndStaticMeshFaceQuery m_staticMeshQuery;
+		ndPolygonMeshDesc::ndProceduralStaticMeshFaceQuery m_proceduralStaticMeshQuery;
+		ndInt32 m_meshFaceCacheHits;
+		ndInt32 m_meshFaceCacheLookups;
+		ndInt32 m_meshFaceCacheSkips;
+	};
+
+	class ndSweepAndPruneEntry
+	{
+		public:
+		ndVector m_minBox;
+		ndVector m_maxBox;
+		ndBodyKinematic* m_body;
+	};
+
+	class ndSweepAndPruneBandEntry
+	{
+		public:
+		ndInt32 m_entry;
+		ndInt32 m_band;
+	};
+
+	class ndContactBatchEntry
+	{
+		public:
+		ndContact* m_contact;
+		ndInt32 m_pairType;
+		ndInt32 m_wasActive;
+	};
+
 	public:
 	D_COLLISION_API virtual ~ndScene();
 	D_COLLISION_API virtual bool AddBody(const ndSharedPtr<ndBody>& body);
@@ -95,10 +156,15 @@ class ndScene : public ndThreadPool
 	D_COLLISION_API virtual void BodiesInAabb(ndBodiesInAabbNotify& callback, const ndVector& minBox, const ndVector& maxBox) const;
 	D_COLLISION_API virtual bool RayCast(ndRayCastNotify& callback, const ndVector& globalOrigin, const ndVector& globalDest) const;
 	D_COLLISION_API virtual bool ConvexCast(ndConvexCastNotify& callback, const ndShapeInstance& convexShape, const ndMatrix& globalOrigin, const ndVector& globalDest) const;
+	// the batch queries use the scene workers and scratch buffer, they must be
+	// called outside an update, after Sync.
+	D_COLLISION_API virtual void RayCastBatch(const ndArray<ndRayCastBatchQuery>& queries, ndArray<ndCastBatchHit>& hits);
+	D_COLLISION_API virtual void ConvexCastBatch(const ndShapeInstance& convexShape, const ndArray<ndConvexCastBatchQuery>& queries, ndArray<ndCastBatchHit>& hits);
 
 	D_COLLISION_API void SendBackgroundTask(ndBackgroundTask* const job);
 
 	ndInt32 GetThreadCount() const;
+	D_COLLISION_API virtual void SetThreadCount(ndInt32 count);
 
 	virtual ndWorld* GetWorld() const;
 	const ndBodyListView& GetBodyList() const;
@@ -111,6 +177,37 @@ class ndScene : public ndThreadPool
 	const ndArray<ndConstraint*>& GetActiveContactArray() const;
 
 	ndArray<ndUnsigned8>& GetScratchBuffer();
+	ndFrameAllocator& GetFrameAllocator();
+
+	// in sweep and prune mode the update does not refit or rebalance the bvh, 
+	// it is only rebuilt when bodies are added or removed, and the scene queries 
+	// refit it on demand before they traverse it.
+	ndBroadPhaseType GetBroadPhaseType() const;
+	D_COLLISION_API void SetBroadPhaseType(ndBroadPhaseType type);
+
+	ndBvhUpdateType GetBvhUpdateType() const;
+	D_COLLISION_API void SetBvhUpdateType(ndBvhUpdateType type);
+	ndUnsigned32 GetBvhRebuildCount() const;
+	D_COLLISION_API ndFloat32 GetBvhQuality() const;
+
+	// with island sleep on, the contacts of resting islands are parked out of 
+	// the contact array, so the world contact list does not include them. 
+	// they stay in the contact map of their bodies.
+	bool GetIslandSleep() const;
+	D_COLLISION_API void SetIslandSleep(bool state);
+	ndInt32 GetSleepingContactCount() const;
+
+	bool GetContactBatching() const;
+	void SetContactBatching(bool state);
+
+	// static mesh face cache lookups and hits of the last update, and the 
+	// cached faces whose polygon test was skipped on their separation.
+	D_COLLISION_API ndInt32 GetMeshFaceCacheHits() const;
+	D_COLLISION_API ndInt32 GetMeshFaceCacheLookups() const;
+	D_COLLISION_API ndInt32 GetMeshFaceCacheSkips() const;
+
+	// true when the per thread scratch was allocated by its own worker thread.
+	bool IsThreadScratchFirstTouch() const;
 
 	ndFloat32 GetTimestep() const;
 	void SetTimestep(ndFloat32 timestep);
@@ -127,12 +224,29 @@ class ndScene : public ndThreadPool
 	void FindCollidingPairsBackward(ndBodyKinematic* const body, ndInt32 threadId);
 	void AddPair(ndBodyKinematic* const body0, ndBodyKinematic* const body1, ndInt32 threadId);
 	void SubmitPairs(ndBvhLeafNode* const bodyNode, ndBvhNode* const node, bool forward, ndInt32 threadId);
+	void SweepAndPruneSort();
+	void SweepAndPruneFindPairs();
+	void SweepAndPruneSubmitPairs(ndInt32 index, ndInt32 threadId);
+	void SweepAndPruneBuildBands(const ndVector& minBox, const ndVector& maxBox, const ndVector& averageSize);
+	ndInt32 SweepAndPruneBand(ndFloat32 value) const;
+	void RefitOutOfDateBvh() const;
+	void BvhFindPairs();
+	ndInt32 ParkSleepingContacts(ndInt32 activeCount);
+	void WakeSleepingContacts();
 
 	void CalculateJointContacts(ndInt32 threadIndex, ndContact* const contact);
-	void ProcessContacts(ndInt32 threadIndex, ndInt32 contactCount, ndContactSolver* const contactSolver);
+	void CalculateBatchContacts();
+	void CalculateBatchContacts(ndInt32 threadIndex, const ndContactBatchEntry* const entries, ndInt32 count);
+	void UpdateContactActiveState(ndContact* const contact, bool wasActive);
+	ndFloat32 CalculateContactSpeed(const ndContact* const contact) const;
+	void ApplyExtForce(ndInt32 threadIndex, ndInt32 start, ndInt32 count);
+	void InitBodyArray(ndInt32 start, ndInt32 count);
+	void FinishBodyArray();
+	void ProcessContacts(ndInt32 threadIndex, ndInt32 contactCount, ndContact* const contact, const ndContactPoint* const contactArray);
 
 	ndJointBilateralConstraint* FindBilateralJoint(ndBodyKinematic* const body0, ndBodyKinematic* const body1) const;
 	bool RayCast(ndRayCastNotify& callback, const ndBvhNode** stackPool, ndFloat32* const distance, ndInt32 stack, const ndFastRay& ray) const;
+	void RayCastPacket(const ndRayCastBatchQuery* const queries, const ndInt32* const queryIndex, ndInt32 count, ndCastBatchHit* const hits) const;
 	bool ConvexCast(ndConvexCastNotify& callback, const ndBvhNode** stackPool, ndFloat32* const distance, ndInt32 stack, const ndFastRay& ray, const ndShapeInstance& convexShape, const ndMatrix& globalOrigin, const ndVector& globalDest) const;
 
 	// call from sub steps update
@@ -164,11 +278,18 @@ class ndScene : public ndThreadPool
 	ndSpecialList<ndBodyKinematic> m_specialUpdateList;
 	ndThreadBackgroundWorker m_backgroundThread;
 	ndArray<ndContactPairs> m_newPairs;
-	ndArray<ndContactPairs> m_partialNewPairs[D_MAX_THREADS_COUNT];
-	ndPolygonMeshDesc::ndStaticMeshFaceQuery m_staticMeshQuery[D_MAX_THREADS_COUNT];
-	ndPolygonMeshDesc::ndProceduralStaticMeshFaceQuery m_proceduralStaticMeshQuery[D_MAX_THREADS_COUNT];
+	ndPerThreadArray<ndThreadScratch> m_threadScratch;
+	ndFrameAllocator m_frameAllocator;
+	ndArray<ndSweepAndPruneEntry> m_sweepAndPruneArray;
+	ndArray<ndSweepAndPruneBandEntry> m_sweepAndPruneBands;
+	ndArray<ndInt32> m_sweepAndPruneBandStart;
+	ndArray<ndContact*> m_sleepingContactArray;
+	ndArray<ndContactBatchEntry> m_contactBatchQueue;
+	ndArray<ndContactBatchEntry> m_contactBatchSorted;
+	ndArray<ndInt32> m_contactBatchPackets;
 
 	ndSpinLock m_lock;
+	mutable ndSpinLock m_bvhLock;
 	ndBvhNode* m_rootNode;
 	ndBodyKinematic* m_sentinelBody;
 	ndContactNotify* m_contactNotifyCallback;
@@ -178,6 +299,21 @@ class ndScene : public ndThreadPool
 	ndUnsigned32 m_frameNumber;
 	ndUnsigned32 m_subStepNumber;
 	ndUnsigned32 m_forceBalanceSceneCounter;
+	ndUnsigned32 m_bvhRebuildCount;
+	ndBroadPhaseType m_broadPhaseType;
+	ndBvhUpdateType m_bvhUpdateType;
+	ndInt32 m_sweepAndPruneAxis;
+	ndInt32 m_sweepAndPruneBandAxis;
+	ndInt32 m_sweepAndPruneBandCount;
+	ndFloat32 m_sweepAndPruneBandOrigin;
+	ndFloat32 m_sweepAndPruneBandInvSize;
+	ndInt32 m_sleepingActiveCount;
+	ndAtomic<ndInt32> m_wakeSleepingIslands;
+	ndAtomic<ndInt32> m_contactBatchCount;
+	mutable ndAtomic<ndInt32> m_bvhOutOfDate;
+	bool m_sweepAndPruneDirty;
+	bool m_islandSleep;
+	bool m_contactBatching;
 
 	static ndVector m_velocTol;
 	static ndVector m_linearContactError2;
@@ -186,6 +322,7 @@ class ndScene : public ndThreadPool
 	friend class ndWorld;
 	friend class ndBodyKinematic;
 	friend class ndRayCastNotify;
+	friend class ndContactSolver;
 	friend class ndPolygonMeshDesc;
 	friend class ndConvexCastNotify;
 	friend class ndSkeletonContainer;
@@ -221,6 +358,11 @@ inline ndArray<ndUnsigned8>& ndScene::GetScratchBuffer()
 	return m_scratchBuffer;
 }
 
+inline ndFrameAllocator& ndScene::GetFrameAllocator()
+{
+	return m_frameAllocator;
+}
+
 inline const ndBodyList& ndScene::GetParticleList() const
 {
 	return m_particleSetList;
@@ -256,6 +398,46 @@ inline const ndArray<ndBodyKinematic*>& ndScene::GetActiveBodyArray() const
 	return m_bodyList.GetView();
 }
 
+inline ndScene::ndBroadPhaseType ndScene::GetBroadPhaseType() const
+{
+	return m_broadPhaseType;
+}
+
+inline ndScene::ndBvhUpdateType ndScene::GetBvhUpdateType() const
+{
+	return m_bvhUpdateType;
+}
+
+inline ndUnsigned32 ndScene::GetBvhRebuildCount() const
+{
+	return m_bvhRebuildCount;
+}
+
+inline bool ndScene::GetIslandSleep() const
+{
+	return m_islandSleep;
+}
+
+inline ndInt32 ndScene::GetSleepingContactCount() const
+{
+	return m_sleepingContactArray.GetCount();
+}
+
+inline bool ndScene::IsThreadScratchFirstTouch() const
+{
+	return m_threadScratch.IsFirstTouch();
+}
+
+inline bool ndScene::GetContactBatching() const
+{
+	return m_contactBatching;
+}
+
+inline void ndScene::SetContactBatching(bool state)
+{
+	m_contactBatching = state;
+}
+
 inline ndFloat32 ndScene::GetTimestep() const
 {
 	return m_timestep;
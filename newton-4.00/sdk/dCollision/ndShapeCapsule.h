@@ -56,6 +56,7 @@ class ndShapeCapsule : public ndShapeConvex
 	ndFloat32 m_radius0;
 	ndFloat32 m_radius1;
 
+	friend class ndContactBatch;
 	friend class ndFileFormatShapeConvexCapsule;
 } D_GCC_NEWTON_ALIGN_32;
 
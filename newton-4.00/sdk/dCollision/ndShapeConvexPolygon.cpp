@@ -33,6 +33,7 @@
 ndShapeConvexPolygon::ndShapeConvexPolygon ()
 	:ndShapeConvex(m_polygonCollision)
 	,m_faceClipSize(0)
+	,m_separation(0)
 	,m_count(0)
 	,m_paddedCount(0)
 	,m_stride(0)
@@ -724,10 +725,12 @@ ndInt32 ndShapeConvexPolygon::CalculateContactToConvexHullDescrete(const ndShape
 	const ndShapeInstance* const hull = &contactSolver.m_instance0;
 
 	ndAssert(m_normal.m_w == ndFloat32(0.0f));
+	m_separation = ndFloat32(0.0f);
 	const ndVector obbOrigin(hullMatrix.TransformVector(contactSolver.m_instance0.GetShape()->GetObbOrigin()));
 	const ndFloat32 shapeSide = m_normal.DotProduct(obbOrigin - m_localPoly[0]).GetScalar();
 	if (shapeSide < ndFloat32(0.0f))
 	{
+		m_separation = -shapeSide;
 		return 0;
 	}
 
@@ -742,6 +745,7 @@ ndInt32 ndShapeConvexPolygon::CalculateContactToConvexHullDescrete(const ndShape
 		contactSolver.m_closestPoint0 = p0;
 		contactSolver.m_closestPoint1 = p0 + m_normal.Scale(penetration);
 		contactSolver.m_separationDistance = -penetration;
+		m_separation = -(penetration + D_PENETRATION_TOL * ndFloat32(5.0f));
 		return 0;
 	}
 
@@ -750,6 +754,7 @@ ndInt32 ndShapeConvexPolygon::CalculateContactToConvexHullDescrete(const ndShape
 	ndFloat32 distance = m_normal.DotProduct(m_localPoly[0] - p1).GetScalar();
 	if (distance >= ndFloat32(0.0f))
 	{
+		m_separation = distance;
 		return 0;
 	}
 
@@ -774,6 +779,7 @@ ndInt32 ndShapeConvexPolygon::CalculateContactToConvexHullDescrete(const ndShape
 
 		if ((centerDist + supportDist) < ndFloat32(0.0f))
 		{
+			m_separation = -(centerDist + supportDist) / ndSqrt(edgeBoundaryNormal.DotProduct(edgeBoundaryNormal).GetScalar());
 			return 0;
 		}
 
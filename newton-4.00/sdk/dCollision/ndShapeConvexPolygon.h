@@ -65,6 +65,9 @@ class ndShapeConvexPolygon: public ndShapeConvex
 	ndVector m_localPoly[D_CONVEX_POLYGON_MAX_VERTEX_COUNT];
 	ndInt32 m_clippEdgeNormal[D_CONVEX_POLYGON_MAX_VERTEX_COUNT];
 	ndFloat32 m_faceClipSize;
+	// after a discrete test without contacts, the distance the hull has to move 
+	// before it can touch the face, zero when the face was not rejected on a plane.
+	ndFloat32 m_separation;
 	ndInt32 m_count;
 	ndInt32 m_paddedCount;
 	ndInt32 m_faceId;
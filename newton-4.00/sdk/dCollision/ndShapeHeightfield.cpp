@@ -27,6 +27,15 @@
 #include "ndPolygonMeshDesc.h"
 #include "ndShapeHeightfield.h"
 
+// cells per side of the nodes of the finest level of the elevation pyramid
+#define D_HEIGHTFIELD_BLOCK_SHIFT			3
+
+// samples per side of the tiles of a dense map, the unit of the bounds updates
+#define D_HEIGHTFIELD_DENSE_TILE_SHIFT		6
+
+#define D_HEIGHTFIELD_EMPTY_ELEVATION		ndReal(1.0e10f)
+#define D_HEIGHTFIELD_RAY_PADDING			ndFloat32(1.0e-3f)
+
 ndVector ndShapeHeightfield::m_yMask(0xffffffff, 0, 0xffffffff, 0);
 ndVector ndShapeHeightfield::m_padding(ndFloat32(0.25f), ndFloat32(0.25f), ndFloat32(0.25f), ndFloat32(0.0f));
 ndVector ndShapeHeightfield::m_elevationPadding(ndFloat32(0.0f), ndFloat32(1.0e10f), ndFloat32(0.0f), ndFloat32(0.0f));
@@ -45,13 +54,21 @@ ndShapeHeightfield::ndShapeHeightfield(
 	,m_maxBox(ndVector::m_zero)
 	,m_atributeMap(width * height)
 	,m_elevationMap(width * height)
+	,m_tiles()
+	,m_pyramid()
+	,m_pyramidLevels()
+	,m_emptyTile(nullptr)
 	,m_horizontalScale_x(horizontalScale_x)
 	,m_horizontalScale_z(horizontalScale_z)
 	,m_horizontalScaleInv_x(ndFloat32(1.0f) / horizontalScale_x)
 	,m_horizontalScaleInv_z(ndFloat32(1.0f) / horizontalScale_z)
 	,m_width(width)
 	,m_height(height)
+	,m_tileShift(D_HEIGHTFIELD_DENSE_TILE_SHIFT)
+	,m_tilesCount_x((width + (1 << D_HEIGHTFIELD_DENSE_TILE_SHIFT) - 1) >> D_HEIGHTFIELD_DENSE_TILE_SHIFT)
+	,m_tilesCount_z((height + (1 << D_HEIGHTFIELD_DENSE_TILE_SHIFT) - 1) >> D_HEIGHTFIELD_DENSE_TILE_SHIFT)
 	,m_diagonalMode(constructionMode)
+	,m_tiled(false)
 {
 	ndAssert(width >= 2);
 	ndAssert(height >= 2);
@@ -61,11 +78,165 @@ ndShapeHeightfield::ndShapeHeightfield(
 	memset(&m_atributeMap[0], 0, sizeof(ndInt8) * m_atributeMap.GetCount());
 	memset(&m_elevationMap[0], 0, sizeof(ndReal) * m_elevationMap.GetCount());
 
+	UpdateElevationMapAabb();
+}
+
+ndShapeHeightfield::ndShapeHeightfield(
+	ndInt32 tilesCount_x, ndInt32 tilesCount_z, ndInt32 tileSize, ndGridConstruction constructionMode,
+	ndFloat32 horizontalScale_x, ndFloat32 horizontalScale_z)
+	:ndShapeStaticMesh(m_heightField)
+	,m_minBox(ndVector::m_zero)
+	,m_maxBox(ndVector::m_zero)
+	,m_atributeMap()
+	,m_elevationMap()
+	,m_tiles()
+	,m_pyramid()
+	,m_pyramidLevels()
+	,m_emptyTile(nullptr)
+	,m_horizontalScale_x(horizontalScale_x)
+	,m_horizontalScale_z(horizontalScale_z)
+	,m_horizontalScaleInv_x(ndFloat32(1.0f) / horizontalScale_x)
+	,m_horizontalScaleInv_z(ndFloat32(1.0f) / horizontalScale_z)
+	,m_width(0)
+	,m_height(0)
+	,m_tileShift(D_HEIGHTFIELD_BLOCK_SHIFT)
+	,m_tilesCount_x(tilesCount_x)
+	,m_tilesCount_z(tilesCount_z)
+	,m_diagonalMode(constructionMode)
+	,m_tiled(true)
+{
+	ndAssert(tilesCount_x >= 1);
+	ndAssert(tilesCount_z >= 1);
+	ndAssert(tileSize >= (1 << D_HEIGHTFIELD_BLOCK_SHIFT));
+	ndAssert((tileSize & (tileSize - 1)) == 0);
+	while ((1 << m_tileShift) < tileSize)
+	{
+		m_tileShift++;
+	}
+	m_width = tilesCount_x << m_tileShift;
+	m_height = tilesCount_z << m_tileShift;
+
+	// unloaded tiles read the elevation and attributes of a tile of zeros
+	const size_t tileSamples = size_t(1) << (2 * m_tileShift);
+	m_emptyTile = (ndReal*)ndMemory::Malloc(tileSamples * (sizeof(ndReal) + sizeof(ndInt8)));
+	memset(m_emptyTile, 0, tileSamples * (sizeof(ndReal) + sizeof(ndInt8)));
+
+	m_tiles.SetCount(tilesCount_x * tilesCount_z);
+	for (ndInt32 i = 0; i < m_tiles.GetCount(); ++i)
+	{
+		ndTile& tile = m_tiles[i];
+		tile.m_elevation = m_emptyTile;
+		tile.m_atributes = (ndInt8*)&m_emptyTile[tileSamples];
+		tile.m_stride = 1 << m_tileShift;
+		tile.m_loaded = false;
+	}
+
+	BuildPyramid();
 	CalculateLocalObb();
 }
 
 ndShapeHeightfield::~ndShapeHeightfield(void)
 {
+	ReleaseTiles();
+}
+
+void ndShapeHeightfield::ReleaseTiles()
+{
+	if (m_tiled)
+	{
+		for (ndInt32 i = 0; i < m_tiles.GetCount(); ++i)
+		{
+			if (m_tiles[i].m_loaded)
+			{
+				ndMemory::Free(m_tiles[i].m_elevation);
+			}
+		}
+		ndMemory::Free(m_emptyTile);
+		m_emptyTile = nullptr;
+	}
+	m_tiles.SetCount(0);
+}
+
+void ndShapeHeightfield::BuildTiles()
+{
+	if (!m_tiled)
+	{
+		// the tiles of a dense map are windows of the elevation and attribute arrays
+		m_tiles.SetCount(m_tilesCount_x * m_tilesCount_z);
+		for (ndInt32 z = 0; z < m_tilesCount_z; ++z)
+		{
+			for (ndInt32 x = 0; x < m_tilesCount_x; ++x)
+			{
+				ndTile& tile = m_tiles[z * m_tilesCount_x + x];
+				const ndInt32 base = (z << m_tileShift) * m_width + (x << m_tileShift);
+				tile.m_elevation = &m_elevationMap[base];
+				tile.m_atributes = &m_atributeMap[base];
+				tile.m_stride = m_width;
+				tile.m_loaded = true;
+			}
+		}
+	}
+}
+
+bool ndShapeHeightfield::IsTileLoaded(ndInt32 tile_x, ndInt32 tile_z) const
+{
+	ndAssert((tile_x >= 0) && (tile_x < m_tilesCount_x));
+	ndAssert((tile_z >= 0) && (tile_z < m_tilesCount_z));
+	return m_tiles[tile_z * m_tilesCount_x + tile_x].m_loaded;
+}
+
+void ndShapeHeightfield::LoadTile(ndInt32 tile_x, ndInt32 tile_z, const ndReal* const elevation, const ndInt8* const atributes)
+{
+	ndAssert(m_tiled);
+	ndAssert((tile_x >= 0) && (tile_x < m_tilesCount_x));
+	ndAssert((tile_z >= 0) && (tile_z < m_tilesCount_z));
+
+	const ndInt32 tileSamples = 1 << (2 * m_tileShift);
+	ndTile& tile = m_tiles[tile_z * m_tilesCount_x + tile_x];
+	if (!tile.m_loaded)
+	{
+		tile.m_elevation = (ndReal*)ndMemory::Malloc(size_t(tileSamples) * (sizeof(ndReal) + sizeof(ndInt8)));
+		tile.m_atributes = (ndInt8*)&tile.m_elevation[tileSamples];
+		tile.m_loaded = true;
+	}
+	ndMemCpy(tile.m_elevation, elevation, tileSamples);
+	if (atributes)
+	{
+		ndMemCpy(tile.m_atributes, atributes, tileSamples);
+	}
+	else
+	{
+		memset(tile.m_atributes, 0, size_t(tileSamples) * sizeof(ndInt8));
+	}
+
+	const ndInt32 tileSize = 1 << m_tileShift;
+	UpdateElevationMapAabb(tile_x << m_tileShift, tile_z << m_tileShift, (tile_x << m_tileShift) + tileSize - 1, (tile_z << m_tileShift) + tileSize - 1);
+}
+
+void ndShapeHeightfield::UnloadTile(ndInt32 tile_x, ndInt32 tile_z)
+{
+	ndAssert(m_tiled);
+	ndAssert((tile_x >= 0) && (tile_x < m_tilesCount_x));
+	ndAssert((tile_z >= 0) && (tile_z < m_tilesCount_z));
+
+	ndTile& tile = m_tiles[tile_z * m_tilesCount_x + tile_x];
+	if (tile.m_loaded)
+	{
+		ndMemory::Free(tile.m_elevation);
+		tile.m_elevation = m_emptyTile;
+		tile.m_atributes = (ndInt8*)&m_emptyTile[1 << (2 * m_tileShift)];
+		tile.m_loaded = false;
+
+		const ndInt32 tileSize = 1 << m_tileShift;
+		UpdateElevationMapAabb(tile_x << m_tileShift, tile_z << m_tileShift, (tile_x << m_tileShift) + tileSize - 1, (tile_z << m_tileShift) + tileSize - 1);
+	}
+}
+
+ndReal* ndShapeHeightfield::GetTileElevation(ndInt32 tile_x, ndInt32 tile_z) const
+{
+	ndAssert(m_tiled);
+	const ndTile& tile = m_tiles[tile_z * m_tilesCount_x + tile_x];
+	return tile.m_loaded ? tile.m_elevation : nullptr;
 }
 
 ndShapeInfo ndShapeHeightfield::GetShapeInfo() const
@@ -77,21 +248,18 @@ ndShapeInfo ndShapeHeightfield::GetShapeInfo() const
 	info.m_heightfield.m_gridsDiagonals = m_diagonalMode;
 	info.m_heightfield.m_horizonalScale_x = m_horizontalScale_x;
 	info.m_heightfield.m_horizonalScale_z = m_horizontalScale_z;
-	info.m_heightfield.m_elevation = (ndReal*)&m_elevationMap[0];
-	info.m_heightfield.m_atributes = (ndInt8*)&m_atributeMap[0];
+	info.m_heightfield.m_elevation = m_tiled ? nullptr : (ndReal*)&m_elevationMap[0];
+	info.m_heightfield.m_atributes = m_tiled ? nullptr : (ndInt8*)&m_atributeMap[0];
 
 	return info;
 }
 
 void ndShapeHeightfield::CalculateLocalObb()
 {
-	ndReal y0 = ndReal (1.0e10f);
-	ndReal y1 = -ndReal(1.0e10f);
-	for (ndInt32 i = m_elevationMap.GetCount()-1; i >= 0; --i)
-	{
-		y0 = ndMin(y0, m_elevationMap[i]);
-		y1 = ndMax(y1, m_elevationMap[i]);
-	}
+	// the root of the pyramid has the elevation range of the loaded samples
+	const ndElevationRange& range = m_pyramid[m_pyramid.GetCount() - 1];
+	const ndReal y0 = (range.m_min <= range.m_max) ? range.m_min : ndReal(0.0f);
+	const ndReal y1 = (range.m_min <= range.m_max) ? range.m_max : ndReal(0.0f);
 
 	m_minBox = ndVector(ndFloat32(0.0f), ndFloat32 (y0), ndFloat32(0.0f), ndFloat32(0.0f));
 	m_maxBox = ndVector(ndFloat32(m_width-1) * m_horizontalScale_x, ndFloat32(y1), ndFloat32(m_height-1) * m_horizontalScale_z, ndFloat32(0.0f));
@@ -102,9 +270,115 @@ void ndShapeHeightfield::CalculateLocalObb()
 
 void ndShapeHeightfield::UpdateElevationMapAabb()
 {
+	BuildTiles();
+	BuildPyramid();
+	CalculateLocalObb();
+}
+
+void ndShapeHeightfield::UpdateElevationMapAabb(ndInt32 x0, ndInt32 z0, ndInt32 x1, ndInt32 z1)
+{
+	ndAssert(x0 <= x1);
+	ndAssert(z0 <= z1);
+	UpdatePyramid(ndMax(x0, 0), ndMax(z0, 0), ndMin(x1, m_width - 1), ndMin(z1, m_height - 1));
 	CalculateLocalObb();
 }
 
+void ndShapeHeightfield::BuildPyramid()
+{
+	// the finest level has a node per block of cells, each level above
+	// has a node per two by two nodes of the level below, up to a single root.
+	ndInt32 start = 0;
+	ndInt32 width = (m_width - 1 + (1 << D_HEIGHTFIELD_BLOCK_SHIFT) - 1) >> D_HEIGHTFIELD_BLOCK_SHIFT;
+	ndInt32 height = (m_height - 1 + (1 << D_HEIGHTFIELD_BLOCK_SHIFT) - 1) >> D_HEIGHTFIELD_BLOCK_SHIFT;
+	m_pyramidLevels.SetCount(0);
+	for (bool done = false; !done; )
+	{
+		ndPyramidLevel level;
+		level.m_start = start;
+		level.m_width = width;
+		level.m_height = height;
+		m_pyramidLevels.PushBack(level);
+
+		start += width * height;
+		done = (width == 1) && (height == 1);
+		width = (width + 1) >> 1;
+		height = (height + 1) >> 1;
+	}
+	m_pyramid.SetCount(start);
+	UpdatePyramid(0, 0, m_width - 1, m_height - 1);
+}
+
+ndShapeHeightfield::ndElevationRange ndShapeHeightfield::CalculateBlockRange(ndInt32 x0, ndInt32 z0, ndInt32 x1, ndInt32 z1) const
+{
+	ndElevationRange range;
+	range.m_min = D_HEIGHTFIELD_EMPTY_ELEVATION;
+	range.m_max = -D_HEIGHTFIELD_EMPTY_ELEVATION;
+	for (ndInt32 z = z0; z <= z1; ++z)
+	{
+		for (ndInt32 x = x0; x <= x1; ++x)
+		{
+			if (!m_tiled || IsSampleLoaded(x, z))
+			{
+				const ndReal elevation = GetElevation(x, z);
+				range.m_min = ndMin(range.m_min, elevation);
+				range.m_max = ndMax(range.m_max, elevation);
+			}
+		}
+	}
+	return range;
+}
+
+void ndShapeHeightfield::UpdatePyramid(ndInt32 x0, ndInt32 z0, ndInt32 x1, ndInt32 z1)
+{
+	// the blocks with a cell that uses one of the samples
+	ndInt32 bx0 = ndMax(x0 - 1, 0) >> D_HEIGHTFIELD_BLOCK_SHIFT;
+	ndInt32 bz0 = ndMax(z0 - 1, 0) >> D_HEIGHTFIELD_BLOCK_SHIFT;
+	ndInt32 bx1 = ndMin(x1, m_width - 2) >> D_HEIGHTFIELD_BLOCK_SHIFT;
+	ndInt32 bz1 = ndMin(z1, m_height - 2) >> D_HEIGHTFIELD_BLOCK_SHIFT;
+
+	const ndPyramidLevel& blocks = m_pyramidLevels[0];
+	for (ndInt32 z = bz0; z <= bz1; ++z)
+	{
+		const ndInt32 sz0 = z << D_HEIGHTFIELD_BLOCK_SHIFT;
+		const ndInt32 sz1 = ndMin((z + 1) << D_HEIGHTFIELD_BLOCK_SHIFT, m_height - 1);
+		for (ndInt32 x = bx0; x <= bx1; ++x)
+		{
+			const ndInt32 sx0 = x << D_HEIGHTFIELD_BLOCK_SHIFT;
+			const ndInt32 sx1 = ndMin((x + 1) << D_HEIGHTFIELD_BLOCK_SHIFT, m_width - 1);
+			m_pyramid[blocks.m_start + z * blocks.m_width + x] = CalculateBlockRange(sx0, sz0, sx1, sz1);
+		}
+	}
+
+	for (ndInt32 i = 1; i < m_pyramidLevels.GetCount(); ++i)
+	{
+		bx0 >>= 1;
+		bz0 >>= 1;
+		bx1 >>= 1;
+		bz1 >>= 1;
+		const ndPyramidLevel& level = m_pyramidLevels[i];
+		const ndPyramidLevel& children = m_pyramidLevels[i - 1];
+		for (ndInt32 z = bz0; z <= bz1; ++z)
+		{
+			for (ndInt32 x = bx0; x <= bx1; ++x)
+			{
+				ndElevationRange range;
+				range.m_min = D_HEIGHTFIELD_EMPTY_ELEVATION;
+				range.m_max = -D_HEIGHTFIELD_EMPTY_ELEVATION;
+				for (ndInt32 cz = z * 2; cz < ndMin(z * 2 + 2, children.m_height); ++cz)
+				{
+					for (ndInt32 cx = x * 2; cx < ndMin(x * 2 + 2, children.m_width); ++cx)
+					{
+						const ndElevationRange& child = m_pyramid[children.m_start + cz * children.m_width + cx];
+						range.m_min = ndMin(range.m_min, child.m_min);
+						range.m_max = ndMax(range.m_max, child.m_max);
+					}
+				}
+				m_pyramid[level.m_start + z * level.m_width + x] = range;
+			}
+		}
+	}
+}
+
 const ndInt32* ndShapeHeightfield::GetIndexList() const
 {
 	return &m_cellIndices[(m_diagonalMode == m_normalDiagonals) ? 0 : 1][0];
@@ -124,20 +398,21 @@ void ndShapeHeightfield::DebugShape(const ndMatrix& matrix, ndShapeDebugNotify&
 	const ndInt32 i2 = indirectIndex[2];
 	const ndInt32 i3 = indirectIndex[3];
 
-	ndInt32 base = 0;
 	for (ndInt32 z = 0; z < m_height - 1; ++z)
 	{
-		const ndVector p0 ((ndFloat32)(0 + 0) * m_horizontalScale_x, ndFloat32(m_elevationMap[base + 0]),               (ndFloat32)(z + 0) * m_horizontalScale_z, ndFloat32(0.0f));
-		const ndVector p1 ((ndFloat32)(0 + 0) * m_horizontalScale_x, ndFloat32(m_elevationMap[base + 0 + m_width + 0]), (ndFloat32)(z + 1) * m_horizontalScale_z, ndFloat32(0.0f));
-
-		points[0 * 2 + 0] = matrix.TransformVector(p0);
-		points[1 * 2 + 0] = matrix.TransformVector(p1);
-
 		for (ndInt32 x = 0; x < m_width - 1; ++x) 
 		{
-			const ndVector p2 ((ndFloat32)(x + 1) * m_horizontalScale_x, ndFloat32(m_elevationMap[base + x + 1]),			(ndFloat32)(z + 0) * m_horizontalScale_z, ndFloat32(0.0f));
-			const ndVector p3 ((ndFloat32)(x + 1) * m_horizontalScale_x, ndFloat32(m_elevationMap[base + x + m_width + 1]), (ndFloat32)(z + 1) * m_horizontalScale_z, ndFloat32(0.0f));
+			if (!IsCellLoaded(x, z))
+			{
+				continue;
+			}
+			const ndVector p0 ((ndFloat32)(x + 0) * m_horizontalScale_x, ndFloat32(GetElevation(x + 0, z + 0)), (ndFloat32)(z + 0) * m_horizontalScale_z, ndFloat32(0.0f));
+			const ndVector p1 ((ndFloat32)(x + 0) * m_horizontalScale_x, ndFloat32(GetElevation(x + 0, z + 1)), (ndFloat32)(z + 1) * m_horizontalScale_z, ndFloat32(0.0f));
+			const ndVector p2 ((ndFloat32)(x + 1) * m_horizontalScale_x, ndFloat32(GetElevation(x + 1, z + 0)), (ndFloat32)(z + 0) * m_horizontalScale_z, ndFloat32(0.0f));
+			const ndVector p3 ((ndFloat32)(x + 1) * m_horizontalScale_x, ndFloat32(GetElevation(x + 1, z + 1)), (ndFloat32)(z + 1) * m_horizontalScale_z, ndFloat32(0.0f));
 
+			points[0 * 2 + 0] = matrix.TransformVector(p0);
+			points[1 * 2 + 0] = matrix.TransformVector(p1);
 			points[0 * 2 + 1] = matrix.TransformVector(p2);
 			points[1 * 2 + 1] = matrix.TransformVector(p3);
 
@@ -150,11 +425,7 @@ void ndShapeHeightfield::DebugShape(const ndMatrix& matrix, ndShapeDebugNotify&
 			triangle[1] = points[i2];
 			triangle[2] = points[i3];
 			debugCallback.DrawPolygon(3, triangle, edgeType);
-
-			points[0 * 2 + 0] = points[0 * 2 + 1];
-			points[1 * 2 + 0] = points[1 * 2 + 1];
 		}
-		base += m_width;
 	}
 }
 
@@ -224,6 +495,12 @@ void ndShapeHeightfield::GetLocalAabb(const ndVector& q0, const ndVector& q1, nd
 	ndFloat32 minHeight = ndFloat32(1.0e10f);
 	ndFloat32 maxHeight = ndFloat32(-1.0e10f);
 	CalculateMinAndMaxElevation(x0, x1, z0, z1, minHeight, maxHeight);
+	if (minHeight > maxHeight)
+	{
+		// the box is over unloaded tiles
+		minHeight = m_minBox.m_y;
+		maxHeight = m_minBox.m_y;
+	}
 	boxP0.m_y = minHeight;
 	boxP1.m_y = maxHeight;
 	ndAssert(boxP0.m_x <= boxP1.m_x);
@@ -237,19 +514,17 @@ ndFloat32 ndShapeHeightfield::RayCastCell(const ndFastRay& ray, ndInt32 xIndex0,
 	ndInt32 triangle[3];
 
 	// get the 3d point at the corner of the cell
-	if ((xIndex0 < 0) || (zIndex0 < 0) || (xIndex0 >= (m_width - 1)) || (zIndex0 >= (m_height - 1))) 
+	if ((xIndex0 < 0) || (zIndex0 < 0) || (xIndex0 >= (m_width - 1)) || (zIndex0 >= (m_height - 1)) || !IsCellLoaded(xIndex0, zIndex0)) 
 	{
 		return ndFloat32(1.2f);
 	}
 
 	ndAssert(maxT <= 1.0);
 
-	ndInt32 base = zIndex0 * m_width + xIndex0;
-
-	points[0 * 2 + 0] = ndVector((ndFloat32)(xIndex0 + 0) * m_horizontalScale_x, ndFloat32 (m_elevationMap[base + 0]),			 (ndFloat32)(zIndex0 + 0) * m_horizontalScale_z, ndFloat32(0.0f));
-	points[0 * 2 + 1] = ndVector((ndFloat32)(xIndex0 + 1) * m_horizontalScale_x, ndFloat32 (m_elevationMap[base + 1]),			 (ndFloat32)(zIndex0 + 0) * m_horizontalScale_z, ndFloat32(0.0f));
-	points[1 * 2 + 1] = ndVector((ndFloat32)(xIndex0 + 1) * m_horizontalScale_x, ndFloat32 (m_elevationMap[base + m_width + 1]), (ndFloat32)(zIndex0 + 1) * m_horizontalScale_z, ndFloat32(0.0f));
-	points[1 * 2 + 0] = ndVector((ndFloat32)(xIndex0 + 0) * m_horizontalScale_x, ndFloat32 (m_elevationMap[base + m_width + 0]), (ndFloat32)(zIndex0 + 1) * m_horizontalScale_z, ndFloat32(0.0f));
+	points[0 * 2 + 0] = ndVector((ndFloat32)(xIndex0 + 0) * m_horizontalScale_x, ndFloat32 (GetElevation(xIndex0 + 0, zIndex0 + 0)), (ndFloat32)(zIndex0 + 0) * m_horizontalScale_z, ndFloat32(0.0f));
+	points[0 * 2 + 1] = ndVector((ndFloat32)(xIndex0 + 1) * m_horizontalScale_x, ndFloat32 (GetElevation(xIndex0 + 1, zIndex0 + 0)), (ndFloat32)(zIndex0 + 0) * m_horizontalScale_z, ndFloat32(0.0f));
+	points[1 * 2 + 1] = ndVector((ndFloat32)(xIndex0 + 1) * m_horizontalScale_x, ndFloat32 (GetElevation(xIndex0 + 1, zIndex0 + 1)), (ndFloat32)(zIndex0 + 1) * m_horizontalScale_z, ndFloat32(0.0f));
+	points[1 * 2 + 0] = ndVector((ndFloat32)(xIndex0 + 0) * m_horizontalScale_x, ndFloat32 (GetElevation(xIndex0 + 0, zIndex0 + 1)), (ndFloat32)(zIndex0 + 1) * m_horizontalScale_z, ndFloat32(0.0f));
 
 	ndFloat32 t = ndFloat32(1.2f);
 	if (m_diagonalMode == m_normalDiagonals)
@@ -317,6 +592,69 @@ ndFloat32 ndShapeHeightfield::RayCastCell(const ndFastRay& ray, ndInt32 xIndex0,
 	return t;
 }
 
+ndFloat32 ndShapeHeightfield::RayCastBlock(const ndFastRay& ray, ndInt32 x0, ndInt32 z0, ndInt32 x1, ndInt32 z1, ndInt32& xIndexOut, ndInt32& zIndexOut, ndVector& normalOut, ndFloat32 maxT) const
+{
+	// the part of the segment over the cells from x0, z0 to x1, z1 inclusive 
+	ndFloat32 t0 = ndFloat32(0.0f);
+	ndFloat32 t1 = ndFloat32(1.0f);
+	const ndVector blockP0(ndFloat32(x0) * m_horizontalScale_x, ndFloat32(0.0f), ndFloat32(z0) * m_horizontalScale_z, ndFloat32(0.0f));
+	const ndVector blockP1(ndFloat32(x1 + 1) * m_horizontalScale_x, ndFloat32(0.0f), ndFloat32(z1 + 1) * m_horizontalScale_z, ndFloat32(0.0f));
+	for (ndInt32 i = 0; i < 3; i += 2)
+	{
+		if (ndAbs(ray.m_diff[i]) > ndFloat32(1.0e-8f))
+		{
+			const ndFloat32 ta = (blockP0[i] - ray.m_p0[i]) / ray.m_diff[i];
+			const ndFloat32 tb = (blockP1[i] - ray.m_p0[i]) / ray.m_diff[i];
+			t0 = ndMax(t0, ndMin(ta, tb));
+			t1 = ndMin(t1, ndMax(ta, tb));
+		}
+	}
+	t1 = ndMin(t1, maxT);
+	if (t0 > t1)
+	{
+		return ndFloat32(1.2f);
+	}
+
+	const ndVector q0(ray.m_p0 + ray.m_diff.Scale(t0));
+	const ndVector q1(ray.m_p0 + ray.m_diff.Scale(t1));
+	const ndInt32 cx0 = ndMax(FastInt(ndMin(q0.m_x, q1.m_x) * m_horizontalScaleInv_x), x0);
+	const ndInt32 cz0 = ndMax(FastInt(ndMin(q0.m_z, q1.m_z) * m_horizontalScaleInv_z), z0);
+	const ndInt32 cx1 = ndMin(FastInt(ndMax(q0.m_x, q1.m_x) * m_horizontalScaleInv_x), x1);
+	const ndInt32 cz1 = ndMin(FastInt(ndMax(q0.m_z, q1.m_z) * m_horizontalScaleInv_z), z1);
+
+	ndFloat32 closestT = maxT;
+	const ndVector padding(D_HEIGHTFIELD_RAY_PADDING, D_HEIGHTFIELD_RAY_PADDING, D_HEIGHTFIELD_RAY_PADDING, ndFloat32(0.0f));
+	for (ndInt32 z = cz0; z <= cz1; ++z)
+	{
+		for (ndInt32 x = cx0; x <= cx1; ++x)
+		{
+			if (!IsCellLoaded(x, z))
+			{
+				continue;
+			}
+			const ndReal y00 = GetElevation(x + 0, z + 0);
+			const ndReal y01 = GetElevation(x + 1, z + 0);
+			const ndReal y10 = GetElevation(x + 0, z + 1);
+			const ndReal y11 = GetElevation(x + 1, z + 1);
+			const ndVector cellP0(ndFloat32(x + 0) * m_horizontalScale_x, ndFloat32(ndMin(ndMin(y00, y01), ndMin(y10, y11))), ndFloat32(z + 0) * m_horizontalScale_z, ndFloat32(0.0f));
+			const ndVector cellP1(ndFloat32(x + 1) * m_horizontalScale_x, ndFloat32(ndMax(ndMax(y00, y01), ndMax(y10, y11))), ndFloat32(z + 1) * m_horizontalScale_z, ndFloat32(0.0f));
+			if (ray.BoxIntersect(cellP0 - padding, cellP1 + padding) < closestT)
+			{
+				ndVector normal;
+				const ndFloat32 t = RayCastCell(ray, x, z, normal, closestT);
+				if (t < closestT)
+				{
+					closestT = t;
+					xIndexOut = x;
+					zIndexOut = z;
+					normalOut = normal;
+				}
+			}
+		}
+	}
+	return closestT;
+}
+
 ndFloat32 ndShapeHeightfield::RayCast(ndRayCastNotify&, const ndVector& localP0, const ndVector& localP1, ndFloat32 maxT, const ndBody* const, ndContactPoint& contactOut) const
 {
 	ndVector boxP0;
@@ -329,122 +667,176 @@ ndFloat32 ndShapeHeightfield::RayCast(ndRayCastNotify&, const ndVector& localP0,
 	ndVector p1(localP1);
 	
 	// clip the line against the bounding box
-	if (ndRayBoxClip(p0, p1, boxP0, boxP1)) 
+	if (!ndRayBoxClip(p0, p1, boxP0, boxP1)) 
 	{
-		ndVector dp(p1 - p0);
-		ndVector normalOut(ndVector::m_zero);
-	
-		ndFloat32 scale_x = m_horizontalScale_x;
-		ndFloat32 invScale_x = m_horizontalScaleInv_x;
-		ndFloat32 scale_z = m_horizontalScale_z;
-		ndFloat32 invScale_z = m_horizontalScaleInv_z;
-		ndInt32 ix0 = FastInt(p0.m_x * invScale_x);
-		ndInt32 iz0 = FastInt(p0.m_z * invScale_z);
-	
-		// implement a 3ddda line algorithm 
-		ndInt32 xInc;
-		ndFloat32 tx;
-		ndFloat32 stepX;
-		if (dp.m_x > ndFloat32(0.0f)) 
-		{
-			xInc = 1;
-			ndFloat32 val = ndFloat32(1.0f) / dp.m_x;
-			stepX = scale_x * val;
-			tx = (scale_x * ((ndFloat32)ix0 + ndFloat32(1.0f)) - p0.m_x) * val;
-		}
-		else if (dp.m_x < ndFloat32(0.0f)) 
+		return ndFloat32(1.2f);
+	}
+
+	// visit the nodes of the elevation pyramid front to back, skipping 
+	// the nodes that the ray misses or enters after the closest hit.
+	class ndStackEntry
+	{
+		public:
+		ndFloat32 m_t;
+		ndInt32 m_level;
+		ndInt32 m_x;
+		ndInt32 m_z;
+	};
+
+	const ndFastRay ray(localP0, localP1);
+	const ndVector padding(D_HEIGHTFIELD_RAY_PADDING, D_HEIGHTFIELD_RAY_PADDING, D_HEIGHTFIELD_RAY_PADDING, ndFloat32(0.0f));
+	auto NodeIntersect = [this, &ray, &padding](ndInt32 level, ndInt32 x, ndInt32 z)
+	{
+		const ndPyramidLevel& pyramidLevel = m_pyramidLevels[level];
+		const ndElevationRange& range = m_pyramid[pyramidLevel.m_start + z * pyramidLevel.m_width + x];
+		if (range.m_min > range.m_max)
 		{
-			xInc = -1;
-			ndFloat32 val = -ndFloat32(1.0f) / dp.m_x;
-			stepX = scale_x * val;
-			tx = -(scale_x * (ndFloat32)ix0 - p0.m_x) * val;
+			return ndFloat32(1.2f);
 		}
-		else 
+		const ndInt32 shift = D_HEIGHTFIELD_BLOCK_SHIFT + level;
+		const ndInt32 x1 = ndMin((x + 1) << shift, m_width - 1);
+		const ndInt32 z1 = ndMin((z + 1) << shift, m_height - 1);
+		const ndVector nodeP0(ndFloat32(x << shift) * m_horizontalScale_x, ndFloat32(range.m_min), ndFloat32(z << shift) * m_horizontalScale_z, ndFloat32(0.0f));
+		const ndVector nodeP1(ndFloat32(x1) * m_horizontalScale_x, ndFloat32(range.m_max), ndFloat32(z1) * m_horizontalScale_z, ndFloat32(0.0f));
+		return ray.BoxIntersect(nodeP0 - padding, nodeP1 + padding);
+	};
+
+	ndInt32 xIndex = 0;
+	ndInt32 zIndex = 0;
+	ndFloat32 closestT = maxT;
+	ndVector normalOut(ndVector::m_zero);
+
+	ndInt32 stack = 1;
+	ndStackEntry stackPool[4 * 32];
+	stackPool[0].m_level = m_pyramidLevels.GetCount() - 1;
+	stackPool[0].m_x = 0;
+	stackPool[0].m_z = 0;
+	stackPool[0].m_t = NodeIntersect(stackPool[0].m_level, 0, 0);
+	while (stack)
+	{
+		stack--;
+		const ndStackEntry entry(stackPool[stack]);
+		if (entry.m_t >= closestT)
 		{
-			xInc = 0;
-			stepX = ndFloat32(0.0f);
-			tx = ndFloat32(1.0e10f);
+			continue;
 		}
-	
-		ndInt32 zInc;
-		ndFloat32 tz;
-		ndFloat32 stepZ;
-		if (dp.m_z > ndFloat32(0.0f)) 
+
+		if (entry.m_level == 0)
 		{
-			zInc = 1;
-			ndFloat32 val = ndFloat32(1.0f) / dp.m_z;
-			stepZ = scale_z * val;
-			tz = (scale_z * ((ndFloat32)iz0 + ndFloat32(1.0f)) - p0.m_z) * val;
+			const ndInt32 x0 = entry.m_x << D_HEIGHTFIELD_BLOCK_SHIFT;
+			const ndInt32 z0 = entry.m_z << D_HEIGHTFIELD_BLOCK_SHIFT;
+			const ndInt32 x1 = ndMin(x0 + (1 << D_HEIGHTFIELD_BLOCK_SHIFT), m_width - 1) - 1;
+			const ndInt32 z1 = ndMin(z0 + (1 << D_HEIGHTFIELD_BLOCK_SHIFT), m_height - 1) - 1;
+			closestT = ndMin(closestT, RayCastBlock(ray, x0, z0, x1, z1, xIndex, zIndex, normalOut, closestT));
+			continue;
 		}
-		else if (dp.m_z < ndFloat32(0.0f)) 
+
+		ndInt32 count = 0;
+		ndStackEntry children[4];
+		const ndPyramidLevel& level = m_pyramidLevels[entry.m_level - 1];
+		for (ndInt32 z = entry.m_z * 2; z < ndMin(entry.m_z * 2 + 2, level.m_height); ++z)
 		{
-			zInc = -1;
-			ndFloat32 val = -ndFloat32(1.0f) / dp.m_z;
-			stepZ = scale_z * val;
-			tz = -(scale_z * (ndFloat32)iz0 - p0.m_z) * val;
+			for (ndInt32 x = entry.m_x * 2; x < ndMin(entry.m_x * 2 + 2, level.m_width); ++x)
+			{
+				const ndFloat32 t = NodeIntersect(entry.m_level - 1, x, z);
+				if (t < closestT)
+				{
+					// insertion sort, farthest first
+					ndInt32 j = count;
+					for (; j && (children[j - 1].m_t < t); --j)
+					{
+						children[j] = children[j - 1];
+					}
+					children[j].m_t = t;
+					children[j].m_level = entry.m_level - 1;
+					children[j].m_x = x;
+					children[j].m_z = z;
+					count++;
+				}
+			}
 		}
-		else 
+		for (ndInt32 i = 0; i < count; ++i)
 		{
-			zInc = 0;
-			stepZ = ndFloat32(0.0f);
-			tz = ndFloat32(1.0e10f);
+			ndAssert(stack < ndInt32(sizeof(stackPool) / sizeof(stackPool[0])));
+			stackPool[stack] = children[i];
+			stack++;
 		}
-	
-		ndFloat32 txAcc = tx;
-		ndFloat32 tzAcc = tz;
-		ndInt32 xIndex0 = ix0;
-		ndInt32 zIndex0 = iz0;
-		ndFastRay ray(localP0, localP1);
-	
-		// for each cell touched by the line
-		do 
-		{
-			ndFloat32 t = RayCastCell(ray, xIndex0, zIndex0, normalOut, maxT);
-			if (t < maxT) 
-			{
-				// bail out at the first intersection and copy the data into the descriptor
-				ndAssert(normalOut.m_w == ndFloat32(0.0f));
-				contactOut.m_normal = normalOut.Normalize();
-				contactOut.m_shapeId0 = m_atributeMap[zIndex0 * m_width + xIndex0];
-				contactOut.m_shapeId1 = m_atributeMap[zIndex0 * m_width + xIndex0];
-	
-				return t;
-			}
-	
-			if (txAcc < tzAcc) 
-			{
-				xIndex0 += xInc;
-				tx = txAcc;
-				txAcc += stepX;
-			}
-			else 
-			{
-				zIndex0 += zInc;
-				tz = tzAcc;
-				tzAcc += stepZ;
-			}
-		} while ((tx <= ndFloat32(1.0f)) || (tz <= ndFloat32(1.0f)));
 	}
-	
+
+	if (closestT < maxT)
+	{
+		ndAssert(normalOut.m_w == ndFloat32(0.0f));
+		contactOut.m_normal = normalOut.Normalize();
+		contactOut.m_shapeId0 = GetAtribute(xIndex, zIndex);
+		contactOut.m_shapeId1 = GetAtribute(xIndex, zIndex);
+		return closestT;
+	}
+
 	// if no cell was hit, return a large value
 	return ndFloat32(1.2f);
 }
 
 void ndShapeHeightfield::CalculateMinAndMaxElevation(ndInt32 x0, ndInt32 x1, ndInt32 z0, ndInt32 z1, ndFloat32& minHeight, ndFloat32& maxHeight) const
 {
-	ndReal minVal = ndReal(1.0e10f);
-	ndReal maxVal = -ndReal(1.0e10f);
-
-	ndInt32 base = z0 * m_width;
-	for (ndInt32 z = z0; z <= z1; ++z) 
+	// the nodes of the pyramid inside the range contribute their range,
+	// only the blocks that straddle the border of the range read samples.
+	ndReal minVal = D_HEIGHTFIELD_EMPTY_ELEVATION;
+	ndReal maxVal = -D_HEIGHTFIELD_EMPTY_ELEVATION;
+
+	ndInt32 stack = 1;
+	ndInt32 stackPool[3 * 4 * 32];
+	stackPool[0] = m_pyramidLevels.GetCount() - 1;
+	stackPool[1] = 0;
+	stackPool[2] = 0;
+	while (stack)
 	{
-		for (ndInt32 x = x0; x <= x1; ++x) 
+		stack--;
+		const ndInt32 levelIndex = stackPool[stack * 3 + 0];
+		const ndInt32 x = stackPool[stack * 3 + 1];
+		const ndInt32 z = stackPool[stack * 3 + 2];
+		const ndPyramidLevel& level = m_pyramidLevels[levelIndex];
+		const ndElevationRange& range = m_pyramid[level.m_start + z * level.m_width + x];
+		if ((range.m_min >= minVal) && (range.m_max <= maxVal))
+		{
+			continue;
+		}
+
+		const ndInt32 shift = D_HEIGHTFIELD_BLOCK_SHIFT + levelIndex;
+		const ndInt32 nx0 = x << shift;
+		const ndInt32 nz0 = z << shift;
+		const ndInt32 nx1 = ndMin((x + 1) << shift, m_width - 1);
+		const ndInt32 nz1 = ndMin((z + 1) << shift, m_height - 1);
+		if ((nx1 < x0) || (nx0 > x1) || (nz1 < z0) || (nz0 > z1))
+		{
+			continue;
+		}
+
+		if ((nx0 >= x0) && (nx1 <= x1) && (nz0 >= z0) && (nz1 <= z1))
+		{
+			minVal = ndMin(minVal, range.m_min);
+			maxVal = ndMax(maxVal, range.m_max);
+		}
+		else if (levelIndex == 0)
 		{
-			ndReal high = m_elevationMap[base + x];
-			minVal = ndMin(high, minVal);
-			maxVal = ndMax(high, maxVal);
+			const ndElevationRange blockRange(CalculateBlockRange(ndMax(nx0, x0), ndMax(nz0, z0), ndMin(nx1, x1), ndMin(nz1, z1)));
+			minVal = ndMin(minVal, blockRange.m_min);
+			maxVal = ndMax(maxVal, blockRange.m_max);
+		}
+		else
+		{
+			const ndPyramidLevel& children = m_pyramidLevels[levelIndex - 1];
+			for (ndInt32 cz = z * 2; cz < ndMin(z * 2 + 2, children.m_height); ++cz)
+			{
+				for (ndInt32 cx = x * 2; cx < ndMin(x * 2 + 2, children.m_width); ++cx)
+				{
+					ndAssert(stack < ndInt32(sizeof(stackPool) / (3 * sizeof(stackPool[0]))));
+					stackPool[stack * 3 + 0] = levelIndex - 1;
+					stackPool[stack * 3 + 1] = cx;
+					stackPool[stack * 3 + 2] = cz;
+					stack++;
+				}
+			}
 		}
-		base += m_width;
 	}
 
 	minHeight = minVal;
@@ -498,17 +890,15 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 		vertex.SetCount(vertexCount);
 
 		ndInt32 vertexIndex = 0;
-		ndInt32 base = z0 * m_width;
 		for (ndInt32 z = z0; z <= z1; ++z) 
 		{
 			ndFloat32 zVal = m_horizontalScale_z * (ndFloat32)z;
 			for (ndInt32 x = x0; x <= x1; ++x) 
 			{
-				vertex[vertexIndex] = ndVector(m_horizontalScale_x * (ndFloat32)x, ndFloat32(m_elevationMap[base + x]), zVal, ndFloat32(0.0f));
+				vertex[vertexIndex] = ndVector(m_horizontalScale_x * (ndFloat32)x, ndFloat32(GetElevation(x, z)), zVal, ndFloat32(0.0f));
 				vertexIndex++;
 				ndAssert(vertexIndex <= vertex.GetCount());
 			}
-			base += m_width;
 		}
 
 		ndInt32 normalBase = vertexIndex;
@@ -528,7 +918,6 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 			ndGridQuad* const quadArray = (ndGridQuad*)&quadDataArray[0];
 			for (ndInt32 z = z0; z < z1; ++z)
 			{
-				ndInt32 zStep = z * m_width;
 				for (ndInt32 x = x0; x < x1; ++x)
 				{
 					ndInt32 vIndex[4];
@@ -561,6 +950,13 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 					n1 = n1.Normalize();
 					vertex[normalIndex0] = n0;
 					vertex[normalIndex1] = n1;
+					if (!IsCellLoaded(x, z))
+					{
+						// the faces of cells in unloaded tiles are removed below, 
+						// their normals are tagged so that no neighbor shares an edge with them.
+						vertex[normalIndex0].m_w = ndFloat32(1.0f);
+						vertex[normalIndex1].m_w = ndFloat32(1.0f);
+					}
 
 					ndGridQuad& quad = quadArray[quadCount];
 
@@ -568,7 +964,7 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 					quad.m_triangle0.m_i0 = i2;
 					quad.m_triangle0.m_i1 = i1;
 					quad.m_triangle0.m_i2 = i0;
-					quad.m_triangle0.m_material = m_atributeMap[zStep + x];
+					quad.m_triangle0.m_material = GetAtribute(x, z);
 					quad.m_triangle0.m_normal = normalIndex0;
 					quad.m_triangle0.m_normal_edge01 = normalIndex0;
 					quad.m_triangle0.m_normal_edge12 = normalIndex0;
@@ -579,7 +975,7 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 					quad.m_triangle1.m_i0 = i1;
 					quad.m_triangle1.m_i1 = i2;
 					quad.m_triangle1.m_i2 = i3;
-					quad.m_triangle1.m_material = m_atributeMap[zStep + x];
+					quad.m_triangle1.m_material = GetAtribute(x, z);
 					quad.m_triangle1.m_normal = normalIndex1;
 					quad.m_triangle1.m_normal_edge01 = normalIndex1;
 					quad.m_triangle1.m_normal_edge12 = normalIndex1;
@@ -615,6 +1011,10 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 
 						ndTriangle& triangle0 = quad0.m_triangle0;
 						ndTriangle& triangle1 = quad1.m_triangle1;
+						if ((vertex[triangle0.m_normal].m_w != ndFloat32(0.0f)) || (vertex[triangle1.m_normal].m_w != ndFloat32(0.0f)))
+						{
+							continue;
+						}
 
 						const ndVector& origin = vertex[triangle1.m_i1];
 						const ndVector& testPoint = vertex[triangle1.m_i0];
@@ -643,6 +1043,10 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 
 						ndTriangle& triangle0 = quad0.m_triangle1;
 						ndTriangle& triangle1 = quad1.m_triangle0;
+						if ((vertex[triangle0.m_normal].m_w != ndFloat32(0.0f)) || (vertex[triangle1.m_normal].m_w != ndFloat32(0.0f)))
+						{
+							continue;
+						}
 
 						const ndVector& origin = vertex[triangle1.m_i0];
 						const ndVector& testPoint = vertex[triangle1.m_i1];
@@ -673,6 +1077,10 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 
 						ndTriangle& triangle0 = quad0.m_triangle1;
 						ndTriangle& triangle1 = quad1.m_triangle0;
+						if ((vertex[triangle0.m_normal].m_w != ndFloat32(0.0f)) || (vertex[triangle1.m_normal].m_w != ndFloat32(0.0f)))
+						{
+							continue;
+						}
 
 						const ndVector& origin = vertex[triangle1.m_i0];
 						const ndVector& testPoint = vertex[triangle1.m_i1];
@@ -701,6 +1109,10 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 
 						ndTriangle& triangle0 = quad0.m_triangle1;
 						ndTriangle& triangle1 = quad1.m_triangle0;
+						if ((vertex[triangle0.m_normal].m_w != ndFloat32(0.0f)) || (vertex[triangle1.m_normal].m_w != ndFloat32(0.0f)))
+						{
+							continue;
+						}
 
 						const ndVector& origin = vertex[triangle1.m_i1];
 						const ndVector& testPoint = vertex[triangle1.m_i0];
@@ -736,7 +1148,7 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 			{
 				const ndInt32* const indexArray = &indices[faceIndexCount1];
 				const ndVector& faceNormal = vertex[indexArray[4]];
-				ndFloat32 dist = data->PolygonBoxRayDistance(faceNormal, 3, indexArray, stride, &vertex[0].m_x, ray);
+				ndFloat32 dist = (faceNormal.m_w == ndFloat32(0.0f)) ? data->PolygonBoxRayDistance(faceNormal, 3, indexArray, stride, &vertex[0].m_x, ray) : ndFloat32(1.2f);
 				if (dist < ndFloat32(1.0f)) 
 				{
 					hitDistance.PushBack(dist);
@@ -755,7 +1167,7 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 			{
 				const ndInt32* const indexArray = &indices[faceIndexCount1];
 				const ndVector& faceNormal = vertex[indexArray[4]];
-				ndFloat32 dist = data->PolygonBoxDistance(faceNormal, 3, indexArray, stride, &vertex[0].m_x);
+				ndFloat32 dist = (faceNormal.m_w == ndFloat32(0.0f)) ? data->PolygonBoxDistance(faceNormal, 3, indexArray, stride, &vertex[0].m_x) : ndFloat32(0.0f);
 				if (dist > ndFloat32(0.0f)) 
 				{
 					hitDistance.PushBack(dist);
@@ -776,6 +1188,21 @@ void ndShapeHeightfield::GetCollidingFaces(ndPolygonMeshDesc* const data) const
 
 ndUnsigned64 ndShapeHeightfield::GetHash(ndUnsigned64 hash) const
 {
+	if (m_tiled)
+	{
+		const ndInt32 tileSamples = 1 << (2 * m_tileShift);
+		for (ndInt32 i = 0; i < m_tiles.GetCount(); ++i)
+		{
+			const ndTile& tile = m_tiles[i];
+			if (tile.m_loaded)
+			{
+				hash = ndCRC64(&i, ndInt32(sizeof(ndInt32)), hash);
+				hash = ndCRC64(tile.m_atributes, tileSamples * ndInt32(sizeof(ndInt8)), hash);
+				hash = ndCRC64(tile.m_elevation, tileSamples * ndInt32(sizeof(ndReal)), hash);
+			}
+		}
+		return hash;
+	}
 	hash = ndCRC64(&m_atributeMap[0], m_atributeMap.GetCount() * ndInt32(sizeof(ndInt8)), hash);
 	hash = ndCRC64(&m_elevationMap[0], m_elevationMap.GetCount() * ndInt32(sizeof(ndReal)), hash);
 	return hash;
@@ -57,14 +57,47 @@ class ndShapeHeightfield: public ndShapeStaticMesh
 
 	D_CLASS_REFLECTION(ndShapeHeightfield,ndShapeStaticMesh)
 	D_COLLISION_API ndShapeHeightfield(ndInt32 width, ndInt32 height, ndGridConstruction constructionMode,ndFloat32 horizontalScale_x, ndFloat32 horizontalScale_z);
+
+	/// a heightfield made of tilesCount_x by tilesCount_z square tiles of tileSize by tileSize 
+	/// elevation samples, tileSize is a power of two not smaller than eight.
+	/// tiles are loaded and unloaded at runtime, the map starts with all tiles unloaded.
+	/// a cell collides when the tiles of its four corners are loaded, the cells of
+	/// unloaded tiles are holes.
+	D_COLLISION_API ndShapeHeightfield(ndInt32 tilesCount_x, ndInt32 tilesCount_z, ndInt32 tileSize, ndGridConstruction constructionMode, ndFloat32 horizontalScale_x, ndFloat32 horizontalScale_z);
 	D_COLLISION_API virtual ~ndShapeHeightfield();
 
+	/// the dense elevation map of a heightfield that is not made of tiles.
 	ndArray<ndReal>& GetElevationMap();
 	const ndArray<ndReal>& GetElevationMap() const;
 
+	/// recalculates the bounds of the whole map.
+	/// the edits of the map of a body in a world, including the tiles loaded and unloaded,
+	/// are only legal outside of an update, or after Sync, and must be followed by a call
+	/// to ndBodyKinematic::CollisionShapeChanged on the body.
 	D_COLLISION_API void UpdateElevationMapAabb();
+
+	/// recalculates the bounds after an edit of the samples from x0, z0 to x1, z1 inclusive,
+	/// the cost is proportional to the size of the edit, not to the size of the map.
+	D_COLLISION_API void UpdateElevationMapAabb(ndInt32 x0, ndInt32 z0, ndInt32 x1, ndInt32 z1);
 	D_COLLISION_API void GetLocalAabb(const ndVector& p0, const ndVector& p1, ndVector& boxP0, ndVector& boxP1) const;
 
+	bool IsTiled() const;
+	ndInt32 GetTileSize() const;
+	ndReal GetElevation(ndInt32 x, ndInt32 z) const;
+
+	D_COLLISION_API bool IsTileLoaded(ndInt32 tile_x, ndInt32 tile_z) const;
+
+	/// copies tileSize * tileSize samples of elevation and attributes in row major order.
+	/// atributes can be nullptr, in which case all the cells of the tile get attribute zero.
+	D_COLLISION_API void LoadTile(ndInt32 tile_x, ndInt32 tile_z, const ndReal* const elevation, const ndInt8* const atributes);
+
+	/// the cells of the tile become holes.
+	D_COLLISION_API void UnloadTile(ndInt32 tile_x, ndInt32 tile_z);
+
+	/// the samples of a loaded tile, for editing in place.
+	/// call UpdateElevationMapAabb with the edited samples when done.
+	D_COLLISION_API ndReal* GetTileElevation(ndInt32 tile_x, ndInt32 tile_z) const;
+
 	protected:
 	virtual ndShapeInfo GetShapeInfo() const;
 	virtual ndUnsigned64 GetHash(ndUnsigned64 hash) const;
@@ -74,25 +107,69 @@ class ndShapeHeightfield: public ndShapeStaticMesh
 	virtual void GetCollidingFaces(ndPolygonMeshDesc* const data) const;
 
 	private: 
+	// the samples of a tile, unloaded tiles point to a shared tile of zeros.
+	// the tiles of a dense map point inside the dense arrays.
+	class ndTile
+	{
+		public:
+		ndReal* m_elevation;
+		ndInt8* m_atributes;
+		ndInt32 m_stride;
+		bool m_loaded;
+	};
+
+	// min and max elevation of the samples of a node of the elevation pyramid
+	class ndElevationRange
+	{
+		public:
+		ndReal m_min;
+		ndReal m_max;
+	};
+
+	class ndPyramidLevel
+	{
+		public:
+		ndInt32 m_start;
+		ndInt32 m_width;
+		ndInt32 m_height;
+	};
+
+	void BuildTiles();
+	void BuildPyramid();
+	void ReleaseTiles();
 	void CalculateLocalObb();
+	void UpdatePyramid(ndInt32 x0, ndInt32 z0, ndInt32 x1, ndInt32 z1);
 	ndInt32 FastInt(ndFloat32 x) const;
+	ndInt8 GetAtribute(ndInt32 x, ndInt32 z) const;
+	bool IsSampleLoaded(ndInt32 x, ndInt32 z) const;
+	bool IsCellLoaded(ndInt32 x, ndInt32 z) const;
 	const ndInt32* GetIndexList() const;
+	ndElevationRange CalculateBlockRange(ndInt32 x0, ndInt32 z0, ndInt32 x1, ndInt32 z1) const;
 	void CalculateMinExtend2d(const ndVector& p0, const ndVector& p1, ndVector& boxP0, ndVector& boxP1) const;
 	void CalculateMinExtend3d(const ndVector& p0, const ndVector& p1, ndVector& boxP0, ndVector& boxP1) const;
 	ndFloat32 RayCastCell(const ndFastRay& ray, ndInt32 xIndex0, ndInt32 zIndex0, ndVector& normalOut, ndFloat32 maxT) const;
+	ndFloat32 RayCastBlock(const ndFastRay& ray, ndInt32 x0, ndInt32 z0, ndInt32 x1, ndInt32 z1, ndInt32& xIndexOut, ndInt32& zIndexOut, ndVector& normalOut, ndFloat32 maxT) const;
 	void CalculateMinAndMaxElevation(ndInt32 x0, ndInt32 x1, ndInt32 z0, ndInt32 z1, ndFloat32& minHeight, ndFloat32& maxHeight) const;
 
 	ndVector m_minBox;
 	ndVector m_maxBox;
 	ndArray<ndInt8> m_atributeMap;
 	ndArray<ndReal> m_elevationMap;
+	ndArray<ndTile> m_tiles;
+	ndArray<ndElevationRange> m_pyramid;
+	ndFixSizeArray<ndPyramidLevel, 32> m_pyramidLevels;
+	ndReal* m_emptyTile;
 	ndFloat32 m_horizontalScale_x;
 	ndFloat32 m_horizontalScale_z;
 	ndFloat32 m_horizontalScaleInv_x;
 	ndFloat32 m_horizontalScaleInv_z;
 	ndInt32 m_width;
 	ndInt32 m_height;
+	ndInt32 m_tileShift;
+	ndInt32 m_tilesCount_x;
+	ndInt32 m_tilesCount_z;
 	ndGridConstruction m_diagonalMode;
+	bool m_tiled;
 
 	static ndVector m_yMask;
 	static ndVector m_padding;
@@ -113,6 +190,40 @@ inline const ndArray<ndReal>& ndShapeHeightfield::GetElevationMap() const
 	return m_elevationMap;
 }
 
+inline bool ndShapeHeightfield::IsTiled() const
+{
+	return m_tiled;
+}
+
+inline ndInt32 ndShapeHeightfield::GetTileSize() const
+{
+	return 1 << m_tileShift;
+}
+
+inline ndReal ndShapeHeightfield::GetElevation(ndInt32 x, ndInt32 z) const
+{
+	const ndInt32 mask = (1 << m_tileShift) - 1;
+	const ndTile& tile = m_tiles[(z >> m_tileShift) * m_tilesCount_x + (x >> m_tileShift)];
+	return tile.m_elevation[(z & mask) * tile.m_stride + (x & mask)];
+}
+
+inline ndInt8 ndShapeHeightfield::GetAtribute(ndInt32 x, ndInt32 z) const
+{
+	const ndInt32 mask = (1 << m_tileShift) - 1;
+	const ndTile& tile = m_tiles[(z >> m_tileShift) * m_tilesCount_x + (x >> m_tileShift)];
+	return tile.m_atributes[(z & mask) * tile.m_stride + (x & mask)];
+}
+
+inline bool ndShapeHeightfield::IsSampleLoaded(ndInt32 x, ndInt32 z) const
+{
+	return m_tiles[(z >> m_tileShift) * m_tilesCount_x + (x >> m_tileShift)].m_loaded;
+}
+
+inline bool ndShapeHeightfield::IsCellLoaded(ndInt32 x, ndInt32 z) const
+{
+	return !m_tiled || (IsSampleLoaded(x, z) && IsSampleLoaded(x + 1, z) && IsSampleLoaded(x, z + 1) && IsSampleLoaded(x + 1, z + 1));
+}
+
 inline ndInt32 ndShapeHeightfield::FastInt(ndFloat32 x) const
 {
 	ndInt32 i = ndInt32(x);
@@ -68,42 +68,43 @@ ndShapeStatic_bvh::ndShapeStatic_bvh(const ndPolygonSoupBuilder& builder)
 {
 	Create(builder);
 	CalculateAdjacent();
+	CalculateMeshInfo();
+}
+
+ndShapeStatic_bvh::ndShapeStatic_bvh(const ndPolygonSoupBuilder& builder, ndThreadPool& threadPool)
+	:ndShapeStaticMesh(m_boundingBoxHierachy)
+	,ndAabbPolygonSoup()
+	,m_trianglesCount(0)
+{
+	Create(builder, threadPool);
+	CalculateAdjacent(threadPool);
+	CalculateMeshInfo();
+}
+
+ndShapeStatic_bvh::ndShapeStatic_bvh(const char* const path)
+	:ndShapeStaticMesh(m_boundingBoxHierachy)
+	,ndAabbPolygonSoup()
+	,m_trianglesCount(0)
+{
+	Deserialize(path);
+	CalculateMeshInfo();
+}
 
+void ndShapeStatic_bvh::CalculateMeshInfo()
+{
 	ndVector p0;
 	ndVector p1;
 	GetAABB(p0, p1);
 	m_boxSize = (p1 - p0) * ndVector::m_half;
 	m_boxOrigin = (p1 + p0) * ndVector::m_half;
 
-	ndMeshVertexListIndexList data;
-	data.m_indexList = nullptr;
-	data.m_userDataList = nullptr;
-	data.m_maxIndexCount = 1000000000;
-	data.m_triangleCount = 0;
-	ndVector zero(ndVector::m_zero);
-	ndFastAabb box(ndGetIdentityMatrix(), ndVector(ndFloat32(1.0e15f)));
-	ForAllSectors(box, zero, ndFloat32(1.0f), GetTriangleCount, &data);
-	m_trianglesCount = data.m_triangleCount;
+	m_trianglesCount = CalculateTriangleCount();
 }
 
 ndShapeStatic_bvh::~ndShapeStatic_bvh(void)
 {
 }
 
-ndIntersectStatus ndShapeStatic_bvh::GetTriangleCount(void* const context, const ndFloat32* const, ndInt32, const ndInt32* const, ndInt32 indexCount, ndFloat32)
-{
-	ndMeshVertexListIndexList& data = (*(ndMeshVertexListIndexList*)context);
-
-	if ((data.m_triangleCount + indexCount - 2) * 3 > data.m_maxIndexCount) 
-	{
-		return m_stopSearch;
-	}
-
-	data.m_triangleCount += (indexCount - 2);
-	ndAssert((data.m_triangleCount * 3) <= data.m_maxIndexCount);
-	return m_continueSearh;
-}
-
 ndShapeInfo ndShapeStatic_bvh::GetShapeInfo() const
 {
 	ndShapeInfo info(ndShapeStaticMesh::GetShapeInfo());
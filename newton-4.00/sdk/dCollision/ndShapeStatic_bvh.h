@@ -32,6 +32,13 @@ class ndShapeStatic_bvh: public ndShapeStaticMesh, public ndAabbPolygonSoup
 
 	D_COLLISION_API ndShapeStatic_bvh();
 	D_COLLISION_API ndShapeStatic_bvh(const ndPolygonSoupBuilder& builder);
+
+	/// builds the mesh on the threads of threadPool, which must be idle,
+	/// a world scene can only be used outside its update.
+	D_COLLISION_API ndShapeStatic_bvh(const ndPolygonSoupBuilder& builder, ndThreadPool& threadPool);
+
+	/// maps a mesh saved with Serialize, the shape uses the file data in place.
+	D_COLLISION_API ndShapeStatic_bvh(const char* const path);
 	D_COLLISION_API virtual ~ndShapeStatic_bvh();
 
 	void *operator new (size_t size);
@@ -48,10 +55,10 @@ class ndShapeStatic_bvh: public ndShapeStaticMesh, public ndAabbPolygonSoup
 	
 	static ndFloat32 RayHit(void* const context, const ndFloat32* const polygon, ndInt32 strideInBytes, const ndInt32* const indexArray, ndInt32 indexCount);
 	static ndIntersectStatus ShowDebugPolygon(void* const context, const ndFloat32* const polygon, ndInt32 strideInBytes, const ndInt32* const indexArray, ndInt32 indexCount, ndFloat32 hitDistance);
-	static ndIntersectStatus GetTriangleCount(void* const context, const ndFloat32* const polygon, ndInt32 strideInBytes, const ndInt32* const indexArray, ndInt32 indexCount, ndFloat32 hitDistance);
 	static ndIntersectStatus GetPolygon(void* const context, const ndFloat32* const polygon, ndInt32 strideInBytes, const ndInt32* const indexArray, ndInt32 indexCount, ndFloat32 hitDistance);
 
 	private: 
+	void CalculateMeshInfo();
 
 	static ndIntersectStatus CalculateHash (
 			void* const context, const ndFloat32* const polygon, ndInt32 strideInBytes,
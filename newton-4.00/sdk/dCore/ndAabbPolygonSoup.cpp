@@ -25,11 +25,29 @@
 #include "ndStack.h"
 #include "ndList.h"
 #include "ndMatrix.h"
+#include "ndSort.h"
+#include "ndThreadPool.h"
 #include "ndPolyhedra.h"
 #include "ndAabbPolygonSoup.h"
+#include "ndMemoryMappedFile.h"
 #include "ndPolygonSoupBuilder.h"
 
 #define DG_STACK_DEPTH 512
+#define DG_WIDE_STACK_DEPTH				(DG_STACK_DEPTH * 2)
+#define D_WIDE_NODE_EMPTY_BOX			ndFloat32 (1.0e15f)
+#define D_WIDE_NODE_FACE_PADDING		ndFloat32 (1.0e-3f)
+#define D_WIDE_NODE_FACE_MIN_PADDING	ndFloat32 (1.0e-4f)
+
+// leaf ranges smaller than this are split by a single thread
+#define D_SOUP_BUILD_SERIAL_SIZE		4096
+#define D_SOUP_BUILD_TASKS_PER_THREAD	8
+#define D_SOUP_EDGE_SORT_BITS			10
+
+// serialized database layout, each array starts at a multiple of D_SOUP_FILE_ALIGNMENT
+#define D_SOUP_FILE_MAGIC				"ndAabbPS"
+#define D_SOUP_FILE_VERSION				1
+#define D_SOUP_FILE_ENDIAN_TAG			0x01020304
+#define D_SOUP_FILE_ALIGNMENT			64
 
 D_MSV_NEWTON_ALIGN_32
 class ndAabbPolygonSoup::ndNodeBuilder: public ndAabbPolygonSoup::ndNode
@@ -45,6 +63,7 @@ class ndAabbPolygonSoup::ndNodeBuilder: public ndAabbPolygonSoup::ndNode
 		,m_enumeration(-1)
 		,m_faceIndex(0)
 		,m_indexCount(0)
+		,m_indexMap(0)
 		,m_faceIndices(nullptr)
 	{
 		SetBox (p0, p1);
@@ -60,6 +79,7 @@ class ndAabbPolygonSoup::ndNodeBuilder: public ndAabbPolygonSoup::ndNode
 		,m_enumeration(-1)
 		,m_faceIndex(faceIndex)
 		,m_indexCount(indexCount)
+		,m_indexMap(0)
 		,m_faceIndices(indexArray)
 	{
 		ndVector minP ( ndFloat32 (1.0e15f)); 
@@ -88,6 +108,7 @@ class ndAabbPolygonSoup::ndNodeBuilder: public ndAabbPolygonSoup::ndNode
 		,m_enumeration(-1)
 		,m_faceIndex(0)
 		,m_indexCount(0)
+		,m_indexMap(0)
 		,m_faceIndices(nullptr)
 	{
 		m_left->m_parent = this;
@@ -114,6 +135,7 @@ class ndAabbPolygonSoup::ndNodeBuilder: public ndAabbPolygonSoup::ndNode
 	ndInt32 m_enumeration;
 	ndInt32 m_faceIndex;
 	ndInt32 m_indexCount;
+	ndInt32 m_indexMap;
 	const ndInt32* m_faceIndices;
 } D_GCC_NEWTON_ALIGN_32;
 
@@ -228,22 +250,127 @@ class ndAabbPolygonSoup::ndSplitInfo
 	ndVector m_p1;
 };
 
+class ndAabbPolygonSoup::ndAdjacentEdge
+{
+	public:
+	ndInt32 m_vertex0;
+	ndInt32 m_vertex1;
+	ndInt32 m_face;
+	// edge index in the face times two, plus one when the edge goes from m_vertex1 to m_vertex0
+	ndInt32 m_edge;
+};
+
+class ndAabbPolygonSoup::ndAdjacentEdgeKey
+{
+	public:
+	ndAdjacentEdgeKey(void* const context)
+		:m_shift(*((ndInt32*)context))
+	{
+	}
+
+	ndInt32 GetKey(const ndAdjacentEdge& edge) const
+	{
+		return (edge.m_vertex0 >> m_shift) & ((1 << D_SOUP_EDGE_SORT_BITS) - 1);
+	}
+
+	ndInt32 m_shift;
+};
+
+class ndAabbPolygonSoup::ndFileHeader
+{
+	public:
+	char m_magic[8];
+	ndUnsigned32 m_version;
+	ndUnsigned32 m_endianTag;
+	ndUnsigned32 m_vertexSize;
+	ndUnsigned32 m_nodeSize;
+	ndUnsigned32 m_wideNodeSize;
+	ndInt32 m_vertexCount;
+	ndInt32 m_indexCount;
+	ndInt32 m_nodesCount;
+	ndInt32 m_wideNodesCount;
+	ndInt32 m_padding;
+	ndUnsigned64 m_vertexOffset;
+	ndUnsigned64 m_indexOffset;
+	ndUnsigned64 m_nodeOffset;
+	ndUnsigned64 m_wideNodeOffset;
+	ndUnsigned64 m_fileSize;
+};
+
+static ndUnsigned64 ndSoupFileAlign(ndUnsigned64 offset)
+{
+	return (offset + D_SOUP_FILE_ALIGNMENT - 1) & ~ndUnsigned64(D_SOUP_FILE_ALIGNMENT - 1);
+}
+
 ndAabbPolygonSoup::ndAabbPolygonSoup ()
 	:ndPolygonSoupDatabase()
 	,m_aabb(nullptr)
+	,m_wideNodes(nullptr)
 	,m_indices(nullptr)
+	,m_mappedFile(nullptr)
 	,m_nodesCount(0)
 	,m_indexCount(0)
+	,m_wideNodesCount(0)
 {
 }
 
 ndAabbPolygonSoup::~ndAabbPolygonSoup ()
 {
-	if (m_aabb) 
+	ReleaseData();
+}
+
+void ndAabbPolygonSoup::ReleaseData()
+{
+	if (m_mappedFile)
+	{
+		// all the arrays are in the mapped file
+		delete m_mappedFile;
+		m_mappedFile = nullptr;
+	}
+	else
+	{
+		if (m_aabb)
+		{
+			ndMemory::Free(m_aabb);
+			ndMemory::Free(m_indices);
+		}
+		if (m_wideNodes)
+		{
+			ndMemory::Free(m_wideNodes);
+		}
+		if (m_localVertex)
+		{
+			ndMemory::Free(m_localVertex);
+		}
+	}
+	m_aabb = nullptr;
+	m_wideNodes = nullptr;
+	m_indices = nullptr;
+	m_localVertex = nullptr;
+	m_nodesCount = 0;
+	m_indexCount = 0;
+	m_vertexCount = 0;
+	m_wideNodesCount = 0;
+}
+
+ndInt32 ndAabbPolygonSoup::CalculateTriangleCount() const
+{
+	// every face is the child of exactly one node, a mesh with a single 
+	// face has an empty leaf with no indices on the right of the root.
+	ndInt32 count = 0;
+	for (ndInt32 i = 0; i < m_nodesCount; ++i)
 	{
-		ndMemory::Free(m_aabb);
-		ndMemory::Free(m_indices);
+		const ndNode& node = m_aabb[i];
+		if (node.m_left.IsLeaf() && (node.m_left.GetCount() > 2))
+		{
+			count += ndInt32(node.m_left.GetCount()) - 2;
+		}
+		if (node.m_right.IsLeaf() && (node.m_right.GetCount() > 2))
+		{
+			count += ndInt32(node.m_right.GetCount()) - 2;
+		}
 	}
+	return count;
 }
 
 ndFloat32 ndAabbPolygonSoup::CalculateFaceMaxDiagonal (const ndVector* const vertex, ndInt32 indexCount, const ndInt32* const indexArray) const
@@ -294,149 +421,228 @@ void ndAabbPolygonSoup::GetAABB (ndVector& p0, ndVector& p1) const
 
 void ndAabbPolygonSoup::CalculateAdjacent ()
 {
-	ndVector p0;
-	ndVector p1;
-	GetAABB (p0, p1);
-	ndFastAabb box (p0, p1);
-
-	ndPolyhedra adjacentMesh;
-	adjacentMesh.BeginFace();
-	ForAllSectors(box, ndVector::m_zero, ndFloat32(1.0f), CalculateAllFaceEdgeNormals, &adjacentMesh);
-	adjacentMesh.EndFace();
-
-	ndInt32 mark = adjacentMesh.IncLRU();
-	ndPolyhedra::Iterator iter(adjacentMesh);
+	BuildAdjacency(nullptr);
+}
+
+void ndAabbPolygonSoup::CalculateAdjacent (ndThreadPool& threadPool)
+{
+	threadPool.Begin();
+	BuildAdjacency(&threadPool);
+	threadPool.End();
+}
+
+void ndAabbPolygonSoup::BuildAdjacency (ndThreadPool* const threadPool)
+{
+	D_TRACKTIME();
+	if (!m_aabb)
+	{
+		return;
+	}
+
+	// collect the faces in the order of the nodes
+	ndInt32 faceCount = 0;
+	ndInt32 edgeCount = 0;
+	ndStack<ndInt32> faceIndexPool(m_nodesCount * 2);
+	ndStack<ndInt32> faceEdgeStartPool(m_nodesCount * 2 + 1);
+	ndInt32* const faceIndex = &faceIndexPool[0];
+	ndInt32* const faceEdgeStart = &faceEdgeStartPool[0];
+	for (ndInt32 i = 0; i < m_nodesCount; ++i)
+	{
+		const ndNode* const node = &m_aabb[i];
+		if (node->m_left.IsLeaf() && node->m_left.GetCount())
+		{
+			faceIndex[faceCount] = ndInt32(node->m_left.GetIndex());
+			faceEdgeStart[faceCount] = edgeCount;
+			edgeCount += ndInt32(node->m_left.GetCount());
+			faceCount++;
+		}
+		if (node->m_right.IsLeaf() && node->m_right.GetCount())
+		{
+			faceIndex[faceCount] = ndInt32(node->m_right.GetIndex());
+			faceEdgeStart[faceCount] = edgeCount;
+			edgeCount += ndInt32(node->m_right.GetCount());
+			faceCount++;
+		}
+	}
+	faceEdgeStart[faceCount] = edgeCount;
+
+	// one entry per face edge, sorted by the smaller vertex index, 
+	// so that the two sides of a shared edge end up in the same small group.
+	ndStack<ndAdjacentEdge> edgePool(edgeCount);
+	ndStack<ndAdjacentEdge> edgeScratchPool(edgeCount);
+	ndAdjacentEdge* edges = &edgePool[0];
+	ndAdjacentEdge* edgesScratch = &edgeScratchPool[0];
+	auto BuildEdges = ndMakeObject::ndFunction([this, faceCount, faceIndex, faceEdgeStart, edges](ndInt32 threadIndex, ndInt32 threadCount)
+	{
+		D_TRACKTIME_NAMED(BuildEdges);
+		const ndStartEnd startEnd(faceCount, threadIndex, threadCount);
+		for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
+		{
+			const ndInt32* const face = &m_indices[faceIndex[i]];
+			const ndInt32 vCount = faceEdgeStart[i + 1] - faceEdgeStart[i];
+			ndInt32 i0 = face[vCount - 1];
+			for (ndInt32 j = 0; j < vCount; ++j)
+			{
+				// edge j goes from vertex j to vertex j + 1
+				const ndInt32 i1 = face[j];
+				const ndInt32 slot = (j + vCount - 1) % vCount;
+				ndAdjacentEdge& edge = edges[faceEdgeStart[i] + slot];
+				edge.m_vertex0 = ndMin(i0, i1);
+				edge.m_vertex1 = ndMax(i0, i1);
+				edge.m_face = i;
+				edge.m_edge = (slot << 1) | ((i0 > i1) ? 1 : 0);
+				i0 = i1;
+			}
+		}
+	});
+	ndParallelExecute(threadPool, BuildEdges);
+
+	for (ndInt32 shift = 0; (shift == 0) || ((m_vertexCount >> shift) > 0); shift += D_SOUP_EDGE_SORT_BITS)
+	{
+		if (threadPool)
+		{
+			ndCountingSort<ndAdjacentEdge, ndAdjacentEdgeKey, D_SOUP_EDGE_SORT_BITS>(*threadPool, edges, edgesScratch, edgeCount, nullptr, &shift);
+		}
+		else
+		{
+			ndCountingSort<ndAdjacentEdge, ndAdjacentEdgeKey, D_SOUP_EDGE_SORT_BITS>(edges, edgesScratch, edgeCount, nullptr, &shift);
+		}
+		ndSwap(edges, edgesScratch);
+	}
+
+	// an edge is shared when exactly two faces use it, in opposite directions.
 	const ndTriplex* const vertexArray = (ndTriplex*)GetLocalVertexPool();
-	for (iter.Begin(); iter; iter++)
+	auto MatchEdges = ndMakeObject::ndFunction([this, edgeCount, edges, faceIndex, faceEdgeStart, vertexArray](ndInt32 threadIndex, ndInt32 threadCount)
 	{
-		ndEdge* const edge = &(*iter);
-		if ((edge->m_mark != mark) && (edge->m_incidentFace >= 0) && (edge->m_twin->m_incidentFace >= 0))
+		D_TRACKTIME_NAMED(MatchEdges);
+		const ndStartEnd startEnd(edgeCount, threadIndex, threadCount);
+		ndInt32 start = startEnd.m_start;
+		while (start && (start < edgeCount) && (edges[start].m_vertex0 == edges[start - 1].m_vertex0))
 		{
-			ndInt32 indexCount0 = 0;
-			ndInt32 indexCount1 = 0;
-			ndInt32 offsetIndex0 = -1;
-			ndInt32 offsetIndex1 = -1;
-			ndInt32* const indexArray0 = (ndInt32*)edge->m_userData;
-			ndInt32* const indexArray1 = (ndInt32*)edge->m_twin->m_userData;
-			ndEdge* ptr = edge;
-			do
+			start++;
+		}
+		for (ndInt32 groupStart = start; groupStart < startEnd.m_end; )
+		{
+			ndInt32 groupEnd = groupStart + 1;
+			while ((groupEnd < edgeCount) && (edges[groupEnd].m_vertex0 == edges[groupStart].m_vertex0))
 			{
-				indexCount0++;
-				ptr = ptr->m_next;
-			} while (ptr != edge);
+				groupEnd++;
+			}
 
-			ptr = edge->m_twin;
-			do
+			for (ndInt32 i = groupStart; i < groupEnd; ++i)
 			{
-				indexCount1++;
-				ptr = ptr->m_next;
-			} while (ptr != edge->m_twin);
+				ndInt32 twin = -1;
+				ndInt32 sharedCount = 0;
+				for (ndInt32 j = groupStart; j < groupEnd; ++j)
+				{
+					if ((j != i) && (edges[j].m_vertex1 == edges[i].m_vertex1))
+					{
+						twin = j;
+						sharedCount++;
+					}
+				}
+				if ((sharedCount != 1) || (twin < i) || (((edges[i].m_edge ^ edges[twin].m_edge) & 1) == 0))
+				{
+					continue;
+				}
+
+				const ndAdjacentEdge& edge0 = edges[i];
+				const ndAdjacentEdge& edge1 = edges[twin];
+				ndInt32* const indexArray0 = &m_indices[faceIndex[edge0.m_face]];
+				ndInt32* const indexArray1 = &m_indices[faceIndex[edge1.m_face]];
+				const ndInt32 indexCount0 = faceEdgeStart[edge0.m_face + 1] - faceEdgeStart[edge0.m_face];
+				const ndInt32 indexCount1 = faceEdgeStart[edge1.m_face + 1] - faceEdgeStart[edge1.m_face];
 
-			ndVector n0(&vertexArray[indexArray0[indexCount0 + 1]].m_x);
-			ndVector q0(&vertexArray[indexArray0[0]].m_x);
-			n0 = n0 & ndVector::m_triplexMask;
-			q0 = q0 & ndVector::m_triplexMask;
+				ndVector n0(&vertexArray[indexArray0[indexCount0 + 1]].m_x);
+				ndVector q0(&vertexArray[indexArray0[0]].m_x);
+				n0 = n0 & ndVector::m_triplexMask;
+				q0 = q0 & ndVector::m_triplexMask;
 
-			ndVector n1(&vertexArray[indexArray1[indexCount1 + 1]].m_x);
-			ndVector q1(&vertexArray[indexArray1[0]].m_x);
-			n1 = n1 & ndVector::m_triplexMask;
-			q1 = q1 & ndVector::m_triplexMask;
+				ndVector n1(&vertexArray[indexArray1[indexCount1 + 1]].m_x);
+				ndVector q1(&vertexArray[indexArray1[0]].m_x);
+				n1 = n1 & ndVector::m_triplexMask;
+				q1 = q1 & ndVector::m_triplexMask;
 
-			ndPlane plane0(n0, -n0.DotProduct(q0).GetScalar());
-			ndPlane plane1(n1, -n1.DotProduct(q1).GetScalar());
+				ndPlane plane0(n0, -n0.DotProduct(q0).GetScalar());
+				ndPlane plane1(n1, -n1.DotProduct(q1).GetScalar());
 
-			ndFloat32 maxDist0 = ndFloat32(-1.0f);
-			for (ndInt32 i = 0; i < indexCount1; ++i)
-			{
-				if (edge->m_twin->m_incidentVertex == indexArray1[i])
+				ndFloat32 maxDist0 = ndFloat32(-1.0f);
+				for (ndInt32 k = 0; k < indexCount1; ++k)
 				{
-					offsetIndex1 = i;
+					ndVector point(&vertexArray[indexArray1[k]].m_x);
+					ndFloat32 dist(plane0.Evalue(point & ndVector::m_triplexMask));
+					maxDist0 = ndMax(maxDist0, dist);
 				}
-				ndVector point(&vertexArray[indexArray1[i]].m_x);
-				ndFloat32 dist(plane0.Evalue(point & ndVector::m_triplexMask));
-				maxDist0 = ndMax(maxDist0, dist);
-			}
 
-			ndFloat32 maxDist1 = ndFloat32(-1.0f);
-			for (ndInt32 i = 0; i < indexCount0; ++i)
-			{
-				if (edge->m_incidentVertex == indexArray0[i])
+				ndFloat32 maxDist1 = ndFloat32(-1.0f);
+				for (ndInt32 k = 0; k < indexCount0; ++k)
 				{
-					offsetIndex0 = i;
+					ndVector point(&vertexArray[indexArray0[k]].m_x);
+					ndFloat32 dist(plane1.Evalue(point & ndVector::m_triplexMask));
+					maxDist1 = ndMax(maxDist1, dist);
 				}
-				ndVector point(&vertexArray[indexArray0[i]].m_x);
-				ndFloat32 dist(plane1.Evalue(point & ndVector::m_triplexMask));
-				maxDist1 = ndMax(maxDist1, dist);
-			}
 
-			bool edgeIsConvex = (maxDist0 <= ndFloat32(1.0e-3f));
-			edgeIsConvex = edgeIsConvex && (maxDist1 <= ndFloat32(1.0e-3f));
-			edgeIsConvex = edgeIsConvex || (n0.DotProduct(n1).GetScalar() > ndFloat32(0.9991f));
+				bool edgeIsConvex = (maxDist0 <= ndFloat32(1.0e-3f));
+				edgeIsConvex = edgeIsConvex && (maxDist1 <= ndFloat32(1.0e-3f));
+				edgeIsConvex = edgeIsConvex || (n0.DotProduct(n1).GetScalar() > ndFloat32(0.9991f));
 
-			//hacks for testing adjacency
-			//edgeIsConvex = edgeIsConvex || (n0.DotProduct(n1).GetScalar() > ndFloat32(0.5f));
-			//edgeIsConvex = true;
-			if (edgeIsConvex)
-			{
-				ndAssert(offsetIndex0 >= 0);
-				ndAssert(offsetIndex1 >= 0);
-				indexArray0[indexCount0 + 2 + offsetIndex0] = indexArray1[indexCount1 + 1];
-				indexArray1[indexCount1 + 2 + offsetIndex1] = indexArray0[indexCount0 + 1];
+				//hacks for testing adjacency
+				//edgeIsConvex = edgeIsConvex || (n0.DotProduct(n1).GetScalar() > ndFloat32(0.5f));
+				//edgeIsConvex = true;
+				if (edgeIsConvex)
+				{
+					indexArray0[indexCount0 + 2 + (edge0.m_edge >> 1)] = indexArray1[indexCount1 + 1];
+					indexArray1[indexCount1 + 2 + (edge1.m_edge >> 1)] = indexArray0[indexCount0 + 1];
+				}
 			}
+			groupStart = groupEnd;
 		}
-		edge->m_mark = mark;
-		edge->m_twin->m_mark = mark;
-	}
+	});
+	ndParallelExecute(threadPool, MatchEdges);
 
-	ndStack<ndTriplex> pool ((m_indexCount / 2) - 1);
-	ndInt32 normalCount = 0;
-	for (ndInt32 i = 0; i < m_nodesCount; ++i) 
+	// the edges without a convex neighbor get their own edge normal
+	ndStack<ndInt32> faceNormalStartPool(faceCount + 1);
+	ndInt32* const faceNormalStart = &faceNormalStartPool[0];
+	auto CountConcaveEdges = ndMakeObject::ndFunction([this, faceCount, faceIndex, faceEdgeStart, faceNormalStart](ndInt32 threadIndex, ndInt32 threadCount)
 	{
-		const ndNode* const node = &m_aabb[i];
-		if (node->m_left.IsLeaf()) 
+		D_TRACKTIME_NAMED(CountConcaveEdges);
+		const ndStartEnd startEnd(faceCount, threadIndex, threadCount);
+		for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
 		{
-			ndInt32 vCount = ndInt32 (node->m_left.GetCount());
-			if (vCount) 
+			const ndInt32* const face = &m_indices[faceIndex[i]];
+			const ndInt32 vCount = faceEdgeStart[i + 1] - faceEdgeStart[i];
+			ndInt32 count = 0;
+			for (ndInt32 j = 0; j < vCount; ++j)
 			{
-				ndInt32 index = ndInt32 (node->m_left.GetIndex());
-				ndInt32* const face = &m_indices[index];
-	
-				ndInt32 j0 = 2 * (vCount + 1) - 1;
-				ndVector normal (&vertexArray[face[vCount + 1]].m_x);
-				normal = normal & ndVector::m_triplexMask;
-				ndAssert (ndAbs (normal.DotProduct(normal).GetScalar() - ndFloat32 (1.0f)) < ndFloat32 (1.0e-6f));
-				ndVector q0 (&vertexArray[face[vCount - 1]].m_x);
-				q0 = q0 & ndVector::m_triplexMask;
-				for (ndInt32 j = 0; j < vCount; ++j) 
-				{
-					ndInt32 j1 = vCount + 2 + j;
-					ndVector q1 (&vertexArray[face[j]].m_x);
-					q1 = q1 & ndVector::m_triplexMask;
-					if (face[j0] & D_CONCAVE_EDGE_MASK)
-					{
-						ndVector e (q1 - q0);
-						ndVector n (e.CrossProduct(normal).Normalize());
-						ndAssert (ndAbs (n.DotProduct(n).GetScalar() - ndFloat32 (1.0f)) < ndFloat32 (1.0e-6f));
-						pool[normalCount].m_x = n.m_x;
-						pool[normalCount].m_y = n.m_y;
-						pool[normalCount].m_z = n.m_z;
-						face[j0] = normalCount | D_CONCAVE_EDGE_MASK;
-						normalCount ++;
-					}
-					q0 = q1;
-					j0 = j1;
-				}
+				count += (face[vCount + 2 + j] & D_CONCAVE_EDGE_MASK) ? 1 : 0;
 			}
+			faceNormalStart[i] = count;
 		}
-	
-		if (node->m_right.IsLeaf()) 
+	});
+	ndParallelExecute(threadPool, CountConcaveEdges);
+
+	ndInt32 normalCount = 0;
+	for (ndInt32 i = 0; i < faceCount; ++i)
+	{
+		const ndInt32 count = faceNormalStart[i];
+		faceNormalStart[i] = normalCount;
+		normalCount += count;
+	}
+	faceNormalStart[faceCount] = normalCount;
+
+	if (normalCount) 
+	{
+		ndStack<ndTriplex> pool (normalCount);
+		auto CalculateEdgeNormals = ndMakeObject::ndFunction([this, faceCount, faceIndex, faceEdgeStart, faceNormalStart, vertexArray, &pool](ndInt32 threadIndex, ndInt32 threadCount)
 		{
-			ndInt32 vCount = ndInt32 (node->m_right.GetCount());
-			if (vCount) 
+			D_TRACKTIME_NAMED(CalculateEdgeNormals);
+			const ndStartEnd startEnd(faceCount, threadIndex, threadCount);
+			for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
 			{
-				ndInt32 index = ndInt32 (node->m_right.GetIndex());
-				ndInt32* const face = &m_indices[index];
-	
+				ndInt32* const face = &m_indices[faceIndex[i]];
+				const ndInt32 vCount = faceEdgeStart[i + 1] - faceEdgeStart[i];
+				ndInt32 normalIndex = faceNormalStart[i];
+
 				ndInt32 j0 = 2 * (vCount + 1) - 1;
 				ndVector normal (&vertexArray[face[vCount + 1]].m_x);
 				normal = normal & ndVector::m_triplexMask;
@@ -453,21 +659,20 @@ void ndAabbPolygonSoup::CalculateAdjacent ()
 						ndVector e (q1 - q0);
 						ndVector n (e.CrossProduct(normal).Normalize());
 						ndAssert (ndAbs (n.DotProduct(n).GetScalar() - ndFloat32 (1.0f)) < ndFloat32 (1.0e-6f));
-						pool[normalCount].m_x = n.m_x;
-						pool[normalCount].m_y = n.m_y;
-						pool[normalCount].m_z = n.m_z;
-						face[j0] = normalCount | D_CONCAVE_EDGE_MASK;
-						normalCount ++;
+						pool[normalIndex].m_x = n.m_x;
+						pool[normalIndex].m_y = n.m_y;
+						pool[normalIndex].m_z = n.m_z;
+						face[j0] = normalIndex | D_CONCAVE_EDGE_MASK;
+						normalIndex ++;
 					}
 					q0 = q1;
 					j0 = j1;
 				}
+				ndAssert(normalIndex == faceNormalStart[i + 1]);
 			}
-		}
-	}
-	
-	if (normalCount) 
-	{
+		});
+		ndParallelExecute(threadPool, CalculateEdgeNormals);
+
 		ndStack<ndInt32> indexArray (normalCount);
 		ndInt32 newNormalCount = ndVertexListToIndexList (&pool[0].m_x, sizeof (ndTriplex), 3, normalCount, &indexArray[0], ndFloat32 (1.0e-6f));
 	
@@ -480,37 +685,15 @@ void ndAabbPolygonSoup::CalculateAdjacent ()
 	
 		m_localVertex = &vertexArray1[0].m_x;
 		m_vertexCount = oldCount + newNormalCount;
-	
-		for (ndInt32 i = 0; i < m_nodesCount; ++i) 
+
+		auto RemapEdgeNormals = ndMakeObject::ndFunction([this, faceCount, faceIndex, faceEdgeStart, oldCount, &indexArray](ndInt32 threadIndex, ndInt32 threadCount)
 		{
-			const ndNode* const node = &m_aabb[i];
-			if (node->m_left.IsLeaf()) 
-			{
-				ndInt32 vCount = ndInt32 (node->m_left.GetCount());
-				ndInt32 index = ndInt32 (node->m_left.GetIndex());
-				ndInt32* const face = &m_indices[index];
-				for (ndInt32 j = 0; j < vCount; ++j) 
-				{
-					ndInt32 edgeIndexNormal = face[vCount + 2 + j];
-					if (edgeIndexNormal & D_CONCAVE_EDGE_MASK)
-					{
-						ndInt32 k = edgeIndexNormal & (~D_CONCAVE_EDGE_MASK);
-						face[vCount + 2 + j] = (indexArray[k] + oldCount) | D_CONCAVE_EDGE_MASK;
-					}
-					#ifdef _DEBUG	
-						//ndVector normal (&vertexArray1[face[vCount + 2 + j]].m_x);
-						ndVector normal (&vertexArray1[face[vCount + 2 + j] & (~D_CONCAVE_EDGE_MASK)].m_x);
-						normal = normal & ndVector::m_triplexMask;
-						ndAssert (ndAbs (normal.DotProduct(normal).GetScalar() - ndFloat32 (1.0f)) < ndFloat32 (1.0e-6f));
-					#endif
-				}
-			}
-	
-			if (node->m_right.IsLeaf()) 
+			D_TRACKTIME_NAMED(RemapEdgeNormals);
+			const ndStartEnd startEnd(faceCount, threadIndex, threadCount);
+			for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
 			{
-				ndInt32 vCount = ndInt32 (node->m_right.GetCount());
-				ndInt32 index = ndInt32 (node->m_right.GetIndex());
-				ndInt32* const face = &m_indices[index];
+				ndInt32* const face = &m_indices[faceIndex[i]];
+				const ndInt32 vCount = faceEdgeStart[i + 1] - faceEdgeStart[i];
 				for (ndInt32 j = 0; j < vCount; ++j) 
 				{
 					ndInt32 edgeIndexNormal = face[vCount + 2 + j];
@@ -519,37 +702,20 @@ void ndAabbPolygonSoup::CalculateAdjacent ()
 						ndInt32 k = edgeIndexNormal & (~D_CONCAVE_EDGE_MASK);
 						face[vCount + 2 + j] = (indexArray[k] + oldCount) | D_CONCAVE_EDGE_MASK;
 					}
-	
 					#ifdef _DEBUG	
-						//ndVector normal (&vertexArray1[face[vCount + 2 + j]].m_x);
+						const ndTriplex* const vertexArray1 = (ndTriplex*)GetLocalVertexPool();
 						ndVector normal(&vertexArray1[face[vCount + 2 + j] & (~D_CONCAVE_EDGE_MASK)].m_x);
 						normal = normal & ndVector::m_triplexMask;
 						ndAssert (ndAbs (normal.DotProduct(normal).GetScalar() - ndFloat32 (1.0f)) < ndFloat32 (1.0e-6f));
 					#endif
 				}
 			}
-		}
+		});
+		ndParallelExecute(threadPool, RemapEdgeNormals);
 	}
 }
 
-ndIntersectStatus ndAabbPolygonSoup::CalculateAllFaceEdgeNormals(void* const context, const ndFloat32* const, ndInt32, const ndInt32* const indexArray, ndInt32 indexCount, ndFloat32)
-{
-	ndInt32 face[256];
-	ndInt64 data[256];
-	ndPolyhedra& adjacency = *((ndPolyhedra*)context);
-
-	ndIntPtr userData;
-	userData.m_ptr = (void*)indexArray;
-	for (ndInt32 i = 0; i < indexCount; ++i)
-	{
-		face[i] = indexArray[i];
-		data[i] = userData.m_int;
-	}
-	adjacency.AddFace(indexCount, face, data);
-	return m_continueSearh;
-}
-
-ndAabbPolygonSoup::ndNodeBuilder* ndAabbPolygonSoup::BuildTopDown (ndNodeBuilder* const leafArray, ndInt32 firstBox, ndInt32 lastBox, ndNodeBuilder** const allocator) const
+ndAabbPolygonSoup::ndNodeBuilder* ndAabbPolygonSoup::BuildTopDown (ndNodeBuilder* const leafArray, ndInt32 firstBox, ndInt32 lastBox, ndNodeBuilder* const nodeArray) const
 {
 	ndAssert (firstBox >= 0);
 	ndAssert (lastBox >= 0);
@@ -562,21 +728,115 @@ ndAabbPolygonSoup::ndNodeBuilder* ndAabbPolygonSoup::BuildTopDown (ndNodeBuilder
 	{
 		ndSplitInfo info (&leafArray[firstBox], lastBox - firstBox + 1);
 
-		ndNodeBuilder* const parent = new (*allocator) ndNodeBuilder (info.m_p0, info.m_p1);
-		*allocator = *allocator + 1;
+		// a range of n leaves owns the n - 1 interior nodes from nodeArray[firstBox] 
+		// to nodeArray[lastBox - 1]: the left range, the parent, then the right range.
+		// this way disjoint ranges can be built at the same time without an allocator.
+		ndNodeBuilder* const parent = new (&nodeArray[firstBox + info.m_axis - 1]) ndNodeBuilder (info.m_p0, info.m_p1);
 
 		ndAssert (parent);
-		parent->m_right = BuildTopDown (leafArray, firstBox + info.m_axis, lastBox, allocator);
+		parent->m_right = BuildTopDown (leafArray, firstBox + info.m_axis, lastBox, nodeArray);
 		parent->m_right->m_parent = parent;
 
-		parent->m_left = BuildTopDown (leafArray, firstBox, firstBox + info.m_axis - 1, allocator);
+		parent->m_left = BuildTopDown (leafArray, firstBox, firstBox + info.m_axis - 1, nodeArray);
 		parent->m_left->m_parent = parent;
 		return parent;
 	}
 }
 
+ndAabbPolygonSoup::ndNodeBuilder* ndAabbPolygonSoup::BuildTopDown (ndNodeBuilder* const leafArray, ndInt32 firstBox, ndInt32 lastBox, ndNodeBuilder* const nodeArray, ndThreadPool* const threadPool) const
+{
+	D_TRACKTIME();
+	if (!threadPool || (threadPool->GetThreadCount() == 1))
+	{
+		return BuildTopDown(leafArray, firstBox, lastBox, nodeArray);
+	}
+
+	class ndSubTree
+	{
+		public:
+		ndNodeBuilder* m_parent;
+		ndInt32 m_firstBox;
+		ndInt32 m_lastBox;
+		bool m_isLeft;
+	};
+
+	// split the top levels on this thread, until there are enough ranges to keep the threads busy.
+	ndNodeBuilder* root = nullptr;
+	ndArray<ndSubTree> ranges;
+	ranges.PushBack(ndSubTree{ nullptr, firstBox, lastBox, false });
+
+	ndInt32 head = 0;
+	const ndInt32 maxSubTrees = threadPool->GetThreadCount() * D_SOUP_BUILD_TASKS_PER_THREAD;
+	while ((head < ranges.GetCount()) && ((ranges.GetCount() - head) < maxSubTrees))
+	{
+		const ndSubTree range(ranges[head]);
+		if ((range.m_lastBox - range.m_firstBox) < D_SOUP_BUILD_SERIAL_SIZE)
+		{
+			break;
+		}
+		head++;
+
+		ndSplitInfo info(&leafArray[range.m_firstBox], range.m_lastBox - range.m_firstBox + 1);
+		ndNodeBuilder* const parent = new (&nodeArray[range.m_firstBox + info.m_axis - 1]) ndNodeBuilder(info.m_p0, info.m_p1);
+		parent->m_parent = range.m_parent;
+		if (!range.m_parent)
+		{
+			root = parent;
+		}
+		else if (range.m_isLeft)
+		{
+			range.m_parent->m_left = parent;
+		}
+		else
+		{
+			range.m_parent->m_right = parent;
+		}
+		ranges.PushBack(ndSubTree{ parent, range.m_firstBox, range.m_firstBox + info.m_axis - 1, true });
+		ranges.PushBack(ndSubTree{ parent, range.m_firstBox + info.m_axis, range.m_lastBox, false });
+	}
+
+	ndAtomic<ndInt32> iterator(head);
+	auto BuildSubTrees = ndMakeObject::ndFunction([this, &iterator, &ranges, &root, leafArray, nodeArray](ndInt32, ndInt32)
+	{
+		D_TRACKTIME_NAMED(BuildSubTrees);
+		for (ndInt32 i = iterator.fetch_add(1); i < ranges.GetCount(); i = iterator.fetch_add(1))
+		{
+			const ndSubTree& range = ranges[i];
+			ndNodeBuilder* const node = BuildTopDown(leafArray, range.m_firstBox, range.m_lastBox, nodeArray);
+			node->m_parent = range.m_parent;
+			if (!range.m_parent)
+			{
+				root = node;
+			}
+			else if (range.m_isLeft)
+			{
+				range.m_parent->m_left = node;
+			}
+			else
+			{
+				range.m_parent->m_right = node;
+			}
+		}
+	});
+	threadPool->ParallelExecute(BuildSubTrees);
+	return root;
+}
+
 void ndAabbPolygonSoup::Create (const ndPolygonSoupBuilder& builder)
 {
+	BuildDatabase(builder, nullptr);
+}
+
+void ndAabbPolygonSoup::Create (const ndPolygonSoupBuilder& builder, ndThreadPool& threadPool)
+{
+	threadPool.Begin();
+	BuildDatabase(builder, &threadPool);
+	threadPool.End();
+}
+
+void ndAabbPolygonSoup::BuildDatabase (const ndPolygonSoupBuilder& builder, ndThreadPool* const threadPool)
+{
+	D_TRACKTIME();
 	if (builder.m_faceVertexCount.GetCount() == 0) 
 	{
 		return;
@@ -596,195 +856,435 @@ void ndAabbPolygonSoup::Create (const ndPolygonSoupBuilder& builder)
 	ndStack<ndVector> tmpVertexArrayCount(builder.m_vertexPoints.GetCount() + builder.m_normalPoints.GetCount() + builder.m_faceVertexCount.GetCount() * 2 + 4);
 
 	ndVector* const tmpVertexArray = &tmpVertexArrayCount[0];
-	for (ndInt32 i = 0; i < builder.m_vertexPoints.GetCount(); ++i) 
+	const ndInt32 faceCount = builder.m_faceVertexCount.GetCount();
+	const ndInt32 pointCount = builder.m_vertexPoints.GetCount();
+	const ndInt32 normalCount = builder.m_normalPoints.GetCount();
+	auto CopyPoints = ndMakeObject::ndFunction([&builder, tmpVertexArray, pointCount, normalCount](ndInt32 threadIndex, ndInt32 threadCount)
 	{
-		tmpVertexArray[i] = builder.m_vertexPoints[i];
-	}
+		D_TRACKTIME_NAMED(CopyPoints);
+		const ndStartEnd startEnd(pointCount + normalCount, threadIndex, threadCount);
+		for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
+		{
+			tmpVertexArray[i] = (i < pointCount) ? ndVector(builder.m_vertexPoints[i]) : ndVector(builder.m_normalPoints[i - pointCount]);
+		}
+	});
+	ndParallelExecute(threadPool, CopyPoints);
 
-	for (ndInt32 i = 0; i < builder.m_normalPoints.GetCount(); ++i) 
+	const ndInt32* const indices = &builder.m_vertexIndex[0];
+	ndStack<ndInt32> faceStartPool(faceCount);
+	ndInt32* const faceStart = &faceStartPool[0];
+	ndInt32 polygonIndex = 0;
+	for (ndInt32 i = 0; i < faceCount; ++i) 
 	{
-		tmpVertexArray[i + builder.m_vertexPoints.GetCount()] = builder.m_normalPoints[i];
+		faceStart[i] = polygonIndex;
+		polygonIndex += builder.m_faceVertexCount[i];
 	}
 
-	const ndInt32* const indices = &builder.m_vertexIndex[0];
-	ndStack<ndNodeBuilder> constructor (builder.m_faceVertexCount.GetCount() * 2 + 16); 
-
-	ndInt32 polygonIndex = 0;
-	ndInt32 allocatorIndex = 0;
-	if (builder.m_faceVertexCount.GetCount() == 1) 
+	// a single face is duplicated, so that the root node has two children.
+	const ndInt32 leafBase = (faceCount == 1) ? 1 : 0;
+	const ndInt32 leafCount = faceCount + leafBase;
+	ndStack<ndNodeBuilder> constructor (leafCount * 2); 
+	if (leafBase) 
 	{
 		ndInt32 indexCount = builder.m_faceVertexCount[0] - 1;
-		new (&constructor[allocatorIndex]) ndNodeBuilder (&tmpVertexArray[0], 0, indexCount, &indices[0]);
-		allocatorIndex ++;
+		new (&constructor[0]) ndNodeBuilder (&tmpVertexArray[0], 0, indexCount, &indices[0]);
 	}
-	for (ndInt32 i = 0; i < builder.m_faceVertexCount.GetCount(); ++i) 
+	auto BuildLeafs = ndMakeObject::ndFunction([&builder, &constructor, tmpVertexArray, indices, faceStart, faceCount, leafBase](ndInt32 threadIndex, ndInt32 threadCount)
 	{
-		ndInt32 indexCount = builder.m_faceVertexCount[i] - 1;
-		new (&constructor[allocatorIndex]) ndNodeBuilder (&tmpVertexArray[0], i, indexCount, &indices[polygonIndex]);
-		allocatorIndex ++;
-		polygonIndex += (indexCount + 1);
-	}
-
-	ndNodeBuilder* constructorAllocator = &constructor[allocatorIndex];
-	ndNodeBuilder* const root = BuildTopDown (&constructor[0], 0, allocatorIndex - 1, &constructorAllocator);
+		D_TRACKTIME_NAMED(BuildLeafs);
+		const ndStartEnd startEnd(faceCount, threadIndex, threadCount);
+		for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
+		{
+			ndInt32 indexCount = builder.m_faceVertexCount[i] - 1;
+			new (&constructor[i + leafBase]) ndNodeBuilder (&tmpVertexArray[0], i, indexCount, &indices[faceStart[i]]);
+		}
+	});
+	ndParallelExecute(threadPool, BuildLeafs);
 
+	ndNodeBuilder* const nodeArray = &constructor[leafCount];
+	ndNodeBuilder* const root = BuildTopDown (&constructor[0], 0, leafCount - 1, nodeArray, threadPool);
 	ndAssert (root);
-	ndList<ndNodeBuilder*> list;
-	list.Append(root);
+
+	// breadth first order, interior nodes get consecutive indices, 
+	// and the faces get consecutive ranges of the index array.
+	ndStack<ndNodeBuilder*> nodeOrderPool(leafCount * 2);
+	ndNodeBuilder** const nodeOrder = &nodeOrderPool[0];
+	ndInt32 nodeOrderCount = 1;
+	nodeOrder[0] = root;
 	ndInt32 nodeIndex = 0;
-	while (list.GetCount())
+	ndInt32 indexMap = 0;
+	for (ndInt32 i = 0; i < nodeOrderCount; ++i)
 	{
-		ndNodeBuilder* const node = list.GetFirst()->GetInfo();
-		list.Remove(list.GetFirst());
-
+		ndNodeBuilder* const node = nodeOrder[i];
 		if (node->m_left) 
 		{
+			ndAssert (node->m_right);
 			node->m_enumeration = nodeIndex;
 			nodeIndex ++;
-			ndAssert (node->m_right);
-			list.Append(node->m_left);
-			list.Append(node->m_right);
+			nodeOrder[nodeOrderCount] = node->m_left;
+			nodeOrder[nodeOrderCount + 1] = node->m_right;
+			nodeOrderCount += 2;
+		}
+		else
+		{
+			node->m_indexMap = indexMap;
+			indexMap += node->m_indexCount * 2 + 3;
 		}
 	}
-	ndAssert(!list.GetCount());
-
-	ndInt32 aabbBase = builder.m_vertexPoints.GetCount() + builder.m_normalPoints.GetCount();
+	ndAssert(nodeIndex == m_nodesCount);
+	ndAssert(indexMap <= m_indexCount);
 
+	const ndInt32 aabbBase = builder.m_vertexPoints.GetCount() + builder.m_normalPoints.GetCount();
 	ndVector* const aabbPoints = &tmpVertexArray[aabbBase];
-
-	ndInt32 vertexIndex = 0;
-	ndInt32 aabbNodeIndex = 0;
-	list.Append(root);
-	ndInt32 indexMap = 0;
-	while (list.GetCount())
+	auto EmitNodes = ndMakeObject::ndFunction([this, &builder, nodeOrder, nodeOrderCount, tmpVertexArray, aabbPoints, aabbBase](ndInt32 threadIndex, ndInt32 threadCount)
 	{
-		ndNodeBuilder* const node = list.GetFirst()->GetInfo();
-		list.Remove(list.GetFirst());
-
-		if (node->m_enumeration >= 0)
+		D_TRACKTIME_NAMED(EmitNodes);
+		const ndStartEnd startEnd(nodeOrderCount, threadIndex, threadCount);
+		for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
 		{
-			ndAssert (node->m_left);
-			ndAssert (node->m_right);
-			ndNode& aabbNode = m_aabb[aabbNodeIndex];
-			aabbNodeIndex ++;
-			ndAssert (aabbNodeIndex <= m_nodesCount);
-
-			if (node->m_parent)
+			const ndNodeBuilder* const node = nodeOrder[i];
+			if (node->m_enumeration >= 0)
 			{
-				if (node->m_parent->m_left == node)
-				{
-					m_aabb[node->m_parent->m_enumeration].m_left = ndNode::ndLeafNodePtr (ndUnsigned32 (&m_aabb[node->m_enumeration] - m_aabb));
-				}
-				else 
+				ndAssert (node->m_left);
+				ndAssert (node->m_right);
+				ndNode& aabbNode = m_aabb[node->m_enumeration];
+				const ndNodeBuilder* const left = node->m_left;
+				const ndNodeBuilder* const right = node->m_right;
+				aabbNode.m_left = (left->m_enumeration >= 0) ? ndNode::ndLeafNodePtr (ndUnsigned32 (left->m_enumeration)) : ndNode::ndLeafNodePtr (ndUnsigned32(left->m_indexCount), ndUnsigned32(left->m_indexMap));
+				aabbNode.m_right = (right->m_enumeration >= 0) ? ndNode::ndLeafNodePtr (ndUnsigned32 (right->m_enumeration)) : ndNode::ndLeafNodePtr (ndUnsigned32(right->m_indexCount), ndUnsigned32(right->m_indexMap));
+
+				const ndInt32 vertexIndex = node->m_enumeration * 2;
+				aabbPoints[vertexIndex + 0] = node->m_p0;
+				aabbPoints[vertexIndex + 1] = node->m_p1;
+
+				aabbNode.m_indexBox0 = aabbBase + vertexIndex;
+				aabbNode.m_indexBox1 = aabbBase + vertexIndex + 1;
+			}
+			else
+			{
+				ndAssert (!node->m_left);
+				ndAssert (!node->m_right);
+
+				// index format i0, i1, i2, ... , id, normal, e0Normal, e1Normal, e2Normal, ..., faceSize
+				const ndInt32 indexMap = node->m_indexMap;
+				for (ndInt32 j = 0; j < node->m_indexCount; ++j) 
 				{
-					ndAssert (node->m_parent->m_right == node);
-					m_aabb[node->m_parent->m_enumeration].m_right = ndNode::ndLeafNodePtr (ndUnsigned32 (&m_aabb[node->m_enumeration] - m_aabb));
+					m_indices[indexMap + j] = node->m_faceIndices[j];
+					m_indices[indexMap + j + node->m_indexCount + 2] = D_CONCAVE_EDGE_MASK | 0xffffffff;
 				}
+
+				// face attribute
+				m_indices[indexMap + node->m_indexCount] = node->m_faceIndices[node->m_indexCount];
+				// face normal
+				m_indices[indexMap + node->m_indexCount + 1] = builder.m_vertexPoints.GetCount() + builder.m_normalIndex[node->m_faceIndex];
+				// face size
+				ndFloat32 faceMaxDiag = CalculateFaceMaxDiagonal(&tmpVertexArray[0], node->m_indexCount, node->m_faceIndices);
+				ndInt32 quantizedDiagSize = ndInt32(ndFloor(faceMaxDiag / D_FACE_CLIP_DIAGONAL_SCALE + ndFloat32(1.0f)));
+				m_indices[indexMap + node->m_indexCount * 2 + 2] = quantizedDiagSize;
 			}
+		}
+	});
+	ndParallelExecute(threadPool, EmitNodes);
 
-			aabbPoints[vertexIndex + 0] = node->m_p0;
-			aabbPoints[vertexIndex + 1] = node->m_p1;
+	const ndInt32 vertexIndex = nodeIndex * 2;
+	ndStack<ndInt32> indexArrayPool (vertexIndex);
+	ndInt32* const indexArray = &indexArrayPool[0];
+	ndInt32 aabbPointCount = ndVertexListToIndexList (&aabbPoints[0].m_x, sizeof (ndVector), 3, vertexIndex, &indexArray[0], ndFloat32 (1.0e-6f));
 
-			aabbNode.m_indexBox0 = aabbBase + vertexIndex;
-			aabbNode.m_indexBox1 = aabbBase + vertexIndex + 1;
+	m_vertexCount = aabbBase + aabbPointCount;
+	m_localVertex = (ndFloat32*) ndMemory::Malloc (sizeof (ndTriplex) * m_vertexCount);
 
-			vertexIndex += 2;
+	ndTriplex* const dstPoints = (ndTriplex*)m_localVertex;
+	auto CopyVertex = ndMakeObject::ndFunction([this, dstPoints, tmpVertexArray, indexArray, aabbBase](ndInt32 threadIndex, ndInt32 threadCount)
+	{
+		D_TRACKTIME_NAMED(CopyVertex);
+		const ndStartEnd vertexStartEnd(m_vertexCount, threadIndex, threadCount);
+		for (ndInt32 i = vertexStartEnd.m_start; i < vertexStartEnd.m_end; ++i) 
+		{
+			dstPoints[i].m_x = tmpVertexArray[i].m_x;
+			dstPoints[i].m_y = tmpVertexArray[i].m_y;
+			dstPoints[i].m_z = tmpVertexArray[i].m_z;
 		}
-		else
+
+		const ndStartEnd nodeStartEnd(m_nodesCount, threadIndex, threadCount);
+		for (ndInt32 i = nodeStartEnd.m_start; i < nodeStartEnd.m_end; ++i) 
 		{
-			ndAssert (!node->m_left);
-			ndAssert (!node->m_right);
+			ndNode& box = m_aabb[i];
+
+			ndInt32 j = box.m_indexBox0 - aabbBase;
+			box.m_indexBox0 = indexArray[j] + aabbBase;
+
+			j = box.m_indexBox1 - aabbBase;
+			box.m_indexBox1 = indexArray[j] + aabbBase;
+		}
+	});
+	ndParallelExecute(threadPool, CopyVertex);
+
+	if (builder.m_faceVertexCount.GetCount() == 1) 
+	{
+		m_aabb[0].m_right = ndNode::ndLeafNodePtr (0, 0);
+	}
+
+	BuildWideTree();
+}
+
+void ndAabbPolygonSoup::BuildWideTree()
+{
+	if (m_wideNodes)
+	{
+		ndMemory::Free(m_wideNodes);
+		m_wideNodes = nullptr;
+		m_wideNodesCount = 0;
+	}
+	if (!m_aabb)
+	{
+		return;
+	}
+
+	// each wide node absorbs at least one binary node
+	const ndTriplex* const vertexArray = (ndTriplex*)m_localVertex;
+	ndWideNode* const wideNodes = (ndWideNode*)ndMemory::Malloc(sizeof(ndWideNode) * m_nodesCount);
+	ndStack<ndInt32> pending(m_nodesCount * 2 + 2);
 
-			if (node->m_parent)
+	ndInt32 stack = 1;
+	ndInt32 wideCount = 1;
+	pending[0] = 0;
+	pending[1] = 0;
+	while (stack)
+	{
+		stack--;
+		const ndNode& binaryNode = m_aabb[pending[stack * 2]];
+		ndWideNode& wideNode = wideNodes[pending[stack * 2 + 1]];
+
+		// open the internal child with the largest box until the node has four children, 
+		// the nodes of a top down tree get smaller with depth, so this collapses about two levels.
+		ndInt32 count = 2;
+		const ndNode::ndLeafNodePtr* children[4];
+		children[0] = &binaryNode.m_left;
+		children[1] = &binaryNode.m_right;
+		while (count < 4)
+		{
+			ndInt32 index = -1;
+			ndFloat32 maxArea = ndFloat32(-1.0f);
+			for (ndInt32 i = 0; i < count; ++i)
 			{
-				if (node->m_parent->m_left == node)
+				if (!children[i]->IsLeaf())
 				{
-					m_aabb[node->m_parent->m_enumeration].m_left = ndNode::ndLeafNodePtr (ndUnsigned32(node->m_indexCount), ndUnsigned32(indexMap));
-				}
-				else 
-				{
-					ndAssert (node->m_parent->m_right == node);
-					m_aabb[node->m_parent->m_enumeration].m_right = ndNode::ndLeafNodePtr (ndUnsigned32(node->m_indexCount), ndUnsigned32(indexMap));
+					const ndNode* const node = children[i]->GetNode(m_aabb);
+					const ndVector p0(ndVector(&vertexArray[node->m_indexBox0].m_x) & ndVector::m_triplexMask);
+					const ndVector p1(ndVector(&vertexArray[node->m_indexBox1].m_x) & ndVector::m_triplexMask);
+					const ndVector size(p1 - p0);
+					const ndFloat32 area = size.DotProduct(size.ShiftTripleRight()).GetScalar();
+					if (area > maxArea)
+					{
+						index = i;
+						maxArea = area;
+					}
 				}
 			}
-
-			// index format i0, i1, i2, ... , id, normal, e0Normal, e1Normal, e2Normal, ..., faceSize
-			for (ndInt32 j = 0; j < node->m_indexCount; ++j) 
+			if (index < 0)
 			{
-				m_indices[indexMap + j] = node->m_faceIndices[j];
-				m_indices[indexMap + j + node->m_indexCount + 2] = D_CONCAVE_EDGE_MASK | 0xffffffff;
+				break;
 			}
-
-			// face attribute
-			m_indices[indexMap + node->m_indexCount] = node->m_faceIndices[node->m_indexCount];
-			// face normal
-			m_indices[indexMap + node->m_indexCount + 1] = builder.m_vertexPoints.GetCount() + builder.m_normalIndex[node->m_faceIndex];
-			// face size
-			ndFloat32 faceMaxDiag = CalculateFaceMaxDiagonal(&tmpVertexArray[0], node->m_indexCount, node->m_faceIndices);
-			ndInt32 quantizedDiagSize = ndInt32(ndFloor(faceMaxDiag / D_FACE_CLIP_DIAGONAL_SCALE + ndFloat32(1.0f)));
-			m_indices[indexMap + node->m_indexCount * 2 + 2] = quantizedDiagSize;
-
-			indexMap += node->m_indexCount * 2 + 3;
+			const ndNode* const node = children[index]->GetNode(m_aabb);
+			children[index] = &node->m_left;
+			children[count] = &node->m_right;
+			count++;
 		}
 
-		if (node->m_left) 
+		for (ndInt32 i = 0; i < 4; ++i)
 		{
-			ndAssert (node->m_right);
-			list.Append(node->m_left);
-			list.Append(node->m_right);
+			ndVector p0(D_WIDE_NODE_EMPTY_BOX);
+			ndVector p1(D_WIDE_NODE_EMPTY_BOX);
+			wideNode.m_child[i] = ndNode::ndLeafNodePtr(0, 0);
+			if (i < count)
+			{
+				const ndNode::ndLeafNodePtr& child = *children[i];
+				if (child.IsLeaf())
+				{
+					const ndInt32 vCount = ndInt32(child.GetCount());
+					if (vCount > 0)
+					{
+						// the box of a face is padded, so that the faces touching
+						// a ray or a box are never rejected by round off.
+						const ndInt32* const indices = &m_indices[child.GetIndex()];
+						p0 = ndVector(&vertexArray[indices[0]].m_x) & ndVector::m_triplexMask;
+						p1 = p0;
+						for (ndInt32 j = 1; j < vCount; ++j)
+						{
+							const ndVector p(ndVector(&vertexArray[indices[j]].m_x) & ndVector::m_triplexMask);
+							p0 = p0.GetMin(p);
+							p1 = p1.GetMax(p);
+						}
+						const ndVector size(p1 - p0);
+						const ndVector padding(ndMax(size.GetMax().GetScalar() * D_WIDE_NODE_FACE_PADDING, D_WIDE_NODE_FACE_MIN_PADDING));
+						p0 -= padding;
+						p1 += padding;
+						wideNode.m_child[i] = child;
+					}
+				}
+				else
+				{
+					const ndNode* const node = child.GetNode(m_aabb);
+					p0 = ndVector(&vertexArray[node->m_indexBox0].m_x) & ndVector::m_triplexMask;
+					p1 = ndVector(&vertexArray[node->m_indexBox1].m_x) & ndVector::m_triplexMask;
+
+					ndAssert(wideCount < m_nodesCount);
+					wideNode.m_child[i] = ndNode::ndLeafNodePtr(ndUnsigned32(wideCount));
+					pending[stack * 2] = ndInt32(node - m_aabb);
+					pending[stack * 2 + 1] = wideCount;
+					wideCount++;
+					stack++;
+				}
+			}
+			wideNode.m_minX[i] = p0.m_x;
+			wideNode.m_minY[i] = p0.m_y;
+			wideNode.m_minZ[i] = p0.m_z;
+			wideNode.m_maxX[i] = p1.m_x;
+			wideNode.m_maxY[i] = p1.m_y;
+			wideNode.m_maxZ[i] = p1.m_z;
 		}
 	}
 
-	ndStack<ndInt32> indexArray (vertexIndex);
-	ndInt32 aabbPointCount = ndVertexListToIndexList (&aabbPoints[0].m_x, sizeof (ndVector), 3, vertexIndex, &indexArray[0], ndFloat32 (1.0e-6f));
-
-	m_vertexCount = aabbBase + aabbPointCount;
-	m_localVertex = (ndFloat32*) ndMemory::Malloc (sizeof (ndTriplex) * m_vertexCount);
+	m_wideNodesCount = wideCount;
+	m_wideNodes = (ndWideNode*)ndMemory::Malloc(sizeof(ndWideNode) * m_wideNodesCount);
+	ndMemCpy(m_wideNodes, wideNodes, m_wideNodesCount);
+	ndMemory::Free(wideNodes);
+}
 
-	ndTriplex* const dstPoints = (ndTriplex*)m_localVertex;
-	for (ndInt32 i = 0; i < m_vertexCount; ++i) 
+void ndAabbPolygonSoup::Serialize (const char* const path) const
+{
+	FILE* const file = fopen(path, "wb");
+	if (file)
 	{
-		dstPoints[i].m_x = tmpVertexArray[i].m_x;
-		dstPoints[i].m_y = tmpVertexArray[i].m_y;
-		dstPoints[i].m_z = tmpVertexArray[i].m_z;
+		ndFileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.m_magic, D_SOUP_FILE_MAGIC, sizeof(header.m_magic));
+		header.m_version = D_SOUP_FILE_VERSION;
+		header.m_endianTag = D_SOUP_FILE_ENDIAN_TAG;
+		header.m_vertexSize = sizeof(ndTriplex);
+		header.m_nodeSize = sizeof(ndNode);
+		header.m_wideNodeSize = sizeof(ndWideNode);
+		if (m_aabb)
+		{
+			header.m_vertexCount = m_vertexCount;
+			header.m_indexCount = m_indexCount;
+			header.m_nodesCount = m_nodesCount;
+			header.m_wideNodesCount = m_wideNodesCount;
+		}
+		header.m_vertexOffset = ndSoupFileAlign(sizeof(header));
+		header.m_indexOffset = ndSoupFileAlign(header.m_vertexOffset + sizeof(ndTriplex) * ndUnsigned64(header.m_vertexCount));
+		header.m_nodeOffset = ndSoupFileAlign(header.m_indexOffset + sizeof(ndInt32) * ndUnsigned64(header.m_indexCount));
+		header.m_wideNodeOffset = ndSoupFileAlign(header.m_nodeOffset + sizeof(ndNode) * ndUnsigned64(header.m_nodesCount));
+		header.m_fileSize = header.m_wideNodeOffset + sizeof(ndWideNode) * ndUnsigned64(header.m_wideNodesCount);
+
+		fwrite(&header, sizeof(header), 1, file);
+
+		const char padding[D_SOUP_FILE_ALIGNMENT] = {};
+		const void* const arrays[] = { m_localVertex, m_indices, m_aabb, m_wideNodes };
+		const ndUnsigned64 offsets[] = { header.m_vertexOffset, header.m_indexOffset, header.m_nodeOffset, header.m_wideNodeOffset };
+		const ndUnsigned64 sizes[] = 
+		{ 
+			sizeof(ndTriplex) * ndUnsigned64(header.m_vertexCount), 
+			sizeof(ndInt32) * ndUnsigned64(header.m_indexCount), 
+			sizeof(ndNode) * ndUnsigned64(header.m_nodesCount), 
+			sizeof(ndWideNode) * ndUnsigned64(header.m_wideNodesCount) 
+		};
+
+		ndUnsigned64 position = sizeof(header);
+		for (ndInt32 i = 0; i < 4; ++i)
+		{
+			fwrite(padding, size_t(offsets[i] - position), 1, file);
+			if (sizes[i])
+			{
+				fwrite(arrays[i], size_t(sizes[i]), 1, file);
+			}
+			position = offsets[i] + sizes[i];
+		}
+		fclose(file);
 	}
+}
+void ndAabbPolygonSoup::Deserialize (const char* const path)
+{
+	ReleaseData();
+	m_strideInBytes = sizeof(ndTriplex);
 
-	for (ndInt32 i = 0; i < m_nodesCount; ++i) 
+	ndMemoryMappedFile* const mappedFile = new ndMemoryMappedFile();
+	if (!mappedFile->Open(path))
 	{
-		ndNode& box = m_aabb[i];
+		delete mappedFile;
+		return;
+	}
 
-		ndInt32 j = box.m_indexBox0 - aabbBase;
-		box.m_indexBox0 = indexArray[j] + aabbBase;
+	const ndFileHeader& header = *((ndFileHeader*)mappedFile->GetData());
+	if ((mappedFile->GetSize() < sizeof(ndFileHeader)) || memcmp(header.m_magic, D_SOUP_FILE_MAGIC, sizeof(header.m_magic)))
+	{
+		delete mappedFile;
+		DeserializeLegacy(path);
+		return;
+	}
 
-		j = box.m_indexBox1 - aabbBase;
-		box.m_indexBox1 = indexArray[j] + aabbBase;
+	if (header.m_endianTag != D_SOUP_FILE_ENDIAN_TAG)
+	{
+		ndTrace(("%s: the polygon soup was saved with a different byte order\n", path));
+		delete mappedFile;
+		return;
+	}
+	if (header.m_version != D_SOUP_FILE_VERSION)
+	{
+		ndTrace(("%s: unsupported polygon soup version %d\n", path, header.m_version));
+		delete mappedFile;
+		return;
+	}
+	if ((header.m_vertexSize != sizeof(ndTriplex)) || (header.m_nodeSize != sizeof(ndNode)) || (header.m_wideNodeSize != sizeof(ndWideNode)))
+	{
+		ndTrace(("%s: the polygon soup was saved by a build with a different precision\n", path));
+		delete mappedFile;
+		return;
 	}
 
-	if (builder.m_faceVertexCount.GetCount() == 1) 
+	if (header.m_fileSize != ndUnsigned64(mappedFile->GetSize()))
 	{
-		m_aabb[0].m_right = ndNode::ndLeafNodePtr (0, 0);
+		ndTrace(("%s: the polygon soup file is truncated or corrupted\n", path));
+		delete mappedFile;
+		return;
 	}
-}
 
-void ndAabbPolygonSoup::Serialize (const char* const path) const
-{
-	FILE* const file = fopen(path, "wb");
-	if (file)
+	const ndUnsigned64 offsets[] = { header.m_vertexOffset, header.m_indexOffset, header.m_nodeOffset, header.m_wideNodeOffset };
+	const ndInt32 counts[] = { header.m_vertexCount, header.m_indexCount, header.m_nodesCount, header.m_wideNodesCount };
+	const ndUnsigned64 sizes[] = { sizeof(ndTriplex), sizeof(ndInt32), sizeof(ndNode), sizeof(ndWideNode) };
+	for (ndInt32 i = 0; i < 4; ++i)
 	{
-		fwrite(&m_vertexCount, sizeof(ndInt32), 1, file);
-		fwrite(&m_indexCount, sizeof(ndInt32), 1, file);
-		fwrite(&m_nodesCount, sizeof(ndInt32), 1, file);
-		if (m_aabb)
+		const bool aligned = (offsets[i] % D_SOUP_FILE_ALIGNMENT) == 0;
+		const bool inFile = (counts[i] >= 0) && ((offsets[i] + sizes[i] * ndUnsigned64(counts[i])) <= ndUnsigned64(mappedFile->GetSize()));
+		if (!(aligned && inFile))
 		{
-			fwrite(m_localVertex, sizeof(ndTriplex) * m_vertexCount, 1, file);
-			fwrite(m_indices, sizeof(ndInt32) * m_indexCount, 1, file);
-			fwrite(m_aabb, sizeof(ndNode) * m_nodesCount, 1, file);
+			ndTrace(("%s: the polygon soup file is truncated or corrupted\n", path));
+			delete mappedFile;
+			return;
 		}
-		fclose(file);
+	}
+
+	if (header.m_vertexCount)
+	{
+		char* const data = (char*)mappedFile->GetData();
+		m_mappedFile = mappedFile;
+		m_vertexCount = header.m_vertexCount;
+		m_indexCount = header.m_indexCount;
+		m_nodesCount = header.m_nodesCount;
+		m_wideNodesCount = header.m_wideNodesCount;
+		m_localVertex = (ndFloat32*)&data[header.m_vertexOffset];
+		m_indices = (ndInt32*)&data[header.m_indexOffset];
+		m_aabb = (ndNode*)&data[header.m_nodeOffset];
+		m_wideNodes = m_wideNodesCount ? (ndWideNode*)&data[header.m_wideNodeOffset] : nullptr;
+	}
+	else
+	{
+		delete mappedFile;
 	}
 }
 
-void ndAabbPolygonSoup::Deserialize (const char* const path)
+void ndAabbPolygonSoup::DeserializeLegacy(const char* const path)
 {
 	FILE* const file = fopen(path, "rb");
 	if (file)
@@ -814,6 +1314,7 @@ void ndAabbPolygonSoup::Deserialize (const char* const path)
 		}
 
 		fclose(file);
+		BuildWideTree();
 	}
 }
 
@@ -967,102 +1468,251 @@ ndVector ndAabbPolygonSoup::ForAllSectorsSupportVertex (const ndVector& dir) con
 
 void ndAabbPolygonSoup::ForAllSectorsRayHit (const ndFastRay& raySrc, ndFloat32 maxParam, ndRayIntersectCallback callback, void* const context) const
 {
-	const ndNode *stackPool[DG_STACK_DEPTH];
-	ndFloat32 distance[DG_STACK_DEPTH];
-	ndFastRay ray (raySrc);
+	if (!m_wideNodes)
+	{
+		return;
+	}
 
-	ndInt32 stack = 1;
+	ndFastRay ray (raySrc);
 	const ndTriplex* const vertexArray = (ndTriplex*) m_localVertex;
 
-	stackPool[0] = m_aabb;
-	distance[0] = m_aabb->RayDistance(ray, vertexArray);
+	const ndVector p0X(ray.m_p0.m_x);
+	const ndVector p0Y(ray.m_p0.m_y);
+	const ndVector p0Z(ray.m_p0.m_z);
+	const ndVector invDirX(ray.m_dpInv.m_x);
+	const ndVector invDirY(ray.m_dpInv.m_y);
+	const ndVector invDirZ(ray.m_dpInv.m_z);
+	const ndInt32 parallel = ray.m_isParallel.GetSignMask();
+	const ndVector maxDist(ndFloat32(1.2f));
+
+	ndFloat32 distance[DG_WIDE_STACK_DEPTH];
+	const ndNode::ndLeafNodePtr* stackPool[DG_WIDE_STACK_DEPTH];
+
+	const ndNode::ndLeafNodePtr root(0);
+	ndInt32 stack = 1;
+	stackPool[0] = &root;
+	distance[0] = ndFloat32(0.0f);
 	while (stack) 
 	{
 		stack --;
-		ndFloat32 dist = distance[stack];
-		if (dist > maxParam) 
+		if (distance[stack] > maxParam)
 		{
-			break;
-		} 
-		else 
+			continue;
+		}
+
+		const ndNode::ndLeafNodePtr& entry = *stackPool[stack];
+		if (entry.IsLeaf())
 		{
-			const ndNode *const me = stackPool[stack];
-			if (me->m_left.IsLeaf()) 
+			ndInt32 vCount = ndInt32 (entry.GetCount());
+			ndAssert(vCount > 0);
+			ndInt32 index = ndInt32 (entry.GetIndex());
+			ndFloat32 param = callback(context, &vertexArray[0].m_x, sizeof (ndTriplex), &m_indices[index], vCount);
+			ndAssert (param >= ndFloat32 (0.0f));
+			if (param < maxParam) 
 			{
-				ndInt32 vCount = ndInt32 (me->m_left.GetCount());
-				if (vCount > 0) 
+				maxParam = param;
+				if (maxParam == ndFloat32 (0.0f)) 
 				{
-					ndInt32 index = ndInt32 (me->m_left.GetIndex());
-					ndFloat32 param = callback(context, &vertexArray[0].m_x, sizeof (ndTriplex), &m_indices[index], vCount);
-					ndAssert (param >= ndFloat32 (0.0f));
-					if (param < maxParam) 
-					{
-						maxParam = param;
-						if (maxParam == ndFloat32 (0.0f)) 
-						{
-							break;
-						}
-					}
+					break;
 				}
-
-			} 
-			else 
+			}
+		}
+		else
+		{
+			// slab test of the ray against the four child boxes
+			const ndWideNode& node = m_wideNodes[entry.m_node];
+			ndVector t0(ray.m_minT);
+			ndVector t1(ray.m_maxT);
+			ndVector inside(ndVector::m_xyzwMask);
+			if (parallel & 1)
 			{
-				const ndNode* const node = me->m_left.GetNode(m_aabb);
-				ndFloat32 dist1 = node->RayDistance(ray, vertexArray);
-				if (dist1 < maxParam) 
+				inside = inside & (node.m_minX < p0X) & (node.m_maxX > p0X);
+			}
+			else
+			{
+				const ndVector tt0(invDirX * (node.m_minX - p0X));
+				const ndVector tt1(invDirX * (node.m_maxX - p0X));
+				t0 = t0.GetMax(tt0.GetMin(tt1));
+				t1 = t1.GetMin(tt0.GetMax(tt1));
+			}
+			if (parallel & 2)
+			{
+				inside = inside & (node.m_minY < p0Y) & (node.m_maxY > p0Y);
+			}
+			else
+			{
+				const ndVector tt0(invDirY * (node.m_minY - p0Y));
+				const ndVector tt1(invDirY * (node.m_maxY - p0Y));
+				t0 = t0.GetMax(tt0.GetMin(tt1));
+				t1 = t1.GetMin(tt0.GetMax(tt1));
+			}
+			if (parallel & 4)
+			{
+				inside = inside & (node.m_minZ < p0Z) & (node.m_maxZ > p0Z);
+			}
+			else
+			{
+				const ndVector tt0(invDirZ * (node.m_minZ - p0Z));
+				const ndVector tt1(invDirZ * (node.m_maxZ - p0Z));
+				t0 = t0.GetMax(tt0.GetMin(tt1));
+				t1 = t1.GetMin(tt0.GetMax(tt1));
+			}
+			const ndVector hit(inside & (t0 < t1));
+			const ndVector dist(maxDist.Select(t0, hit));
+			const ndInt32 hitMask = hit.GetSignMask();
+
+			// sort the children far to near and push them in that order, so that the nearest is visited first
+			ndInt32 count = 0;
+			ndInt32 order[4];
+			for (ndInt32 i = 0; i < 4; ++i)
+			{
+				if ((hitMask & (1 << i)) && (dist[i] < maxParam))
 				{
-					ndInt32 j = stack;
-					for ( ; j && (dist1 > distance[j - 1]); j --) 
+					ndInt32 j = count;
+					for (; j && (dist[i] > dist[order[j - 1]]); --j)
 					{
-						stackPool[j] = stackPool[j - 1];
-						distance[j] = distance[j - 1];
+						order[j] = order[j - 1];
 					}
-					ndAssert (stack < DG_STACK_DEPTH);
-					stackPool[j] = node;
-					distance[j] = dist1;
-					stack++;
+					order[j] = i;
+					count++;
 				}
 			}
+			ndAssert((stack + count) <= DG_WIDE_STACK_DEPTH);
+			for (ndInt32 i = 0; i < count; ++i)
+			{
+				stackPool[stack] = &node.m_child[order[i]];
+				distance[stack] = dist[order[i]];
+				stack++;
+			}
+		}
+	}
+}
+
+void ndAabbPolygonSoup::ForAllSectorsWide(const ndFastAabb& obbAabbInfo, ndAaabbIntersectCallback callback, void* const context) const
+{
+	ndAssert(m_wideNodes);
+	const ndInt32 stride = sizeof (ndTriplex) / sizeof (ndFloat32);
+	const ndTriplex* const vertexArray = (ndTriplex*) m_localVertex;
 
-			if (me->m_right.IsLeaf()) 
+	// the box and the obb of the query, one component per vector
+	const ndVector boxP0X(obbAabbInfo.m_p0.m_x);
+	const ndVector boxP0Y(obbAabbInfo.m_p0.m_y);
+	const ndVector boxP0Z(obbAabbInfo.m_p0.m_z);
+	const ndVector boxP1X(obbAabbInfo.m_p1.m_x);
+	const ndVector boxP1Y(obbAabbInfo.m_p1.m_y);
+	const ndVector boxP1Z(obbAabbInfo.m_p1.m_z);
+
+	const ndVector positX(obbAabbInfo.m_posit.m_x);
+	const ndVector positY(obbAabbInfo.m_posit.m_y);
+	const ndVector positZ(obbAabbInfo.m_posit.m_z);
+	const ndVector obbSizeX(obbAabbInfo.m_size.m_x);
+	const ndVector obbSizeY(obbAabbInfo.m_size.m_y);
+	const ndVector obbSizeZ(obbAabbInfo.m_size.m_z);
+
+	const ndVector dir00(obbAabbInfo[0][0]);
+	const ndVector dir01(obbAabbInfo[0][1]);
+	const ndVector dir02(obbAabbInfo[0][2]);
+	const ndVector dir10(obbAabbInfo[1][0]);
+	const ndVector dir11(obbAabbInfo[1][1]);
+	const ndVector dir12(obbAabbInfo[1][2]);
+	const ndVector dir20(obbAabbInfo[2][0]);
+	const ndVector dir21(obbAabbInfo[2][1]);
+	const ndVector dir22(obbAabbInfo[2][2]);
+
+	const ndVector absDir00(obbAabbInfo.m_absDir[0][0]);
+	const ndVector absDir01(obbAabbInfo.m_absDir[0][1]);
+	const ndVector absDir02(obbAabbInfo.m_absDir[0][2]);
+	const ndVector absDir10(obbAabbInfo.m_absDir[1][0]);
+	const ndVector absDir11(obbAabbInfo.m_absDir[1][1]);
+	const ndVector absDir12(obbAabbInfo.m_absDir[1][2]);
+	const ndVector absDir20(obbAabbInfo.m_absDir[2][0]);
+	const ndVector absDir21(obbAabbInfo.m_absDir[2][1]);
+	const ndVector absDir22(obbAabbInfo.m_absDir[2][2]);
+
+	ndFloat32 separationDistance = obbAabbInfo.m_separationDistance.GetScalar();
+	ndInt32 stackPool[DG_WIDE_STACK_DEPTH];
+
+	ndInt32 stack = 1;
+	stackPool[0] = 0;
+	while (stack)
+	{
+		stack--;
+		const ndWideNode& node = m_wideNodes[stackPool[stack]];
+
+		// penetration of the four child boxes with the aabb of the query, same as ndNode::BoxPenetration
+		const ndVector minBoxX(node.m_minX - boxP1X);
+		const ndVector minBoxY(node.m_minY - boxP1Y);
+		const ndVector minBoxZ(node.m_minZ - boxP1Z);
+		const ndVector maxBoxX(node.m_maxX - boxP0X);
+		const ndVector maxBoxY(node.m_maxY - boxP0Y);
+		const ndVector maxBoxZ(node.m_maxZ - boxP0Z);
+		ndVector dist(maxBoxX.GetMin(minBoxX * ndVector::m_negOne));
+		dist = dist.GetMin(maxBoxY.GetMin(minBoxY * ndVector::m_negOne));
+		dist = dist.GetMin(maxBoxZ.GetMin(minBoxZ * ndVector::m_negOne));
+
+		if ((dist > ndVector::m_zero).GetSignMask())
+		{
+			// the children overlapping the aabb are tested again in the space of the obb
+			const ndVector originX(ndVector::m_half * (node.m_maxX + node.m_minX) - positX);
+			const ndVector originY(ndVector::m_half * (node.m_maxY + node.m_minY) - positY);
+			const ndVector originZ(ndVector::m_half * (node.m_maxZ + node.m_minZ) - positZ);
+			const ndVector sizeX(ndVector::m_half * (node.m_maxX - node.m_minX));
+			const ndVector sizeY(ndVector::m_half * (node.m_maxY - node.m_minY));
+			const ndVector sizeZ(ndVector::m_half * (node.m_maxZ - node.m_minZ));
+
+			const ndVector localX(dir00 * originX + dir01 * originY + dir02 * originZ);
+			const ndVector localY(dir10 * originX + dir11 * originY + dir12 * originZ);
+			const ndVector localZ(dir20 * originX + dir21 * originY + dir22 * originZ);
+			const ndVector extendX(absDir00 * sizeX + absDir10 * sizeY + absDir20 * sizeZ + obbSizeX);
+			const ndVector extendY(absDir01 * sizeX + absDir11 * sizeY + absDir21 * sizeZ + obbSizeY);
+			const ndVector extendZ(absDir02 * sizeX + absDir12 * sizeY + absDir22 * sizeZ + obbSizeZ);
+			dist = dist.GetMin(extendX - localX.Abs());
+			dist = dist.GetMin(extendY - localY.Abs());
+			dist = dist.GetMin(extendZ - localZ.Abs());
+		}
+
+		for (ndInt32 i = 0; i < 4; ++i)
+		{
+			if (dist[i] > ndFloat32(0.0f))
 			{
-				ndInt32 vCount = ndInt32 (me->m_right.GetCount());
-				if (vCount > 0) 
+				const ndNode::ndLeafNodePtr& child = node.m_child[i];
+				if (child.IsLeaf())
 				{
-					ndInt32 index = ndInt32 (me->m_right.GetIndex());
-					ndFloat32 param = callback(context, &vertexArray[0].m_x, sizeof (ndTriplex), &m_indices[index], vCount);
-					ndAssert (param >= ndFloat32 (0.0f));
-					if (param < maxParam) 
+					const ndInt32 vCount = ndInt32(child.GetCount());
+					ndAssert(vCount >= 3);
+					const ndInt32* const indices = &m_indices[child.GetIndex()];
+					ndInt32 normalIndex = indices[vCount + 1];
+					ndVector faceNormal(&vertexArray[normalIndex].m_x);
+					faceNormal = faceNormal & ndVector::m_triplexMask;
+					ndFloat32 dist1 = obbAabbInfo.PolygonBoxDistance(faceNormal, vCount, indices, stride, &vertexArray[0].m_x);
+					if (dist1 > ndFloat32(0.0f))
 					{
-						maxParam = param;
-						if (maxParam == ndFloat32 (0.0f)) 
+						separationDistance = ndFloat32(0.0f);
+						if (callback(context, &vertexArray[0].m_x, sizeof(ndTriplex), indices, vCount, dist1) == m_stopSearch)
 						{
-							break;
+							obbAabbInfo.m_separationDistance = separationDistance;
+							return;
 						}
 					}
-				}
-			} 
-			else 
-			{
-				const ndNode* const node = me->m_right.GetNode(m_aabb);
-				ndFloat32 dist1 = node->RayDistance(ray, vertexArray);
-				if (dist1 < maxParam) 
-				{
-					ndInt32 j = stack;
-					for ( ; j && (dist1 > distance[j - 1]); j --) 
+					else
 					{
-						stackPool[j] = stackPool[j - 1];
-						distance[j] = distance[j - 1];
+						separationDistance = ndMin(separationDistance, -dist1);
 					}
-					ndAssert (stack < DG_STACK_DEPTH);
-					stackPool[j] = node;
-					distance[j] = dist1;
+				}
+				else
+				{
+					ndAssert(stack < DG_WIDE_STACK_DEPTH);
+					stackPool[stack] = ndInt32(child.m_node);
 					stack++;
 				}
 			}
+			else
+			{
+				separationDistance = ndMin(separationDistance, -dist[i]);
+			}
 		}
 	}
+	obbAabbInfo.m_separationDistance = separationDistance;
 }
 
 void ndAabbPolygonSoup::ForAllSectors (const ndFastAabb& obbAabbInfo, const ndVector& boxDistanceTravel, ndFloat32, ndAaabbIntersectCallback callback, void* const context) const
@@ -1086,119 +1736,7 @@ void ndAabbPolygonSoup::ForAllSectors (const ndFastAabb& obbAabbInfo, const ndVe
 		ndAssert (boxDistanceTravel.m_w == ndFloat32 (0.0f));
 		if (boxDistanceTravel.DotProduct(boxDistanceTravel).GetScalar() < ndFloat32 (1.0e-8f)) 
 		{
-			ndInt32 stack = 1;
-			stackPool[0] = m_aabb;
-			distance[0] = m_aabb->BoxPenetration(obbAabbInfo, vertexArray);
-			if (distance[0] <= ndFloat32(0.0f)) 
-			{
-				obbAabbInfo.m_separationDistance = ndMin(obbAabbInfo.m_separationDistance[0], -distance[0]);
-			}
-			while (stack) 
-			{
-				stack --;
-				ndFloat32 dist = distance[stack];
-				if (dist > ndFloat32 (0.0f)) 
-				{
-					const ndNode* const me = stackPool[stack];
-					if (me->m_left.IsLeaf()) 
-					{
-						ndInt32 index = ndInt32 (me->m_left.GetIndex());
-						ndInt32 vCount = ndInt32 (me->m_left.GetCount());
-						if (vCount > 0) 
-						{
-							const ndInt32* const indices = &m_indices[index];
-							ndInt32 normalIndex = indices[vCount + 1];
-							ndVector faceNormal (&vertexArray[normalIndex].m_x);
-							faceNormal = faceNormal & ndVector::m_triplexMask;
-							ndFloat32 dist1 = obbAabbInfo.PolygonBoxDistance (faceNormal, vCount, indices, stride, &vertexArray[0].m_x);
-							if (dist1 > ndFloat32 (0.0f)) 
-							{
-								obbAabbInfo.m_separationDistance = ndFloat32(0.0f);
-								ndAssert (vCount >= 3);
-								if (callback(context, &vertexArray[0].m_x, sizeof (ndTriplex), indices, vCount, dist1) == m_stopSearch) 
-								{
-									return;
-								}
-							} 
-							else 
-							{
-								obbAabbInfo.m_separationDistance = ndMin(obbAabbInfo.m_separationDistance[0], -dist1);
-							}
-						}
-					} 
-					else 
-					{
-						const ndNode* const node = me->m_left.GetNode(m_aabb);
-						ndFloat32 dist1 = node->BoxPenetration(obbAabbInfo, vertexArray);
-						if (dist1 > ndFloat32 (0.0f)) 
-						{
-							ndInt32 j = stack;
-							for ( ; j && (dist1 > distance[j - 1]); j --) 
-							{
-								stackPool[j] = stackPool[j - 1];
-								distance[j] = distance[j - 1];
-							}
-							ndAssert (stack < DG_STACK_DEPTH);
-							stackPool[j] = node;
-							distance[j] = dist1;
-							stack++;
-						} 
-						else 
-						{
-							obbAabbInfo.m_separationDistance = ndMin(obbAabbInfo.m_separationDistance[0], -dist1);
-						}
-					}
-
-					if (me->m_right.IsLeaf()) 
-					{
-						ndInt32 index = ndInt32 (me->m_right.GetIndex());
-						ndInt32 vCount = ndInt32 (me->m_right.GetCount());
-						if (vCount > 0) 
-						{
-							const ndInt32* const indices = &m_indices[index];
-							ndInt32 normalIndex = indices[vCount + 1];
-							ndVector faceNormal (&vertexArray[normalIndex].m_x);
-							faceNormal = faceNormal & ndVector::m_triplexMask;
-							ndFloat32 dist1 = obbAabbInfo.PolygonBoxDistance (faceNormal, vCount, indices, stride, &vertexArray[0].m_x);
-							if (dist1 > ndFloat32 (0.0f)) 
-							{
-								ndAssert (vCount >= 3);
-								obbAabbInfo.m_separationDistance = ndFloat32(0.0f);
-								if (callback(context, &vertexArray[0].m_x, sizeof (ndTriplex), indices, vCount, dist1) == m_stopSearch) 
-								{
-									return;
-								}
-							} 
-							else 
-							{
-								obbAabbInfo.m_separationDistance = ndMin(obbAabbInfo.m_separationDistance[0], -dist1);
-							}
-						}
-					} 
-					else 
-					{
-						const ndNode* const node = me->m_right.GetNode(m_aabb);
-						ndFloat32 dist1 = node->BoxPenetration(obbAabbInfo, vertexArray);
-						if (dist1 > ndFloat32 (0.0f)) 
-						{
-							ndInt32 j = stack;
-							for ( ; j && (dist1 > distance[j - 1]); j --) 
-							{
-								stackPool[j] = stackPool[j - 1];
-								distance[j] = distance[j - 1];
-							}
-							ndAssert (stack < DG_STACK_DEPTH);
-							stackPool[j] = node;
-							distance[j] = dist1;
-							stack++;
-						} 
-						else 
-						{
-							obbAabbInfo.m_separationDistance = ndMin(obbAabbInfo.m_separationDistance[0], -dist1);
-						}
-					}
-				}
-			}
+			ForAllSectorsWide(obbAabbInfo, callback, context);
 		} 
 		else 
 		{
@@ -30,6 +30,8 @@
 #include "ndIntersections.h"
 #include "ndPolygonSoupDatabase.h"
 
+class ndThreadPool;
+class ndMemoryMappedFile;
 class ndPolygonSoupBuilder;
 
 // index format: i0, i1, i2, ... , id, normal, e0Normal, e1Normal, e2Normal, ..., faceSize
@@ -207,6 +209,24 @@ class ndAabbPolygonSoup: public ndPolygonSoupDatabase
 		ndLeafNodePtr m_right;
 	};
 
+	/// Four children of the binary tree collapsed into one node.
+	/// The child boxes are stored one component per vector, so that the
+	/// traversal tests all the children of a node with a few vector operations.
+	/// A child is either a face, with the box of the face, or another wide node.
+	/// Empty children are leaves with zero index count and a far away empty box.
+	D_MSV_NEWTON_ALIGN_32
+	class ndWideNode
+	{
+		public:
+		ndVector m_minX;
+		ndVector m_minY;
+		ndVector m_minZ;
+		ndVector m_maxX;
+		ndVector m_maxY;
+		ndVector m_maxZ;
+		ndNode::ndLeafNodePtr m_child[4];
+	} D_GCC_NEWTON_ALIGN_32;
+
 	class ndSplitInfo;
 	class ndNodeBuilder;
 
@@ -214,9 +234,18 @@ class ndAabbPolygonSoup: public ndPolygonSoupDatabase
 	D_CORE_API virtual void GetAABB (ndVector& p0, ndVector& p1) const;
 
 	/// writes the entire database to a binary file named path.
+	/// the file is a header followed by the vertex, index, node and wide node arrays
+	/// exactly as they are in memory, all references are indices, so that the file 
+	/// can be used in place from any address.
 	D_CORE_API virtual void Serialize (const char* const path) const;
 
 	/// Reads a previously saved database binary file named path.
+	/// the file is memory mapped and the database uses the arrays in place, 
+	/// so loading does not parse or copy the data and processes loading the 
+	/// same file share its pages. a file written by a build with a different 
+	/// byte order, version or precision, or whose size does not match the size 
+	/// saved in its header, is rejected and leaves the database empty.
+	/// files in the format of earlier versions are read into memory.
 	D_CORE_API virtual void Deserialize (const char* const path);
 
 	protected:
@@ -224,7 +253,23 @@ class ndAabbPolygonSoup: public ndPolygonSoupDatabase
 	D_CORE_API virtual ~ndAabbPolygonSoup ();
 
 	D_CORE_API void Create (const ndPolygonSoupBuilder& builder);
+
+	/// an edge gets the normal of its adjacent face only when exactly two faces
+	/// share it, in opposite directions. the edges shared by three or more faces,
+	/// or by two faces with the same winding, are left open, the other edges
+	/// of those faces are still matched.
 	D_CORE_API void CalculateAdjacent ();
+
+	/// same as Create and CalculateAdjacent, with the leaf setup, the top down split,
+	/// the node layout and the edge matching distributed over the threads of threadPool.
+	/// the resulting database is identical to the one built on a single thread.
+	/// threadPool must be idle, a world scene can only be used outside its update.
+	D_CORE_API void Create (const ndPolygonSoupBuilder& builder, ndThreadPool& threadPool);
+	D_CORE_API void CalculateAdjacent (ndThreadPool& threadPool);
+
+	/// number of triangles of the faces of the mesh, from the leaves of the hierarchy.
+	D_CORE_API ndInt32 CalculateTriangleCount() const;
+
 	D_CORE_API virtual ndVector ForAllSectorsSupportVertex(const ndVector& dir) const;
 	D_CORE_API virtual void ForAllSectorsRayHit (const ndFastRay& ray, ndFloat32 maxT, ndRayIntersectCallback callback, void* const context) const;
 	D_CORE_API virtual void ForAllSectors (const ndFastAabb& obbAabb, const ndVector& boxDistanceTravel, ndFloat32 maxT, ndAaabbIntersectCallback callback, void* const context) const;
@@ -261,14 +306,27 @@ class ndAabbPolygonSoup: public ndPolygonSoupDatabase
 	}
 
 	private:
-	ndNodeBuilder* BuildTopDown (ndNodeBuilder* const leafArray, ndInt32 firstBox, ndInt32 lastBox, ndNodeBuilder** const allocator) const;
+	class ndAdjacentEdge;
+	class ndAdjacentEdgeKey;
+	class ndFileHeader;
+
+	void ReleaseData();
+	void BuildWideTree();
+	void DeserializeLegacy(const char* const path);
+	void BuildDatabase (const ndPolygonSoupBuilder& builder, ndThreadPool* const threadPool);
+	void BuildAdjacency (ndThreadPool* const threadPool);
+	void ForAllSectorsWide(const ndFastAabb& obbAabb, ndAaabbIntersectCallback callback, void* const context) const;
+	ndNodeBuilder* BuildTopDown (ndNodeBuilder* const leafArray, ndInt32 firstBox, ndInt32 lastBox, ndNodeBuilder* const nodeArray) const;
+	ndNodeBuilder* BuildTopDown (ndNodeBuilder* const leafArray, ndInt32 firstBox, ndInt32 lastBox, ndNodeBuilder* const nodeArray, ndThreadPool* const threadPool) const;
 	ndFloat32 CalculateFaceMaxDiagonal (const ndVector* const vertex, ndInt32 indexCount, const ndInt32* const indexArray) const;
-	static ndIntersectStatus CalculateAllFaceEdgeNormals(void* const context, const ndFloat32* const polygon, ndInt32 strideInBytes, const ndInt32* const indexArray, ndInt32 indexCount, ndFloat32 hitDistance);
 	
 	ndNode* m_aabb;
+	ndWideNode* m_wideNodes;
 	ndInt32* m_indices;
+	ndMemoryMappedFile* m_mappedFile;
 	ndInt32 m_nodesCount;
 	ndInt32 m_indexCount;
+	ndInt32 m_wideNodesCount;
 	friend class ndContactSolver;
 };
 
@@ -192,14 +192,27 @@ void ndFreeListAlloc::Flush()
 
 void* ndFreeListAlloc::operator new (size_t size)
 {
+	if (ndMemory::IsThreadLocalAllocator())
+	{
+		// the thread local allocator already recycles blocks 
+		// per thread, the global free list will only add contention.
+		return ndMemory::Malloc(size);
+	}
 	ndFreeListDictionary& dictionary = ndFreeListDictionary::GetHeader();
 	return dictionary.Malloc(ndInt32 (size));
 }
 
 void ndFreeListAlloc::operator delete (void* ptr)
 {
-	ndFreeListDictionary& dictionary = ndFreeListDictionary::GetHeader();
-	dictionary.Free(ptr);
+	if (ndMemory::IsThreadLocalAllocator())
+	{
+		ndMemory::Free(ptr);
+	}
+	else
+	{
+		ndFreeListDictionary& dictionary = ndFreeListDictionary::GetHeader();
+		dictionary.Free(ptr);
+	}
 }
 
 void ndFreeListAlloc::Flush(ndInt32 size)
@@ -38,6 +38,7 @@
 #include <ndMatrix.h>
 #include <ndThread.h>
 #include <ndMemory.h>
+#include <ndSlabAllocator.h>
 #include <ndGoogol.h>
 #include <ndString.h>
 #include <ndFastRay.h>
@@ -47,6 +48,9 @@
 #include <ndSyncMutex.h>
 #include <ndSemaphore.h>
 #include <ndSharedPtr.h>
+#include <ndPerThreadArray.h>
+#include <ndFrameAllocator.h>
+#include <ndTaskGraph.h>
 #include <ndClassAlloc.h>
 #include <ndThreadPool.h>
 #include <ndIsoSurface.h>
@@ -69,6 +73,7 @@
 #include <ndContainersAlloc.h>
 #include <ndAabbPolygonSoup.h>
 #include <ndSmallDeterminant.h>
+#include <ndMemoryMappedFile.h>
 #include <ndConjugateGradient.h>
 #include <ndPolygonSoupBuilder.h>
 #include <ndPolygonSoupDatabase.h>
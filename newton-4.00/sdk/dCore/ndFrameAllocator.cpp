@@ -0,0 +1,114 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndCoreStdafx.h"
+#include "ndTypes.h"
+#include "ndUtils.h"
+#include "ndFrameAllocator.h"
+
+ndFrameAllocator::ndArena::ndArena()
+	:m_chunks()
+	,m_chunk(0)
+	,m_offset(0)
+{
+	ndChunk chunk;
+	chunk.m_size = D_FRAME_ALLOCATOR_CHUNK_SIZE;
+	chunk.m_buffer = (char*)ndMemory::Malloc(chunk.m_size);
+	m_chunks.PushBack(chunk);
+}
+
+ndFrameAllocator::ndArena::~ndArena()
+{
+	for (ndInt32 i = m_chunks.GetCount() - 1; i >= 0; --i)
+	{
+		ndMemory::Free(m_chunks[i].m_buffer);
+	}
+}
+
+void* ndFrameAllocator::ndArena::AllocChunk(size_t size)
+{
+	// the chunks after the current one are empty, they are reused if they are big enough.
+	const ndInt32 next = m_chunk + 1;
+	if ((next < m_chunks.GetCount()) && (m_chunks[next].m_size < size))
+	{
+		for (ndInt32 i = m_chunks.GetCount() - 1; i >= next; --i)
+		{
+			ndMemory::Free(m_chunks[i].m_buffer);
+		}
+		m_chunks.SetCount(next);
+	}
+
+	if (next == m_chunks.GetCount())
+	{
+		ndChunk chunk;
+		chunk.m_size = ndMax(size, m_chunks[m_chunk].m_size * 2);
+		chunk.m_buffer = (char*)ndMemory::Malloc(chunk.m_size);
+		m_chunks.PushBack(chunk);
+	}
+
+	m_chunk = next;
+	m_offset = size;
+	return m_chunks[next].m_buffer;
+}
+
+void ndFrameAllocator::ndArena::Reset()
+{
+	if (m_chunks.GetCount() > 1)
+	{
+		// the frame did not fit in one chunk, merge them all 
+		// so that the next frame does not need to allocate.
+		ndChunk chunk;
+		chunk.m_size = 0;
+		for (ndInt32 i = m_chunks.GetCount() - 1; i >= 0; --i)
+		{
+			chunk.m_size += m_chunks[i].m_size;
+			ndMemory::Free(m_chunks[i].m_buffer);
+		}
+		chunk.m_buffer = (char*)ndMemory::Malloc(chunk.m_size);
+		m_chunks.SetCount(0);
+		m_chunks.PushBack(chunk);
+	}
+	m_chunk = 0;
+	m_offset = 0;
+}
+
+ndFrameAllocator::ndFrameAllocator()
+	:ndClassAlloc()
+	,m_arenas()
+{
+}
+
+ndFrameAllocator::~ndFrameAllocator()
+{
+}
+
+void ndFrameAllocator::SetThreadCount(ndInt32 count)
+{
+	m_arenas.SetCount(count);
+}
+
+void ndFrameAllocator::Reset()
+{
+	for (ndInt32 i = m_arenas.GetCount() - 1; i >= 0; --i)
+	{
+		m_arenas[i].Reset();
+	}
+}
@@ -0,0 +1,175 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __ND_FRAME_ALLOCATOR_H_
+#define __ND_FRAME_ALLOCATOR_H_
+
+#include "ndCoreStdafx.h"
+#include "ndTypes.h"
+#include "ndMemory.h"
+#include "ndClassAlloc.h"
+#include "ndFixSizeArray.h"
+#include "ndPerThreadArray.h"
+
+#define D_FRAME_ALLOCATOR_CHUNK_SIZE	(64 * 1024)
+#define D_FRAME_ALLOCATOR_MAX_CHUNKS	32
+
+/// Linear allocator for temporary buffers that only live during one update.
+/// Each thread bumps a pointer in its own arena, so allocating is a few 
+/// instructions and requires no synchronization.
+/// Buffers are never freed individually, a stage takes a mark before 
+/// allocating and releases back to it when is done.
+/// When an arena runs out of space it chains a new chunk for the rest of the frame, 
+/// and Reset merges the chunks into a single one, so after the first few frames 
+/// a steady state simulation does not make any heap allocation.
+class ndFrameAllocator: public ndClassAlloc
+{
+	public:
+	class ndMark
+	{
+		public:
+		ndInt32 m_chunk;
+		size_t m_offset;
+	};
+
+	/// Release all the memory allocated by a thread after the scope was created.
+	/// a null allocator makes the scope do nothing.
+	class ndScope
+	{
+		public:
+		ndScope(ndFrameAllocator* const allocator, ndInt32 threadIndex);
+		~ndScope();
+
+		private:
+		ndFrameAllocator* m_allocator;
+		ndMark m_mark;
+		ndInt32 m_threadIndex;
+	};
+
+	D_CORE_API ndFrameAllocator();
+	D_CORE_API ~ndFrameAllocator();
+
+	ndInt32 GetThreadCount() const;
+	D_CORE_API void SetThreadCount(ndInt32 count);
+
+	/// Rewind all the arenas, must be called when no buffer is in use, usually at the start of a frame.
+	D_CORE_API void Reset();
+
+	/// Return a buffer aligned to D_MEMORY_ALIGMNET from the arena of the thread.
+	void* Alloc(ndInt32 threadIndex, size_t size);
+
+	template<class T>
+	T* Alloc(ndInt32 threadIndex, ndInt32 count);
+
+	ndMark GetMark(ndInt32 threadIndex) const;
+	void Release(ndInt32 threadIndex, const ndMark& mark);
+
+	private:
+	class ndChunk
+	{
+		public:
+		char* m_buffer;
+		size_t m_size;
+	};
+
+	class ndArena
+	{
+		public:
+		ndArena();
+		~ndArena();
+
+		void Reset();
+		void* Alloc(size_t size);
+		void* AllocChunk(size_t size);
+
+		ndFixSizeArray<ndChunk, D_FRAME_ALLOCATOR_MAX_CHUNKS> m_chunks;
+		ndInt32 m_chunk;
+		size_t m_offset;
+	};
+
+	ndPerThreadArray<ndArena> m_arenas;
+};
+
+inline ndInt32 ndFrameAllocator::GetThreadCount() const
+{
+	return m_arenas.GetCount();
+}
+
+inline void* ndFrameAllocator::ndArena::Alloc(size_t size)
+{
+	const size_t alignedSize = (size + D_MEMORY_ALIGMNET - 1) & ~size_t(D_MEMORY_ALIGMNET - 1);
+	const ndChunk& chunk = m_chunks[m_chunk];
+	if ((m_offset + alignedSize) <= chunk.m_size)
+	{
+		void* const ptr = &chunk.m_buffer[m_offset];
+		m_offset += alignedSize;
+		return ptr;
+	}
+	return AllocChunk(alignedSize);
+}
+
+inline void* ndFrameAllocator::Alloc(ndInt32 threadIndex, size_t size)
+{
+	return m_arenas[threadIndex].Alloc(size);
+}
+
+template<class T>
+inline T* ndFrameAllocator::Alloc(ndInt32 threadIndex, ndInt32 count)
+{
+	return (T*)m_arenas[threadIndex].Alloc(sizeof(T) * size_t(count));
+}
+
+inline ndFrameAllocator::ndMark ndFrameAllocator::GetMark(ndInt32 threadIndex) const
+{
+	const ndArena& arena = m_arenas[threadIndex];
+	ndMark mark;
+	mark.m_chunk = arena.m_chunk;
+	mark.m_offset = arena.m_offset;
+	return mark;
+}
+
+inline void ndFrameAllocator::Release(ndInt32 threadIndex, const ndMark& mark)
+{
+	ndArena& arena = m_arenas[threadIndex];
+	ndAssert((mark.m_chunk < arena.m_chunk) || ((mark.m_chunk == arena.m_chunk) && (mark.m_offset <= arena.m_offset)));
+	arena.m_chunk = mark.m_chunk;
+	arena.m_offset = mark.m_offset;
+}
+
+inline ndFrameAllocator::ndScope::ndScope(ndFrameAllocator* const allocator, ndInt32 threadIndex)
+	:m_allocator(allocator)
+	,m_threadIndex(threadIndex)
+{
+	if (m_allocator)
+	{
+		m_mark = m_allocator->GetMark(m_threadIndex);
+	}
+}
+
+inline ndFrameAllocator::ndScope::~ndScope()
+{
+	if (m_allocator)
+	{
+		m_allocator->Release(m_threadIndex, m_mark);
+	}
+}
+
+#endif
@@ -22,8 +22,14 @@
 #include "ndCoreStdafx.h"
 #include "ndTypes.h"
 #include "ndMemory.h"
+#include "ndSlabAllocator.h"
+
+// bytes a thread accumulates before merging them into the global counter.
+#define D_MEMORY_COUNTER_FLUSH	(64 * 1024)
 
 ndAtomic<ndUnsigned64> ndMemory::m_memoryUsed(0);
+bool ndMemory::m_threadLocalAllocator = false;
+ndMemory::ndAllocationMode ndMemory::m_allocationMode = ndMemory::m_defaultAllocation;
 
 static ndMemFreeCallback m_freeMemory = free;
 static ndMemAllocCallback m_allocMemory = malloc;
@@ -32,10 +38,37 @@ class ndMemoryHeader
 {
 	public:
 	void* m_ptr;
+	ndMemFreeCallback m_free;
 	ndUnsigned32 m_bufferSize;
 	ndUnsigned32 m_requestedSize;
 };
 
+class ndMemoryThreadCounter
+{
+	public:
+	ndMemoryThreadCounter()
+		:m_memoryUsed(0)
+		,m_allocations(0)
+	{
+	}
+
+	~ndMemoryThreadCounter()
+	{
+		Merge();
+	}
+
+	void Merge()
+	{
+		ndMemory::m_memoryUsed.fetch_add(ndUnsigned64(m_memoryUsed));
+		m_memoryUsed = 0;
+	}
+
+	ndInt64 m_memoryUsed;
+	ndUnsigned64 m_allocations;
+};
+
+static thread_local ndMemoryThreadCounter m_threadMemoryUsed;
+
 #define ndGetBufferPaddingInBytes size_t(D_MEMORY_ALIGMNET - 1 + sizeof (ndMemoryHeader))
 
 size_t ndMemory::CalculateBufferSize(size_t size)
@@ -55,9 +88,11 @@ void* ndMemory::Malloc(size_t size)
 	ndMemoryHeader* const info = ret - 1;
 	ndAssert((char*)info >= (char*)metToVal.m_ptr);
 	info->m_ptr = metToVal.m_ptr;
+	info->m_free = m_freeMemory;
 	info->m_bufferSize = ndUnsigned32 (bufferSize);
 	info->m_requestedSize = ndUnsigned32(size);
-	m_memoryUsed.fetch_add(bufferSize);
+	UpdateMemoryUsed(ndInt64(bufferSize));
+	m_threadMemoryUsed.m_allocations++;
 	return ret;
 }
 
@@ -66,8 +101,8 @@ void ndMemory::Free(void* const ptr)
 	if (ptr)
 	{
 		ndMemoryHeader* const info = ((ndMemoryHeader*)ptr) - 1;
-		m_memoryUsed.fetch_sub(ndUnsigned64(info->m_bufferSize));
-		m_freeMemory(info->m_ptr);
+		UpdateMemoryUsed(-ndInt64(info->m_bufferSize));
+		info->m_free(info->m_ptr);
 	}
 }
 
@@ -88,10 +123,37 @@ ndUnsigned64 ndMemory::GetMemoryUsed()
 	return m_memoryUsed.load();
 }
 
+void ndMemory::UpdateMemoryUsed(ndInt64 size)
+{
+	if (m_threadLocalAllocator)
+	{
+		m_threadMemoryUsed.m_memoryUsed += size;
+		if ((m_threadMemoryUsed.m_memoryUsed > D_MEMORY_COUNTER_FLUSH) || (m_threadMemoryUsed.m_memoryUsed < -D_MEMORY_COUNTER_FLUSH))
+		{
+			m_threadMemoryUsed.Merge();
+		}
+	}
+	else
+	{
+		m_memoryUsed.fetch_add(ndUnsigned64(size));
+	}
+}
+
+ndUnsigned64 ndMemory::GetThreadAllocationCount()
+{
+	return m_threadMemoryUsed.m_allocations;
+}
+
 void ndMemory::SetMemoryAllocators(ndMemAllocCallback alloc, ndMemFreeCallback free)
 {
 	m_freeMemory = free;
 	m_allocMemory = alloc;
+	m_threadLocalAllocator = (alloc == ndSlabAllocator::Malloc);
+}
+
+bool ndMemory::IsThreadLocalAllocator()
+{
+	return m_threadLocalAllocator;
 }
 
 void ndMemory::GetMemoryAllocators(ndMemAllocCallback& alloc, ndMemFreeCallback& free)
@@ -99,3 +161,13 @@ void ndMemory::GetMemoryAllocators(ndMemAllocCallback& alloc, ndMemFreeCallback&
 	free = m_freeMemory;
 	alloc = m_allocMemory;
 }
+
+ndMemory::ndAllocationMode ndMemory::GetAllocationMode()
+{
+	return m_allocationMode;
+}
+
+void ndMemory::SetAllocationMode(ndAllocationMode mode)
+{
+	m_allocationMode = mode;
+}
@@ -33,6 +33,16 @@ typedef void (*ndMemFreeCallback) (void* const ptr);
 class ndMemory
 {
 	public:
+	enum ndAllocationMode
+	{
+		// per thread scratch buffers are allocated by the thread that resizes them.
+		m_defaultAllocation,
+		// per thread scratch buffers are allocated and initialized by the thread 
+		// that uses them, so that the operating system first touch policy places 
+		// their pages in the numa node of that thread.
+		m_firstTouchAllocation,
+	};
+
 	/// General Memory allocation function.
 	/// All memory allocations used by the Newton Engine and Tools 
 	/// are performed by calling this function.
@@ -51,8 +61,13 @@ class ndMemory
 	D_CORE_API static size_t CalculateBufferSize(size_t size);
 
 	/// Return the total memory allocated by the newton engine and tools.
+	/// when the thread local allocator is installed, the count is 
+	/// accumulated per thread and merged lazily, so it is approximated.
 	D_CORE_API static ndUnsigned64 GetMemoryUsed();
 
+	/// Return the number of calls to Malloc made by the calling thread.
+	D_CORE_API static ndUnsigned64 GetThreadAllocationCount();
+
 	/// Install low level system memory allocation functions.
 	/// \param ndMemAllocCallback alloc: is a function pointer callback to allocate a memory chunk.
 	/// \param ndMemFreeCallback free: is a function pointer callback to free a memory chunk.
@@ -66,11 +81,30 @@ class ndMemory
 	/// allocation using global operators new and delete, therefore it 
 	/// is ok to install the memory allocator on the main of the 
 	/// application or just before start using the engine.
+	/// Passing ndSlabAllocator::Malloc and ndSlabAllocator::Free selects the 
+	/// engine thread local size class allocator, in that mode ndFreeListAlloc
+	/// classes bypass their global free lists and allocate from it directly.
+	/// Each buffer remembers the free function it was allocated with, so 
+	/// switching allocators while engine objects are alive is safe.
 	D_CORE_API static void SetMemoryAllocators(ndMemAllocCallback alloc, ndMemFreeCallback free);
 	D_CORE_API static void GetMemoryAllocators(ndMemAllocCallback& alloc, ndMemFreeCallback& free);
 
+	/// Return true if the installed allocators are the thread local ndSlabAllocator.
+	D_CORE_API static bool IsThreadLocalAllocator();
+
+	/// Select how per thread scratch buffers are allocated.
+	/// First touch allocation is only useful on multi socket machines, together with 
+	/// thread affinity, see ndThreadPool::SetThreadAffinity.
+	D_CORE_API static ndAllocationMode GetAllocationMode();
+	D_CORE_API static void SetAllocationMode(ndAllocationMode mode);
+
 	private:
+	static void UpdateMemoryUsed(ndInt64 size);
+
 	static ndAtomic<ndUnsigned64> m_memoryUsed;
+	static bool m_threadLocalAllocator;
+	static ndAllocationMode m_allocationMode;
+	friend class ndMemoryThreadCounter;
 };
 
 #endif
@@ -0,0 +1,189 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndCoreStdafx.h"
+#include "ndMemory.h"
+#include "ndMemoryMappedFile.h"
+
+#if (defined (WIN32) || defined(_WIN32))
+	#define D_MAPPED_FILE_WINDOWS
+#elif (defined (__linux__) || defined (__APPLE__) || defined (__unix__))
+	#define D_MAPPED_FILE_POSIX
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+ndMemoryMappedFile::ndMemoryMappedFile()
+	:ndClassAlloc()
+	,m_data(nullptr)
+	,m_fileHandle(nullptr)
+	,m_mapHandle(nullptr)
+	,m_size(0)
+{
+}
+
+ndMemoryMappedFile::~ndMemoryMappedFile()
+{
+	Close();
+}
+
+#if defined (D_MAPPED_FILE_WINDOWS)
+
+bool ndMemoryMappedFile::Open(const char* const path)
+{
+	Close();
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || (size.QuadPart == 0))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* const data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_data = data;
+	m_fileHandle = file;
+	m_mapHandle = mapping;
+	m_size = size_t(size.QuadPart);
+	return true;
+}
+
+void ndMemoryMappedFile::Close()
+{
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+		CloseHandle((HANDLE)m_mapHandle);
+		CloseHandle((HANDLE)m_fileHandle);
+	}
+	m_data = nullptr;
+	m_fileHandle = nullptr;
+	m_mapHandle = nullptr;
+	m_size = 0;
+}
+
+#elif defined (D_MAPPED_FILE_POSIX)
+
+bool ndMemoryMappedFile::Open(const char* const path)
+{
+	Close();
+	const int file = open(path, O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if ((fstat(file, &info) != 0) || (info.st_size == 0))
+	{
+		close(file);
+		return false;
+	}
+
+	// the descriptor is not needed once the file is mapped
+	void* const data = mmap(nullptr, size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_data = data;
+	m_size = size_t(info.st_size);
+	return true;
+}
+
+void ndMemoryMappedFile::Close()
+{
+	if (m_data)
+	{
+		munmap(m_data, m_size);
+	}
+	m_data = nullptr;
+	m_size = 0;
+}
+
+#else
+
+bool ndMemoryMappedFile::Open(const char* const path)
+{
+	Close();
+	FILE* const file = fopen(path, "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size <= 0)
+	{
+		fclose(file);
+		return false;
+	}
+
+	void* const data = ndMemory::Malloc(size_t(size));
+	const size_t readBytes = fread(data, 1, size_t(size), file);
+	fclose(file);
+	if (readBytes != size_t(size))
+	{
+		ndMemory::Free(data);
+		return false;
+	}
+
+	m_data = data;
+	m_size = size_t(size);
+	return true;
+}
+
+void ndMemoryMappedFile::Close()
+{
+	if (m_data)
+	{
+		ndMemory::Free(m_data);
+	}
+	m_data = nullptr;
+	m_size = 0;
+}
+
+#endif
@@ -0,0 +1,69 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __ND_MEMORY_MAPPED_FILE_H_
+#define __ND_MEMORY_MAPPED_FILE_H_
+
+#include "ndCoreStdafx.h"
+#include "ndClassAlloc.h"
+
+/// Maps the content of a file into the address space of the process.
+/// \brief The mapping is private and copy on write, the pages are shared with 
+/// every other process that maps the same file through the page cache until 
+/// they are written to, writes are never seen by the file or by other processes.
+/// On platforms without memory mapping the file is read into a heap buffer.
+class ndMemoryMappedFile: public ndClassAlloc
+{
+	public:
+	D_CORE_API ndMemoryMappedFile();
+	D_CORE_API ~ndMemoryMappedFile();
+
+	/// Maps the file named path, releasing any previous mapping.
+	/// \return false if the file can not be opened or it is empty.
+	D_CORE_API bool Open(const char* const path);
+
+	/// Unmaps the file, all pointers to the data become invalid.
+	D_CORE_API void Close();
+
+	/// Start of the file content, aligned to a memory page when the file is mapped.
+	void* GetData() const;
+
+	/// Size of the file content in bytes.
+	size_t GetSize() const;
+
+	private:
+	void* m_data;
+	void* m_fileHandle;
+	void* m_mapHandle;
+	size_t m_size;
+};
+
+inline void* ndMemoryMappedFile::GetData() const
+{
+	return m_data;
+}
+
+inline size_t ndMemoryMappedFile::GetSize() const
+{
+	return m_size;
+}
+
+#endif
@@ -0,0 +1,213 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __ND_PER_THREAD_ARRAY_H_
+#define __ND_PER_THREAD_ARRAY_H_
+
+#include "ndCoreStdafx.h"
+#include "ndTypes.h"
+#include "ndMemory.h"
+#include "ndClassAlloc.h"
+#include "ndThreadPool.h"
+
+#define D_CACHE_LINE_SIZE	64
+
+/// Array of per thread scratch objects sized at run time to the thread count.
+/// Each entry starts on its own cache line, so threads writing to their 
+/// own entry do not invalidate the cache lines of their neighbors.
+template<class T>
+class ndPerThreadArray: public ndClassAlloc
+{
+	public:
+	ndPerThreadArray();
+	~ndPerThreadArray();
+
+	ndInt32 GetCount() const;
+	bool IsFirstTouch() const;
+
+	/// resize the array, all the entries are destroyed and constructed again. 
+	void SetCount(ndInt32 count);
+
+	/// resize the array, when the memory allocation mode is first touch, 
+	/// each entry is allocated and constructed by the thread of the pool with the same index.
+	/// must be called while the pool workers are running, between ndThreadPool::Begin and ndThreadPool::End.
+	void SetCount(ndInt32 count, ndThreadPool& threadPool);
+
+	T& operator[] (ndInt32 i);
+	const T& operator[] (ndInt32 i) const;
+
+	private:
+	ndPerThreadArray(const ndPerThreadArray&);
+	ndPerThreadArray& operator=(const ndPerThreadArray&);
+
+	void Release();
+	static size_t GetStride();
+
+	char* m_buffer;
+	char** m_entryBuffers;
+	T** m_entries;
+	ndInt32 m_count;
+	bool m_firstTouch;
+};
+
+template<class T>
+ndPerThreadArray<T>::ndPerThreadArray()
+	:ndClassAlloc()
+	,m_buffer(nullptr)
+	,m_entryBuffers(nullptr)
+	,m_entries(nullptr)
+	,m_count(0)
+	,m_firstTouch(false)
+{
+}
+
+template<class T>
+ndPerThreadArray<T>::~ndPerThreadArray()
+{
+	Release();
+}
+
+template<class T>
+size_t ndPerThreadArray<T>::GetStride()
+{
+	return (sizeof(T) + D_CACHE_LINE_SIZE - 1) & ~size_t(D_CACHE_LINE_SIZE - 1);
+}
+
+template<class T>
+ndInt32 ndPerThreadArray<T>::GetCount() const
+{
+	return m_count;
+}
+
+template<class T>
+bool ndPerThreadArray<T>::IsFirstTouch() const
+{
+	return m_firstTouch;
+}
+
+template<class T>
+void ndPerThreadArray<T>::Release()
+{
+	for (ndInt32 i = m_count - 1; i >= 0; --i)
+	{
+		T* const entry = m_entries[i];
+		entry->~T();
+		if (m_firstTouch)
+		{
+			ndMemory::Free(m_entryBuffers[i]);
+		}
+	}
+	if (m_buffer)
+	{
+		ndMemory::Free(m_buffer);
+	}
+	if (m_entryBuffers)
+	{
+		ndMemory::Free(m_entryBuffers);
+	}
+	if (m_entries)
+	{
+		ndMemory::Free(m_entries);
+	}
+	m_count = 0;
+	m_buffer = nullptr;
+	m_entryBuffers = nullptr;
+	m_entries = nullptr;
+	m_firstTouch = false;
+}
+
+template<class T>
+void ndPerThreadArray<T>::SetCount(ndInt32 count)
+{
+	if ((count == m_count) && !m_firstTouch)
+	{
+		return;
+	}
+
+	Release();
+	if (count > 0)
+	{
+		const size_t stride = GetStride();
+		m_entries = (T**)ndMemory::Malloc(size_t(count) * sizeof(T*));
+		m_buffer = (char*)ndMemory::Malloc(size_t(count) * stride + D_CACHE_LINE_SIZE);
+		char* const array = (char*)((ndUnsigned64(m_buffer) + D_CACHE_LINE_SIZE - 1) & ~ndUnsigned64(D_CACHE_LINE_SIZE - 1));
+		for (ndInt32 i = 0; i < count; ++i)
+		{
+			m_entries[i] = ::new (&array[size_t(i) * stride]) T();
+		}
+		m_count = count;
+	}
+}
+
+template<class T>
+void ndPerThreadArray<T>::SetCount(ndInt32 count, ndThreadPool& threadPool)
+{
+	if (ndMemory::GetAllocationMode() != ndMemory::m_firstTouchAllocation)
+	{
+		SetCount(count);
+		return;
+	}
+
+	if ((count == m_count) && m_firstTouch)
+	{
+		return;
+	}
+
+	Release();
+	if (count > 0)
+	{
+		m_entries = (T**)ndMemory::Malloc(size_t(count) * sizeof(T*));
+		m_entryBuffers = (char**)ndMemory::Malloc(size_t(count) * sizeof(char*));
+		auto FirstTouch = ndMakeObject::ndFunction([this, count](ndInt32 threadIndex, ndInt32 threadCount)
+		{
+			// each thread allocates and initializes its own entries, 
+			// so their pages are placed in the memory node of that thread.
+			// the allocator only aligns to 32 bytes, so the entries are aligned by hand.
+			for (ndInt32 i = threadIndex; i < count; i += threadCount)
+			{
+				m_entryBuffers[i] = (char*)ndMemory::Malloc(GetStride() + D_CACHE_LINE_SIZE);
+				void* const entry = (void*)((ndUnsigned64(m_entryBuffers[i]) + D_CACHE_LINE_SIZE - 1) & ~ndUnsigned64(D_CACHE_LINE_SIZE - 1));
+				m_entries[i] = ::new (entry) T();
+			}
+		});
+		threadPool.ParallelExecute(FirstTouch);
+		m_count = count;
+		m_firstTouch = true;
+	}
+}
+
+template<class T>
+T& ndPerThreadArray<T>::operator[] (ndInt32 i)
+{
+	ndAssert(i >= 0);
+	ndAssert(i < m_count);
+	return *m_entries[i];
+}
+
+template<class T>
+const T& ndPerThreadArray<T>::operator[] (ndInt32 i) const
+{
+	ndAssert(i >= 0);
+	ndAssert(i < m_count);
+	return *m_entries[i];
+}
+
+#endif
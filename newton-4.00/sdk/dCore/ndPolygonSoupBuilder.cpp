@@ -30,10 +30,18 @@
 #include "ndTree.h"
 #include "ndStack.h"
 #include "ndPolyhedra.h"
+#include "ndProfiler.h"
+#include "ndThreadPool.h"
 #include "ndPolygonSoupBuilder.h"
 
 #define ND_POINTS_RUN (512 * 1024)
 
+// points closer than the tolerance in all axis are the same point,
+// the hash cell is larger than twice the tolerance, so that the points
+// that can be welded to a point are in at most eight cells.
+#define ND_WELD_TOLERANCE	ndFloat64 (1.0e-6f)
+#define ND_WELD_CELL		ndFloat64 (4.0e-6f)
+
 class ndPolygonSoupBuilder::ndFaceInfo
 {
 	public:
@@ -133,6 +141,9 @@ ndPolygonSoupBuilder::ndPolygonSoupBuilder ()
 	,m_normalIndex()
 	,m_vertexPoints()
 	,m_normalPoints()
+	,m_weldBuckets()
+	,m_weldChain()
+	,m_weldOnAdd(false)
 {
 	m_run = ND_POINTS_RUN;
 }
@@ -143,6 +154,9 @@ ndPolygonSoupBuilder::ndPolygonSoupBuilder (const ndPolygonSoupBuilder& source)
 	,m_normalIndex()
 	,m_vertexPoints(source.m_vertexPoints.GetCount())
 	,m_normalPoints()
+	,m_weldBuckets()
+	,m_weldChain()
+	,m_weldOnAdd(false)
 {
 	m_run = ND_POINTS_RUN;
 	m_faceVertexCount.SetCount(source.m_faceVertexCount.GetCount());
@@ -177,6 +191,108 @@ void ndPolygonSoupBuilder::Begin()
 	m_vertexPoints.SetCount(0);
 	m_normalPoints.SetCount(0);
 	m_faceVertexCount.SetCount(0);
+	ReleaseWeldBuckets();
+}
+
+void ndPolygonSoupBuilder::BeginWelded()
+{
+	Begin();
+	m_weldOnAdd = true;
+	RehashWeldBuckets(1024);
+}
+
+void ndPolygonSoupBuilder::ReleaseWeldBuckets()
+{
+	m_weldOnAdd = false;
+	m_weldBuckets.Resize(0);
+	m_weldBuckets.SetCount(0);
+	m_weldChain.Resize(0);
+	m_weldChain.SetCount(0);
+}
+
+static ndInt32 ndWeldBucket(ndInt64 x, ndInt64 y, ndInt64 z, ndInt32 bucketCount)
+{
+	const ndUnsigned64 hash = ndUnsigned64(x * 73856093) ^ ndUnsigned64(y * 19349663) ^ ndUnsigned64(z * 83492791);
+	return ndInt32((hash ^ (hash >> 29)) & ndUnsigned64(bucketCount - 1));
+}
+
+void ndPolygonSoupBuilder::RehashWeldBuckets(ndInt32 bucketCount)
+{
+	ndAssert(!(bucketCount & (bucketCount - 1)));
+	m_weldBuckets.SetCount(bucketCount);
+	for (ndInt32 i = 0; i < bucketCount; ++i)
+	{
+		m_weldBuckets[i] = -1;
+	}
+
+	const ndFloat64 invCell = ndFloat64(1.0f) / ND_WELD_CELL;
+	m_weldChain.SetCount(m_vertexPoints.GetCount());
+	for (ndInt32 i = 0; i < m_vertexPoints.GetCount(); ++i)
+	{
+		const ndBigVector cell((m_vertexPoints[i].Scale(invCell)).Floor());
+		const ndInt32 bucket = ndWeldBucket(ndInt64(cell.m_x), ndInt64(cell.m_y), ndInt64(cell.m_z), bucketCount);
+		m_weldChain[i] = m_weldBuckets[bucket];
+		m_weldBuckets[bucket] = i;
+	}
+}
+
+ndInt32 ndPolygonSoupBuilder::WeldPoint(const ndBigVector& point)
+{
+	const ndFloat64 invCell = ndFloat64(1.0f) / ND_WELD_CELL;
+	const ndBigVector scaledPoint(point.Scale(invCell));
+	const ndBigVector cell(scaledPoint.Floor());
+	const ndBigVector fraction((scaledPoint - cell).Scale(ND_WELD_CELL));
+
+	// the cell of the point, and the neighbors closer than the tolerance
+	ndInt64 base[3];
+	ndInt64 side[3];
+	for (ndInt32 i = 0; i < 3; ++i)
+	{
+		base[i] = ndInt64(cell[i]);
+		side[i] = 0;
+		if (fraction[i] < ND_WELD_TOLERANCE)
+		{
+			side[i] = -1;
+		}
+		else if (fraction[i] > (ND_WELD_CELL - ND_WELD_TOLERANCE))
+		{
+			side[i] = 1;
+		}
+	}
+
+	const ndInt32 bucketCount = m_weldBuckets.GetCount();
+	for (ndInt32 i = 0; i < 8; ++i)
+	{
+		if (((i & 1) && !side[0]) || ((i & 2) && !side[1]) || ((i & 4) && !side[2]))
+		{
+			continue;
+		}
+		const ndInt64 x = base[0] + ((i & 1) ? side[0] : 0);
+		const ndInt64 y = base[1] + ((i & 2) ? side[1] : 0);
+		const ndInt64 z = base[2] + ((i & 4) ? side[2] : 0);
+		for (ndInt32 j = m_weldBuckets[ndWeldBucket(x, y, z, bucketCount)]; j >= 0; j = m_weldChain[j])
+		{
+			const ndBigVector error((m_vertexPoints[j] - point).Abs());
+			if ((error.m_x <= ND_WELD_TOLERANCE) && (error.m_y <= ND_WELD_TOLERANCE) && (error.m_z <= ND_WELD_TOLERANCE))
+			{
+				return j;
+			}
+		}
+	}
+
+	const ndInt32 index = m_vertexPoints.GetCount();
+	m_vertexPoints.PushBack(point);
+	if ((index * 2) >= bucketCount)
+	{
+		RehashWeldBuckets(bucketCount * 2);
+	}
+	else
+	{
+		const ndInt32 bucket = ndWeldBucket(base[0], base[1], base[2], bucketCount);
+		m_weldChain.PushBack(m_weldBuckets[bucket]);
+		m_weldBuckets[bucket] = index;
+	}
+	return index;
 }
 
 void ndPolygonSoupBuilder::SavePLY(const char* const fileName) const
@@ -274,10 +390,17 @@ void ndPolygonSoupBuilder::AddFaceIndirect(const ndFloat32* const vertex, ndInt3
 	const ndInt32 stride = ndInt32 (strideInBytes / sizeof(ndFloat32));
 	for (ndInt32 i = 0; i < indexCount; ++i)
 	{
-		pool[i] = i + vertexCount;
 		const ndInt32 j = indexArray[i] * stride;
 		ndBigVector point(vertex[j + 0], vertex[j + 1], vertex[j + 2], ndFloat32(0.0f));
-		m_vertexPoints.PushBack (point);
+		if (m_weldOnAdd)
+		{
+			pool[i] = WeldPoint(point);
+		}
+		else
+		{
+			pool[i] = i + vertexCount;
+			m_vertexPoints.PushBack (point);
+		}
 	}
 
 	ndInt32 convexFaces = 0;
@@ -339,10 +462,13 @@ void ndPolygonSoupBuilder::AddFaceIndirect(const ndFloat32* const vertex, ndInt3
 		m_faceVertexCount.PushBack(count1);
 	}
 
-	m_run -= indexCount;
-	if (m_run <= 0)
+	if (!m_weldOnAdd)
 	{
-		PackArray();
+		m_run -= indexCount;
+		if (m_run <= 0)
+		{
+			PackArray();
+		}
 	}
 }
 
@@ -382,7 +508,7 @@ void ndPolygonSoupBuilder::PackArray()
 	m_run = ND_POINTS_RUN;
 }
 
-void ndPolygonSoupBuilder::Finalize()
+void ndPolygonSoupBuilder::Finalize(ndThreadPool* const threadPool)
 {
 	const ndInt32 faceCount = m_faceVertexCount.GetCount();
 	if (faceCount)
@@ -407,13 +533,13 @@ void ndPolygonSoupBuilder::Finalize()
 			}
 			k ++;
 		}
-		OptimizeByIndividualFaces();
+		OptimizeByIndividualFaces(threadPool);
 	}
 }
 
 void ndPolygonSoupBuilder::FinalizeAndOptimize(ndInt32 id)
 {
-	Finalize();
+	Finalize(nullptr);
 	ndPolyhedra polyhedra;
 	ndPolygonSoupBuilder source(*this);
 	ndPolygonSoupBuilder leftOver;
@@ -538,10 +664,10 @@ void ndPolygonSoupBuilder::FinalizeAndOptimize(ndInt32 id)
 		faceIndexNumber += (indexCount + 1); 
 	}
 
-	Finalize();
+	Finalize(nullptr);
 }
 
-void ndPolygonSoupBuilder::OptimizeByIndividualFaces()
+void ndPolygonSoupBuilder::OptimizeByIndividualFaces(ndThreadPool* const threadPool)
 {
 	ndInt32* const faceArray = &m_faceVertexCount[0];
 	ndInt32* const indexArray = &m_vertexIndex[0];
@@ -549,15 +675,41 @@ void ndPolygonSoupBuilder::OptimizeByIndividualFaces()
 	ndInt32* const oldFaceArray = &m_faceVertexCount[0];
 	ndInt32* const oldIndexArray = &m_vertexIndex[0];
 
+	// filter all the faces in place first, the compaction below 
+	// only overwrites the indices of faces that were already filtered.
+	const ndInt32 faceCount = m_faceVertexCount.GetCount();
+	ndStack<ndInt32> faceStartPool(faceCount);
+	ndStack<ndInt32> filterCountPool(faceCount);
+	ndInt32* const faceStart = &faceStartPool[0];
+	ndInt32* const filterCount = &filterCountPool[0];
 	ndInt32 polygonIndex = 0;
+	for (ndInt32 i = 0; i < faceCount; ++i)
+	{
+		faceStart[i] = polygonIndex;
+		polygonIndex += oldFaceArray[i];
+	}
+	ndAssert (polygonIndex == m_vertexIndex.GetCount());
+
+	auto FilterFaces = ndMakeObject::ndFunction([this, faceCount, faceStart, filterCount, oldFaceArray, oldIndexArray](ndInt32 threadIndex, ndInt32 threadCount)
+	{
+		D_TRACKTIME_NAMED(FilterFaces);
+		const ndStartEnd startEnd(faceCount, threadIndex, threadCount);
+		for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
+		{
+			filterCount[i] = FilterFace (oldFaceArray[i] - 1, &oldIndexArray[faceStart[i]]);
+		}
+	});
+	ndParallelExecute(threadPool, FilterFaces);
+
 	ndInt32 newFaceCount = 0;
 	ndInt32 newIndexCount = 0;
-	for (ndInt32 i = 0; i < m_faceVertexCount.GetCount(); ++i)
+	for (ndInt32 i = 0; i < faceCount; ++i)
 	{
 		ndInt32 oldCount = oldFaceArray[i];
-		ndInt32 count = FilterFace (oldCount - 1, &oldIndexArray[polygonIndex]);
+		ndInt32 count = filterCount[i];
 		if (count) 
 		{
+			polygonIndex = faceStart[i];
 			faceArray[newFaceCount] = count + 1;
 			for (ndInt32 j = 0; j < count; ++j) 
 			{
@@ -567,9 +719,7 @@ void ndPolygonSoupBuilder::OptimizeByIndividualFaces()
 			newFaceCount ++;
 			newIndexCount += (count + 1);
 		}
-		polygonIndex += oldCount;
 	}
-	ndAssert (polygonIndex == m_vertexIndex.GetCount());
 
 	m_vertexIndex.Resize(newIndexCount);
 	m_faceVertexCount.Resize(newFaceCount);
@@ -578,6 +728,18 @@ void ndPolygonSoupBuilder::OptimizeByIndividualFaces()
 }
 
 void ndPolygonSoupBuilder::End(bool optimize)
+{
+	EndBuild(optimize, nullptr);
+}
+
+void ndPolygonSoupBuilder::End(bool optimize, ndThreadPool& threadPool)
+{
+	threadPool.Begin();
+	EndBuild(optimize, &threadPool);
+	threadPool.End();
+}
+
+void ndPolygonSoupBuilder::EndBuild(bool optimize, ndThreadPool* const threadPool)
 {
 	if (optimize) 
 	{
@@ -592,7 +754,8 @@ void ndPolygonSoupBuilder::End(bool optimize)
 			Optimize(iter.GetNode()->GetKey(), bucket, copy);
 		}
 	}
-	Finalize();
+	Finalize(threadPool);
+	ReleaseWeldBuckets();
 
 	// build the normal array and adjacency array
 	ndInt32 indexCount = 0;
@@ -600,32 +763,45 @@ void ndPolygonSoupBuilder::End(bool optimize)
 	if (faceCount)
 	{
 		// calculate all face the normals
+		ndStack<ndInt32> faceStartPool(faceCount);
+		ndInt32* const faceStart = &faceStartPool[0];
+		for (ndInt32 i = 0; i < faceCount; ++i)
+		{
+			faceStart[i] = indexCount;
+			indexCount += m_faceVertexCount[i];
+		}
+
 		m_normalPoints.Resize(faceCount);
 		m_normalPoints.SetCount(faceCount);
-		for (ndInt32 i = 0; i < faceCount; ++i)
+		auto CalculateNormals = ndMakeObject::ndFunction([this, faceCount, faceStart](ndInt32 threadIndex, ndInt32 threadCount)
 		{
-			ndInt32 faceIndexCount = m_faceVertexCount[i];
-
-			const ndInt32* const ptr = &m_vertexIndex[indexCount];
-			ndBigVector v0(&m_vertexPoints[ptr[0]].m_x);
-			ndBigVector v1(&m_vertexPoints[ptr[1]].m_x);
-			ndBigVector e0(v1 - v0);
-			ndBigVector normal0(ndBigVector::m_zero);
-			for (ndInt32 j = 2; j < faceIndexCount - 1; ++j)
+			D_TRACKTIME_NAMED(CalculateNormals);
+			const ndStartEnd startEnd(faceCount, threadIndex, threadCount);
+			for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
 			{
-				ndBigVector v2(&m_vertexPoints[ptr[j]].m_x);
-				ndBigVector e1(v2 - v0);
-				normal0 += e0.CrossProduct(e1);
-				e0 = e1;
-			}
-			ndBigVector normal(normal0.Normalize());
+				ndInt32 faceIndexCount = m_faceVertexCount[i];
+
+				const ndInt32* const ptr = &m_vertexIndex[faceStart[i]];
+				ndBigVector v0(&m_vertexPoints[ptr[0]].m_x);
+				ndBigVector v1(&m_vertexPoints[ptr[1]].m_x);
+				ndBigVector e0(v1 - v0);
+				ndBigVector normal0(ndBigVector::m_zero);
+				for (ndInt32 j = 2; j < faceIndexCount - 1; ++j)
+				{
+					ndBigVector v2(&m_vertexPoints[ptr[j]].m_x);
+					ndBigVector e1(v2 - v0);
+					normal0 += e0.CrossProduct(e1);
+					e0 = e1;
+				}
+				ndBigVector normal(normal0.Normalize());
 
-			m_normalPoints[i].m_x = normal.m_x;
-			m_normalPoints[i].m_y = normal.m_y;
-			m_normalPoints[i].m_z = normal.m_z;
-			m_normalPoints[i].m_w = ndFloat32(0.0f);
-			indexCount += faceIndexCount;
-		}
+				m_normalPoints[i].m_x = normal.m_x;
+				m_normalPoints[i].m_y = normal.m_y;
+				m_normalPoints[i].m_z = normal.m_z;
+				m_normalPoints[i].m_w = ndFloat32(0.0f);
+			}
+		});
+		ndParallelExecute(threadPool, CalculateNormals);
 
 		m_normalIndex.Resize(faceCount);;
 		m_normalIndex.SetCount(faceCount);
@@ -34,6 +34,8 @@
 #include "ndVector.h"
 #include "ndMatrix.h"
 
+class ndThreadPool;
+
 /// Helper intermediate class for encoding a face adjacent face to an edge of a face.
 class ndAdjacentFace
 {
@@ -58,6 +60,21 @@ class ndPolygonSoupBuilder: public ndClassAlloc
 
 	D_CORE_API virtual void Begin();
 	D_CORE_API virtual void End(bool optimize);
+
+	/// same as End, with the face filtering and the face normals 
+	/// distributed over the threads of threadPool.
+	/// threadPool must be idle, a world scene can only be used outside its update.
+	D_CORE_API void End(bool optimize, ndThreadPool& threadPool);
+
+	/// same as Begin, but the points of each face are welded to the points
+	/// already in the builder as the face is added, so that the builder holds 
+	/// a single copy of each point, instead of repacking all the points 
+	/// every few hundred thousand faces. 
+	/// this only removes the duplicated points, the face indices, vertex counts 
+	/// and face attributes are still held until End, since the bvh is built over 
+	/// the whole face set, so the memory of the builder still grows with the face count.
+	/// use it for very large meshes added one face at a time.
+	D_CORE_API void BeginWelded();
 	D_CORE_API virtual void AddFace(const ndFloat32* const vertex, ndInt32 strideInBytes, ndInt32 vertexCount, const ndInt32 faceId);
 	D_CORE_API virtual void AddFaceIndirect(const ndFloat32* const vertex, ndInt32 strideInBytes, ndInt32 faceId, const ndInt32* const indexArray, ndInt32 indexCount);
 
@@ -67,8 +84,12 @@ class ndPolygonSoupBuilder: public ndClassAlloc
 	private:
 	void Optimize(ndInt32 faceId, const ndFaceBucket& faceBucket, const ndPolygonSoupBuilder& source);
 
-	void Finalize();
-	void OptimizeByIndividualFaces();
+	void Finalize(ndThreadPool* const threadPool);
+	void OptimizeByIndividualFaces(ndThreadPool* const threadPool);
+	void EndBuild(bool optimize, ndThreadPool* const threadPool);
+	ndInt32 WeldPoint(const ndBigVector& point);
+	void RehashWeldBuckets(ndInt32 bucketCount);
+	void ReleaseWeldBuckets();
 	void FinalizeAndOptimize(ndInt32 id);
 	ndInt32 FilterFace (ndInt32 count, ndInt32* const indexArray);
 	ndInt32 AddConvexFace (ndInt32 count, ndInt32* const indexArray, ndInt32* const  facesArray);
@@ -108,7 +129,12 @@ class ndPolygonSoupBuilder: public ndClassAlloc
 	ndIndexArray m_normalIndex;
 	ndVertexArray m_vertexPoints;
 	ndVertexArray m_normalPoints;
+
+	// point hash of the welded mode, one chain per bucket
+	ndIndexArray m_weldBuckets;
+	ndIndexArray m_weldChain;
 	ndInt32 m_run;
+	bool m_weldOnAdd;
 };
 
 #endif
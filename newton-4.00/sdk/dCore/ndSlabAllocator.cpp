@@ -0,0 +1,250 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndCoreStdafx.h"
+#include "ndTypes.h"
+#include "ndUtils.h"
+#include "ndSlabAllocator.h"
+#include "ndThreadSyncUtils.h"
+
+// blocks are rounded to 64 bytes up to 1 kbyte and to 512 bytes up to 8 kbytes,
+// larger requests go directly to the system heap.
+#define D_SLAB_SMALL_STEP		64
+#define D_SLAB_SMALL_LIMIT		1024
+#define D_SLAB_LARGE_STEP		512
+#define D_SLAB_LARGE_LIMIT		(8 * 1024)
+#define D_SLAB_CLASS_COUNT		(D_SLAB_SMALL_LIMIT / D_SLAB_SMALL_STEP + (D_SLAB_LARGE_LIMIT - D_SLAB_SMALL_LIMIT) / D_SLAB_LARGE_STEP)
+#define D_SLAB_CHUNK_SIZE		(64 * 1024)
+#define D_SLAB_CHUNK_HEADER		64
+#define D_SLAB_THREAD_CACHE		(128 * 1024)
+
+class ndSlabBlockHeader
+{
+	public:
+	ndInt64 m_sizeClass;
+	ndInt64 m_padding;
+};
+
+class ndSlabFreeBlock
+{
+	public:
+	ndSlabFreeBlock* m_next;
+};
+
+class ndSlabChunk
+{
+	public:
+	ndSlabChunk* m_next;
+};
+
+class ndSlabFreeList
+{
+	public:
+	void Push(ndSlabFreeBlock* const block)
+	{
+		block->m_next = m_head;
+		m_head = block;
+		m_count++;
+	}
+
+	ndSlabFreeBlock* Pop()
+	{
+		ndSlabFreeBlock* const block = m_head;
+		m_head = block->m_next;
+		m_count--;
+		return block;
+	}
+
+	// move up to count blocks to the destination list
+	void Move(ndSlabFreeList& dst, ndInt32 count)
+	{
+		for (ndInt32 i = ndMin(count, m_count); i > 0; --i)
+		{
+			dst.Push(Pop());
+		}
+	}
+
+	ndSlabFreeBlock* m_head;
+	ndInt32 m_count;
+};
+
+static inline ndInt32 ndSlabGetSizeClass(size_t blockSize)
+{
+	if (blockSize <= D_SLAB_SMALL_LIMIT)
+	{
+		return ndInt32((blockSize + D_SLAB_SMALL_STEP - 1) / D_SLAB_SMALL_STEP) - 1;
+	}
+	return D_SLAB_SMALL_LIMIT / D_SLAB_SMALL_STEP + ndInt32((blockSize - D_SLAB_SMALL_LIMIT + D_SLAB_LARGE_STEP - 1) / D_SLAB_LARGE_STEP) - 1;
+}
+
+static inline ndInt32 ndSlabGetClassSize(ndInt32 sizeClass)
+{
+	const ndInt32 smallClasses = D_SLAB_SMALL_LIMIT / D_SLAB_SMALL_STEP;
+	if (sizeClass < smallClasses)
+	{
+		return (sizeClass + 1) * D_SLAB_SMALL_STEP;
+	}
+	return D_SLAB_SMALL_LIMIT + (sizeClass - smallClasses + 1) * D_SLAB_LARGE_STEP;
+}
+
+class ndSlabSharedPool
+{
+	public:
+	ndSlabSharedPool()
+		:m_chunks(nullptr)
+	{
+		memset(m_lists, 0, sizeof(m_lists));
+	}
+
+	static ndSlabSharedPool& GetPool()
+	{
+		// the pool has a trivial destructor, so blocks released 
+		// by destructors of other static objects at exit are still valid.
+		static ndSlabSharedPool pool;
+		return pool;
+	}
+
+	void Push(ndSlabFreeList& src, ndInt32 sizeClass, ndInt32 count)
+	{
+		ndScopeSpinLock lock(m_lock[sizeClass]);
+		src.Move(m_lists[sizeClass], count);
+	}
+
+	void Refill(ndSlabFreeList& dst, ndInt32 sizeClass)
+	{
+		const ndInt32 blockSize = ndSlabGetClassSize(sizeClass);
+		const ndInt32 blocksPerChunk = (D_SLAB_CHUNK_SIZE - D_SLAB_CHUNK_HEADER) / blockSize;
+		{
+			ndScopeSpinLock lock(m_lock[sizeClass]);
+			m_lists[sizeClass].Move(dst, (blocksPerChunk + 1) / 2);
+		}
+		if (!dst.m_count)
+		{
+			char* const buffer = (char*)malloc(D_SLAB_CHUNK_SIZE);
+			ndSlabChunk* const chunk = (ndSlabChunk*)buffer;
+			{
+				ndScopeSpinLock lock(m_chunksLock);
+				chunk->m_next = m_chunks;
+				m_chunks = chunk;
+			}
+
+			for (ndInt32 i = blocksPerChunk - 1; i >= 0; --i)
+			{
+				ndSlabBlockHeader* const header = (ndSlabBlockHeader*)&buffer[D_SLAB_CHUNK_HEADER + i * blockSize];
+				header->m_sizeClass = sizeClass;
+				dst.Push((ndSlabFreeBlock*)(header + 1));
+			}
+		}
+	}
+
+	ndSlabFreeList m_lists[D_SLAB_CLASS_COUNT];
+	ndSpinLock m_lock[D_SLAB_CLASS_COUNT];
+	ndSlabChunk* m_chunks;
+	ndSpinLock m_chunksLock;
+};
+
+class ndSlabThreadCache
+{
+	public:
+	ndSlabThreadCache()
+		:m_released(false)
+	{
+		memset(m_lists, 0, sizeof(m_lists));
+	}
+
+	~ndSlabThreadCache()
+	{
+		Flush();
+		m_released = true;
+	}
+
+	void* Malloc(ndInt32 sizeClass)
+	{
+		ndSlabFreeList& list = m_lists[sizeClass];
+		if (!list.m_count)
+		{
+			ndSlabSharedPool::GetPool().Refill(list, sizeClass);
+		}
+		return list.Pop();
+	}
+
+	void Free(ndSlabFreeBlock* const block, ndInt32 sizeClass)
+	{
+		ndSlabFreeList& list = m_lists[sizeClass];
+		list.Push(block);
+		if (m_released)
+		{
+			// the thread is exiting, static destructors can still free memory.
+			ndSlabSharedPool::GetPool().Push(list, sizeClass, list.m_count);
+		}
+		else if (list.m_count * ndSlabGetClassSize(sizeClass) > D_SLAB_THREAD_CACHE)
+		{
+			ndSlabSharedPool::GetPool().Push(list, sizeClass, list.m_count / 2);
+		}
+	}
+
+	void Flush()
+	{
+		ndSlabSharedPool& pool = ndSlabSharedPool::GetPool();
+		for (ndInt32 i = 0; i < D_SLAB_CLASS_COUNT; ++i)
+		{
+			if (m_lists[i].m_count)
+			{
+				pool.Push(m_lists[i], i, m_lists[i].m_count);
+			}
+		}
+	}
+
+	ndSlabFreeList m_lists[D_SLAB_CLASS_COUNT];
+	bool m_released;
+};
+
+static thread_local ndSlabThreadCache m_threadCache;
+
+void* ndSlabAllocator::Malloc(size_t size)
+{
+	const size_t blockSize = size + sizeof(ndSlabBlockHeader);
+	if (blockSize > D_SLAB_LARGE_LIMIT)
+	{
+		ndSlabBlockHeader* const header = (ndSlabBlockHeader*)malloc(blockSize);
+		header->m_sizeClass = -1;
+		return header + 1;
+	}
+	return m_threadCache.Malloc(ndSlabGetSizeClass(blockSize));
+}
+
+void ndSlabAllocator::Free(void* const ptr)
+{
+	ndSlabBlockHeader* const header = ((ndSlabBlockHeader*)ptr) - 1;
+	if (header->m_sizeClass < 0)
+	{
+		free(header);
+	}
+	else
+	{
+		m_threadCache.Free((ndSlabFreeBlock*)ptr, ndInt32(header->m_sizeClass));
+	}
+}
+
+void ndSlabAllocator::FlushThreadCache()
+{
+	m_threadCache.Flush();
+}
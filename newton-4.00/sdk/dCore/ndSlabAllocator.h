@@ -0,0 +1,48 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __ND_SLAB_ALLOCATOR_H_
+#define __ND_SLAB_ALLOCATOR_H_
+
+#include "ndCoreStdafx.h"
+#include "ndTypes.h"
+
+/// Thread local size class memory allocator.
+/// Small requests are served from per thread free lists of fixed size blocks 
+/// carved out of large slabs, so threads creating and destroying contacts 
+/// concurrently do not contend on the system heap or on a global lock.
+/// Blocks freed by a thread other than the one that allocated them go to the 
+/// freeing thread cache. Caches that grow too large, or that belong to a thread 
+/// that exits, give their blocks back to a shared pool guarded by one lock per size class.
+/// Slabs are kept for the life of the process.
+/// to select it call:
+/// ndMemory::SetMemoryAllocators(ndSlabAllocator::Malloc, ndSlabAllocator::Free);
+class ndSlabAllocator
+{
+	public:
+	D_CORE_API static void* Malloc(size_t size);
+	D_CORE_API static void Free(void* const ptr);
+
+	/// return all the blocks cached by the calling thread to the shared pool.
+	D_CORE_API static void FlushThreadCache();
+};
+
+#endif
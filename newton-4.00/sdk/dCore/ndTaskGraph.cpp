@@ -0,0 +1,292 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndCoreStdafx.h"
+#include "ndTypes.h"
+#include "ndProfiler.h"
+#include "ndTaskGraph.h"
+
+ndTaskGraph::ndNode::ndNode(ndInt32 count, ndInt32 batchSize)
+	:ndClassAlloc()
+	,m_successors()
+	,m_continuation(nullptr)
+	,m_pendingItems(0)
+	,m_pendingDependencies(0)
+	,m_dependencies(0)
+	,m_batchSize(ndMax(batchSize, 1))
+	,m_count(ndMax(count, 0))
+	,m_isContinuation(false)
+{
+}
+
+ndTaskGraph::ndNode::~ndNode()
+{
+}
+
+void ndTaskGraph::ndNode::SetCount(ndInt32 count)
+{
+	m_count = ndMax(count, 0);
+}
+
+ndTaskGraph::ndJobQueue::ndJobQueue()
+	:m_lock()
+	,m_top(0)
+	,m_bottom(0)
+{
+}
+
+bool ndTaskGraph::ndJobQueue::Push(const ndJob& job)
+{
+	ndScopeSpinLock lock(m_lock);
+	if ((m_bottom - m_top) >= D_TASK_GRAPH_QUEUE_SIZE)
+	{
+		return false;
+	}
+	m_jobs[m_bottom & (D_TASK_GRAPH_QUEUE_SIZE - 1)] = job;
+	m_bottom++;
+	return true;
+}
+
+bool ndTaskGraph::ndJobQueue::PopBottom(ndJob& job)
+{
+	ndScopeSpinLock lock(m_lock);
+	if (m_bottom == m_top)
+	{
+		return false;
+	}
+	m_bottom--;
+	job = m_jobs[m_bottom & (D_TASK_GRAPH_QUEUE_SIZE - 1)];
+	return true;
+}
+
+bool ndTaskGraph::ndJobQueue::PopTop(ndJob& job)
+{
+	ndScopeSpinLock lock(m_lock);
+	if (m_bottom == m_top)
+	{
+		return false;
+	}
+	job = m_jobs[m_top & (D_TASK_GRAPH_QUEUE_SIZE - 1)];
+	m_top++;
+	return true;
+}
+
+ndTaskGraph::ndTaskGraph()
+	:ndClassAlloc()
+	,m_nodes()
+	,m_queues()
+	,m_pendingNodes(0)
+{
+	ndAssert((D_TASK_GRAPH_QUEUE_SIZE & (D_TASK_GRAPH_QUEUE_SIZE - 1)) == 0);
+}
+
+ndTaskGraph::~ndTaskGraph()
+{
+	Clear();
+}
+
+void ndTaskGraph::Clear()
+{
+	for (ndInt32 i = ndInt32(m_nodes.GetCount()) - 1; i >= 0; --i)
+	{
+		delete m_nodes[i];
+	}
+	m_nodes.SetCount(0);
+}
+
+void ndTaskGraph::AddDependency(ndNode* const node, ndNode* const dependent)
+{
+	ndAssert(node != dependent);
+	ndAssert(!dependent->m_isContinuation);
+	node->m_successors.PushBack(dependent);
+	dependent->m_dependencies++;
+}
+
+void ndTaskGraph::AddContinuation(ndNode* const node, ndNode* const continuation)
+{
+	ndAssert(!node->m_continuation);
+	ndAssert(!continuation->m_dependencies);
+	node->m_continuation = continuation;
+	continuation->m_isContinuation = true;
+}
+
+void ndTaskGraph::Schedule(ndInt32 threadIndex, ndNode* const node)
+{
+	if (node->m_count)
+	{
+		ndJob job;
+		job.m_node = node;
+		job.m_start = 0;
+		job.m_count = node->m_count;
+		if (!m_queues[threadIndex].Push(job))
+		{
+			RunJob(threadIndex, job);
+		}
+	}
+	else
+	{
+		if (node->m_continuation)
+		{
+			ndAssert(!node->m_continuation->m_count);
+			CompleteItems(threadIndex, node->m_continuation, 0);
+		}
+		CompleteItems(threadIndex, node, 0);
+	}
+}
+
+void ndTaskGraph::CompleteItems(ndInt32 threadIndex, ndNode* const node, ndInt32 count)
+{
+	if (node->m_pendingItems.fetch_sub(count) == count)
+	{
+		for (ndInt32 i = 0; i < node->m_successors.GetCount(); ++i)
+		{
+			ndNode* const successor = node->m_successors[i];
+			if (successor->m_pendingDependencies.fetch_sub(1) == 1)
+			{
+				Schedule(threadIndex, successor);
+			}
+		}
+		// successors must be in the queue before the node is retired,
+		// otherwise idle threads may see an empty graph and quit.
+		m_pendingNodes.fetch_sub(1);
+	}
+}
+
+void ndTaskGraph::RunJob(ndInt32 threadIndex, ndJob& job)
+{
+	ndNode* const node = job.m_node;
+	while (job.m_count > node->m_batchSize)
+	{
+		ndJob upperHalf;
+		const ndInt32 half = job.m_count / 2;
+		upperHalf.m_node = node;
+		upperHalf.m_start = job.m_start + half;
+		upperHalf.m_count = job.m_count - half;
+		if (!m_queues[threadIndex].Push(upperHalf))
+		{
+			break;
+		}
+		job.m_count = half;
+	}
+
+	node->Execute(threadIndex, job.m_start, job.m_count);
+	ndNode* const continuation = node->m_continuation;
+	if (continuation)
+	{
+		ndAssert(continuation->m_count == node->m_count);
+		continuation->Execute(threadIndex, job.m_start, job.m_count);
+		CompleteItems(threadIndex, continuation, job.m_count);
+	}
+	CompleteItems(threadIndex, node, job.m_count);
+}
+
+bool ndTaskGraph::GetJob(ndInt32 threadIndex, ndInt32 threadCount, ndJob& job)
+{
+	if (m_queues[threadIndex].PopBottom(job))
+	{
+		return true;
+	}
+
+	for (ndInt32 i = 1; i < threadCount; ++i)
+	{
+		ndInt32 victim = threadIndex + i;
+		victim = (victim >= threadCount) ? victim - threadCount : victim;
+		if (m_queues[victim].PopTop(job))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void ndTaskGraph::WorkerLoop(ndInt32 threadIndex, ndInt32 threadCount)
+{
+	ndInt32 iterations = 0;
+	while (m_pendingNodes.load())
+	{
+		ndJob job;
+		if (GetJob(threadIndex, threadCount, job))
+		{
+			RunJob(threadIndex, job);
+			iterations = 0;
+		}
+		else
+		{
+			if (iterations == 32)
+			{
+				ndThreadYield();
+				iterations = 0;
+			}
+			else
+			{
+				ndThreadPause();
+			}
+			iterations++;
+		}
+	}
+}
+
+void ndTaskGraph::Execute(ndThreadPool& threadPool)
+{
+	D_TRACKTIME();
+	const ndInt32 nodesCount = ndInt32(m_nodes.GetCount());
+	if (!nodesCount)
+	{
+		return;
+	}
+
+	for (ndInt32 i = 0; i < nodesCount; ++i)
+	{
+		ndNode* const node = m_nodes[i];
+		node->m_pendingItems.store(node->m_count);
+		node->m_pendingDependencies.store(node->m_dependencies);
+	}
+	m_pendingNodes.store(nodesCount);
+
+	const ndInt32 threadCount = threadPool.GetThreadCount();
+	m_queues.SetCount(threadCount);
+	for (ndInt32 i = 0; i < threadCount; ++i)
+	{
+		ndAssert(m_queues[i].m_top == m_queues[i].m_bottom);
+		m_queues[i].m_top = 0;
+		m_queues[i].m_bottom = 0;
+	}
+
+	// distribute the root nodes across the threads queues.
+	ndInt32 queueIndex = 0;
+	for (ndInt32 i = 0; i < nodesCount; ++i)
+	{
+		ndNode* const node = m_nodes[i];
+		if (!node->m_dependencies && !node->m_isContinuation)
+		{
+			Schedule(queueIndex, node);
+			queueIndex = (queueIndex + 1 < threadCount) ? queueIndex + 1 : 0;
+		}
+	}
+
+	auto ExecuteGraph = ndMakeObject::ndFunction([this](ndInt32 threadIndex, ndInt32 threadCount)
+	{
+		D_TRACKTIME_NAMED(ExecuteGraph);
+		WorkerLoop(threadIndex, threadCount);
+	});
+	threadPool.ParallelExecute(ExecuteGraph);
+	ndAssert(!m_pendingNodes.load());
+}
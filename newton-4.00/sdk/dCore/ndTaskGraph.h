@@ -0,0 +1,191 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+* 
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* 
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __ND_TASK_GRAPH_H_
+#define __ND_TASK_GRAPH_H_
+
+#include "ndCoreStdafx.h"
+#include "ndTypes.h"
+#include "ndArray.h"
+#include "ndClassAlloc.h"
+#include "ndThreadPool.h"
+#include "ndFixSizeArray.h"
+#include "ndPerThreadArray.h"
+#include "ndThreadSyncUtils.h"
+
+#define D_TASK_GRAPH_QUEUE_SIZE			256
+#define D_TASK_GRAPH_MAX_SUCCESSORS		8
+
+/// Work stealing scheduler for a graph of dependent tasks.
+/// Each thread owns a deque of jobs, it pops work from the bottom of its own deque
+/// and steals from the top of the other threads deques when it runs out of work.
+/// Parallel for nodes are split recursively so that idle threads can steal the upper half of a range.
+/// A node is schedule as soon as all its dependencies are completed, so there is only 
+/// one join for the entire graph instead of one barrier per stage.
+class ndTaskGraph: public ndClassAlloc
+{
+	public:
+	class ndNode: public ndClassAlloc
+	{
+		public:
+		D_CORE_API ndNode(ndInt32 count, ndInt32 batchSize);
+		D_CORE_API virtual ~ndNode();
+
+		/// set the number of items of a parallel for node. 
+		/// Must be called before ndTaskGraph::Execute.
+		D_CORE_API void SetCount(ndInt32 count);
+		ndInt32 GetCount() const;
+
+		protected:
+		virtual void Execute(ndInt32 threadIndex, ndInt32 start, ndInt32 count) const = 0;
+
+		private:
+		ndFixSizeArray<ndNode*, D_TASK_GRAPH_MAX_SUCCESSORS> m_successors;
+		ndNode* m_continuation;
+		ndAtomic<ndInt32> m_pendingItems;
+		ndAtomic<ndInt32> m_pendingDependencies;
+		ndInt32 m_dependencies;
+		ndInt32 m_batchSize;
+		ndInt32 m_count;
+		bool m_isContinuation;
+		friend class ndTaskGraph;
+	};
+
+	D_CORE_API ndTaskGraph();
+	D_CORE_API ~ndTaskGraph();
+
+	/// remove all the nodes from the graph.
+	D_CORE_API void Clear();
+
+	/// add a task that runs once in a single thread.
+	/// the function signature is void function(ndInt32 threadIndex)
+	template <typename Function>
+	ndNode* AddTask(const Function& function);
+
+	/// add a task that runs over the range [0, count) in batches of at least batchSize items. 
+	/// the function signature is void function(ndInt32 threadIndex, ndInt32 start, ndInt32 count)
+	template <typename Function>
+	ndNode* AddParallelFor(ndInt32 count, const Function& function, ndInt32 batchSize = D_WORKER_BATCH_SIZE);
+
+	/// node dependent will not start until node is completed.
+	D_CORE_API void AddDependency(ndNode* const node, ndNode* const dependent);
+
+	/// continuation is a parallel for node that runs over the same sub range, 
+	/// and in the same thread, right after each sub range of node is completed.
+	/// it allows chaining two per item stages without a join between them.
+	D_CORE_API void AddContinuation(ndNode* const node, ndNode* const continuation);
+
+	/// execute all the nodes of the graph using the threads of the pool,
+	/// the function returns after all nodes are completed.
+	D_CORE_API void Execute(ndThreadPool& threadPool);
+
+	private:
+	class ndJob
+	{
+		public:
+		ndNode* m_node;
+		ndInt32 m_start;
+		ndInt32 m_count;
+	};
+
+	class ndJobQueue
+	{
+		public:
+		ndJobQueue();
+		bool Push(const ndJob& job);
+		bool PopBottom(ndJob& job);
+		bool PopTop(ndJob& job);
+
+		ndJob m_jobs[D_TASK_GRAPH_QUEUE_SIZE];
+		ndSpinLock m_lock;
+		ndInt32 m_top;
+		ndInt32 m_bottom;
+	};
+
+	template <typename Function>
+	class ndTaskNode: public ndNode
+	{
+		public:
+		ndTaskNode(const Function& function)
+			:ndNode(1, 1)
+			,m_function(function)
+		{
+		}
+
+		virtual void Execute(ndInt32 threadIndex, ndInt32, ndInt32) const
+		{
+			m_function(threadIndex);
+		}
+
+		Function m_function;
+	};
+
+	template <typename Function>
+	class ndParallelForNode: public ndNode
+	{
+		public:
+		ndParallelForNode(ndInt32 count, const Function& function, ndInt32 batchSize)
+			:ndNode(count, batchSize)
+			,m_function(function)
+		{
+		}
+
+		virtual void Execute(ndInt32 threadIndex, ndInt32 start, ndInt32 count) const
+		{
+			m_function(threadIndex, start, count);
+		}
+
+		Function m_function;
+	};
+
+	void WorkerLoop(ndInt32 threadIndex, ndInt32 threadCount);
+	bool GetJob(ndInt32 threadIndex, ndInt32 threadCount, ndJob& job);
+	void RunJob(ndInt32 threadIndex, ndJob& job);
+	void Schedule(ndInt32 threadIndex, ndNode* const node);
+	void CompleteItems(ndInt32 threadIndex, ndNode* const node, ndInt32 count);
+
+	ndArray<ndNode*> m_nodes;
+	ndPerThreadArray<ndJobQueue> m_queues;
+	ndAtomic<ndInt32> m_pendingNodes;
+};
+
+inline ndInt32 ndTaskGraph::ndNode::GetCount() const
+{
+	return m_count;
+}
+
+template <typename Function>
+ndTaskGraph::ndNode* ndTaskGraph::AddTask(const Function& function)
+{
+	ndNode* const node = new ndTaskNode<Function>(function);
+	m_nodes.PushBack(node);
+	return node;
+}
+
+template <typename Function>
+ndTaskGraph::ndNode* ndTaskGraph::AddParallelFor(ndInt32 count, const Function& function, ndInt32 batchSize)
+{
+	ndNode* const node = new ndParallelForNode<Function>(count, function, batchSize);
+	m_nodes.PushBack(node);
+	return node;
+}
+
+#endif
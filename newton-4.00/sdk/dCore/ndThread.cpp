@@ -26,6 +26,11 @@
 #include "ndProfiler.h"
 #include "ndThreadSyncUtils.h"
 
+#if defined (__linux__) && !defined (D_USE_THREAD_EMULATION)
+	#include <sched.h>
+	#include <pthread.h>
+#endif
+
 #ifdef _MSC_VER
 #pragma warning( push )
 #pragma warning( disable : 4355)
@@ -42,6 +47,9 @@ ndThread::ndThread()
 #endif
 {
 	strcpy (m_name, "newtonWorker");
+#if defined (__linux__) && !defined (D_USE_THREAD_EMULATION)
+	m_pinned = false;
+#endif
 #ifndef D_USE_THREAD_EMULATION
 	store(false);
 #endif
@@ -96,6 +104,71 @@ void ndThread::Finish()
 #endif
 }
 
+bool ndThread::SetAffinity(const ndInt32* const processors, ndInt32 count)
+{
+#if defined (D_USE_THREAD_EMULATION)
+	(void)processors;
+	(void)count;
+	return false;
+#elif defined (__linux__)
+	static_assert(sizeof(cpu_set_t) <= sizeof(m_unpinnedAffinity), "cpu_set_t does not fit");
+	cpu_set_t* const unpinnedSet = (cpu_set_t*)m_unpinnedAffinity;
+	if (!m_pinned)
+	{
+		// save the processors this thread is allowed to run on before pinning it, 
+		// a cgroup or taskset may exclude some of the machine processors.
+		// the set is read from the thread itself, not from the calling thread, 
+		// which may be a pool thread that is already pinned.
+		if (!count)
+		{
+			return true;
+		}
+		if (pthread_getaffinity_np(std::thread::native_handle(), sizeof(cpu_set_t), unpinnedSet))
+		{
+			return false;
+		}
+		m_pinned = true;
+	}
+
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	if (count)
+	{
+		for (ndInt32 i = 0; i < count; ++i)
+		{
+			CPU_SET(size_t(processors[i]), &cpuSet);
+		}
+	}
+	else
+	{
+		cpuSet = *unpinnedSet;
+	}
+	return pthread_setaffinity_np(std::thread::native_handle(), sizeof(cpuSet), &cpuSet) == 0;
+#elif (defined (WIN32) || defined(_WIN32))
+	DWORD_PTR mask = 0;
+	if (count)
+	{
+		for (ndInt32 i = 0; i < count; ++i)
+		{
+			if (processors[i] < ndInt32(sizeof(DWORD_PTR) * 8))
+			{
+				mask |= DWORD_PTR(1) << processors[i];
+			}
+		}
+	}
+	else
+	{
+		DWORD_PTR systemMask = 0;
+		GetProcessAffinityMask(GetCurrentProcess(), &mask, &systemMask);
+	}
+	return mask ? (SetThreadAffinityMask(std::thread::native_handle(), mask) != 0) : false;
+#else
+	(void)processors;
+	(void)count;
+	return false;
+#endif
+}
+
 void ndThread::Signal()
 {
 #ifndef D_USE_THREAD_EMULATION
@@ -68,6 +68,11 @@ class ndThread
 	/// wants to terminate the thread because the destructor does not do it. 
 	D_CORE_API void Finish();
 
+	/// Restrict the thread to run only on the listed logical processors.
+	/// An empty list lets the operating system schedule the thread on any processor.
+	/// Return false if the platform does not support thread affinity.
+	D_CORE_API bool SetAffinity(const ndInt32* const processors, ndInt32 count);
+
 	/// Thread function to execute in a perpetual loop until the thread is terminated.
 	/// Each time the thread owner calls function Signal, the loop execute one call to 
 	/// this function and upon return, the thread goes back to wait for another signal  
@@ -79,6 +84,12 @@ class ndThread
 
 	private:
 	void ThreadFunctionCallback();
+
+#if defined (__linux__) && !defined (D_USE_THREAD_EMULATION)
+	// the processor set the thread had before it was first pinned, big enough for a cpu_set_t
+	ndUnsigned64 m_unpinnedAffinity[16];
+	bool m_pinned;
+#endif
 };
 
 #endif
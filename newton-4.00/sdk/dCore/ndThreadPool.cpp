@@ -26,6 +26,204 @@
 #include "ndThreadPool.h"
 #include "ndThreadSyncUtils.h"
 
+#if defined (__linux__) && !defined (D_USE_THREAD_EMULATION)
+	#include <sched.h>
+#endif
+
+// logical processors of the machine ordered for thread placement.
+class ndProcessorTopology
+{
+	public:
+	ndProcessorTopology()
+		:m_cores()
+		,m_nodeProcessors()
+		,m_nodeStart()
+	{
+		#if defined (__linux__) && !defined (D_USE_THREAD_EMULATION)
+			BuildLinux();
+		#elif (defined (WIN32) || defined(_WIN32)) && !defined (D_USE_THREAD_EMULATION)
+			BuildWindows();
+		#endif
+
+		if (!m_cores.GetCount())
+		{
+			const ndInt32 processorCount = ndMax(ndInt32(std::thread::hardware_concurrency()), 1);
+			for (ndInt32 i = 0; i < processorCount; ++i)
+			{
+				m_cores.PushBack(i);
+			}
+		}
+
+		if (!m_nodeProcessors.GetCount())
+		{
+			m_nodeStart.SetCount(0);
+			m_nodeStart.PushBack(0);
+			for (ndInt32 i = 0; i < m_cores.GetCount(); ++i)
+			{
+				m_nodeProcessors.PushBack(m_cores[i]);
+			}
+			m_nodeStart.PushBack(m_nodeProcessors.GetCount());
+		}
+	}
+
+	ndInt32 GetNodeCount() const
+	{
+		return m_nodeStart.GetCount() - 1;
+	}
+
+	private:
+	#if defined (__linux__) && !defined (D_USE_THREAD_EMULATION)
+	static ndInt32 ReadValue(const char* const path)
+	{
+		ndInt32 value = -1;
+		FILE* const file = fopen(path, "rb");
+		if (file)
+		{
+			if (fscanf(file, "%d", &value) != 1)
+			{
+				value = -1;
+			}
+			fclose(file);
+		}
+		return value;
+	}
+
+	void BuildLinux()
+	{
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet))
+		{
+			return;
+		}
+
+		// first pass one logical processor per physical core, 
+		// second pass the remaining hyper threads.
+		ndArray<ndInt64> coreKeys;
+		ndArray<ndInt32> siblings;
+		for (ndInt32 i = 0; i < CPU_SETSIZE; ++i)
+		{
+			if (CPU_ISSET(size_t(i), &cpuSet))
+			{
+				char path[256];
+				snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", i);
+				const ndInt64 core = ReadValue(path);
+				snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", i);
+				const ndInt64 package = ReadValue(path);
+				const ndInt64 key = (package << 32) + core;
+
+				bool duplicate = false;
+				for (ndInt32 j = 0; (j < coreKeys.GetCount()) && !duplicate; ++j)
+				{
+					duplicate = (coreKeys[j] == key) && (core >= 0);
+				}
+				if (duplicate)
+				{
+					siblings.PushBack(i);
+				}
+				else
+				{
+					coreKeys.PushBack(key);
+					m_cores.PushBack(i);
+				}
+			}
+		}
+		for (ndInt32 i = 0; i < siblings.GetCount(); ++i)
+		{
+			m_cores.PushBack(siblings[i]);
+		}
+
+		m_nodeStart.PushBack(0);
+		for (ndInt32 node = 0; node < 256; ++node)
+		{
+			char path[256];
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+			FILE* const file = fopen(path, "rb");
+			if (!file)
+			{
+				continue;
+			}
+
+			ndInt32 first;
+			const ndInt32 start = m_nodeProcessors.GetCount();
+			while (fscanf(file, "%d", &first) == 1)
+			{
+				ndInt32 last = first;
+				char separator = char(fgetc(file));
+				if (separator == '-')
+				{
+					if (fscanf(file, "%d", &last) != 1)
+					{
+						last = first;
+					}
+					separator = char(fgetc(file));
+				}
+				for (ndInt32 i = first; i <= last; ++i)
+				{
+					if ((i < CPU_SETSIZE) && CPU_ISSET(size_t(i), &cpuSet))
+					{
+						m_nodeProcessors.PushBack(i);
+					}
+				}
+				if (separator != ',')
+				{
+					break;
+				}
+			}
+			fclose(file);
+
+			if (m_nodeProcessors.GetCount() > start)
+			{
+				m_nodeStart.PushBack(m_nodeProcessors.GetCount());
+			}
+		}
+		if (m_nodeStart.GetCount() < 2)
+		{
+			m_nodeStart.SetCount(0);
+			m_nodeProcessors.SetCount(0);
+		}
+	}
+	#endif
+
+	#if (defined (WIN32) || defined(_WIN32)) && !defined (D_USE_THREAD_EMULATION)
+	void BuildWindows()
+	{
+		ULONG highestNode = 0;
+		if (!GetNumaHighestNodeNumber(&highestNode))
+		{
+			return;
+		}
+
+		m_nodeStart.PushBack(0);
+		for (ULONG node = 0; node <= highestNode; ++node)
+		{
+			ULONGLONG mask = 0;
+			if (GetNumaNodeProcessorMask(UCHAR(node), &mask) && mask)
+			{
+				for (ndInt32 i = 0; i < 64; ++i)
+				{
+					if (mask & (ULONGLONG(1) << i))
+					{
+						m_nodeProcessors.PushBack(i);
+					}
+				}
+				m_nodeStart.PushBack(m_nodeProcessors.GetCount());
+			}
+		}
+		if (m_nodeStart.GetCount() < 2)
+		{
+			m_nodeStart.SetCount(0);
+			m_nodeProcessors.SetCount(0);
+		}
+	}
+	#endif
+
+	public:
+	ndArray<ndInt32> m_cores;
+	ndArray<ndInt32> m_nodeProcessors;
+	ndArray<ndInt32> m_nodeStart;
+};
+
 ndThreadPool::ndWorker::ndWorker()
 	:ndThread()
 	,m_owner(nullptr)
@@ -115,6 +313,8 @@ ndThreadPool::ndThreadPool(const char* const baseName)
 	,ndThread()
 	,m_workers(nullptr)
 	,m_count(0)
+	,m_affinity(m_affinityNone)
+	,m_inBlock(false)
 {
 	char name[256];
 	strncpy(m_baseName, baseName, sizeof (m_baseName));
@@ -164,6 +364,61 @@ void ndThreadPool::SetThreadCount(ndInt32 count)
 				m_workers[i].SetName(name);
 			}
 		}
+		if (m_affinity != m_affinityNone)
+		{
+			ApplyThreadAffinity();
+		}
+	}
+#endif
+}
+
+ndThreadPool::ndThreadAffinity ndThreadPool::GetThreadAffinity() const
+{
+	return m_affinity;
+}
+
+void ndThreadPool::SetThreadAffinity(ndThreadAffinity affinity)
+{
+	if (affinity != m_affinity)
+	{
+		m_affinity = affinity;
+		ApplyThreadAffinity();
+	}
+}
+
+void ndThreadPool::ApplyThreadAffinity()
+{
+#ifndef D_USE_THREAD_EMULATION
+	// thread zero is the pool own thread, the one that calls ParallelExecute. 
+	const ndProcessorTopology topology;
+	const ndInt32 threadCount = GetThreadCount();
+	for (ndInt32 i = 0; i < threadCount; ++i)
+	{
+		ndThread* const thread = i ? (ndThread*)&m_workers[i - 1] : (ndThread*)this;
+		switch (m_affinity)
+		{
+			case m_affinityCores:
+			{
+				const ndInt32 processor = topology.m_cores[i % topology.m_cores.GetCount()];
+				thread->SetAffinity(&processor, 1);
+				break;
+			}
+
+			case m_affinityNumaNodes:
+			{
+				const ndInt32 node = i * topology.GetNodeCount() / threadCount;
+				const ndInt32 start = topology.m_nodeStart[node];
+				const ndInt32 count = topology.m_nodeStart[node + 1] - start;
+				thread->SetAffinity(&topology.m_nodeProcessors[start], count);
+				break;
+			}
+
+			case m_affinityNone:
+			default:
+			{
+				thread->SetAffinity(nullptr, 0);
+			}
+		}
 	}
 #endif
 }
@@ -171,6 +426,8 @@ void ndThreadPool::SetThreadCount(ndInt32 count)
 void ndThreadPool::Begin()
 {
 	D_TRACKTIME();
+	ndAssert(!m_inBlock);
+	m_inBlock = true;
 	for (ndInt32 i = 0; i < m_count; ++i)
 	{
 		m_workers[i].Signal();
@@ -209,6 +466,7 @@ void ndThreadPool::End()
 		}
 	} while (stillLooping);
 	#endif
+	m_inBlock = false;
 }
 
 void ndThreadPool::Release()
@@ -32,8 +32,11 @@
 
 //#define	D_USE_SYNC_SEMAPHORE
 
-//#define	D_MAX_THREADS_COUNT	16
-#define	D_MAX_THREADS_COUNT	32
+// upper bound of the thread count, no per thread storage is sized by it.
+// per thread stack arrays are allocated with ndAlloca(type, GetThreadCount()) 
+// and large per thread scratch buffers are sized at runtime with ndPerThreadArray.
+//#define	D_MAX_THREADS_COUNT	32
+#define	D_MAX_THREADS_COUNT	256
 #define D_WORKER_BATCH_SIZE	32
 
 class ndThreadPool;
@@ -92,14 +95,32 @@ class ndThreadPool: public ndSyncMutex, public ndThread
 	};
 
 	public:
+	enum ndThreadAffinity
+	{
+		// threads float freely, the operating system decides where they run.
+		m_affinityNone,
+		// each thread is pinned to its own core, one logical processor per physical core first.
+		m_affinityCores,
+		// threads are assigned in contiguous blocks to the numa nodes, 
+		// and can float between the processors of their node.
+		m_affinityNumaNodes,
+	};
+
 	D_CORE_API ndThreadPool(const char* const baseName);
 	D_CORE_API virtual ~ndThreadPool();
 
 	ndInt32 GetThreadCount() const;
 	D_CORE_API static ndInt32 GetMaxThreads();
-	D_CORE_API void SetThreadCount(ndInt32 count);
+	D_CORE_API virtual void SetThreadCount(ndInt32 count);
+
+	D_CORE_API ndThreadAffinity GetThreadAffinity() const;
+	D_CORE_API void SetThreadAffinity(ndThreadAffinity affinity);
 
 	D_CORE_API void TickOne();
+
+	/// wakes the workers for a block of ParallelExecute calls, only one
+	/// block can run at a time, so a pool that is in the middle of an update,
+	/// like the one of a world, can not be handed to other parallel code.
 	D_CORE_API void Begin();
 	D_CORE_API void End();
 
@@ -109,10 +130,14 @@ class ndThreadPool: public ndSyncMutex, public ndThread
 	private:
 	D_CORE_API virtual void Release();
 	D_CORE_API virtual void WaitForWorkers();
+	void ApplyThreadAffinity();
 
 	ndWorker* m_workers;
 	ndInt32 m_count;
+	ndThreadAffinity m_affinity;
 	char m_baseName[32];
+	// set from Begin to End
+	bool m_inBlock;
 };
 
 inline ndInt32 ndThreadPool::GetThreadCount() const
@@ -221,4 +246,19 @@ void ndThreadPool::ParallelExecute(const Function& callback)
 	}
 }
 
+/// runs the function on the threads of threadPool, or on the calling thread 
+/// when there is no pool, for code that can be called with or without one.
+template <typename Function>
+void ndParallelExecute(ndThreadPool* const threadPool, const Function& callback)
+{
+	if (threadPool)
+	{
+		threadPool->ParallelExecute(callback);
+	}
+	else
+	{
+		callback(0, 1);
+	}
+}
+
 #endif
@@ -50,12 +50,37 @@ ndInt32 ndFileFormatShapeStaticHeightfield::SaveShape(ndFileFormatSave* const sc
 	xmlSaveParam(classNode, "width", staticMesh->m_width);
 	xmlSaveParam(classNode, "height", staticMesh->m_height);
 	xmlSaveParam(classNode, "diagonalMode", ndInt32(staticMesh->m_diagonalMode));
+	if (staticMesh->IsTiled())
+	{
+		xmlSaveParam(classNode, "tileSize", staticMesh->GetTileSize());
+		xmlSaveParam(classNode, "tilesCount_x", staticMesh->m_tilesCount_x);
+		xmlSaveParam(classNode, "tilesCount_z", staticMesh->m_tilesCount_z);
+	}
 
 	FILE* const file = fopen(fileName, "wb");
 	if (file)
 	{
-		fwrite(&staticMesh->m_elevationMap[0], sizeof(ndReal), size_t(staticMesh->m_elevationMap.GetCount()), file);
-		fwrite(&staticMesh->m_atributeMap[0], sizeof(ndInt8), size_t(staticMesh->m_atributeMap.GetCount()), file);
+		if (staticMesh->IsTiled())
+		{
+			// a loaded flag per tile, followed by the samples of the loaded tiles
+			const size_t tileSamples = size_t(staticMesh->GetTileSize() * staticMesh->GetTileSize());
+			for (ndInt32 i = 0; i < staticMesh->m_tiles.GetCount(); ++i)
+			{
+				const ndShapeHeightfield::ndTile& tile = staticMesh->m_tiles[i];
+				const ndInt8 loaded = tile.m_loaded ? 1 : 0;
+				fwrite(&loaded, sizeof(ndInt8), 1, file);
+				if (tile.m_loaded)
+				{
+					fwrite(tile.m_elevation, sizeof(ndReal), tileSamples, file);
+					fwrite(tile.m_atributes, sizeof(ndInt8), tileSamples, file);
+				}
+			}
+		}
+		else
+		{
+			fwrite(&staticMesh->m_elevationMap[0], sizeof(ndReal), size_t(staticMesh->m_elevationMap.GetCount()), file);
+			fwrite(&staticMesh->m_atributeMap[0], sizeof(ndInt8), size_t(staticMesh->m_atributeMap.GetCount()), file);
+		}
 		fclose(file);
 	}
 
@@ -73,6 +98,39 @@ ndShape* ndFileFormatShapeStaticHeightfield::LoadShape(const nd::TiXmlElement* c
 	ndFloat32 horizontalScale_x = xmlGetFloat(node, "horizontalScale_x");
 	ndFloat32 horizontalScale_z = xmlGetFloat(node, "horizontalScale_z");
 
+	if (node->FirstChild("tileSize"))
+	{
+		const ndInt32 tileSize = xmlGetInt(node, "tileSize");
+		const ndInt32 tilesCount_x = xmlGetInt(node, "tilesCount_x");
+		const ndInt32 tilesCount_z = xmlGetInt(node, "tilesCount_z");
+		ndShapeHeightfield* const staticMesh = new ndShapeHeightfield(tilesCount_x, tilesCount_z, tileSize, ndShapeHeightfield::ndGridConstruction(diagonalMode), horizontalScale_x, horizontalScale_z);
+
+		FILE* const file = fopen(filename, "rb");
+		if (file)
+		{
+			ndArray<ndReal> elevation;
+			ndArray<ndInt8> atributes;
+			elevation.SetCount(tileSize * tileSize);
+			atributes.SetCount(tileSize * tileSize);
+			for (ndInt32 z = 0; z < tilesCount_z; ++z)
+			{
+				for (ndInt32 x = 0; x < tilesCount_x; ++x)
+				{
+					ndInt8 loaded = 0;
+					size_t ret = fread(&loaded, sizeof(ndInt8), 1, file);
+					if (ret && loaded)
+					{
+						ret = fread(&elevation[0], sizeof(ndReal), size_t(elevation.GetCount()), file);
+						ret = fread(&atributes[0], sizeof(ndInt8), size_t(atributes.GetCount()), file);
+						staticMesh->LoadTile(x, z, &elevation[0], &atributes[0]);
+					}
+				}
+			}
+			fclose(file);
+		}
+		return staticMesh;
+	}
+
 	ndShapeHeightfield* const staticMesh = new ndShapeHeightfield(width, height, ndShapeHeightfield::ndGridConstruction (diagonalMode), horizontalScale_x, horizontalScale_z);
 
 	FILE* const file = fopen(filename, "rb");
@@ -86,5 +144,6 @@ ndShape* ndFileFormatShapeStaticHeightfield::LoadShape(const nd::TiXmlElement* c
 		ret = fread(&staticMesh->m_atributeMap[0], sizeof(ndInt8), size_t(staticMesh->m_atributeMap.GetCount()), file);
 		fclose(file);
 	}
+	staticMesh->UpdateElevationMapAabb();
 	return staticMesh;
 }
\ No newline at end of file
@@ -51,11 +51,6 @@ ndInt32 ndFileFormatShapeStaticMesh_bvh::SaveShape(ndFileFormatSave* const scene
 ndShape* ndFileFormatShapeStaticMesh_bvh::LoadShape(const nd::TiXmlElement* const node, const ndTree<ndShape*, ndInt32>&)
 {
 	const char* const filename = xmlGetString(node, "assetName");
-	ndInt32 triangleCount = xmlGetInt(node, "triangleCount");
-
-	ndShapeStatic_bvh* const staticMesh = new ndShapeStatic_bvh();
-
-	staticMesh->Deserialize(filename);
-	staticMesh->m_trianglesCount = triangleCount;
+	ndShapeStatic_bvh* const staticMesh = new ndShapeStatic_bvh(filename);
 	return staticMesh;
 }
\ No newline at end of file
@@ -775,7 +775,7 @@ void ndDynamicsUpdateAvx2::SortIslands()
 	GetInternalForces().SetCount(bodyArray.GetCount());
 	activeBodyArray.SetCount(bodyArray.GetCount());
 
-	ndInt32 histogram[D_MAX_THREADS_COUNT][3];
+	ndInt32 (*const histogram)[3] = (ndInt32 (*)[3])ndAlloca(ndInt32, 3 * scene->GetThreadCount());
 	auto Scan0 = ndMakeObject::ndFunction([&bodyArray, &histogram](ndInt32 threadIndex, ndInt32 threadCount)
 	{
 		D_TRACKTIME_NAMED(Scan0);
@@ -945,7 +945,7 @@ void ndDynamicsUpdateAvx2::InitWeights()
 	const ndInt32 bodyCount = bodyArray.GetCount();
 	GetInternalForces().SetCount(bodyCount);
 
-	ndInt32 extraPassesArray[D_MAX_THREADS_COUNT];
+	ndInt32* const extraPassesArray = ndAlloca(ndInt32, scene->GetThreadCount());
 
 	ndAtomic<ndInt32> iterator(0);
 	auto InitWeights = ndMakeObject::ndFunction([this, &iterator, &bodyArray, &extraPassesArray](ndInt32 threadIndex, ndInt32)
@@ -1186,7 +1186,7 @@ void ndDynamicsUpdateAvx2::InitJacobianMatrix()
 				rhs->m_deltaAccel = extenalAcceleration;
 				rhs->m_coordenateAccel += extenalAcceleration;
 				ndAssert(rhs->m_jointFeebackForce);
-				const ndFloat32 force = rhs->m_jointFeebackForce->GetInitialGuess();
+				const ndFloat32 force = isBilateral ? rhs->m_jointFeebackForce->GetInitialGuess() : rhs->m_jointFeebackForce->GetWarmStart();
 
 				rhs->m_force = isBilateral ? ndClamp(force, rhs->m_lowerBoundFrictionCoefficent, rhs->m_upperBoundFrictionCoefficent) : force;
 				rhs->m_maxImpact = ndFloat32(0.0f);
@@ -0,0 +1,238 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+*
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndCoreStdafx.h"
+#include "ndNewtonStdafx.h"
+#include "ndBodyStateBuffer.h"
+
+ndMatrix ndBodyState::GetMatrix() const
+{
+	return ndCalculateMatrix(m_rotation, m_posit);
+}
+
+ndMatrix ndBodyState::GetInterpolatedMatrix(ndFloat32 param) const
+{
+	// take the short arc, the two rotations can be on opposite hemispheres
+	const ndQuaternion prevRotation((m_prevRotation.DotProduct(m_rotation).GetScalar() < ndFloat32(0.0f)) ? m_prevRotation.Scale(ndFloat32(-1.0f)) : m_prevRotation);
+	const ndQuaternion rotation(prevRotation.Slerp(m_rotation, param));
+	const ndVector posit(m_prevPosit + (m_posit - m_prevPosit).Scale(param));
+	return ndCalculateMatrix(rotation, posit);
+}
+
+const ndBodyState* ndBodyStateFrame::FindState(ndUnsigned32 bodyId) const
+{
+	ndInt32 i0 = 0;
+	ndInt32 i1 = m_states.GetCount() - 1;
+	while (i0 <= i1)
+	{
+		const ndInt32 mid = (i0 + i1) >> 1;
+		const ndUnsigned32 id = m_states[mid].m_bodyId;
+		if (id == bodyId)
+		{
+			return &m_states[mid];
+		}
+		else if (id < bodyId)
+		{
+			i0 = mid + 1;
+		}
+		else
+		{
+			i1 = mid - 1;
+		}
+	}
+	return nullptr;
+}
+
+const ndBodyState* ndBodyStateFrame::FindState(const ndBody* const body) const
+{
+	return FindState(body->GetId());
+}
+
+ndBodyStateBuffer::ndSnapshot::ndSnapshot(const ndBodyStateBuffer& buffer)
+	:m_frame(nullptr)
+{
+	// pin the latest frame, and retry if the update published
+	// a new frame before the pin was visible to it.
+	for (ndInt32 latest = buffer.m_latest.load(); latest >= 0; latest = buffer.m_latest.load())
+	{
+		ndBodyStateFrame* const frame = (ndBodyStateFrame*)&buffer.m_frames[latest];
+		frame->m_readers.fetch_add(1);
+		if (buffer.m_latest.load() == latest)
+		{
+			m_frame = frame;
+			break;
+		}
+		frame->m_readers.fetch_add(-1);
+	}
+}
+
+ndBodyStateBuffer::ndSnapshot::~ndSnapshot()
+{
+	if (m_frame)
+	{
+		m_frame->m_readers.fetch_add(-1);
+	}
+}
+
+ndBodyStateBuffer::ndBodyStateBuffer()
+	:ndClassAlloc()
+	,m_view()
+	,m_viewIds()
+	,m_bodies()
+	,m_latest(-1)
+{
+}
+
+ndBodyStateBuffer::~ndBodyStateBuffer()
+{
+}
+
+ndUnsigned32 ndBodyStateBuffer::GetFrameNumber() const
+{
+	const ndSnapshot snapshot(*this);
+	return snapshot.GetFrame() ? snapshot.GetFrame()->GetFrameNumber() : 0;
+}
+
+void ndBodyStateBuffer::Reset()
+{
+	// no reader can hold a frame here
+	m_latest.store(-1);
+	for (ndInt32 i = 0; i < D_BODY_STATE_FRAMES; ++i)
+	{
+		ndAssert(m_frames[i].m_readers.load() == 0);
+		m_frames[i].m_states.SetCount(0);
+		m_frames[i].m_frameNumber = 0;
+	}
+	m_view.SetCount(0);
+	m_viewIds.SetCount(0);
+	m_bodies.SetCount(0);
+}
+
+void ndBodyStateBuffer::SortBodies(const ndArray<ndBodyKinematic*>& view)
+{
+	// the view only changes when bodies are added or removed,
+	// so most frames reuse the order of the previous one. the ids are
+	// compared too, a new body can be allocated where a deleted one was.
+	const ndInt32 count = view.GetCount() - 1;
+	bool changed = (count != m_view.GetCount());
+	for (ndInt32 i = 0; !changed && (i < count); ++i)
+	{
+		changed = (view[i] != m_view[i]) || (view[i]->GetId() != m_viewIds[i]);
+	}
+	if (!changed)
+	{
+		return;
+	}
+
+	class ndCompareKey
+	{
+		public:
+		ndCompareKey(const void* const)
+		{
+		}
+
+		ndInt32 Compare(const ndBodyKinematic* const bodyA, const ndBodyKinematic* const bodyB) const
+		{
+			const ndUnsigned32 idA = bodyA->GetId();
+			const ndUnsigned32 idB = bodyB->GetId();
+			if (idA < idB)
+			{
+				return -1;
+			}
+			else if (idA > idB)
+			{
+				return 1;
+			}
+			return 0;
+		}
+	};
+
+	m_view.SetCount(count);
+	m_viewIds.SetCount(count);
+	m_bodies.SetCount(count);
+	for (ndInt32 i = 0; i < count; ++i)
+	{
+		m_view[i] = view[i];
+		m_viewIds[i] = view[i]->GetId();
+		m_bodies[i] = view[i];
+	}
+	if (count)
+	{
+		ndSort<ndBodyKinematic*, ndCompareKey>(&m_bodies[0], count, nullptr);
+	}
+}
+
+void ndBodyStateBuffer::Publish(ndScene* const scene, ndFloat32 timestep, ndUnsigned32 frameNumber)
+{
+	D_TRACKTIME();
+	const ndInt32 latest = m_latest.load();
+	ndBodyStateFrame* frame = nullptr;
+	for (ndInt32 i = 0; i < D_BODY_STATE_FRAMES; ++i)
+	{
+		if ((i != latest) && (m_frames[i].m_readers.load() == 0))
+		{
+			frame = &m_frames[i];
+			break;
+		}
+	}
+	if (!frame)
+	{
+		// readers hold all the other frames, they keep reading the last one.
+		return;
+	}
+
+	SortBodies(scene->GetActiveBodyArray());
+
+	const ndBodyStateFrame* const prevFrame = (latest >= 0) ? &m_frames[latest] : nullptr;
+	frame->m_states.SetCount(m_bodies.GetCount());
+	auto CopyStates = ndMakeObject::ndFunction([this, frame, prevFrame](ndInt32 threadIndex, ndInt32 threadCount)
+	{
+		D_TRACKTIME_NAMED(CopyStates);
+		const ndStartEnd startEnd(m_bodies.GetCount(), threadIndex, threadCount);
+		for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
+		{
+			const ndBodyKinematic* const body = m_bodies[i];
+			ndBodyState& state = frame->m_states[i];
+			state.m_rotation = body->GetRotation();
+			state.m_posit = body->GetMatrix().m_posit;
+			state.m_veloc = body->GetVelocity();
+			state.m_omega = body->GetOmega();
+			state.m_body = body;
+			state.m_bodyId = body->GetId();
+
+			// the previous frame has the same order unless bodies were added or removed
+			const ndBodyState* prevState = nullptr;
+			if (prevFrame)
+			{
+				const ndArray<ndBodyState>& prevStates = prevFrame->m_states;
+				const bool sameIndex = (i < prevStates.GetCount()) && (prevStates[i].m_bodyId == state.m_bodyId);
+				prevState = sameIndex ? &prevStates[i] : prevFrame->FindState(state.m_bodyId);
+			}
+			state.m_prevRotation = prevState ? prevState->m_rotation : state.m_rotation;
+			state.m_prevPosit = prevState ? prevState->m_posit : state.m_posit;
+		}
+	});
+	scene->ParallelExecute(CopyStates);
+
+	frame->m_timestep = timestep;
+	frame->m_frameNumber = frameNumber;
+	m_latest.store(ndInt32(frame - m_frames));
+}
@@ -0,0 +1,155 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+*
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __ND_BODY_STATE_BUFFER_H__
+#define __ND_BODY_STATE_BUFFER_H__
+
+#include "ndNewtonStdafx.h"
+
+class ndBody;
+class ndScene;
+class ndBodyKinematic;
+
+// number of frames in the ring, the last published frame, the frame
+// being written by the update and a spare one for slow readers.
+#define D_BODY_STATE_FRAMES		3
+
+/// the state of a body at the end of a frame, and its pose at the end of the frame before.
+D_MSV_NEWTON_ALIGN_32
+class ndBodyState
+{
+	public:
+	D_NEWTON_API ndMatrix GetMatrix() const;
+
+	/// the pose at param between the end of the previous frame (zero) and the end of this frame (one).
+	D_NEWTON_API ndMatrix GetInterpolatedMatrix(ndFloat32 param) const;
+
+	ndQuaternion m_rotation;
+	ndQuaternion m_prevRotation;
+	ndVector m_posit;
+	ndVector m_prevPosit;
+	ndVector m_veloc;
+	ndVector m_omega;
+
+	// for identification only, the body may have been deleted since the frame was published.
+	const ndBodyKinematic* m_body;
+	ndUnsigned32 m_bodyId;
+} D_GCC_NEWTON_ALIGN_32;
+
+/// a consistent copy of the state of all bodies at the end of one update.
+class ndBodyStateFrame : public ndClassAlloc
+{
+	public:
+	ndBodyStateFrame();
+
+	/// the states sorted by body id.
+	const ndArray<ndBodyState>& GetStates() const;
+
+	/// nullptr if the body was not in the world when the frame was published.
+	D_NEWTON_API const ndBodyState* FindState(ndUnsigned32 bodyId) const;
+	D_NEWTON_API const ndBodyState* FindState(const ndBody* const body) const;
+
+	/// the value of ndWorld::GetFrameNumber after the update that published the frame.
+	ndUnsigned32 GetFrameNumber() const;
+	ndFloat32 GetTimestep() const;
+
+	private:
+	ndArray<ndBodyState> m_states;
+	ndAtomic<ndInt32> m_readers;
+	ndFloat32 m_timestep;
+	ndUnsigned32 m_frameNumber;
+
+	friend class ndBodyStateBuffer;
+};
+
+/// the state of the bodies published at the end of each update, so that other
+/// threads can read the last completed frame while the next one is simulated.
+/// the update writes into a frame that no reader holds and then makes it the
+/// latest with a single atomic store, readers never block the update or each other.
+class ndBodyStateBuffer : public ndClassAlloc
+{
+	public:
+	/// holds the latest published frame for the lifetime of the object.
+	/// hold it for about the duration of a frame, while all the frames of
+	/// the ring are held by readers the update skips publishing.
+	class ndSnapshot
+	{
+		public:
+		D_NEWTON_API ndSnapshot(const ndBodyStateBuffer& buffer);
+		D_NEWTON_API ~ndSnapshot();
+
+		/// nullptr until the first frame is published.
+		const ndBodyStateFrame* GetFrame() const;
+
+		private:
+		ndBodyStateFrame* m_frame;
+	};
+
+	D_NEWTON_API ndBodyStateBuffer();
+	D_NEWTON_API ~ndBodyStateBuffer();
+
+	/// the number of the last published frame, zero if none.
+	D_NEWTON_API ndUnsigned32 GetFrameNumber() const;
+
+	private:
+	void Reset();
+	void Publish(ndScene* const scene, ndFloat32 timestep, ndUnsigned32 frameNumber);
+	void SortBodies(const ndArray<ndBodyKinematic*>& view);
+
+	ndBodyStateFrame m_frames[D_BODY_STATE_FRAMES];
+	ndArray<ndBodyKinematic*> m_view;
+	ndArray<ndUnsigned32> m_viewIds;
+	ndArray<ndBodyKinematic*> m_bodies;
+	mutable ndAtomic<ndInt32> m_latest;
+
+	friend class ndWorld;
+};
+
+inline ndBodyStateFrame::ndBodyStateFrame()
+	:ndClassAlloc()
+	,m_states()
+	,m_readers(0)
+	,m_timestep(ndFloat32(0.0f))
+	,m_frameNumber(0)
+{
+}
+
+inline const ndArray<ndBodyState>& ndBodyStateFrame::GetStates() const
+{
+	return m_states;
+}
+
+inline ndUnsigned32 ndBodyStateFrame::GetFrameNumber() const
+{
+	return m_frameNumber;
+}
+
+inline ndFloat32 ndBodyStateFrame::GetTimestep() const
+{
+	return m_timestep;
+}
+
+inline const ndBodyStateFrame* ndBodyStateBuffer::ndSnapshot::GetFrame() const
+{
+	return m_frame;
+}
+
+#endif
@@ -140,8 +140,9 @@ void ndDynamicsUpdate::SortBodyJointScan()
 	});
 	scene->ParallelExecute(EnumerateJointBodyPairs);
 
-	scene->GetScratchBuffer().SetCount(bodyJointPairs.GetCount() * ndInt32 (sizeof (ndJointBodyPairIndex)));
-	ndJointBodyPairIndex* const tempBuffer = (ndJointBodyPairIndex*)&scene->GetScratchBuffer()[0];
+	ndFrameAllocator& frameAllocator = scene->GetFrameAllocator();
+	ndFrameAllocator::ndScope frameScope(&frameAllocator, 0);
+	ndJointBodyPairIndex* const tempBuffer = frameAllocator.Alloc<ndJointBodyPairIndex>(0, bodyJointPairs.GetCount());
 
 	ndCountingSort<ndJointBodyPairIndex, ndEvaluateKey0, D_MAX_BODY_RADIX_BIT>(*scene, &bodyJointPairs[0], tempBuffer, bodyJointPairs.GetCount(), nullptr, nullptr);
 	ndCountingSort<ndJointBodyPairIndex, ndEvaluateKey1, D_MAX_BODY_RADIX_BIT>(*scene, tempBuffer, &bodyJointPairs[0], bodyJointPairs.GetCount(), nullptr, nullptr);
@@ -261,9 +262,13 @@ void ndDynamicsUpdate::SortJointsScan()
 	
 	m_leftHandSide.SetCount(jointArray.GetCount() + 32);
 	
-	ndInt32 histogram[D_MAX_THREADS_COUNT][2];
-	ndInt32 movingJoints[D_MAX_THREADS_COUNT];
 	const ndInt32 threadCount = scene->GetThreadCount();
+	ndInt32 (*const histogram)[2] = (ndInt32 (*)[2])ndAlloca(ndInt32, 2 * threadCount);
+	ndInt32* const movingJoints = ndAlloca(ndInt32, threadCount);
+
+	ndFrameAllocator& frameAllocator = scene->GetFrameAllocator();
+	ndFrameAllocator::ndScope frameScope(&frameAllocator, 0);
+	ndConstraint** const tempJointBuffer = frameAllocator.Alloc<ndConstraint*>(0, jointArray.GetCount() + 32);
 	
 	ndAtomic<ndInt32> iterator(0);
 	auto MarkFence0 = ndMakeObject::ndFunction([this, &iterator, &jointArray](ndInt32, ndInt32)
@@ -327,12 +332,11 @@ void ndDynamicsUpdate::SortJointsScan()
 		movingJoints[threadIndex] = activeJointCount;
 	});
 	
-	auto Scan0 = ndMakeObject::ndFunction([&jointArray, &histogram, scene](ndInt32 threadIndex, ndInt32 threadCount)
+	auto Scan0 = ndMakeObject::ndFunction([&jointArray, &histogram, tempJointBuffer](ndInt32 threadIndex, ndInt32 threadCount)
 	{
 		D_TRACKTIME_NAMED(Scan0);
 		ndInt32* const hist = &histogram[threadIndex][0];
-		ndAssert(scene->GetScratchBuffer().GetCount() >= ndInt32 (jointArray.GetCount() * sizeof(ndConstraint*)));
-		ndConstraint** const dstBuffer = (ndConstraint**)&scene->GetScratchBuffer()[0];
+		ndConstraint** const dstBuffer = tempJointBuffer;
 	
 		hist[0] = 0;
 		hist[1] = 0;
@@ -350,12 +354,11 @@ void ndDynamicsUpdate::SortJointsScan()
 		}
 	});
 	
-	auto Sort0 = ndMakeObject::ndFunction([&jointArray, &histogram, scene](ndInt32 threadIndex, ndInt32 threadCount)
+	auto Sort0 = ndMakeObject::ndFunction([&jointArray, &histogram, tempJointBuffer](ndInt32 threadIndex, ndInt32 threadCount)
 	{
 		D_TRACKTIME_NAMED(Sort0);
 		ndInt32* const hist = &histogram[threadIndex][0];
-		ndAssert(scene->GetScratchBuffer().GetCount() >= ndInt32 (jointArray.GetCount() * sizeof (ndConstraint*)));
-		ndConstraint** const dstBuffer = (ndConstraint**)&scene->GetScratchBuffer()[0];
+		ndConstraint** const dstBuffer = tempJointBuffer;
 	
 		const ndStartEnd startEnd(jointArray.GetCount(), threadIndex, threadCount);
 		for (ndInt32 i = startEnd.m_start; i < startEnd.m_end; ++i)
@@ -370,9 +373,6 @@ void ndDynamicsUpdate::SortJointsScan()
 		}
 	});
 	
-	scene->GetScratchBuffer().SetCount((jointArray.GetCount() + 32) * ndInt32 (sizeof (ndConstraint*)));
-	ndConstraint** const tempJointBuffer = (ndConstraint**)&scene->GetScratchBuffer()[0];
-	
 	scene->ParallelExecute(MarkFence0);
 	scene->ParallelExecute(MarkFence1);
 	scene->ParallelExecute(Scan0);
@@ -496,7 +496,7 @@ void ndDynamicsUpdate::SortIslands()
 	GetInternalForces().SetCount(bodyArray.GetCount());
 	activeBodyArray.SetCount(bodyArray.GetCount());
 
-	ndInt32 histogram[D_MAX_THREADS_COUNT][3];
+	ndInt32 (*const histogram)[3] = (ndInt32 (*)[3])ndAlloca(ndInt32, 3 * scene->GetThreadCount());
 	auto Scan0 = ndMakeObject::ndFunction([&bodyArray, &histogram](ndInt32 threadIndex, ndInt32 threadCount)
 	{
 		D_TRACKTIME_NAMED(Scan0);
@@ -630,7 +630,7 @@ void ndDynamicsUpdate::InitWeights()
 	const ndInt32 bodyCount = bodyArray.GetCount();
 	GetInternalForces().SetCount(bodyCount);
 
-	ndInt32 extraPassesArray[D_MAX_THREADS_COUNT];
+	ndInt32* const extraPassesArray = ndAlloca(ndInt32, scene->GetThreadCount());
 
 	ndAtomic<ndInt32> iterator(0);
 	auto InitWeights = ndMakeObject::ndFunction([this, &iterator, &bodyArray, &extraPassesArray](ndInt32 threadIndex, ndInt32)
@@ -879,7 +879,7 @@ void ndDynamicsUpdate::InitJacobianMatrix()
 				rhs->m_deltaAccel = extenalAcceleration;
 				rhs->m_coordenateAccel += extenalAcceleration;
 				ndAssert(rhs->m_jointFeebackForce);
-				const ndFloat32 force = rhs->m_jointFeebackForce->GetInitialGuess();
+				const ndFloat32 force = isBilateral ? rhs->m_jointFeebackForce->GetInitialGuess() : rhs->m_jointFeebackForce->GetWarmStart();
 
 				rhs->m_force = isBilateral ? ndClamp(force, rhs->m_lowerBoundFrictionCoefficent, rhs->m_upperBoundFrictionCoefficent) : force;
 				rhs->m_maxImpact = ndFloat32(0.0f);
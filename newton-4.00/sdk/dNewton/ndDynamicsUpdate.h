@@ -91,7 +91,7 @@ class ndDynamicsUpdate : public ndClassAlloc
 	ndArray<ndBodyKinematic*>& GetBodyIslandOrder();
 	ndArray<ndJointBodyPairIndex>& GetJointBodyPairIndexBuffer();
 
-	private:
+	protected:
 	void SortJoints();
 	void SortIslands();
 	void BuildIsland();
@@ -111,7 +111,6 @@ class ndDynamicsUpdate : public ndClassAlloc
 	void DetermineSleepStates();
 	void GetJacobianDerivatives(ndConstraint* const joint);
 
-	protected:
 	void Clear();
 	virtual void Update();
 	void SortJointsScan();
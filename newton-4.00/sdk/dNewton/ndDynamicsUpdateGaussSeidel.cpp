@@ -0,0 +1,442 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+*
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ndCoreStdafx.h"
+#include "ndNewtonStdafx.h"
+#include "ndWorld.h"
+#include "ndBodyDynamic.h"
+#include "ndDynamicsUpdateGaussSeidel.h"
+
+ndDynamicsUpdateGaussSeidel::ndDynamicsUpdateGaussSeidel(ndWorld* const world)
+	:ndDynamicsUpdate(world)
+	,m_colorStart(D_GAUSS_SEIDEL_MAX_COLORS + 2)
+	,m_jointColor(1024)
+	,m_bodyColors(1024)
+	,m_coloredJoints(1024)
+{
+}
+
+ndDynamicsUpdateGaussSeidel::~ndDynamicsUpdateGaussSeidel()
+{
+	Clear();
+}
+
+const char* ndDynamicsUpdateGaussSeidel::GetStringId() const
+{
+	return "gauss seidel";
+}
+
+void ndDynamicsUpdateGaussSeidel::ColorJoints()
+{
+	D_TRACKTIME();
+	ndScene* const scene = m_world->GetScene();
+	const ndArray<ndConstraint*>& jointArray = scene->GetActiveContactArray();
+	const ndInt32 jointCount = jointArray.GetCount();
+
+	m_jointColor.SetCount(jointCount);
+	m_coloredJoints.SetCount(jointCount);
+	m_bodyColors.SetCount(scene->GetActiveBodyArray().GetCount());
+	ndMemSet(&m_bodyColors[0], ndUnsigned64(0), m_bodyColors.GetCount());
+
+	// greedy coloring, static bodies do not receive forces,
+	// so they do not constrain the colors of the joints attached to them.
+	ndInt32 colorCount = 0;
+	ndInt32 histogram[D_GAUSS_SEIDEL_MAX_COLORS + 1];
+	ndMemSet(histogram, 0, D_GAUSS_SEIDEL_MAX_COLORS + 1);
+	for (ndInt32 i = 0; i < jointCount; ++i)
+	{
+		const ndConstraint* const joint = jointArray[i];
+		const ndBodyKinematic* const body0 = joint->GetBody0();
+		const ndBodyKinematic* const body1 = joint->GetBody1();
+		const ndInt32 m0 = body0->m_index;
+		const ndInt32 m1 = body1->m_index;
+		const ndUnsigned64 mask0 = body0->m_isStatic ? ndUnsigned64(0) : m_bodyColors[m0];
+		const ndUnsigned64 mask1 = body1->m_isStatic ? ndUnsigned64(0) : m_bodyColors[m1];
+		const ndUnsigned64 freeColors = ~(mask0 | mask1);
+
+		ndInt32 color = D_GAUSS_SEIDEL_MAX_COLORS;
+		if (freeColors)
+		{
+			ndUnsigned64 bit = freeColors & (~freeColors + 1);
+			color = 0;
+			while (bit > 1)
+			{
+				bit >>= 1;
+				color++;
+			}
+			const ndUnsigned64 colorMask = ndUnsigned64(1) << color;
+			if (!body0->m_isStatic)
+			{
+				m_bodyColors[m0] |= colorMask;
+			}
+			if (!body1->m_isStatic)
+			{
+				m_bodyColors[m1] |= colorMask;
+			}
+			colorCount = ndMax(colorCount, color + 1);
+		}
+		m_jointColor[i] = ndUnsigned8(color);
+		histogram[color]++;
+	}
+
+	// the last slot is the batch of joints that ran out of colors
+	histogram[colorCount] = histogram[D_GAUSS_SEIDEL_MAX_COLORS];
+	m_colorStart.SetCount(colorCount + 2);
+	ndInt32 sum = 0;
+	for (ndInt32 i = 0; i <= colorCount; ++i)
+	{
+		m_colorStart[i] = sum;
+		sum += histogram[i];
+		histogram[i] = m_colorStart[i];
+	}
+	m_colorStart[colorCount + 1] = sum;
+	ndAssert(sum == jointCount);
+
+	for (ndInt32 i = 0; i < jointCount; ++i)
+	{
+		const ndInt32 color = ndMin(ndInt32(m_jointColor[i]), colorCount);
+		const ndInt32 index = histogram[color];
+		histogram[color] = index + 1;
+		m_coloredJoints[index] = jointArray[i];
+	}
+}
+
+void ndDynamicsUpdateGaussSeidel::InitDiagonal()
+{
+	D_TRACKTIME();
+	ndScene* const scene = m_world->GetScene();
+	const ndArray<ndConstraint*>& jointArray = scene->GetActiveContactArray();
+
+	// InitJacobianMatrix scales the diagonal by the Jacobi body weights,
+	// Gauss Seidel uses the unscaled effective mass of each row.
+	ndAtomic<ndInt32> iterator(0);
+	auto InitDiagonal = ndMakeObject::ndFunction([this, &iterator, &jointArray](ndInt32, ndInt32)
+	{
+		D_TRACKTIME_NAMED(InitDiagonal);
+		const ndInt32 jointCount = jointArray.GetCount();
+		for (ndInt32 i = iterator.fetch_add(D_WORKER_BATCH_SIZE); i < jointCount; i = iterator.fetch_add(D_WORKER_BATCH_SIZE))
+		{
+			const ndInt32 maxSpan = ((jointCount - i) >= D_WORKER_BATCH_SIZE) ? D_WORKER_BATCH_SIZE : jointCount - i;
+			for (ndInt32 j = 0; j < maxSpan; ++j)
+			{
+				const ndConstraint* const joint = jointArray[i + j];
+				const ndInt32 index = joint->m_rowStart;
+				const ndInt32 count = joint->m_rowCount;
+				for (ndInt32 k = 0; k < count; ++k)
+				{
+					const ndLeftHandSide* const row = &m_leftHandSide[index + k];
+					ndRightHandSide* const rhs = &m_rightHandSide[index + k];
+
+					const ndJacobian& JtM0 = row->m_Jt.m_jacobianM0;
+					const ndJacobian& JtM1 = row->m_Jt.m_jacobianM1;
+					const ndJacobian& JMinvM0 = row->m_JMinv.m_jacobianM0;
+					const ndJacobian& JMinvM1 = row->m_JMinv.m_jacobianM1;
+					const ndVector tmpDiag(
+						JMinvM0.m_linear * JtM0.m_linear + JMinvM0.m_angular * JtM0.m_angular +
+						JMinvM1.m_linear * JtM1.m_linear + JMinvM1.m_angular * JtM1.m_angular);
+
+					ndFloat32 diag = tmpDiag.AddHorizontal().GetScalar();
+					ndAssert(diag > ndFloat32(0.0f));
+					rhs->m_diagDamp = diag * rhs->m_diagonalRegularizer;
+
+					diag *= (ndFloat32(1.0f) + rhs->m_diagonalRegularizer);
+					rhs->m_invJinvMJt = ndFloat32(1.0f) / diag;
+				}
+			}
+		}
+	});
+
+	if (jointArray.GetCount())
+	{
+		scene->ParallelExecute(InitDiagonal);
+	}
+}
+
+void ndDynamicsUpdateGaussSeidel::AccumulateJointForces()
+{
+	D_TRACKTIME();
+	ndScene* const scene = m_world->GetScene();
+	ndArray<ndBodyKinematic*>& bodyArray = scene->GetActiveBodyArray();
+	ndArray<ndConstraint*>& jointArray = scene->GetActiveContactArray();
+
+	// rebuild the body forces from the joint forces, this discards
+	// the skeleton reactions added to the body forces by the previous sub step
+	ndAtomic<ndInt32> iterator0(0);
+	auto CalculateJointPartialForces = ndMakeObject::ndFunction([this, &iterator0, &jointArray](ndInt32, ndInt32)
+	{
+		D_TRACKTIME_NAMED(CalculateJointPartialForces);
+		const ndVector zero(ndVector::m_zero);
+		ndJacobian* const jointPartialForces = &GetTempInternalForces()[0];
+
+		const ndInt32 jointCount = jointArray.GetCount();
+		for (ndInt32 i = iterator0.fetch_add(D_WORKER_BATCH_SIZE); i < jointCount; i = iterator0.fetch_add(D_WORKER_BATCH_SIZE))
+		{
+			const ndInt32 maxSpan = ((jointCount - i) >= D_WORKER_BATCH_SIZE) ? D_WORKER_BATCH_SIZE : jointCount - i;
+			for (ndInt32 j = 0; j < maxSpan; ++j)
+			{
+				const ndConstraint* const joint = jointArray[i + j];
+				const ndInt32 rowStart = joint->m_rowStart;
+				const ndInt32 rowsCount = joint->m_rowCount;
+
+				ndVector forceM0(zero);
+				ndVector torqueM0(zero);
+				ndVector forceM1(zero);
+				ndVector torqueM1(zero);
+				for (ndInt32 k = 0; k < rowsCount; ++k)
+				{
+					const ndRightHandSide* const rhs = &m_rightHandSide[rowStart + k];
+					const ndLeftHandSide* const lhs = &m_leftHandSide[rowStart + k];
+
+					const ndVector f(rhs->m_force);
+					forceM0 = forceM0.MulAdd(lhs->m_Jt.m_jacobianM0.m_linear, f);
+					torqueM0 = torqueM0.MulAdd(lhs->m_Jt.m_jacobianM0.m_angular, f);
+					forceM1 = forceM1.MulAdd(lhs->m_Jt.m_jacobianM1.m_linear, f);
+					torqueM1 = torqueM1.MulAdd(lhs->m_Jt.m_jacobianM1.m_angular, f);
+				}
+
+				ndJacobian& outBody0 = jointPartialForces[(i + j) * 2 + 0];
+				outBody0.m_linear = forceM0;
+				outBody0.m_angular = torqueM0;
+
+				ndJacobian& outBody1 = jointPartialForces[(i + j) * 2 + 1];
+				outBody1.m_linear = forceM1;
+				outBody1.m_angular = torqueM1;
+			}
+		}
+	});
+
+	ndAtomic<ndInt32> iterator1(0);
+	auto AccumulatePartialForces = ndMakeObject::ndFunction([this, &iterator1, &bodyArray](ndInt32, ndInt32)
+	{
+		D_TRACKTIME_NAMED(AccumulatePartialForces);
+		const ndVector zero(ndVector::m_zero);
+
+		ndJacobian* const internalForces = &GetInternalForces()[0];
+		const ndInt32* const bodyIndex = &GetJointForceIndexBuffer()[0];
+
+		const ndJacobian* const jointInternalForces = &GetTempInternalForces()[0];
+		const ndJointBodyPairIndex* const jointBodyPairIndexBuffer = &GetJointBodyPairIndexBuffer()[0];
+
+		const ndInt32 bodyCount = bodyArray.GetCount();
+		for (ndInt32 i = iterator1.fetch_add(D_WORKER_BATCH_SIZE); i < bodyCount; i = iterator1.fetch_add(D_WORKER_BATCH_SIZE))
+		{
+			const ndInt32 maxSpan = ((bodyCount - i) >= D_WORKER_BATCH_SIZE) ? D_WORKER_BATCH_SIZE : bodyCount - i;
+			for (ndInt32 j = 0; j < maxSpan; ++j)
+			{
+				ndVector force(zero);
+				ndVector torque(zero);
+				const ndInt32 m = i + j;
+				const ndBodyKinematic* const body = bodyArray[m];
+
+				const ndInt32 startIndex = bodyIndex[m];
+				const ndInt32 mask = body->m_isStatic - 1;
+				const ndInt32 count = mask & (bodyIndex[m + 1] - startIndex);
+				for (ndInt32 k = 0; k < count; ++k)
+				{
+					const ndInt32 index = jointBodyPairIndexBuffer[startIndex + k].m_joint;
+					force += jointInternalForces[index].m_linear;
+					torque += jointInternalForces[index].m_angular;
+				}
+				internalForces[m].m_linear = force;
+				internalForces[m].m_angular = torque;
+			}
+		}
+	});
+
+	scene->ParallelExecute(CalculateJointPartialForces);
+	scene->ParallelExecute(AccumulatePartialForces);
+}
+
+void ndDynamicsUpdateGaussSeidel::CalculateJointsForce()
+{
+	D_TRACKTIME();
+	ndScene* const scene = m_world->GetScene();
+	const ndUnsigned32 passes = m_solverPasses;
+
+	AccumulateJointForces();
+
+	// solves one joint in place, the body forces of the joint are read
+	// and written directly, so no other joint in flight can share a dynamic body.
+	auto JointForce = [this](ndConstraint* const joint)
+	{
+		ndBodyKinematic* const body0 = joint->GetBody0();
+		ndBodyKinematic* const body1 = joint->GetBody1();
+		ndAssert(body0);
+		ndAssert(body1);
+
+		const ndInt32 m0 = body0->m_index;
+		const ndInt32 m1 = body1->m_index;
+		const ndInt32 rowStart = joint->m_rowStart;
+		const ndInt32 rowsCount = joint->m_rowCount;
+
+		const ndInt32 resting = body0->m_equilibrium0 & body1->m_equilibrium0;
+		if (!resting)
+		{
+			const ndVector zero(ndVector::m_zero);
+			ndVector forceM0(m_internalForces[m0].m_linear);
+			ndVector torqueM0(m_internalForces[m0].m_angular);
+			ndVector forceM1(m_internalForces[m1].m_linear);
+			ndVector torqueM1(m_internalForces[m1].m_angular);
+
+			const ndFloat32 tol = ndFloat32(0.125f);
+			const ndFloat32 tol2 = tol * tol;
+			ndVector maxAccel(tol2 * ndFloat32(2.0f));
+			for (ndInt32 k = 0; (k < 4) && (maxAccel.GetScalar() > tol2); ++k)
+			{
+				maxAccel = zero;
+				for (ndInt32 j = 0; j < rowsCount; ++j)
+				{
+					ndRightHandSide* const rhs = &m_rightHandSide[rowStart + j];
+					const ndLeftHandSide* const lhs = &m_leftHandSide[rowStart + j];
+					const ndVector force(rhs->m_force);
+
+					ndVector a(lhs->m_JMinv.m_jacobianM0.m_linear * forceM0);
+					a = a.MulAdd(lhs->m_JMinv.m_jacobianM0.m_angular, torqueM0);
+					a = a.MulAdd(lhs->m_JMinv.m_jacobianM1.m_linear, forceM1);
+					a = a.MulAdd(lhs->m_JMinv.m_jacobianM1.m_angular, torqueM1);
+					a = ndVector(rhs->m_coordenateAccel - rhs->m_force * rhs->m_diagDamp) - a.AddHorizontal();
+
+					ndAssert(rhs->m_normalForceIndexFlat >= 0);
+					ndVector f(force + a.Scale(rhs->m_invJinvMJt));
+					const ndInt32 frictionIndex = rhs->m_normalForceIndexFlat;
+					const ndFloat32 frictionNormal = m_rightHandSide[frictionIndex].m_force;
+					const ndVector lowerFrictionForce(frictionNormal * rhs->m_lowerBoundFrictionCoefficent);
+					const ndVector upperFrictionForce(frictionNormal * rhs->m_upperBoundFrictionCoefficent);
+
+					a = a & (f < upperFrictionForce) & (f > lowerFrictionForce);
+					maxAccel = maxAccel.MulAdd(a, a);
+
+					f = f.GetMax(lowerFrictionForce).GetMin(upperFrictionForce);
+					rhs->m_force = f.GetScalar();
+					rhs->m_maxImpact = ndMax(ndAbs(rhs->m_force), rhs->m_maxImpact);
+
+					const ndVector deltaForce(f - force);
+					forceM0 = forceM0.MulAdd(lhs->m_Jt.m_jacobianM0.m_linear, deltaForce);
+					torqueM0 = torqueM0.MulAdd(lhs->m_Jt.m_jacobianM0.m_angular, deltaForce);
+					forceM1 = forceM1.MulAdd(lhs->m_Jt.m_jacobianM1.m_linear, deltaForce);
+					torqueM1 = torqueM1.MulAdd(lhs->m_Jt.m_jacobianM1.m_angular, deltaForce);
+				}
+			}
+
+			// static bodies are shared by joints of the same color,
+			// but their inverse mass is zero so their forces are never read.
+			if (!body0->m_isStatic)
+			{
+				m_internalForces[m0].m_linear = forceM0;
+				m_internalForces[m0].m_angular = torqueM0;
+			}
+			if (!body1->m_isStatic)
+			{
+				m_internalForces[m1].m_linear = forceM1;
+				m_internalForces[m1].m_angular = torqueM1;
+			}
+		}
+	};
+
+	ndInt32 colorStart = 0;
+	ndInt32 colorCount = 0;
+	ndAtomic<ndInt32> iterator(0);
+	auto CalculateJointsForce = ndMakeObject::ndFunction([this, &iterator, &colorStart, &colorCount, &JointForce](ndInt32, ndInt32)
+	{
+		D_TRACKTIME_NAMED(CalculateJointsForce);
+		ndConstraint** const jointArray = &m_coloredJoints[colorStart];
+		const ndInt32 jointCount = colorCount;
+		for (ndInt32 i = iterator.fetch_add(D_WORKER_BATCH_SIZE); i < jointCount; i = iterator.fetch_add(D_WORKER_BATCH_SIZE))
+		{
+			const ndInt32 maxSpan = ((jointCount - i) >= D_WORKER_BATCH_SIZE) ? D_WORKER_BATCH_SIZE : jointCount - i;
+			for (ndInt32 j = 0; j < maxSpan; ++j)
+			{
+				JointForce(jointArray[i + j]);
+			}
+		}
+	});
+
+	const ndInt32 colors = GetColorCount();
+	for (ndInt32 i = 0; i < ndInt32(passes); ++i)
+	{
+		for (ndInt32 color = 0; color < colors; ++color)
+		{
+			colorStart = m_colorStart[color];
+			colorCount = m_colorStart[color + 1] - colorStart;
+			if (colorCount > D_WORKER_BATCH_SIZE)
+			{
+				iterator = 0;
+				scene->ParallelExecute(CalculateJointsForce);
+			}
+			else
+			{
+				// not enough work to pay for the thread barrier
+				for (ndInt32 j = 0; j < colorCount; ++j)
+				{
+					JointForce(m_coloredJoints[colorStart + j]);
+				}
+			}
+		}
+
+		// joints that ran out of colors are solved serially
+		for (ndInt32 j = m_colorStart[colors]; j < m_colorStart[colors + 1]; ++j)
+		{
+			JointForce(m_coloredJoints[j]);
+		}
+	}
+}
+
+void ndDynamicsUpdateGaussSeidel::CalculateForces()
+{
+	D_TRACKTIME();
+	if (m_world->GetScene()->GetActiveContactArray().GetCount())
+	{
+		m_firstPassCoef = ndFloat32(0.0f);
+
+		InitSkeletons();
+		for (ndInt32 step = 0; step < 4; step++)
+		{
+			CalculateJointsAcceleration();
+			CalculateJointsForce();
+			UpdateSkeletons();
+			IntegrateBodiesVelocity();
+		}
+		UpdateForceFeedback();
+	}
+}
+
+void ndDynamicsUpdateGaussSeidel::Update()
+{
+	D_TRACKTIME();
+	m_timestep = m_world->GetScene()->GetTimestep();
+
+	BuildIsland();
+	IntegrateUnconstrainedBodies();
+	InitWeights();
+	InitBodyArray();
+	InitJacobianMatrix();
+	if (m_world->GetScene()->GetActiveContactArray().GetCount())
+	{
+		// every pass sees the latest forces, so the extra passes
+		// the Jacobi solver adds for highly connected bodies are not needed.
+		m_solverPasses = ndUnsigned32(m_world->GetSolverIterations());
+		ColorJoints();
+		InitDiagonal();
+	}
+	CalculateForces();
+	IntegrateBodies();
+	DetermineSleepStates();
+}
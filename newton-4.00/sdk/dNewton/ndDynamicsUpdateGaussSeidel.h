@@ -0,0 +1,71 @@
+/* Copyright (c) <2003-2022> <Julio Jerez, Newton Game Dynamics>
+*
+* This software is provided 'as-is', without any express or implied
+* warranty. In no event will the authors be held liable for any damages
+* arising from the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __ND_WORLD_DYNAMICS_UPDATE_GAUSS_SEIDEL_H__
+#define __ND_WORLD_DYNAMICS_UPDATE_GAUSS_SEIDEL_H__
+
+#include "ndNewtonStdafx.h"
+#include "ndDynamicsUpdate.h"
+
+// the colors are stored in a 64 bit mask per body,
+// joints that can not find a free color go to a last batch solved serially.
+#define D_GAUSS_SEIDEL_MAX_COLORS	64
+
+// Graph colored Gauss Seidel solver.
+// Active joints are partitioned into colors such that no two joints of the
+// same color share a dynamic body. Each color is solved in parallel, and
+// each joint reads and writes the body forces directly, so every row sees
+// the latest impulses of all previously solved rows.
+// This converges much faster than the weighted Jacobi passes of the
+// default solver, at the cost of one thread barrier per color.
+D_MSV_NEWTON_ALIGN_32
+class ndDynamicsUpdateGaussSeidel: public ndDynamicsUpdate
+{
+	public:
+	ndDynamicsUpdateGaussSeidel(ndWorld* const world);
+	virtual ~ndDynamicsUpdateGaussSeidel();
+
+	virtual const char* GetStringId() const;
+	ndInt32 GetColorCount() const;
+
+	protected:
+	virtual void Update();
+
+	private:
+	void ColorJoints();
+	void InitDiagonal();
+	void CalculateForces();
+	void CalculateJointsForce();
+	void AccumulateJointForces();
+
+	ndArray<ndInt32> m_colorStart;
+	ndArray<ndUnsigned8> m_jointColor;
+	ndArray<ndUnsigned64> m_bodyColors;
+	ndArray<ndConstraint*> m_coloredJoints;
+} D_GCC_NEWTON_ALIGN_32;
+
+inline ndInt32 ndDynamicsUpdateGaussSeidel::GetColorCount() const
+{
+	return (m_colorStart.GetCount() > 1) ? m_colorStart.GetCount() - 2 : 0;
+}
+
+#endif
+
@@ -39,6 +39,7 @@
 #include <ndJointHinge.h>
 #include <ndJointPlane.h>
 #include <ndBodyNotify.h>
+#include <ndBodyStateBuffer.h>
 #include <ndJointWheel.h>
 #include <ndJointRoller.h>
 #include <ndJointSlider.h>
@@ -64,6 +65,7 @@
 #include <ndModelArticulation.h>
 #include <ndSkeletonContainer.h>
 #include <ndDynamicsUpdateSoa.h>
+#include <ndDynamicsUpdateGaussSeidel.h>
 #include <ndIkJointDoubleHinge.h>
 #include <ndMultiBodyVehicleMotor.h>
 #include <ndMultiBodyVehicleGearBox.h>
@@ -28,6 +28,7 @@
 #include "ndSkeletonList.h"
 #include "ndDynamicsUpdate.h"
 #include "ndDynamicsUpdateSoa.h"
+#include "ndDynamicsUpdateGaussSeidel.h"
 #include "ndJointBilateralConstraint.h"
 
 #ifdef _D_USE_AVX2_SOLVER
@@ -103,6 +104,10 @@ ndWorld::ndWorld()
 	,m_deletedModels()
 	,m_deletedJoints()
 	,m_activeSkeletons(256)
+	,m_bodyStates()
+	,m_subStepGraph()
+	,m_applyExtForceNode(nullptr)
+	,m_initBodyArrayNode(nullptr)
 	,m_deletedLock()
 	,m_timestep(ndFloat32 (0.0f))
 	,m_freezeAccel2(D_FREEZE_ACCEL2)
@@ -111,16 +116,21 @@ ndWorld::ndWorld()
 	,m_averageTimestepAcc(ndFloat32(0.0f))
 	,m_averageFramesCount(ndFloat32(0.0f))
 	,m_lastExecutionTime(ndFloat32(0.0f))
+	,m_frameHeapAllocations(0)
 	,m_subSteps(1)
 	,m_solverMode(ndStandardSolver)
 	,m_solverIterations(4)
 	,m_inUpdate(false)
+	,m_publishBodyStates(false)
+	,m_countHeapAllocations(false)
 {
 	// start the engine thread;
 	ndBody::m_uniqueIdCount = 0;
 	m_solver = new ndDynamicsUpdate(this);
 	m_scene = new ndWorldScene(this);
 
+	BuildSubStepGraph();
+
 	ndInt32 steps = 1;
 	ndFloat32 freezeAccel2 = m_freezeAccel2;
 	//ndFloat32 freezeAlpha2 = m_freezeAlpha2;
@@ -197,6 +207,7 @@ void ndWorld::CleanUp()
 	}
 
 	ndBody::m_uniqueIdCount = 1;
+	m_bodyStates.Reset();
 	m_scene->Cleanup();
 }
 
@@ -231,6 +242,26 @@ void ndWorld::SetThreadCount(ndInt32 count)
 	m_scene->m_backgroundThread.SetThreadCount(count);
 }
 
+ndThreadPool::ndThreadAffinity ndWorld::GetThreadAffinity() const
+{
+	return m_scene->GetThreadAffinity();
+}
+
+void ndWorld::SetThreadAffinity(ndThreadPool::ndThreadAffinity affinity)
+{
+	m_scene->SetThreadAffinity(affinity);
+}
+
+ndScene::ndBroadPhaseType ndWorld::GetBroadPhaseType() const
+{
+	return m_scene->GetBroadPhaseType();
+}
+
+void ndWorld::SetBroadPhaseType(ndScene::ndBroadPhaseType type)
+{
+	m_scene->SetBroadPhaseType(type);
+}
+
 ndInt32 ndWorld::GetSubSteps() const
 {
 	return m_subSteps;
@@ -256,6 +287,22 @@ void ndWorld::SetSolverIterations(ndInt32 iterations)
 	m_solverIterations = ndInt32(ndMax(4, iterations));
 }
 
+bool ndWorld::GetPublishBodyStates() const
+{
+	return m_publishBodyStates;
+}
+
+void ndWorld::SetPublishBodyStates(bool state)
+{
+	Sync();
+	m_publishBodyStates = state;
+}
+
+const ndBodyStateBuffer& ndWorld::GetBodyStates() const
+{
+	return m_bodyStates;
+}
+
 ndContactNotify* ndWorld::GetContactNotify() const
 {
 	return m_scene->GetContactNotify();
@@ -311,6 +358,41 @@ ndFloat32 ndWorld::GetAverageUpdateTime() const
 	return m_averageUpdateTime;
 }
 
+bool ndWorld::GetCountHeapAllocations() const
+{
+	return m_countHeapAllocations;
+}
+
+void ndWorld::SetCountHeapAllocations(bool state)
+{
+	Sync();
+	m_countHeapAllocations = state;
+	m_frameHeapAllocations = 0;
+}
+
+ndUnsigned64 ndWorld::GetFrameHeapAllocations() const
+{
+	return m_frameHeapAllocations;
+}
+
+ndUnsigned64 ndWorld::GetThreadsAllocationCount()
+{
+	// each thread can only read its own counter.
+	ndUnsigned64* const allocations = ndAlloca(ndUnsigned64, m_scene->GetThreadCount());
+	auto CountAllocations = ndMakeObject::ndFunction([&allocations](ndInt32 threadIndex, ndInt32)
+	{
+		allocations[threadIndex] = ndMemory::GetThreadAllocationCount();
+	});
+	m_scene->ParallelExecute(CountAllocations);
+
+	ndUnsigned64 count = 0;
+	for (ndInt32 i = m_scene->GetThreadCount() - 1; i >= 0; --i)
+	{
+		count += allocations[i];
+	}
+	return count;
+}
+
 ndUnsigned32 ndWorld::GetFrameNumber() const
 {
 	return m_scene->m_frameNumber;
@@ -434,6 +516,7 @@ void ndWorld::ThreadFunction()
 
 	m_inUpdate = true;
 	m_scene->Begin();
+	const ndUnsigned64 allocations = m_countHeapAllocations ? GetThreadsAllocationCount() : 0;
 
 	// clean up all batched deletd objects, before update
 	while (m_deletedModels.GetCount())
@@ -507,8 +590,16 @@ void ndWorld::ThreadFunction()
 	UpdateTransforms();
 	PostModelTransform();
 	PostUpdate(m_timestep);
+	if (m_publishBodyStates)
+	{
+		m_bodyStates.Publish(m_scene, m_timestep, m_scene->m_frameNumber + 1);
+	}
 	m_inUpdate = false;
 
+	if (m_countHeapAllocations)
+	{
+		m_frameHeapAllocations = GetThreadsAllocationCount() - allocations;
+	}
 	m_scene->End();
 	
 	m_lastExecutionTime = (ndFloat32)(ndGetTimeInMicroseconds() - timeAcc) * ndFloat32(1.0e-6f);
@@ -542,8 +633,7 @@ void ndWorld::SubStepUpdate(ndFloat32 timestep)
 	m_scene->SetTimestep(timestep);
 
 	m_scene->BalanceScene();
-	m_scene->ApplyExtForce();
-	m_scene->InitBodyArray();
+	PrepareBodyArray();
 
 	// update the collision system
 	m_scene->FindCollidingPairs();
@@ -576,6 +666,47 @@ void ndWorld::SubStepUpdate(ndFloat32 timestep)
 	m_scene->m_subStepNumber++;
 }
 
+void ndWorld::BuildSubStepGraph()
+{
+	// the solver only depends on the body equilibrium state, not on the entire array, 
+	// so each batch of bodies flows from the external forces into the body array 
+	// initialization in the same thread, without a join between the two stages.
+	auto ApplyExtForce = [this](ndInt32 threadIndex, ndInt32 start, ndInt32 count)
+	{
+		D_TRACKTIME_NAMED(ApplyExtForce);
+		m_scene->ApplyExtForce(threadIndex, start, count);
+	};
+
+	auto InitBodyArray = [this](ndInt32, ndInt32 start, ndInt32 count)
+	{
+		D_TRACKTIME_NAMED(InitBodyArray);
+		m_scene->InitBodyArray(start, count);
+	};
+
+	m_subStepGraph.Clear();
+	m_applyExtForceNode = m_subStepGraph.AddParallelFor(0, ApplyExtForce);
+	m_initBodyArrayNode = m_subStepGraph.AddParallelFor(0, InitBodyArray);
+	m_subStepGraph.AddContinuation(m_applyExtForceNode, m_initBodyArrayNode);
+}
+
+void ndWorld::PrepareBodyArray()
+{
+	D_TRACKTIME();
+	if (m_scene->IsHighPerformanceCompute())
+	{
+		m_scene->ApplyExtForce();
+		m_scene->InitBodyArray();
+	}
+	else
+	{
+		const ndInt32 bodyCount = m_scene->GetActiveBodyArray().GetCount() - 1;
+		m_applyExtForceNode->SetCount(bodyCount);
+		m_initBodyArrayNode->SetCount(bodyCount);
+		m_subStepGraph.Execute(*m_scene);
+		m_scene->FinishBodyArray();
+	}
+}
+
 void ndWorld::ParticleUpdate(ndFloat32 timestep)
 {
 	D_TRACKTIME();
@@ -936,6 +1067,22 @@ bool ndWorld::ConvexCast(ndConvexCastNotify& callback, const ndShapeInstance& co
 	return m_scene->ConvexCast(callback, convexShape, globalOrigin, globalDest);
 }
 
+void ndWorld::RayCastBatch(const ndArray<ndRayCastBatchQuery>& queries, ndArray<ndCastBatchHit>& hits) const
+{
+	// the batch runs on the world thread pool and its scratch buffer,
+	// so it can not overlap an update, or be called from one.
+	ndAssert(!m_inUpdate);
+	Sync();
+	m_scene->RayCastBatch(queries, hits);
+}
+
+void ndWorld::ConvexCastBatch(const ndShapeInstance& convexShape, const ndArray<ndConvexCastBatchQuery>& queries, ndArray<ndCastBatchHit>& hits) const
+{
+	ndAssert(!m_inUpdate);
+	Sync();
+	m_scene->ConvexCastBatch(convexShape, queries, hits);
+}
+
 void ndWorld::BodiesInAabb(ndBodiesInAabbNotify& callback, const ndVector& minBox, const ndVector& maxBox) const
 {
 	m_scene->BodiesInAabb(callback, minBox, maxBox);
@@ -1012,6 +1159,17 @@ void ndWorld::SelectSolver(ndSolverModes solverMode)
 				break;
 			}
 
+			case ndGaussSeidelSolver:
+			{
+				ndWorldScene* const newScene = new ndWorldScene(*((ndWorldScene*)m_scene));
+				delete m_scene;
+				m_scene = newScene;
+
+				m_solverMode = solverMode;
+				m_solver = new ndDynamicsUpdateGaussSeidel(this);
+				break;
+			}
+
 			case ndStandardSolver:
 			default:
 			{
@@ -26,15 +26,19 @@
 #include "ndModelList.h"
 #include "ndJointList.h"
 #include "ndSkeletonList.h"
+#include "ndBodyStateBuffer.h"
 
 class ndWorld;
 class ndModel;
 class ndJointList;
 class ndBodyDynamic;
+class ndCastBatchHit;
 class ndRayCastNotify;
 class ndDynamicsUpdate;
 class ndConvexCastNotify;
+class ndRayCastBatchQuery;
 class ndBodiesInAabbNotify;
+class ndConvexCastBatchQuery;
 class ndJointBilateralConstraint;
 
 #define D_NEWTON_ENGINE_MAJOR_VERSION 4
@@ -52,6 +56,7 @@ class ndWorld: public ndClassAlloc
 		ndSimdSoaSolver,
 		ndSimdAvx2Solver,
 		ndCudaSolver,
+		ndGaussSeidelSolver,
 	};
 
 	D_BASE_CLASS_REFLECTION(ndWorld)
@@ -69,12 +74,18 @@ class ndWorld: public ndClassAlloc
 	D_NEWTON_API ndInt32 GetThreadCount() const;
 	D_NEWTON_API void SetThreadCount(ndInt32 count);
 
+	D_NEWTON_API ndThreadPool::ndThreadAffinity GetThreadAffinity() const;
+	D_NEWTON_API void SetThreadAffinity(ndThreadPool::ndThreadAffinity affinity);
+
 	D_NEWTON_API ndInt32 GetSubSteps() const;
 	D_NEWTON_API void SetSubSteps(ndInt32 subSteps);
 
 	D_NEWTON_API ndSolverModes GetSelectedSolver() const;
 	D_NEWTON_API void SelectSolver(ndSolverModes solverMode);
 
+	D_NEWTON_API ndScene::ndBroadPhaseType GetBroadPhaseType() const;
+	D_NEWTON_API void SetBroadPhaseType(ndScene::ndBroadPhaseType type);
+
 	D_NEWTON_API ndScene* GetScene() const;
 	D_NEWTON_API bool IsHighPerformanceCompute() const;
 	D_NEWTON_API const char* GetSolverString() const;
@@ -96,6 +107,7 @@ class ndWorld: public ndClassAlloc
 	D_NEWTON_API const ndModelList& GetModelList() const;
 	D_NEWTON_API const ndBodyListView& GetBodyList() const;
 	D_NEWTON_API const ndBodyList& GetParticleList() const;
+	// does not include the contacts parked by island sleep, see ndScene::SetIslandSleep.
 	D_NEWTON_API const ndContactArray& GetContactList() const;
 	D_NEWTON_API const ndSkeletonList& GetSkeletonList() const;
 
@@ -107,6 +119,19 @@ class ndWorld: public ndClassAlloc
 	D_NEWTON_API ndUnsigned32 GetSubFrameNumber() const;
 	D_NEWTON_API ndFloat32 GetAverageUpdateTime() const;
 
+	/// when enabled, each update counts the calls to ndMemory::Malloc made by the 
+	/// world threads. counting costs two extra passes over the thread pool per 
+	/// update, so it is off by default and GetFrameHeapAllocations returns zero.
+	D_NEWTON_API bool GetCountHeapAllocations() const;
+	D_NEWTON_API void SetCountHeapAllocations(bool state);
+	D_NEWTON_API ndUnsigned64 GetFrameHeapAllocations() const;
+
+	/// when enabled, each update ends publishing the state of all bodies to the
+	/// body state buffer, so that other threads can read it while the next update runs.
+	D_NEWTON_API bool GetPublishBodyStates() const;
+	D_NEWTON_API void SetPublishBodyStates(bool state);
+	D_NEWTON_API const ndBodyStateBuffer& GetBodyStates() const;
+
 	D_NEWTON_API ndContactNotify* GetContactNotify() const;
 	D_NEWTON_API void SetContactNotify(ndContactNotify* const notify);
 
@@ -117,6 +142,10 @@ class ndWorld: public ndClassAlloc
 	D_NEWTON_API void BodiesInAabb(ndBodiesInAabbNotify& callback, const ndVector& minBox, const ndVector& maxBox) const;
 	D_NEWTON_API bool RayCast(ndRayCastNotify& callback, const ndVector& globalOrigin, const ndVector& globalDest) const;
 	D_NEWTON_API bool ConvexCast(ndConvexCastNotify& callback, const ndShapeInstance& convexShape, const ndMatrix& globalOrigin, const ndVector& globalDest) const;
+	// the batch queries run on the world thread pool, they wait for the update
+	// in progress to finish and must not be called from inside an update callback.
+	D_NEWTON_API void RayCastBatch(const ndArray<ndRayCastBatchQuery>& queries, ndArray<ndCastBatchHit>& hits) const;
+	D_NEWTON_API void ConvexCastBatch(const ndShapeInstance& convexShape, const ndArray<ndConvexCastBatchQuery>& queries, ndArray<ndCastBatchHit>& hits) const;
 
 	D_NEWTON_API void CalculateJointContacts(ndContact* const contact);
 
@@ -157,6 +186,9 @@ class ndWorld: public ndClassAlloc
 	void ModelUpdate();
 	void ModelPostUpdate();
 	void CalculateAverageUpdateTime();
+	ndUnsigned64 GetThreadsAllocationCount();
+	void PrepareBodyArray();
+	void BuildSubStepGraph();
 	void SubStepUpdate(ndFloat32 timestep);
 	void ParticleUpdate(ndFloat32 timestep);
 
@@ -172,6 +204,10 @@ class ndWorld: public ndClassAlloc
 	ndSpecialList<ndModel> m_deletedModels;
 	ndSpecialList<ndJointBilateralConstraint> m_deletedJoints;
 	ndArray<ndSkeletonContainer*> m_activeSkeletons;
+	ndBodyStateBuffer m_bodyStates;
+	ndTaskGraph m_subStepGraph;
+	ndTaskGraph::ndNode* m_applyExtForceNode;
+	ndTaskGraph::ndNode* m_initBodyArrayNode;
 	ndSpinLock m_deletedLock;
 
 	ndFloat32 m_timestep;
@@ -181,12 +217,15 @@ class ndWorld: public ndClassAlloc
 	ndFloat32 m_averageTimestepAcc;
 	ndFloat32 m_averageFramesCount;
 	ndFloat32 m_lastExecutionTime;
+	ndUnsigned64 m_frameHeapAllocations;
 	dgSolverProgressiveSleepEntry m_sleepTable[D_SLEEP_ENTRIES];
 
 	ndInt32 m_subSteps;
 	ndSolverModes m_solverMode;
 	ndInt32 m_solverIterations;
 	bool m_inUpdate;
+	bool m_publishBodyStates;
+	bool m_countHeapAllocations;
 	
 	friend class ndScene;
 	friend class ndIkSolver;
@@ -196,6 +235,7 @@ class ndWorld: public ndClassAlloc
 	friend class ndSkeletonContainer;
 	friend class ndModelArticulation;
 	friend class ndDynamicsUpdateSoa;
+	friend class ndDynamicsUpdateGaussSeidel;
 	friend class ndDynamicsUpdateAvx2;
 	friend class ndDynamicsUpdateCuda;
 } D_GCC_NEWTON_ALIGN_32;
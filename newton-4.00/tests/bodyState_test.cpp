@@ -0,0 +1,205 @@
+/* Copyright (c) <2003-2019> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+#include "ndNewton.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+/* Snapshots of the body state buffer hold a complete frame along with the pose of the frame before it. */
+TEST(BodyState, BodyStateSnapshots) {
+  ndWorld world;
+  world.SetThreadCount(4);
+  world.SetPublishBodyStates(true);
+
+  // free falling spheres far apart, every sphere has the same height in a frame
+  ndShapeInstance shape(new ndShapeSphere(0.5f));
+  std::vector<ndBodyDynamic*> bodies;
+  for (int i = 0; i < 64; i++) {
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = ndVector(ndFloat32(i % 8) * 4.0f, 10.0f, ndFloat32(i / 8) * 4.0f, 1.0f);
+    ndBodyDynamic* const body = new ndBodyDynamic();
+    body->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+    body->SetCollisionShape(shape);
+    body->SetMatrix(matrix);
+    body->SetMassMatrix(1.0f, shape);
+    body->SetOmega(ndVector(0.0f, 1.0f, 0.0f, 0.0f));
+    ndSharedPtr<ndBody> bodyPtr(body);
+    world.AddBody(bodyPtr);
+    bodies.push_back(body);
+  }
+
+  const ndBodyStateBuffer& buffer = world.GetBodyStates();
+  EXPECT_EQ(ndBodyStateBuffer::ndSnapshot(buffer).GetFrame(), nullptr);
+
+  // the first frame has no previous one, its previous pose is the current pose
+  world.Update(1.0f / 60.0f);
+  world.Sync();
+  {
+    const ndBodyStateBuffer::ndSnapshot snapshot(buffer);
+    const ndBodyState* const state = snapshot.GetFrame()->FindState(bodies[5]);
+    EXPECT_EQ(state->m_prevPosit.m_y, state->m_posit.m_y);
+    EXPECT_LT(state->m_posit.m_y, 10.0f);
+  }
+
+  ndVector prevPosit(bodies[5]->GetMatrix().m_posit);
+  for (int i = 0; i < 4; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    const ndBodyStateBuffer::ndSnapshot snapshot(buffer);
+    const ndBodyStateFrame* const frame = snapshot.GetFrame();
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(frame->GetFrameNumber(), world.GetFrameNumber());
+    EXPECT_EQ(frame->GetStates().GetCount(), ndInt32(bodies.size()));
+
+    const ndBodyState* const state = frame->FindState(bodies[5]);
+    ASSERT_NE(state, nullptr);
+    const ndMatrix matrix(bodies[5]->GetMatrix());
+    EXPECT_NEAR(state->m_posit.m_y, matrix.m_posit.m_y, 1.0e-6f);
+    EXPECT_NEAR(state->m_veloc.m_y, bodies[5]->GetVelocity().m_y, 1.0e-6f);
+    EXPECT_NEAR(state->m_prevPosit.m_y, prevPosit.m_y, 1.0e-6f);
+    EXPECT_NEAR(state->GetMatrix().m_front.m_x, matrix.m_front.m_x, 1.0e-5f);
+    EXPECT_NEAR(state->GetMatrix().m_front.m_z, matrix.m_front.m_z, 1.0e-5f);
+
+    const ndMatrix halfMatrix(state->GetInterpolatedMatrix(0.5f));
+    EXPECT_NEAR(halfMatrix.m_posit.m_y, (prevPosit.m_y + matrix.m_posit.m_y) * 0.5f, 1.0e-5f);
+    EXPECT_NEAR(state->GetInterpolatedMatrix(1.0f).m_posit.m_y, matrix.m_posit.m_y, 1.0e-5f);
+    prevPosit = matrix.m_posit;
+  }
+
+  // a held snapshot is not modified by later updates, and while readers hold
+  // every spare frame the updates skip publishing instead of waiting.
+  {
+    const ndBodyStateBuffer::ndSnapshot snapshot0(buffer);
+    const ndUnsigned32 frameNumber0 = snapshot0.GetFrame()->GetFrameNumber();
+    const ndFloat32 height0 = snapshot0.GetFrame()->FindState(bodies[0])->m_posit.m_y;
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    const ndBodyStateBuffer::ndSnapshot snapshot1(buffer);
+    EXPECT_EQ(snapshot1.GetFrame()->GetFrameNumber(), frameNumber0 + 1);
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    EXPECT_EQ(buffer.GetFrameNumber(), frameNumber0 + 2);
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    EXPECT_EQ(buffer.GetFrameNumber(), frameNumber0 + 2);
+    EXPECT_EQ(snapshot0.GetFrame()->GetFrameNumber(), frameNumber0);
+    EXPECT_EQ(snapshot0.GetFrame()->FindState(bodies[0])->m_posit.m_y, height0);
+  }
+  world.Update(1.0f / 60.0f);
+  world.Sync();
+  EXPECT_EQ(buffer.GetFrameNumber(), world.GetFrameNumber());
+
+  // a removed body is not in the frames published after its removal
+  world.RemoveBody(bodies[63]);
+  bodies.pop_back();
+  world.Update(1.0f / 60.0f);
+  world.Sync();
+  EXPECT_EQ(ndBodyStateBuffer::ndSnapshot(buffer).GetFrame()->GetStates().GetCount(), ndInt32(bodies.size()));
+
+  // a reader thread never sees a frame mixing the states of two updates
+  std::atomic<bool> done(false);
+  std::atomic<int> frames(0);
+  std::atomic<int> tornFrames(0);
+  std::thread reader([&]() {
+    ndUnsigned32 lastFrame = 0;
+    while (!done.load()) {
+      const ndBodyStateBuffer::ndSnapshot snapshot(buffer);
+      const ndArray<ndBodyState>& states = snapshot.GetFrame()->GetStates();
+      for (ndInt32 i = 1; i < states.GetCount(); i++) {
+        if (states[i].m_posit.m_y != states[0].m_posit.m_y) {
+          tornFrames++;
+          break;
+        }
+      }
+      if (snapshot.GetFrame()->GetFrameNumber() != lastFrame) {
+        lastFrame = snapshot.GetFrame()->GetFrameNumber();
+        frames++;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+  for (int i = 0; i < 60; i++) {
+    world.Update(1.0f / 60.0f);
+  }
+  world.Sync();
+  done = true;
+  reader.join();
+  EXPECT_EQ(tornFrames.load(), 0);
+  EXPECT_GT(frames.load(), 0);
+  world.CleanUp();
+}
+
+/* A body allocated where a removed one was, in the same place of the world, is published under its own id. */
+TEST(BodyState, ReusedBodyAddressKeepsFramesSorted) {
+  ndWorld world;
+  world.SetPublishBodyStates(true);
+
+  auto AddSphere = [&world](ndBodyDynamic* const body, ndFloat32 x) {
+    ndShapeInstance shape(new ndShapeSphere(0.5f));
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = ndVector(x, 10.0f, 0.0f, 1.0f);
+    body->SetCollisionShape(shape);
+    body->SetMatrix(matrix);
+    body->SetMassMatrix(1.0f, shape);
+    ndSharedPtr<ndBody> bodyPtr(body);
+    world.AddBody(bodyPtr);
+    return body;
+  };
+
+  // the body with the smallest id is the last one in the world, so it is the
+  // first one of the sorted frames while the body that replaces it is the last.
+  ndBodyDynamic* const removed = new ndBodyDynamic();
+  std::vector<ndBodyDynamic*> bodies;
+  for (int i = 1; i < 8; i++) {
+    bodies.push_back(AddSphere(new ndBodyDynamic(), ndFloat32(i) * 4.0f));
+  }
+  AddSphere(removed, 0.0f);
+  world.Update(1.0f / 60.0f);
+  world.Sync();
+
+  const ndBodyStateBuffer& buffer = world.GetBodyStates();
+  {
+    // while readers hold the spare frames nothing is published, so the next
+    // frame is sorted against the bodies of the world before the removal.
+    const ndBodyStateBuffer::ndSnapshot snapshot0(buffer);
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    const ndBodyStateBuffer::ndSnapshot snapshot1(buffer);
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+
+    world.RemoveBody(removed);
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    // the allocator usually hands the memory of the removed body to the new one
+    bodies.push_back(AddSphere(new ndBodyDynamic(), 32.0f));
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    EXPECT_LT(buffer.GetFrameNumber(), world.GetFrameNumber());
+  }
+
+  world.Update(1.0f / 60.0f);
+  world.Sync();
+  const ndBodyStateBuffer::ndSnapshot snapshot(buffer);
+  const ndArray<ndBodyState>& states = snapshot.GetFrame()->GetStates();
+  ASSERT_EQ(states.GetCount(), ndInt32(bodies.size()));
+  for (ndInt32 i = 1; i < states.GetCount(); i++) {
+    EXPECT_LT(states[i - 1].m_bodyId, states[i].m_bodyId);
+  }
+  for (size_t i = 0; i < bodies.size(); i++) {
+    const ndBodyState* const state = snapshot.GetFrame()->FindState(bodies[i]);
+    ASSERT_NE(state, nullptr);
+    EXPECT_EQ(state->m_posit.m_x, bodies[i]->GetMatrix().m_posit.m_x);
+  }
+  world.CleanUp();
+}
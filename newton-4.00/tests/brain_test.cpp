@@ -0,0 +1,504 @@
+/* Copyright (c) <2003-2019> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+#include "ndNewton.h"
+#include "ndBrainInc.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+static void FillRandom(ndBrainMatrix& matrix)
+{
+  for (ndInt32 i = 0; i < matrix.GetRows(); ++i)
+  {
+    for (ndInt32 j = 0; j < matrix.GetColumns(); ++j)
+    {
+      matrix[i][j] = ndBrainFloat(ndRand() * 2.0f - 1.0f);
+    }
+  }
+}
+
+static ndBrainFloat MaxDifference(const ndBrainVector& a, const ndBrainVector& b)
+{
+  ndBrainFloat error = ndBrainFloat(0.0f);
+  for (ndInt32 i = 0; i < a.GetCount(); ++i)
+  {
+    error = ndMax(error, ndBrainFloat(ndAbs(a[i] - b[i])));
+  }
+  return error;
+}
+
+/* The blocked products must match the naive triple loop, for sizes that
+ * are not multiples of the register tiles or of the cache blocks. */
+TEST(Brain, BlockedMatrixProducts)
+{
+  ndSetRandSeed(42);
+  const ndInt32 sizes[][3] = { {1, 1, 1}, {3, 5, 7}, {37, 131, 45}, {130, 300, 19}, {64, 16, 8} };
+  for (ndInt32 n = 0; n < ndInt32(sizeof(sizes) / sizeof(sizes[0])); ++n)
+  {
+    const ndInt32 rows = sizes[n][0];
+    const ndInt32 depth = sizes[n][1];
+    const ndInt32 columns = sizes[n][2];
+
+    ndBrainMatrix a(rows, depth);
+    ndBrainMatrix b(depth, columns);
+    ndBrainMatrix bt(columns, depth);
+    ndBrainMatrix at(depth, rows);
+    FillRandom(a);
+    FillRandom(b);
+    for (ndInt32 i = 0; i < depth; ++i)
+    {
+      for (ndInt32 j = 0; j < columns; ++j)
+      {
+        bt[j][i] = b[i][j];
+      }
+      for (ndInt32 j = 0; j < rows; ++j)
+      {
+        at[i][j] = a[j][i];
+      }
+    }
+
+    ndBrainMatrix expected(rows, columns);
+    for (ndInt32 i = 0; i < rows; ++i)
+    {
+      for (ndInt32 j = 0; j < columns; ++j)
+      {
+        ndFloat64 sum = 0.0;
+        for (ndInt32 k = 0; k < depth; ++k)
+        {
+          sum += ndFloat64(a[i][k]) * ndFloat64(b[k][j]);
+        }
+        expected[i][j] = ndBrainFloat(sum);
+      }
+    }
+
+    ndBrainMatrix c0(rows, columns);
+    ndBrainMatrix c1(rows, columns);
+    ndBrainMatrix c2(rows, columns);
+    c0.MatrixMul(a, b);
+    c1.MatrixMulTranspose(a, bt);
+    c2.TransposeMatrixMul(at, b);
+    for (ndInt32 i = 0; i < rows; ++i)
+    {
+      EXPECT_LT(MaxDifference(c0[i], expected[i]), 1.0e-4f);
+      EXPECT_LT(MaxDifference(c1[i], expected[i]), 1.0e-4f);
+      EXPECT_LT(MaxDifference(c2[i], expected[i]), 1.0e-4f);
+    }
+  }
+}
+
+/* One batch trainer must produce the average of the gradients of one
+ * single sample trainer per row. */
+TEST(Brain, BatchBackPropagateMatchesSingleSample)
+{
+  ndSetRandSeed(7);
+  const ndInt32 inputSize = 21;
+  const ndInt32 outputSize = 5;
+  const ndInt32 batchSize = 13;
+
+  ndBrain brain;
+  brain.AddLayer(new ndBrainLayerLinear(inputSize, 33));
+  brain.AddLayer(new ndBrainLayerTanhActivation(33));
+  brain.AddLayer(new ndBrainLayerLinear(33, 17));
+  brain.AddLayer(new ndBrainLayerReluActivation(17));
+  brain.AddLayer(new ndBrainLayerLinear(17, outputSize));
+  brain.AddLayer(new ndBrainLayerSigmoidActivation(outputSize));
+  brain.InitWeightsXavierMethod();
+
+  ndBrainMatrix input(batchSize, inputSize);
+  ndBrainMatrix truth(batchSize, outputSize);
+  FillRandom(input);
+  FillRandom(truth);
+
+  ndBrainLossLeastSquaredError loss(outputSize);
+  ndBrainTrainer batchTrainer(&brain);
+  batchTrainer.BackPropagate(input, truth, loss);
+
+  ndBrainTrainer accumulator(&brain);
+  accumulator.ClearGradients();
+  ndBrainTrainer trainer(&brain);
+  for (ndInt32 i = 0; i < batchSize; ++i)
+  {
+    loss.SetTruth(truth[i]);
+    trainer.BackPropagate(input[i], loss);
+    accumulator.AddGradients(&trainer);
+  }
+  accumulator.ScaleWeights(ndBrainFloat(1.0f) / ndBrainFloat(batchSize));
+
+  for (ndInt32 i = 0; i < brain.GetCount(); ++i)
+  {
+    if (!brain[i]->HasParameters())
+    {
+      continue;
+    }
+    ndBrainLayerLinear* const expected = (ndBrainLayerLinear*)accumulator.GetGradientLayer(i);
+    ndBrainLayerLinear* const gradient = (ndBrainLayerLinear*)batchTrainer.GetGradientLayer(i);
+    EXPECT_LT(MaxDifference(*gradient->GetBias(), *expected->GetBias()), 1.0e-5f);
+    const ndBrainMatrix& weights = *gradient->GetWeights();
+    const ndBrainMatrix& expectedWeights = *expected->GetWeights();
+    for (ndInt32 j = 0; j < weights.GetRows(); ++j)
+    {
+      EXPECT_LT(MaxDifference(weights[j], expectedWeights[j]), 1.0e-5f);
+    }
+  }
+
+  // a smaller batch reuses the trainer buffers
+  ndBrainMatrix input1(1, inputSize);
+  ndBrainMatrix truth1(1, outputSize);
+  input1[0].Set(input[3]);
+  truth1[0].Set(truth[3]);
+  batchTrainer.BackPropagate(input1, truth1, loss);
+
+  loss.SetTruth(truth[3]);
+  trainer.BackPropagate(input[3], loss);
+  ndBrainLayerLinear* const expected = (ndBrainLayerLinear*)trainer.GetGradientLayer(0);
+  ndBrainLayerLinear* const gradient = (ndBrainLayerLinear*)batchTrainer.GetGradientLayer(0);
+  EXPECT_LT(MaxDifference(*gradient->GetBias(), *expected->GetBias()), 1.0e-5f);
+}
+
+class ndTestPolicyAgent: public ndBrainAgentContinuePolicyGradient<6, 3>
+{
+  public:
+  ndTestPolicyAgent(const ndSharedPtr<ndBrain>& actor, ndInt32 seed)
+    :ndBrainAgentContinuePolicyGradient<6, 3>(actor)
+    ,m_seed(seed)
+  {
+  }
+
+  void GetObservation(ndBrainFloat* const observation)
+  {
+    for (ndInt32 i = 0; i < 6; ++i)
+    {
+      observation[i] = ndBrainFloat(ndSin(ndFloat32(m_seed * 7 + i)));
+    }
+  }
+
+  void ApplyActions(ndBrainFloat* const actions)
+  {
+    for (ndInt32 i = 0; i < 3; ++i)
+    {
+      m_actions[i] = actions[i];
+    }
+  }
+
+  ndBrainFloat m_actions[3];
+  ndInt32 m_seed;
+};
+
+/* Stepping the agents through one batch must apply the same actions as
+ * stepping each agent by itself. */
+TEST(Brain, AgentBatchMatchesAgentStep)
+{
+  ndSetRandSeed(11);
+  ndSharedPtr<ndBrain> brain(new ndBrain());
+  brain->AddLayer(new ndBrainLayerLinear(6, 32));
+  brain->AddLayer(new ndBrainLayerTanhActivation(32));
+  brain->AddLayer(new ndBrainLayerLinear(32, 3));
+  brain->AddLayer(new ndBrainLayerTanhActivation(3));
+  brain->InitWeightsXavierMethod();
+
+  const ndInt32 agentCount = 37;
+  ndBrainAgentBatch batch(brain, 3);
+  std::vector<ndTestPolicyAgent*> agents;
+  for (ndInt32 i = 0; i < agentCount; ++i)
+  {
+    agents.push_back(new ndTestPolicyAgent(brain, i));
+    batch.AddAgent(agents.back());
+  }
+  EXPECT_EQ(batch.GetAgentCount(), agentCount);
+
+  std::vector<ndBrainFloat> expected;
+  for (ndInt32 i = 0; i < agentCount; ++i)
+  {
+    agents[i]->Step();
+    for (ndInt32 j = 0; j < 3; ++j)
+    {
+      expected.push_back(agents[i]->m_actions[j]);
+      agents[i]->m_actions[j] = ndBrainFloat(100.0f);
+    }
+  }
+
+  batch.Step();
+  for (ndInt32 i = 0; i < agentCount; ++i)
+  {
+    for (ndInt32 j = 0; j < 3; ++j)
+    {
+      EXPECT_NEAR(agents[i]->m_actions[j], expected[size_t(i * 3 + j)], 1.0e-5f);
+    }
+  }
+
+  // removed agents are no longer stepped
+  batch.RemoveAgent(agents[5]);
+  agents[5]->m_actions[0] = ndBrainFloat(100.0f);
+  batch.Step();
+  EXPECT_EQ(batch.GetAgentCount(), agentCount - 1);
+  EXPECT_EQ(agents[5]->m_actions[0], ndBrainFloat(100.0f));
+  EXPECT_NEAR(agents[6]->m_actions[0], expected[6 * 3], 1.0e-5f);
+
+  for (ndInt32 i = 0; i < agentCount; ++i)
+  {
+    delete agents[i];
+  }
+}
+
+static ndBrain* MakeQuantizationTestBrain()
+{
+  // odd sizes exercise the padding of the rows and of the row blocks
+  ndBrain* const brain = new ndBrain();
+  brain->AddLayer(new ndBrainLayerLinear(37, 45));
+  brain->AddLayer(new ndBrainLayerTanhActivation(45));
+  brain->AddLayer(new ndBrainLayerLinear(45, 7));
+  brain->InitWeightsXavierMethod();
+  return brain;
+}
+
+/* Quantized brains must stay close to the float brain they came from,
+ * and the batched path must match the single sample path. */
+TEST(Brain, QuantizedLinearLayersMatchFloat)
+{
+  const ndBrainLayerLinearQuantized::ndType types[] = { ndBrainLayerLinearQuantized::m_int8, ndBrainLayerLinearQuantized::m_bfloat16 };
+  const ndBrainFloat tolerance[] = { ndBrainFloat(5.0e-2f), ndBrainFloat(2.0e-2f) };
+  for (ndInt32 n = 0; n < 2; ++n)
+  {
+    ndSetRandSeed(13);
+    ndSharedPtr<ndBrain> brain(MakeQuantizationTestBrain());
+    ndSharedPtr<ndBrain> quantized(new ndBrain(**brain));
+    ndBrainLayerLinearQuantized::Quantize(**quantized, types[n]);
+    EXPECT_STREQ((**quantized)[0]->GetLabelId(), "ndBrainLayerLinearQuantized");
+    EXPECT_STREQ((**quantized)[2]->GetLabelId(), "ndBrainLayerLinearQuantized");
+
+    const ndInt32 batchSize = 19;
+    ndBrainMatrix input(batchSize, 37);
+    FillRandom(input);
+
+    ndBrainMatrix output(batchSize, 45);
+    ndBrainMatrix batchOutput(batchSize, 45);
+    (**quantized)[0]->MakeBatchPrediction(input, batchOutput);
+
+    ndBrainVector expected;
+    ndBrainVector result;
+    ndBrainVector workingBuffer;
+    expected.SetCount(7);
+    result.SetCount(7);
+    for (ndInt32 i = 0; i < batchSize; ++i)
+    {
+      (**quantized)[0]->MakePrediction(input[i], output[i]);
+      EXPECT_LT(MaxDifference(output[i], batchOutput[i]), ndBrainFloat(1.0e-5f));
+
+      brain->MakePrediction(input[i], expected, workingBuffer);
+      quantized->MakePrediction(input[i], result, workingBuffer);
+      EXPECT_LT(MaxDifference(expected, result), tolerance[n]);
+    }
+  }
+}
+
+TEST(Brain, QuantizedBrainSaveLoad)
+{
+  ndSetRandSeed(17);
+  const char* const path = "ndQuantizedBrainTest.dnn";
+  ndSharedPtr<ndBrain> brain(MakeQuantizationTestBrain());
+  ndBrainLayerLinearQuantized::Quantize(**brain, ndBrainLayerLinearQuantized::m_int8);
+  ndBrainSave::Save(*brain, path);
+  ndSharedPtr<ndBrain> loaded(ndBrainLoad::Load(path));
+  remove(path);
+
+  ASSERT_EQ(loaded->GetCount(), brain->GetCount());
+  ndBrainMatrix input(1, 37);
+  FillRandom(input);
+  ndBrainVector expected;
+  ndBrainVector result;
+  ndBrainVector workingBuffer;
+  expected.SetCount(7);
+  result.SetCount(7);
+  brain->MakePrediction(input[0], expected, workingBuffer);
+  loaded->MakePrediction(input[0], result, workingBuffer);
+  EXPECT_LT(MaxDifference(expected, result), ndBrainFloat(1.0e-4f));
+}
+
+/* The fused steps must predict what the layers predict one at a time,
+ * for every fused activation and for layers that are not fused. */
+TEST(Brain, InferenceFusesLinearActivations)
+{
+  ndSetRandSeed(23);
+  // the approximate tanh needs its buffers aligned, the widest layer is a multiple of four
+  ndSharedPtr<ndBrain> brain(new ndBrain());
+  brain->AddLayer(new ndBrainLayerLinear(13, 36));
+  brain->AddLayer(new ndBrainLayerReluActivation(36));
+  brain->AddLayer(new ndBrainLayerLinear(36, 21));
+  brain->AddLayer(new ndBrainLayerTanhActivation(21));
+  brain->AddLayer(new ndBrainLayerLinear(21, 17));
+  brain->AddLayer(new ndBrainLayerSigmoidActivation(17));
+  brain->AddLayer(new ndBrainLayerLinear(17, 16));
+  brain->AddLayer(new ndBrainLayerApproximateTanhActivation(16));
+  brain->AddLayer(new ndBrainLayerLinear(16, 9));
+  brain->AddLayer(new ndBrainLayerSoftmaxActivation(9));
+  brain->InitWeightsXavierMethod();
+
+  ndBrainInference inference(brain);
+  EXPECT_EQ(inference.GetStepCount(), 6);
+  EXPECT_EQ(inference.GetInputSize(), 13);
+  EXPECT_EQ(inference.GetOutputSize(), 9);
+
+  ndBrainMatrix input(8, 13);
+  FillRandom(input);
+  ndBrainVector expected;
+  ndBrainVector result;
+  ndBrainVector workingBuffer;
+  ndBrainVector scratchBuffer;
+  expected.SetCount(9);
+  result.SetCount(9);
+  for (ndInt32 i = 0; i < input.GetRows(); ++i)
+  {
+    brain->MakePrediction(input[i], expected, workingBuffer);
+    inference.MakePrediction(input[i], result);
+    EXPECT_LT(MaxDifference(expected, result), ndBrainFloat(1.0e-5f));
+
+    inference.MakePrediction(input[i], result, scratchBuffer);
+    EXPECT_LT(MaxDifference(expected, result), ndBrainFloat(1.0e-5f));
+  }
+  EXPECT_EQ(scratchBuffer.GetCount(), inference.GetScratchBufferSize());
+
+  // the steps read the weights of the brain
+  brain->InitWeightsXavierMethod();
+  brain->MakePrediction(input[0], expected, workingBuffer);
+  inference.MakePrediction(input[0], result);
+  EXPECT_LT(MaxDifference(expected, result), ndBrainFloat(1.0e-5f));
+
+  // the continue policy gradient actor keeps the tanh label but its second half are sigmas
+  ndSharedPtr<ndBrain> actor(new ndBrain());
+  actor->AddLayer(new ndBrainLayerLinear(13, 20));
+  actor->AddLayer(new ndBrainLayerTanhActivation(20));
+  actor->AddLayer(new ndBrainLastLinearLayer(20, 4));
+  actor->AddLayer(new ndBrainLastActivationLayer(4));
+  actor->InitWeightsXavierMethod();
+
+  ndBrainInference actorInference(actor);
+  EXPECT_EQ(actorInference.GetStepCount(), 3);
+  EXPECT_EQ(actorInference.GetOutputSize(), 8);
+  expected.SetCount(8);
+  result.SetCount(8);
+  for (ndInt32 i = 0; i < input.GetRows(); ++i)
+  {
+    actor->MakePrediction(input[i], expected, workingBuffer);
+    actorInference.MakePrediction(input[i], result);
+    EXPECT_LT(MaxDifference(expected, result), ndBrainFloat(1.0e-5f));
+  }
+}
+
+template <class ndConvolution>
+class ndTestConvolution: public ndConvolution
+{
+  public:
+  ndTestConvolution(ndInt32 width, ndInt32 height, ndInt32 layers, ndInt32 kernelSize, ndInt32 filters)
+    :ndConvolution(width, height, layers, kernelSize, filters)
+  {
+  }
+
+  ndBrainVector& GetKernels() { return this->m_kernels; }
+  ndBrainVector& GetBias() { return this->m_bias; }
+};
+
+/* The im2col path must match the direct loops, for the convolution
+ * (flipped kernels) and the cross correlation, for the prediction, the
+ * filter and bias gradients and the input gradients. */
+template <class ndConvolution>
+static void CheckConvolutionLayer(ndInt32 width, ndInt32 height, ndInt32 layers, ndInt32 kernelSize, ndInt32 filters, bool flip)
+{
+  ndTestConvolution<ndConvolution> layer(width, height, layers, kernelSize, filters);
+  ndSharedPtr<ndBrainLayer> gradientLayer(layer.Clone());
+  ndTestConvolution<ndConvolution>* const gradients = (ndTestConvolution<ndConvolution>*)*gradientLayer;
+
+  ndBrainVector& kernels = layer.GetKernels();
+  ndBrainVector& bias = layer.GetBias();
+  for (ndInt32 i = 0; i < kernels.GetCount(); ++i)
+  {
+    kernels[i] = ndBrainFloat(ndRand() * 2.0f - 1.0f);
+  }
+  for (ndInt32 i = 0; i < bias.GetCount(); ++i)
+  {
+    bias[i] = ndBrainFloat(ndRand() * 2.0f - 1.0f);
+  }
+
+  const ndInt32 outWidth = width - kernelSize + 1;
+  const ndInt32 outHeight = height - kernelSize + 1;
+  const ndInt32 outSize = outWidth * outHeight;
+  const ndInt32 kernelCount = kernelSize * kernelSize;
+  const ndBrainFloat biasScale = ndBrainFloat(1.0f) / ndBrainFloat(layers * outSize);
+
+  ndBrainMatrix data(4, ndMax(layer.GetInputSize(), layer.GetOutputBufferSize()));
+  FillRandom(data);
+  ndBrainMemVector input(&data[0][0], layer.GetInputSize());
+  ndBrainMemVector outputDerivative(&data[1][0], layer.GetOutputSize());
+  ndBrainMemVector output(&data[2][0], layer.GetOutputBufferSize());
+  ndBrainMemVector inputGradient(&data[3][0], layer.GetInputSize());
+
+  ndBrainVector expectedOutput;
+  ndBrainVector expectedKernels;
+  ndBrainVector expectedBias;
+  ndBrainVector expectedInputGradient;
+  expectedOutput.SetCount(layer.GetOutputSize());
+  expectedKernels.SetCount(kernels.GetCount());
+  expectedBias.SetCount(bias.GetCount());
+  expectedInputGradient.SetCount(layer.GetInputSize());
+  expectedKernels.Set(ndBrainFloat(0.0f));
+  expectedInputGradient.Set(ndBrainFloat(0.0f));
+
+  for (ndInt32 o = 0; o < filters; ++o)
+  {
+    ndBrainFloat biasGrad = ndBrainFloat(0.0f);
+    for (ndInt32 p = 0; p < outSize; ++p)
+    {
+      biasGrad += outputDerivative[o * outSize + p];
+    }
+    expectedBias[o] = biasGrad * biasScale;
+
+    for (ndInt32 y = 0; y < outHeight; ++y)
+    {
+      for (ndInt32 x = 0; x < outWidth; ++x)
+      {
+        const ndInt32 outIndex = o * outSize + y * outWidth + x;
+        const ndBrainFloat outGrad = outputDerivative[outIndex];
+        ndFloat64 sum = bias[o] * biasScale;
+        for (ndInt32 c = 0; c < layers; ++c)
+        {
+          for (ndInt32 k = 0; k < kernelCount; ++k)
+          {
+            const ndInt32 kernelIndex = (o * layers + c) * kernelCount + (flip ? kernelCount - 1 - k : k);
+            const ndInt32 inputIndex = c * width * height + (y + k / kernelSize) * width + x + k % kernelSize;
+            sum += input[inputIndex] * kernels[kernelIndex];
+            expectedKernels[kernelIndex] += input[inputIndex] * outGrad;
+            expectedInputGradient[inputIndex] += kernels[kernelIndex] * outGrad;
+          }
+        }
+        expectedOutput[outIndex] = ndBrainFloat(sum);
+      }
+    }
+  }
+
+  ndBrainMemVector prediction(&output[0], layer.GetOutputSize());
+  layer.MakePrediction(input, prediction);
+  EXPECT_LT(MaxDifference(prediction, expectedOutput), ndBrainFloat(1.0e-4f));
+
+  layer.CalculateParamGradients(input, output, outputDerivative, inputGradient, *gradientLayer);
+  EXPECT_LT(MaxDifference(gradients->GetKernels(), expectedKernels), ndBrainFloat(1.0e-3f));
+  EXPECT_LT(MaxDifference(gradients->GetBias(), expectedBias), ndBrainFloat(1.0e-5f));
+  EXPECT_LT(MaxDifference(inputGradient, expectedInputGradient), ndBrainFloat(1.0e-4f));
+}
+
+TEST(Brain, ConvolutionLayersMatchDirectLoops)
+{
+  ndSetRandSeed(29);
+  CheckConvolutionLayer<ndBrainLayerConvolutional_2d>(9, 7, 3, 3, 5, true);
+  CheckConvolutionLayer<ndBrainLayerConvolutional_2d>(28, 28, 1, 3, 4, true);
+  CheckConvolutionLayer<ndBrainLayerConvolutional_2d>(12, 10, 2, 5, 3, true);
+  CheckConvolutionLayer<ndBrainLayerCrossCorrelation_2d>(9, 7, 3, 3, 5, false);
+  CheckConvolutionLayer<ndBrainLayerCrossCorrelation_2d>(28, 28, 1, 3, 4, false);
+  CheckConvolutionLayer<ndBrainLayerCrossCorrelation_2d>(12, 10, 2, 5, 3, false);
+}
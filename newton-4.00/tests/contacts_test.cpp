@@ -0,0 +1,418 @@
+/* Copyright (c) <2003-2019> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+#include "ndNewton.h"
+#include <gtest/gtest.h>
+#include <set>
+#include <map>
+
+// a floor with a pile of 200 boxes in two layers
+static void BuildBoxPile(ndWorld& world, std::map<const ndBody*, int>& bodyIndex) {
+  ndShapeInstance floorShape(new ndShapeBox(40.0f, 1.0f, 40.0f));
+  ndBodyKinematic* const floor = new ndBodyKinematic();
+  floor->SetCollisionShape(floorShape);
+  floor->SetMatrix(ndGetIdentityMatrix());
+  ndSharedPtr<ndBody> floorPtr(floor);
+  world.AddBody(floorPtr);
+  bodyIndex[floor] = 0;
+
+  ndShapeInstance shape(new ndShapeBox(1.0f, 1.0f, 1.0f));
+  for (int i = 0; i < 200; i++) {
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = ndVector(ndFloat32(i % 10) * 1.05f, 1.0f + ndFloat32(i / 100) * 1.02f, ndFloat32((i / 10) % 10) * 1.05f, 1.0f);
+    ndBodyDynamic* const body = new ndBodyDynamic();
+    body->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+    body->SetCollisionShape(shape);
+    body->SetMatrix(matrix);
+    body->SetMassMatrix(1.0f, shape);
+    ndSharedPtr<ndBody> bodyPtr(body);
+    world.AddBody(bodyPtr);
+    bodyIndex[body] = i + 1;
+  }
+}
+
+/* Resting islands leave the collision pipeline and come back when something hits them. */
+TEST(Contacts, IslandSleepParksRestingContacts) {
+  ndWorld world;
+  world.GetScene()->SetIslandSleep(true);
+  EXPECT_TRUE(world.GetScene()->GetIslandSleep());
+
+  std::map<const ndBody*, int> bodyIndex;
+  BuildBoxPile(world, bodyIndex);
+  for (int i = 0; i < 300; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+  const ndInt32 sleepingCount = world.GetScene()->GetSleepingContactCount();
+  EXPECT_GT(sleepingCount, 0);
+  EXPECT_LT(world.GetContactList().GetCount(), sleepingCount);
+
+  // drop a box on the pile, it must land on it and not go through.
+  ndShapeInstance shape(new ndShapeBox(1.0f, 1.0f, 1.0f));
+  ndMatrix matrix(ndGetIdentityMatrix());
+  matrix.m_posit = ndVector(4.2f, 5.0f, 4.2f, 1.0f);
+  ndBodyDynamic* const box = new ndBodyDynamic();
+  box->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+  box->SetCollisionShape(shape);
+  box->SetMatrix(matrix);
+  box->SetMassMatrix(1.0f, shape);
+  ndSharedPtr<ndBody> boxPtr(box);
+  world.AddBody(boxPtr);
+
+  for (int i = 0; i < 120; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+  EXPECT_GT(box->GetMatrix().m_posit.m_y, 2.5f);
+
+  const ndBodyListView& bodyList = world.GetBodyList();
+  for (ndBodyListView::ndNode* node = bodyList.GetFirst(); node; node = node->GetNext()) {
+    ndBodyKinematic* const body = node->GetInfo()->GetAsBodyKinematic();
+    if (body->GetInvMass() > 0.0f) {
+      EXPECT_GT(body->GetMatrix().m_posit.m_y, 0.5f);
+    }
+    EXPECT_TRUE(body->GetContactMap().SanityCheck());
+  }
+
+  // leaving the mode returns every contact to the scene.
+  const ndInt32 totalCount = world.GetContactList().GetCount() + world.GetScene()->GetSleepingContactCount();
+  world.GetScene()->SetIslandSleep(false);
+  EXPECT_EQ(world.GetScene()->GetSleepingContactCount(), 0);
+  EXPECT_EQ(world.GetContactList().GetCount(), totalCount);
+  world.Update(1.0f / 60.0f);
+  world.Sync();
+  world.CleanUp();
+}
+
+/* Parked contacts leave the world contact list but stay in the contact maps of their bodies. */
+TEST(Contacts, ParkedContactsStayInContactMaps) {
+  ndWorld world;
+  world.GetScene()->SetIslandSleep(true);
+
+  std::map<const ndBody*, int> bodyIndex;
+  BuildBoxPile(world, bodyIndex);
+  for (int i = 0; i < 300; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+
+  std::set<const ndContact*> listed;
+  const ndContactArray& contacts = world.GetContactList();
+  for (ndInt32 i = 0; i < contacts.GetCount(); i++) {
+    listed.insert(contacts[i]);
+  }
+  std::set<const ndContact*> mapped;
+  ndBodyKinematic* floor = nullptr;
+  const ndBodyListView& bodyList = world.GetBodyList();
+  for (ndBodyListView::ndNode* node = bodyList.GetFirst(); node; node = node->GetNext()) {
+    ndBodyKinematic* const body = node->GetInfo()->GetAsBodyKinematic();
+    floor = (body->GetInvMass() == 0.0f) ? body : floor;
+    ndBodyKinematic::ndContactMap::Iterator it(body->GetContactMap());
+    for (it.Begin(); it; it++) {
+      mapped.insert(*it);
+    }
+  }
+  const ndInt32 sleepingCount = world.GetScene()->GetSleepingContactCount();
+  EXPECT_GT(sleepingCount, 0);
+  EXPECT_EQ(mapped.size(), listed.size() + size_t(sleepingCount));
+  for (const ndContact* const contact : listed) {
+    EXPECT_TRUE(mapped.count(contact));
+  }
+
+  // removing the floor kills its parked contacts, the next update collects them.
+  ndAssert(floor);
+  const ndInt32 floorContacts = ndInt32(floor->GetContactMap().GetCount());
+  EXPECT_GT(floorContacts, 0);
+  world.RemoveBody(floor);
+  world.Update(1.0f / 60.0f);
+  world.Sync();
+  EXPECT_LE(world.GetScene()->GetSleepingContactCount(), sleepingCount - floorContacts);
+  for (ndBodyListView::ndNode* node = bodyList.GetFirst(); node; node = node->GetNext()) {
+    ndBodyKinematic* const body = node->GetInfo()->GetAsBodyKinematic();
+    EXPECT_TRUE(body->GetContactMap().SanityCheck());
+  }
+  world.CleanUp();
+}
+
+/* Contact points of a resting box keep their feature ids and carry their forces across frames. */
+TEST(Contacts, ContactWarmStart) {
+  ndWorld world;
+  ndShapeInstance floorShape(new ndShapeBox(40.0f, 1.0f, 40.0f));
+  ndMatrix floorMatrix(ndGetIdentityMatrix());
+  floorMatrix.m_posit.m_y = -0.5f;
+  ndBodyKinematic* const floor = new ndBodyKinematic();
+  floor->SetCollisionShape(floorShape);
+  floor->SetMatrix(floorMatrix);
+  ndSharedPtr<ndBody> floorPtr(floor);
+  world.AddBody(floorPtr);
+
+  ndShapeInstance shape(new ndShapeBox(1.0f, 1.0f, 1.0f));
+  ndMatrix matrix(ndYawMatrix(30.0f * ndDegreeToRad));
+  matrix.m_posit = ndVector(0.0f, 0.51f, 0.0f, 1.0f);
+  ndBodyDynamic* const box = new ndBodyDynamic();
+  box->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+  box->SetCollisionShape(shape);
+  box->SetMatrix(matrix);
+  box->SetMassMatrix(2.0f, shape);
+  box->SetAutoSleep(false);
+  ndSharedPtr<ndBody> boxPtr(box);
+  world.AddBody(boxPtr);
+
+  auto GetContactPoints = [box]() {
+    const ndContactPointList* points = nullptr;
+    ndBodyKinematic::ndContactMap& contactMap = box->GetContactMap();
+    ndBodyKinematic::ndContactMap::Iterator it(contactMap);
+    for (it.Begin(); it; it++) {
+      const ndContact* const contact = *it;
+      if (contact->IsActive()) {
+        points = &contact->GetContactPoints();
+      }
+    }
+    return points;
+  };
+
+  for (int i = 0; i < 60; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+
+  const ndContactPointList* const points0 = GetContactPoints();
+  ASSERT_TRUE(points0 != nullptr);
+  EXPECT_EQ(points0->GetCount(), 4);
+  std::set<ndUnsigned64> features;
+  for (ndContactPointList::ndNode* node = points0->GetFirst(); node; node = node->GetNext()) {
+    features.insert(node->GetInfo().m_featureId);
+  }
+  EXPECT_EQ(int(features.size()), points0->GetCount());
+
+  for (int i = 0; i < 10; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+
+  // same features, and the warm start forces add up to the weight of the box
+  ndFloat32 warmStart = 0.0f;
+  const ndContactPointList* const points1 = GetContactPoints();
+  ASSERT_TRUE(points1 != nullptr);
+  for (ndContactPointList::ndNode* node = points1->GetFirst(); node; node = node->GetNext()) {
+    EXPECT_TRUE(features.find(node->GetInfo().m_featureId) != features.end());
+    warmStart += node->GetInfo().m_normal_Force.GetWarmStart();
+  }
+  EXPECT_NEAR(warmStart, 0.9f * 20.0f, 2.0f);
+  world.CleanUp();
+}
+
+/* The batched narrow phase finds the same contacts as the generic solver for each primitive pair type. */
+TEST(Contacts, ContactBatchMatchesGeneric) {
+  ndShapeInstance sphere(new ndShapeSphere(0.5f));
+  ndShapeInstance capsule(new ndShapeCapsule(0.25f, 0.25f, 1.0f));
+  ndShapeInstance box(new ndShapeBox(1.0f, 0.6f, 2.0f));
+
+  // solves one pair with both paths, returns the number of contacts of the
+  // batch, or -1 when the two paths can not be compared.
+  auto Solve = [](const ndShapeInstance& shape0, const ndMatrix& matrix0, const ndShapeInstance& shape1, const ndMatrix& matrix1) {
+    ndContactSolver solver;
+    ndFixSizeArray<ndContactPoint, 16> generic;
+    solver.CalculateContacts(&shape0, matrix0, ndVector::m_zero, &shape1, matrix1, ndVector::m_zero, generic, nullptr);
+
+    ndShapeInstance instance0(shape0);
+    ndShapeInstance instance1(shape1);
+    instance0.SetGlobalMatrix(matrix0);
+    instance1.SetGlobalMatrix(matrix1);
+    ndContactPoint contacts[D_CONTACT_BATCH_MAX_POINTS];
+    ndContactBatch::ndPair pair;
+    pair.m_instance0 = &instance0;
+    pair.m_instance1 = &instance1;
+    pair.m_contacts = contacts;
+    ndContactBatch::CalculateContacts(ndContactBatch::GetPairType(shape0, shape1), &pair, 1);
+    if (pair.m_degenerate) {
+      EXPECT_EQ(pair.m_count, 0);
+      return -1;
+    }
+
+    ndFloat32 penetration0 = -1.0e10f;
+    ndFloat32 penetration1 = -1.0e10f;
+    for (int j = 0; j < generic.GetCount(); j++) {
+      penetration0 = ndMax(penetration0, generic[j].m_penetration);
+    }
+    for (int j = 0; j < pair.m_count; j++) {
+      penetration1 = ndMax(penetration1, contacts[j].m_penetration);
+    }
+    // the two paths may disagree right at the contact threshold, and
+    // the generic solver finds no contact when two capsule segments cross
+    if ((generic.GetCount() != 0) != (pair.m_count != 0)) {
+      EXPECT_TRUE((ndMax(penetration0, penetration1) < 2.0f * D_PENETRATION_TOL) || (!generic.GetCount() && (penetration1 > 0.45f)));
+      return -1;
+    }
+    if (generic.GetCount()) {
+      // the batch keeps the reference face of a box pair up to 5% past
+      // the best axis, so the two paths can pick different box features.
+      const bool boxes = (ndContactBatch::GetPairType(shape0, shape1) == ndContactBatch::m_boxBox);
+      const ndFloat32 tol = 2.0f * D_PENETRATION_TOL + (boxes ? 0.05f * penetration0 + 1.0e-3f : 0.0f);
+      if (boxes) {
+        // several box axes can tie, the batch normal must just be the
+        // direction of its reported penetration.
+        const ndVector normal(contacts[0].m_normal);
+        const ndVector support0(matrix0.TransformVector(shape0.SupportVertex(matrix0.UnrotateVector(normal.Scale(-1.0f)))));
+        const ndVector support1(matrix1.TransformVector(shape1.SupportVertex(matrix1.UnrotateVector(normal))));
+        const ndFloat32 overlap = normal.DotProduct(support1 - support0).GetScalar();
+        EXPECT_NEAR(overlap + D_PENETRATION_TOL, penetration1, tol);
+      } else if (penetration0 < 0.25f) {
+        // with the sphere center inside the box the closest face is ambiguous
+        EXPECT_GT(generic[0].m_normal.DotProduct(contacts[0].m_normal).GetScalar(), 0.99f);
+      }
+      EXPECT_NEAR(penetration0, penetration1, tol);
+    }
+    return pair.m_count;
+  };
+
+  auto Compare = [&Solve](const ndShapeInstance& shape0, const ndShapeInstance& shape1, ndFloat32 minDist, ndFloat32 maxDist) {
+    EXPECT_NE(ndContactBatch::GetPairType(shape0, shape1), ndContactBatch::m_generic);
+    int hits = 0;
+    for (int i = 0; i < 500; i++) {
+      const ndVector dir(ndVector(ndRand() - 0.5f, ndRand() - 0.5f, ndRand() - 0.5f, 0.0f).Normalize());
+      ndMatrix matrix0(ndPitchMatrix(ndRand() * 6.0f) * ndYawMatrix(ndRand() * 6.0f) * ndRollMatrix(ndRand() * 6.0f));
+      ndMatrix matrix1(ndPitchMatrix(ndRand() * 6.0f) * ndYawMatrix(ndRand() * 6.0f) * ndRollMatrix(ndRand() * 6.0f));
+      matrix1.m_posit = dir.Scale(minDist + (maxDist - minDist) * ndRand()) | ndVector::m_wOne;
+      if (Solve(shape0, matrix0, shape1, matrix1) > 0) {
+        hits++;
+      }
+    }
+    EXPECT_GT(hits, 100);
+  };
+
+  Compare(sphere, sphere, 0.8f, 1.05f);
+  Compare(sphere, capsule, 0.6f, 1.3f);
+  Compare(capsule, capsule, 0.4f, 1.5f);
+  Compare(sphere, box, 0.7f, 1.4f);
+  Compare(box, sphere, 0.7f, 1.4f);
+
+  // the generic solver underestimates deep box penetrations, so the box pairs
+  // are placed at the distance where they touch along a random direction,
+  // minus a small penetration. the boxes overlap on all the 15 separating axes.
+  auto CompareBoxes = [&Solve](const ndShapeInstance& shape, const ndVector& halfSize) {
+    int hits = 0;
+    for (int i = 0; i < 500; i++) {
+      const ndVector dir(ndVector(ndRand() - 0.5f, ndRand() - 0.5f, ndRand() - 0.5f, 0.0f).Normalize());
+      ndMatrix matrix0(ndPitchMatrix(ndRand() * 6.0f) * ndYawMatrix(ndRand() * 6.0f) * ndRollMatrix(ndRand() * 6.0f));
+      ndMatrix matrix1(ndPitchMatrix(ndRand() * 6.0f) * ndYawMatrix(ndRand() * 6.0f) * ndRollMatrix(ndRand() * 6.0f));
+
+      ndFixSizeArray<ndVector, 15> axes;
+      for (int j = 0; j < 3; j++) {
+        axes.PushBack(matrix0[j]);
+        axes.PushBack(matrix1[j]);
+        for (int k = 0; k < 3; k++) {
+          const ndVector cross(matrix0[j].CrossProduct(matrix1[k]));
+          if (cross.DotProduct(cross).GetScalar() > 1.0e-6f) {
+            axes.PushBack(cross.Normalize());
+          }
+        }
+      }
+      ndFloat32 touchDist = 1.0e10f;
+      for (int j = 0; j < axes.GetCount(); j++) {
+        const ndVector axis(axes[j] & ndVector::m_triplexMask);
+        ndFloat32 radius = 0.0f;
+        for (int k = 0; k < 3; k++) {
+          radius += halfSize[k] * (ndAbs(axis.DotProduct(matrix0[k]).GetScalar()) + ndAbs(axis.DotProduct(matrix1[k]).GetScalar()));
+        }
+        const ndFloat32 project = ndAbs(axis.DotProduct(dir).GetScalar());
+        if (project > 1.0e-6f) {
+          touchDist = ndMin(touchDist, radius / project);
+        }
+      }
+      matrix1.m_posit = dir.Scale(touchDist - 0.03f * ndRand()) | ndVector::m_wOne;
+      if (Solve(shape, matrix0, shape, matrix1) > 0) {
+        hits++;
+      }
+    }
+    EXPECT_GT(hits, 400);
+  };
+  CompareBoxes(box, ndVector(0.5f, 0.3f, 1.0f, 0.0f));
+
+  // a box resting on another, face to face with four contacts, and shifted
+  // and turned so that the incident face is clipped by the reference face
+  ndShapeInstance cube(new ndShapeBox(1.0f, 1.0f, 1.0f));
+  ndMatrix matrix(ndGetIdentityMatrix());
+  matrix.m_posit = ndVector(0.0f, 0.99f, 0.0f, 1.0f);
+  EXPECT_EQ(Solve(cube, ndGetIdentityMatrix(), cube, matrix), 4);
+  matrix.m_posit = ndVector(0.3f, 0.99f, 0.2f, 1.0f);
+  EXPECT_GT(Solve(cube, ndGetIdentityMatrix(), cube, matrix), 0);
+  matrix = ndYawMatrix(0.4f);
+  matrix.m_posit = ndVector(0.0f, 0.79f, 0.0f, 1.0f);
+  EXPECT_GT(Solve(box, ndGetIdentityMatrix(), cube, matrix), 0);
+
+  // two cubes turned 45 degrees around crossing axes touch edge to edge,
+  // the generic solver returns a tiny patch around the single batch contact
+  matrix = ndPitchMatrix(ndPi * 0.25f);
+  ndMatrix matrix0(ndRollMatrix(ndPi * 0.25f));
+  matrix.m_posit = ndVector(0.0f, 1.4f, 0.0f, 1.0f);
+  EXPECT_EQ(Solve(cube, matrix0, cube, matrix), 1);
+
+  // concentric spheres have no contact direction, the batch hands them back
+  ndShapeInstance instance0(sphere);
+  ndShapeInstance instance1(sphere);
+  instance0.SetGlobalMatrix(ndGetIdentityMatrix());
+  instance1.SetGlobalMatrix(ndGetIdentityMatrix());
+  ndContactPoint contacts[D_CONTACT_BATCH_MAX_POINTS];
+  ndContactBatch::ndPair pair;
+  pair.m_instance0 = &instance0;
+  pair.m_instance1 = &instance1;
+  pair.m_contacts = contacts;
+  ndContactBatch::CalculateContacts(ndContactBatch::m_sphereSphere, &pair, 1);
+  EXPECT_EQ(pair.m_degenerate, 1);
+}
+
+/* Speculative contacts stop a fast body at a thin wall that it tunnels through without them. */
+TEST(Contacts, SpeculativeContactsStopFastBody) {
+  // a small sphere fired at a thin wall covers several times the wall
+  // thickness in one step, only the speculative contact can stop it.
+  auto FireAtWall = [](bool speculative) {
+    ndWorld world;
+    world.SetSubSteps(1);
+
+    ndShapeInstance wallShape(new ndShapeBox(0.1f, 4.0f, 4.0f));
+    ndBodyDynamic* const wall = new ndBodyDynamic();
+    wall->SetCollisionShape(wallShape);
+    wall->SetMatrix(ndGetIdentityMatrix());
+    ndSharedPtr<ndBody> wallPtr(wall);
+    world.AddBody(wallPtr);
+
+    ndShapeInstance shape(new ndShapeSphere(0.1f));
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = ndVector(-1.7f, 0.0f, 0.0f, 1.0f);
+    ndBodyDynamic* const bullet = new ndBodyDynamic();
+    bullet->SetNotifyCallback(new ndBodyNotify(ndVector::m_zero));
+    bullet->SetCollisionShape(shape);
+    bullet->SetMatrix(matrix);
+    bullet->SetMassMatrix(0.1f, shape);
+    bullet->SetAutoSleep(false);
+    bullet->SetVelocity(ndVector(200.0f, 0.0f, 0.0f, 0.0f));
+    bullet->SetSpeculativeContacts(speculative);
+    ndSharedPtr<ndBody> bulletPtr(bullet);
+    world.AddBody(bulletPtr);
+
+    ndFloat32 maxX = -1.0e10f;
+    for (int i = 0; i < 10; i++) {
+      world.Update(1.0f / 60.0f);
+      world.Sync();
+      maxX = ndMax(maxX, bullet->GetMatrix().m_posit.m_x);
+    }
+    world.CleanUp();
+    return maxX;
+  };
+
+  EXPECT_GT(FireAtWall(false), 0.15f);
+
+  // the sphere reaches the wall face, and never goes past it
+  const ndFloat32 x = FireAtWall(true);
+  EXPECT_LT(x, -0.14f);
+  EXPECT_GT(x, -0.16f);
+}
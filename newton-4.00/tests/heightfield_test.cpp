@@ -0,0 +1,229 @@
+/* Copyright (c) <2003-2019> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+#include "ndNewton.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+class ndTestRayCastNotify : public ndRayCastNotify {
+  public:
+  ndFloat32 OnRayCastAction(const ndContactPoint&, ndFloat32 intersetParam) { return intersetParam; }
+};
+
+static ndFloat32 HeightfieldRayHit(const ndShapeInstance& instance, const ndVector& p0, const ndVector& p1) {
+  ndContactPoint contact;
+  ndTestRayCastNotify callback;
+  return instance.RayCast(callback, p0, p1, nullptr, contact);
+}
+
+/* A tiled heightfield collides like a dense one, holes in unloaded tiles and edits of single samples included. */
+TEST(Heightfield, TiledHeightfield) {
+  const int tileSize = 16;
+  const int tiles = 4;
+  const int width = tiles * tileSize;
+  const ndFloat32 scale = 0.5f;
+  auto Height = [](int x, int z) { return ndReal(2.0f * ndSin(ndFloat32(x) * 0.21f) * ndCos(ndFloat32(z) * 0.17f)); };
+
+  ndShapeHeightfield* const dense = new ndShapeHeightfield(width, width, ndShapeHeightfield::m_normalDiagonals, scale, scale);
+  for (int z = 0; z < width; z++) {
+    for (int x = 0; x < width; x++) {
+      dense->GetElevationMap()[z * width + x] = Height(x, z);
+    }
+  }
+  dense->UpdateElevationMapAabb();
+
+  ndShapeHeightfield* const tiled = new ndShapeHeightfield(tiles, tiles, tileSize, ndShapeHeightfield::m_normalDiagonals, scale, scale);
+  EXPECT_TRUE(tiled->IsTiled());
+  EXPECT_FALSE(tiled->IsTileLoaded(0, 0));
+  std::vector<ndReal> tileElevation(tileSize * tileSize);
+  for (int tz = 0; tz < tiles; tz++) {
+    for (int tx = 0; tx < tiles; tx++) {
+      for (int z = 0; z < tileSize; z++) {
+        for (int x = 0; x < tileSize; x++) {
+          tileElevation[z * tileSize + x] = Height(tx * tileSize + x, tz * tileSize + z);
+        }
+      }
+      tiled->LoadTile(tx, tz, &tileElevation[0], nullptr);
+    }
+  }
+
+  ndShapeInstance denseInstance(dense);
+  ndShapeInstance tiledInstance(tiled);
+
+  // the height under a vertical ray, from the two triangles of the cell
+  auto SurfaceHeight = [&](ndFloat32 px, ndFloat32 pz) {
+    const int x = int(px / scale);
+    const int z = int(pz / scale);
+    const ndFloat32 u = px / scale - ndFloat32(x);
+    const ndFloat32 v = pz / scale - ndFloat32(z);
+    const ndFloat32 h00 = tiled->GetElevation(x, z);
+    const ndFloat32 h10 = tiled->GetElevation(x + 1, z);
+    const ndFloat32 h01 = tiled->GetElevation(x, z + 1);
+    const ndFloat32 h11 = tiled->GetElevation(x + 1, z + 1);
+    if ((u + v) <= 1.0f) {
+      return h00 + u * (h10 - h00) + v * (h01 - h00);
+    }
+    return h11 + (1.0f - u) * (h01 - h11) + (1.0f - v) * (h10 - h11);
+  };
+
+  const ndFloat32 size = ndFloat32(width - 1) * scale;
+  ndSetRandSeed(23);
+  int hits = 0;
+  for (int i = 0; i < 500; i++) {
+    const ndVector p0(ndRand() * size, 4.0f, ndRand() * size, 0.0f);
+    const ndVector p1(ndRand() * size, -4.0f, ndRand() * size, 0.0f);
+    const ndFloat32 t0 = HeightfieldRayHit(denseInstance, p0, p1);
+    const ndFloat32 t1 = HeightfieldRayHit(tiledInstance, p0, p1);
+    EXPECT_EQ(t0 < 1.0f, t1 < 1.0f);
+    if ((t0 < 1.0f) && (t1 < 1.0f)) {
+      EXPECT_NEAR(t0, t1, 1.0e-5f);
+      hits++;
+    }
+
+    const ndVector q0(p0.m_x, 4.0f, p0.m_z, 0.0f);
+    const ndVector q1(p0.m_x, -4.0f, p0.m_z, 0.0f);
+    const ndFloat32 t = HeightfieldRayHit(tiledInstance, q0, q1);
+    EXPECT_NEAR(t, (4.0f - SurfaceHeight(p0.m_x, p0.m_z)) / 8.0f, 1.0e-4f);
+
+    const ndVector b0(ndMin(p0.m_x, p1.m_x), -1.0f, ndMin(p0.m_z, p1.m_z), 0.0f);
+    const ndVector b1(ndMax(p0.m_x, p1.m_x), 1.0f, ndMax(p0.m_z, p1.m_z), 0.0f);
+    ndVector denseP0, denseP1, tiledP0, tiledP1;
+    dense->GetLocalAabb(b0, b1, denseP0, denseP1);
+    tiled->GetLocalAabb(b0, b1, tiledP0, tiledP1);
+    EXPECT_EQ(denseP0.m_y, tiledP0.m_y);
+    EXPECT_EQ(denseP1.m_y, tiledP1.m_y);
+    for (int z = int(b0.m_z / scale) + 1; z <= int(b1.m_z / scale); z++) {
+      for (int x = int(b0.m_x / scale) + 1; x <= int(b1.m_x / scale); x++) {
+        EXPECT_LE(tiledP0.m_y, Height(x, z));
+        EXPECT_GE(tiledP1.m_y, Height(x, z));
+      }
+    }
+  }
+  EXPECT_GT(hits, 400);
+
+  // an unloaded tile is a hole, the rest of the map still collides
+  tiled->UnloadTile(1, 2);
+  EXPECT_FALSE(tiled->IsTileLoaded(1, 2));
+  for (int i = 0; i < 100; i++) {
+    const ndFloat32 x = (16.0f + ndRand() * 14.0f) * scale;
+    const ndFloat32 z = (32.0f + ndRand() * 14.0f) * scale;
+    EXPECT_GT(HeightfieldRayHit(tiledInstance, ndVector(x, 4.0f, z, 0.0f), ndVector(x, -4.0f, z, 0.0f)), 1.0f);
+    EXPECT_LT(HeightfieldRayHit(tiledInstance, ndVector(z, 4.0f, x, 0.0f), ndVector(z, -4.0f, x, 0.0f)), 1.0f);
+  }
+
+  // an edit of one sample moves the surface and the bounds of the map
+  tiled->GetTileElevation(2, 0)[5 * tileSize + 6] = 10.0f;
+  tiled->UpdateElevationMapAabb(2 * tileSize + 6, 5, 2 * tileSize + 6, 5);
+  const ndFloat32 x = ndFloat32(2 * tileSize + 6) * scale;
+  const ndFloat32 z = ndFloat32(5) * scale;
+  const ndFloat32 t = HeightfieldRayHit(tiledInstance, ndVector(x, 20.0f, z, 0.0f), ndVector(x, -20.0f, z, 0.0f));
+  EXPECT_NEAR(t, 0.25f, 1.0e-4f);
+  ndVector boxP0, boxP1;
+  tiled->GetLocalAabb(ndVector(x - 1.0f, -1.0f, z - 1.0f, 0.0f), ndVector(x + 1.0f, 1.0f, z + 1.0f, 0.0f), boxP0, boxP1);
+  EXPECT_EQ(boxP1.m_y, 10.0f);
+
+  tiled->GetTileElevation(2, 0)[5 * tileSize + 6] = Height(2 * tileSize + 6, 5);
+  tiled->UpdateElevationMapAabb(2 * tileSize + 6, 5, 2 * tileSize + 6, 5);
+  tiled->GetLocalAabb(ndVector(x - 1.0f, -1.0f, z - 1.0f, 0.0f), ndVector(x + 1.0f, 1.0f, z + 1.0f, 0.0f), boxP0, boxP1);
+  EXPECT_LT(boxP1.m_y, 2.0f);
+
+  // a sphere rests on a loaded tile and falls through the hole of the unloaded one
+  ndWorld world;
+  ndBodyKinematic* const floor = new ndBodyKinematic();
+  floor->SetCollisionShape(tiledInstance);
+  floor->SetMatrix(ndGetIdentityMatrix());
+  ndSharedPtr<ndBody> floorPtr(floor);
+  world.AddBody(floorPtr);
+
+  ndShapeInstance sphereShape(new ndShapeSphere(0.25f));
+  const ndVector restPosit(40.0f * scale, 3.0f, 40.0f * scale, 1.0f);
+  const ndVector holePosit(24.0f * scale, 3.0f, 24.0f * scale, 1.0f);
+  ndBodyDynamic* spheres[2];
+  for (int i = 0; i < 2; i++) {
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = i ? holePosit : restPosit;
+    spheres[i] = new ndBodyDynamic();
+    spheres[i]->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+    spheres[i]->SetCollisionShape(sphereShape);
+    spheres[i]->SetMatrix(matrix);
+    spheres[i]->SetMassMatrix(1.0f, sphereShape);
+    ndSharedPtr<ndBody> spherePtr(spheres[i]);
+    world.AddBody(spherePtr);
+  }
+  tiled->UnloadTile(1, 1);
+  floor->CollisionShapeChanged();
+  for (int i = 0; i < 120; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+  const ndVector spherePosit(spheres[0]->GetMatrix().m_posit);
+  EXPECT_GT(spherePosit.m_y, SurfaceHeight(spherePosit.m_x, spherePosit.m_z));
+  EXPECT_LT(spheres[1]->GetMatrix().m_posit.m_y, -5.0f);
+  world.CleanUp();
+}
+
+/* Tiles loaded and unloaded under a heightfield body in a world move its bounds in the scene and wake the bodies resting on it. */
+TEST(Heightfield, TilesChangedAfterAddBody) {
+  const int tileSize = 8;
+  const int tiles = 4;
+  const ndFloat32 scale = 0.5f;
+
+  ndShapeHeightfield* const tiled = new ndShapeHeightfield(tiles, tiles, tileSize, ndShapeHeightfield::m_normalDiagonals, scale, scale);
+  std::vector<ndReal> flat(tileSize * tileSize, ndReal(0.0f));
+  std::vector<ndReal> raised(tileSize * tileSize, ndReal(2.0f));
+  for (int tz = 0; tz < tiles; tz++) {
+    for (int tx = 0; tx < tiles; tx++) {
+      tiled->LoadTile(tx, tz, &flat[0], nullptr);
+    }
+  }
+  ndShapeInstance tiledInstance(tiled);
+
+  ndWorld world;
+  ndBodyKinematic* const floor = new ndBodyKinematic();
+  floor->SetCollisionShape(tiledInstance);
+  floor->SetMatrix(ndGetIdentityMatrix());
+  ndSharedPtr<ndBody> floorPtr(floor);
+  world.AddBody(floorPtr);
+  world.Update(1.0f / 60.0f);
+  world.Sync();
+
+  // the raised tile is far above the bounds the floor had when it was added
+  ndShapeHeightfield* const shape = floor->GetCollisionShape().GetShape()->GetAsShapeHeightfield();
+  shape->LoadTile(1, 1, &raised[0], nullptr);
+  floor->CollisionShapeChanged();
+
+  ndShapeInstance sphereShape(new ndShapeSphere(0.25f));
+  ndMatrix matrix(ndGetIdentityMatrix());
+  matrix.m_posit = ndVector(12.0f * scale, 4.0f, 12.0f * scale, 1.0f);
+  ndBodyDynamic* const sphere = new ndBodyDynamic();
+  sphere->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+  sphere->SetCollisionShape(sphereShape);
+  sphere->SetMatrix(matrix);
+  sphere->SetMassMatrix(1.0f, sphereShape);
+  ndSharedPtr<ndBody> spherePtr(sphere);
+  world.AddBody(spherePtr);
+  for (int i = 0; i < 240; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+  EXPECT_NEAR(sphere->GetMatrix().m_posit.m_y, 2.25f, 0.05f);
+  EXPECT_TRUE(sphere->GetSleepState());
+
+  // the sphere sleeps on the tile, it wakes up and falls through the hole when the tile is unloaded
+  shape->UnloadTile(1, 1);
+  floor->CollisionShapeChanged();
+  for (int i = 0; i < 120; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+  EXPECT_LT(sphere->GetMatrix().m_posit.m_y, -5.0f);
+  world.CleanUp();
+}
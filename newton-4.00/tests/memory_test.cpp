@@ -0,0 +1,101 @@
+/* Copyright (c) <2003-2019> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+#include "ndNewton.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+/* Memory allocated by one allocator must be released correctly after switching to another. */
+TEST(Memory, SlabAllocatorSwitch)
+{
+	ndMemAllocCallback alloc;
+	ndMemFreeCallback free;
+	ndMemory::GetMemoryAllocators(alloc, free);
+	void* const defaultBuffer = ndMemory::Malloc(100);
+
+	ndMemory::SetMemoryAllocators(ndSlabAllocator::Malloc, ndSlabAllocator::Free);
+	EXPECT_TRUE(ndMemory::IsThreadLocalAllocator());
+
+	ndArray<void*> buffers;
+	for (ndInt32 size = 1; size < 20000; size += 97)
+	{
+		char* const ptr = (char*)ndMemory::Malloc(size_t(size));
+		EXPECT_EQ(ndMemory::GetOriginalSize(ptr), size_t(size));
+		EXPECT_EQ(size_t(ptr) & (D_MEMORY_ALIGMNET - 1), size_t(0));
+		memset(ptr, 0xff, size_t(size));
+		buffers.PushBack(ptr);
+	}
+
+	// blocks allocated by a thread and released by another.
+	std::thread worker([&buffers]()
+	{
+		for (ndInt32 i = 0; i < 1000; ++i)
+		{
+			buffers.PushBack(ndMemory::Malloc(size_t(i * 8 + 8)));
+		}
+		ndSlabAllocator::FlushThreadCache();
+	});
+	worker.join();
+
+	ndList<ndInt32, ndContainersFreeListAlloc<ndInt32>>* const list = new ndList<ndInt32, ndContainersFreeListAlloc<ndInt32>>();
+	for (ndInt32 i = 0; i < 1000; ++i)
+	{
+		list->Append(i);
+	}
+
+	for (ndInt32 i = 0; i < buffers.GetCount(); i += 2)
+	{
+		ndMemory::Free(buffers[i]);
+	}
+	ndMemory::Free(defaultBuffer);
+
+	ndMemory::SetMemoryAllocators(alloc, free);
+	EXPECT_FALSE(ndMemory::IsThreadLocalAllocator());
+	for (ndInt32 i = 1; i < buffers.GetCount(); i += 2)
+	{
+		ndMemory::Free(buffers[i]);
+	}
+	delete list;
+}
+
+/* After the first frame the arenas are merged, so the same allocations do not touch the heap. */
+TEST(Memory, FrameAllocatorSteadyState)
+{
+	ndFrameAllocator allocator;
+	allocator.SetThreadCount(2);
+
+	for (ndInt32 frame = 0; frame < 3; ++frame)
+	{
+		allocator.Reset();
+		const ndUnsigned64 allocations = ndMemory::GetThreadAllocationCount();
+
+		ndFrameAllocator::ndMark mark(allocator.GetMark(1));
+		char* const buffer0 = (char*)allocator.Alloc(1, 1000);
+		allocator.Release(1, mark);
+		char* const buffer1 = (char*)allocator.Alloc(1, 1000);
+		EXPECT_EQ(buffer0, buffer1);
+
+		// overflow the first chunk
+		for (ndInt32 i = 0; i < 10; ++i)
+		{
+			ndFrameAllocator::ndScope scope(&allocator, 0);
+			ndInt32* const buffer = allocator.Alloc<ndInt32>(0, 10000);
+			EXPECT_EQ(size_t(buffer) & (D_MEMORY_ALIGMNET - 1), size_t(0));
+			memset(buffer, 0, 10000 * sizeof(ndInt32));
+			allocator.Alloc(0, 100 * 1024);
+		}
+
+		if (frame)
+		{
+			EXPECT_EQ(ndMemory::GetThreadAllocationCount(), allocations);
+		}
+	}
+}
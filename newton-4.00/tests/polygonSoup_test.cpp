@@ -0,0 +1,407 @@
+/* Copyright (c) <2003-2019> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+#include "ndNewton.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <vector>
+#include <algorithm>
+
+// an oriented box query, the way the static mesh contacts set it up.
+class ndTestOrientedBox : public ndFastAabb {
+ public:
+  ndTestOrientedBox(const ndMatrix& matrix, const ndVector& halfSize) : ndFastAabb(matrix, halfSize) {
+    m_size = halfSize;
+  }
+};
+
+class ndTestPolygonSoup : public ndShapeStatic_bvh {
+ public:
+  class ndClosestHit {
+   public:
+    ndClosestHit(const ndVector& p0, const ndVector& p1) : m_ray(p0, p1), m_t(1.2f) {}
+    ndFastRay m_ray;
+    ndFloat32 m_t;
+  };
+
+  ndTestPolygonSoup(const ndPolygonSoupBuilder& builder) : ndShapeStatic_bvh(builder) {
+    // a box enclosing the whole mesh collects every face.
+    m_faces = GetFaces(ndFastAabb(ndVector(-1.0e10f), ndVector(1.0e10f)));
+  }
+
+  ndTestPolygonSoup(const ndPolygonSoupBuilder& builder, ndThreadPool& threadPool) : ndShapeStatic_bvh(builder, threadPool) {
+    m_faces = GetFaces(ndFastAabb(ndVector(-1.0e10f), ndVector(1.0e10f)));
+  }
+
+  ndTestPolygonSoup(const char* const path) : ndShapeStatic_bvh(path) {
+    m_faces = GetFaces(ndFastAabb(ndVector(-1.0e10f), ndVector(1.0e10f)));
+  }
+
+  // the index array of each face, in the order they are laid out in the mesh.
+  std::vector<ndInt32> GetFaceIndices() const {
+    std::vector<ndInt32> indices;
+    for (std::set<const ndInt32*>::const_iterator it = m_faces.begin(); it != m_faces.end(); it++) {
+      indices.insert(indices.end(), *it, *it + 9);
+    }
+    return indices;
+  }
+
+  int GetConcaveEdgeCount() const {
+    int count = 0;
+    for (std::set<const ndInt32*>::const_iterator it = m_faces.begin(); it != m_faces.end(); it++) {
+      for (int i = 0; i < 3; i++) {
+        count += ((*it)[5 + i] & D_CONCAVE_EDGE_MASK) ? 1 : 0;
+      }
+    }
+    return count;
+  }
+
+  std::set<const ndInt32*> GetFaces(const ndFastAabb& box) const {
+    std::set<const ndInt32*> faces;
+    ForAllSectors(box, ndVector::m_zero, 1.0f, CollectFace, &faces);
+    return faces;
+  }
+
+  std::set<const ndInt32*> GetFacesBruteForce(const ndFastAabb& box, bool testFaceBox) const {
+    std::set<const ndInt32*> faces;
+    const ndFloat32* const vertex = GetLocalVertexPool();
+    const ndInt32 stride = GetStrideInBytes() / ndInt32(sizeof(ndFloat32));
+    for (std::set<const ndInt32*>::const_iterator it = m_faces.begin(); it != m_faces.end(); it++) {
+      const ndInt32* const indices = *it;
+      const ndVector normal(ndVector(&vertex[indices[4] * stride]) & ndVector::m_triplexMask);
+      bool overlap = box.PolygonBoxDistance(normal, 3, indices, stride, vertex) > 0.0f;
+      if (overlap && testFaceBox) {
+        // a node with the box of the face
+        ndTriplex faceBox[2];
+        ndVector p0(ndVector(&vertex[indices[0] * stride]) & ndVector::m_triplexMask);
+        ndVector p1(p0);
+        for (int i = 1; i < 3; i++) {
+          const ndVector p(ndVector(&vertex[indices[i] * stride]) & ndVector::m_triplexMask);
+          p0 = p0.GetMin(p);
+          p1 = p1.GetMax(p);
+        }
+        faceBox[0].m_x = p0.m_x;
+        faceBox[0].m_y = p0.m_y;
+        faceBox[0].m_z = p0.m_z;
+        faceBox[1].m_x = p1.m_x;
+        faceBox[1].m_y = p1.m_y;
+        faceBox[1].m_z = p1.m_z;
+        ndAabbPolygonSoup::ndNode node;
+        node.m_indexBox0 = 0;
+        node.m_indexBox1 = 1;
+        overlap = node.BoxPenetration(box, faceBox) > 0.0f;
+      }
+      if (overlap) {
+        faces.insert(indices);
+      }
+    }
+    return faces;
+  }
+
+  ndFloat32 RayHit(const ndVector& p0, const ndVector& p1) const {
+    ndClosestHit hit(p0, p1);
+    ForAllSectorsRayHit(hit.m_ray, 1.0f, ClosestHit, &hit);
+    return hit.m_t;
+  }
+
+  ndFloat32 RayHitBruteForce(const ndVector& p0, const ndVector& p1) const {
+    ndClosestHit hit(p0, p1);
+    for (std::set<const ndInt32*>::const_iterator it = m_faces.begin(); it != m_faces.end(); it++) {
+      ClosestHit(&hit, GetLocalVertexPool(), GetStrideInBytes(), *it, 3);
+    }
+    return hit.m_t;
+  }
+
+  static ndIntersectStatus CollectFace(void* const context, const ndFloat32* const, ndInt32, const ndInt32* const indexArray, ndInt32, ndFloat32) {
+    ((std::set<const ndInt32*>*)context)->insert(indexArray);
+    return m_continueSearh;
+  }
+
+  static ndFloat32 ClosestHit(void* const context, const ndFloat32* const polygon, ndInt32 strideInBytes, const ndInt32* const indexArray, ndInt32 indexCount) {
+    ndClosestHit& hit = *((ndClosestHit*)context);
+    const ndVector normal(ndVector(&polygon[indexArray[indexCount + 1] * (strideInBytes / ndInt32(sizeof(ndFloat32)))]) & ndVector::m_triplexMask);
+    const ndFloat32 t = hit.m_ray.PolygonIntersect(normal, 1.0f, polygon, strideInBytes, indexArray, indexCount);
+    hit.m_t = ndMin(hit.m_t, t);
+    return t;
+  }
+
+  std::set<const ndInt32*> m_faces;
+};
+
+/* The four wide node traversal finds every face that overlaps the query and no face outside its candidates. */
+TEST(PolygonSoup, WideNodeTraversalMatchesBruteForce) {
+  // a bumpy terrain, so that the tree nodes are not flat
+  ndPolygonSoupBuilder meshBuilder;
+  meshBuilder.Begin();
+  auto Height = [](int i, int j) { return ndFloat32(0.5f * ndSin(ndFloat32(i) * 0.37f) * ndCos(ndFloat32(j) * 0.23f)); };
+  for (int i = 0; i < 48; i++) {
+    for (int j = 0; j < 48; j++) {
+      const ndVector p00(ndFloat32(i) * 0.5f, Height(i, j), ndFloat32(j) * 0.5f, 0.0f);
+      const ndVector p01(ndFloat32(i) * 0.5f, Height(i, j + 1), ndFloat32(j + 1) * 0.5f, 0.0f);
+      const ndVector p10(ndFloat32(i + 1) * 0.5f, Height(i + 1, j), ndFloat32(j) * 0.5f, 0.0f);
+      const ndVector p11(ndFloat32(i + 1) * 0.5f, Height(i + 1, j + 1), ndFloat32(j + 1) * 0.5f, 0.0f);
+      ndVector face0[3] = { p00, p01, p11 };
+      ndVector face1[3] = { p00, p11, p10 };
+      meshBuilder.AddFace(&face0[0].m_x, sizeof(ndVector), 3, 0);
+      meshBuilder.AddFace(&face1[0].m_x, sizeof(ndVector), 3, 0);
+    }
+  }
+  meshBuilder.End(false);
+  ndShapeInstance instance(new ndTestPolygonSoup(meshBuilder));
+  const ndTestPolygonSoup* const soup = (const ndTestPolygonSoup*)instance.GetShape()->GetAsShapeStaticBVH();
+
+  EXPECT_EQ(soup->m_faces.size(), size_t(48 * 48 * 2));
+
+  ndSetRandSeed(17);
+  int overlaps = 0;
+  for (int i = 0; i < 500; i++) {
+    ndMatrix matrix(ndPitchMatrix(ndRand() * ndPi) * ndYawMatrix(ndRand() * ndPi) * ndRollMatrix(ndRand() * ndPi));
+    matrix.m_posit = ndVector(ndRand() * 24.0f, ndRand() * 2.0f - 1.0f, ndRand() * 24.0f, 1.0f);
+    const ndVector size(ndRand() * 2.0f + 0.1f, ndRand() * 2.0f + 0.1f, ndRand() * 2.0f + 0.1f, 0.0f);
+    const ndTestOrientedBox box(matrix, size);
+    const std::set<const ndInt32*> faces(soup->GetFaces(box));
+    // the wide nodes also test the box of each face against the axes of the
+    // oriented box, so they can skip faces that the face test alone accepts.
+    const std::set<const ndInt32*> overlapping(soup->GetFacesBruteForce(box, true));
+    const std::set<const ndInt32*> candidates(soup->GetFacesBruteForce(box, false));
+    EXPECT_TRUE(std::includes(faces.begin(), faces.end(), overlapping.begin(), overlapping.end()));
+    EXPECT_TRUE(std::includes(candidates.begin(), candidates.end(), faces.begin(), faces.end()));
+    overlaps += faces.size() ? 1 : 0;
+  }
+  EXPECT_GT(overlaps, 100);
+
+  int hits = 0;
+  for (int i = 0; i < 500; i++) {
+    const ndVector p0(ndRand() * 24.0f, ndRand() * 4.0f - 2.0f, ndRand() * 24.0f, 0.0f);
+    ndVector p1(ndRand() * 24.0f, ndRand() * 4.0f - 2.0f, ndRand() * 24.0f, 0.0f);
+    if (i % 4 == 0) {
+      // axis aligned rays take the parallel path of the slab test
+      p1 = ndVector(p0.m_x, p0.m_y - 3.0f, p0.m_z, 0.0f);
+    }
+    const ndFloat32 t0 = soup->RayHit(p0, p1);
+    const ndFloat32 t1 = soup->RayHitBruteForce(p0, p1);
+    EXPECT_EQ(t0 < 1.0f, t1 < 1.0f);
+    if ((t0 < 1.0f) && (t1 < 1.0f)) {
+      EXPECT_NEAR(t0, t1, 1.0e-5f);
+      hits++;
+    }
+  }
+  EXPECT_GT(hits, 100);
+}
+
+static void AddTestTerrain(ndPolygonSoupBuilder& meshBuilder, int cells, ndFloat32 amplitude) {
+  auto Height = [amplitude](int i, int j) { return amplitude * ndSin(ndFloat32(i) * 0.37f) * ndCos(ndFloat32(j) * 0.23f); };
+  for (int i = 0; i < cells; i++) {
+    for (int j = 0; j < cells; j++) {
+      const ndVector p00(ndFloat32(i) * 0.5f, Height(i, j), ndFloat32(j) * 0.5f, 0.0f);
+      const ndVector p01(ndFloat32(i) * 0.5f, Height(i, j + 1), ndFloat32(j + 1) * 0.5f, 0.0f);
+      const ndVector p10(ndFloat32(i + 1) * 0.5f, Height(i + 1, j), ndFloat32(j) * 0.5f, 0.0f);
+      const ndVector p11(ndFloat32(i + 1) * 0.5f, Height(i + 1, j + 1), ndFloat32(j + 1) * 0.5f, 0.0f);
+      ndVector face0[3] = { p00, p01, p11 };
+      ndVector face1[3] = { p00, p11, p10 };
+      meshBuilder.AddFace(&face0[0].m_x, sizeof(ndVector), 3, 0);
+      meshBuilder.AddFace(&face1[0].m_x, sizeof(ndVector), 3, 0);
+    }
+  }
+}
+
+/* Threaded and welded polygon soup builds produce the same mesh as the serial build. */
+TEST(PolygonSoup, ThreadedSoupBuildMatchesSerial) {
+  ndWorld world;
+  world.SetThreadCount(4);
+  ndThreadPool& threadPool = *world.GetScene();
+
+  // the threaded build must produce the same mesh as the serial one
+  ndPolygonSoupBuilder serialBuilder;
+  serialBuilder.Begin();
+  AddTestTerrain(serialBuilder, 64, 0.5f);
+  serialBuilder.End(false);
+  ndShapeInstance serialInstance(new ndTestPolygonSoup(serialBuilder));
+  const ndTestPolygonSoup* const serial = (const ndTestPolygonSoup*)serialInstance.GetShape()->GetAsShapeStaticBVH();
+
+  ndPolygonSoupBuilder threadedBuilder;
+  threadedBuilder.Begin();
+  AddTestTerrain(threadedBuilder, 64, 0.5f);
+  threadedBuilder.End(false, threadPool);
+  ndShapeInstance threadedInstance(new ndTestPolygonSoup(threadedBuilder, threadPool));
+  const ndTestPolygonSoup* const threaded = (const ndTestPolygonSoup*)threadedInstance.GetShape()->GetAsShapeStaticBVH();
+
+  EXPECT_EQ(serial->m_faces.size(), size_t(64 * 64 * 2));
+  ASSERT_EQ(serial->GetVertexCount(), threaded->GetVertexCount());
+  const size_t vertexSize = size_t(serial->GetVertexCount() * serial->GetStrideInBytes());
+  EXPECT_EQ(memcmp(serial->GetLocalVertexPool(), threaded->GetLocalVertexPool(), vertexSize), 0);
+  EXPECT_TRUE(serial->GetFaceIndices() == threaded->GetFaceIndices());
+
+  // welded faces are merged as they arrive, so the vertex order differs
+  // but the mesh has the same points and the same surface.
+  ndPolygonSoupBuilder weldedBuilder;
+  weldedBuilder.BeginWelded();
+  AddTestTerrain(weldedBuilder, 64, 0.5f);
+  weldedBuilder.End(false, threadPool);
+  ndShapeInstance weldedInstance(new ndTestPolygonSoup(weldedBuilder, threadPool));
+  const ndTestPolygonSoup* const welded = (const ndTestPolygonSoup*)weldedInstance.GetShape()->GetAsShapeStaticBVH();
+
+  EXPECT_EQ(serial->GetVertexCount(), welded->GetVertexCount());
+  EXPECT_EQ(serial->m_faces.size(), welded->m_faces.size());
+  EXPECT_EQ(serial->GetConcaveEdgeCount(), welded->GetConcaveEdgeCount());
+
+  ndSetRandSeed(23);
+  int hits = 0;
+  for (int i = 0; i < 200; i++) {
+    const ndVector p0(ndRand() * 32.0f, 2.0f, ndRand() * 32.0f, 0.0f);
+    const ndVector p1(ndRand() * 32.0f, -2.0f, ndRand() * 32.0f, 0.0f);
+    const ndFloat32 t0 = serial->RayHit(p0, p1);
+    const ndFloat32 t1 = welded->RayHit(p0, p1);
+    EXPECT_NEAR(t0, t1, 1.0e-5f);
+    hits += (t0 < 1.0f) ? 1 : 0;
+  }
+  EXPECT_GT(hits, 100);
+
+  // on a flat grid only the edges on the border of the mesh are concave
+  ndPolygonSoupBuilder flatBuilder;
+  flatBuilder.BeginWelded();
+  AddTestTerrain(flatBuilder, 16, 0.0f);
+  flatBuilder.End(false, threadPool);
+  ndShapeInstance flatInstance(new ndTestPolygonSoup(flatBuilder, threadPool));
+  const ndTestPolygonSoup* const flat = (const ndTestPolygonSoup*)flatInstance.GetShape()->GetAsShapeStaticBVH();
+  EXPECT_EQ(flat->GetConcaveEdgeCount(), 4 * 16);
+}
+
+/* Edges shared by more than two faces, or by two faces with the same winding, stay open while the other edges are matched. */
+TEST(PolygonSoup, NonManifoldEdgesStayOpen) {
+  auto OpenEdgeCount = [](const ndVector* const faces, int faceCount) {
+    ndPolygonSoupBuilder builder;
+    builder.Begin();
+    for (int i = 0; i < faceCount; i++) {
+      builder.AddFace(&faces[i * 3].m_x, sizeof(ndVector), 3, 0);
+    }
+    builder.End(false);
+    ndShapeInstance instance(new ndTestPolygonSoup(builder));
+    const ndTestPolygonSoup* const soup = (const ndTestPolygonSoup*)instance.GetShape()->GetAsShapeStaticBVH();
+    EXPECT_EQ(soup->m_faces.size(), size_t(faceCount));
+    return soup->GetConcaveEdgeCount();
+  };
+
+  const ndVector q0(0.0f, 0.0f, 0.0f, 0.0f);
+  const ndVector q1(0.0f, 0.0f, 1.0f, 0.0f);
+  const ndVector a(1.0f, 0.0f, 0.5f, 0.0f);
+  const ndVector b(-1.0f, 0.0f, 0.5f, 0.0f);
+  const ndVector c(0.0f, 1.0f, 0.5f, 0.0f);
+  const ndVector d(1.0f, 0.0f, 1.5f, 0.0f);
+
+  // two flat faces and a vertical fin on the edge q0 q1, with a fourth face on the edge q1 a.
+  // only the edge q1 a is matched, the three sides of the fin edge stay open.
+  const ndVector fin[] = { q0, q1, a, q1, q0, b, q0, q1, c, a, q1, d };
+  EXPECT_EQ(OpenEdgeCount(fin, 4), 4 * 3 - 2);
+
+  // without the fin the two flat faces share the edge q0 q1 as well.
+  const ndVector flat[] = { q0, q1, a, q1, q0, b, a, q1, d };
+  EXPECT_EQ(OpenEdgeCount(flat, 3), 3 * 3 - 4);
+
+  // two faces with the same winding on the edge q0 q1 face opposite ways and are not matched.
+  const ndVector flipped[] = { q0, q1, a, q0, q1, b };
+  EXPECT_EQ(OpenEdgeCount(flipped, 2), 2 * 3);
+}
+
+/* A serialized polygon soup mapped in place answers queries like the original, and bad files are rejected. */
+TEST(PolygonSoup, SerializedSoupIsMappedInPlace) {
+  ndPolygonSoupBuilder meshBuilder;
+  meshBuilder.Begin();
+  AddTestTerrain(meshBuilder, 32, 0.5f);
+  meshBuilder.End(false);
+  ndShapeInstance instance(new ndTestPolygonSoup(meshBuilder));
+  const ndTestPolygonSoup* const soup = (const ndTestPolygonSoup*)instance.GetShape()->GetAsShapeStaticBVH();
+
+  const char* const path = "ndSerializedSoupTest.bin";
+  soup->Serialize(path);
+  {
+    ndShapeInstance loadedInstance(new ndTestPolygonSoup(path));
+    const ndTestPolygonSoup* const loaded = (const ndTestPolygonSoup*)loadedInstance.GetShape()->GetAsShapeStaticBVH();
+    ASSERT_EQ(soup->GetVertexCount(), loaded->GetVertexCount());
+    const size_t vertexSize = size_t(soup->GetVertexCount() * soup->GetStrideInBytes());
+    EXPECT_EQ(memcmp(soup->GetLocalVertexPool(), loaded->GetLocalVertexPool(), vertexSize), 0);
+    EXPECT_TRUE(soup->GetFaceIndices() == loaded->GetFaceIndices());
+
+    ndSetRandSeed(29);
+    for (int i = 0; i < 100; i++) {
+      const ndVector p0(ndRand() * 16.0f, 2.0f, ndRand() * 16.0f, 0.0f);
+      const ndVector p1(ndRand() * 16.0f, -2.0f, ndRand() * 16.0f, 0.0f);
+      EXPECT_EQ(soup->RayHit(p0, p1), loaded->RayHit(p0, p1));
+    }
+
+    // the mapping is copy on write, changes are private to the loaded mesh
+    const ndInt32* const face = *loaded->m_faces.begin();
+    loaded->SetTagId(face, 3, 7);
+    EXPECT_EQ(loaded->GetTagId(face, 3), 7u);
+  }
+  {
+    ndShapeInstance loadedInstance(new ndTestPolygonSoup(path));
+    const ndTestPolygonSoup* const loaded = (const ndTestPolygonSoup*)loadedInstance.GetShape()->GetAsShapeStaticBVH();
+    EXPECT_TRUE(soup->GetFaceIndices() == loaded->GetFaceIndices());
+  }
+
+  // files from a machine with a different byte order, cut short or with extra bytes, are rejected
+  FILE* const file = fopen(path, "rb");
+  ASSERT_TRUE(file != nullptr);
+  fseek(file, 0, SEEK_END);
+  std::vector<char> contents(size_t(ftell(file)));
+  fseek(file, 0, SEEK_SET);
+  const size_t size = fread(&contents[0], 1, contents.size(), file);
+  fclose(file);
+  ASSERT_EQ(size, contents.size());
+  ASSERT_GT(size, size_t(1024));
+  const std::vector<char> data(contents.begin(), contents.begin() + 1024);
+
+  std::vector<char> swapped(data);
+  std::reverse(swapped.begin() + 12, swapped.begin() + 16);
+  FILE* const swappedFile = fopen(path, "wb");
+  fwrite(&swapped[0], 1, swapped.size(), swappedFile);
+  fclose(swappedFile);
+  {
+    ndShapeInstance loadedInstance(new ndTestPolygonSoup(path));
+    const ndTestPolygonSoup* const loaded = (const ndTestPolygonSoup*)loadedInstance.GetShape()->GetAsShapeStaticBVH();
+    EXPECT_EQ(loaded->GetVertexCount(), 0);
+    EXPECT_EQ(loaded->m_faces.size(), size_t(0));
+  }
+
+  FILE* const truncatedFile = fopen(path, "wb");
+  fwrite(&data[0], 1, data.size(), truncatedFile);
+  fclose(truncatedFile);
+  {
+    ndShapeInstance loadedInstance(new ndTestPolygonSoup(path));
+    const ndTestPolygonSoup* const loaded = (const ndTestPolygonSoup*)loadedInstance.GetShape()->GetAsShapeStaticBVH();
+    EXPECT_EQ(loaded->GetVertexCount(), 0);
+  }
+
+  std::vector<char> padded(contents);
+  padded.resize(padded.size() + 64, 0);
+  FILE* const paddedFile = fopen(path, "wb");
+  fwrite(&padded[0], 1, padded.size(), paddedFile);
+  fclose(paddedFile);
+  {
+    ndShapeInstance loadedInstance(new ndTestPolygonSoup(path));
+    const ndTestPolygonSoup* const loaded = (const ndTestPolygonSoup*)loadedInstance.GetShape()->GetAsShapeStaticBVH();
+    EXPECT_EQ(loaded->GetVertexCount(), 0);
+  }
+
+  // the untouched file still loads
+  FILE* const originalFile = fopen(path, "wb");
+  fwrite(&contents[0], 1, contents.size(), originalFile);
+  fclose(originalFile);
+  {
+    ndShapeInstance loadedInstance(new ndTestPolygonSoup(path));
+    const ndTestPolygonSoup* const loaded = (const ndTestPolygonSoup*)loadedInstance.GetShape()->GetAsShapeStaticBVH();
+    EXPECT_EQ(loaded->GetVertexCount(), soup->GetVertexCount());
+  }
+  remove(path);
+}
@@ -13,6 +13,7 @@
 #include <cstdio>
 #include "ndNewton.h"
 #include <gtest/gtest.h>
+#include <map>
 
 using ClientNodePtr = std::shared_ptr<class ClientNode>;
 
@@ -205,3 +206,90 @@ TEST(RayCast, rayCastFilter)
 	// the second body hitpoint z coordinate should be Z_OFFSET + HALF_BOX_DIM;
 	EXPECT_TRUE(info.position.m_z == Z_OFFSET + HALF_BOX_DIM); 
 }
+
+// a floor with a pile of 200 boxes in two layers
+static void BuildBoxPile(ndWorld& world, std::map<const ndBody*, int>& bodyIndex) {
+  ndShapeInstance floorShape(new ndShapeBox(40.0f, 1.0f, 40.0f));
+  ndBodyKinematic* const floor = new ndBodyKinematic();
+  floor->SetCollisionShape(floorShape);
+  floor->SetMatrix(ndGetIdentityMatrix());
+  ndSharedPtr<ndBody> floorPtr(floor);
+  world.AddBody(floorPtr);
+  bodyIndex[floor] = 0;
+
+  ndShapeInstance shape(new ndShapeBox(1.0f, 1.0f, 1.0f));
+  for (int i = 0; i < 200; i++) {
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = ndVector(ndFloat32(i % 10) * 1.05f, 1.0f + ndFloat32(i / 100) * 1.02f, ndFloat32((i / 10) % 10) * 1.05f, 1.0f);
+    ndBodyDynamic* const body = new ndBodyDynamic();
+    body->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+    body->SetCollisionShape(shape);
+    body->SetMatrix(matrix);
+    body->SetMassMatrix(1.0f, shape);
+    ndSharedPtr<ndBody> bodyPtr(body);
+    world.AddBody(bodyPtr);
+    bodyIndex[body] = i + 1;
+  }
+}
+
+/* Batched ray and convex casts return the same closest hits as the single queries. */
+TEST(RayCast, RayCastBatchMatchesRayCast) {
+  ndWorld world;
+  world.SetThreadCount(ndThreadPool::GetMaxThreads());
+  std::map<const ndBody*, int> bodyIndex;
+  BuildBoxPile(world, bodyIndex);
+  for (int i = 0; i < 30; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+
+  // an odd count leaves a partial packet, and the last query is degenerated.
+  ndArray<ndRayCastBatchQuery> queries;
+  for (int i = 0; i < 103; i++) {
+    ndRayCastBatchQuery query;
+    query.m_origin = ndVector(ndFloat32(i % 13) * 0.83f - 1.0f, 6.0f, ndFloat32(i / 13) * 1.3f - 1.0f, 0.0f);
+    query.m_dest = query.m_origin + ndVector(ndFloat32(i % 3) - 1.0f, -8.0f, ndFloat32(i % 5) * 0.5f - 1.0f, 0.0f);
+    queries.PushBack(query);
+  }
+  queries[queries.GetCount() - 1].m_dest = queries[queries.GetCount() - 1].m_origin;
+
+  ndArray<ndCastBatchHit> hits;
+  world.RayCastBatch(queries, hits);
+  ASSERT_EQ(hits.GetCount(), queries.GetCount());
+  int hitCount = 0;
+  for (ndInt32 i = 0; i < queries.GetCount() - 1; i++) {
+    ndRayCastClosestHitCallback callback;
+    const bool hit = world.RayCast(callback, queries[i].m_origin, queries[i].m_dest);
+    EXPECT_EQ(hit, hits[i].m_body != nullptr);
+    if (hit) {
+      hitCount++;
+      EXPECT_EQ(hits[i].m_body, callback.m_contact.m_body0);
+      EXPECT_NEAR(hits[i].m_param, callback.m_param, 1.0e-5f);
+    }
+  }
+  EXPECT_GT(hitCount, 50);
+  EXPECT_TRUE(hits[queries.GetCount() - 1].m_body == nullptr);
+
+  ndShapeInstance sphere(new ndShapeSphere(0.25f));
+  ndArray<ndConvexCastBatchQuery> sweeps;
+  for (int i = 0; i < 9; i++) {
+    ndConvexCastBatchQuery sweep;
+    sweep.m_origin = ndGetIdentityMatrix();
+    sweep.m_origin.m_posit = ndVector(ndFloat32(i) * 1.05f, 6.0f, 2.1f, 1.0f);
+    sweep.m_dest = sweep.m_origin.m_posit - ndVector(0.0f, 8.0f, 0.0f, 0.0f);
+    sweeps.PushBack(sweep);
+  }
+  world.ConvexCastBatch(sphere, sweeps, hits);
+  ASSERT_EQ(hits.GetCount(), sweeps.GetCount());
+  for (ndInt32 i = 0; i < sweeps.GetCount(); i++) {
+    class ndConvexCastAll : public ndConvexCastNotify {
+      public:
+      ndUnsigned32 OnRayPrecastAction(const ndBody* const, const ndShapeInstance* const) { return 1; }
+    };
+    ndConvexCastAll callback;
+    EXPECT_TRUE(world.ConvexCast(callback, sphere, sweeps[i].m_origin, sweeps[i].m_dest));
+    EXPECT_TRUE(hits[i].m_body != nullptr);
+    EXPECT_NEAR(hits[i].m_param, callback.m_param, 1.0e-5f);
+  }
+  world.CleanUp();
+}
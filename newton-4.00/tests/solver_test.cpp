@@ -0,0 +1,64 @@
+/* Copyright (c) <2003-2019> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+#include "ndNewton.h"
+#include <gtest/gtest.h>
+
+/* The graph colored Gauss Seidel solver keeps a box column standing. */
+TEST(Solver, GaussSeidelSolverStack) {
+  ndWorld world;
+  world.SelectSolver(ndWorld::ndGaussSeidelSolver);
+  EXPECT_EQ(world.GetSelectedSolver(), ndWorld::ndGaussSeidelSolver);
+  EXPECT_STREQ(world.GetSolverString(), "gauss seidel");
+
+  ndShapeInstance floorShape(new ndShapeBox(40.0f, 1.0f, 40.0f));
+  ndMatrix floorMatrix(ndGetIdentityMatrix());
+  floorMatrix.m_posit.m_y = -0.5f;
+  ndBodyKinematic* const floor = new ndBodyKinematic();
+  floor->SetCollisionShape(floorShape);
+  floor->SetMatrix(floorMatrix);
+  ndSharedPtr<ndBody> floorPtr(floor);
+  world.AddBody(floorPtr);
+
+  const int stackHigh = 12;
+  ndBodyDynamic* top = nullptr;
+  ndShapeInstance shape(new ndShapeBox(1.0f, 1.0f, 1.0f));
+  for (int i = 0; i < stackHigh; i++) {
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = ndVector(0.0f, 0.5f + ndFloat32(i) * 1.05f, 0.0f, 1.0f);
+    ndBodyDynamic* const box = new ndBodyDynamic();
+    box->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+    box->SetCollisionShape(shape);
+    box->SetMatrix(matrix);
+    box->SetMassMatrix(1.0f, shape);
+    box->SetAutoSleep(false);
+    ndSharedPtr<ndBody> boxPtr(box);
+    world.AddBody(boxPtr);
+    top = box;
+  }
+
+  for (int i = 0; i < 240; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+
+  const ndVector posit(top->GetMatrix().m_posit);
+  EXPECT_NEAR(posit.m_y, ndFloat32(stackHigh) - 0.5f, 0.1f);
+  EXPECT_NEAR(posit.m_x, 0.0f, 0.05f);
+  EXPECT_NEAR(posit.m_z, 0.0f, 0.05f);
+
+  // switching back restores the default solver
+  world.SelectSolver(ndWorld::ndStandardSolver);
+  EXPECT_EQ(world.GetSelectedSolver(), ndWorld::ndStandardSolver);
+  world.Update(1.0f / 60.0f);
+  world.Sync();
+  world.CleanUp();
+}
@@ -1472,4 +1472,153 @@ TEST(StaticBody, mesh)
 	EXPECT_NEAR(staticBunny->GetMatrix().m_posit.m_x, startPosition.m_x, 1E-6);
 	EXPECT_NEAR(staticBunny->GetMatrix().m_posit.m_y, startPosition.m_y, 1E-6);
 	EXPECT_NEAR(staticBunny->GetMatrix().m_posit.m_z, startPosition.m_z, 1E-6);
-}
\ No newline at end of file
+}
+
+/* A box sliding on a static mesh reuses its cached faces and its manifold stays at four points. */
+TEST(StaticBody, StaticMeshFaceCache) {
+  ndWorld world;
+
+  // a floor made of small triangles, so a box sliding on it touches many faces.
+  ndPolygonSoupBuilder meshBuilder;
+  meshBuilder.Begin();
+  for (int i = -20; i < 20; i++) {
+    for (int j = -20; j < 20; j++) {
+      const ndFloat32 x0 = ndFloat32(i) * 0.25f;
+      const ndFloat32 z0 = ndFloat32(j) * 0.25f;
+      const ndFloat32 x1 = x0 + 0.25f;
+      const ndFloat32 z1 = z0 + 0.25f;
+      ndVector face0[3] = { ndVector(x0, 0.0f, z0, 0.0f), ndVector(x0, 0.0f, z1, 0.0f), ndVector(x1, 0.0f, z1, 0.0f) };
+      ndVector face1[3] = { ndVector(x0, 0.0f, z0, 0.0f), ndVector(x1, 0.0f, z1, 0.0f), ndVector(x1, 0.0f, z0, 0.0f) };
+      meshBuilder.AddFace(&face0[0].m_x, sizeof(ndVector), 3, 0);
+      meshBuilder.AddFace(&face1[0].m_x, sizeof(ndVector), 3, 0);
+    }
+  }
+  meshBuilder.End(false);
+
+  ndShapeInstance floorShape(new ndShapeStatic_bvh(meshBuilder));
+  ndBodyKinematic* const floor = new ndBodyKinematic();
+  floor->SetCollisionShape(floorShape);
+  floor->SetMatrix(ndGetIdentityMatrix());
+  ndSharedPtr<ndBody> floorPtr(floor);
+  world.AddBody(floorPtr);
+
+  ndShapeInstance shape(new ndShapeBox(1.0f, 0.5f, 1.0f));
+  ndMatrix matrix(ndGetIdentityMatrix());
+  matrix.m_posit = ndVector(-2.0f, 0.26f, 0.1f, 1.0f);
+  ndBodyDynamic* const box = new ndBodyDynamic();
+  box->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+  box->SetCollisionShape(shape);
+  box->SetMatrix(matrix);
+  box->SetMassMatrix(1.0f, shape);
+  box->SetAutoSleep(false);
+  box->SetVelocity(ndVector(2.0f, 0.0f, 0.0f, 0.0f));
+  ndSharedPtr<ndBody> boxPtr(box);
+  world.AddBody(boxPtr);
+
+  // the box of a sphere overlaps faces that the sphere does not touch, 
+  // their polygon test is skipped while the sphere stays away from them.
+  ndShapeInstance sphereShape(new ndShapeSphere(0.3f));
+  ndMatrix sphereMatrix(ndGetIdentityMatrix());
+  sphereMatrix.m_posit = ndVector(3.0f, 0.31f, 3.0f, 1.0f);
+  ndBodyDynamic* const sphere = new ndBodyDynamic();
+  sphere->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+  sphere->SetCollisionShape(sphereShape);
+  sphere->SetMatrix(sphereMatrix);
+  sphere->SetMassMatrix(1.0f, sphereShape);
+  sphere->SetAutoSleep(false);
+  ndSharedPtr<ndBody> spherePtr(sphere);
+  world.AddBody(spherePtr);
+
+  ndInt32 hits = 0;
+  ndInt32 skips = 0;
+  ndInt32 lookups = 0;
+  for (int i = 0; i < 60; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    hits += world.GetScene()->GetMeshFaceCacheHits();
+    skips += world.GetScene()->GetMeshFaceCacheSkips();
+    lookups += world.GetScene()->GetMeshFaceCacheLookups();
+
+    // the box covers dozens of faces, but the manifold is reduced to four points.
+    const ndContactArray& contacts = world.GetContactList();
+    for (ndInt32 j = 0; j < contacts.GetCount(); j++) {
+      EXPECT_LE(contacts[j]->GetContactPoints().GetCount(), 4);
+    }
+  }
+
+  // the box slides a fraction of the cache padding per step, 
+  // so most queries reuse the faces of a previous step.
+  EXPECT_GT(lookups, 0);
+  EXPECT_GT(hits * 2, lookups);
+  EXPECT_GT(skips, 0);
+
+  // and it rests on the floor without sinking or tilting.
+  const ndMatrix boxMatrix(box->GetMatrix());
+  EXPECT_NEAR(boxMatrix.m_posit.m_y, 0.25f, 0.01f);
+  EXPECT_GT(boxMatrix.m_up.m_y, 0.999f);
+  EXPECT_GT(boxMatrix.m_posit.m_x, -1.9f);
+  EXPECT_NEAR(sphere->GetMatrix().m_posit.m_y, 0.3f, 0.01f);
+  world.CleanUp();
+}
+
+/* A hull far from its origin, spinning around that origin into a mesh face, is stopped by the face. */
+TEST(StaticBody, StaticMeshFaceCacheOffCenterHull) {
+  ndWorld world;
+
+  // a wall in the plane z = 1.5, facing the hull
+  ndPolygonSoupBuilder meshBuilder;
+  meshBuilder.Begin();
+  ndVector face0[3] = { ndVector(1.5f, -1.0f, 1.5f, 0.0f), ndVector(4.5f, 1.0f, 1.5f, 0.0f), ndVector(4.5f, -1.0f, 1.5f, 0.0f) };
+  ndVector face1[3] = { ndVector(1.5f, -1.0f, 1.5f, 0.0f), ndVector(1.5f, 1.0f, 1.5f, 0.0f), ndVector(4.5f, 1.0f, 1.5f, 0.0f) };
+  meshBuilder.AddFace(&face0[0].m_x, sizeof(ndVector), 3, 0);
+  meshBuilder.AddFace(&face1[0].m_x, sizeof(ndVector), 3, 0);
+  meshBuilder.End(false);
+
+  ndShapeInstance wallShape(new ndShapeStatic_bvh(meshBuilder));
+  ndBodyKinematic* const wall = new ndBodyKinematic();
+  wall->SetCollisionShape(wallShape);
+  wall->SetMatrix(ndGetIdentityMatrix());
+  ndSharedPtr<ndBody> wallPtr(wall);
+  world.AddBody(wallPtr);
+
+  // a wedge three units away from the origin of the hull, turning around that
+  // origin. the empty corner of its box reaches the wall before the wedge, so
+  // the wall faces are skipped for a few steps before the wedge touches them.
+  ndVector points[6];
+  for (int i = 0; i < 2; i++) {
+    const ndFloat32 y = i ? 0.1f : -0.1f;
+    points[i * 3 + 0] = ndVector(3.0f, y, -0.1f, 0.0f);
+    points[i * 3 + 1] = ndVector(3.5f, y, -0.1f, 0.0f);
+    points[i * 3 + 2] = ndVector(3.0f, y, 0.4f, 0.0f);
+  }
+  ndShapeInstance wedgeShape(new ndShapeConvexHull(6, sizeof(ndVector), 0.0f, &points[0].m_x));
+  ndBodyDynamic* const wedge = new ndBodyDynamic();
+  wedge->SetNotifyCallback(new ndBodyNotify(ndVector::m_zero));
+  wedge->SetCollisionShape(wedgeShape);
+  wedge->SetMatrix(ndGetIdentityMatrix());
+  wedge->SetMassMatrix(1.0f, wedgeShape);
+  wedge->SetCentreOfMass(ndVector::m_wOne);
+  wedge->SetAutoSleep(false);
+  wedge->SetOmega(ndVector(0.0f, -0.5f, 0.0f, 0.0f));
+  ndSharedPtr<ndBody> wedgePtr(wedge);
+  world.AddBody(wedgePtr);
+
+  ndInt32 skips = 0;
+  ndFloat32 maxZ = -1.0e10f;
+  for (int i = 0; i < 90; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    skips += world.GetScene()->GetMeshFaceCacheSkips();
+    const ndMatrix matrix(wedge->GetMatrix());
+    for (int j = 0; j < 6; j++) {
+      maxZ = ndMax(maxZ, matrix.TransformVector(points[j]).m_z);
+    }
+  }
+
+  // the faces are skipped while the wedge is away, but the
+  // wedge does not go through the wall when it gets there.
+  EXPECT_GT(skips, 0);
+  EXPECT_GT(maxZ, 1.45f);
+  EXPECT_LT(maxZ, 1.53f);
+  world.CleanUp();
+}
@@ -0,0 +1,101 @@
+/* Copyright (c) <2003-2019> <Newton Game Dynamics>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely
+ */
+
+#include "ndNewton.h"
+#include <gtest/gtest.h>
+
+class ndTestThreadPool: public ndThreadPool
+{
+	public:
+	ndTestThreadPool()
+		:ndThreadPool("testPool")
+	{
+		SetThreadCount(GetMaxThreads());
+		Begin();
+	}
+
+	~ndTestThreadPool()
+	{
+		End();
+		Finish();
+	}
+
+	virtual void ThreadFunction()
+	{
+	}
+};
+
+TEST(TaskGraph, DependenciesAndContinuations)
+{
+	const ndInt32 count = 10000;
+	ndArray<ndInt32> values;
+	values.SetCount(count);
+
+	ndAtomic<ndInt32> stage(0);
+	ndAtomic<ndInt32> errors(0);
+
+	ndTaskGraph graph;
+	ndTaskGraph::ndNode* const clear = graph.AddParallelFor(count, [&values](ndInt32, ndInt32 start, ndInt32 items)
+	{
+		for (ndInt32 i = 0; i < items; ++i)
+		{
+			values[start + i] = start + i;
+		}
+	});
+
+	ndTaskGraph::ndNode* const square = graph.AddParallelFor(count, [&values](ndInt32, ndInt32 start, ndInt32 items)
+	{
+		for (ndInt32 i = 0; i < items; ++i)
+		{
+			values[start + i] = values[start + i] * 2;
+		}
+	});
+
+	ndTaskGraph::ndNode* const check = graph.AddTask([&values, &stage, &errors, count](ndInt32)
+	{
+		for (ndInt32 i = 0; i < count; ++i)
+		{
+			if (values[i] != i * 2)
+			{
+				errors.fetch_add(1);
+			}
+		}
+		stage.fetch_add(1);
+	});
+
+	ndTaskGraph::ndNode* const last = graph.AddTask([&stage, &errors](ndInt32)
+	{
+		if (stage.load() != 1)
+		{
+			errors.fetch_add(1);
+		}
+	});
+
+	graph.AddContinuation(clear, square);
+	graph.AddDependency(square, check);
+	graph.AddDependency(check, last);
+
+	ndTestThreadPool pool;
+	for (ndInt32 i = 0; i < 4; ++i)
+	{
+		stage.store(0);
+		graph.Execute(pool);
+		EXPECT_EQ(errors.load(), 0);
+		EXPECT_EQ(stage.load(), 1);
+	}
+
+	// empty ranges must still release their dependents.
+	clear->SetCount(0);
+	square->SetCount(0);
+	stage.store(0);
+	graph.Execute(pool);
+	EXPECT_EQ(stage.load(), 1);
+}
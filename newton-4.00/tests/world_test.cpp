@@ -11,6 +11,9 @@
 
 #include "ndNewton.h"
 #include <gtest/gtest.h>
+#include <map>
+#include <set>
+#include <algorithm>
 
 /* Baseline test: create and destroy an empty Newton world. */
 TEST(HelloNewton, CreateWorld) {
@@ -19,3 +22,342 @@ TEST(HelloNewton, CreateWorld) {
   world.Update(1.0f / 60.0f);
   world.Sync();
 }
+
+/* Pinned threads and first touch scratch buffers must not change the simulation. */
+TEST(HelloNewton, ThreadAffinityAndFirstTouch) {
+  ndMemory::SetAllocationMode(ndMemory::m_firstTouchAllocation);
+  {
+    ndWorld world;
+    world.SetThreadCount(ndThreadPool::GetMaxThreads());
+    world.SetThreadAffinity(ndThreadPool::m_affinityNumaNodes);
+    world.SetThreadAffinity(ndThreadPool::m_affinityCores);
+    EXPECT_EQ(world.GetThreadAffinity(), ndThreadPool::m_affinityCores);
+
+    ndShapeInstance shape(new ndShapeSphere(0.5f));
+    ndBodyDynamic* const body = new ndBodyDynamic();
+    body->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+    body->SetCollisionShape(shape);
+    body->SetMassMatrix(1.0f, shape);
+    ndSharedPtr<ndBody> bodyPtr(body);
+    world.AddBody(bodyPtr);
+
+    for (int i = 0; i < 60; i++) {
+      world.Update(1.0f / 60.0f);
+      world.Sync();
+    }
+    EXPECT_LT(body->GetMatrix().m_posit.m_y, -1.0f);
+    EXPECT_TRUE(world.GetScene()->IsThreadScratchFirstTouch());
+
+    // changing the thread count keeps the scratch buffers in first touch mode.
+    world.SetThreadCount(ndMax(ndThreadPool::GetMaxThreads() / 2, 1));
+    EXPECT_TRUE(world.GetScene()->IsThreadScratchFirstTouch());
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    EXPECT_TRUE(world.GetScene()->IsThreadScratchFirstTouch());
+
+    world.SetThreadAffinity(ndThreadPool::m_affinityNone);
+    world.CleanUp();
+  }
+  ndMemory::SetAllocationMode(ndMemory::m_defaultAllocation);
+}
+
+/* Once a scene is warmed up, an update does not allocate memory from the heap. */
+TEST(HelloNewton, SteadyStateFrameHeapAllocations) {
+  ndWorld world;
+  world.SetSubSteps(2);
+  world.SetCountHeapAllocations(true);
+
+  ndShapeInstance floorShape(new ndShapeBox(20.0f, 1.0f, 20.0f));
+  ndBodyKinematic* const floor = new ndBodyKinematic();
+  floor->SetCollisionShape(floorShape);
+  floor->SetMatrix(ndGetIdentityMatrix());
+  ndSharedPtr<ndBody> floorPtr(floor);
+  world.AddBody(floorPtr);
+
+  ndShapeInstance shape(new ndShapeBox(1.0f, 1.0f, 1.0f));
+  for (int i = 0; i < 16; i++) {
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = ndVector(ndFloat32(i % 4) * 1.1f, 1.0f + ndFloat32(i / 4) * 1.01f, 0.0f, 1.0f);
+    ndBodyDynamic* const body = new ndBodyDynamic();
+    body->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+    body->SetCollisionShape(shape);
+    body->SetMatrix(matrix);
+    body->SetMassMatrix(1.0f, shape);
+    body->SetAutoSleep(false);
+    ndSharedPtr<ndBody> bodyPtr(body);
+    world.AddBody(bodyPtr);
+  }
+
+  // the first update builds the scene, so it has to be counted.
+  world.Update(1.0f / 60.0f);
+  world.Sync();
+  EXPECT_GT(world.GetFrameHeapAllocations(), ndUnsigned64(0));
+
+  for (int i = 0; i < 120; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+  for (int i = 0; i < 10; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+    EXPECT_EQ(world.GetFrameHeapAllocations(), ndUnsigned64(0));
+  }
+  world.CleanUp();
+}
+
+/* Every contact in the world can be found in the contact map of both its bodies. */
+TEST(HelloNewton, ContactMapMatchesContactList) {
+  ndWorld world;
+
+  ndShapeInstance floorShape(new ndShapeBox(20.0f, 1.0f, 20.0f));
+  ndBodyKinematic* const floor = new ndBodyKinematic();
+  floor->SetCollisionShape(floorShape);
+  floor->SetMatrix(ndGetIdentityMatrix());
+  ndSharedPtr<ndBody> floorPtr(floor);
+  world.AddBody(floorPtr);
+
+  // more than D_CONTACT_MAP_INLINE_SLOTS contacts on the floor forces the table to grow.
+  ndShapeInstance shape(new ndShapeBox(1.0f, 1.0f, 1.0f));
+  for (int i = 0; i < 48; i++) {
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = ndVector(ndFloat32(i % 6) * 1.1f, 1.0f + ndFloat32(i / 36) * 1.01f, ndFloat32((i / 6) % 6) * 1.1f, 1.0f);
+    ndBodyDynamic* const body = new ndBodyDynamic();
+    body->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+    body->SetCollisionShape(shape);
+    body->SetMatrix(matrix);
+    body->SetMassMatrix(1.0f, shape);
+    body->SetAutoSleep(false);
+    ndSharedPtr<ndBody> bodyPtr(body);
+    world.AddBody(bodyPtr);
+  }
+
+  for (int i = 0; i < 60; i++) {
+    world.Update(1.0f / 60.0f);
+    world.Sync();
+  }
+
+  const ndContactArray& contacts = world.GetContactList();
+  EXPECT_GT(floor->GetContactMap().GetCount(), D_CONTACT_MAP_INLINE_SLOTS);
+  for (ndInt32 i = 0; i < contacts.GetCount(); i++) {
+    ndContact* const contact = contacts[i];
+    ndBodyKinematic* const body0 = contact->GetBody0();
+    ndBodyKinematic* const body1 = contact->GetBody1();
+    EXPECT_EQ(body0->GetContactMap().FindContact(body0, body1), contact);
+    EXPECT_EQ(body1->GetContactMap().FindContact(body1, body0), contact);
+  }
+
+  const ndArray<ndBodyKinematic*>& bodies = world.GetScene()->GetActiveBodyArray();
+  for (ndInt32 i = 0; i < bodies.GetCount(); i++) {
+    EXPECT_TRUE(bodies[i]->GetContactMap().SanityCheck());
+  }
+  EXPECT_EQ(floor->GetContactMap().FindContact(floor, floor), nullptr);
+  world.CleanUp();
+}
+
+static void BuildBroadPhaseScene(ndWorld& world, std::map<const ndBody*, int>& bodyIndex) {
+  ndShapeInstance floorShape(new ndShapeBox(40.0f, 1.0f, 40.0f));
+  ndBodyKinematic* const floor = new ndBodyKinematic();
+  floor->SetCollisionShape(floorShape);
+  floor->SetMatrix(ndGetIdentityMatrix());
+  ndSharedPtr<ndBody> floorPtr(floor);
+  world.AddBody(floorPtr);
+  bodyIndex[floor] = 0;
+
+  ndShapeInstance shape(new ndShapeBox(1.0f, 1.0f, 1.0f));
+  for (int i = 0; i < 200; i++) {
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = ndVector(ndFloat32(i % 10) * 1.05f, 1.0f + ndFloat32(i / 100) * 1.02f, ndFloat32((i / 10) % 10) * 1.05f, 1.0f);
+    ndBodyDynamic* const body = new ndBodyDynamic();
+    body->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+    body->SetCollisionShape(shape);
+    body->SetMatrix(matrix);
+    body->SetMassMatrix(1.0f, shape);
+    ndSharedPtr<ndBody> bodyPtr(body);
+    world.AddBody(bodyPtr);
+    bodyIndex[body] = i + 1;
+  }
+}
+
+static std::set<std::pair<int, int>> GetContactPairs(ndWorld& world, std::map<const ndBody*, int>& bodyIndex) {
+  std::set<std::pair<int, int>> pairs;
+  const ndContactArray& contacts = world.GetContactList();
+  for (ndInt32 i = 0; i < contacts.GetCount(); i++) {
+    const int index0 = bodyIndex[contacts[i]->GetBody0()];
+    const int index1 = bodyIndex[contacts[i]->GetBody1()];
+    pairs.insert(std::make_pair(std::min(index0, index1), std::max(index0, index1)));
+  }
+  return pairs;
+}
+
+/* The sweep and prune broad phase finds the same pairs as the bvh. */
+TEST(HelloNewton, SweepAndPruneBroadPhase) {
+  ndWorld bvhWorld;
+  ndWorld sapWorld;
+  sapWorld.SetBroadPhaseType(ndScene::ndSweepAndPruneBroadPhase);
+  EXPECT_EQ(sapWorld.GetBroadPhaseType(), ndScene::ndSweepAndPruneBroadPhase);
+
+  std::map<const ndBody*, int> bvhIndex;
+  std::map<const ndBody*, int> sapIndex;
+  BuildBroadPhaseScene(bvhWorld, bvhIndex);
+  BuildBroadPhaseScene(sapWorld, sapIndex);
+
+  bvhWorld.Update(1.0f / 60.0f);
+  bvhWorld.Sync();
+  sapWorld.Update(1.0f / 60.0f);
+  sapWorld.Sync();
+
+  const std::set<std::pair<int, int>> bvhPairs(GetContactPairs(bvhWorld, bvhIndex));
+  const std::set<std::pair<int, int>> sapPairs(GetContactPairs(sapWorld, sapIndex));
+  EXPECT_GT(bvhPairs.size(), size_t(200));
+  EXPECT_TRUE(bvhPairs == sapPairs);
+
+  // the stack settles on the floor
+  for (int i = 0; i < 120; i++) {
+    sapWorld.Update(1.0f / 60.0f);
+    sapWorld.Sync();
+  }
+  const ndBodyListView& bodyList = sapWorld.GetBodyList();
+  for (ndBodyListView::ndNode* node = bodyList.GetFirst(); node; node = node->GetNext()) {
+    ndBodyKinematic* const body = node->GetInfo()->GetAsBodyKinematic();
+    if (body->GetInvMass() > 0.0f) {
+      EXPECT_GT(body->GetMatrix().m_posit.m_y, 0.5f);
+    }
+    EXPECT_TRUE(body->GetContactMap().SanityCheck());
+  }
+
+  bvhWorld.CleanUp();
+  sapWorld.CleanUp();
+}
+
+/* On a wide plane of bodies the banded sweep finds the same pairs as the bvh, and queries still see moving bodies. */
+TEST(HelloNewton, SweepAndPrunePlane) {
+  ndWorld bvhWorld;
+  ndWorld sapWorld;
+  sapWorld.SetBroadPhaseType(ndScene::ndSweepAndPruneBroadPhase);
+
+  std::map<const ndBody*, int> bvhIndex;
+  std::map<const ndBody*, int> sapIndex;
+  ndWorld* const worlds[] = { &bvhWorld, &sapWorld };
+  std::map<const ndBody*, int>* const indices[] = { &bvhIndex, &sapIndex };
+  ndBodyDynamic* dropBody[2];
+  for (int k = 0; k < 2; k++) {
+    ndShapeInstance floorShape(new ndShapeBox(200.0f, 1.0f, 200.0f));
+    ndBodyKinematic* const floor = new ndBodyKinematic();
+    floor->SetCollisionShape(floorShape);
+    floor->SetMatrix(ndGetIdentityMatrix());
+    ndSharedPtr<ndBody> floorPtr(floor);
+    worlds[k]->AddBody(floorPtr);
+    (*indices[k])[floor] = 0;
+
+    // a 40 x 40 grid of boxes resting on the floor, the rows are spaced so that 
+    // the quantized boxes never just touch, where the pair depends on the test order.
+    ndShapeInstance shape(new ndShapeBox(1.0f, 1.0f, 1.0f));
+    for (int i = 0; i < 1600; i++) {
+      ndMatrix matrix(ndGetIdentityMatrix());
+      matrix.m_posit = ndVector(ndFloat32(i % 40) * 1.05f - 20.0f, 1.0f, ndFloat32(i / 40) * 2.0f - 40.0f, 1.0f);
+      ndBodyDynamic* const body = new ndBodyDynamic();
+      body->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+      body->SetCollisionShape(shape);
+      body->SetMatrix(matrix);
+      body->SetMassMatrix(1.0f, shape);
+      ndSharedPtr<ndBody> bodyPtr(body);
+      worlds[k]->AddBody(bodyPtr);
+      (*indices[k])[body] = i + 1;
+    }
+
+    // a box thrown up out of the scene bounds.
+    ndMatrix matrix(ndGetIdentityMatrix());
+    matrix.m_posit = ndVector(60.0f, 10.0f, 60.0f, 1.0f);
+    dropBody[k] = new ndBodyDynamic();
+    dropBody[k]->SetNotifyCallback(new ndBodyNotify(ndVector(0.0f, -10.0f, 0.0f, 0.0f)));
+    dropBody[k]->SetCollisionShape(shape);
+    dropBody[k]->SetMatrix(matrix);
+    dropBody[k]->SetMassMatrix(1.0f, shape);
+    dropBody[k]->SetVelocity(ndVector(0.0f, 40.0f, 0.0f, 0.0f));
+    ndSharedPtr<ndBody> dropPtr(dropBody[k]);
+    worlds[k]->AddBody(dropPtr);
+    (*indices[k])[dropBody[k]] = 1601;
+  }
+
+  bvhWorld.Update(1.0f / 60.0f);
+  bvhWorld.Sync();
+  sapWorld.Update(1.0f / 60.0f);
+  sapWorld.Sync();
+
+  const std::set<std::pair<int, int>> bvhPairs(GetContactPairs(bvhWorld, bvhIndex));
+  const std::set<std::pair<int, int>> sapPairs(GetContactPairs(sapWorld, sapIndex));
+  EXPECT_GT(bvhPairs.size(), size_t(2000));
+  EXPECT_TRUE(bvhPairs == sapPairs);
+
+  for (int i = 0; i < 60; i++) {
+    sapWorld.Update(1.0f / 60.0f);
+    sapWorld.Sync();
+  }
+
+  // the tree is only built once, but a ray still finds the box out of its original bounds.
+  EXPECT_EQ(sapWorld.GetScene()->GetBvhRebuildCount(), ndUnsigned32(1));
+  const ndVector dropPosit(dropBody[1]->GetMatrix().m_posit);
+  EXPECT_GT(dropPosit.m_y, 30.0f);
+  ndRayCastClosestHitCallback rayCaster;
+  EXPECT_TRUE(sapWorld.RayCast(rayCaster, dropPosit + ndVector(0.0f, 2.0f, 0.0f, 0.0f), dropPosit - ndVector(0.0f, 0.25f, 0.0f, 0.0f)));
+  EXPECT_EQ(rayCaster.m_contact.m_body0, dropBody[1]);
+
+  bvhWorld.CleanUp();
+  sapWorld.CleanUp();
+}
+
+/* The refit update keeps the tree valid and only rebuilds it when it degrades. */
+TEST(HelloNewton, BvhRefitUpdate) {
+  ndWorld rebuildWorld;
+  ndWorld refitWorld;
+  refitWorld.GetScene()->SetBvhUpdateType(ndScene::ndBvhRefit);
+  EXPECT_EQ(refitWorld.GetScene()->GetBvhUpdateType(), ndScene::ndBvhRefit);
+
+  std::map<const ndBody*, int> rebuildIndex;
+  std::map<const ndBody*, int> refitIndex;
+  BuildBroadPhaseScene(rebuildWorld, rebuildIndex);
+  BuildBroadPhaseScene(refitWorld, refitIndex);
+
+  rebuildWorld.Update(1.0f / 60.0f);
+  rebuildWorld.Sync();
+  refitWorld.Update(1.0f / 60.0f);
+  refitWorld.Sync();
+  EXPECT_TRUE(GetContactPairs(rebuildWorld, rebuildIndex) == GetContactPairs(refitWorld, refitIndex));
+
+  for (int i = 0; i < 120; i++) {
+    rebuildWorld.Update(1.0f / 60.0f);
+    rebuildWorld.Sync();
+    refitWorld.Update(1.0f / 60.0f);
+    refitWorld.Sync();
+  }
+  EXPECT_GT(rebuildWorld.GetScene()->GetBvhRebuildCount(), ndUnsigned32(1));
+
+  // a resting scene is never rebuilt.
+  const ndUnsigned32 rebuildCount = refitWorld.GetScene()->GetBvhRebuildCount();
+  for (int i = 0; i < 120; i++) {
+    refitWorld.Update(1.0f / 60.0f);
+    refitWorld.Sync();
+  }
+  EXPECT_EQ(refitWorld.GetScene()->GetBvhRebuildCount(), rebuildCount);
+  EXPECT_GT(refitWorld.GetScene()->GetBvhQuality(), 0.0f);
+
+  // queries still find every body.
+  const ndBodyListView& bodyList = refitWorld.GetBodyList();
+  for (ndBodyListView::ndNode* node = bodyList.GetFirst(); node; node = node->GetNext()) {
+    ndBodyKinematic* const body = node->GetInfo()->GetAsBodyKinematic();
+    if (body->GetInvMass() > 0.0f) {
+      const ndVector posit(body->GetMatrix().m_posit);
+      const ndVector size(0.1f, 0.1f, 0.1f, 0.0f);
+      ndBodiesInAabbNotify callback;
+      refitWorld.BodiesInAabb(callback, posit - size, posit + size);
+      bool found = false;
+      for (ndInt32 j = 0; j < callback.m_bodyArray.GetCount(); j++) {
+        found = found || (callback.m_bodyArray[j] == body);
+      }
+      EXPECT_TRUE(found);
+    }
+  }
+
+  rebuildWorld.CleanUp();
+  refitWorld.CleanUp();
+}